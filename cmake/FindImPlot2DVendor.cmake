@@ -27,6 +27,7 @@ if (NOT TARGET implot2d_vendor)
   )
 
   add_library(implot2d_vendor STATIC ${IMPLOT2D_VENDOR_SOURCES})
+  target_include_directories(implot2d_vendor PUBLIC ${implot2d_SOURCE_DIR})
   target_link_libraries(implot2d_vendor PUBLIC imgui::imgui)
   add_library(imgui::ImPlot2D ALIAS implot2d_vendor)
 
@@ -27,13 +27,14 @@ if (NOT TARGET implot3d_vendor)
   )
 
   add_library(implot3d_vendor STATIC ${IMPLOT3D_VENDOR_SOURCES})
+  target_include_directories(implot3d_vendor PUBLIC ${implot3d_SOURCE_DIR})
   target_link_libraries(implot3d_vendor PUBLIC imgui::imgui)
   add_library(imgui::ImPlot3D ALIAS implot3d_vendor)
 
   message(STATUS "imgui::ImPlot3D target created from vendored sources")
 endif ()
 
-if (TARGET imgui::ImPlot2D)
+if (TARGET imgui::ImPlot3D)
   message(STATUS "imgui::ImPlot3D target is available from vendored ImPlot3D")
 else ()
   message(WARNING "ImPlot3D vendored build completed but imgui::ImPlot3D target was not found. Check ImPlot3D's CMake configuration and adjust usage accordingly.")
@@ -0,0 +1,62 @@
+// Packed GEMM of the native engine against onnxruntime (MLAS) on the matrix
+// product shapes of a model.
+//
+//   mynn_gemm_bench <model.onnx> [batch_size] [threads] [iterations]
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "../engine/gemm.h"
+#include "../engine/simd.h"
+#include "../model/inspector.h"
+#include "../runtime/gemm_bench.h"
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::fprintf(stderr,
+                 "usage: %s <model.onnx> [batch_size] [threads] "
+                 "[iterations]\n",
+                 argv[0]);
+    return 1;
+  }
+  const int batch_size = argc > 2 ? std::atoi(argv[2]) : 1;
+  const int threads = argc > 3 ? std::atoi(argv[3]) : 0;
+  const int iterations = argc > 4 ? std::atoi(argv[4]) : 20;
+
+  ModelInspector inspector(argv[1]);
+  const auto shapes =
+      GemmBenchmark::extract_shapes(inspector.graph(), batch_size);
+  if (shapes.empty()) {
+    std::fprintf(stderr, "no static MatMul or Gemm shapes in %s\n", argv[1]);
+    return 1;
+  }
+  const auto &blocking = gemm_blocking();
+  std::printf("isa %s, kc %lld, mc %lld, nc %lld, threads %d\n",
+              simd_isa_name(detected_simd_isa()),
+              static_cast<long long>(blocking.kc),
+              static_cast<long long>(blocking.mc),
+              static_cast<long long>(blocking.nc), threads);
+  std::printf("%6s %6s %6s %5s | %10s %10s %10s | %9s %9s\n", "m", "n", "k",
+              "count", "ort GF/s", "fp32 GF/s", "bf16 GF/s", "fp32 diff",
+              "bf16 diff");
+  for (const auto &shape : shapes) {
+    const auto r = GemmBenchmark::run(shape, threads, iterations);
+    if (!r.ok) {
+      std::printf("%6lld %6lld %6lld %5d | failed: %s\n",
+                  static_cast<long long>(shape.m),
+                  static_cast<long long>(shape.n),
+                  static_cast<long long>(shape.k), shape.count,
+                  r.error.c_str());
+      continue;
+    }
+    std::printf("%6lld %6lld %6lld %5d | %10.1f %10.1f %10.1f | %9.2e "
+                "%9.2e\n",
+                static_cast<long long>(shape.m),
+                static_cast<long long>(shape.n),
+                static_cast<long long>(shape.k), shape.count,
+                r.gflops(r.ort_ms), r.gflops(r.packed_fp32_ms),
+                r.gflops(r.packed_bf16_ms), r.fp32_max_diff, r.bf16_max_diff);
+  }
+  return 0;
+}
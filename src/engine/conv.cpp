@@ -0,0 +1,447 @@
+#include "conv.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "simd.h"
+
+namespace {
+
+// Winograd needs enough channels for its 16 GEMMs to beat the transforms
+constexpr int64_t kWinogradMinChannels = 8;
+
+int64_t winograd_tiles(const sConv2DParams &p) {
+  return ((p.out_height + 1) / 2) * ((p.out_width + 1) / 2);
+}
+
+void pointwise(const sConv2DParams &p, const float *input,
+               const float *weight, const float *bias, float *output,
+               const sActivation &activation) {
+  const auto &simd = simd_kernels();
+  const int64_t plane = p.in_height * p.in_width;
+  for (int64_t n = 0; n < p.batch; ++n) {
+    simd.sgemm(p.out_channels, plane, p.in_channels, weight, p.in_channels,
+               input + n * p.in_channels * plane, plane,
+               output + n * p.out_channels * plane, plane, bias, false);
+    apply_activation(activation, output + n * p.out_channels * plane,
+                     output + n * p.out_channels * plane,
+                     static_cast<size_t>(p.out_channels * plane));
+  }
+}
+
+void im2col_gemm(const sConv2DParams &p, const float *input,
+                 const float *weight, const float *bias, float *output,
+                 float *columns, const sActivation &activation) {
+  const auto &simd = simd_kernels();
+  const int64_t in_per_group = p.in_channels / p.group;
+  const int64_t out_per_group = p.out_channels / p.group;
+  const int64_t in_plane = p.in_height * p.in_width;
+  const int64_t out_plane = p.out_height * p.out_width;
+  const int64_t taps = p.kernel_height * p.kernel_width;
+  const int64_t depth = in_per_group * taps;
+
+  for (int64_t n = 0; n < p.batch; ++n) {
+    for (int64_t g = 0; g < p.group; ++g) {
+      const float *in =
+          input + (n * p.in_channels + g * in_per_group) * in_plane;
+      // row (ic, ky, kx) holds that tap for every output position
+      float *row = columns;
+      for (int64_t ic = 0; ic < in_per_group; ++ic) {
+        const float *plane = in + ic * in_plane;
+        for (int64_t ky = 0; ky < p.kernel_height; ++ky) {
+          for (int64_t kx = 0; kx < p.kernel_width; ++kx) {
+            for (int64_t oy = 0; oy < p.out_height; ++oy) {
+              const int64_t iy =
+                  oy * p.stride_height - p.pad_top + ky * p.dilation_height;
+              float *dst = row + oy * p.out_width;
+              if (iy < 0 || iy >= p.in_height) {
+                std::fill(dst, dst + p.out_width, 0.f);
+                continue;
+              }
+              const float *src = plane + iy * p.in_width;
+              for (int64_t ox = 0; ox < p.out_width; ++ox) {
+                const int64_t ix =
+                    ox * p.stride_width - p.pad_left + kx * p.dilation_width;
+                dst[ox] = ix >= 0 && ix < p.in_width ? src[ix] : 0.f;
+              }
+            }
+            row += out_plane;
+          }
+        }
+      }
+      float *out =
+          output + (n * p.out_channels + g * out_per_group) * out_plane;
+      simd.sgemm(out_per_group, out_plane, depth,
+                 weight + g * out_per_group * depth, depth, columns, out_plane,
+                 out, out_plane, bias ? bias + g * out_per_group : nullptr,
+                 false);
+      apply_activation(activation, out, out,
+                       static_cast<size_t>(out_per_group * out_plane));
+    }
+  }
+}
+
+// U = G g G^T for every (out, in) channel pair, stored as 16 matrices of
+// out_channels x in_channels
+std::vector<float> winograd_weights(const sConv2DParams &p,
+                                    const float *weight) {
+  const int64_t pairs = p.out_channels * p.in_channels;
+  std::vector<float> packed(static_cast<size_t>(16 * pairs));
+  for (int64_t pair = 0; pair < pairs; ++pair) {
+    const float *g = weight + pair * 9;
+    float t[4][3];
+    for (int c = 0; c < 3; ++c) {
+      t[0][c] = g[c];
+      t[1][c] = 0.5f * (g[c] + g[3 + c] + g[6 + c]);
+      t[2][c] = 0.5f * (g[c] - g[3 + c] + g[6 + c]);
+      t[3][c] = g[6 + c];
+    }
+    for (int r = 0; r < 4; ++r) {
+      const float u[4] = {t[r][0], 0.5f * (t[r][0] + t[r][1] + t[r][2]),
+                          0.5f * (t[r][0] - t[r][1] + t[r][2]), t[r][2]};
+      for (int c = 0; c < 4; ++c) {
+        packed[(r * 4 + c) * pairs + pair] = u[c];
+      }
+    }
+  }
+  return packed;
+}
+
+void winograd_3x3(const sConv2DParams &p, const float *input,
+                  const float *packed, const float *bias, float *output,
+                  float *workspace, const sActivation &activation) {
+  const auto &simd = simd_kernels();
+  const int64_t tiles_x = (p.out_width + 1) / 2;
+  const int64_t tiles = winograd_tiles(p);
+  const int64_t in_plane = p.in_height * p.in_width;
+  const int64_t out_plane = p.out_height * p.out_width;
+  // V: 16 x in_channels x tiles, M: 16 x out_channels x tiles
+  float *v = workspace;
+  float *m = workspace + 16 * p.in_channels * tiles;
+  const int64_t v_stride = p.in_channels * tiles;
+  const int64_t m_stride = p.out_channels * tiles;
+
+  for (int64_t n = 0; n < p.batch; ++n) {
+    // input tiles: V = B^T d B over overlapping 4x4 patches
+    for (int64_t ic = 0; ic < p.in_channels; ++ic) {
+      const float *plane = input + (n * p.in_channels + ic) * in_plane;
+      for (int64_t tile = 0; tile < tiles; ++tile) {
+        const int64_t iy0 = (tile / tiles_x) * 2 - p.pad_top;
+        const int64_t ix0 = (tile % tiles_x) * 2 - p.pad_left;
+        float d[4][4];
+        for (int r = 0; r < 4; ++r) {
+          const int64_t iy = iy0 + r;
+          for (int c = 0; c < 4; ++c) {
+            const int64_t ix = ix0 + c;
+            d[r][c] = iy >= 0 && iy < p.in_height && ix >= 0 &&
+                              ix < p.in_width
+                          ? plane[iy * p.in_width + ix]
+                          : 0.f;
+          }
+        }
+        float t[4][4];
+        for (int c = 0; c < 4; ++c) {
+          t[0][c] = d[0][c] - d[2][c];
+          t[1][c] = d[1][c] + d[2][c];
+          t[2][c] = d[2][c] - d[1][c];
+          t[3][c] = d[1][c] - d[3][c];
+        }
+        float *dst = v + ic * tiles + tile;
+        for (int r = 0; r < 4; ++r) {
+          dst[(r * 4 + 0) * v_stride] = t[r][0] - t[r][2];
+          dst[(r * 4 + 1) * v_stride] = t[r][1] + t[r][2];
+          dst[(r * 4 + 2) * v_stride] = t[r][2] - t[r][1];
+          dst[(r * 4 + 3) * v_stride] = t[r][1] - t[r][3];
+        }
+      }
+    }
+
+    for (int xi = 0; xi < 16; ++xi) {
+      simd.sgemm(p.out_channels, tiles, p.in_channels,
+                 packed + xi * p.out_channels * p.in_channels, p.in_channels,
+                 v + xi * v_stride, tiles, m + xi * m_stride, tiles, nullptr,
+                 false);
+    }
+
+    // output tiles: Y = A^T M A, clipped at the bottom and right edges
+    for (int64_t oc = 0; oc < p.out_channels; ++oc) {
+      float *out = output + (n * p.out_channels + oc) * out_plane;
+      const float b = bias ? bias[oc] : 0.f;
+      for (int64_t tile = 0; tile < tiles; ++tile) {
+        const float *src = m + oc * tiles + tile;
+        float s[2][4];
+        for (int c = 0; c < 4; ++c) {
+          const float m0 = src[(0 * 4 + c) * m_stride];
+          const float m1 = src[(1 * 4 + c) * m_stride];
+          const float m2 = src[(2 * 4 + c) * m_stride];
+          const float m3 = src[(3 * 4 + c) * m_stride];
+          s[0][c] = m0 + m1 + m2;
+          s[1][c] = m1 - m2 - m3;
+        }
+        const int64_t oy0 = (tile / tiles_x) * 2;
+        const int64_t ox0 = (tile % tiles_x) * 2;
+        for (int r = 0; r < 2 && oy0 + r < p.out_height; ++r) {
+          const float y[2] = {s[r][0] + s[r][1] + s[r][2],
+                              s[r][1] - s[r][2] - s[r][3]};
+          for (int c = 0; c < 2 && ox0 + c < p.out_width; ++c) {
+            out[(oy0 + r) * p.out_width + ox0 + c] = y[c] + b;
+          }
+        }
+      }
+      apply_activation(activation, out, out, static_cast<size_t>(out_plane));
+    }
+  }
+}
+
+void conv2d_nhwc_row(const sConv2DParams &p, const float *input,
+                     const float *weight, const float *bias, float *output,
+                     int64_t row, const sActivation &activation) {
+  const auto &simd = simd_kernels();
+  const int64_t oy = row % p.out_height;
+  const int64_t n = row / p.out_height;
+  const int64_t in_pixel = p.in_channels;
+  float *out =
+      output + (n * p.out_height + oy) * p.out_width * p.out_channels;
+  for (int64_t ox = 0; ox < p.out_width; ++ox) {
+    for (int64_t oc = 0; oc < p.out_channels; ++oc) {
+      out[ox * p.out_channels + oc] = bias ? bias[oc] : 0.f;
+    }
+  }
+  // every tap is a GEMM of the output columns whose input pixel lies
+  // inside the row, pixels strided by stride_width
+  for (int64_t ky = 0; ky < p.kernel_height; ++ky) {
+    const int64_t iy =
+        oy * p.stride_height - p.pad_top + ky * p.dilation_height;
+    if (iy < 0 || iy >= p.in_height) {
+      continue;
+    }
+    const float *in_row =
+        input + (n * p.in_height + iy) * p.in_width * in_pixel;
+    for (int64_t kx = 0; kx < p.kernel_width; ++kx) {
+      const int64_t offset = kx * p.dilation_width - p.pad_left;
+      const int64_t first =
+          offset >= 0 ? 0 : (-offset + p.stride_width - 1) / p.stride_width;
+      const int64_t end =
+          p.in_width - offset <= 0
+              ? 0
+              : std::min(p.out_width,
+                         (p.in_width - 1 - offset) / p.stride_width + 1);
+      if (first >= end) {
+        continue;
+      }
+      const int64_t tap = ky * p.kernel_width + kx;
+      simd.sgemm(end - first, p.out_channels, p.in_channels,
+                 in_row + (first * p.stride_width + offset) * in_pixel,
+                 p.stride_width * in_pixel,
+                 weight + tap * p.in_channels * p.out_channels,
+                 p.out_channels, out + first * p.out_channels, p.out_channels,
+                 nullptr, true);
+    }
+  }
+  apply_activation(activation, out, out,
+                   static_cast<size_t>(p.out_width * p.out_channels));
+}
+
+} // namespace
+
+const char *conv_algorithm_name(eConvAlgorithm algorithm) {
+  switch (algorithm) {
+  case CONV_DEPTHWISE:
+    return "depthwise";
+  case CONV_POINTWISE:
+    return "pointwise";
+  case CONV_WINOGRAD_3X3:
+    return "winograd 3x3";
+  case CONV_IM2COL_GEMM:
+    return "im2col gemm";
+  case CONV_REFERENCE:
+  default:
+    return "reference";
+  }
+}
+
+eConvAlgorithm select_conv_algorithm(const sConv2DParams &p) {
+  if (p.group > 1 && p.group == p.in_channels && p.group == p.out_channels) {
+    return CONV_DEPTHWISE;
+  }
+  const bool unit_stride = p.stride_height == 1 && p.stride_width == 1;
+  if (p.group == 1 && p.kernel_height == 1 && p.kernel_width == 1 &&
+      unit_stride && p.pad_top == 0 && p.pad_left == 0 &&
+      p.out_height == p.in_height && p.out_width == p.in_width) {
+    return CONV_POINTWISE;
+  }
+  if (p.group == 1 && p.kernel_height == 3 && p.kernel_width == 3 &&
+      unit_stride && p.dilation_height == 1 && p.dilation_width == 1 &&
+      p.in_channels >= kWinogradMinChannels &&
+      p.out_channels >= kWinogradMinChannels) {
+    return CONV_WINOGRAD_3X3;
+  }
+  return CONV_IM2COL_GEMM;
+}
+
+int64_t conv2d_workspace_size(const sConv2DParams &p,
+                              eConvAlgorithm algorithm) {
+  switch (algorithm) {
+  case CONV_WINOGRAD_3X3:
+    return 16 * (p.in_channels + p.out_channels) * winograd_tiles(p);
+  case CONV_IM2COL_GEMM:
+    return (p.in_channels / p.group) * p.kernel_height * p.kernel_width *
+           p.out_height * p.out_width;
+  default:
+    return 0;
+  }
+}
+
+std::vector<float> pack_conv2d_weights(const sConv2DParams &p,
+                                       eConvAlgorithm algorithm,
+                                       const float *weight) {
+  if (algorithm == CONV_WINOGRAD_3X3) {
+    return winograd_weights(p, weight);
+  }
+  return {};
+}
+
+void conv2d(const sConv2DParams &p, eConvAlgorithm algorithm,
+            const float *input, const float *weight, const float *bias,
+            float *output, float *workspace, const sActivation &activation) {
+  const auto count =
+      static_cast<size_t>(p.batch * p.out_channels * p.out_height *
+                          p.out_width);
+  switch (algorithm) {
+  case CONV_DEPTHWISE:
+    simd_kernels().depthwise_conv2d(p, input, weight, bias, output);
+    apply_activation(activation, output, output, count);
+    break;
+  case CONV_POINTWISE:
+    pointwise(p, input, weight, bias, output, activation);
+    break;
+  case CONV_WINOGRAD_3X3:
+    winograd_3x3(p, input, weight, bias, output, workspace, activation);
+    break;
+  case CONV_IM2COL_GEMM:
+    im2col_gemm(p, input, weight, bias, output, workspace, activation);
+    break;
+  case CONV_REFERENCE:
+  default:
+    conv2d_reference(p, input, weight, bias, output);
+    apply_activation(activation, output, output, count);
+    break;
+  }
+}
+
+bool conv2d_supports_layout(const sConv2DParams &p, eTensorLayout layout) {
+  switch (layout) {
+  case LAYOUT_NHWC:
+    return p.group == 1;
+  case LAYOUT_NCHWC8:
+  case LAYOUT_NCHWC16:
+    return p.group == 1 ||
+           (p.group == p.in_channels && p.group == p.out_channels);
+  case LAYOUT_NCHW:
+  default:
+    return false;
+  }
+}
+
+const char *conv2d_layout_kernel_name(eTensorLayout layout) {
+  switch (layout) {
+  case LAYOUT_NHWC:
+    return "nhwc gemm";
+  case LAYOUT_NCHWC8:
+    return "direct nchwc8";
+  case LAYOUT_NCHWC16:
+    return "direct nchwc16";
+  case LAYOUT_NCHW:
+  default:
+    return "";
+  }
+}
+
+std::vector<float> pack_conv2d_layout_weights(const sConv2DParams &p,
+                                              eTensorLayout layout,
+                                              const float *weight) {
+  const int64_t taps = p.kernel_height * p.kernel_width;
+  if (layout == LAYOUT_NHWC) {
+    std::vector<float> packed(
+        static_cast<size_t>(taps * p.in_channels * p.out_channels));
+    for (int64_t oc = 0; oc < p.out_channels; ++oc) {
+      for (int64_t ic = 0; ic < p.in_channels; ++ic) {
+        for (int64_t tap = 0; tap < taps; ++tap) {
+          packed[(tap * p.in_channels + ic) * p.out_channels + oc] =
+              weight[(oc * p.in_channels + ic) * taps + tap];
+        }
+      }
+    }
+    return packed;
+  }
+
+  const int64_t block = layout_block(layout);
+  const int64_t out_blocks = (p.out_channels + block - 1) / block;
+  if (p.group > 1) {
+    // depthwise: (block, ky, kx, channel in block)
+    std::vector<float> packed(
+        static_cast<size_t>(out_blocks * taps * block), 0.f);
+    for (int64_t c = 0; c < p.out_channels; ++c) {
+      for (int64_t tap = 0; tap < taps; ++tap) {
+        packed[((c / block) * taps + tap) * block + c % block] =
+            weight[c * taps + tap];
+      }
+    }
+    return packed;
+  }
+  // (out block, in block, ky, kx, in channel in block, out channel in
+  // block), zero for the channel padding
+  const int64_t in_blocks = (p.in_channels + block - 1) / block;
+  std::vector<float> packed(
+      static_cast<size_t>(out_blocks * in_blocks * taps * block * block),
+      0.f);
+  for (int64_t oc = 0; oc < p.out_channels; ++oc) {
+    for (int64_t ic = 0; ic < p.in_channels; ++ic) {
+      for (int64_t tap = 0; tap < taps; ++tap) {
+        const int64_t tile =
+            ((oc / block) * in_blocks + ic / block) * taps + tap;
+        packed[(tile * block + ic % block) * block + oc % block] =
+            weight[(oc * p.in_channels + ic) * taps + tap];
+      }
+    }
+  }
+  return packed;
+}
+
+void conv2d_layout(const sConv2DParams &p, eTensorLayout layout,
+                   const float *input, const float *weight, const float *bias,
+                   float *output, ThreadPool *pool,
+                   const sActivation &activation) {
+  std::function<void(int64_t)> row;
+  int64_t rows = p.batch * p.out_height;
+  if (layout == LAYOUT_NHWC) {
+    row = [&](int64_t r) {
+      conv2d_nhwc_row(p, input, weight, bias, output, r, activation);
+    };
+  } else {
+    const int64_t block = layout_block(layout);
+    auto pick = [&](const sSimdKernels &simd) {
+      return block == 8 ? simd.conv2d_nchwc8 : simd.conv2d_nchwc16;
+    };
+    auto kernel = pick(simd_kernels());
+    if (!kernel) {
+      // NCHWc8 is half an AVX-512 vector, every AVX-512 CPU has AVX2
+      const auto *avx2 = simd_kernels_avx2();
+      kernel = pick(avx2 ? *avx2 : *simd_kernels_scalar());
+    }
+    rows *= (p.out_channels + block - 1) / block;
+    const int64_t row_size = p.out_width * block;
+    row = [&, kernel, row_size](int64_t r) {
+      kernel(p, input, weight, bias, output, r);
+      float *out = output + r * row_size;
+      apply_activation(activation, out, out, static_cast<size_t>(row_size));
+    };
+  }
+  if (pool) {
+    pool->parallel_for(rows, row);
+    return;
+  }
+  for (int64_t r = 0; r < rows; ++r) {
+    row(r);
+  }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "kernels.h"
+#include "layout.h"
+#include "thread_pool.h"
+
+// Optimized 2D convolution. The algorithm is chosen once per node at plan
+// time; the inner loops come from the SIMD table of the running CPU.
+
+enum eConvAlgorithm {
+  CONV_REFERENCE = 0,
+  // one filter per channel, vectorized along output rows
+  CONV_DEPTHWISE,
+  // 1x1, stride 1, no padding: a plain GEMM over the input planes
+  CONV_POINTWISE,
+  // Winograd F(2x2, 3x3): 16 GEMMs over transformed tiles
+  CONV_WINOGRAD_3X3,
+  // patches unfolded into a matrix, then a GEMM per group
+  CONV_IM2COL_GEMM,
+};
+
+const char *conv_algorithm_name(eConvAlgorithm algorithm);
+
+eConvAlgorithm select_conv_algorithm(const sConv2DParams &params);
+
+// floats of scratch memory conv2d needs
+int64_t conv2d_workspace_size(const sConv2DParams &params,
+                              eConvAlgorithm algorithm);
+
+// weights rearranged for the algorithm; empty if it reads the ONNX layout
+std::vector<float> pack_conv2d_weights(const sConv2DParams &params,
+                                       eConvAlgorithm algorithm,
+                                       const float *weight);
+
+// weight is the packed weight for algorithms that pack, otherwise as
+// conv2d_reference takes it. the activation is applied to each slice of
+// the output as soon as it is complete.
+void conv2d(const sConv2DParams &params, eConvAlgorithm algorithm,
+            const float *input, const float *weight, const float *bias,
+            float *output, float *workspace,
+            const sActivation &activation = {});
+
+// Convolutions with input and output in NHWC or a blocked layout, chosen
+// by the executor's layout plan instead of an algorithm. NHWC takes
+// group 1, the blocked layouts group 1 and depthwise.
+bool conv2d_supports_layout(const sConv2DParams &params,
+                            eTensorLayout layout);
+
+const char *conv2d_layout_kernel_name(eTensorLayout layout);
+
+// weights for conv2d_layout: (ky, kx, in, out) for NHWC, B x B tiles per
+// block pair for the blocked layouts. the bias is read as it is.
+std::vector<float> pack_conv2d_layout_weights(const sConv2DParams &params,
+                                              eTensorLayout layout,
+                                              const float *weight);
+
+// output rows are split over pool, which may be null
+void conv2d_layout(const sConv2DParams &params, eTensorLayout layout,
+                   const float *input, const float *weight, const float *bias,
+                   float *output, ThreadPool *pool,
+                   const sActivation &activation = {});
@@ -0,0 +1,1084 @@
+#include "executor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+#include "../model/graph_utils.h"
+#include "../model/shape_inference.h"
+#include "../model/tensor_utils.h"
+#include "../model/weights.h"
+
+namespace {
+
+// inputs the kernel reads as data. shape operands (Reshape's target,
+// Unsqueeze axes, ..) are folded at plan time and their producers skipped.
+std::vector<int> data_inputs(const sModelGraphNode &node) {
+  const auto &op = node.op_type;
+  if (op == "Reshape" || op == "Flatten" || op == "Squeeze" ||
+      op == "Unsqueeze" || op == "Identity" || op == "Dropout" ||
+      op == "Clip" || op == "Relu") {
+    return {node.input_tensors.empty() ? -1 : node.input_tensors[0]};
+  }
+  return node.input_tensors;
+}
+
+bool all_static(const std::vector<int64_t> &shape) {
+  return std::all_of(shape.begin(), shape.end(),
+                     [](int64_t dim) { return dim >= 0; });
+}
+
+eBinaryOp binary_op(const std::string &op) {
+  return op == "Add"   ? BINARY_ADD
+         : op == "Sub" ? BINARY_SUB
+         : op == "Mul" ? BINARY_MUL
+                       : BINARY_DIV;
+}
+
+// the initializer operand of a bias Add
+int constant_operand(const sModelGraph &graph, const sModelGraphNode &node) {
+  for (int t : node.input_tensors) {
+    if (t >= 0 && graph.tensors[t].is_initializer) {
+      return t;
+    }
+  }
+  return -1;
+}
+
+} // namespace
+
+bool Executor::fail(const std::string &message) {
+  _error = message;
+  _steps.clear();
+  return false;
+}
+
+int64_t Executor::element_count(int tensor_index) const {
+  return tensor_element_count(_graph.tensors[tensor_index]);
+}
+
+bool Executor::prepare(const std::string &model_path,
+                       const sModelGraph &graph,
+                       const sExecutorConfig &config) {
+  _graph = graph;
+  _config = config;
+  _error.clear();
+  _steps.clear();
+  _inputs.clear();
+  _outputs = _graph.output_tensors;
+
+  pin_input_shapes(_graph, config.batch_size);
+  _fusion = config.fuse ? plan_fusion(_graph, config.batch_size)
+                        : sFusionPlan{};
+  for (int t : _graph.input_tensors) {
+    if (!_graph.tensors[t].is_initializer) {
+      _inputs.push_back(t);
+    }
+  }
+
+  std::unordered_map<std::string, std::vector<float>> weights;
+  if (!load_float_weights(model_path, weights, _error)) {
+    return fail(_error);
+  }
+  _owned.assign(_graph.tensors.size(), {});
+  _weight_bytes = 0;
+  for (size_t t = 0; t < _graph.tensors.size(); ++t) {
+    auto it = weights.find(_graph.tensors[t].name);
+    if (it != weights.end()) {
+      _weight_bytes += static_cast<int64_t>(it->second.size() * sizeof(float));
+      _owned[t] = std::move(it->second);
+    }
+  }
+
+  // nodes feeding the graph outputs through data inputs
+  const auto producers = tensor_producers(_graph);
+  std::vector<bool> needed(_graph.nodes.size(), false);
+  std::vector<int> pending(_outputs.begin(), _outputs.end());
+  std::vector<bool> visited(_graph.tensors.size(), false);
+  while (!pending.empty()) {
+    const int t = pending.back();
+    pending.pop_back();
+    if (t < 0 || visited[t]) {
+      continue;
+    }
+    visited[t] = true;
+    const int producer = producers[t];
+    if (producer < 0 || !_owned[t].empty()) {
+      continue;
+    }
+    needed[producer] = true;
+    for (int input : data_inputs(_graph.nodes[producer])) {
+      pending.push_back(input);
+    }
+  }
+
+  for (int node_index : topological_order(_graph)) {
+    if (!needed[node_index]) {
+      continue;
+    }
+    // a fused group runs at its last node, once all its inputs are ready
+    const int group =
+        _fusion.node_group.empty() ? -1 : _fusion.node_group[node_index];
+    if (group >= 0 && _fusion.groups[group].nodes.back() != node_index) {
+      continue;
+    }
+    sExecutionStep step;
+    if (!(group >= 0 ? build_fused_step(group, step)
+                     : build_step(node_index, step))) {
+      return false;
+    }
+    _steps.push_back(std::move(step));
+  }
+  if (_steps.empty()) {
+    return fail("nothing to execute");
+  }
+  rewrite_fused_nodes(needed);
+  plan_layouts();
+  // the reorders are needed too
+  needed.resize(_graph.nodes.size(), true);
+  release_unread_weights();
+  _pool = std::make_unique<ThreadPool>(ThreadPool::shared(), config.threads);
+  pack_weights();
+  return plan_buffers(needed);
+}
+
+void Executor::pack_weights() {
+  _packed.assign(_steps.size(), {});
+  _packed_b.assign(_steps.size(), {});
+  _packed_bytes = 0;
+  int64_t workspace = 0;
+  for (size_t i = 0; i < _steps.size(); ++i) {
+    const auto &step = _steps[i];
+    if (step.kind == KERNEL_GEMM && !_config.reference_kernels &&
+        !_owned[step.inputs[1]].empty()) {
+      const auto &p = step.gemm;
+      const float *b = _owned[step.inputs[1]].data();
+      _packed_b[i].resize(static_cast<size_t>(step.batch_count));
+      for (int64_t batch = 0; batch < step.batch_count; ++batch) {
+        auto &packed = _packed_b[i][batch];
+        pack_gemm_b(b + batch * p.k * p.n, p.trans_b ? p.k : p.n, p.trans_b,
+                    p.k, p.n, _config.gemm_precision, packed);
+        _packed_bytes += packed.bytes();
+      }
+    } else if (step.kind == KERNEL_GEMM) {
+      _packed_b[i].resize(1);
+    }
+    if (step.kind != KERNEL_CONV2D) {
+      continue;
+    }
+    if (step.layout != LAYOUT_NCHW) {
+      _packed[i] = pack_conv2d_layout_weights(step.conv, step.layout,
+                                              _owned[step.inputs[1]].data());
+      _packed_bytes +=
+          static_cast<int64_t>(_packed[i].size() * sizeof(float));
+      continue;
+    }
+    workspace = std::max(
+        workspace, conv2d_workspace_size(step.conv, step.conv_algorithm));
+    const auto &weight = _owned[step.inputs[1]];
+    if (!weight.empty()) {
+      _packed[i] = pack_conv2d_weights(step.conv, step.conv_algorithm,
+                                       weight.data());
+      _packed_bytes +=
+          static_cast<int64_t>(_packed[i].size() * sizeof(float));
+    }
+  }
+  _workspace.assign(static_cast<size_t>(workspace), 0.f);
+}
+
+bool Executor::build_step(int node_index, sExecutionStep &step) {
+  const auto &node = _graph.nodes[node_index];
+  const auto &op = node.op_type;
+  step.node = node_index;
+  step.inputs = data_inputs(node);
+  step.output = node.output_tensors.empty() ? -1 : node.output_tensors[0];
+  if (step.output < 0) {
+    return fail(node.name + " has no output");
+  }
+  const auto &out = _graph.tensors[step.output];
+  if (!all_static(out.shape) || tensor_element_count(out) < 0) {
+    return fail("shape of " + out.name + " is not static");
+  }
+  auto input_shape = [&](size_t i) -> const std::vector<int64_t> & {
+    return _graph.tensors[node.input_tensors[i]].shape;
+  };
+  auto has_input = [&](size_t i) {
+    return i < node.input_tensors.size() && node.input_tensors[i] >= 0;
+  };
+
+  if (op == "Conv") {
+    if (!has_input(1) || input_shape(0).size() != 4 ||
+        input_shape(1).size() != 4 || out.shape.size() != 4) {
+      return fail(node.name + ": only 2D convolutions are supported");
+    }
+    auto &p = step.conv;
+    const auto &in = input_shape(0);
+    const auto &w = input_shape(1);
+    p.batch = in[0];
+    p.in_channels = in[1];
+    p.in_height = in[2];
+    p.in_width = in[3];
+    p.out_channels = out.shape[1];
+    p.out_height = out.shape[2];
+    p.out_width = out.shape[3];
+    p.kernel_height = w[2];
+    p.kernel_width = w[3];
+    p.group = attribute_int(node, "group", 1);
+    auto strides = attribute_ints(node, "strides");
+    auto dilations = attribute_ints(node, "dilations");
+    auto pads = attribute_ints(node, "pads");
+    strides.resize(2, 1);
+    dilations.resize(2, 1);
+    pads.resize(4, 0);
+    p.stride_height = strides[0];
+    p.stride_width = strides[1];
+    p.dilation_height = dilations[0];
+    p.dilation_width = dilations[1];
+    p.pad_top = pads[0];
+    p.pad_left = pads[1];
+    const auto auto_pad = attribute_string(node, "auto_pad", "NOTSET");
+    if (auto_pad == "SAME_UPPER" || auto_pad == "SAME_LOWER") {
+      auto leading_pad = [&](int64_t in_dim, int64_t out_dim, int64_t kernel,
+                             int64_t stride, int64_t dilation) {
+        const int64_t total = std::max<int64_t>(
+            0, (out_dim - 1) * stride + (kernel - 1) * dilation + 1 - in_dim);
+        return auto_pad == "SAME_UPPER" ? total / 2 : total - total / 2;
+      };
+      p.pad_top = leading_pad(p.in_height, p.out_height, p.kernel_height,
+                              p.stride_height, p.dilation_height);
+      p.pad_left = leading_pad(p.in_width, p.out_width, p.kernel_width,
+                               p.stride_width, p.dilation_width);
+    }
+    step.kind = KERNEL_CONV2D;
+    step.conv_algorithm = _config.reference_kernels
+                              ? CONV_REFERENCE
+                              : select_conv_algorithm(p);
+    // Winograd needs its weights transformed up front
+    if (step.conv_algorithm == CONV_WINOGRAD_3X3 &&
+        _owned[node.input_tensors[1]].empty()) {
+      step.conv_algorithm = CONV_IM2COL_GEMM;
+    }
+  } else if (op == "Gemm" || op == "MatMul") {
+    const auto &a = input_shape(0);
+    const auto &b = input_shape(1);
+    if (a.size() < 2 || b.size() < 2 || (op == "Gemm" && a.size() != 2)) {
+      return fail(node.name + ": only matrix operands are supported");
+    }
+    auto &p = step.gemm;
+    p.trans_a = attribute_int(node, "transA", 0) != 0;
+    p.trans_b = attribute_int(node, "transB", 0) != 0;
+    p.alpha = attribute_float(node, "alpha", 1.f);
+    p.beta = attribute_float(node, "beta", 1.f);
+    p.n = out.shape.back();
+    p.k = a[p.trans_a ? 0 : a.size() - 1];
+    if (b.size() == 2) {
+      // a single weight matrix: leading dims of A fold into the rows
+      p.m = tensor_element_count(out) / std::max<int64_t>(p.n, 1);
+    } else if (a.size() == b.size() &&
+               std::equal(a.begin(), a.end() - 2, b.begin())) {
+      p.m = a[a.size() - 2];
+      step.batch_count = tensor_element_count(out) /
+                         std::max<int64_t>(p.m * p.n, 1);
+    } else {
+      return fail(node.name + ": broadcast batched MatMul is not supported");
+    }
+    if (op == "Gemm" && has_input(2)) {
+      const auto &c = input_shape(2);
+      p.c_rows = c.size() == 2 ? c[0] : 1;
+      p.c_cols = c.empty() ? 1 : c.back();
+    } else {
+      step.inputs.resize(2);
+    }
+    step.kind = KERNEL_GEMM;
+  } else if (is_fusable_activation(op)) {
+    step.kind = KERNEL_ACTIVATION;
+    step.count = tensor_element_count(out);
+    step.activation = activation_of(node);
+  } else if (op == "Add" || op == "Sub" || op == "Mul" || op == "Div") {
+    step.kind = KERNEL_BINARY;
+    step.binary = binary_op(op);
+    step.out_shape = out.shape;
+    step.a_strides = broadcast_strides(input_shape(0), out.shape);
+    step.b_strides = broadcast_strides(input_shape(1), out.shape);
+  } else if (op == "BatchNormalization") {
+    // copied: add_constant() grows the tensor list
+    const auto in = input_shape(0);
+    if (in.size() < 2) {
+      return fail(node.name + ": input rank below 2");
+    }
+    std::vector<float> scale;
+    std::vector<float> shift;
+    if (!batch_norm_affine(node, scale, shift)) {
+      return false;
+    }
+    if (static_cast<int64_t>(scale.size()) != in[1]) {
+      return fail(node.name + ": parameters do not match the channels");
+    }
+    step.kind = KERNEL_BATCH_NORM;
+    step.channels = in[1];
+    step.planes = in[0] * in[1];
+    step.spatial =
+        tensor_element_count(out) / std::max<int64_t>(step.planes, 1);
+    step.inputs = {node.input_tensors[0],
+                   add_constant(node.name + "_scale", {in[1]}, scale),
+                   add_constant(node.name + "_shift", {in[1]}, shift)};
+  } else if (op == "GlobalAveragePool") {
+    const auto &in = input_shape(0);
+    if (in.size() < 2) {
+      return fail(node.name + ": input rank below 2");
+    }
+    step.kind = KERNEL_GLOBAL_AVERAGE_POOL;
+    step.channels = in[1];
+    step.planes = in[0] * in[1];
+    step.spatial =
+        tensor_element_count(_graph.tensors[node.input_tensors[0]]) /
+        std::max<int64_t>(step.planes, 1);
+  } else if (op == "Reshape" || op == "Flatten" || op == "Squeeze" ||
+             op == "Unsqueeze" || op == "Identity" || op == "Dropout") {
+    step.kind = KERNEL_COPY;
+    step.count = tensor_element_count(out);
+  } else {
+    return fail("unsupported op " + op + " (" + node.name + ")");
+  }
+
+  for (int t : data_inputs(node)) {
+    if (t < 0) {
+      continue;
+    }
+    const auto &tensor = _graph.tensors[t];
+    if (!all_static(tensor.shape) || tensor_element_count(tensor) < 0) {
+      return fail("shape of " + tensor.name + " is not static");
+    }
+  }
+  return true;
+}
+
+bool Executor::build_fused_step(int group_index, sExecutionStep &step) {
+  const auto &group = _fusion.groups[group_index];
+  if (group.kind == FUSION_ELEMENTWISE_CHAIN) {
+    return build_chain_step(group_index, step);
+  }
+  const auto &anchor = _graph.nodes[group.nodes.front()];
+  if (!build_step(group.nodes.front(), step)) {
+    return false;
+  }
+  step.fusion = group_index;
+  step.output = _graph.nodes[group.nodes.back()].output_tensors[0];
+  if (group.activation >= 0) {
+    step.activation = activation_of(_graph.nodes[group.activation]);
+  }
+  const int bias_operand =
+      group.bias_add >= 0
+          ? constant_operand(_graph, _graph.nodes[group.bias_add])
+          : -1;
+  if (bias_operand >= 0 && _owned[bias_operand].empty()) {
+    return fail(anchor.name + ": bias " + _graph.tensors[bias_operand].name +
+                " is not loaded");
+  }
+
+  if (step.kind == KERNEL_GEMM) {
+    // added by the epilogue of every block
+    if (bias_operand >= 0) {
+      step.inputs.resize(4, -1);
+      step.inputs[3] = bias_operand;
+    }
+    return true;
+  }
+  if (group.batch_norm < 0 && bias_operand < 0) {
+    return true;
+  }
+
+  // BatchNormalization and the bias Add fold into copies of the weights
+  // and bias: w' = w * scale, b' = b * scale + shift + bias
+  const auto channels = static_cast<size_t>(step.conv.out_channels);
+  std::vector<float> bias(channels, 0.f);
+  if (step.inputs.size() > 2 && step.inputs[2] >= 0) {
+    bias = _owned[step.inputs[2]];
+  }
+  if (bias.size() != channels) {
+    return fail(anchor.name + ": bias does not match the channels");
+  }
+  if (group.batch_norm >= 0) {
+    std::vector<float> scale;
+    std::vector<float> shift;
+    if (!batch_norm_affine(_graph.nodes[group.batch_norm], scale, shift)) {
+      return false;
+    }
+    std::vector<float> weight = _owned[step.inputs[1]];
+    if (scale.size() != channels || weight.empty()) {
+      return fail(anchor.name + ": cannot fold " +
+                  _graph.nodes[group.batch_norm].name);
+    }
+    const size_t per_channel = weight.size() / channels;
+    for (size_t c = 0; c < channels; ++c) {
+      for (size_t i = 0; i < per_channel; ++i) {
+        weight[c * per_channel + i] *= scale[c];
+      }
+      bias[c] = bias[c] * scale[c] + shift[c];
+    }
+    auto shape = _graph.tensors[step.inputs[1]].shape;
+    step.inputs[1] = add_constant(anchor.name + "_folded_weight",
+                                  std::move(shape), std::move(weight));
+  }
+  if (bias_operand >= 0) {
+    const auto &values = _owned[bias_operand];
+    if (values.size() != channels) {
+      return fail(anchor.name + ": bias does not match the channels");
+    }
+    for (size_t c = 0; c < channels; ++c) {
+      bias[c] += values[c];
+    }
+  }
+  step.inputs.resize(3);
+  step.inputs[2] =
+      add_constant(anchor.name + "_folded_bias",
+                   {static_cast<int64_t>(channels)}, std::move(bias));
+  return true;
+}
+
+bool Executor::build_chain_step(int group_index, sExecutionStep &step) {
+  const auto &group = _fusion.groups[group_index];
+  const auto &head = _graph.nodes[group.nodes.front()];
+  step.node = group.nodes.front();
+  step.fusion = group_index;
+  step.kind = KERNEL_ELEMENTWISE_CHAIN;
+  step.output = _graph.nodes[group.nodes.back()].output_tensors[0];
+  step.out_shape = _graph.tensors[step.output].shape;
+  if (!all_static(step.out_shape)) {
+    return fail("shape of " + _graph.tensors[step.output].name +
+                " is not static");
+  }
+
+  // the running value enters at full shape, as plan_fusion() chose it
+  int value = -1;
+  for (int t : head.input_tensors) {
+    if (t >= 0 && _graph.tensors[t].shape == step.out_shape) {
+      value = t;
+      break;
+    }
+  }
+  if (value < 0) {
+    return fail(head.name + ": no input spans the fused chain");
+  }
+  step.inputs = {value};
+  for (int index : group.nodes) {
+    const auto &node = _graph.nodes[index];
+    sElementwiseLink link;
+    int operand = -1;
+    if (is_fusable_activation(node.op_type)) {
+      link.activation = activation_of(node);
+    } else {
+      link.binary = true;
+      link.op = binary_op(node.op_type);
+      link.swapped = node.input_tensors[1] == value;
+      operand = node.input_tensors[link.swapped ? 0 : 1];
+      const auto &shape = _graph.tensors[operand].shape;
+      if (!all_static(shape)) {
+        return fail("shape of " + _graph.tensors[operand].name +
+                    " is not static");
+      }
+      link.operand_strides = broadcast_strides(shape, step.out_shape);
+      step.inputs.push_back(operand);
+    }
+    step.links.push_back(std::move(link));
+    step.link_operands.push_back(operand);
+    value = node.output_tensors[0];
+  }
+  return true;
+}
+
+sActivation Executor::activation_of(const sModelGraphNode &node) const {
+  // scalar from a constant operand, e.g. Clip's min and max
+  auto constant_scalar = [&](size_t i, float fallback) {
+    if (i >= node.input_tensors.size() || node.input_tensors[i] < 0 ||
+        _owned[node.input_tensors[i]].empty()) {
+      return fallback;
+    }
+    return _owned[node.input_tensors[i]][0];
+  };
+  constexpr float kInf = std::numeric_limits<float>::infinity();
+
+  sActivation activation;
+  const auto &op = node.op_type;
+  if (op == "Relu") {
+    activation = {ACTIVATION_CLIP, 0.f, kInf};
+  } else if (op == "Clip") {
+    // opset 11 moved min and max from attributes to inputs
+    activation = {ACTIVATION_CLIP,
+                  constant_scalar(1, attribute_float(node, "min", -kInf)),
+                  constant_scalar(2, attribute_float(node, "max", kInf))};
+  } else if (op == "LeakyRelu") {
+    activation = {ACTIVATION_LEAKY_RELU,
+                  attribute_float(node, "alpha", 0.01f), 0.f};
+  } else if (op == "Sigmoid") {
+    activation.kind = ACTIVATION_SIGMOID;
+  } else if (op == "Tanh") {
+    activation.kind = ACTIVATION_TANH;
+  } else if (op == "Gelu") {
+    activation.kind = ACTIVATION_GELU;
+    activation.alpha =
+        attribute_string(node, "approximate", "none") == "tanh" ? 1.f : 0.f;
+  }
+  return activation;
+}
+
+bool Executor::batch_norm_affine(const sModelGraphNode &node,
+                                 std::vector<float> &scale,
+                                 std::vector<float> &shift) {
+  const auto &inputs = node.input_tensors;
+  for (size_t i = 1; i < 5; ++i) {
+    if (i >= inputs.size() || inputs[i] < 0 || _owned[inputs[i]].empty()) {
+      return fail(node.name + ": parameters are not constant");
+    }
+  }
+  const auto &gamma = _owned[inputs[1]];
+  const auto &beta = _owned[inputs[2]];
+  const auto &mean = _owned[inputs[3]];
+  const auto &variance = _owned[inputs[4]];
+  const size_t channels = gamma.size();
+  if (beta.size() != channels || mean.size() != channels ||
+      variance.size() != channels) {
+    return fail(node.name + ": parameters differ in size");
+  }
+  const float epsilon = attribute_float(node, "epsilon", 1e-5f);
+  scale.resize(channels);
+  shift.resize(channels);
+  for (size_t c = 0; c < channels; ++c) {
+    scale[c] = gamma[c] / std::sqrt(variance[c] + epsilon);
+    shift[c] = beta[c] - mean[c] * scale[c];
+  }
+  return true;
+}
+
+int Executor::add_constant(const std::string &name, std::vector<int64_t> shape,
+                           std::vector<float> values) {
+  sModelTensor tensor;
+  tensor.name = name;
+  tensor.shape = std::move(shape);
+  tensor.tensorDataType = MODEL_TENSOR_DATA_TYPE_FLOAT32;
+  tensor.is_initializer = true;
+  _graph.tensors.push_back(std::move(tensor));
+  _owned.push_back(std::move(values));
+  return static_cast<int>(_graph.tensors.size()) - 1;
+}
+
+void Executor::rewrite_fused_nodes(const std::vector<bool> &needed) {
+  // the last node of a group takes over the inputs of the whole group, so
+  // liveness keeps them until the fused step runs, and the intermediates
+  // lose their producer and are never planned
+  for (const auto &group : _fusion.groups) {
+    const int tail = group.nodes.back();
+    if (!needed[tail]) {
+      continue;
+    }
+    std::vector<int> external;
+    for (int index : group.nodes) {
+      for (int t : _graph.nodes[index].input_tensors) {
+        if (t < 0 ||
+            std::find(group.elided_tensors.begin(), group.elided_tensors.end(),
+                      t) != group.elided_tensors.end() ||
+            std::find(external.begin(), external.end(), t) != external.end()) {
+          continue;
+        }
+        external.push_back(t);
+      }
+    }
+    for (int index : group.nodes) {
+      if (index != tail) {
+        _graph.nodes[index].input_tensors.clear();
+        _graph.nodes[index].output_tensors.clear();
+      }
+    }
+    _graph.nodes[tail].input_tensors = std::move(external);
+  }
+}
+
+void Executor::plan_layouts() {
+  _layouts.assign(_graph.tensors.size(), LAYOUT_NCHW);
+  const eTensorLayout target =
+      _config.reference_kernels ? LAYOUT_NCHW : _config.conv_layout;
+  if (target == LAYOUT_NCHW) {
+    return;
+  }
+  const int64_t block = layout_block(target);
+  const int first_added = static_cast<int>(_graph.nodes.size());
+  auto producers = tensor_producers(_graph);
+  std::vector<bool> is_output(_graph.tensors.size(), false);
+  for (int t : _outputs) {
+    is_output[t] = true;
+  }
+  // the graph gets the physical shapes, decisions are on the logical ones
+  std::vector<std::vector<int64_t>> logical;
+  for (const auto &tensor : _graph.tensors) {
+    logical.push_back(tensor.shape);
+  }
+  // (tensor, layout) -> copy of the tensor in that layout
+  std::map<std::pair<int, int>, int> copies;
+  std::vector<sExecutionStep> steps;
+
+  auto graph_node = [&](const sExecutionStep &step) {
+    return step.fusion >= 0 ? _fusion.groups[step.fusion].nodes.back()
+                            : step.node;
+  };
+  auto add_edge = [&](int tensor, int source, int target_node) {
+    sModelGraphEdge edge;
+    edge.name = _graph.tensors[tensor].name;
+    edge.tensor_index = tensor;
+    edge.source_node = source;
+    edge.target_node = target_node;
+    const int index = static_cast<int>(_graph.edges.size());
+    _graph.edges.push_back(std::move(edge));
+    if (source >= 0) {
+      _graph.nodes[source].output_edges.push_back(index);
+    }
+    _graph.nodes[target_node].input_edges.push_back(index);
+  };
+  auto add_tensor = [&](int like, eTensorLayout layout) {
+    sModelTensor tensor;
+    tensor.name = _graph.tensors[like].name + "_" + layout_name(layout);
+    tensor.shape = layout_shape(logical[like], layout);
+    tensor.tensorDataType = MODEL_TENSOR_DATA_TYPE_FLOAT32;
+    tensor.is_initializer = false;
+    _graph.tensors.push_back(std::move(tensor));
+    _owned.emplace_back();
+    _layouts.push_back(layout);
+    logical.push_back(logical[like]);
+    producers.push_back(-1);
+    is_output.push_back(false);
+    return static_cast<int>(_graph.tensors.size()) - 1;
+  };
+  auto add_reorder = [&](int from, int to) {
+    sModelGraphNode node;
+    node.name = _graph.tensors[to].name + "_reorder";
+    node.op_type = "Reorder";
+    node.input_tensors = {from};
+    node.output_tensors = {to};
+    node.attributes["from"] = layout_name(_layouts[from]);
+    node.attributes["to"] = layout_name(_layouts[to]);
+    const int index = static_cast<int>(_graph.nodes.size());
+    _graph.nodes.push_back(std::move(node));
+    producers[to] = index;
+    if (producers[from] >= 0) {
+      add_edge(from, producers[from], index);
+    }
+    const auto &shape = logical[to];
+    sExecutionStep step;
+    step.node = index;
+    step.kind = KERNEL_REORDER;
+    step.inputs = {from};
+    step.output = to;
+    step.source_layout = _layouts[from];
+    step.layout = _layouts[to];
+    step.channels = shape[1];
+    step.planes = shape[0] * shape[1];
+    step.spatial = shape[2] * shape[3];
+    steps.push_back(std::move(step));
+  };
+  // `t` in `layout`, reordered on first use and shared afterwards
+  auto in_layout = [&](int t, eTensorLayout layout) {
+    if (t < 0 || _layouts[t] == layout) {
+      return t;
+    }
+    const auto key = std::make_pair(t, static_cast<int>(layout));
+    auto it = copies.find(key);
+    if (it != copies.end()) {
+      return it->second;
+    }
+    const int copy = add_tensor(t, layout);
+    add_reorder(t, copy);
+    copies[key] = copy;
+    return copy;
+  };
+  // the non-NCHW layout a tensor is already available in
+  auto available = [&](int t) {
+    if (_layouts[t] != LAYOUT_NCHW) {
+      return _layouts[t];
+    }
+    return copies.count({t, static_cast<int>(target)}) ? target
+                                                       : LAYOUT_NCHW;
+  };
+  auto is_4d = [&](int t) { return t >= 0 && logical[t].size() == 4; };
+
+  for (auto &step : _steps) {
+    // data operands, and whether each follows the step's layout. operands
+    // of elementwise steps that do not span the output are scalars.
+    const bool elementwise = step.kind == KERNEL_BINARY ||
+                             step.kind == KERNEL_ELEMENTWISE_CHAIN;
+    std::vector<int> operands;
+    std::vector<bool> full;
+    auto add_operand = [&](int t) {
+      operands.push_back(t);
+      full.push_back(t >= 0 && (!elementwise ||
+                                logical[t] == logical[step.output]));
+    };
+    if (step.kind == KERNEL_ELEMENTWISE_CHAIN) {
+      add_operand(step.inputs[0]);
+      for (int t : step.link_operands) {
+        if (t >= 0) {
+          add_operand(t);
+        }
+      }
+    } else if (step.kind == KERNEL_CONV2D) {
+      add_operand(step.inputs[0]);
+    } else {
+      for (int t : step.inputs) {
+        add_operand(t);
+      }
+    }
+
+    eTensorLayout layout = LAYOUT_NCHW;
+    switch (step.kind) {
+    case KERNEL_CONV2D: {
+      const auto &p = step.conv;
+      // too few channels to fill a block are not worth the padding
+      const bool wide = block <= 1 || (p.in_channels >= block &&
+                                       p.out_channels >= block);
+      if (wide && conv2d_supports_layout(p, target) &&
+          !_owned[step.inputs[1]].empty()) {
+        layout = target;
+      }
+      break;
+    }
+    case KERNEL_ACTIVATION:
+    case KERNEL_BATCH_NORM:
+    case KERNEL_GLOBAL_AVERAGE_POOL:
+      if (is_4d(step.inputs[0])) {
+        layout = available(step.inputs[0]);
+      }
+      break;
+    case KERNEL_BINARY:
+    case KERNEL_ELEMENTWISE_CHAIN: {
+      // elementwise over the physical buffer: every operand spans the
+      // output or is one value. a division could turn the padding of the
+      // blocked layouts into NaN.
+      bool fits = is_4d(step.output);
+      bool divides = step.kind == KERNEL_BINARY && step.binary == BINARY_DIV;
+      for (const auto &link : step.links) {
+        divides = divides || (link.binary && link.op == BINARY_DIV);
+      }
+      for (size_t k = 0; k < operands.size() && fits; ++k) {
+        const int t = operands[k];
+        fits = t >= 0 && (full[k] ? _owned[t].empty()
+                                  : tensor_element_count(
+                                        _graph.tensors[t]) == 1);
+      }
+      if (!fits || (divides && block > 1)) {
+        break;
+      }
+      for (size_t k = 0; k < operands.size(); ++k) {
+        if (full[k] && available(operands[k]) != LAYOUT_NCHW) {
+          layout = available(operands[k]);
+          break;
+        }
+      }
+      break;
+    }
+    default:
+      break;
+    }
+
+    // operands into the step's layout. scalars and weights stay as they are
+    const int node = graph_node(step);
+    for (size_t k = 0; k < operands.size(); ++k) {
+      const int from = operands[k];
+      if (from < 0 || !_owned[from].empty() ||
+          (layout != LAYOUT_NCHW && !full[k])) {
+        continue;
+      }
+      const int to = in_layout(from, layout);
+      if (to == from) {
+        continue;
+      }
+      std::replace(step.inputs.begin(), step.inputs.end(), from, to);
+      std::replace(step.link_operands.begin(), step.link_operands.end(),
+                   from, to);
+      auto &reads = _graph.nodes[node].input_tensors;
+      std::replace(reads.begin(), reads.end(), from, to);
+    }
+    for (int t : step.inputs) {
+      if (t >= 0 && producers[t] >= first_added) {
+        add_edge(t, producers[t], node);
+      }
+    }
+
+    step.layout = layout;
+    if (layout != LAYOUT_NCHW) {
+      const auto physical = layout_shape(logical[step.output], layout);
+      int64_t count = 1;
+      for (int64_t dim : physical) {
+        count *= dim;
+      }
+      switch (step.kind) {
+      case KERNEL_ACTIVATION:
+        step.count = count;
+        break;
+      case KERNEL_BINARY:
+        step.out_shape = {count};
+        step.a_strides = {full[0] ? 1 : 0};
+        step.b_strides = {full[1] ? 1 : 0};
+        break;
+      case KERNEL_ELEMENTWISE_CHAIN:
+        step.out_shape = {count};
+        for (size_t l = 0; l < step.links.size(); ++l) {
+          const int t = step.link_operands[l];
+          if (t >= 0) {
+            step.links[l].operand_strides = {
+                logical[t] == logical[step.output] ? 1 : 0};
+          }
+        }
+        break;
+      default:
+        break;
+      }
+    }
+    const eTensorLayout out_layout =
+        step.kind == KERNEL_GLOBAL_AVERAGE_POOL ? LAYOUT_NCHW : layout;
+    const int output = step.output;
+    if (out_layout == LAYOUT_NCHW) {
+      steps.push_back(std::move(step));
+      continue;
+    }
+    if (!is_output[output]) {
+      _layouts[output] = out_layout;
+      _graph.tensors[output].shape = layout_shape(logical[output], out_layout);
+      steps.push_back(std::move(step));
+      continue;
+    }
+    // graph outputs stay NCHW: the step writes a copy in its layout and a
+    // reorder the output itself
+    const int internal = add_tensor(output, out_layout);
+    auto &writes = _graph.nodes[node].output_tensors;
+    std::replace(writes.begin(), writes.end(), output, internal);
+    producers[internal] = node;
+    producers[output] = -1;
+    step.output = internal;
+    steps.push_back(std::move(step));
+    copies[{output, static_cast<int>(out_layout)}] = internal;
+    add_reorder(internal, output);
+  }
+  _steps = std::move(steps);
+
+  // run in the order liveness assumes, with the reorders in place
+  const auto order = topological_order(_graph);
+  std::vector<int> position(_graph.nodes.size(), 0);
+  for (size_t i = 0; i < order.size(); ++i) {
+    position[order[i]] = static_cast<int>(i);
+  }
+  std::stable_sort(_steps.begin(), _steps.end(),
+                   [&](const sExecutionStep &a, const sExecutionStep &b) {
+                     return position[graph_node(a)] < position[graph_node(b)];
+                   });
+}
+
+void Executor::release_unread_weights() {
+  // e.g. weights replaced by their folded copies
+  std::vector<bool> read(_owned.size(), false);
+  for (const auto &step : _steps) {
+    for (int t : step.inputs) {
+      if (t >= 0) {
+        read[t] = true;
+      }
+    }
+  }
+  for (int t : _outputs) {
+    read[t] = true;
+  }
+  _weight_bytes = 0;
+  for (size_t t = 0; t < _owned.size(); ++t) {
+    if (!read[t]) {
+      std::vector<float>().swap(_owned[t]);
+    }
+    _weight_bytes += static_cast<int64_t>(_owned[t].size() * sizeof(float));
+  }
+}
+
+bool Executor::plan_buffers(const std::vector<bool> &needed) {
+  const auto liveness = analyze_liveness(_graph, _config.batch_size);
+  const auto plan =
+      plan_memory(liveness, _config.memory_plan, _config.alignment);
+
+  // over-allocate so the arena base can be aligned
+  const int64_t alignment = std::max<int64_t>(_config.alignment, 1);
+  _arena_size = plan.arena_size;
+  _arena_storage.assign(static_cast<size_t>(_arena_size + alignment), 0);
+  auto *base = _arena_storage.data();
+  const auto address = reinterpret_cast<uintptr_t>(base);
+  base += (alignment - address % alignment) % alignment;
+
+  _data.assign(_graph.tensors.size(), nullptr);
+  for (const auto &assignment : plan.assignments) {
+    _data[assignment.tensor] =
+        reinterpret_cast<float *>(base + assignment.offset);
+  }
+  for (size_t t = 0; t < _owned.size(); ++t) {
+    if (!_owned[t].empty()) {
+      _data[t] = _owned[t].data();
+    }
+  }
+  for (int t : _inputs) {
+    const int64_t count = element_count(t);
+    if (count < 0 || !all_static(_graph.tensors[t].shape)) {
+      return fail("shape of input " + _graph.tensors[t].name +
+                  " is not static");
+    }
+    _owned[t].assign(static_cast<size_t>(count), 0.f);
+    _data[t] = _owned[t].data();
+  }
+
+  for (const auto &step : _steps) {
+    if (!_data[step.output]) {
+      return fail("no buffer planned for " + _graph.tensors[step.output].name);
+    }
+    for (int t : step.inputs) {
+      if (t >= 0 && !_data[t] && needed[step.node]) {
+        return fail("no data for " + _graph.tensors[t].name);
+      }
+    }
+  }
+  for (auto &step : _steps) {
+    for (size_t l = 0; l < step.links.size(); ++l) {
+      if (step.link_operands[l] >= 0) {
+        step.links[l].operand = _data[step.link_operands[l]];
+      }
+    }
+  }
+  _step_ms.assign(_steps.size(), 0.0);
+  return true;
+}
+
+void Executor::run_gemm(size_t index, const float *a, const float *b,
+                        const float *c, float *y) {
+  const auto &step = _steps[index];
+  const auto &p = step.gemm;
+  const int64_t a_size = p.m * p.k;
+  const int64_t b_size = p.k * p.n;
+  const int64_t y_size = p.m * p.n;
+  sGemmEpilogue epilogue;
+  epilogue.bias = step.inputs.size() > 3 && step.inputs[3] >= 0
+                      ? _data[step.inputs[3]]
+                      : nullptr;
+  epilogue.activation = step.activation;
+  const bool has_epilogue =
+      epilogue.bias || epilogue.activation.kind != ACTIVATION_NONE;
+  if (_config.reference_kernels) {
+    for (int64_t batch = 0; batch < step.batch_count; ++batch) {
+      gemm_reference(p, a + batch * a_size, b + batch * b_size, c,
+                     y + batch * y_size);
+    }
+    for (int64_t row = 0; has_epilogue && row < step.batch_count * p.m;
+         ++row) {
+      float *values = y + row * p.n;
+      for (int64_t j = 0; epilogue.bias && j < p.n; ++j) {
+        values[j] += epilogue.bias[j];
+      }
+      apply_activation(epilogue.activation, values, values,
+                       static_cast<size_t>(p.n));
+    }
+    return;
+  }
+  bool accumulate = false;
+  if (c) {
+    // beta C broadcast into Y first, the product is added on top
+    for (int64_t i = 0; i < p.m; ++i) {
+      for (int64_t j = 0; j < p.n; ++j) {
+        y[i * p.n + j] = p.beta * c[(p.c_rows == 1 ? 0 : i) * p.c_cols +
+                                    (p.c_cols == 1 ? 0 : j)];
+      }
+    }
+    accumulate = true;
+  }
+  auto &packs = _packed_b[index];
+  const bool prepacked = !_owned[step.inputs[1]].empty();
+  for (int64_t batch = 0; batch < step.batch_count; ++batch) {
+    auto &packed = packs[prepacked ? batch : 0];
+    if (!prepacked) {
+      pack_gemm_b(b + batch * b_size, p.trans_b ? p.k : p.n, p.trans_b, p.k,
+                  p.n, _config.gemm_precision, packed);
+    }
+    gemm_packed(p.m, a + batch * a_size, p.trans_a ? p.m : p.k, p.trans_a,
+                p.alpha, packed, y + batch * y_size, p.n, accumulate,
+                _pool.get(), has_epilogue ? &epilogue : nullptr);
+  }
+}
+
+bool Executor::run() {
+  if (!ready()) {
+    return false;
+  }
+  using clock = std::chrono::steady_clock;
+  for (size_t i = 0; i < _steps.size(); ++i) {
+    const auto &step = _steps[i];
+    const auto started = _config.profile ? clock::now() : clock::time_point{};
+    auto in = [&](size_t k) -> const float * {
+      return k < step.inputs.size() && step.inputs[k] >= 0
+                 ? _data[step.inputs[k]]
+                 : nullptr;
+    };
+    float *out = _data[step.output];
+    switch (step.kind) {
+    case KERNEL_CONV2D:
+      if (step.layout != LAYOUT_NCHW) {
+        conv2d_layout(step.conv, step.layout, in(0), _packed[i].data(),
+                      in(2), out, _pool.get(), step.activation);
+        break;
+      }
+      conv2d(step.conv, step.conv_algorithm, in(0),
+             _packed[i].empty() ? in(1) : _packed[i].data(), in(2), out,
+             _workspace.data(), step.activation);
+      break;
+    case KERNEL_GEMM:
+      run_gemm(i, in(0), in(1), in(2), out);
+      break;
+    case KERNEL_ACTIVATION:
+      apply_activation(step.activation, in(0), out,
+                       static_cast<size_t>(step.count));
+      break;
+    case KERNEL_BINARY:
+      binary_broadcast(step.binary, in(0), step.a_strides, in(1),
+                       step.b_strides, out, step.out_shape);
+      break;
+    case KERNEL_BATCH_NORM:
+      if (step.layout != LAYOUT_NCHW) {
+        channel_affine_layout(in(0), step.layout, in(1), in(2), out,
+                              step.planes / step.channels, step.channels,
+                              step.spatial);
+        break;
+      }
+      channel_affine(in(0), in(1), in(2), out, step.planes / step.channels,
+                     step.channels, step.spatial);
+      break;
+    case KERNEL_ELEMENTWISE_CHAIN:
+      elementwise_chain(in(0), step.links, out, step.out_shape);
+      break;
+    case KERNEL_GLOBAL_AVERAGE_POOL:
+      if (step.layout != LAYOUT_NCHW) {
+        global_average_pool_layout(in(0), step.layout, out,
+                                   step.planes / step.channels,
+                                   step.channels, step.spatial);
+        break;
+      }
+      global_average_pool(in(0), out, step.planes, step.spatial);
+      break;
+    case KERNEL_COPY:
+      if (out != in(0)) {
+        std::memcpy(out, in(0), static_cast<size_t>(step.count) * 4);
+      }
+      break;
+    case KERNEL_REORDER:
+      reorder_layout(in(0), step.source_layout, out, step.layout,
+                     step.planes / step.channels, step.channels, step.spatial,
+                     _pool.get());
+      break;
+    }
+    if (_config.profile) {
+      _step_ms[i] = std::chrono::duration<double, std::milli>(clock::now() -
+                                                              started)
+                        .count();
+    }
+  }
+  return true;
+}
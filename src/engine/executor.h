@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../model/fusion.h"
+#include "../model/memory_planner.h"
+#include "../model/types.h"
+#include "conv.h"
+#include "gemm.h"
+#include "kernels.h"
+#include "layout.h"
+#include "thread_pool.h"
+
+struct sExecutorConfig {
+  // value of the leading symbolic dim of every input, other symbolic dims
+  // become 1
+  int batch_size = 1;
+  eMemoryPlanStrategy memory_plan = MEMORY_PLAN_GREEDY_BY_SIZE;
+  int64_t alignment = 64;
+  // time every step of run()
+  bool profile = false;
+  // run every convolution and matrix product on the reference kernels, to
+  // check the optimized ones against them
+  bool reference_kernels = false;
+  // loop participants on the shared pool, 0 for all of them
+  int threads = 0;
+  eGemmPrecision gemm_precision = GEMM_FP32;
+  // run the groups of plan_fusion() as single steps
+  bool fuse = true;
+  // layout of the convolutions; the ops between them follow it where they
+  // can and reorders go in at the boundaries. NCHW turns the plan off.
+  eTensorLayout conv_layout = native_conv_layout();
+};
+
+enum eKernelKind {
+  KERNEL_CONV2D = 0,
+  KERNEL_GEMM,
+  KERNEL_ACTIVATION,
+  KERNEL_BINARY,
+  KERNEL_BATCH_NORM,
+  KERNEL_ELEMENTWISE_CHAIN,
+  KERNEL_GLOBAL_AVERAGE_POOL,
+  // reshapes and other views, copied into the output buffer
+  KERNEL_COPY,
+  // a tensor copied into another layout, inserted by the layout plan
+  KERNEL_REORDER,
+};
+
+// one scheduled node, or fusion group, with operands and parameters
+// resolved at plan time
+struct sExecutionStep {
+  int node = -1;
+  // index into the fusion plan, -1 for a single node
+  int fusion = -1;
+  eKernelKind kind = KERNEL_COPY;
+  // tensor indices, -1 for omitted optional inputs
+  std::vector<int> inputs;
+  int output = -1;
+
+  sConv2DParams conv;
+  eConvAlgorithm conv_algorithm = CONV_REFERENCE;
+  sGemmParams gemm;
+  eBinaryOp binary = BINARY_ADD;
+  std::vector<int64_t> a_strides;
+  std::vector<int64_t> b_strides;
+  std::vector<int64_t> out_shape;
+  // the op itself for activation steps, the epilogue of conv and gemm
+  sActivation activation;
+  // links of an elementwise chain and the tensor each binary link reads
+  std::vector<sElementwiseLink> links;
+  std::vector<int> link_operands;
+  // independent products of a batched MatMul
+  int64_t batch_count = 1;
+  // elements for activation and copy; planes and plane size for pooling
+  // and batch normalization
+  int64_t count = 0;
+  int64_t planes = 0;
+  int64_t spatial = 0;
+  int64_t channels = 0;
+  // layout the step runs in; reorders copy from source_layout
+  eTensorLayout layout = LAYOUT_NCHW;
+  eTensorLayout source_layout = LAYOUT_NCHW;
+};
+
+// Native fp32 CPU executor over sModelGraph, independent of onnxruntime.
+// prepare() resolves static shapes for the configured batch, schedules the
+// nodes that contribute to the graph outputs, fuses them, picks the layout
+// of every step, plans every activation into one arena and loads the
+// weights; run() then executes without allocating.
+class Executor {
+private:
+  // copy of the graph with all shapes static and every fused group
+  // collapsed onto its last node
+  sModelGraph _graph;
+  sExecutorConfig _config;
+  std::string _error;
+  std::vector<sExecutionStep> _steps;
+  std::vector<int> _inputs;
+  std::vector<int> _outputs;
+  sFusionPlan _fusion;
+  // per tensor; reorders and the tensors they write are added to _graph
+  std::vector<eTensorLayout> _layouts;
+
+  // weights, constants and graph inputs, indexed by tensor
+  std::vector<std::vector<float>> _owned;
+  std::vector<uint8_t> _arena_storage;
+  int64_t _arena_size = 0;
+  int64_t _weight_bytes = 0;
+  // data of every scheduled tensor, into _owned or the arena
+  std::vector<float *> _data;
+  // per step weights in the layout of its kernel, empty if unpacked
+  std::vector<std::vector<float>> _packed;
+  // per step B of matrix products, one per batch packed at prepare() for
+  // constant weights, and a single one packed per batch and run otherwise
+  std::vector<std::vector<sPackedMatrix>> _packed_b;
+  int64_t _packed_bytes = 0;
+  // scratch shared by the steps, sized for the largest
+  std::vector<float> _workspace;
+  std::unique_ptr<ThreadPool> _pool;
+  std::vector<double> _step_ms;
+
+  bool build_step(int node_index, sExecutionStep &step);
+  bool build_fused_step(int group_index, sExecutionStep &step);
+  bool build_chain_step(int group_index, sExecutionStep &step);
+  sActivation activation_of(const sModelGraphNode &node) const;
+  bool batch_norm_affine(const sModelGraphNode &node,
+                         std::vector<float> &scale,
+                         std::vector<float> &shift);
+  int add_constant(const std::string &name, std::vector<int64_t> shape,
+                   std::vector<float> values);
+  void rewrite_fused_nodes(const std::vector<bool> &needed);
+  void plan_layouts();
+  void release_unread_weights();
+  bool plan_buffers(const std::vector<bool> &needed);
+  void pack_weights();
+  void run_gemm(size_t index, const float *a, const float *b, const float *c,
+                float *y);
+  bool fail(const std::string &message);
+
+public:
+  bool prepare(const std::string &model_path, const sModelGraph &graph,
+               const sExecutorConfig &config);
+  bool ready() const { return !_steps.empty() && _error.empty(); }
+  const std::string &error() const { return _error; }
+  bool run();
+
+  // graph inputs (initializers excluded) and outputs as tensor indices
+  const std::vector<int> &inputs() const { return _inputs; }
+  const std::vector<int> &outputs() const { return _outputs; }
+  const sModelGraph &graph() const { return _graph; }
+  float *data(int tensor_index) { return _data[tensor_index]; }
+  const float *data(int tensor_index) const { return _data[tensor_index]; }
+  int64_t element_count(int tensor_index) const;
+  // inputs and outputs are always NCHW
+  eTensorLayout layout(int tensor_index) const {
+    return _layouts[tensor_index];
+  }
+
+  const std::vector<sExecutionStep> &steps() const { return _steps; }
+  // groups the steps were fused from, empty with fusion off
+  const sFusionPlan &fusion() const { return _fusion; }
+  // per step wall time of the last run, if profiling
+  const std::vector<double> &step_ms() const { return _step_ms; }
+  int64_t arena_bytes() const { return _arena_size; }
+  int64_t weight_bytes() const { return _weight_bytes; }
+  // weights repacked for the optimized kernels
+  int64_t packed_bytes() const { return _packed_bytes; }
+};
@@ -0,0 +1,224 @@
+#include "gemm.h"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "../model/half.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+namespace {
+
+// largest micro tile, AVX-512 is 6 x 32
+constexpr int kMaxTile = 256;
+
+int64_t round_down(int64_t value, int64_t multiple) {
+  return std::max(multiple, value / multiple * multiple);
+}
+
+sGemmBlocking compute_blocking() {
+  sGemmBlocking blocking;
+  // typical desktop sizes, used where the OS does not tell
+  blocking.l1_bytes = 32 * 1024;
+  blocking.l2_bytes = 1024 * 1024;
+  blocking.l3_bytes = 8 * 1024 * 1024;
+#if defined(__linux__) && defined(_SC_LEVEL1_DCACHE_SIZE)
+  auto query = [](int name, int64_t fallback) {
+    const long value = sysconf(name);
+    return value > 0 ? static_cast<int64_t>(value) : fallback;
+  };
+  blocking.l1_bytes = query(_SC_LEVEL1_DCACHE_SIZE, blocking.l1_bytes);
+  blocking.l2_bytes = query(_SC_LEVEL2_CACHE_SIZE, blocking.l2_bytes);
+  blocking.l3_bytes = query(_SC_LEVEL3_CACHE_SIZE, blocking.l3_bytes);
+#endif
+
+  const auto &simd = simd_kernels();
+  const int64_t mr = simd.gemm_mr;
+  const int64_t nr = simd.gemm_nr;
+  // half of each level, the rest is left for C and everything else
+  blocking.kc = std::clamp<int64_t>(
+      round_down(blocking.l1_bytes / 2 / ((mr + nr) * 4), 8), 64, 512);
+  blocking.mc = std::clamp<int64_t>(
+      round_down(blocking.l2_bytes / 2 / (blocking.kc * 4), mr), mr, 128 * mr);
+  blocking.nc = std::clamp<int64_t>(
+      round_down(blocking.l3_bytes / 2 / (blocking.kc * 4), nr), nr, 8192);
+  return blocking;
+}
+
+float round_operand(float value, eGemmPrecision precision) {
+  return precision == GEMM_BF16 ? bfloat16_to_float(float_to_bfloat16(value))
+                                : value;
+}
+
+} // namespace
+
+const char *gemm_precision_name(eGemmPrecision precision) {
+  return precision == GEMM_BF16 ? "bf16" : "fp32";
+}
+
+const sGemmBlocking &gemm_blocking() {
+  static const sGemmBlocking blocking = compute_blocking();
+  return blocking;
+}
+
+void pack_gemm_b(const float *b, int64_t ldb, bool trans_b, int64_t k,
+                 int64_t n, eGemmPrecision precision, sPackedMatrix &packed) {
+  const int64_t nr = simd_kernels().gemm_nr;
+  const int64_t kc = gemm_blocking().kc;
+  const int64_t panels = (n + nr - 1) / nr;
+  packed.k = k;
+  packed.n = n;
+  packed.kc = kc;
+  packed.nr = static_cast<int>(nr);
+  packed.precision = precision;
+  const size_t size = static_cast<size_t>(k * panels * nr);
+  packed.fp32.resize(precision == GEMM_FP32 ? size : 0);
+  packed.bf16.resize(precision == GEMM_BF16 ? size : 0);
+
+  size_t index = 0;
+  for (int64_t l0 = 0; l0 < k; l0 += kc) {
+    const int64_t depth = std::min(kc, k - l0);
+    for (int64_t panel = 0; panel < panels; ++panel) {
+      for (int64_t l = l0; l < l0 + depth; ++l) {
+        for (int64_t jj = 0; jj < nr; ++jj) {
+          const int64_t j = panel * nr + jj;
+          float value = 0.f;
+          if (j < n) {
+            value = trans_b ? b[j * ldb + l] : b[l * ldb + j];
+          }
+          if (precision == GEMM_BF16) {
+            packed.bf16[index++] = float_to_bfloat16(value);
+          } else {
+            packed.fp32[index++] = value;
+          }
+        }
+      }
+    }
+  }
+}
+
+void gemm_packed(int64_t m, const float *a, int64_t lda, bool trans_a,
+                 float alpha, const sPackedMatrix &b, float *c, int64_t ldc,
+                 bool accumulate, ThreadPool *pool,
+                 const sGemmEpilogue *epilogue) {
+  const int64_t n = b.n;
+  const int64_t k = b.k;
+  if (m <= 0 || n <= 0) {
+    return;
+  }
+  const auto &simd = simd_kernels();
+  const int64_t mr = simd.gemm_mr;
+  const int64_t nr = b.nr;
+  const int64_t kc = b.kc;
+  const int64_t mc = gemm_blocking().mc;
+  const int64_t panels = (n + nr - 1) / nr;
+
+  // C is split into mc x (panels_per_block * nr) blocks, one task each.
+  // narrow the column blocks until every thread has a couple of tasks.
+  const int64_t row_blocks = (m + mc - 1) / mc;
+  int64_t panels_per_block = std::max<int64_t>(1, gemm_blocking().nc / nr);
+  const int64_t threads = pool ? pool->size() : 1;
+  while (panels_per_block > 1 &&
+         row_blocks * ((panels + panels_per_block - 1) / panels_per_block) <
+             2 * threads) {
+    panels_per_block = (panels_per_block + 1) / 2;
+  }
+  const int64_t column_blocks =
+      (panels + panels_per_block - 1) / panels_per_block;
+
+  auto task = [&](int64_t t) {
+    const int64_t i0 = (t / column_blocks) * mc;
+    const int64_t rows = std::min(mc, m - i0);
+    const int64_t row_panels = (rows + mr - 1) / mr;
+    const int64_t panel0 = (t % column_blocks) * panels_per_block;
+    const int64_t panel1 = std::min(panels, panel0 + panels_per_block);
+
+    thread_local std::vector<float> a_packed;
+    a_packed.resize(static_cast<size_t>(row_panels * mr * kc));
+    float tile[kMaxTile];
+
+    for (int64_t l0 = 0; l0 < k || l0 == 0; l0 += kc) {
+      const int64_t depth = std::min(kc, k - l0);
+      const bool load_c = accumulate || l0 > 0;
+
+      // A block as mr-row panels, alpha folded in
+      float *dst = a_packed.data();
+      for (int64_t rp = 0; rp < row_panels; ++rp) {
+        for (int64_t l = l0; l < l0 + depth; ++l) {
+          for (int64_t r = 0; r < mr; ++r) {
+            const int64_t i = i0 + rp * mr + r;
+            float value = 0.f;
+            if (i < m) {
+              value = alpha * (trans_a ? a[l * lda + i] : a[i * lda + l]);
+            }
+            *dst++ = round_operand(value, b.precision);
+          }
+        }
+      }
+
+      const int64_t b_pass = l0 * panels * nr;
+      for (int64_t panel = panel0; panel < panel1; ++panel) {
+        const int64_t b_offset = b_pass + panel * depth * nr;
+        const int64_t j0 = panel * nr;
+        const int64_t cols = std::min(nr, n - j0);
+        for (int64_t rp = 0; rp < row_panels; ++rp) {
+          const float *a_panel = a_packed.data() + rp * depth * mr;
+          const int64_t tile_rows = std::min(mr, rows - rp * mr);
+          float *c_tile = c + (i0 + rp * mr) * ldc + j0;
+          const bool full = tile_rows == mr && cols == nr;
+          float *out = full ? c_tile : tile;
+          const int64_t out_ld = full ? ldc : nr;
+          const bool out_accumulate = full && load_c;
+          if (b.precision == GEMM_BF16) {
+            simd.gemm_micro_bf16(depth, a_panel, b.bf16.data() + b_offset,
+                                 out, out_ld, out_accumulate);
+          } else {
+            simd.gemm_micro_fp32(depth, a_panel, b.fp32.data() + b_offset,
+                                 out, out_ld, out_accumulate);
+          }
+          if (full) {
+            continue;
+          }
+          // edge tile, computed aside and merged into the valid part
+          for (int64_t r = 0; r < tile_rows; ++r) {
+            for (int64_t j = 0; j < cols; ++j) {
+              float &value = c_tile[r * ldc + j];
+              value = (load_c ? value : 0.f) + tile[r * nr + j];
+            }
+          }
+        }
+      }
+      if (k == 0) {
+        break;
+      }
+    }
+
+    if (!epilogue) {
+      return;
+    }
+    const int64_t j0 = panel0 * nr;
+    const int64_t cols = std::min(n, panel1 * nr) - j0;
+    for (int64_t r = 0; r < rows; ++r) {
+      float *row = c + (i0 + r) * ldc + j0;
+      if (epilogue->bias) {
+        for (int64_t j = 0; j < cols; ++j) {
+          row[j] += epilogue->bias[j0 + j];
+        }
+      }
+      apply_activation(epilogue->activation, row, row,
+                       static_cast<size_t>(cols));
+    }
+  };
+
+  const int64_t tasks = row_blocks * column_blocks;
+  if (pool) {
+    pool->parallel_for(tasks, task);
+  } else {
+    for (int64_t t = 0; t < tasks; ++t) {
+      task(t);
+    }
+  }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "kernels.h"
+
+class ThreadPool;
+
+// Packed, cache-blocked GEMM on the micro kernel of the running CPU (see
+// simd.h). B is packed once, typically at model load; A is packed per call
+// into per-thread buffers, block by block.
+
+enum eGemmPrecision {
+  GEMM_FP32 = 0,
+  // operands rounded to bfloat16, products accumulated in fp32. packed B
+  // takes half the memory and bandwidth.
+  GEMM_BF16,
+};
+
+const char *gemm_precision_name(eGemmPrecision precision);
+
+// block sizes derived from the data cache sizes of the machine
+struct sGemmBlocking {
+  int64_t l1_bytes = 0;
+  int64_t l2_bytes = 0;
+  int64_t l3_bytes = 0;
+  // depth of one pass, so a micro panel of A and of B stay in L1
+  int64_t kc = 0;
+  // rows of A packed per block, sized for L2
+  int64_t mc = 0;
+  // columns of B per block, sized for L3
+  int64_t nc = 0;
+};
+
+const sGemmBlocking &gemm_blocking();
+
+// B (k x n) as kc-deep passes of nr-wide column panels, zero padded
+struct sPackedMatrix {
+  int64_t k = 0;
+  int64_t n = 0;
+  int64_t kc = 0;
+  int nr = 0;
+  eGemmPrecision precision = GEMM_FP32;
+  std::vector<float> fp32;
+  std::vector<uint16_t> bf16;
+
+  int64_t bytes() const {
+    return static_cast<int64_t>(fp32.size() * sizeof(float) +
+                                bf16.size() * sizeof(uint16_t));
+  }
+};
+
+// b is (k x n), or (n x k) with trans_b. reuses the storage of `packed`.
+void pack_gemm_b(const float *b, int64_t ldb, bool trans_b, int64_t k,
+                 int64_t n, eGemmPrecision precision, sPackedMatrix &packed);
+
+// applied to each block of C after its last pass, while it is in cache
+struct sGemmEpilogue {
+  // n values added to every row, may be null
+  const float *bias = nullptr;
+  sActivation activation;
+};
+
+// C (m x n) = alpha op(A) B, or C += alpha op(A) B with accumulate. A is
+// (m x k), or (k x m) with trans_a. runs on `pool` if given.
+void gemm_packed(int64_t m, const float *a, int64_t lda, bool trans_a,
+                 float alpha, const sPackedMatrix &b, float *c, int64_t ldc,
+                 bool accumulate, ThreadPool *pool,
+                 const sGemmEpilogue *epilogue = nullptr);
@@ -0,0 +1,252 @@
+#include "kernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+void conv2d_reference(const sConv2DParams &p, const float *input,
+                      const float *weight, const float *bias, float *output) {
+  const int64_t in_per_group = p.in_channels / p.group;
+  const int64_t out_per_group = p.out_channels / p.group;
+  const int64_t in_plane = p.in_height * p.in_width;
+  const int64_t out_plane = p.out_height * p.out_width;
+  const int64_t kernel_size = p.kernel_height * p.kernel_width;
+
+  for (int64_t n = 0; n < p.batch; ++n) {
+    for (int64_t oc = 0; oc < p.out_channels; ++oc) {
+      const int64_t g = oc / out_per_group;
+      const float *w = weight + oc * in_per_group * kernel_size;
+      const float *in = input + (n * p.in_channels + g * in_per_group) *
+                                    in_plane;
+      float *out = output + (n * p.out_channels + oc) * out_plane;
+      const float b = bias ? bias[oc] : 0.f;
+
+      for (int64_t oy = 0; oy < p.out_height; ++oy) {
+        for (int64_t ox = 0; ox < p.out_width; ++ox) {
+          float sum = b;
+          const int64_t iy0 = oy * p.stride_height - p.pad_top;
+          const int64_t ix0 = ox * p.stride_width - p.pad_left;
+          for (int64_t ic = 0; ic < in_per_group; ++ic) {
+            const float *plane = in + ic * in_plane;
+            const float *wk = w + ic * kernel_size;
+            for (int64_t ky = 0; ky < p.kernel_height; ++ky) {
+              const int64_t iy = iy0 + ky * p.dilation_height;
+              if (iy < 0 || iy >= p.in_height) {
+                continue;
+              }
+              for (int64_t kx = 0; kx < p.kernel_width; ++kx) {
+                const int64_t ix = ix0 + kx * p.dilation_width;
+                if (ix < 0 || ix >= p.in_width) {
+                  continue;
+                }
+                sum += plane[iy * p.in_width + ix] *
+                       wk[ky * p.kernel_width + kx];
+              }
+            }
+          }
+          out[oy * p.out_width + ox] = sum;
+        }
+      }
+    }
+  }
+}
+
+void gemm_reference(const sGemmParams &p, const float *a, const float *b,
+                    const float *c, float *y) {
+  for (int64_t i = 0; i < p.m; ++i) {
+    for (int64_t j = 0; j < p.n; ++j) {
+      float sum = 0.f;
+      for (int64_t l = 0; l < p.k; ++l) {
+        const float av = p.trans_a ? a[l * p.m + i] : a[i * p.k + l];
+        const float bv = p.trans_b ? b[j * p.k + l] : b[l * p.n + j];
+        sum += av * bv;
+      }
+      float value = p.alpha * sum;
+      if (c) {
+        const int64_t row = p.c_rows == 1 ? 0 : i;
+        const int64_t col = p.c_cols == 1 ? 0 : j;
+        value += p.beta * c[row * p.c_cols + col];
+      }
+      y[i * p.n + j] = value;
+    }
+  }
+}
+
+void apply_activation(const sActivation &activation, const float *input,
+                      float *output, size_t count) {
+  const float alpha = activation.alpha;
+  const float beta = activation.beta;
+  switch (activation.kind) {
+  case ACTIVATION_NONE:
+    if (output != input) {
+      std::copy(input, input + count, output);
+    }
+    break;
+  case ACTIVATION_CLIP:
+    for (size_t i = 0; i < count; ++i) {
+      output[i] = std::min(std::max(input[i], alpha), beta);
+    }
+    break;
+  case ACTIVATION_LEAKY_RELU:
+    for (size_t i = 0; i < count; ++i) {
+      output[i] = input[i] >= 0.f ? input[i] : alpha * input[i];
+    }
+    break;
+  case ACTIVATION_SIGMOID:
+    for (size_t i = 0; i < count; ++i) {
+      output[i] = 1.f / (1.f + std::exp(-input[i]));
+    }
+    break;
+  case ACTIVATION_TANH:
+    for (size_t i = 0; i < count; ++i) {
+      output[i] = std::tanh(input[i]);
+    }
+    break;
+  case ACTIVATION_GELU:
+    for (size_t i = 0; i < count; ++i) {
+      const float x = input[i];
+      output[i] =
+          alpha != 0.f
+              ? 0.5f * x *
+                    (1.f + std::tanh(0.7978845608f *
+                                     (x + 0.044715f * x * x * x)))
+              : 0.5f * x * (1.f + std::erf(x * 0.7071067812f));
+    }
+    break;
+  }
+}
+
+std::vector<int64_t> broadcast_strides(const std::vector<int64_t> &shape,
+                                       const std::vector<int64_t> &out_shape) {
+  std::vector<int64_t> strides(out_shape.size(), 0);
+  int64_t stride = 1;
+  for (size_t i = shape.size(); i-- > 0;) {
+    const size_t axis = out_shape.size() - shape.size() + i;
+    strides[axis] = shape[i] == 1 ? 0 : stride;
+    stride *= shape[i];
+  }
+  return strides;
+}
+
+namespace {
+
+float apply(eBinaryOp op, float a, float b) {
+  switch (op) {
+  case BINARY_SUB:
+    return a - b;
+  case BINARY_MUL:
+    return a * b;
+  case BINARY_DIV:
+    return a / b;
+  case BINARY_ADD:
+  default:
+    return a + b;
+  }
+}
+
+} // namespace
+
+void binary_broadcast(eBinaryOp op, const float *a,
+                      const std::vector<int64_t> &a_strides, const float *b,
+                      const std::vector<int64_t> &b_strides, float *output,
+                      const std::vector<int64_t> &out_shape) {
+  int64_t count = 1;
+  for (int64_t dim : out_shape) {
+    count *= dim;
+  }
+  const size_t rank = out_shape.size();
+  // odometer over the output index, innermost dim fastest
+  std::vector<int64_t> index(rank, 0);
+  int64_t a_offset = 0;
+  int64_t b_offset = 0;
+  for (int64_t i = 0; i < count; ++i) {
+    output[i] = apply(op, a[a_offset], b[b_offset]);
+    for (size_t d = rank; d-- > 0;) {
+      a_offset += a_strides[d];
+      b_offset += b_strides[d];
+      if (++index[d] < out_shape[d]) {
+        break;
+      }
+      a_offset -= a_strides[d] * out_shape[d];
+      b_offset -= b_strides[d] * out_shape[d];
+      index[d] = 0;
+    }
+  }
+}
+
+void global_average_pool(const float *input, float *output, int64_t planes,
+                         int64_t spatial) {
+  for (int64_t p = 0; p < planes; ++p) {
+    const float *plane = input + p * spatial;
+    double sum = 0.0;
+    for (int64_t i = 0; i < spatial; ++i) {
+      sum += plane[i];
+    }
+    output[p] = spatial > 0 ? static_cast<float>(sum / spatial) : 0.f;
+  }
+}
+
+void channel_affine(const float *input, const float *scale,
+                    const float *shift, float *output, int64_t batch,
+                    int64_t channels, int64_t spatial) {
+  for (int64_t n = 0; n < batch; ++n) {
+    for (int64_t c = 0; c < channels; ++c) {
+      const int64_t offset = (n * channels + c) * spatial;
+      for (int64_t i = 0; i < spatial; ++i) {
+        output[offset + i] = input[offset + i] * scale[c] + shift[c];
+      }
+    }
+  }
+}
+
+void elementwise_chain(const float *input,
+                       const std::vector<sElementwiseLink> &links,
+                       float *output, const std::vector<int64_t> &out_shape) {
+  const size_t rank = out_shape.size();
+  const size_t outer = rank ? rank - 1 : 0;
+  const int64_t width = rank ? out_shape.back() : 1;
+  int64_t rows = 1;
+  for (size_t d = 0; d < outer; ++d) {
+    rows *= out_shape[d];
+  }
+  // odometer over the outer dims, one operand offset per link
+  std::vector<int64_t> index(rank, 0);
+  std::vector<int64_t> offsets(links.size(), 0);
+  for (int64_t r = 0; r < rows; ++r) {
+    const float *in = input + r * width;
+    float *out = output + r * width;
+    if (out != in) {
+      std::copy(in, in + width, out);
+    }
+    for (size_t l = 0; l < links.size(); ++l) {
+      const auto &link = links[l];
+      if (!link.binary) {
+        apply_activation(link.activation, out, out,
+                         static_cast<size_t>(width));
+        continue;
+      }
+      const int64_t step = rank ? link.operand_strides.back() : 0;
+      const float *operand = link.operand + offsets[l];
+      for (int64_t j = 0; j < width; ++j) {
+        const float value = operand[j * step];
+        out[j] = link.swapped ? apply(link.op, value, out[j])
+                              : apply(link.op, out[j], value);
+      }
+    }
+    for (size_t d = outer; d-- > 0;) {
+      for (size_t l = 0; l < links.size(); ++l) {
+        if (links[l].binary) {
+          offsets[l] += links[l].operand_strides[d];
+        }
+      }
+      if (++index[d] < out_shape[d]) {
+        break;
+      }
+      for (size_t l = 0; l < links.size(); ++l) {
+        if (links[l].binary) {
+          offsets[l] -= links[l].operand_strides[d] * out_shape[d];
+        }
+      }
+      index[d] = 0;
+    }
+  }
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Reference CPU kernels of the native engine. fp32, NCHW, row major. They
+// favour clarity over speed and are the baseline optimized kernels are
+// checked against.
+
+struct sConv2DParams {
+  int64_t batch = 1;
+  int64_t in_channels = 0;
+  int64_t in_height = 0;
+  int64_t in_width = 0;
+  int64_t out_channels = 0;
+  int64_t out_height = 0;
+  int64_t out_width = 0;
+  int64_t kernel_height = 1;
+  int64_t kernel_width = 1;
+  int64_t stride_height = 1;
+  int64_t stride_width = 1;
+  int64_t pad_top = 0;
+  int64_t pad_left = 0;
+  int64_t dilation_height = 1;
+  int64_t dilation_width = 1;
+  int64_t group = 1;
+};
+
+// weight is (out_channels, in_channels / group, kh, kw); bias may be null
+void conv2d_reference(const sConv2DParams &params, const float *input,
+                      const float *weight, const float *bias, float *output);
+
+struct sGemmParams {
+  int64_t m = 0;
+  int64_t n = 0;
+  int64_t k = 0;
+  bool trans_a = false;
+  bool trans_b = false;
+  float alpha = 1.f;
+  float beta = 1.f;
+  // shape of C, broadcast to (m, n): (m, n), (1, n), (m, 1) or (1, 1)
+  int64_t c_rows = 0;
+  int64_t c_cols = 0;
+};
+
+// Y = alpha * op(A) op(B) + beta * C; c may be null
+void gemm_reference(const sGemmParams &params, const float *a, const float *b,
+                    const float *c, float *y);
+
+enum eActivation {
+  ACTIVATION_NONE = 0,
+  // clamp to [alpha, beta]; Relu is alpha = 0, beta = inf
+  ACTIVATION_CLIP,
+  // x for x >= 0, alpha x below
+  ACTIVATION_LEAKY_RELU,
+  ACTIVATION_SIGMOID,
+  ACTIVATION_TANH,
+  // erf form, or the tanh approximation if alpha is nonzero
+  ACTIVATION_GELU,
+};
+
+struct sActivation {
+  eActivation kind = ACTIVATION_NONE;
+  float alpha = 0.f;
+  float beta = 0.f;
+};
+
+// standalone, and as the epilogue of fused convolutions and products.
+// input and output may be the same buffer.
+void apply_activation(const sActivation &activation, const float *input,
+                      float *output, size_t count);
+
+enum eBinaryOp {
+  BINARY_ADD = 0,
+  BINARY_SUB,
+  BINARY_MUL,
+  BINARY_DIV,
+};
+
+// numpy broadcasting strides of an input against the output shape: 0 along
+// broadcast dims
+std::vector<int64_t> broadcast_strides(const std::vector<int64_t> &shape,
+                                       const std::vector<int64_t> &out_shape);
+
+void binary_broadcast(eBinaryOp op, const float *a,
+                      const std::vector<int64_t> &a_strides, const float *b,
+                      const std::vector<int64_t> &b_strides, float *output,
+                      const std::vector<int64_t> &out_shape);
+
+// mean over `spatial` contiguous values of each of `planes` planes
+void global_average_pool(const float *input, float *output, int64_t planes,
+                         int64_t spatial);
+
+// inference BatchNormalization with the statistics folded into one scale
+// and shift per channel: y = x * scale[c] + shift[c]
+void channel_affine(const float *input, const float *scale,
+                    const float *shift, float *output, int64_t batch,
+                    int64_t channels, int64_t spatial);
+
+// one link of a fused elementwise chain: an activation of the running
+// value, or a binary op between it and a broadcast operand
+struct sElementwiseLink {
+  bool binary = false;
+  sActivation activation;
+  eBinaryOp op = BINARY_ADD;
+  // the running value is the right-hand side, e.g. 1 - x
+  bool swapped = false;
+  const float *operand = nullptr;
+  std::vector<int64_t> operand_strides;
+};
+
+// runs all links over one innermost row at a time, so every element is
+// read and written once. input has the output shape.
+void elementwise_chain(const float *input,
+                       const std::vector<sElementwiseLink> &links,
+                       float *output, const std::vector<int64_t> &out_shape);
@@ -0,0 +1,160 @@
+#include "layout.h"
+
+#include <algorithm>
+
+#include "simd.h"
+
+namespace {
+
+// offsets of one layout: position s of channel c in image n is at
+// n * image() + channel(c) + s * block
+struct sChannelMap {
+  int64_t block = 1;
+  int64_t blocks = 1;
+  int64_t spatial = 1;
+
+  sChannelMap(eTensorLayout layout, int64_t channels, int64_t spatial)
+      : spatial(spatial) {
+    block = layout_block(layout);
+    if (block == 0) {
+      block = std::max<int64_t>(channels, 1);
+    }
+    blocks = (channels + block - 1) / block;
+  }
+  int64_t image() const { return blocks * spatial * block; }
+  int64_t channel(int64_t c) const {
+    return (c / block) * spatial * block + c % block;
+  }
+};
+
+} // namespace
+
+const char *layout_name(eTensorLayout layout) {
+  switch (layout) {
+  case LAYOUT_NHWC:
+    return "nhwc";
+  case LAYOUT_NCHWC8:
+    return "nchwc8";
+  case LAYOUT_NCHWC16:
+    return "nchwc16";
+  case LAYOUT_NCHW:
+  default:
+    return "nchw";
+  }
+}
+
+int64_t layout_block(eTensorLayout layout) {
+  switch (layout) {
+  case LAYOUT_NHWC:
+    return 0;
+  case LAYOUT_NCHWC8:
+    return 8;
+  case LAYOUT_NCHWC16:
+    return 16;
+  case LAYOUT_NCHW:
+  default:
+    return 1;
+  }
+}
+
+eTensorLayout native_conv_layout() {
+  switch (detected_simd_isa()) {
+  case SIMD_AVX512:
+    return LAYOUT_NCHWC16;
+  case SIMD_AVX2:
+  case SIMD_NEON:
+    return LAYOUT_NCHWC8;
+  case SIMD_SCALAR:
+  default:
+    return LAYOUT_NCHW;
+  }
+}
+
+std::vector<int64_t> layout_shape(const std::vector<int64_t> &shape,
+                                  eTensorLayout layout) {
+  if (shape.size() != 4 || layout == LAYOUT_NCHW) {
+    return shape;
+  }
+  if (layout == LAYOUT_NHWC) {
+    return {shape[0], shape[2], shape[3], shape[1]};
+  }
+  const int64_t block = layout_block(layout);
+  return {shape[0], (shape[1] + block - 1) / block, shape[2], shape[3],
+          block};
+}
+
+void reorder_layout(const float *input, eTensorLayout from, float *output,
+                    eTensorLayout to, int64_t batch, int64_t channels,
+                    int64_t spatial, ThreadPool *pool) {
+  const sChannelMap src(from, channels, spatial);
+  const sChannelMap dst(to, channels, spatial);
+  const int64_t padded = dst.blocks * dst.block;
+  std::vector<int64_t> src_offset(static_cast<size_t>(padded), -1);
+  std::vector<int64_t> dst_offset(static_cast<size_t>(padded));
+  for (int64_t c = 0; c < padded; ++c) {
+    if (c < channels) {
+      src_offset[c] = src.channel(c);
+    }
+    dst_offset[c] = dst.channel(c);
+  }
+  // tasks over runs of positions, so they rarely write the same cache line
+  constexpr int64_t kChunk = 64;
+  const int64_t chunks = (spatial + kChunk - 1) / kChunk;
+  auto copy = [&](int64_t task) {
+    const int64_t n = task / chunks;
+    const int64_t begin = task % chunks * kChunk;
+    const int64_t end = std::min(spatial, begin + kChunk);
+    const float *in = input + n * src.image();
+    float *out = output + n * dst.image();
+    for (int64_t s = begin; s < end; ++s) {
+      for (int64_t c = 0; c < padded; ++c) {
+        out[dst_offset[c] + s * dst.block] =
+            src_offset[c] < 0 ? 0.f : in[src_offset[c] + s * src.block];
+      }
+    }
+  };
+  if (pool) {
+    pool->parallel_for(batch * chunks, copy);
+    return;
+  }
+  for (int64_t task = 0; task < batch * chunks; ++task) {
+    copy(task);
+  }
+}
+
+void global_average_pool_layout(const float *input, eTensorLayout layout,
+                                float *output, int64_t batch,
+                                int64_t channels, int64_t spatial) {
+  const sChannelMap map(layout, channels, spatial);
+  for (int64_t n = 0; n < batch; ++n) {
+    for (int64_t c = 0; c < channels; ++c) {
+      const float *in = input + n * map.image() + map.channel(c);
+      double sum = 0.0;
+      for (int64_t s = 0; s < spatial; ++s) {
+        sum += in[s * map.block];
+      }
+      output[n * channels + c] =
+          spatial > 0 ? static_cast<float>(sum / spatial) : 0.f;
+    }
+  }
+}
+
+void channel_affine_layout(const float *input, eTensorLayout layout,
+                           const float *scale, const float *shift,
+                           float *output, int64_t batch, int64_t channels,
+                           int64_t spatial) {
+  const sChannelMap map(layout, channels, spatial);
+  const int64_t padded = map.blocks * map.block;
+  for (int64_t n = 0; n < batch; ++n) {
+    for (int64_t c = 0; c < padded; ++c) {
+      // the padding stays zero
+      const float a = c < channels ? scale[c] : 0.f;
+      const float b = c < channels ? shift[c] : 0.f;
+      const int64_t offset = n * map.image() + map.channel(c);
+      for (int64_t s = 0; s < spatial; ++s) {
+        const int64_t i = offset + s * map.block;
+        output[i] = input[i] * a + b;
+      }
+    }
+  }
+}
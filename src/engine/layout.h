@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "thread_pool.h"
+
+// Memory layouts of 4D activations in the native engine. Graph inputs,
+// outputs and every op without a layout aware kernel use NCHW; the
+// executor's layout plan moves the tensors between convolutions into the
+// layout their kernels prefer and reorders at the boundaries.
+//
+// Every layout is NCHW with the channels split into blocks of b values
+// stored innermost: offset ((n * blocks + c / b) * H * W + s) * b + c % b.
+// NCHW is b = 1, NHWC is a single block of all channels and the blocked
+// layouts pad the channels up to a whole block. Reorders zero the padding;
+// ops running blocked may leave other finite values there, which no kernel
+// reads as data.
+
+enum eTensorLayout {
+  LAYOUT_NCHW = 0,
+  LAYOUT_NHWC,
+  // channels in blocks of 8 and 16, one SIMD register of AVX2 and AVX-512
+  LAYOUT_NCHWC8,
+  LAYOUT_NCHWC16,
+};
+
+const char *layout_name(eTensorLayout layout);
+
+// channels per block, 0 for NHWC whose block is all channels
+int64_t layout_block(eTensorLayout layout);
+
+// layout convolutions should run in on this CPU: the blocked layout that
+// fills a vector register of the detected ISA, NCHW without SIMD
+eTensorLayout native_conv_layout();
+
+// physical shape of a logical NCHW shape, e.g. (N, C / 16, H, W, 16)
+std::vector<int64_t> layout_shape(const std::vector<int64_t> &shape,
+                                  eTensorLayout layout);
+
+// copies a (batch, channels, spatial) tensor between layouts, zeroing the
+// channel padding of blocked outputs. pool may be null.
+void reorder_layout(const float *input, eTensorLayout from, float *output,
+                    eTensorLayout to, int64_t batch, int64_t channels,
+                    int64_t spatial, ThreadPool *pool = nullptr);
+
+// global_average_pool over an input in `layout`, output in NCHW
+void global_average_pool_layout(const float *input, eTensorLayout layout,
+                                float *output, int64_t batch,
+                                int64_t channels, int64_t spatial);
+
+// channel_affine with input and output in `layout`
+void channel_affine_layout(const float *input, eTensorLayout layout,
+                           const float *scale, const float *shift,
+                           float *output, int64_t batch, int64_t channels,
+                           int64_t spatial);
@@ -0,0 +1,115 @@
+#include "simd.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace {
+
+bool cpu_has(eSimdIsa isa) {
+  switch (isa) {
+  case SIMD_SCALAR:
+    return true;
+  case SIMD_NEON:
+#if defined(__aarch64__) || defined(_M_ARM64)
+    return true;
+#else
+    return false;
+#endif
+  case SIMD_AVX2:
+  case SIMD_AVX512:
+#if (defined(__GNUC__) || defined(__clang__)) &&                              \
+    (defined(__x86_64__) || defined(__i386__))
+    if (isa == SIMD_AVX2) {
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    }
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("fma");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    {
+      int info[4];
+      __cpuid(info, 1);
+      const bool fma = (info[2] & (1 << 12)) != 0;
+      const bool osxsave = (info[2] & (1 << 27)) != 0;
+      if (!fma || !osxsave) {
+        return false;
+      }
+      // the OS must save the ymm (and zmm) state on context switches
+      const unsigned long long xcr0 = _xgetbv(0);
+      __cpuidex(info, 7, 0);
+      if (isa == SIMD_AVX2) {
+        return (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+      }
+      return (xcr0 & 0xe6) == 0xe6 && (info[1] & (1 << 16)) != 0;
+    }
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+const sSimdKernels *compiled_kernels(eSimdIsa isa) {
+  switch (isa) {
+  case SIMD_NEON:
+    return simd_kernels_neon();
+  case SIMD_AVX2:
+    return simd_kernels_avx2();
+  case SIMD_AVX512:
+    return simd_kernels_avx512();
+  case SIMD_SCALAR:
+  default:
+    return simd_kernels_scalar();
+  }
+}
+
+eSimdIsa requested_cap() {
+  const char *value = std::getenv("MYNN_SIMD");
+  if (!value) {
+    return SIMD_AVX512;
+  }
+  for (int isa = SIMD_SCALAR; isa <= SIMD_AVX512; ++isa) {
+    if (std::strcmp(value, simd_isa_name(static_cast<eSimdIsa>(isa))) == 0) {
+      return static_cast<eSimdIsa>(isa);
+    }
+  }
+  return SIMD_AVX512;
+}
+
+} // namespace
+
+const char *simd_isa_name(eSimdIsa isa) {
+  switch (isa) {
+  case SIMD_NEON:
+    return "neon";
+  case SIMD_AVX2:
+    return "avx2";
+  case SIMD_AVX512:
+    return "avx512";
+  case SIMD_SCALAR:
+  default:
+    return "scalar";
+  }
+}
+
+eSimdIsa detected_simd_isa() {
+  static const eSimdIsa isa = [] {
+    const eSimdIsa cap = requested_cap();
+    for (int candidate = cap; candidate > SIMD_SCALAR; --candidate) {
+      const auto isa = static_cast<eSimdIsa>(candidate);
+      // check the CPU first: the tables live in code built for the ISA
+      if (cpu_has(isa) && compiled_kernels(isa)) {
+        return isa;
+      }
+    }
+    return SIMD_SCALAR;
+  }();
+  return isa;
+}
+
+const sSimdKernels &simd_kernels() {
+  return *compiled_kernels(detected_simd_isa());
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+
+#include "kernels.h"
+
+// Vectorized inner kernels, built once per instruction set and picked at
+// runtime by CPU feature detection. The per-ISA translation units get their
+// own compile flags, everything else in the engine is baseline code.
+
+enum eSimdIsa {
+  SIMD_SCALAR = 0,
+  SIMD_NEON,
+  SIMD_AVX2,
+  SIMD_AVX512,
+};
+
+const char *simd_isa_name(eSimdIsa isa);
+
+struct sSimdKernels {
+  eSimdIsa isa = SIMD_SCALAR;
+  // C (m x n) = A (m x k) B (k x n) + bias[row], all row major. bias may
+  // be null; with accumulate set C is added to instead of overwritten.
+  void (*sgemm)(int64_t m, int64_t n, int64_t k, const float *a, int64_t lda,
+                const float *b, int64_t ldb, float *c, int64_t ldc,
+                const float *bias, bool accumulate) = nullptr;
+  // direct convolution with one filter per channel (group == channels)
+  void (*depthwise_conv2d)(const sConv2DParams &params, const float *input,
+                           const float *weight, const float *bias,
+                           float *output) = nullptr;
+
+  // packed GEMM micro kernel: a gemm_mr x gemm_nr tile of C from k steps
+  // of a packed A panel (gemm_mr values per step) and a packed B panel
+  // (gemm_nr values per step, float or bfloat16)
+  int gemm_mr = 0;
+  int gemm_nr = 0;
+  void (*gemm_micro_fp32)(int64_t k, const float *a, const float *b, float *c,
+                          int64_t ldc, bool accumulate) = nullptr;
+  void (*gemm_micro_bf16)(int64_t k, const float *a, const uint16_t *b,
+                          float *c, int64_t ldc, bool accumulate) = nullptr;
+
+  // one output row (batch, channel block, y) of a convolution with input
+  // and output in NCHWc8 / NCHWc16, weights from
+  // pack_conv2d_layout_weights. null if a block is not whole vectors.
+  void (*conv2d_nchwc8)(const sConv2DParams &params, const float *input,
+                        const float *weight, const float *bias,
+                        float *output, int64_t row) = nullptr;
+  void (*conv2d_nchwc16)(const sConv2DParams &params, const float *input,
+                         const float *weight, const float *bias,
+                         float *output, int64_t row) = nullptr;
+};
+
+// kernel tables, null if the ISA was not compiled into this binary
+const sSimdKernels *simd_kernels_scalar();
+const sSimdKernels *simd_kernels_neon();
+const sSimdKernels *simd_kernels_avx2();
+const sSimdKernels *simd_kernels_avx512();
+
+// best ISA that is both compiled in and supported by the CPU. the MYNN_SIMD
+// environment variable (scalar, neon, avx2, avx512) caps the choice.
+eSimdIsa detected_simd_isa();
+const sSimdKernels &simd_kernels();
@@ -0,0 +1,39 @@
+#include "simd.h"
+
+// built with AVX2 and FMA enabled, see CMakeLists.txt
+#if defined(__AVX2__)
+
+#include <algorithm>
+
+#include <immintrin.h>
+
+namespace simd_avx2 {
+
+constexpr eSimdIsa kIsa = SIMD_AVX2;
+
+struct Vec {
+  using reg = __m256;
+  static constexpr int64_t width = 8;
+  static reg set1(float value) { return _mm256_set1_ps(value); }
+  static reg load(const float *p) { return _mm256_loadu_ps(p); }
+  static reg load_bf16(const uint16_t *p) {
+    const __m128i bits = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    return _mm256_castsi256_ps(
+        _mm256_slli_epi32(_mm256_cvtepu16_epi32(bits), 16));
+  }
+  static void store(float *p, reg value) { _mm256_storeu_ps(p, value); }
+  static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+  static reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_ps(a, b, c); }
+};
+
+#include "simd_impl.h"
+
+} // namespace simd_avx2
+
+const sSimdKernels *simd_kernels_avx2() { return &simd_avx2::kKernels; }
+
+#else
+
+const sSimdKernels *simd_kernels_avx2() { return nullptr; }
+
+#endif
@@ -0,0 +1,42 @@
+#include "simd.h"
+
+// built with AVX-512F enabled, see CMakeLists.txt
+#if defined(__AVX512F__)
+
+#include <algorithm>
+
+#include <immintrin.h>
+
+namespace simd_avx512 {
+
+constexpr eSimdIsa kIsa = SIMD_AVX512;
+
+struct Vec {
+  using reg = __m512;
+  static constexpr int64_t width = 16;
+  static reg set1(float value) { return _mm512_set1_ps(value); }
+  static reg load(const float *p) { return _mm512_loadu_ps(p); }
+  static reg load_bf16(const uint16_t *p) {
+    const __m256i bits =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    // the zero-masking forms sidestep a bogus -Wmaybe-uninitialized in
+    // GCC 12's headers for the unmasked ones
+    const __m512i wide = _mm512_maskz_cvtepu16_epi32(0xffff, bits);
+    return _mm512_castsi512_ps(_mm512_maskz_slli_epi32(0xffff, wide, 16));
+  }
+  static void store(float *p, reg value) { _mm512_storeu_ps(p, value); }
+  static reg add(reg a, reg b) { return _mm512_add_ps(a, b); }
+  static reg fmadd(reg a, reg b, reg c) { return _mm512_fmadd_ps(a, b, c); }
+};
+
+#include "simd_impl.h"
+
+} // namespace simd_avx512
+
+const sSimdKernels *simd_kernels_avx512() { return &simd_avx512::kKernels; }
+
+#else
+
+const sSimdKernels *simd_kernels_avx512() { return nullptr; }
+
+#endif
@@ -0,0 +1,356 @@
+// Kernel bodies shared by the simd_<isa>.cpp files. Each of them defines a
+// Vec type for its instruction set and includes this file inside its own
+// namespace, so the instantiations of different ISAs never mix at link
+// time. Not a standalone header.
+//
+// Vec provides: reg, width, set1(float), load(const float *),
+// load_bf16(const uint16_t *), store(float *, reg), add(a, b) and
+// fmadd(a, b, c) = a * b + c.
+
+// rows of C computed together by the gemm micro kernel
+constexpr int kGemmRows = 4;
+// depth of one pass over k, so the A panel stays in L1
+constexpr int64_t kGemmDepth = 256;
+
+template <int R>
+void gemm_rows(int64_t n, int64_t k, const float *a, int64_t lda,
+               const float *b, int64_t ldb, float *c, int64_t ldc,
+               const float *bias, bool load_c) {
+  constexpr int64_t W = Vec::width;
+  auto initial = [&](int r, int64_t j) {
+    float value = bias ? bias[r] : 0.f;
+    return load_c ? value + c[r * ldc + j] : value;
+  };
+  int64_t j = 0;
+  for (; j + 2 * W <= n; j += 2 * W) {
+    typename Vec::reg acc[R][2];
+    for (int r = 0; r < R; ++r) {
+      const auto base = Vec::set1(bias ? bias[r] : 0.f);
+      acc[r][0] = base;
+      acc[r][1] = base;
+      if (load_c) {
+        acc[r][0] = Vec::add(acc[r][0], Vec::load(c + r * ldc + j));
+        acc[r][1] = Vec::add(acc[r][1], Vec::load(c + r * ldc + j + W));
+      }
+    }
+    for (int64_t l = 0; l < k; ++l) {
+      const auto b0 = Vec::load(b + l * ldb + j);
+      const auto b1 = Vec::load(b + l * ldb + j + W);
+      for (int r = 0; r < R; ++r) {
+        const auto av = Vec::set1(a[r * lda + l]);
+        acc[r][0] = Vec::fmadd(av, b0, acc[r][0]);
+        acc[r][1] = Vec::fmadd(av, b1, acc[r][1]);
+      }
+    }
+    for (int r = 0; r < R; ++r) {
+      Vec::store(c + r * ldc + j, acc[r][0]);
+      Vec::store(c + r * ldc + j + W, acc[r][1]);
+    }
+  }
+  for (; j + W <= n; j += W) {
+    typename Vec::reg acc[R];
+    for (int r = 0; r < R; ++r) {
+      acc[r] = Vec::set1(bias ? bias[r] : 0.f);
+      if (load_c) {
+        acc[r] = Vec::add(acc[r], Vec::load(c + r * ldc + j));
+      }
+    }
+    for (int64_t l = 0; l < k; ++l) {
+      const auto bv = Vec::load(b + l * ldb + j);
+      for (int r = 0; r < R; ++r) {
+        acc[r] = Vec::fmadd(Vec::set1(a[r * lda + l]), bv, acc[r]);
+      }
+    }
+    for (int r = 0; r < R; ++r) {
+      Vec::store(c + r * ldc + j, acc[r]);
+    }
+  }
+  for (; j < n; ++j) {
+    for (int r = 0; r < R; ++r) {
+      float sum = initial(r, j);
+      for (int64_t l = 0; l < k; ++l) {
+        sum += a[r * lda + l] * b[l * ldb + j];
+      }
+      c[r * ldc + j] = sum;
+    }
+  }
+}
+
+void sgemm(int64_t m, int64_t n, int64_t k, const float *a, int64_t lda,
+           const float *b, int64_t ldb, float *c, int64_t ldc,
+           const float *bias, bool accumulate) {
+  for (int64_t l0 = 0; l0 < k || l0 == 0; l0 += kGemmDepth) {
+    const int64_t depth = std::min(kGemmDepth, k - l0);
+    // bias goes in with the first pass, later passes add to C
+    const float *pass_bias = l0 == 0 ? bias : nullptr;
+    const bool load_c = accumulate || l0 > 0;
+    const float *a_pass = a + l0;
+    const float *b_pass = b + l0 * ldb;
+    int64_t i = 0;
+    for (; i + kGemmRows <= m; i += kGemmRows) {
+      const float *row_bias = pass_bias ? pass_bias + i : nullptr;
+      gemm_rows<kGemmRows>(n, depth, a_pass + i * lda, lda, b_pass, ldb,
+                           c + i * ldc, ldc, row_bias, load_c);
+    }
+    for (; i < m; ++i) {
+      const float *row_bias = pass_bias ? pass_bias + i : nullptr;
+      gemm_rows<1>(n, depth, a_pass + i * lda, lda, b_pass, ldb, c + i * ldc,
+                   ldc, row_bias, load_c);
+    }
+  }
+}
+
+void depthwise_conv2d(const sConv2DParams &p, const float *input,
+                      const float *weight, const float *bias, float *output) {
+  constexpr int64_t W = Vec::width;
+  const int64_t in_plane = p.in_height * p.in_width;
+  const int64_t out_plane = p.out_height * p.out_width;
+  const int64_t taps = p.kernel_height * p.kernel_width;
+  // output columns whose taps all fall inside the input row
+  const int64_t ox_lo = std::min(
+      p.out_width, (p.pad_left + p.stride_width - 1) / p.stride_width);
+  const int64_t last_tap = (p.kernel_width - 1) * p.dilation_width;
+  const int64_t last_start = p.in_width - 1 + p.pad_left - last_tap;
+  const int64_t ox_hi =
+      last_start < 0
+          ? ox_lo
+          : std::max(ox_lo, std::min(p.out_width,
+                                     last_start / p.stride_width + 1));
+
+  for (int64_t n = 0; n < p.batch; ++n) {
+    for (int64_t ch = 0; ch < p.out_channels; ++ch) {
+      const float *in = input + (n * p.in_channels + ch) * in_plane;
+      const float *w = weight + ch * taps;
+      float *out = output + (n * p.out_channels + ch) * out_plane;
+      const float b = bias ? bias[ch] : 0.f;
+
+      for (int64_t oy = 0; oy < p.out_height; ++oy) {
+        const int64_t iy0 = oy * p.stride_height - p.pad_top;
+        float *out_row = out + oy * p.out_width;
+        auto border = [&](int64_t ox) {
+          float sum = b;
+          const int64_t ix0 = ox * p.stride_width - p.pad_left;
+          for (int64_t ky = 0; ky < p.kernel_height; ++ky) {
+            const int64_t iy = iy0 + ky * p.dilation_height;
+            if (iy < 0 || iy >= p.in_height) {
+              continue;
+            }
+            for (int64_t kx = 0; kx < p.kernel_width; ++kx) {
+              const int64_t ix = ix0 + kx * p.dilation_width;
+              if (ix >= 0 && ix < p.in_width) {
+                sum += in[iy * p.in_width + ix] * w[ky * p.kernel_width + kx];
+              }
+            }
+          }
+          out_row[ox] = sum;
+        };
+
+        for (int64_t ox = 0; ox < ox_lo; ++ox) {
+          border(ox);
+        }
+        int64_t ox = ox_lo;
+        if (p.stride_width == 1) {
+          for (; ox + W <= ox_hi; ox += W) {
+            auto acc = Vec::set1(b);
+            for (int64_t ky = 0; ky < p.kernel_height; ++ky) {
+              const int64_t iy = iy0 + ky * p.dilation_height;
+              if (iy < 0 || iy >= p.in_height) {
+                continue;
+              }
+              const float *row = in + iy * p.in_width + ox - p.pad_left;
+              const float *wk = w + ky * p.kernel_width;
+              for (int64_t kx = 0; kx < p.kernel_width; ++kx) {
+                acc = Vec::fmadd(Vec::set1(wk[kx]),
+                                 Vec::load(row + kx * p.dilation_width), acc);
+              }
+            }
+            Vec::store(out_row + ox, acc);
+          }
+        }
+        // interior columns left over, no column bounds checks needed
+        for (; ox < ox_hi; ++ox) {
+          float sum = b;
+          const int64_t ix0 = ox * p.stride_width - p.pad_left;
+          for (int64_t ky = 0; ky < p.kernel_height; ++ky) {
+            const int64_t iy = iy0 + ky * p.dilation_height;
+            if (iy < 0 || iy >= p.in_height) {
+              continue;
+            }
+            const float *row = in + iy * p.in_width + ix0;
+            const float *wk = w + ky * p.kernel_width;
+            for (int64_t kx = 0; kx < p.kernel_width; ++kx) {
+              sum += row[kx * p.dilation_width] * wk[kx];
+            }
+          }
+          out_row[ox] = sum;
+        }
+        for (; ox < p.out_width; ++ox) {
+          border(ox);
+        }
+      }
+    }
+  }
+}
+
+// output row (batch, channel block, oy) of a convolution in the blocked
+// layout with B channels per block. weights are packed per output block as
+// (in block, ky, kx, in channel, out channel) B x B tiles, or (ky, kx, B)
+// for depthwise. taps in the padding read a block of zeros.
+template <int64_t B>
+void conv2d_nchwc_row(const sConv2DParams &p, const float *input,
+                      const float *weight, const float *bias, float *output,
+                      int64_t row) {
+  constexpr int64_t W = Vec::width;
+  constexpr int64_t V = B / W;
+  // output columns per pass: enough accumulators to hide the FMA latency
+  constexpr int64_t T = V == 1 ? 8 : 4;
+  alignas(64) static const float zeros[B] = {};
+  const bool depthwise = p.group > 1;
+  const int64_t in_blocks = (p.in_channels + B - 1) / B;
+  const int64_t out_blocks = (p.out_channels + B - 1) / B;
+  const int64_t oy = row % p.out_height;
+  const int64_t ob = row / p.out_height % out_blocks;
+  const int64_t n = row / p.out_height / out_blocks;
+  const int64_t in_plane = p.in_height * p.in_width * B;
+  const int64_t taps = p.kernel_height * p.kernel_width;
+  float *out =
+      output + ((n * out_blocks + ob) * p.out_height + oy) * p.out_width * B;
+  float block_bias[B];
+  for (int64_t c = 0; c < B; ++c) {
+    const int64_t channel = ob * B + c;
+    block_bias[c] = bias && channel < p.out_channels ? bias[channel] : 0.f;
+  }
+
+  for (int64_t ox0 = 0; ox0 < p.out_width; ox0 += T) {
+    const int64_t columns = std::min(T, p.out_width - ox0);
+    typename Vec::reg acc[T][V];
+    for (int64_t t = 0; t < T; ++t) {
+      for (int64_t v = 0; v < V; ++v) {
+        acc[t][v] = Vec::load(block_bias + v * W);
+      }
+    }
+    const int64_t first_block = depthwise ? ob : 0;
+    const int64_t last_block = depthwise ? ob + 1 : in_blocks;
+    for (int64_t ib = first_block; ib < last_block; ++ib) {
+      const float *in = input + (n * in_blocks + ib) * in_plane;
+      for (int64_t ky = 0; ky < p.kernel_height; ++ky) {
+        const int64_t iy = oy * p.stride_height - p.pad_top +
+                           ky * p.dilation_height;
+        if (iy < 0 || iy >= p.in_height) {
+          continue;
+        }
+        for (int64_t kx = 0; kx < p.kernel_width; ++kx) {
+          const float *src[T];
+          for (int64_t t = 0; t < T; ++t) {
+            const int64_t ix = (ox0 + t) * p.stride_width - p.pad_left +
+                               kx * p.dilation_width;
+            src[t] = t < columns && ix >= 0 && ix < p.in_width
+                         ? in + (iy * p.in_width + ix) * B
+                         : zeros;
+          }
+          const int64_t tap = ky * p.kernel_width + kx;
+          if (depthwise) {
+            const float *w = weight + (ob * taps + tap) * B;
+            for (int64_t v = 0; v < V; ++v) {
+              const auto wv = Vec::load(w + v * W);
+              for (int64_t t = 0; t < T; ++t) {
+                acc[t][v] = Vec::fmadd(Vec::load(src[t] + v * W), wv,
+                                       acc[t][v]);
+              }
+            }
+            continue;
+          }
+          const float *w =
+              weight + ((ob * in_blocks + ib) * taps + tap) * B * B;
+          for (int64_t ic = 0; ic < B; ++ic) {
+            typename Vec::reg wv[V];
+            for (int64_t v = 0; v < V; ++v) {
+              wv[v] = Vec::load(w + ic * B + v * W);
+            }
+            for (int64_t t = 0; t < T; ++t) {
+              const auto a = Vec::set1(src[t][ic]);
+              for (int64_t v = 0; v < V; ++v) {
+                acc[t][v] = Vec::fmadd(a, wv[v], acc[t][v]);
+              }
+            }
+          }
+        }
+      }
+    }
+    for (int64_t t = 0; t < columns; ++t) {
+      for (int64_t v = 0; v < V; ++v) {
+        Vec::store(out + (ox0 + t) * B + v * W, acc[t][v]);
+      }
+    }
+  }
+}
+
+// null where the block is not a whole number of vectors
+template <int64_t B>
+constexpr auto conv2d_nchwc_kernel()
+    -> void (*)(const sConv2DParams &, const float *, const float *,
+                const float *, float *, int64_t) {
+  if constexpr (B % Vec::width == 0) {
+    return conv2d_nchwc_row<B>;
+  } else {
+    return nullptr;
+  }
+}
+
+// rows of the packed micro kernel; with two vectors of columns this keeps
+// 12 accumulators in registers
+constexpr int kMicroRows = 6;
+
+inline typename Vec::reg load_b(const float *p) { return Vec::load(p); }
+inline typename Vec::reg load_b(const uint16_t *p) { return Vec::load_bf16(p); }
+
+template <typename T>
+void gemm_micro(int64_t k, const float *a, const T *b, float *c, int64_t ldc,
+                bool accumulate) {
+  constexpr int64_t W = Vec::width;
+  typename Vec::reg acc[kMicroRows][2];
+  for (int r = 0; r < kMicroRows; ++r) {
+    acc[r][0] = Vec::set1(0.f);
+    acc[r][1] = Vec::set1(0.f);
+  }
+  for (int64_t l = 0; l < k; ++l) {
+    const auto b0 = load_b(b);
+    const auto b1 = load_b(b + W);
+    for (int r = 0; r < kMicroRows; ++r) {
+      const auto av = Vec::set1(a[r]);
+      acc[r][0] = Vec::fmadd(av, b0, acc[r][0]);
+      acc[r][1] = Vec::fmadd(av, b1, acc[r][1]);
+    }
+    a += kMicroRows;
+    b += 2 * W;
+  }
+  for (int r = 0; r < kMicroRows; ++r) {
+    float *row = c + r * ldc;
+    if (accumulate) {
+      acc[r][0] = Vec::add(acc[r][0], Vec::load(row));
+      acc[r][1] = Vec::add(acc[r][1], Vec::load(row + W));
+    }
+    Vec::store(row, acc[r][0]);
+    Vec::store(row + W, acc[r][1]);
+  }
+}
+
+void gemm_micro_fp32(int64_t k, const float *a, const float *b, float *c,
+                     int64_t ldc, bool accumulate) {
+  gemm_micro(k, a, b, c, ldc, accumulate);
+}
+
+void gemm_micro_bf16(int64_t k, const float *a, const uint16_t *b, float *c,
+                     int64_t ldc, bool accumulate) {
+  gemm_micro(k, a, b, c, ldc, accumulate);
+}
+
+const sSimdKernels kKernels{kIsa,
+                            sgemm,
+                            depthwise_conv2d,
+                            kMicroRows,
+                            static_cast<int>(2 * Vec::width),
+                            gemm_micro_fp32,
+                            gemm_micro_bf16,
+                            conv2d_nchwc_kernel<8>(),
+                            conv2d_nchwc_kernel<16>()};
@@ -0,0 +1,37 @@
+#include "simd.h"
+
+// NEON is part of the aarch64 baseline, no extra flags needed
+#if defined(__aarch64__) || defined(_M_ARM64)
+
+#include <algorithm>
+
+#include <arm_neon.h>
+
+namespace simd_neon {
+
+constexpr eSimdIsa kIsa = SIMD_NEON;
+
+struct Vec {
+  using reg = float32x4_t;
+  static constexpr int64_t width = 4;
+  static reg set1(float value) { return vdupq_n_f32(value); }
+  static reg load(const float *p) { return vld1q_f32(p); }
+  static reg load_bf16(const uint16_t *p) {
+    return vreinterpretq_f32_u32(vshll_n_u16(vld1_u16(p), 16));
+  }
+  static void store(float *p, reg value) { vst1q_f32(p, value); }
+  static reg add(reg a, reg b) { return vaddq_f32(a, b); }
+  static reg fmadd(reg a, reg b, reg c) { return vfmaq_f32(c, a, b); }
+};
+
+#include "simd_impl.h"
+
+} // namespace simd_neon
+
+const sSimdKernels *simd_kernels_neon() { return &simd_neon::kKernels; }
+
+#else
+
+const sSimdKernels *simd_kernels_neon() { return nullptr; }
+
+#endif
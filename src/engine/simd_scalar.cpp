@@ -0,0 +1,26 @@
+#include "simd.h"
+
+#include <algorithm>
+
+#include "../model/half.h"
+
+namespace simd_scalar {
+
+constexpr eSimdIsa kIsa = SIMD_SCALAR;
+
+struct Vec {
+  using reg = float;
+  static constexpr int64_t width = 1;
+  static reg set1(float value) { return value; }
+  static reg load(const float *p) { return *p; }
+  static reg load_bf16(const uint16_t *p) { return bfloat16_to_float(*p); }
+  static void store(float *p, reg value) { *p = value; }
+  static reg add(reg a, reg b) { return a + b; }
+  static reg fmadd(reg a, reg b, reg c) { return a * b + c; }
+};
+
+#include "simd_impl.h"
+
+} // namespace simd_scalar
+
+const sSimdKernels *simd_kernels_scalar() { return &simd_scalar::kKernels; }
@@ -0,0 +1,312 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct sTask {
+  std::function<void()> run;
+  eTaskPriority priority = TASK_PRIORITY_INTERACTIVE;
+  CancellationToken token;
+  TaskGroup *group = nullptr;
+};
+
+struct sQueue {
+  std::mutex mutex;
+  std::deque<sTask> tasks[TASK_PRIORITY_COUNT];
+};
+
+// iterations of one loop participant
+struct sRange {
+  std::mutex mutex;
+  int64_t begin = 0;
+  int64_t end = 0;
+};
+
+bool pop(sRange &range, int64_t &iteration) {
+  std::lock_guard<std::mutex> lock(range.mutex);
+  if (range.begin >= range.end) {
+    return false;
+  }
+  iteration = range.begin++;
+  return true;
+}
+
+bool steal(sRange *ranges, int participants, int index) {
+  for (int offset = 1; offset < participants; ++offset) {
+    auto &victim = ranges[(index + offset) % participants];
+    int64_t begin;
+    int64_t end;
+    {
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      const int64_t left = victim.end - victim.begin;
+      if (left <= 0) {
+        continue;
+      }
+      // take the back half, the victim keeps working from the front
+      end = victim.end;
+      begin = victim.end - (left + 1) / 2;
+      victim.end = begin;
+    }
+    auto &own = ranges[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    own.begin = begin;
+    own.end = end;
+    return true;
+  }
+  return false;
+}
+
+void participate(sRange *ranges, int participants, int index,
+                 const std::function<void(int64_t)> &body) {
+  int64_t iteration;
+  while (true) {
+    while (pop(ranges[index], iteration)) {
+      body(iteration);
+    }
+    if (!steal(ranges, participants, index)) {
+      return;
+    }
+  }
+}
+
+// priority of the task running on this thread, inherited by forked tasks
+thread_local eTaskPriority t_priority = TASK_PRIORITY_INTERACTIVE;
+// pool core and queue of the current thread if it is a worker
+thread_local const void *t_core = nullptr;
+thread_local int t_queue = -1;
+
+} // namespace
+
+struct ThreadPool::sCore {
+  std::vector<std::thread> workers;
+  // one per worker, the last one takes tasks queued by other threads
+  std::vector<std::unique_ptr<sQueue>> queues;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable joined;
+  std::atomic<int64_t> queued{0};
+  bool stop = false;
+
+  explicit sCore(int worker_count);
+  ~sCore();
+  int queue_of_caller() const;
+  void push(sTask task);
+  bool take(int index, sTask &task);
+  bool take_group(const TaskGroup *group, sTask &task);
+  void execute(sTask &task);
+  void worker(int index);
+};
+
+ThreadPool::sCore::sCore(int worker_count) {
+  for (int i = 0; i <= worker_count; ++i) {
+    queues.push_back(std::make_unique<sQueue>());
+  }
+  for (int i = 0; i < worker_count; ++i) {
+    workers.emplace_back(&sCore::worker, this, i);
+  }
+}
+
+ThreadPool::sCore::~sCore() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  wake.notify_all();
+  for (auto &thread : workers) {
+    thread.join();
+  }
+}
+
+int ThreadPool::sCore::queue_of_caller() const {
+  return t_core == this ? t_queue : static_cast<int>(queues.size()) - 1;
+}
+
+void ThreadPool::sCore::push(sTask task) {
+  TaskGroup *group = task.group;
+  auto &queue = *queues[queue_of_caller()];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks[task.priority].push_back(std::move(task));
+  }
+  {
+    // counted under the mutex the sleepers check, so no wakeup is lost
+    std::lock_guard<std::mutex> lock(mutex);
+    ++queued;
+    if (group) {
+      ++group->_queued;
+    }
+  }
+  wake.notify_one();
+  if (group) {
+    joined.notify_all();
+  }
+}
+
+bool ThreadPool::sCore::take(int index, sTask &task) {
+  const int count = static_cast<int>(queues.size());
+  const bool is_worker = index < count - 1;
+  for (int priority = 0; priority < TASK_PRIORITY_COUNT; ++priority) {
+    for (int offset = 0; offset < count; ++offset) {
+      auto &queue = *queues[(index + offset) % count];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      auto &tasks = queue.tasks[priority];
+      if (tasks.empty()) {
+        continue;
+      }
+      // newest of our own, oldest of anyone else's
+      if (offset == 0 && is_worker) {
+        task = std::move(tasks.back());
+        tasks.pop_back();
+      } else {
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      --queued;
+      if (task.group) {
+        --task.group->_queued;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::sCore::take_group(const TaskGroup *group, sTask &task) {
+  if (group->_queued == 0) {
+    return false;
+  }
+  for (auto &queue : queues) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    for (auto &tasks : queue->tasks) {
+      auto it = std::find_if(tasks.rbegin(), tasks.rend(),
+                             [&](const sTask &t) { return t.group == group; });
+      if (it == tasks.rend()) {
+        continue;
+      }
+      task = std::move(*it);
+      tasks.erase(std::next(it).base());
+      --queued;
+      --task.group->_queued;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::sCore::execute(sTask &task) {
+  const eTaskPriority previous = t_priority;
+  t_priority = task.priority;
+  if (!task.token.cancelled()) {
+    task.run();
+  }
+  t_priority = previous;
+  task.run = nullptr;
+  // the group may be gone as soon as its count reaches zero
+  if (task.group && --task.group->_pending == 0) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+    }
+    joined.notify_all();
+  }
+}
+
+void ThreadPool::sCore::worker(int index) {
+  t_core = this;
+  t_queue = index;
+  sTask task;
+  while (true) {
+    if (take(index, task)) {
+      execute(task);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    wake.wait(lock, [&] { return stop || queued > 0; });
+    if (stop) {
+      return;
+    }
+  }
+}
+
+ThreadPool::ThreadPool(int threads) {
+  if (threads <= 0) {
+    threads =
+        static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  }
+  _core = std::make_shared<sCore>(std::max(threads - 1, 1));
+  _participants = threads;
+}
+
+ThreadPool::ThreadPool(const ThreadPool &pool, int participants)
+    : _core(pool._core), _participants(pool._participants) {
+  if (participants > 0) {
+    _participants = std::min(participants, pool._participants);
+  }
+}
+
+ThreadPool::~ThreadPool() = default;
+
+ThreadPool &ThreadPool::shared() {
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::enqueue(std::function<void()> run, eTaskPriority priority,
+                         const CancellationToken &token, TaskGroup *group) {
+  _core->push({std::move(run), priority, token, group});
+}
+
+void ThreadPool::parallel_for(int64_t count,
+                              const std::function<void(int64_t)> &body) {
+  if (count <= 0) {
+    return;
+  }
+  const int participants =
+      static_cast<int>(std::min<int64_t>(_participants, count));
+  if (participants <= 1) {
+    for (int64_t i = 0; i < count; ++i) {
+      body(i);
+    }
+    return;
+  }
+
+  auto ranges = std::make_unique<sRange[]>(static_cast<size_t>(participants));
+  for (int i = 0; i < participants; ++i) {
+    ranges[i].begin = count * i / participants;
+    ranges[i].end = count * (i + 1) / participants;
+  }
+  // helpers that start late find the ranges empty and return at once
+  TaskGroup group(*this);
+  for (int i = 1; i < participants; ++i) {
+    group.run([&, i] { participate(ranges.get(), participants, i, body); });
+  }
+  participate(ranges.get(), participants, 0, body);
+  group.wait();
+}
+
+TaskGroup::TaskGroup(ThreadPool &pool, const CancellationToken &token)
+    : _pool(pool), _token(token) {}
+
+void TaskGroup::run(std::function<void()> fn) {
+  ++_pending;
+  _pool.enqueue(std::move(fn), t_priority, _token, this);
+}
+
+void TaskGroup::wait() {
+  auto &core = *_pool._core;
+  sTask task;
+  while (_pending > 0) {
+    // only this group's tasks, so the join is not held up by unrelated work
+    if (core.take_group(this, task)) {
+      core.execute(task);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(core.mutex);
+    core.joined.wait(lock, [&] { return _pending == 0 || _queued > 0; });
+  }
+}
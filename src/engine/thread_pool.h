@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+// Work-stealing task scheduler shared by model loading, the panels and the
+// native engine. Every worker owns a deque per priority: it runs its own
+// tasks newest first and, once it runs dry, steals the oldest task of
+// another worker. Interactive tasks always go before background ones.
+
+enum eTaskPriority {
+  // work the user is waiting on, e.g. loading and laying out a model
+  TASK_PRIORITY_INTERACTIVE = 0,
+  // analysis passes and benchmarks started from a panel
+  TASK_PRIORITY_BACKGROUND,
+  TASK_PRIORITY_COUNT,
+};
+
+// Flag shared between a task owner and its tasks. Queued tasks are dropped
+// once it is set; running ones are not interrupted but may poll it.
+class CancellationToken {
+private:
+  std::shared_ptr<std::atomic<bool>> _cancelled =
+      std::make_shared<std::atomic<bool>>(false);
+
+public:
+  void cancel() { _cancelled->store(true); }
+  bool cancelled() const {
+    return _cancelled->load(std::memory_order_relaxed);
+  }
+};
+
+class TaskGroup;
+
+class ThreadPool {
+private:
+  struct sCore;
+  std::shared_ptr<sCore> _core;
+  // participants of a loop, including the calling thread
+  int _participants = 1;
+
+  friend class TaskGroup;
+  void enqueue(std::function<void()> run, eTaskPriority priority,
+               const CancellationToken &token, TaskGroup *group);
+
+public:
+  // `threads` loop participants: threads - 1 workers, at least one, plus
+  // the calling thread. 0 uses every hardware thread.
+  explicit ThreadPool(int threads = 0);
+  // runs on the workers of `pool` with loops capped at `participants`,
+  // 0 for the cap of `pool`
+  ThreadPool(const ThreadPool &pool, int participants);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // the process wide pool, one participant per hardware thread. the UI
+  // thread is the participant without a worker.
+  static ThreadPool &shared();
+
+  int size() const { return _participants; }
+
+  // queues fn() and returns its result. a task dropped by cancellation
+  // leaves a broken promise. waiting on the future from inside a task may
+  // starve the pool, fork a TaskGroup there instead.
+  template <typename F>
+  auto submit(eTaskPriority priority, F &&fn,
+              const CancellationToken &token = {})
+      -> std::future<std::invoke_result_t<std::decay_t<F>>>;
+
+  // runs body(i) for i in [0, count) and returns when all are done. every
+  // participant starts with an even share of the iterations and, once its
+  // share is done, steals half of the remaining range of another, so
+  // uneven iterations still balance out.
+  void parallel_for(int64_t count, const std::function<void(int64_t)> &body);
+};
+
+// Fork-join scope. run() queues tasks at the priority of the forking
+// thread; wait() helps running them and returns when all are done. Tasks
+// must not throw.
+class TaskGroup {
+private:
+  ThreadPool &_pool;
+  CancellationToken _token;
+  // forked and not finished, and forked and not started
+  std::atomic<int> _pending{0};
+  std::atomic<int> _queued{0};
+
+  friend class ThreadPool;
+
+public:
+  explicit TaskGroup(ThreadPool &pool, const CancellationToken &token = {});
+  ~TaskGroup() { wait(); }
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+  void run(std::function<void()> fn);
+  void wait();
+  // drops the tasks that have not started yet
+  void cancel() { _token.cancel(); }
+};
+
+template <typename F>
+auto ThreadPool::submit(eTaskPriority priority, F &&fn,
+                        const CancellationToken &token)
+    -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+  using Result = std::invoke_result_t<std::decay_t<F>>;
+  auto task =
+      std::make_shared<std::packaged_task<Result()>>(std::forward<F>(fn));
+  auto future = task->get_future();
+  enqueue([task] { (*task)(); }, priority, token, nullptr);
+  return future;
+}
@@ -2,10 +2,31 @@
 #include <backends/imgui_impl_sdl3.h>
 #include <backends/imgui_impl_sdlrenderer3.h>
 #include <imgui.h>
+#include <implot.h>
+#include <implot3d.h>
 #include <memory>
 
+#include "widget/cost/panel.h"
+#include "widget/dedup/panel.h"
+#include "widget/engine/panel.h"
+#include "widget/extraction/panel.h"
+#include "widget/folding/panel.h"
+#include "widget/fusion/panel.h"
+#include "widget/graph_diff/panel.h"
 #include "widget/menu/top.h"
+#include "widget/memory/panel.h"
+#include "widget/memory_plan/panel.h"
 #include "widget/model_viewer/viewer.h"
+#include "widget/optimization/panel.h"
+#include "widget/precision/panel.h"
+#include "widget/quantization/panel.h"
+#include "widget/query/panel.h"
+#include "widget/serving/panel.h"
+#include "widget/shapes/panel.h"
+#include "widget/sparsity/panel.h"
+#include "widget/startup/panel.h"
+#include "widget/tensor_inspector/panel.h"
+#include "widget/weight_stats/panel.h"
 
 #if 0
 #include <torch/torch.h>
@@ -52,6 +73,8 @@ int main() {
 
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
+  ImPlot::CreateContext();
+  ImPlot3D::CreateContext();
   ImGuiIO &io = ImGui::GetIO();
   io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
   io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
@@ -87,6 +110,25 @@ int main() {
   SDL_Event e;
 
   auto model_viewer = std::make_shared<ModelViewer>();
+  ServingPanel serving_panel;
+  TensorInspectorPanel tensor_inspector;
+  OptimizationPanel optimization_panel;
+  StartupPanel startup_panel;
+  MemoryPanel memory_panel;
+  MemoryPlanPanel memory_plan_panel;
+  CostPanel cost_panel;
+  ShapesPanel shapes_panel;
+  EnginePanel engine_panel;
+  FusionPanel fusion_panel;
+  QuantizationPanel quantization_panel;
+  GraphDiffPanel graph_diff_panel;
+  QueryPanel query_panel;
+  ExtractionPanel extraction_panel;
+  WeightStatsPanel weight_stats_panel;
+  SparsityPanel sparsity_panel;
+  ConstantFoldingPanel constant_folding_panel;
+  WeightDedupPanel weight_dedup_panel;
+  MixedPrecisionPanel mixed_precision_panel;
   TopMenuState menu_state;
   menu_state.show_demo_window = true;
 
@@ -105,6 +147,7 @@ int main() {
     ImGui_ImplSDLRenderer3_NewFrame();
     ImGui_ImplSDL3_NewFrame();
     ImGui::NewFrame();
+    model_viewer->update();
 
     ImGuiID dockspace_id = ImGui::GetID("MainDockspace");
     ImGuiViewport *viewport = ImGui::GetMainViewport();
@@ -141,6 +184,7 @@ int main() {
     if (menu_state.show_graph_viewer) {
       if (ImGui::Begin("Model Viewer", &menu_state.show_graph_viewer,
                        ImGuiWindowFlags_None)) {
+        model_viewer->set_collapse_blocks(menu_state.collapse_repeated_blocks);
         ImVec2 content_area_size = ImGui::GetWindowContentRegionMax();
         // Placeholder for future size negotiation.
         model_viewer->set_size(ImVec2{0, 0});
@@ -149,6 +193,160 @@ int main() {
       ImGui::End();
     }
 
+    if (menu_state.show_serving_simulator) {
+      if (ImGui::Begin("Serving Simulator", &menu_state.show_serving_simulator,
+                       ImGuiWindowFlags_None)) {
+        serving_panel.draw(model_viewer->inspector());
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_tensor_inspector) {
+      if (ImGui::Begin("Tensor Inspector", &menu_state.show_tensor_inspector,
+                       ImGuiWindowFlags_None)) {
+        tensor_inspector.draw(model_viewer->inspector(),
+                              model_viewer->selected_nodes());
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_optimization_levels) {
+      if (ImGui::Begin("Optimization Levels",
+                       &menu_state.show_optimization_levels,
+                       ImGuiWindowFlags_None)) {
+        optimization_panel.draw(model_viewer->inspector());
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_startup_profiler) {
+      if (ImGui::Begin("Startup Profiler", &menu_state.show_startup_profiler,
+                       ImGuiWindowFlags_None)) {
+        startup_panel.draw(model_viewer->inspector());
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_memory_profiler) {
+      if (ImGui::Begin("Memory Profiler", &menu_state.show_memory_profiler,
+                       ImGuiWindowFlags_None)) {
+        memory_panel.draw(model_viewer->inspector());
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_memory_planner) {
+      if (ImGui::Begin("Memory Planner", &menu_state.show_memory_planner,
+                       ImGuiWindowFlags_None)) {
+        memory_plan_panel.draw(*model_viewer);
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_cost_model) {
+      if (ImGui::Begin("Cost Model", &menu_state.show_cost_model,
+                       ImGuiWindowFlags_None)) {
+        cost_panel.draw(*model_viewer);
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_shapes) {
+      if (ImGui::Begin("Shapes", &menu_state.show_shapes,
+                       ImGuiWindowFlags_None)) {
+        shapes_panel.draw(*model_viewer);
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_engine) {
+      if (ImGui::Begin("Native Engine", &menu_state.show_engine,
+                       ImGuiWindowFlags_None)) {
+        engine_panel.draw(model_viewer->inspector());
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_fusion) {
+      if (ImGui::Begin("Operator Fusion", &menu_state.show_fusion,
+                       ImGuiWindowFlags_None)) {
+        fusion_panel.draw(*model_viewer);
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_quantization) {
+      if (ImGui::Begin("Quantization", &menu_state.show_quantization,
+                       ImGuiWindowFlags_None)) {
+        quantization_panel.draw(model_viewer->inspector());
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_graph_diff) {
+      if (ImGui::Begin("Graph Diff", &menu_state.show_graph_diff,
+                       ImGuiWindowFlags_None)) {
+        graph_diff_panel.draw(model_viewer->inspector());
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_query) {
+      if (ImGui::Begin("Graph Query", &menu_state.show_query,
+                       ImGuiWindowFlags_None)) {
+        query_panel.draw(*model_viewer);
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_extraction) {
+      if (ImGui::Begin("Subgraph Extraction", &menu_state.show_extraction,
+                       ImGuiWindowFlags_None)) {
+        extraction_panel.draw(*model_viewer);
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_weight_stats) {
+      if (ImGui::Begin("Weight Statistics", &menu_state.show_weight_stats,
+                       ImGuiWindowFlags_None)) {
+        weight_stats_panel.draw(*model_viewer);
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_sparsity) {
+      if (ImGui::Begin("Sparsity & Pruning", &menu_state.show_sparsity,
+                       ImGuiWindowFlags_None)) {
+        sparsity_panel.draw(*model_viewer);
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_constant_folding) {
+      if (ImGui::Begin("Constant Folding", &menu_state.show_constant_folding,
+                       ImGuiWindowFlags_None)) {
+        constant_folding_panel.draw(*model_viewer);
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_weight_dedup) {
+      if (ImGui::Begin("Weight Deduplication", &menu_state.show_weight_dedup,
+                       ImGuiWindowFlags_None)) {
+        weight_dedup_panel.draw(*model_viewer);
+      }
+      ImGui::End();
+    }
+
+    if (menu_state.show_mixed_precision) {
+      if (ImGui::Begin("Mixed Precision", &menu_state.show_mixed_precision,
+                       ImGuiWindowFlags_None)) {
+        mixed_precision_panel.draw(*model_viewer);
+      }
+      ImGui::End();
+    }
+
     if (menu_state.show_helper_window) {
       if (ImGui::Begin("Helper Window", &menu_state.show_helper_window,
                        ImGuiWindowFlags_None)) {
@@ -168,6 +366,8 @@ int main() {
 
   ImGui_ImplSDLRenderer3_Shutdown();
   ImGui_ImplSDL3_Shutdown();
+  ImPlot3D::DestroyContext();
+  ImPlot::DestroyContext();
   ImGui::DestroyContext();
   SDL_DestroyRenderer(renderer);
   SDL_DestroyWindow(window);
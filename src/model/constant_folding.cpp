@@ -0,0 +1,1330 @@
+#include "constant_folding.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <onnx/onnx_pb.h>
+
+#include "graph_utils.h"
+#include "weights.h"
+
+namespace {
+
+// largest folded tensor that may outgrow its inputs: shape operands, masks
+// and position tables, not broadcasts into activation sized tensors
+constexpr int64_t kMaxFoldedElements = int64_t(1) << 16;
+
+const std::unordered_set<std::string> kFoldableOps = {
+    "Constant", "ConstantOfShape", "Shape", "Size", "Range",
+    "Identity", "Cast", "Reshape", "Flatten", "Squeeze", "Unsqueeze",
+    "Transpose", "Concat", "Gather", "Slice", "Where",
+    "Add", "Sub", "Mul", "Div", "Pow", "Min", "Max",
+    "Equal", "Less", "Greater", "LessOrEqual", "GreaterOrEqual",
+    "And", "Or", "Xor", "Not",
+    "Neg", "Abs", "Sign", "Relu", "Sqrt", "Reciprocal", "Exp", "Log",
+    "Floor", "Ceil", "Sigmoid", "Tanh", "Erf",
+};
+
+int64_t element_count(const std::vector<int64_t> &dims) {
+  int64_t count = 1;
+  for (int64_t dim : dims) {
+    count *= dim;
+  }
+  return count;
+}
+
+// a known rank with every dim static. empty shapes are scalars or unknown,
+// which a Shape node must not fold.
+bool static_shape(const sModelTensor &tensor) {
+  return !tensor.shape.empty() &&
+         std::all_of(tensor.shape.begin(), tensor.shape.end(),
+                     [](int64_t dim) { return dim >= 0; });
+}
+
+bool foldable(const sModelGraph &graph, const sModelGraphNode &node,
+              const std::vector<char> &constant,
+              const std::vector<char> &is_output) {
+  if (!kFoldableOps.count(node.op_type) || node.output_tensors.size() != 1 ||
+      node.output_tensors[0] < 0 || is_output[node.output_tensors[0]]) {
+    return false;
+  }
+  if (node.op_type == "Shape" || node.op_type == "Size") {
+    return !node.input_tensors.empty() && node.input_tensors[0] >= 0 &&
+           static_shape(graph.tensors[node.input_tensors[0]]);
+  }
+  int64_t input_elements = 0;
+  for (int t : node.input_tensors) {
+    if (t < 0) {
+      continue;
+    }
+    if (!constant[t]) {
+      return false;
+    }
+    input_elements += element_count(graph.tensors[t].shape);
+  }
+  const auto &output = graph.tensors[node.output_tensors[0]];
+  return !static_shape(output) ||
+         element_count(output.shape) <=
+             std::max(kMaxFoldedElements, input_elements);
+}
+
+// A constant tensor. Floating point values are held as doubles, integer
+// and bool values as int64, whatever the width of the stored type.
+struct sConstant {
+  int dtype = onnx::TensorProto_DataType_UNDEFINED;
+  std::vector<int64_t> dims;
+  std::vector<double> f;
+  std::vector<int64_t> i;
+
+  bool floating() const {
+    return dtype == onnx::TensorProto_DataType_FLOAT ||
+           dtype == onnx::TensorProto_DataType_DOUBLE;
+  }
+  size_t size() const { return floating() ? f.size() : i.size(); }
+  double real(size_t k) const {
+    return floating() ? f[k] : static_cast<double>(i[k]);
+  }
+  void resize(size_t count) { floating() ? f.resize(count) : i.resize(count); }
+};
+
+bool supported_type(int dtype) {
+  switch (dtype) {
+  case onnx::TensorProto_DataType_FLOAT:
+  case onnx::TensorProto_DataType_DOUBLE:
+  case onnx::TensorProto_DataType_INT64:
+  case onnx::TensorProto_DataType_INT32:
+  case onnx::TensorProto_DataType_INT16:
+  case onnx::TensorProto_DataType_INT8:
+  case onnx::TensorProto_DataType_UINT64:
+  case onnx::TensorProto_DataType_UINT32:
+  case onnx::TensorProto_DataType_UINT16:
+  case onnx::TensorProto_DataType_UINT8:
+  case onnx::TensorProto_DataType_BOOL:
+    return true;
+  default:
+    return false;
+  }
+}
+
+template <typename T> void wrap(std::vector<int64_t> &values) {
+  for (auto &value : values) {
+    value = static_cast<T>(value);
+  }
+}
+
+// the values as the stored type holds them: float32 rounded from the
+// doubles they were computed in, integers wrapped to their width
+void narrow(sConstant &value) {
+  switch (value.dtype) {
+  case onnx::TensorProto_DataType_FLOAT:
+    for (auto &f : value.f) {
+      f = static_cast<float>(f);
+    }
+    break;
+  case onnx::TensorProto_DataType_INT32:
+    wrap<int32_t>(value.i);
+    break;
+  case onnx::TensorProto_DataType_INT16:
+    wrap<int16_t>(value.i);
+    break;
+  case onnx::TensorProto_DataType_INT8:
+    wrap<int8_t>(value.i);
+    break;
+  case onnx::TensorProto_DataType_UINT32:
+    wrap<uint32_t>(value.i);
+    break;
+  case onnx::TensorProto_DataType_UINT16:
+    wrap<uint16_t>(value.i);
+    break;
+  case onnx::TensorProto_DataType_UINT8:
+    wrap<uint8_t>(value.i);
+    break;
+  case onnx::TensorProto_DataType_BOOL:
+    for (auto &i : value.i) {
+      i = i != 0;
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+// truncated floats an integer type holds, [lo, hi)
+bool integer_bounds(int dtype, double &lo, double &hi) {
+  switch (dtype) {
+  case onnx::TensorProto_DataType_INT64:
+    lo = -0x1p63;
+    hi = 0x1p63;
+    return true;
+  case onnx::TensorProto_DataType_INT32:
+    lo = -0x1p31;
+    hi = 0x1p31;
+    return true;
+  case onnx::TensorProto_DataType_INT16:
+    lo = -0x1p15;
+    hi = 0x1p15;
+    return true;
+  case onnx::TensorProto_DataType_INT8:
+    lo = -0x1p7;
+    hi = 0x1p7;
+    return true;
+  case onnx::TensorProto_DataType_UINT64:
+    lo = 0.0;
+    hi = 0x1p64;
+    return true;
+  case onnx::TensorProto_DataType_UINT32:
+    lo = 0.0;
+    hi = 0x1p32;
+    return true;
+  case onnx::TensorProto_DataType_UINT16:
+    lo = 0.0;
+    hi = 0x1p16;
+    return true;
+  case onnx::TensorProto_DataType_UINT8:
+    lo = 0.0;
+    hi = 0x1p8;
+    return true;
+  default:
+    return false;
+  }
+}
+
+template <typename T, typename U>
+void from_raw(const std::string &raw, std::vector<U> &out) {
+  out.resize(raw.size() / sizeof(T));
+  for (size_t k = 0; k < out.size(); ++k) {
+    T value;
+    std::memcpy(&value, raw.data() + k * sizeof(T), sizeof(T));
+    out[k] = static_cast<U>(value);
+  }
+}
+
+template <typename T, typename U>
+void to_raw(const std::vector<U> &values, std::string &raw) {
+  raw.resize(values.size() * sizeof(T));
+  for (size_t k = 0; k < values.size(); ++k) {
+    const T value = static_cast<T>(values[k]);
+    std::memcpy(raw.data() + k * sizeof(T), &value, sizeof(T));
+  }
+}
+
+template <typename T, typename Field, typename U>
+void read_values(const onnx::TensorProto &tensor, const Field &field,
+                 std::vector<U> &out) {
+  if (tensor.has_raw_data()) {
+    from_raw<T>(tensor.raw_data(), out);
+  } else {
+    out.assign(field.begin(), field.end());
+  }
+}
+
+bool read_tensor(const onnx::TensorProto &tensor, sConstant &value) {
+  value = {};
+  value.dtype = tensor.data_type();
+  value.dims.assign(tensor.dims().begin(), tensor.dims().end());
+  if (tensor.data_location() == onnx::TensorProto_DataLocation_EXTERNAL) {
+    return false;
+  }
+  switch (value.dtype) {
+  case onnx::TensorProto_DataType_FLOAT:
+    read_values<float>(tensor, tensor.float_data(), value.f);
+    break;
+  case onnx::TensorProto_DataType_DOUBLE:
+    read_values<double>(tensor, tensor.double_data(), value.f);
+    break;
+  case onnx::TensorProto_DataType_INT64:
+    read_values<int64_t>(tensor, tensor.int64_data(), value.i);
+    break;
+  case onnx::TensorProto_DataType_INT32:
+    read_values<int32_t>(tensor, tensor.int32_data(), value.i);
+    break;
+  case onnx::TensorProto_DataType_INT16:
+    read_values<int16_t>(tensor, tensor.int32_data(), value.i);
+    break;
+  case onnx::TensorProto_DataType_INT8:
+    read_values<int8_t>(tensor, tensor.int32_data(), value.i);
+    break;
+  case onnx::TensorProto_DataType_UINT64:
+    read_values<uint64_t>(tensor, tensor.uint64_data(), value.i);
+    break;
+  case onnx::TensorProto_DataType_UINT32:
+    read_values<uint32_t>(tensor, tensor.uint64_data(), value.i);
+    break;
+  case onnx::TensorProto_DataType_UINT16:
+    read_values<uint16_t>(tensor, tensor.int32_data(), value.i);
+    break;
+  case onnx::TensorProto_DataType_UINT8:
+  case onnx::TensorProto_DataType_BOOL:
+    read_values<uint8_t>(tensor, tensor.int32_data(), value.i);
+    break;
+  default:
+    return false;
+  }
+  return static_cast<int64_t>(value.size()) == element_count(value.dims);
+}
+
+void write_tensor(const sConstant &value, const std::string &name,
+                  onnx::TensorProto &tensor) {
+  tensor.Clear();
+  tensor.set_name(name);
+  tensor.set_data_type(value.dtype);
+  for (int64_t dim : value.dims) {
+    tensor.add_dims(dim);
+  }
+  std::string raw;
+  switch (value.dtype) {
+  case onnx::TensorProto_DataType_FLOAT:
+    to_raw<float>(value.f, raw);
+    break;
+  case onnx::TensorProto_DataType_DOUBLE:
+    to_raw<double>(value.f, raw);
+    break;
+  case onnx::TensorProto_DataType_INT64:
+  case onnx::TensorProto_DataType_UINT64:
+    to_raw<int64_t>(value.i, raw);
+    break;
+  case onnx::TensorProto_DataType_INT32:
+  case onnx::TensorProto_DataType_UINT32:
+    to_raw<int32_t>(value.i, raw);
+    break;
+  case onnx::TensorProto_DataType_INT16:
+  case onnx::TensorProto_DataType_UINT16:
+    to_raw<int16_t>(value.i, raw);
+    break;
+  default:
+    to_raw<uint8_t>(value.i, raw);
+    break;
+  }
+  tensor.set_raw_data(std::move(raw));
+}
+
+const onnx::AttributeProto *find_attribute(const onnx::NodeProto &node,
+                                           const char *name) {
+  for (const auto &attribute : node.attribute()) {
+    if (attribute.name() == name) {
+      return &attribute;
+    }
+  }
+  return nullptr;
+}
+
+bool ints_attribute(const onnx::NodeProto &node, const char *name,
+                    std::vector<int64_t> &values) {
+  const auto *attribute = find_attribute(node, name);
+  if (!attribute) {
+    return false;
+  }
+  values.assign(attribute->ints().begin(), attribute->ints().end());
+  return true;
+}
+
+bool ints_of(const sConstant *value, std::vector<int64_t> &values) {
+  if (!value || value->floating()) {
+    return false;
+  }
+  values = value->i;
+  return true;
+}
+
+bool normalize_axis(int64_t &axis, int64_t rank) {
+  if (axis < 0) {
+    axis += rank;
+  }
+  return axis >= 0 && axis < rank;
+}
+
+std::vector<int64_t> row_major_strides(const std::vector<int64_t> &dims) {
+  std::vector<int64_t> strides(dims.size(), 1);
+  for (size_t d = dims.size(); d-- > 1;) {
+    strides[d - 1] = strides[d] * dims[d];
+  }
+  return strides;
+}
+
+// source offset of every element of a `dims` shaped output walking a
+// source at `strides` from `start`. broadcasts, transposes and slices.
+std::vector<int64_t> strided_offsets(const std::vector<int64_t> &dims,
+                                     const std::vector<int64_t> &strides,
+                                     int64_t start) {
+  std::vector<int64_t> offsets(static_cast<size_t>(element_count(dims)));
+  std::vector<int64_t> index(dims.size(), 0);
+  int64_t offset = start;
+  for (auto &out : offsets) {
+    out = offset;
+    for (size_t d = dims.size(); d-- > 0;) {
+      offset += strides[d];
+      if (++index[d] < dims[d]) {
+        break;
+      }
+      offset -= strides[d] * dims[d];
+      index[d] = 0;
+    }
+  }
+  return offsets;
+}
+
+void take(const sConstant &x, const std::vector<int64_t> &offsets,
+          sConstant &out) {
+  out.dtype = x.dtype;
+  out.resize(offsets.size());
+  for (size_t k = 0; k < offsets.size(); ++k) {
+    if (x.floating()) {
+      out.f[k] = x.f[offsets[k]];
+    } else {
+      out.i[k] = x.i[offsets[k]];
+    }
+  }
+}
+
+bool broadcast_dims(const std::vector<const sConstant *> &inputs,
+                    std::vector<int64_t> &dims) {
+  size_t rank = 0;
+  for (const auto *x : inputs) {
+    rank = std::max(rank, x->dims.size());
+  }
+  dims.assign(rank, 1);
+  for (const auto *x : inputs) {
+    const size_t skip = rank - x->dims.size();
+    for (size_t d = 0; d < x->dims.size(); ++d) {
+      int64_t &dim = dims[skip + d];
+      if (x->dims[d] != 1 && dim != 1 && x->dims[d] != dim) {
+        return false;
+      }
+      if (x->dims[d] != 1) {
+        dim = x->dims[d];
+      }
+    }
+  }
+  return true;
+}
+
+std::vector<int64_t> broadcast_offsets(const std::vector<int64_t> &dims,
+                                       const sConstant &x) {
+  std::vector<int64_t> strides(dims.size(), 0);
+  const auto own = row_major_strides(x.dims);
+  const size_t skip = dims.size() - x.dims.size();
+  for (size_t d = 0; d < x.dims.size(); ++d) {
+    strides[skip + d] = x.dims[d] == 1 ? 0 : own[d];
+  }
+  return strided_offsets(dims, strides, 0);
+}
+
+bool unary(const std::string &op, const sConstant &x, sConstant &out) {
+  out.dtype = x.dtype;
+  out.dims = x.dims;
+  out.resize(x.size());
+  if (op == "Not") {
+    if (x.dtype != onnx::TensorProto_DataType_BOOL) {
+      return false;
+    }
+    for (size_t k = 0; k < x.i.size(); ++k) {
+      out.i[k] = x.i[k] == 0;
+    }
+    return true;
+  }
+  if (!x.floating()) {
+    int64_t (*fn)(int64_t) = nullptr;
+    if (op == "Neg") {
+      fn = [](int64_t v) { return -v; };
+    } else if (op == "Abs") {
+      fn = [](int64_t v) { return v < 0 ? -v : v; };
+    } else if (op == "Sign") {
+      fn = [](int64_t v) { return int64_t((v > 0) - (v < 0)); };
+    } else if (op == "Relu") {
+      fn = [](int64_t v) { return std::max<int64_t>(v, 0); };
+    } else {
+      return false;
+    }
+    std::transform(x.i.begin(), x.i.end(), out.i.begin(), fn);
+    narrow(out);
+    return true;
+  }
+  double (*fn)(double) = nullptr;
+  if (op == "Neg") {
+    fn = [](double v) { return -v; };
+  } else if (op == "Abs") {
+    fn = [](double v) { return std::fabs(v); };
+  } else if (op == "Sign") {
+    fn = [](double v) { return double((v > 0) - (v < 0)); };
+  } else if (op == "Relu") {
+    fn = [](double v) { return std::max(v, 0.0); };
+  } else if (op == "Sqrt") {
+    fn = [](double v) { return std::sqrt(v); };
+  } else if (op == "Reciprocal") {
+    fn = [](double v) { return 1.0 / v; };
+  } else if (op == "Exp") {
+    fn = [](double v) { return std::exp(v); };
+  } else if (op == "Log") {
+    fn = [](double v) { return std::log(v); };
+  } else if (op == "Floor") {
+    fn = [](double v) { return std::floor(v); };
+  } else if (op == "Ceil") {
+    fn = [](double v) { return std::ceil(v); };
+  } else if (op == "Sigmoid") {
+    fn = [](double v) { return 1.0 / (1.0 + std::exp(-v)); };
+  } else if (op == "Tanh") {
+    fn = [](double v) { return std::tanh(v); };
+  } else if (op == "Erf") {
+    fn = [](double v) { return std::erf(v); };
+  } else {
+    return false;
+  }
+  std::transform(x.f.begin(), x.f.end(), out.f.begin(), fn);
+  narrow(out);
+  return true;
+}
+
+bool is_comparison(const std::string &op) {
+  return op == "Equal" || op == "Less" || op == "Greater" ||
+         op == "LessOrEqual" || op == "GreaterOrEqual";
+}
+
+template <typename T> bool compare(const std::string &op, T a, T b) {
+  if (op == "Equal") {
+    return a == b;
+  }
+  if (op == "Less") {
+    return a < b;
+  }
+  if (op == "Greater") {
+    return a > b;
+  }
+  if (op == "LessOrEqual") {
+    return a <= b;
+  }
+  return a >= b;
+}
+
+bool arithmetic(const std::string &op, double a, double b, double &out) {
+  if (op == "Add") {
+    out = a + b;
+  } else if (op == "Sub") {
+    out = a - b;
+  } else if (op == "Mul") {
+    out = a * b;
+  } else if (op == "Div") {
+    out = a / b;
+  } else if (op == "Pow") {
+    out = std::pow(a, b);
+  } else if (op == "Min") {
+    out = std::min(a, b);
+  } else if (op == "Max") {
+    out = std::max(a, b);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// integer division truncates like onnxruntime; dividing by zero refuses.
+// sums and products wrap at 64 bits, binary() wraps them to the type.
+bool arithmetic(const std::string &op, int64_t a, int64_t b, int64_t &out) {
+  const auto ua = static_cast<uint64_t>(a);
+  const auto ub = static_cast<uint64_t>(b);
+  if (op == "Add") {
+    out = static_cast<int64_t>(ua + ub);
+  } else if (op == "Sub") {
+    out = static_cast<int64_t>(ua - ub);
+  } else if (op == "Mul") {
+    out = static_cast<int64_t>(ua * ub);
+  } else if (op == "Div") {
+    if (b == 0 || (a == std::numeric_limits<int64_t>::min() && b == -1)) {
+      return false;
+    }
+    out = a / b;
+  } else if (op == "Pow") {
+    const double power = std::pow(static_cast<double>(a), b);
+    if (!(power >= -0x1p63 && power < 0x1p63)) {
+      return false;
+    }
+    out = static_cast<int64_t>(power);
+  } else if (op == "Min") {
+    out = std::min(a, b);
+  } else if (op == "Max") {
+    out = std::max(a, b);
+  } else if (op == "And") {
+    out = a != 0 && b != 0;
+  } else if (op == "Or") {
+    out = a != 0 || b != 0;
+  } else if (op == "Xor") {
+    out = (a != 0) != (b != 0);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool binary(const std::string &op, const sConstant &a, const sConstant &b,
+            sConstant &out) {
+  if (!broadcast_dims({&a, &b}, out.dims)) {
+    return false;
+  }
+  const auto oa = broadcast_offsets(out.dims, a);
+  const auto ob = broadcast_offsets(out.dims, b);
+  const bool floating = a.floating() || b.floating();
+  if (is_comparison(op)) {
+    out.dtype = onnx::TensorProto_DataType_BOOL;
+    out.i.resize(oa.size());
+    for (size_t k = 0; k < oa.size(); ++k) {
+      out.i[k] = floating ? compare(op, a.real(oa[k]), b.real(ob[k]))
+                          : compare(op, a.i[oa[k]], b.i[ob[k]]);
+    }
+    return true;
+  }
+  out.dtype = a.dtype;
+  out.resize(oa.size());
+  for (size_t k = 0; k < oa.size(); ++k) {
+    const bool ok = floating ? arithmetic(op, a.real(oa[k]), b.real(ob[k]),
+                                          out.f[k])
+                             : arithmetic(op, a.i[oa[k]], b.i[ob[k]],
+                                          out.i[k]);
+    if (!ok) {
+      return false;
+    }
+  }
+  narrow(out);
+  return true;
+}
+
+bool where(const sConstant &condition, const sConstant &x,
+           const sConstant &y, sConstant &out) {
+  if (condition.floating() || x.dtype != y.dtype ||
+      !broadcast_dims({&condition, &x, &y}, out.dims)) {
+    return false;
+  }
+  const auto oc = broadcast_offsets(out.dims, condition);
+  const auto ox = broadcast_offsets(out.dims, x);
+  const auto oy = broadcast_offsets(out.dims, y);
+  out.dtype = x.dtype;
+  out.resize(oc.size());
+  for (size_t k = 0; k < oc.size(); ++k) {
+    const bool pick_x = condition.i[oc[k]] != 0;
+    if (x.floating()) {
+      out.f[k] = pick_x ? x.f[ox[k]] : y.f[oy[k]];
+    } else {
+      out.i[k] = pick_x ? x.i[ox[k]] : y.i[oy[k]];
+    }
+  }
+  narrow(out);
+  return true;
+}
+
+// NaN and floats out of range of the integer type are undefined to cast,
+// so they refuse
+bool cast(const sConstant &x, int to, sConstant &out) {
+  if (!supported_type(to)) {
+    return false;
+  }
+  double lo = 0.0;
+  double hi = 0.0;
+  const bool bounded = integer_bounds(to, lo, hi);
+  out.dtype = to;
+  out.dims = x.dims;
+  out.resize(x.size());
+  for (size_t k = 0; k < x.size(); ++k) {
+    if (out.floating()) {
+      out.f[k] = x.real(k);
+    } else if (to == onnx::TensorProto_DataType_BOOL) {
+      out.i[k] = x.real(k) != 0.0;
+    } else if (!x.floating()) {
+      out.i[k] = x.i[k];
+    } else {
+      const double value = std::trunc(x.f[k]);
+      if (!bounded || !(value >= lo && value < hi)) {
+        return false;
+      }
+      out.i[k] = to == onnx::TensorProto_DataType_UINT64
+                     ? static_cast<int64_t>(static_cast<uint64_t>(value))
+                     : static_cast<int64_t>(value);
+    }
+  }
+  narrow(out);
+  return true;
+}
+
+bool reshape(const sConstant &x, std::vector<int64_t> shape, bool allow_zero,
+             sConstant &out) {
+  const int64_t total = static_cast<int64_t>(x.size());
+  int inferred = -1;
+  int64_t known = 1;
+  for (size_t d = 0; d < shape.size(); ++d) {
+    if (shape[d] == 0 && !allow_zero) {
+      if (d >= x.dims.size()) {
+        return false;
+      }
+      shape[d] = x.dims[d];
+    }
+    if (shape[d] == -1) {
+      if (inferred >= 0) {
+        return false;
+      }
+      inferred = static_cast<int>(d);
+    } else if (shape[d] < 0) {
+      return false;
+    } else {
+      known *= shape[d];
+    }
+  }
+  if (inferred >= 0) {
+    if (known == 0 || total % known != 0) {
+      return false;
+    }
+    shape[inferred] = total / known;
+  }
+  if (element_count(shape) != total) {
+    return false;
+  }
+  out = x;
+  out.dims = std::move(shape);
+  return true;
+}
+
+bool squeeze(const sConstant &x, std::vector<int64_t> axes, bool have_axes,
+             sConstant &out) {
+  const int64_t rank = static_cast<int64_t>(x.dims.size());
+  std::vector<char> drop(x.dims.size(), 0);
+  for (int64_t &axis : axes) {
+    if (!normalize_axis(axis, rank) || x.dims[axis] != 1) {
+      return false;
+    }
+    drop[axis] = 1;
+  }
+  out = x;
+  out.dims.clear();
+  for (size_t d = 0; d < x.dims.size(); ++d) {
+    if (!(have_axes ? drop[d] : x.dims[d] == 1)) {
+      out.dims.push_back(x.dims[d]);
+    }
+  }
+  return true;
+}
+
+bool unsqueeze(const sConstant &x, std::vector<int64_t> axes,
+               sConstant &out) {
+  const int64_t rank = static_cast<int64_t>(x.dims.size() + axes.size());
+  std::vector<char> inserted(static_cast<size_t>(rank), 0);
+  for (int64_t &axis : axes) {
+    if (!normalize_axis(axis, rank) || inserted[axis]) {
+      return false;
+    }
+    inserted[axis] = 1;
+  }
+  out = x;
+  out.dims.clear();
+  size_t next = 0;
+  for (int64_t d = 0; d < rank; ++d) {
+    out.dims.push_back(inserted[d] ? 1 : x.dims[next++]);
+  }
+  return true;
+}
+
+bool transpose(const sConstant &x, std::vector<int64_t> perm,
+               sConstant &out) {
+  const size_t rank = x.dims.size();
+  if (perm.empty()) {
+    for (size_t d = rank; d-- > 0;) {
+      perm.push_back(static_cast<int64_t>(d));
+    }
+  }
+  if (perm.size() != rank) {
+    return false;
+  }
+  const auto own = row_major_strides(x.dims);
+  std::vector<int64_t> dims(rank);
+  std::vector<int64_t> strides(rank);
+  for (size_t d = 0; d < rank; ++d) {
+    if (perm[d] < 0 || perm[d] >= static_cast<int64_t>(rank)) {
+      return false;
+    }
+    dims[d] = x.dims[perm[d]];
+    strides[d] = own[perm[d]];
+  }
+  take(x, strided_offsets(dims, strides, 0), out);
+  out.dims = std::move(dims);
+  return true;
+}
+
+bool concat(const std::vector<const sConstant *> &inputs, int64_t axis,
+            sConstant &out) {
+  const auto &first = *inputs[0];
+  const int64_t rank = static_cast<int64_t>(first.dims.size());
+  if (!normalize_axis(axis, rank)) {
+    return false;
+  }
+  out.dtype = first.dtype;
+  out.dims = first.dims;
+  out.dims[axis] = 0;
+  for (const auto *x : inputs) {
+    if (x->dtype != first.dtype || x->dims.size() != first.dims.size()) {
+      return false;
+    }
+    for (int64_t d = 0; d < rank; ++d) {
+      if (d != axis && x->dims[d] != first.dims[d]) {
+        return false;
+      }
+    }
+    out.dims[axis] += x->dims[axis];
+  }
+  const int64_t outer = element_count(
+      std::vector<int64_t>(first.dims.begin(), first.dims.begin() + axis));
+  for (int64_t o = 0; o < outer; ++o) {
+    for (const auto *x : inputs) {
+      const size_t block = x->size() / static_cast<size_t>(outer);
+      if (x->floating()) {
+        out.f.insert(out.f.end(), x->f.begin() + o * block,
+                     x->f.begin() + (o + 1) * block);
+      } else {
+        out.i.insert(out.i.end(), x->i.begin() + o * block,
+                     x->i.begin() + (o + 1) * block);
+      }
+    }
+  }
+  return true;
+}
+
+bool gather(const sConstant &x, const sConstant &indices, int64_t axis,
+            sConstant &out) {
+  const int64_t rank = static_cast<int64_t>(x.dims.size());
+  if (indices.floating() || !normalize_axis(axis, rank)) {
+    return false;
+  }
+  const int64_t extent = x.dims[axis];
+  const int64_t outer = element_count(
+      std::vector<int64_t>(x.dims.begin(), x.dims.begin() + axis));
+  const int64_t inner = element_count(
+      std::vector<int64_t>(x.dims.begin() + axis + 1, x.dims.end()));
+  out.dtype = x.dtype;
+  out.dims.assign(x.dims.begin(), x.dims.begin() + axis);
+  out.dims.insert(out.dims.end(), indices.dims.begin(), indices.dims.end());
+  out.dims.insert(out.dims.end(), x.dims.begin() + axis + 1, x.dims.end());
+  std::vector<int64_t> offsets;
+  offsets.reserve(static_cast<size_t>(element_count(out.dims)));
+  for (int64_t o = 0; o < outer; ++o) {
+    for (int64_t index : indices.i) {
+      if (index < 0) {
+        index += extent;
+      }
+      if (index < 0 || index >= extent) {
+        return false;
+      }
+      for (int64_t k = 0; k < inner; ++k) {
+        offsets.push_back((o * extent + index) * inner + k);
+      }
+    }
+  }
+  take(x, offsets, out);
+  return true;
+}
+
+bool slice(const sConstant &x, const std::vector<int64_t> &starts,
+           const std::vector<int64_t> &ends, std::vector<int64_t> axes,
+           std::vector<int64_t> steps, sConstant &out) {
+  const int64_t rank = static_cast<int64_t>(x.dims.size());
+  if (axes.empty()) {
+    for (size_t a = 0; a < starts.size(); ++a) {
+      axes.push_back(static_cast<int64_t>(a));
+    }
+  }
+  steps.resize(starts.size(), 1);
+  if (ends.size() != starts.size() || axes.size() != starts.size()) {
+    return false;
+  }
+  const auto own = row_major_strides(x.dims);
+  std::vector<int64_t> dims = x.dims;
+  std::vector<int64_t> strides = own;
+  int64_t start_offset = 0;
+  for (size_t a = 0; a < axes.size(); ++a) {
+    int64_t axis = axes[a];
+    const int64_t step = steps[a];
+    if (!normalize_axis(axis, rank) || step == 0) {
+      return false;
+    }
+    const int64_t dim = x.dims[axis];
+    // clamp before adding dim: ends like INT64_MIN would overflow
+    int64_t start = starts[a];
+    int64_t end = ends[a];
+    if (start < 0) {
+      start = std::max(start, -dim) + dim;
+    }
+    if (end < 0) {
+      end = std::max(end, -dim - 1) + dim;
+    }
+    int64_t count = 0;
+    if (step > 0) {
+      start = std::clamp<int64_t>(start, 0, dim);
+      end = std::clamp<int64_t>(end, 0, dim);
+      count = std::max<int64_t>(0, (end - start + step - 1) / step);
+    } else {
+      start = std::clamp<int64_t>(start, 0, dim - 1);
+      end = std::clamp<int64_t>(end, -1, dim - 1);
+      count = std::max<int64_t>(0, (start - end - step - 1) / -step);
+    }
+    dims[axis] = count;
+    strides[axis] = own[axis] * step;
+    start_offset += start * own[axis];
+  }
+  take(x, strided_offsets(dims, strides, start_offset), out);
+  out.dims = std::move(dims);
+  return true;
+}
+
+bool range(const sConstant &start, const sConstant &limit,
+           const sConstant &delta, sConstant &out) {
+  if (start.size() != 1 || limit.size() != 1 || delta.size() != 1 ||
+      delta.real(0) == 0.0) {
+    return false;
+  }
+  const double count = std::ceil((limit.real(0) - start.real(0)) /
+                                 delta.real(0));
+  if (count > static_cast<double>(kMaxFoldedElements)) {
+    return false;
+  }
+  out.dtype = start.dtype;
+  out.dims = {std::max<int64_t>(0, static_cast<int64_t>(count))};
+  out.resize(static_cast<size_t>(out.dims[0]));
+  for (size_t k = 0; k < out.size(); ++k) {
+    if (out.floating()) {
+      out.f[k] = start.f[0] + static_cast<double>(k) * delta.f[0];
+    } else {
+      out.i[k] = start.i[0] + static_cast<int64_t>(k) * delta.i[0];
+    }
+  }
+  narrow(out);
+  return true;
+}
+
+bool constant(const onnx::NodeProto &node, sConstant &out) {
+  out = {};
+  for (const auto &attribute : node.attribute()) {
+    if (attribute.name() == "value" && attribute.has_t()) {
+      return read_tensor(attribute.t(), out);
+    }
+    if (attribute.name() == "value_float" ||
+        attribute.name() == "value_floats") {
+      out.dtype = onnx::TensorProto_DataType_FLOAT;
+      if (attribute.name() == "value_float") {
+        out.f = {attribute.f()};
+      } else {
+        out.f.assign(attribute.floats().begin(), attribute.floats().end());
+        out.dims = {attribute.floats_size()};
+      }
+      return true;
+    }
+    if (attribute.name() == "value_int" || attribute.name() == "value_ints") {
+      out.dtype = onnx::TensorProto_DataType_INT64;
+      if (attribute.name() == "value_int") {
+        out.i = {attribute.i()};
+      } else {
+        out.i.assign(attribute.ints().begin(), attribute.ints().end());
+        out.dims = {attribute.ints_size()};
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+// Evaluates foldable nodes from the model's initializers and the outputs
+// of nodes it folded before, loading initializers on first use.
+class ConstantEvaluator {
+private:
+  const sModelGraph &_graph;
+  const onnx::GraphProto &_proto;
+  std::unordered_map<std::string, const onnx::TensorProto *> _initializers;
+  // by tensor index
+  std::vector<sConstant> _values;
+  std::vector<char> _known;
+
+  const sConstant *input(const sModelGraphNode &node, size_t i) {
+    if (i >= node.input_tensors.size() || node.input_tensors[i] < 0) {
+      return nullptr;
+    }
+    const int t = node.input_tensors[i];
+    if (!_known[t] && _graph.tensors[t].is_initializer) {
+      auto it = _initializers.find(_graph.tensors[t].name);
+      _known[t] = it != _initializers.end() &&
+                  read_tensor(*it->second, _values[t]);
+    }
+    return _known[t] ? &_values[t] : nullptr;
+  }
+
+  bool run(const sModelGraphNode &node, const onnx::NodeProto &proto,
+           const std::vector<const sConstant *> &in, sConstant &out) {
+    const auto &op = node.op_type;
+    const size_t arity = in.size();
+    std::vector<int64_t> ints;
+    if (op == "Constant") {
+      return constant(proto, out);
+    }
+    if (op == "Shape" || op == "Size") {
+      const auto &shape = _graph.tensors[node.input_tensors[0]].shape;
+      const int64_t rank = static_cast<int64_t>(shape.size());
+      out.dtype = onnx::TensorProto_DataType_INT64;
+      if (op == "Size") {
+        out.i = {element_count(shape)};
+        return true;
+      }
+      int64_t start = int_attribute(proto, "start", 0);
+      int64_t end = int_attribute(proto, "end", rank);
+      start = std::clamp<int64_t>(start < 0 ? start + rank : start, 0, rank);
+      end = std::clamp<int64_t>(end < 0 ? end + rank : end, 0, rank);
+      out.i.assign(shape.begin() + start,
+                   shape.begin() + std::max(start, end));
+      out.dims = {static_cast<int64_t>(out.i.size())};
+      return true;
+    }
+    if (op == "ConstantOfShape") {
+      if (!ints_of(in[0], out.dims) ||
+          element_count(out.dims) > kMaxFoldedElements) {
+        return false;
+      }
+      sConstant value;
+      value.dtype = onnx::TensorProto_DataType_FLOAT;
+      value.f = {0.0};
+      if (const auto *attribute = find_attribute(proto, "value")) {
+        if (!read_tensor(attribute->t(), value) || value.size() != 1) {
+          return false;
+        }
+      }
+      out.dtype = value.dtype;
+      if (value.floating()) {
+        out.f.assign(static_cast<size_t>(element_count(out.dims)), value.f[0]);
+      } else {
+        out.i.assign(static_cast<size_t>(element_count(out.dims)), value.i[0]);
+      }
+      return true;
+    }
+    if (arity == 0 || !in[0]) {
+      return false;
+    }
+    const auto &x = *in[0];
+    if (op == "Identity") {
+      out = x;
+      return true;
+    }
+    if (op == "Cast") {
+      return cast(x, static_cast<int>(int_attribute(proto, "to", 0)), out);
+    }
+    if (op == "Reshape") {
+      if (!(arity > 1 ? ints_of(in[1], ints)
+                      : ints_attribute(proto, "shape", ints))) {
+        return false;
+      }
+      return reshape(x, ints, int_attribute(proto, "allowzero", 0) != 0, out);
+    }
+    if (op == "Flatten") {
+      int64_t axis = int_attribute(proto, "axis", 1);
+      const int64_t rank = static_cast<int64_t>(x.dims.size());
+      if (axis < 0) {
+        axis += rank;
+      }
+      if (axis < 0 || axis > rank) {
+        return false;
+      }
+      out = x;
+      out.dims = {element_count(std::vector<int64_t>(
+                      x.dims.begin(), x.dims.begin() + axis)),
+                  element_count(std::vector<int64_t>(
+                      x.dims.begin() + axis, x.dims.end()))};
+      return true;
+    }
+    if (op == "Squeeze") {
+      const bool have_axes = arity > 1 ? ints_of(in[1], ints)
+                                       : ints_attribute(proto, "axes", ints);
+      return squeeze(x, ints, have_axes, out);
+    }
+    if (op == "Unsqueeze") {
+      if (!(arity > 1 ? ints_of(in[1], ints)
+                      : ints_attribute(proto, "axes", ints))) {
+        return false;
+      }
+      return unsqueeze(x, ints, out);
+    }
+    if (op == "Transpose") {
+      ints_attribute(proto, "perm", ints);
+      return transpose(x, ints, out);
+    }
+    if (op == "Concat") {
+      std::vector<const sConstant *> inputs;
+      for (const auto *value : in) {
+        if (value) {
+          inputs.push_back(value);
+        }
+      }
+      return concat(inputs, int_attribute(proto, "axis", 0), out);
+    }
+    if (op == "Gather") {
+      return arity > 1 && in[1] &&
+             gather(x, *in[1], int_attribute(proto, "axis", 0), out);
+    }
+    if (op == "Slice") {
+      std::vector<int64_t> starts;
+      std::vector<int64_t> ends;
+      std::vector<int64_t> axes;
+      std::vector<int64_t> steps;
+      if (arity > 2) {
+        if (!ints_of(in[1], starts) || !ints_of(in[2], ends)) {
+          return false;
+        }
+        if (arity > 3 && in[3]) {
+          ints_of(in[3], axes);
+        }
+        if (arity > 4 && in[4]) {
+          ints_of(in[4], steps);
+        }
+      } else if (!ints_attribute(proto, "starts", starts) ||
+                 !ints_attribute(proto, "ends", ends)) {
+        return false;
+      } else {
+        ints_attribute(proto, "axes", axes);
+      }
+      return slice(x, starts, ends, axes, steps, out);
+    }
+    if (op == "Range") {
+      return arity == 3 && in[1] && in[2] && range(x, *in[1], *in[2], out);
+    }
+    if (op == "Where") {
+      return arity == 3 && in[1] && in[2] && where(x, *in[1], *in[2], out);
+    }
+    if (arity == 1) {
+      return unary(op, x, out);
+    }
+    return arity == 2 && in[1] && binary(op, x, *in[1], out);
+  }
+
+public:
+  ConstantEvaluator(const sModelGraph &graph, const onnx::GraphProto &proto)
+      : _graph(graph), _proto(proto), _values(graph.tensors.size()),
+        _known(graph.tensors.size(), 0) {
+    for (const auto &tensor : proto.initializer()) {
+      _initializers.emplace(tensor.name(), &tensor);
+    }
+  }
+
+  bool evaluate(int node_index) {
+    const auto &node = _graph.nodes[node_index];
+    const bool shape_only = node.op_type == "Shape" || node.op_type == "Size";
+    std::vector<const sConstant *> in(node.input_tensors.size(), nullptr);
+    int64_t input_elements = 0;
+    for (size_t i = 0; i < in.size() && !shape_only; ++i) {
+      if (node.input_tensors[i] < 0) {
+        continue;
+      }
+      in[i] = input(node, i);
+      if (!in[i]) {
+        return false;
+      }
+      input_elements += static_cast<int64_t>(in[i]->size());
+    }
+    sConstant out;
+    if (!run(node, _proto.node(node_index), in, out) ||
+        !supported_type(out.dtype) ||
+        static_cast<int64_t>(out.size()) != element_count(out.dims) ||
+        static_cast<int64_t>(out.size()) >
+            std::max(kMaxFoldedElements, input_elements)) {
+      return false;
+    }
+    const int t = node.output_tensors[0];
+    _values[t] = std::move(out);
+    _known[t] = 1;
+    return true;
+  }
+
+  const sConstant &value(int tensor) const { return _values[tensor]; }
+};
+
+template <typename T, typename Keep>
+void keep_if(google::protobuf::RepeatedPtrField<T> &field, Keep keep) {
+  google::protobuf::RepeatedPtrField<T> kept;
+  for (int k = 0; k < field.size(); ++k) {
+    if (keep(k, field.Get(k))) {
+      kept.Add()->Swap(field.Mutable(k));
+    }
+  }
+  field.Swap(&kept);
+}
+
+} // namespace
+
+sFoldingPlan
+plan_constant_folding(const sModelGraph &graph,
+                      const std::vector<int> &implicit_uses,
+                      const std::function<bool(int node)> &evaluate) {
+  const auto started = std::chrono::steady_clock::now();
+  const size_t tensor_count = graph.tensors.size();
+  sFoldingPlan plan;
+  plan.fates.assign(graph.nodes.size(), NODE_DEAD);
+  const auto order = topological_order(graph);
+
+  // live nodes reach a graph output or a subgraph read, whatever folds
+  std::vector<char> is_output(tensor_count, 0);
+  std::vector<char> needed(tensor_count, 0);
+  for (int t : graph.output_tensors) {
+    is_output[t] = 1;
+    needed[t] = 1;
+  }
+  for (int t : implicit_uses) {
+    needed[t] = 1;
+  }
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    const auto &node = graph.nodes[*it];
+    if (std::none_of(node.output_tensors.begin(), node.output_tensors.end(),
+                     [&](int t) { return t >= 0 && needed[t]; })) {
+      continue;
+    }
+    plan.fates[*it] = NODE_KEPT;
+    for (int t : node.input_tensors) {
+      if (t >= 0) {
+        needed[t] = 1;
+      }
+    }
+  }
+
+  // initializers listed as graph inputs can be overridden at run time
+  std::vector<char> constant(tensor_count, 0);
+  for (size_t t = 0; t < tensor_count; ++t) {
+    constant[t] = graph.tensors[t].is_initializer;
+  }
+  for (int t : graph.input_tensors) {
+    constant[t] = 0;
+  }
+  for (int n : order) {
+    const auto &node = graph.nodes[n];
+    if (plan.fates[n] != NODE_KEPT ||
+        !foldable(graph, node, constant, is_output) ||
+        (evaluate && !evaluate(n))) {
+      continue;
+    }
+    plan.fates[n] = NODE_FOLDED;
+    constant[node.output_tensors[0]] = 1;
+  }
+
+  std::vector<char> kept_use(tensor_count, 0);
+  for (int t : implicit_uses) {
+    kept_use[t] = 1;
+  }
+  for (size_t n = 0; n < graph.nodes.size(); ++n) {
+    if (plan.fates[n] != NODE_KEPT) {
+      continue;
+    }
+    for (int t : graph.nodes[n].input_tensors) {
+      if (t >= 0) {
+        kept_use[t] = 1;
+      }
+    }
+  }
+  for (size_t n = 0; n < graph.nodes.size(); ++n) {
+    if (plan.fates[n] == NODE_DEAD) {
+      ++plan.dead_nodes;
+    } else if (plan.fates[n] == NODE_FOLDED) {
+      ++plan.folded_nodes;
+      const int t = graph.nodes[n].output_tensors[0];
+      if (kept_use[t]) {
+        plan.materialized.push_back(t);
+      }
+    }
+  }
+  std::vector<char> overridable(tensor_count, 0);
+  for (int t : graph.input_tensors) {
+    overridable[t] = 1;
+  }
+  for (size_t t = 0; t < tensor_count; ++t) {
+    if (graph.tensors[t].is_initializer && !kept_use[t] && !is_output[t] &&
+        !overridable[t]) {
+      plan.unused_initializers.push_back(static_cast<int>(t));
+    }
+  }
+  plan.elapsed_ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - started)
+                        .count();
+  return plan;
+}
+
+sFoldingResult fold_constants(const std::string &model_path,
+                              const sModelGraph &graph,
+                              const std::string &output_path) {
+  const auto started = std::chrono::steady_clock::now();
+  sFoldingResult result;
+  onnx::ModelProto model;
+  if (!load_model_proto(model_path, model, result.error)) {
+    return result;
+  }
+  auto &graph_proto = *model.mutable_graph();
+  // with an output missing from the graph, everything feeding it is dead
+  if (graph_proto.node_size() != static_cast<int>(graph.nodes.size()) ||
+      graph_proto.output_size() !=
+          static_cast<int>(graph.output_tensors.size())) {
+    result.error = "the graph does not match " + model_path;
+    return result;
+  }
+
+  const auto implicit_uses = subgraph_inputs(graph_proto, graph);
+
+  ConstantEvaluator evaluator(graph, graph_proto);
+  const auto plan = plan_constant_folding(
+      graph, implicit_uses, [&](int node) { return evaluator.evaluate(node); });
+
+  // outputs of removed nodes lose their value_info
+  std::unordered_set<std::string> removed;
+  for (size_t n = 0; n < graph.nodes.size(); ++n) {
+    if (plan.fates[n] != NODE_KEPT) {
+      const auto &node = graph_proto.node(static_cast<int>(n));
+      removed.insert(node.output().begin(), node.output().end());
+    }
+  }
+  std::unordered_set<std::string> unused;
+  for (int t : plan.unused_initializers) {
+    unused.insert(graph.tensors[t].name);
+  }
+  keep_if(*graph_proto.mutable_node(), [&](int n, const onnx::NodeProto &) {
+    return plan.fates[n] == NODE_KEPT;
+  });
+  keep_if(*graph_proto.mutable_initializer(),
+          [&](int, const onnx::TensorProto &tensor) {
+            return !unused.count(tensor.name());
+          });
+  keep_if(*graph_proto.mutable_value_info(),
+          [&](int, const onnx::ValueInfoProto &info) {
+            return !removed.count(info.name());
+          });
+  for (int t : plan.materialized) {
+    write_tensor(evaluator.value(t), graph.tensors[t].name,
+                 *graph_proto.add_initializer());
+  }
+
+  result.output_path = output_path;
+  if (result.output_path.empty()) {
+    result.output_path = std::filesystem::path(model_path)
+                             .replace_extension(".folded.onnx")
+                             .string();
+  }
+  {
+    std::ofstream output(result.output_path,
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!output.is_open() || !model.SerializeToOstream(&output)) {
+      result.error = "unable to write " + result.output_path;
+      return result;
+    }
+  }
+  result.nodes_before = static_cast<int>(graph.nodes.size());
+  result.nodes_after = graph_proto.node_size();
+  result.folded_nodes = plan.folded_nodes;
+  result.dead_nodes = plan.dead_nodes;
+  result.initializers_added = static_cast<int>(plan.materialized.size());
+  result.initializers_removed =
+      static_cast<int>(plan.unused_initializers.size());
+  result.bytes_before = file_size(model_path);
+  result.bytes_after = file_size(result.output_path);
+  result.elapsed_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - started)
+                          .count();
+  result.ok = true;
+  return result;
+}
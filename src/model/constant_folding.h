@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// Constant folding and dead node elimination. Planning reads only the
+// graph; folding evaluates the constant nodes from the model's weights and
+// writes the slimmer model. Startup of both models is compared in
+// runtime/folding.h.
+
+enum eNodeFate {
+  NODE_KEPT = 0,
+  // computed from constants only, replaced by its outputs as initializers
+  // where kept nodes read them
+  NODE_FOLDED,
+  // nothing reaching a graph output reads it
+  NODE_DEAD,
+};
+
+struct sFoldingPlan {
+  // per node
+  std::vector<eNodeFate> fates;
+  // outputs of folded nodes read by kept nodes, stored as initializers
+  std::vector<int> materialized;
+  // initializers no kept node reads. initializers listed as graph inputs
+  // are overridable and never dropped.
+  std::vector<int> unused_initializers;
+  int folded_nodes = 0;
+  int dead_nodes = 0;
+  double elapsed_ms = 0.0;
+};
+
+// Plans folding in two linear passes over the graph without reading any
+// weight, cheap enough for every model open. A node folds when its op can
+// be evaluated and every input is a folded output or an initializer; Shape
+// and Size fold whenever the input shape is static. Nodes producing graph
+// outputs and nodes whose outputs would dwarf their inputs never fold.
+// `implicit_uses` are tensors read by If, Loop and Scan bodies, kept alive
+// like graph outputs. `evaluate`, when set, is called on each node about to
+// fold in topological order and may refuse it, which keeps the node and
+// everything computed from it.
+sFoldingPlan
+plan_constant_folding(const sModelGraph &graph,
+                      const std::vector<int> &implicit_uses = {},
+                      const std::function<bool(int node)> &evaluate = nullptr);
+
+struct sFoldingResult {
+  bool ok = false;
+  std::string error;
+  std::string output_path;
+  int nodes_before = 0;
+  int nodes_after = 0;
+  int folded_nodes = 0;
+  int dead_nodes = 0;
+  int initializers_added = 0;
+  int initializers_removed = 0;
+  // model file sizes
+  int64_t bytes_before = 0;
+  int64_t bytes_after = 0;
+  double elapsed_ms = 0.0;
+};
+
+// Folds the model at `model_path`, whose ModelInspector declared_graph() is
+// `graph`, and writes it to `output_path`, empty for <model>.folded.onnx
+// next to the model. Input shapes pinned since loading would otherwise be
+// baked into the folded shape constants. Nodes whose constants are of a
+// type the evaluator does not handle (float16, bfloat16, strings) stay.
+sFoldingResult fold_constants(const std::string &model_path,
+                              const sModelGraph &graph,
+                              const std::string &output_path);
@@ -0,0 +1,373 @@
+#include "cost_model.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "graph_utils.h"
+#include "tensor_utils.h"
+
+namespace {
+
+// FLOPs per output element of ops whose cost scales with their output.
+// transcendentals are counted as a handful of FLOPs, roughly what a
+// vectorized polynomial approximation costs.
+const std::unordered_map<std::string, double> kElementwiseFlops = {
+    {"Add", 1},         {"Sub", 1},        {"Mul", 1},
+    {"Div", 1},         {"Max", 1},        {"Min", 1},
+    {"Mean", 1},        {"Sum", 1},        {"Neg", 1},
+    {"Abs", 1},         {"Relu", 1},       {"LeakyRelu", 2},
+    {"PRelu", 2},       {"Clip", 2},       {"Sqrt", 1},
+    {"Reciprocal", 1},  {"Where", 1},      {"Equal", 1},
+    {"Less", 1},        {"Greater", 1},    {"Not", 1},
+    {"And", 1},         {"Or", 1},         {"Floor", 1},
+    {"Ceil", 1},        {"Round", 1},      {"Sign", 1},
+    {"HardSigmoid", 3}, {"HardSwish", 4},  {"Elu", 4},
+    {"Selu", 4},        {"Exp", 4},        {"Log", 4},
+    {"Pow", 4},         {"Tanh", 4},       {"Sigmoid", 4},
+    {"Erf", 4},         {"Sin", 4},        {"Cos", 4},
+    {"Softplus", 5},    {"Mish", 10},      {"Gelu", 8},
+    {"FastGelu", 8},    {"BiasGelu", 9},   {"QuickGelu", 6},
+    {"Softmax", 5},     {"LogSoftmax", 5},
+};
+
+// normalizations, per element of the normalized tensor. inference-mode
+// BatchNormalization is a folded scale and shift.
+const std::unordered_map<std::string, double> kNormalizationFlops = {
+    {"BatchNormalization", 2},
+    {"InstanceNormalization", 8},
+    {"GroupNormalization", 8},
+    {"LayerNormalization", 8},
+    {"SimplifiedLayerNormalization", 6},
+    {"SkipLayerNormalization", 9},
+    {"SkipSimplifiedLayerNormalization", 7},
+    {"LpNormalization", 4},
+    {"MeanVarianceNormalization", 8},
+};
+
+// reductions, per input element
+const std::unordered_map<std::string, double> kReductionFlops = {
+    {"GlobalAveragePool", 1}, {"GlobalMaxPool", 1}, {"GlobalLpPool", 2},
+    {"ReduceMean", 1},        {"ReduceSum", 1},     {"ReduceMax", 1},
+    {"ReduceMin", 1},         {"ReduceProd", 1},    {"ReduceL1", 2},
+    {"ReduceL2", 2},          {"ReduceSumSquare", 2},
+    {"ReduceLogSum", 1},      {"ReduceLogSumExp", 5},
+    {"ArgMax", 1},            {"ArgMin", 1},
+};
+
+// views that alias their input and move no data
+const std::unordered_set<std::string> kViewOps = {
+    "Reshape", "Flatten", "Squeeze", "Unsqueeze", "Identity", "Shape",
+    "Size",    "Dropout",
+};
+
+class NodeCostEstimator {
+private:
+  const sModelGraph &_graph;
+  const sModelGraphNode &_node;
+  int64_t _batch_size;
+  sNodeCost &_cost;
+
+public:
+  NodeCostEstimator(const sModelGraph &graph, int node_index,
+                    int64_t batch_size, sNodeCost &cost)
+      : _graph(graph), _node(graph.nodes[node_index]),
+        _batch_size(batch_size), _cost(cost) {
+    _cost.node = node_index;
+  }
+
+  const sModelTensor *input(size_t i) const {
+    return tensor(_node.input_tensors, i);
+  }
+  const sModelTensor *output(size_t i) const {
+    return tensor(_node.output_tensors, i);
+  }
+
+  // element count, -1 if the tensor or its shape is unknown
+  int64_t elements(const sModelTensor *t) const {
+    return t ? tensor_element_count(*t, _batch_size) : -1;
+  }
+
+  // dim of a tensor counting negative indices from the back
+  int64_t dim(const sModelTensor *t, int axis) const {
+    if (!t) {
+      return -1;
+    }
+    const int rank = static_cast<int>(t->shape.size());
+    if (axis < 0) {
+      axis += rank;
+    }
+    if (axis < 0 || axis >= rank) {
+      return -1;
+    }
+    return t->shape[axis] < 0 ? _batch_size : t->shape[axis];
+  }
+
+  void add_macs(int64_t macs) {
+    if (macs < 0) {
+      _cost.sized = false;
+      return;
+    }
+    _cost.macs += static_cast<double>(macs);
+    _cost.flops += 2.0 * static_cast<double>(macs);
+  }
+
+  void add_flops(int64_t elements, double per_element) {
+    if (elements < 0) {
+      _cost.sized = false;
+      return;
+    }
+    _cost.flops += per_element * static_cast<double>(elements);
+  }
+
+  void count_bytes() {
+    if (kViewOps.count(_node.op_type)) {
+      return;
+    }
+    for (int t : _node.input_tensors) {
+      if (t < 0) {
+        continue;
+      }
+      const auto &tensor = _graph.tensors[t];
+      const int64_t bytes = tensor_byte_size(tensor, _batch_size);
+      if (bytes < 0) {
+        _cost.sized = false;
+      } else if (tensor.is_initializer) {
+        _cost.param_bytes += bytes;
+      } else {
+        _cost.read_bytes += bytes;
+      }
+    }
+    for (int t : _node.output_tensors) {
+      if (t < 0) {
+        continue;
+      }
+      const int64_t bytes = tensor_byte_size(_graph.tensors[t], _batch_size);
+      if (bytes < 0) {
+        _cost.sized = false;
+      } else {
+        _cost.write_bytes += bytes;
+      }
+    }
+  }
+
+  void estimate() {
+    count_bytes();
+    const auto &op = _node.op_type;
+    if (op == "Conv" || op == "ConvInteger" || op == "FusedConv" ||
+        op == "NhwcConv") {
+      estimate_conv();
+    } else if (op == "ConvTranspose") {
+      estimate_conv_transpose();
+    } else if (op == "Gemm" || op == "FusedGemm") {
+      estimate_gemm();
+    } else if (op == "MatMul" || op == "MatMulInteger" ||
+               op == "FusedMatMul") {
+      estimate_matmul();
+    } else if (op == "Attention") {
+      estimate_packed_attention();
+    } else if (op == "MultiHeadAttention") {
+      estimate_multi_head_attention();
+    } else if (op == "MaxPool" || op == "AveragePool" || op == "LpPool") {
+      estimate_pool();
+    } else if (auto it = kReductionFlops.find(op);
+               it != kReductionFlops.end()) {
+      add_flops(elements(input(0)), it->second);
+    } else if (auto it = kNormalizationFlops.find(op);
+               it != kNormalizationFlops.end()) {
+      add_flops(elements(input(0)), it->second);
+    } else if (auto it = kElementwiseFlops.find(op);
+               it != kElementwiseFlops.end()) {
+      add_flops(elements(output(0)), it->second);
+    }
+    // anything else (Transpose, Concat, Gather, Resize, ...) only moves data
+  }
+
+private:
+  const sModelTensor *tensor(const std::vector<int> &indices,
+                             size_t i) const {
+    if (i >= indices.size() || indices[i] < 0) {
+      return nullptr;
+    }
+    return &_graph.tensors[indices[i]];
+  }
+
+  // product of the weight dims after the first, i.e. MACs per output
+  // (Conv) or per input (ConvTranspose) element
+  int64_t weight_fan(const sModelTensor *weight) const {
+    if (!weight || weight->shape.size() < 2) {
+      return -1;
+    }
+    int64_t fan = 1;
+    for (size_t i = 1; i < weight->shape.size(); ++i) {
+      fan *= dim(weight, static_cast<int>(i));
+    }
+    return fan;
+  }
+
+  void estimate_conv() {
+    const int64_t outputs = elements(output(0));
+    const int64_t fan = weight_fan(input(1));
+    add_macs(outputs >= 0 && fan >= 0 ? outputs * fan : -1);
+    if (input(2)) {
+      add_flops(outputs, 1);
+    }
+  }
+
+  void estimate_conv_transpose() {
+    const int64_t inputs = elements(input(0));
+    const int64_t fan = weight_fan(input(1));
+    add_macs(inputs >= 0 && fan >= 0 ? inputs * fan : -1);
+    if (input(2)) {
+      add_flops(elements(output(0)), 1);
+    }
+  }
+
+  void estimate_gemm() {
+    const int64_t outputs = elements(output(0));
+    const bool trans_a = attribute_int(_node, "transA", 0) != 0;
+    const int64_t k = dim(input(0), trans_a ? 0 : 1);
+    add_macs(outputs >= 0 && k >= 0 ? outputs * k : -1);
+    if (input(2)) {
+      add_flops(outputs, 1);
+    }
+  }
+
+  void estimate_matmul() {
+    const int64_t outputs = elements(output(0));
+    const int64_t k = dim(input(0), -1);
+    add_macs(outputs >= 0 && k >= 0 ? outputs * k : -1);
+  }
+
+  // com.microsoft.Attention: input (B, S, D) projected by a packed QKV
+  // weight (D, 3H), then softmax(Q K^T) V over the sequence
+  void estimate_packed_attention() {
+    const int64_t b = dim(input(0), 0);
+    const int64_t s = dim(input(0), 1);
+    const int64_t d = dim(input(0), 2);
+    const int64_t qkv = dim(input(1), -1);
+    const int64_t heads = attribute_int(_node, "num_heads", 1);
+    if (b < 0 || s < 0 || d < 0 || qkv < 0) {
+      _cost.sized = false;
+      return;
+    }
+    const int64_t hidden = qkv / 3;
+    add_macs(b * s * d * qkv);
+    add_macs(2 * b * s * s * hidden);
+    add_flops(b * heads * s * s, kElementwiseFlops.at("Softmax"));
+  }
+
+  // com.microsoft.MultiHeadAttention: projected query (B, S, H) and
+  // key/value (B, L, H)
+  void estimate_multi_head_attention() {
+    const int64_t b = dim(input(0), 0);
+    const int64_t s = dim(input(0), 1);
+    const int64_t hidden = dim(input(0), -1);
+    const int64_t l = input(1) ? dim(input(1), 1) : s;
+    const int64_t heads = attribute_int(_node, "num_heads", 1);
+    if (b < 0 || s < 0 || hidden < 0 || l < 0) {
+      _cost.sized = false;
+      return;
+    }
+    add_macs(2 * b * s * l * hidden);
+    add_flops(b * heads * s * l, kElementwiseFlops.at("Softmax"));
+  }
+
+  void estimate_pool() {
+    int64_t window = 1;
+    for (int64_t k : attribute_ints(_node, "kernel_shape")) {
+      window *= k;
+    }
+    add_flops(elements(output(0)), static_cast<double>(window));
+  }
+};
+
+} // namespace
+
+void sCostAggregate::add(const sNodeCost &cost) {
+  ++node_count;
+  flops += cost.flops;
+  macs += cost.macs;
+  param_bytes += cost.param_bytes;
+  read_bytes += cost.read_bytes;
+  write_bytes += cost.write_bytes;
+}
+
+sCostReport estimate_cost(const sModelGraph &graph, int64_t batch_size,
+                          const std::vector<int> &representative) {
+  sCostReport report;
+  report.total.name = "total";
+  const int node_count = static_cast<int>(graph.nodes.size());
+  report.nodes.resize(node_count);
+  const bool reuse = static_cast<int>(representative.size()) == node_count;
+  auto is_representative = [&](int i) {
+    return !reuse || representative[i] == i || representative[i] < 0 ||
+           representative[i] >= node_count;
+  };
+  for (int i = 0; i < node_count; ++i) {
+    if (is_representative(i)) {
+      NodeCostEstimator(graph, i, batch_size, report.nodes[i]).estimate();
+    }
+  }
+  for (int i = 0; i < node_count; ++i) {
+    auto &cost = report.nodes[i];
+    if (!is_representative(i)) {
+      cost = report.nodes[representative[i]];
+      cost.node = i;
+    }
+    if (!cost.sized) {
+      ++report.unsized_nodes;
+    }
+    report.total.add(cost);
+    auto &by_op = report.by_op_type[graph.nodes[i].op_type];
+    by_op.name = graph.nodes[i].op_type;
+    by_op.add(cost);
+  }
+  return report;
+}
+
+std::vector<sCostAggregate> aggregate_by_scope(const sModelGraph &graph,
+                                               const sCostReport &report,
+                                               int depth) {
+  std::vector<sCostAggregate> groups;
+  std::unordered_map<std::string, size_t> group_of;
+  for (size_t i = 0; i < report.nodes.size() && i < graph.nodes.size(); ++i) {
+    const auto &name = graph.nodes[i].name;
+    std::string scope;
+    if (!name.empty() && name[0] == '/') {
+      // "/a/b/Conv": components before the last one are the scope
+      size_t end = 0;
+      for (int level = 0; level < depth; ++level) {
+        const size_t next = name.find('/', end + 1);
+        if (next == std::string::npos) {
+          break;
+        }
+        end = next;
+      }
+      scope = name.substr(0, end);
+    }
+    if (scope.empty()) {
+      scope = graph.nodes[i].op_type;
+    }
+    auto [it, inserted] = group_of.emplace(scope, groups.size());
+    if (inserted) {
+      groups.push_back({});
+      groups.back().name = scope;
+    }
+    groups[it->second].add(report.nodes[i]);
+  }
+  return groups;
+}
+
+sCostAggregate aggregate_nodes(const sCostReport &report,
+                               const std::vector<int> &nodes,
+                               const std::string &name) {
+  sCostAggregate aggregate;
+  aggregate.name = name;
+  for (int node : nodes) {
+    if (node >= 0 && node < static_cast<int>(report.nodes.size())) {
+      aggregate.add(report.nodes[node]);
+    }
+  }
+  return aggregate;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// static cost of one node. a multiply-accumulate counts as two FLOPs.
+struct sNodeCost {
+  int node = -1;
+  double flops = 0.0;
+  double macs = 0.0;
+  // initializer inputs
+  int64_t param_bytes = 0;
+  // non-initializer inputs and all outputs
+  int64_t read_bytes = 0;
+  int64_t write_bytes = 0;
+  // false if an input or output shape needed by the formula is unknown
+  bool sized = true;
+
+  int64_t total_bytes() const { return param_bytes + read_bytes + write_bytes; }
+  // FLOPs per byte moved, assuming every tensor touches memory once
+  double arithmetic_intensity() const {
+    const int64_t bytes = total_bytes();
+    return bytes > 0 ? flops / bytes : 0.0;
+  }
+};
+
+// sum over a group of nodes
+struct sCostAggregate {
+  std::string name;
+  int node_count = 0;
+  double flops = 0.0;
+  double macs = 0.0;
+  int64_t param_bytes = 0;
+  int64_t read_bytes = 0;
+  int64_t write_bytes = 0;
+
+  void add(const sNodeCost &cost);
+  int64_t total_bytes() const { return param_bytes + read_bytes + write_bytes; }
+  double arithmetic_intensity() const {
+    const int64_t bytes = total_bytes();
+    return bytes > 0 ? flops / bytes : 0.0;
+  }
+};
+
+struct sCostReport {
+  // indexed like graph.nodes
+  std::vector<sNodeCost> nodes;
+  sCostAggregate total;
+  std::map<std::string, sCostAggregate> by_op_type;
+  int unsized_nodes = 0;
+};
+
+// unknown dims are taken as `batch_size`. with `representative` (see
+// sBlockPlan) only representatives are estimated; the other nodes of a
+// repeated block copy their representative's cost.
+sCostReport estimate_cost(const sModelGraph &graph, int64_t batch_size = 1,
+                          const std::vector<int> &representative = {});
+
+// groups nodes by the first `depth` components of their '/' separated name,
+// the scope path torch.onnx gives each module (e.g. /layer1/layer1.0/conv1).
+// nodes without a scope are grouped by op type.
+std::vector<sCostAggregate> aggregate_by_scope(const sModelGraph &graph,
+                                               const sCostReport &report,
+                                               int depth);
+
+sCostAggregate aggregate_nodes(const sCostReport &report,
+                               const std::vector<int> &nodes,
+                               const std::string &name);
@@ -0,0 +1,272 @@
+#include "decimation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "../engine/thread_pool.h"
+
+namespace {
+
+// level 0 buckets at most, 8 MiB of ranges
+constexpr size_t kMaxBaseBuckets = size_t(1) << 20;
+// level 0 buckets per parallel piece
+constexpr size_t kPieceBuckets = 4096;
+constexpr size_t kBatch = 4096;
+
+float extreme(const sMinMax &range) {
+  if (range.empty()) {
+    return 0.f;
+  }
+  return std::abs(range.max) >= std::abs(range.min) ? range.max : range.min;
+}
+
+// finite values of [first, last), read in batches
+void merge_values(const ValueReader &read, size_t first, size_t last,
+                  float *buffer, sMinMax &range) {
+  for (size_t i = first; i < last; i += kBatch) {
+    const size_t n = std::min(kBatch, last - i);
+    const float *values = read(i, n, buffer);
+    for (size_t j = 0; j < n; ++j) {
+      const float x = values[j];
+      if (x - x == 0.f) {
+        range.merge({x, x});
+      }
+    }
+  }
+}
+
+// range of exactly [first, last): the level 0 buckets inside it from the
+// pyramid, the partial buckets at either end read
+sMinMax exact_range(const sDecimationPyramid &pyramid,
+                    const ValueReader &read, size_t first, size_t last,
+                    float *buffer) {
+  const size_t base = pyramid.base;
+  const size_t head = std::min(last, (first + base - 1) / base * base);
+  const size_t tail = std::max(head, last / base * base);
+  sMinMax range = pyramid.range(head, tail);
+  merge_values(read, first, head, buffer, range);
+  merge_values(read, tail, last, buffer, range);
+  return range;
+}
+
+} // namespace
+
+size_t sDecimationPyramid::bytes() const {
+  size_t total = 0;
+  for (const auto &level : levels) {
+    total += level.size() * sizeof(sMinMax);
+  }
+  return total;
+}
+
+sMinMax sDecimationPyramid::range(size_t first, size_t last) const {
+  sMinMax result;
+  if (levels.empty() || first >= last) {
+    return result;
+  }
+  // the largest aligned bucket that fits, from the left
+  size_t b = first / base;
+  const size_t e = std::min((last + base - 1) / base, levels[0].size());
+  while (b < e) {
+    size_t level = 0;
+    while (level + 1 < levels.size() && b % (size_t(2) << level) == 0 &&
+           b + (size_t(2) << level) <= e) {
+      ++level;
+    }
+    result.merge(levels[level][b >> level]);
+    b += size_t(1) << level;
+  }
+  return result;
+}
+
+sDecimationPyramid build_pyramid(size_t count, const ValueReader &read) {
+  const auto started = std::chrono::steady_clock::now();
+  sDecimationPyramid pyramid;
+  pyramid.count = count;
+  if (count == 0) {
+    return pyramid;
+  }
+  while ((count + pyramid.base - 1) / pyramid.base > kMaxBaseBuckets) {
+    pyramid.base *= 2;
+  }
+  const size_t base = pyramid.base;
+  const size_t buckets = (count + base - 1) / base;
+  pyramid.levels.emplace_back(buckets);
+  auto &level0 = pyramid.levels[0];
+
+  // pieces hold whole buckets, so no bucket is written by two threads
+  const size_t pieces = (buckets + kPieceBuckets - 1) / kPieceBuckets;
+  ThreadPool::shared().parallel_for(
+      static_cast<int64_t>(pieces), [&](int64_t p) {
+        const size_t first = static_cast<size_t>(p) * kPieceBuckets * base;
+        const size_t last = std::min(first + kPieceBuckets * base, count);
+        float buffer[kBatch];
+        for (size_t offset = first; offset < last; offset += kBatch) {
+          const size_t n = std::min(kBatch, last - offset);
+          const float *values = read(offset, n, buffer);
+          for (size_t i = 0; i < n;) {
+            const size_t bucket = (offset + i) / base;
+            const size_t end = std::min(n, (bucket + 1) * base - offset);
+            float lo = level0[bucket].min;
+            float hi = level0[bucket].max;
+            for (; i < end; ++i) {
+              const float x = values[i];
+              // skips NaN and Inf
+              if (x - x != 0.f) {
+                continue;
+              }
+              lo = x < lo ? x : lo;
+              hi = x > hi ? x : hi;
+            }
+            level0[bucket].min = lo;
+            level0[bucket].max = hi;
+          }
+        }
+      });
+
+  while (pyramid.levels.back().size() > 1) {
+    const auto &below = pyramid.levels.back();
+    std::vector<sMinMax> level((below.size() + 1) / 2);
+    for (size_t b = 0; b < below.size(); ++b) {
+      level[b / 2].merge(below[b]);
+    }
+    pyramid.levels.push_back(std::move(level));
+  }
+  pyramid.build_ms = std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - started)
+                         .count();
+  return pyramid;
+}
+
+void decimate(const sDecimationPyramid &pyramid, const ValueReader &read,
+              double first, double last, int max_points,
+              sDecimatedSeries &out) {
+  out.x.clear();
+  out.min.clear();
+  out.max.clear();
+  out.bucket = 1;
+  const double count = static_cast<double>(pyramid.count);
+  const auto begin =
+      static_cast<size_t>(std::clamp(std::floor(first), 0.0, count));
+  const auto end =
+      static_cast<size_t>(std::clamp(std::ceil(last), 0.0, count));
+  if (begin >= end || pyramid.levels.empty()) {
+    return;
+  }
+  const size_t points = static_cast<size_t>(std::max(max_points, 1));
+  const size_t needed = (end - begin + points - 1) / points;
+
+  if (needed < pyramid.base && read) {
+    // zoomed in below level 0: raw values, bucketed if still too many
+    out.scratch.resize(end - begin);
+    const float *values = read(begin, end - begin, out.scratch.data());
+    out.bucket = needed;
+    for (size_t i = begin; i < end; i += needed) {
+      const size_t n = std::min(needed, end - i);
+      sMinMax range;
+      for (size_t j = 0; j < n; ++j) {
+        const float x = values[i - begin + j];
+        if (x - x == 0.f) {
+          range.merge({x, x});
+        }
+      }
+      out.x.push_back(i + 0.5 * (n - 1));
+      out.min.push_back(range.empty() ? NAN : range.min);
+      out.max.push_back(range.empty() ? NAN : range.max);
+    }
+    return;
+  }
+
+  // the finest level with at most `points` buckets over the range
+  int level = 0;
+  while (level + 1 < static_cast<int>(pyramid.levels.size()) &&
+         pyramid.bucket_size(level) < needed) {
+    ++level;
+  }
+  const size_t size = pyramid.bucket_size(level);
+  const auto &buckets = pyramid.levels[level];
+  out.bucket = size;
+  const size_t last_bucket = std::min((end + size - 1) / size, buckets.size());
+  for (size_t b = begin / size; b < last_bucket; ++b) {
+    const auto &range = buckets[b];
+    const size_t bucket_end = std::min((b + 1) * size, pyramid.count);
+    out.x.push_back(0.5 * (b * size + bucket_end - 1));
+    out.min.push_back(range.empty() ? NAN : range.min);
+    out.max.push_back(range.empty() ? NAN : range.max);
+  }
+}
+
+void decimate_grid(const sDecimationPyramid &pyramid, const ValueReader &read,
+                   size_t rows, size_t cols, int max_rows, int max_cols,
+                   sDecimatedGrid &out) {
+  out.rows = static_cast<int>(std::min(rows, static_cast<size_t>(max_rows)));
+  out.cols = static_cast<int>(std::min(cols, static_cast<size_t>(max_cols)));
+  const size_t cells = static_cast<size_t>(out.rows) * out.cols;
+  out.xs.resize(cells);
+  out.ys.resize(cells);
+  out.zs.resize(cells);
+  if (cells == 0 || rows * cols > pyramid.count) {
+    out.rows = 0;
+    out.cols = 0;
+    return;
+  }
+  // cells reach into the buckets of the columns next to them, so their
+  // partial buckets are read. below two buckets per cell that costs more
+  // than reading the rows whole.
+  const bool raw = read && cols / out.cols < 2 * pyramid.base;
+  // grid rows in parallel, each writing its own cells
+  ThreadPool::shared().parallel_for(out.rows, [&](int64_t gr) {
+    const size_t r0 = gr * rows / out.rows;
+    const size_t r1 = (gr + 1) * rows / out.rows;
+    float buffer[kBatch];
+    std::vector<sMinMax> ranges(out.cols);
+    if (raw) {
+      for (size_t r = r0; r < r1; ++r) {
+        size_t gc = 0;
+        for (size_t c = 0; c < cols; c += kBatch) {
+          const size_t n = std::min(kBatch, cols - c);
+          const float *values = read(r * cols + c, n, buffer);
+          for (size_t j = 0; j < n;) {
+            while ((gc + 1) * cols / out.cols <= c + j) {
+              ++gc;
+            }
+            const size_t end = std::min(n, (gc + 1) * cols / out.cols - c);
+            float lo = ranges[gc].min;
+            float hi = ranges[gc].max;
+            for (; j < end; ++j) {
+              const float x = values[j];
+              if (x - x != 0.f) {
+                continue;
+              }
+              lo = x < lo ? x : lo;
+              hi = x > hi ? x : hi;
+            }
+            ranges[gc].min = lo;
+            ranges[gc].max = hi;
+          }
+        }
+      }
+    }
+    auto cell_range = [&](size_t first, size_t last) {
+      return read ? exact_range(pyramid, read, first, last, buffer)
+                  : pyramid.range(first, last);
+    };
+    for (int gc = 0; gc < out.cols; ++gc) {
+      const size_t c0 = gc * cols / out.cols;
+      const size_t c1 = (gc + 1) * cols / out.cols;
+      auto &range = ranges[gc];
+      if (!raw && c0 == 0 && c1 == cols) {
+        range = cell_range(r0 * cols, r1 * cols);
+      } else if (!raw) {
+        for (size_t r = r0; r < r1; ++r) {
+          range.merge(cell_range(r * cols + c0, r * cols + c1));
+        }
+      }
+      const size_t cell = static_cast<size_t>(gr) * out.cols + gc;
+      out.xs[cell] = static_cast<float>(c0);
+      out.ys[cell] = static_cast<float>(r0);
+      out.zs[cell] = extreme(range);
+    }
+  });
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Reads values [first, first + count) of a series. Returns them in place
+// when it can, otherwise converts them into `buffer`, which holds `count`
+// floats. Called from several threads at once while a pyramid is built.
+using ValueReader =
+    std::function<const float *(size_t first, size_t count, float *buffer)>;
+
+// range of the finite values of one bucket; min > max when it has none
+struct sMinMax {
+  float min = FLT_MAX;
+  float max = -FLT_MAX;
+
+  bool empty() const { return min > max; }
+  void merge(const sMinMax &other) {
+    min = other.min < min ? other.min : min;
+    max = other.max > max ? other.max : max;
+  }
+};
+
+// Multi-resolution min/max summary of a series. Level 0 holds buckets of
+// `base` values and every level above halves the buckets, up to a single
+// one. base is the smallest power of two keeping level 0 within a few MiB,
+// so a 100M value tensor summarizes to about 12 MiB.
+struct sDecimationPyramid {
+  size_t count = 0;
+  size_t base = 1;
+  std::vector<std::vector<sMinMax>> levels;
+  double build_ms = 0.0;
+
+  size_t bucket_size(int level) const { return base << level; }
+  size_t bytes() const;
+  // range of the buckets covering [first, last), which may reach a little
+  // past either end below base resolution
+  sMinMax range(size_t first, size_t last) const;
+};
+
+// builds the pyramid of `count` values in pieces on the shared pool
+sDecimationPyramid build_pyramid(size_t count, const ValueReader &read);
+
+// A view of [first, last) with about one point per pixel: raw values when
+// zoomed in far enough, otherwise the min/max of each bucket.
+struct sDecimatedSeries {
+  // doubles, as plotting takes one type and floats lose indices past 2^24
+  std::vector<double> x;
+  std::vector<double> min;
+  std::vector<double> max;
+  // values per point, 1 for raw values
+  size_t bucket = 1;
+  // raw values below base resolution
+  std::vector<float> scratch;
+};
+
+// fills `out` with at most about `max_points` points over [first, last).
+// below base resolution the values are read with `read` when given,
+// otherwise level 0 is shown.
+void decimate(const sDecimationPyramid &pyramid, const ValueReader &read,
+              double first, double last, int max_points,
+              sDecimatedSeries &out);
+
+// The series folded into rows x cols, decimated to at most max_rows x
+// max_cols cells holding the value of largest magnitude of each cell, as
+// xs/ys/zs arrays for a surface plot. with `read` the cells are exact,
+// their values below base resolution read; without, they may take values
+// of the columns next to them.
+struct sDecimatedGrid {
+  int rows = 0;
+  int cols = 0;
+  std::vector<float> xs;
+  std::vector<float> ys;
+  std::vector<float> zs;
+};
+
+void decimate_grid(const sDecimationPyramid &pyramid, const ValueReader &read,
+                   size_t rows, size_t cols, int max_rows, int max_cols,
+                   sDecimatedGrid &out);
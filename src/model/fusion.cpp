@@ -0,0 +1,311 @@
+#include "fusion.h"
+
+#include <algorithm>
+
+#include "graph_utils.h"
+#include "tensor_utils.h"
+
+namespace {
+
+bool is_binary(const std::string &op) {
+  return op == "Add" || op == "Sub" || op == "Mul" || op == "Div";
+}
+
+bool is_constant(const sModelGraph &graph, int tensor) {
+  return tensor < 0 || graph.tensors[tensor].is_initializer;
+}
+
+// no unknown dims; symbolic dims compare by symbol
+bool is_known(const std::vector<int64_t> &shape) {
+  return std::none_of(shape.begin(), shape.end(),
+                      [](int64_t dim) { return dim == -1; });
+}
+
+class FusionPlanner {
+public:
+  FusionPlanner(const sModelGraph &graph, int64_t batch_size)
+      : _graph(graph), _batch_size(batch_size),
+        _consumers(tensor_consumers(graph)),
+        _is_output(graph.tensors.size(), false) {
+    for (int t : graph.output_tensors) {
+      _is_output[t] = true;
+    }
+    _plan.node_group.assign(graph.nodes.size(), -1);
+  }
+
+  sFusionPlan run() {
+    const auto order = topological_order(_graph);
+    // epilogues first, so a Relu after a Conv is not taken by a chain
+    for (int node : order) {
+      const auto &op = _graph.nodes[node].op_type;
+      if (op == "Conv") {
+        fuse_conv(node);
+      } else if (op == "Gemm" || op == "MatMul") {
+        fuse_gemm(node);
+      }
+    }
+    for (int node : order) {
+      if (_plan.node_group[node] < 0 &&
+          is_fusable_elementwise(_graph.nodes[node].op_type)) {
+        fuse_chain(node);
+      }
+    }
+    return std::move(_plan);
+  }
+
+private:
+  const sModelGraph &_graph;
+  int64_t _batch_size;
+  std::vector<std::vector<int>> _consumers;
+  std::vector<bool> _is_output;
+  sFusionPlan _plan;
+
+  // the single output of `node`, -1 if it has several
+  int single_output(int node) const {
+    int output = -1;
+    for (int t : _graph.nodes[node].output_tensors) {
+      if (t < 0) {
+        continue;
+      }
+      if (output >= 0) {
+        return -1;
+      }
+      output = t;
+    }
+    return output;
+  }
+
+  // the node that reads the output of `node` as its only consumer, -1 if
+  // the output may not be elided
+  int sole_consumer(int node) const {
+    const int output = single_output(node);
+    if (output < 0 || _is_output[output] || _consumers[output].size() != 1) {
+      return -1;
+    }
+    const int consumer = _consumers[output].front();
+    const auto &inputs = _graph.nodes[consumer].input_tensors;
+    if (_plan.node_group[consumer] >= 0 ||
+        std::count(inputs.begin(), inputs.end(), output) != 1) {
+      return -1;
+    }
+    return consumer;
+  }
+
+  const std::vector<int64_t> &shape(int tensor) const {
+    return _graph.tensors[tensor].shape;
+  }
+
+  // input of a binary node that is not `tensor`
+  int other_operand(int node, int tensor) const {
+    const auto &inputs = _graph.nodes[node].input_tensors;
+    if (inputs.size() != 2) {
+      return -1;
+    }
+    return inputs[0] == tensor ? inputs[1] : inputs[0];
+  }
+
+  // Clip's bounds must be known when the kernel is planned
+  bool activation_ok(int node, int input) const {
+    const auto &n = _graph.nodes[node];
+    if (!is_fusable_activation(n.op_type) || n.input_tensors.empty() ||
+        n.input_tensors[0] != input) {
+      return false;
+    }
+    for (size_t i = 1; i < n.input_tensors.size(); ++i) {
+      if (!is_constant(_graph, n.input_tensors[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // constant with a single non-unit dim of size `size`, at `axis` counted
+  // from the back
+  bool is_bias(int tensor, int64_t size, size_t axis) const {
+    if (tensor < 0 || !_graph.tensors[tensor].is_initializer || size <= 0) {
+      return false;
+    }
+    const auto &s = shape(tensor);
+    if (s.size() < axis + 1) {
+      return false;
+    }
+    for (size_t i = 0; i < s.size(); ++i) {
+      const bool at_axis = i == s.size() - 1 - axis;
+      if (s[i] != (at_axis ? size : 1)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void fuse_conv(int conv) {
+    const auto &node = _graph.nodes[conv];
+    if (node.input_tensors.size() < 2 || node.input_tensors[1] < 0) {
+      return;
+    }
+    const auto &weight = shape(node.input_tensors[1]);
+    const int64_t channels = weight.empty() ? -1 : weight[0];
+    // folding rewrites the bias, and the weights for BatchNormalization
+    const bool bias_constant = node.input_tensors.size() < 3 ||
+                               is_constant(_graph, node.input_tensors[2]);
+    const bool foldable =
+        bias_constant && is_constant(_graph, node.input_tensors[1]);
+
+    sFusionGroup group;
+    group.kind = FUSION_CONV_EPILOGUE;
+    group.nodes.push_back(conv);
+    int next = sole_consumer(conv);
+    int value = single_output(conv);
+    if (foldable && next >= 0 &&
+        _graph.nodes[next].op_type == "BatchNormalization" &&
+        _graph.nodes[next].input_tensors.size() == 5 &&
+        _graph.nodes[next].input_tensors[0] == value &&
+        single_output(next) >= 0 &&
+        std::all_of(_graph.nodes[next].input_tensors.begin() + 1,
+                    _graph.nodes[next].input_tensors.end(), [&](int t) {
+                      return t >= 0 && _graph.tensors[t].is_initializer;
+                    })) {
+      group.batch_norm = next;
+      group.nodes.push_back(next);
+      value = single_output(next);
+      next = sole_consumer(next);
+    }
+    if (bias_constant && next >= 0 && _graph.nodes[next].op_type == "Add" &&
+        is_bias(other_operand(next, value), channels, 2)) {
+      group.bias_add = next;
+      group.nodes.push_back(next);
+      value = single_output(next);
+      next = sole_consumer(next);
+    }
+    if (next >= 0 && activation_ok(next, value)) {
+      group.activation = next;
+      group.nodes.push_back(next);
+    }
+    commit(std::move(group));
+  }
+
+  void fuse_gemm(int gemm) {
+    const auto &node = _graph.nodes[gemm];
+    const int output = single_output(gemm);
+    if (output < 0 || shape(output).empty()) {
+      return;
+    }
+    const int64_t columns = shape(output).back();
+    // Gemm's own C already takes the place of a bias
+    const bool has_c =
+        node.input_tensors.size() > 2 && node.input_tensors[2] >= 0;
+
+    sFusionGroup group;
+    group.kind = FUSION_GEMM_EPILOGUE;
+    group.nodes.push_back(gemm);
+    int next = sole_consumer(gemm);
+    int value = output;
+    if (!has_c && next >= 0 && _graph.nodes[next].op_type == "Add" &&
+        is_bias(other_operand(next, value), columns, 0)) {
+      group.bias_add = next;
+      group.nodes.push_back(next);
+      value = single_output(next);
+      next = sole_consumer(next);
+    }
+    if (next >= 0 && activation_ok(next, value)) {
+      group.activation = next;
+      group.nodes.push_back(next);
+    }
+    commit(std::move(group));
+  }
+
+  // a link keeps the shape of the running value and reads it once
+  bool chain_link_ok(int node, int input, const std::vector<int64_t> &s) {
+    const auto &n = _graph.nodes[node];
+    const int output = single_output(node);
+    if (output < 0 || shape(output) != s) {
+      return false;
+    }
+    if (is_binary(n.op_type)) {
+      return n.input_tensors.size() == 2;
+    }
+    return activation_ok(node, input);
+  }
+
+  void fuse_chain(int head) {
+    const auto &node = _graph.nodes[head];
+    const int output = single_output(head);
+    if (output < 0 || !is_known(shape(output))) {
+      return;
+    }
+    const auto &s = shape(output);
+    // the running value enters the chain at full shape
+    int input = -1;
+    for (int t : node.input_tensors) {
+      if (t >= 0 && shape(t) == s) {
+        input = t;
+        break;
+      }
+    }
+    if (input < 0 || !chain_link_ok(head, input, s)) {
+      return;
+    }
+
+    sFusionGroup group;
+    group.kind = FUSION_ELEMENTWISE_CHAIN;
+    group.nodes.push_back(head);
+    int value = output;
+    for (int next = sole_consumer(head);
+         next >= 0 && is_fusable_elementwise(_graph.nodes[next].op_type) &&
+         chain_link_ok(next, value, s);
+         next = sole_consumer(next)) {
+      group.nodes.push_back(next);
+      value = single_output(next);
+    }
+    commit(std::move(group));
+  }
+
+  void commit(sFusionGroup group) {
+    if (group.nodes.size() < 2) {
+      return;
+    }
+    const int index = static_cast<int>(_plan.groups.size());
+    for (size_t i = 0; i < group.nodes.size(); ++i) {
+      const int node = group.nodes[i];
+      _plan.node_group[node] = index;
+      group.label += (i ? "+" : "") + _graph.nodes[node].op_type;
+      if (i + 1 < group.nodes.size()) {
+        const int t = single_output(node);
+        group.elided_tensors.push_back(t);
+        group.elided_bytes +=
+            std::max<int64_t>(0, tensor_byte_size(_graph.tensors[t],
+                                                  _batch_size));
+      }
+    }
+    _plan.fused_nodes += static_cast<int>(group.nodes.size());
+    _plan.elided_bytes += group.elided_bytes;
+    _plan.groups.push_back(std::move(group));
+  }
+};
+
+} // namespace
+
+const char *fusion_kind_name(eFusionKind kind) {
+  switch (kind) {
+  case FUSION_CONV_EPILOGUE:
+    return "conv epilogue";
+  case FUSION_GEMM_EPILOGUE:
+    return "gemm epilogue";
+  case FUSION_ELEMENTWISE_CHAIN:
+  default:
+    return "elementwise chain";
+  }
+}
+
+bool is_fusable_activation(const std::string &op_type) {
+  return op_type == "Relu" || op_type == "Clip" || op_type == "LeakyRelu" ||
+         op_type == "Sigmoid" || op_type == "Tanh" || op_type == "Gelu";
+}
+
+bool is_fusable_elementwise(const std::string &op_type) {
+  return is_fusable_activation(op_type) || is_binary(op_type);
+}
+
+sFusionPlan plan_fusion(const sModelGraph &graph, int64_t batch_size) {
+  return FusionPlanner(graph, batch_size).run();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// Pattern based operator fusion over sModelGraph. Only the plan is made
+// here: the native engine carries it out, and the fusion panel shows which
+// nodes it merges.
+
+enum eFusionKind {
+  // Conv, then optionally a BatchNormalization folded into its weights, a
+  // per-channel bias Add and an activation
+  FUSION_CONV_EPILOGUE = 0,
+  // Gemm or MatMul, then optionally a per-column bias Add and an activation
+  FUSION_GEMM_EPILOGUE,
+  // two or more elementwise ops evaluated in one pass over the data
+  FUSION_ELEMENTWISE_CHAIN,
+};
+
+const char *fusion_kind_name(eFusionKind kind);
+
+struct sFusionGroup {
+  eFusionKind kind = FUSION_ELEMENTWISE_CHAIN;
+  // members in data flow order. the first is the anchor, the last produces
+  // the output of the group
+  std::vector<int> nodes;
+  // epilogue members, -1 if absent
+  int batch_norm = -1;
+  int bias_add = -1;
+  int activation = -1;
+  // member op types joined by '+', e.g. Conv+BatchNormalization+Relu
+  std::string label;
+  // intermediate tensors that are no longer materialized
+  std::vector<int> elided_tensors;
+  int64_t elided_bytes = 0;
+};
+
+struct sFusionPlan {
+  std::vector<sFusionGroup> groups;
+  // group of every node, -1 if it runs on its own
+  std::vector<int> node_group;
+  int fused_nodes = 0;
+  int64_t elided_bytes = 0;
+};
+
+// ops that may end an epilogue, and ops that may join an elementwise chain
+bool is_fusable_activation(const std::string &op_type);
+bool is_fusable_elementwise(const std::string &op_type);
+
+// an intermediate is only fused away if its producer has no other output
+// and exactly one consumer reads it, once. unknown dims are taken as
+// `batch_size` when sizing the elided tensors.
+sFusionPlan plan_fusion(const sModelGraph &graph, int64_t batch_size = 1);
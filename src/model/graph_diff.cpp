@@ -0,0 +1,710 @@
+#include "graph_diff.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string_view>
+
+#include "graph_utils.h"
+#include "shape_inference.h"
+
+namespace {
+
+// symbolic dims are indices into each graph's own table, so only fully
+// static shapes compare without printing them
+bool same_static_shape(const sModelTensor &before, const sModelTensor &after) {
+  if (before.shape.empty() || before.shape != after.shape) {
+    return false;
+  }
+  return std::all_of(before.shape.begin(), before.shape.end(),
+                     [](int64_t dim) { return dim >= 0; });
+}
+
+// topology and structural hashes of one graph
+struct sGraphIndex {
+  const sModelGraph &graph;
+  std::vector<int> order;
+  // of every node in order
+  std::vector<int> position;
+  std::vector<int> producers;
+  // output position of every tensor on its producer
+  std::vector<int> producer_slot;
+  std::vector<std::vector<int>> consumers;
+  std::vector<bool> graph_output;
+  // op type, attributes and operand counts
+  std::vector<uint64_t> local;
+
+  explicit sGraphIndex(const sModelGraph &graph)
+      : graph(graph), order(topological_order(graph)),
+        position(graph.nodes.size(), 0), producers(tensor_producers(graph)),
+        producer_slot(graph.tensors.size(), 0),
+        consumers(tensor_consumers(graph)),
+        graph_output(graph.tensors.size(), false),
+        local(graph.nodes.size(), 0) {
+    for (size_t i = 0; i < order.size(); ++i) {
+      position[order[i]] = static_cast<int>(i);
+    }
+    for (const auto &node : graph.nodes) {
+      for (size_t slot = 0; slot < node.output_tensors.size(); ++slot) {
+        if (node.output_tensors[slot] >= 0) {
+          producer_slot[node.output_tensors[slot]] = static_cast<int>(slot);
+        }
+      }
+    }
+    for (int t : graph.output_tensors) {
+      if (t >= 0) {
+        graph_output[t] = true;
+      }
+    }
+    for (size_t n = 0; n < graph.nodes.size(); ++n) {
+      const auto &node = graph.nodes[n];
+      uint64_t hash = hash_string(node.op_type);
+      for (const auto &[key, value] : node.attributes) {
+        hash = hash_combine(hash_combine(hash, hash_string(key)),
+                            hash_string(value));
+      }
+      hash = hash_combine(hash, node.input_tensors.size());
+      local[n] = hash_combine(hash, node.output_tensors.size());
+    }
+  }
+
+  // local hash with the hashes of the producers of every input mixed in,
+  // in operand order
+  uint64_t up_step(int n, const std::vector<uint64_t> &hash) const {
+    static const uint64_t kNone = hash_string("none");
+    static const uint64_t kInput = hash_string("input");
+    static const uint64_t kConstant = hash_string("constant");
+    uint64_t h = local[n];
+    for (int t : graph.nodes[n].input_tensors) {
+      if (t < 0) {
+        h = hash_combine(h, kNone);
+      } else if (producers[t] >= 0) {
+        h = hash_combine(hash_combine(h, hash[producers[t]]),
+                         producer_slot[t]);
+      } else {
+        h = hash_combine(h, graph.tensors[t].is_initializer ? kConstant
+                                                            : kInput);
+      }
+    }
+    return h;
+  }
+
+  // local hash with the hashes of the consumers of every output mixed in;
+  // the consumers of one output are summed as their order means nothing
+  uint64_t down_step(int n, const std::vector<uint64_t> &hash) const {
+    static const uint64_t kOutput = hash_string("output");
+    uint64_t h = local[n];
+    for (int t : graph.nodes[n].output_tensors) {
+      if (t < 0) {
+        h = hash_combine(h, 0);
+        continue;
+      }
+      uint64_t sum = graph_output[t] ? kOutput : 0;
+      for (int c : consumers[t]) {
+        const auto &inputs = graph.nodes[c].input_tensors;
+        for (size_t slot = 0; slot < inputs.size(); ++slot) {
+          if (inputs[slot] == t) {
+            sum += hash_combine(hash[c], slot);
+          }
+        }
+      }
+      h = hash_combine(h, sum);
+    }
+    return h;
+  }
+
+  // hash of everything upstream of each node; producers first, so one
+  // pass in place covers every path. nodes on cycles see partial hashes.
+  std::vector<uint64_t> upstream() const {
+    std::vector<uint64_t> hash = local;
+    for (int n : order) {
+      hash[n] = up_step(n, hash);
+    }
+    return hash;
+  }
+
+  std::vector<uint64_t> downstream() const {
+    std::vector<uint64_t> hash = local;
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+      hash[*it] = down_step(*it, hash);
+    }
+    return hash;
+  }
+};
+
+class GraphMatcher {
+public:
+  GraphMatcher(const sModelGraph &before, const sModelGraph &after)
+      : _before(before), _after(after),
+        _to_after(before.nodes.size(), -1),
+        _to_before(after.nodes.size(), -1),
+        _match(before.nodes.size(), NODE_MATCH_NONE) {}
+
+  void run() {
+    // equal upstream or downstream cones pin a node down exactly. names
+    // only settle what the structure leaves open: exporters number nodes
+    // with counters, and one removed node shifts every name after it. the
+    // positional pass aligns what sits between two edits.
+    by_hash(_before.upstream(), _after.upstream());
+    by_hash(_before.downstream(), _after.downstream());
+    by_neighbours();
+    by_name();
+    by_neighbours();
+    by_position();
+    by_neighbours();
+  }
+  sGraphDiff diff() const;
+
+private:
+  sGraphIndex _before;
+  sGraphIndex _after;
+  std::vector<int> _to_after;
+  std::vector<int> _to_before;
+  // per node of before
+  std::vector<eNodeMatch> _match;
+  // pairs whose neighbours are still to be looked at
+  std::vector<std::pair<int, int>> _pending;
+
+  const sModelGraphNode &before_node(int n) const {
+    return _before.graph.nodes[n];
+  }
+  const sModelGraphNode &after_node(int n) const {
+    return _after.graph.nodes[n];
+  }
+  bool can_pair(int b, int a) const {
+    return _to_after[b] < 0 && _to_before[a] < 0 &&
+           before_node(b).op_type == after_node(a).op_type;
+  }
+  void pair(int b, int a, eNodeMatch match) {
+    _to_after[b] = a;
+    _to_before[a] = b;
+    _match[b] = match;
+    _pending.emplace_back(b, a);
+  }
+  bool neighbours_agree(int b, int a) const;
+  void by_name();
+  void by_hash(const std::vector<uint64_t> &before,
+               const std::vector<uint64_t> &after);
+  void by_neighbours();
+  void by_position();
+  void align(const std::vector<int> &before, const std::vector<int> &after);
+  sNodeDiff compare(int b, int a) const;
+};
+
+bool GraphMatcher::neighbours_agree(int b, int a) const {
+  const auto &bn = before_node(b);
+  const auto &an = after_node(a);
+  // a matched producer of the same operand, or the same graph input or
+  // initializer
+  const size_t inputs =
+      std::min(bn.input_tensors.size(), an.input_tensors.size());
+  for (size_t i = 0; i < inputs; ++i) {
+    const int bt = bn.input_tensors[i];
+    const int at = an.input_tensors[i];
+    if (bt < 0 || at < 0) {
+      continue;
+    }
+    const int bp = _before.producers[bt];
+    const int ap = _after.producers[at];
+    if (bp >= 0 ? _to_after[bp] >= 0 && _to_after[bp] == ap
+                : ap < 0 && _before.graph.tensors[bt].name ==
+                                _after.graph.tensors[at].name) {
+      return true;
+    }
+  }
+  // a matched consumer of the same output, or the same graph output
+  const size_t outputs =
+      std::min(bn.output_tensors.size(), an.output_tensors.size());
+  for (size_t o = 0; o < outputs; ++o) {
+    const int bt = bn.output_tensors[o];
+    const int at = an.output_tensors[o];
+    if (bt < 0 || at < 0) {
+      continue;
+    }
+    if (_before.graph_output[bt] && _after.graph_output[at] &&
+        _before.graph.tensors[bt].name == _after.graph.tensors[at].name) {
+      return true;
+    }
+    const auto &after_consumers = _after.consumers[at];
+    for (int c : _before.consumers[bt]) {
+      if (_to_after[c] >= 0 &&
+          std::find(after_consumers.begin(), after_consumers.end(),
+                    _to_after[c]) != after_consumers.end()) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void GraphMatcher::by_name() {
+  // sorted names; a name that occurs more than once aligns nothing
+  auto sorted_names = [](const sModelGraph &graph) {
+    std::vector<std::pair<std::string_view, int>> names;
+    names.reserve(graph.nodes.size());
+    for (size_t n = 0; n < graph.nodes.size(); ++n) {
+      if (!graph.nodes[n].name.empty()) {
+        names.emplace_back(graph.nodes[n].name, static_cast<int>(n));
+      }
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+  };
+  const auto before_names = sorted_names(_before.graph);
+  const auto after_names = sorted_names(_after.graph);
+  auto unique = [](const std::vector<std::pair<std::string_view, int>> &names,
+                   size_t i) {
+    return (i == 0 || names[i - 1].first != names[i].first) &&
+           (i + 1 == names.size() || names[i + 1].first != names[i].first);
+  };
+  // after node of the same unique name, per before node
+  std::vector<int> named(_before.graph.nodes.size(), -1);
+  std::vector<int> pending;
+  size_t i = 0;
+  size_t j = 0;
+  while (i < before_names.size() && j < after_names.size()) {
+    const int order = before_names[i].first.compare(after_names[j].first);
+    if (order < 0) {
+      ++i;
+    } else if (order > 0) {
+      ++j;
+    } else {
+      const int b = before_names[i].second;
+      const int a = after_names[j].second;
+      if (unique(before_names, i) && unique(after_names, j) &&
+          can_pair(b, a)) {
+        named[b] = a;
+        pending.push_back(b);
+      }
+      ++i;
+      ++j;
+    }
+  }
+  // a name pair holds once a neighbour agrees; each pair taken lets the
+  // name pairs next to it be looked at again
+  while (!pending.empty()) {
+    const int b = pending.back();
+    pending.pop_back();
+    const int a = named[b];
+    if (a < 0 || !can_pair(b, a) || !neighbours_agree(b, a)) {
+      continue;
+    }
+    pair(b, a, NODE_MATCH_NAME);
+    for (int t : before_node(b).input_tensors) {
+      if (t >= 0 && _before.producers[t] >= 0 &&
+          named[_before.producers[t]] >= 0) {
+        pending.push_back(_before.producers[t]);
+      }
+    }
+    for (int t : before_node(b).output_tensors) {
+      if (t < 0) {
+        continue;
+      }
+      for (int c : _before.consumers[t]) {
+        if (named[c] >= 0) {
+          pending.push_back(c);
+        }
+      }
+    }
+  }
+}
+
+void GraphMatcher::by_hash(const std::vector<uint64_t> &before,
+                           const std::vector<uint64_t> &after) {
+  // unmatched nodes with equal hashes pair up in topological order: sort
+  // both sides by (hash, position) and walk the runs of equal hashes
+  auto unmatched = [](const sGraphIndex &index,
+                      const std::vector<uint64_t> &hash,
+                      const std::vector<int> &matched) {
+    std::vector<std::pair<uint64_t, int>> keys;
+    for (size_t p = 0; p < index.order.size(); ++p) {
+      if (matched[index.order[p]] < 0) {
+        keys.emplace_back(hash[index.order[p]], static_cast<int>(p));
+      }
+    }
+    std::sort(keys.begin(), keys.end());
+    return keys;
+  };
+  const auto before_keys = unmatched(_before, before, _to_after);
+  const auto after_keys = unmatched(_after, after, _to_before);
+  size_t i = 0;
+  size_t j = 0;
+  while (i < before_keys.size() && j < after_keys.size()) {
+    if (before_keys[i].first < after_keys[j].first) {
+      ++i;
+    } else if (after_keys[j].first < before_keys[i].first) {
+      ++j;
+    } else {
+      const int b = _before.order[before_keys[i++].second];
+      const int a = _after.order[after_keys[j++].second];
+      if (can_pair(b, a)) {
+        pair(b, a, NODE_MATCH_STRUCTURE);
+      }
+    }
+  }
+}
+
+void GraphMatcher::by_neighbours() {
+  while (!_pending.empty()) {
+    const auto [b, a] = _pending.back();
+    _pending.pop_back();
+    const auto &bn = before_node(b);
+    const auto &an = after_node(a);
+
+    // producers of the same operand
+    const size_t inputs =
+        std::min(bn.input_tensors.size(), an.input_tensors.size());
+    for (size_t i = 0; i < inputs; ++i) {
+      const int bt = bn.input_tensors[i];
+      const int at = an.input_tensors[i];
+      if (bt < 0 || at < 0) {
+        continue;
+      }
+      const int bp = _before.producers[bt];
+      const int ap = _after.producers[at];
+      if (bp >= 0 && ap >= 0 && can_pair(bp, ap)) {
+        pair(bp, ap, NODE_MATCH_NEIGHBOURS);
+      }
+    }
+
+    // consumers of the same output, in order within each op type. fan-out
+    // is small, a scan beats building an index per tensor.
+    const size_t outputs =
+        std::min(bn.output_tensors.size(), an.output_tensors.size());
+    for (size_t o = 0; o < outputs; ++o) {
+      const int bt = bn.output_tensors[o];
+      const int at = an.output_tensors[o];
+      if (bt < 0 || at < 0) {
+        continue;
+      }
+      for (int c : _before.consumers[bt]) {
+        for (int candidate : _after.consumers[at]) {
+          if (can_pair(c, candidate)) {
+            pair(c, candidate, NODE_MATCH_NEIGHBOURS);
+            break;
+          }
+        }
+      }
+    }
+  }
+}
+
+void GraphMatcher::by_position() {
+  // pairs in the same relative order in both graphs split the unmatched
+  // nodes into gaps, aligned like the lines of a text diff
+  std::vector<int> before_gap;
+  std::vector<int> after_gap;
+  int last = -1;
+  auto close_gap = [&](int until) {
+    for (int p = last + 1; p < until; ++p) {
+      if (_to_after[_before.order[p]] < 0) {
+        before_gap.push_back(_before.order[p]);
+      }
+    }
+    align(before_gap, after_gap);
+    before_gap.clear();
+    after_gap.clear();
+  };
+  for (int a : _after.order) {
+    const int b = _to_before[a];
+    if (b < 0) {
+      after_gap.push_back(a);
+      continue;
+    }
+    if (_before.position[b] > last) {
+      close_gap(_before.position[b]);
+      last = _before.position[b];
+    }
+  }
+  close_gap(static_cast<int>(_before.order.size()));
+}
+
+void GraphMatcher::align(const std::vector<int> &before,
+                         const std::vector<int> &after) {
+  // Myers' shortest edit script over op types, O((N + M) D) for D edits.
+  // a gap that needs more than kMaxEdits stays unmatched.
+  constexpr int kMaxEdits = 1024;
+  const int rows = static_cast<int>(before.size());
+  const int columns = static_cast<int>(after.size());
+  if (rows == 0 || columns == 0) {
+    return;
+  }
+  auto same = [&](int x, int y) {
+    return before_node(before[x]).op_type == after_node(after[y]).op_type;
+  };
+  const int limit = std::min(rows + columns, kMaxEdits);
+  const int offset = limit + 1;
+  // furthest x on each diagonal k = x - y, kept after every step
+  std::vector<int> furthest(2 * limit + 3, 0);
+  std::vector<std::vector<int>> trace;
+  bool reached = false;
+  for (int d = 0; d <= limit && !reached; ++d) {
+    for (int k = -d; k <= d; k += 2) {
+      const bool down = k == -d || (k != d && furthest[offset + k - 1] <
+                                                  furthest[offset + k + 1]);
+      int x = down ? furthest[offset + k + 1] : furthest[offset + k - 1] + 1;
+      int y = x - k;
+      while (x < rows && y < columns && same(x, y)) {
+        ++x;
+        ++y;
+      }
+      furthest[offset + k] = x;
+      if (x >= rows && y >= columns) {
+        reached = true;
+        break;
+      }
+    }
+    trace.push_back(furthest);
+  }
+  if (!reached) {
+    return;
+  }
+  // walk the script back, pairing the diagonal runs
+  int x = rows;
+  int y = columns;
+  for (int d = static_cast<int>(trace.size()) - 1; d >= 0; --d) {
+    int start_x = 0;
+    int start_y = 0;
+    int previous_x = 0;
+    int previous_y = 0;
+    if (d > 0) {
+      const auto &v = trace[d - 1];
+      const int k = x - y;
+      const bool down =
+          k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1]);
+      const int previous_k = down ? k + 1 : k - 1;
+      previous_x = v[offset + previous_k];
+      previous_y = previous_x - previous_k;
+      start_x = down ? previous_x : previous_x + 1;
+      start_y = start_x - k;
+    }
+    while (x > start_x && y > start_y) {
+      --x;
+      --y;
+      if (can_pair(before[x], after[y])) {
+        pair(before[x], after[y], NODE_MATCH_POSITION);
+      }
+    }
+    x = previous_x;
+    y = previous_y;
+  }
+}
+
+sNodeDiff GraphMatcher::compare(int b, int a) const {
+  const auto &bn = before_node(b);
+  const auto &an = after_node(a);
+  sNodeDiff row;
+  row.before = b;
+  row.after = a;
+  row.match = _match[b];
+  row.renamed = bn.name != an.name;
+
+  auto bi = bn.attributes.begin();
+  auto ai = an.attributes.begin();
+  while (bi != bn.attributes.end() || ai != an.attributes.end()) {
+    if (ai == an.attributes.end() ||
+        (bi != bn.attributes.end() && bi->first < ai->first)) {
+      row.attributes.push_back({bi->first, bi->second, ""});
+      ++bi;
+    } else if (bi == bn.attributes.end() || ai->first < bi->first) {
+      row.attributes.push_back({ai->first, "", ai->second});
+      ++ai;
+    } else {
+      if (bi->second != ai->second) {
+        row.attributes.push_back({bi->first, bi->second, ai->second});
+      }
+      ++bi;
+      ++ai;
+    }
+  }
+
+  auto compare_shapes = [&](const std::vector<int> &before_tensors,
+                            const std::vector<int> &after_tensors,
+                            bool output) {
+    const size_t count = std::max(before_tensors.size(), after_tensors.size());
+    for (size_t i = 0; i < count; ++i) {
+      const int bt = i < before_tensors.size() ? before_tensors[i] : -1;
+      const int at = i < after_tensors.size() ? after_tensors[i] : -1;
+      if (bt >= 0 && at >= 0 &&
+          same_static_shape(_before.graph.tensors[bt],
+                            _after.graph.tensors[at])) {
+        continue;
+      }
+      sShapeChange change;
+      change.output = output;
+      change.slot = static_cast<int>(i);
+      if (bt >= 0) {
+        change.tensor = _before.graph.tensors[bt].name;
+        change.before =
+            shape_to_string(_before.graph, _before.graph.tensors[bt]);
+      }
+      if (at >= 0) {
+        change.tensor = _after.graph.tensors[at].name;
+        change.after = shape_to_string(_after.graph, _after.graph.tensors[at]);
+      }
+      if (change.before != change.after) {
+        row.shapes.push_back(std::move(change));
+      }
+    }
+  };
+  compare_shapes(bn.input_tensors, an.input_tensors, false);
+  compare_shapes(bn.output_tensors, an.output_tensors, true);
+
+  row.rewired = bn.input_tensors.size() != an.input_tensors.size();
+  for (size_t i = 0; i < bn.input_tensors.size() && !row.rewired; ++i) {
+    const int bt = bn.input_tensors[i];
+    const int at = an.input_tensors[i];
+    const int bp = bt >= 0 ? _before.producers[bt] : -1;
+    const int ap = at >= 0 ? _after.producers[at] : -1;
+    row.rewired = (bt < 0) != (at < 0) || (bp < 0) != (ap < 0) ||
+                  (bp >= 0 && (_to_after[bp] != ap ||
+                               _before.producer_slot[bt] !=
+                                   _after.producer_slot[at]));
+  }
+
+  const bool changed = row.renamed || row.rewired ||
+                       !row.attributes.empty() || !row.shapes.empty();
+  row.status = changed ? NODE_DIFF_MODIFIED : NODE_DIFF_UNCHANGED;
+  return row;
+}
+
+sGraphDiff GraphMatcher::diff() const {
+  sGraphDiff diff;
+  auto removed = [&](int b) {
+    sNodeDiff row;
+    row.before = b;
+    row.status = NODE_DIFF_REMOVED;
+    return row;
+  };
+  // walk the new order; removed nodes go in as the old order passes them
+  size_t cursor = 0;
+  for (int a : _after.order) {
+    const int b = _to_before[a];
+    if (b < 0) {
+      sNodeDiff row;
+      row.after = a;
+      row.status = NODE_DIFF_ADDED;
+      diff.rows.push_back(std::move(row));
+      continue;
+    }
+    const auto until = static_cast<size_t>(_before.position[b]);
+    for (; cursor < until; ++cursor) {
+      if (_to_after[_before.order[cursor]] < 0) {
+        diff.rows.push_back(removed(_before.order[cursor]));
+      }
+    }
+    cursor = std::max(cursor, until + 1);
+    diff.rows.push_back(compare(b, a));
+    ++diff.matched_by[_match[b]];
+  }
+  for (; cursor < _before.order.size(); ++cursor) {
+    if (_to_after[_before.order[cursor]] < 0) {
+      diff.rows.push_back(removed(_before.order[cursor]));
+    }
+  }
+  for (const auto &row : diff.rows) {
+    switch (row.status) {
+    case NODE_DIFF_UNCHANGED:
+      ++diff.unchanged;
+      break;
+    case NODE_DIFF_MODIFIED:
+      ++diff.modified;
+      break;
+    case NODE_DIFF_ADDED:
+      ++diff.added;
+      break;
+    case NODE_DIFF_REMOVED:
+      ++diff.removed;
+      break;
+    }
+  }
+  return diff;
+}
+
+// graph inputs (initializers excluded) or outputs by name, in order
+std::map<std::string, int> io_tensors(const sModelGraph &graph,
+                                      const std::vector<int> &tensors) {
+  std::map<std::string, int> named;
+  for (int t : tensors) {
+    if (t >= 0 && !graph.tensors[t].is_initializer) {
+      named.emplace(graph.tensors[t].name, t);
+    }
+  }
+  return named;
+}
+
+void diff_io(const sModelGraph &before, const sModelGraph &after,
+             bool output, std::vector<sShapeChange> &changes) {
+  const auto old_tensors =
+      io_tensors(before, output ? before.output_tensors : before.input_tensors);
+  const auto new_tensors =
+      io_tensors(after, output ? after.output_tensors : after.input_tensors);
+  auto add = [&](const std::string &name, int bt, int at) {
+    sShapeChange change;
+    change.tensor = name;
+    change.output = output;
+    if (bt >= 0) {
+      change.before = shape_to_string(before, before.tensors[bt]);
+    }
+    if (at >= 0) {
+      change.after = shape_to_string(after, after.tensors[at]);
+    }
+    if (bt < 0 || at < 0 || change.before != change.after) {
+      changes.push_back(std::move(change));
+    }
+  };
+  for (const auto &[name, t] : old_tensors) {
+    auto it = new_tensors.find(name);
+    add(name, t, it == new_tensors.end() ? -1 : it->second);
+  }
+  for (const auto &[name, t] : new_tensors) {
+    if (!old_tensors.count(name)) {
+      add(name, -1, t);
+    }
+  }
+}
+
+} // namespace
+
+const char *node_diff_status_name(eNodeDiffStatus status) {
+  switch (status) {
+  case NODE_DIFF_MODIFIED:
+    return "modified";
+  case NODE_DIFF_ADDED:
+    return "added";
+  case NODE_DIFF_REMOVED:
+    return "removed";
+  case NODE_DIFF_UNCHANGED:
+  default:
+    return "unchanged";
+  }
+}
+
+const char *node_match_name(eNodeMatch match) {
+  switch (match) {
+  case NODE_MATCH_NAME:
+    return "name";
+  case NODE_MATCH_STRUCTURE:
+    return "structure";
+  case NODE_MATCH_NEIGHBOURS:
+    return "neighbours";
+  case NODE_MATCH_POSITION:
+    return "position";
+  case NODE_MATCH_NONE:
+  default:
+    return "none";
+  }
+}
+
+sGraphDiff diff_graphs(const sModelGraph &before, const sModelGraph &after) {
+  const auto started = std::chrono::steady_clock::now();
+  GraphMatcher matcher(before, after);
+  matcher.run();
+  sGraphDiff diff = matcher.diff();
+  diff_io(before, after, false, diff.io_changes);
+  diff_io(before, after, true, diff.io_changes);
+  diff.diff_ms = std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - started)
+                     .count();
+  return diff;
+}
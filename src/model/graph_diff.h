@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// Structural diff of two versions of a model. Nodes are aligned by unique
+// name, then by structural hashes of the node and everything upstream or
+// downstream of it (op types, attributes and wiring), and the matched
+// regions grow to neighbours of the same op type. The unmatched nodes
+// between two aligned ones are paired by op type in topological order, as
+// a text diff pairs lines. Whatever is left over counts as removed or
+// added.
+
+enum eNodeDiffStatus {
+  NODE_DIFF_UNCHANGED = 0,
+  NODE_DIFF_MODIFIED,
+  NODE_DIFF_ADDED,
+  NODE_DIFF_REMOVED,
+};
+
+const char *node_diff_status_name(eNodeDiffStatus status);
+
+// how a pair of nodes was aligned
+enum eNodeMatch {
+  NODE_MATCH_NONE = 0,
+  NODE_MATCH_NAME,
+  NODE_MATCH_STRUCTURE,
+  NODE_MATCH_NEIGHBOURS,
+  NODE_MATCH_POSITION,
+};
+
+const char *node_match_name(eNodeMatch match);
+
+// an empty value means the attribute is absent on that side
+struct sAttributeChange {
+  std::string key;
+  std::string before;
+  std::string after;
+};
+
+// shapes as shape_to_string() prints them, empty if the tensor is absent
+struct sShapeChange {
+  std::string tensor;
+  bool output = false;
+  // operand position on the node, unused for graph inputs and outputs
+  int slot = 0;
+  std::string before;
+  std::string after;
+};
+
+// one row of the side by side view: a node of either graph or an aligned
+// pair, indices into before.nodes and after.nodes
+struct sNodeDiff {
+  int before = -1;
+  int after = -1;
+  eNodeDiffStatus status = NODE_DIFF_UNCHANGED;
+  eNodeMatch match = NODE_MATCH_NONE;
+  bool renamed = false;
+  // an input comes from a different node, or the operand count changed
+  bool rewired = false;
+  std::vector<sAttributeChange> attributes;
+  std::vector<sShapeChange> shapes;
+};
+
+struct sGraphDiff {
+  // removed nodes sit next to where they were in the old topological order
+  std::vector<sNodeDiff> rows;
+  int unchanged = 0;
+  int modified = 0;
+  int added = 0;
+  int removed = 0;
+  // aligned pairs per eNodeMatch
+  int matched_by[5] = {};
+  // graph inputs and outputs added, removed or reshaped, by name
+  std::vector<sShapeChange> io_changes;
+  double diff_ms = 0.0;
+};
+
+sGraphDiff diff_graphs(const sModelGraph &before, const sModelGraph &after);
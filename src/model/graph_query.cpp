@@ -0,0 +1,525 @@
+#include "graph_query.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+
+#include "graph_utils.h"
+
+namespace {
+
+enum eTokenKind {
+  TOKEN_WORD = 0,
+  TOKEN_NUMBER,
+  TOKEN_STRING,
+  TOKEN_SYMBOL,
+  TOKEN_END,
+};
+
+struct sToken {
+  eTokenKind kind = TOKEN_END;
+  std::string text;
+  size_t offset = 0;
+};
+
+bool is_word_char(char c) {
+  return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.';
+}
+
+bool tokenize(const std::string &text, std::vector<sToken> &tokens,
+              std::string &error) {
+  // inside brackets "<-1" is a comparison with a negative number
+  int depth = 0;
+  size_t i = 0;
+  while (i < text.size()) {
+    const char c = text[i];
+    const char next = i + 1 < text.size() ? text[i + 1] : '\0';
+    if (std::isspace(static_cast<unsigned char>(c))) {
+      ++i;
+      continue;
+    }
+    sToken token;
+    token.offset = i;
+    if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+      token.kind = TOKEN_WORD;
+      while (i < text.size() && is_word_char(text[i])) {
+        ++i;
+      }
+      token.text = text.substr(token.offset, i - token.offset);
+    } else if (std::isdigit(static_cast<unsigned char>(c)) ||
+               (c == '-' && std::isdigit(static_cast<unsigned char>(next)))) {
+      char *end = nullptr;
+      std::strtod(text.c_str() + i, &end);
+      token.kind = TOKEN_NUMBER;
+      i = static_cast<size_t>(end - text.c_str());
+      token.text = text.substr(token.offset, i - token.offset);
+    } else if (c == '"') {
+      const size_t close = text.find('"', i + 1);
+      if (close == std::string::npos) {
+        error = "unterminated string at offset " + std::to_string(i);
+        return false;
+      }
+      token.kind = TOKEN_STRING;
+      token.text = text.substr(i + 1, close - i - 1);
+      i = close + 1;
+    } else {
+      const std::string pair = text.substr(i, 2);
+      token.kind = TOKEN_SYMBOL;
+      if (pair == "->" || pair == "==" || pair == "!=" || pair == "<=" ||
+          pair == ">=" || (pair == "<-" && depth == 0)) {
+        token.text = pair;
+        i += 2;
+      } else if (std::string("[]{},*<>~").find(c) != std::string::npos) {
+        token.text = std::string(1, c);
+        depth += c == '[' ? 1 : c == ']' ? -1 : 0;
+        ++i;
+      } else {
+        error = std::string("unexpected '") + c + "' at offset " +
+                std::to_string(i);
+        return false;
+      }
+    }
+    tokens.push_back(std::move(token));
+  }
+  sToken end;
+  end.offset = text.size();
+  tokens.push_back(end);
+  return true;
+}
+
+class QueryParser {
+public:
+  QueryParser(const std::vector<sToken> &tokens, std::string &error)
+      : _tokens(tokens), _error(error) {}
+
+  bool parse(sGraphQuery &query) {
+    query.steps.clear();
+    sQueryStep step;
+    if (!parse_step(step)) {
+      return false;
+    }
+    query.steps.push_back(std::move(step));
+    while (peek().kind != TOKEN_END) {
+      sQueryStep next;
+      if (!parse_arrow(next) || !parse_step(next)) {
+        return false;
+      }
+      query.steps.push_back(std::move(next));
+    }
+    return true;
+  }
+
+private:
+  const std::vector<sToken> &_tokens;
+  std::string &_error;
+  size_t _position = 0;
+
+  const sToken &peek() const { return _tokens[_position]; }
+  bool is_symbol(const char *symbol) const {
+    return peek().kind == TOKEN_SYMBOL && peek().text == symbol;
+  }
+  bool fail(const std::string &expected) {
+    const auto &token = peek();
+    _error = "expected " + expected + " at offset " +
+             std::to_string(token.offset);
+    if (token.kind != TOKEN_END) {
+      _error += ", found '" + token.text + "'";
+    }
+    return false;
+  }
+  bool expect(const char *symbol) {
+    if (!is_symbol(symbol)) {
+      return fail(std::string("'") + symbol + "'");
+    }
+    ++_position;
+    return true;
+  }
+  bool parse_int(int &value) {
+    if (peek().kind != TOKEN_NUMBER) {
+      return fail("a hop count");
+    }
+    char *end = nullptr;
+    const long parsed = std::strtol(peek().text.c_str(), &end, 10);
+    if (*end != '\0' || parsed < 0 || parsed > INT32_MAX) {
+      return fail("a hop count");
+    }
+    value = static_cast<int>(parsed);
+    ++_position;
+    return true;
+  }
+
+  bool parse_step(sQueryStep &step) {
+    if (peek().kind == TOKEN_WORD) {
+      step.op_type = peek().text;
+    } else if (!is_symbol("*")) {
+      return fail("an op type or *");
+    }
+    ++_position;
+    if (!is_symbol("[")) {
+      return true;
+    }
+    ++_position;
+    while (true) {
+      sQueryCondition condition;
+      if (!parse_condition(condition)) {
+        return false;
+      }
+      step.conditions.push_back(std::move(condition));
+      if (peek().kind == TOKEN_WORD && peek().text == "and") {
+        ++_position;
+        continue;
+      }
+      return expect("]");
+    }
+  }
+
+  bool parse_condition(sQueryCondition &condition) {
+    if (peek().kind != TOKEN_WORD) {
+      return fail("a property");
+    }
+    condition.property = peek().text;
+    ++_position;
+    static const std::pair<const char *, eQueryCompare> kCompares[] = {
+        {"==", QUERY_EQUAL},         {"!=", QUERY_NOT_EQUAL},
+        {"<", QUERY_LESS},           {"<=", QUERY_LESS_EQUAL},
+        {">", QUERY_GREATER},        {">=", QUERY_GREATER_EQUAL},
+        {"~", QUERY_CONTAINS},
+    };
+    auto it = std::find_if(std::begin(kCompares), std::end(kCompares),
+                           [&](const auto &c) { return is_symbol(c.first); });
+    if (it == std::end(kCompares)) {
+      return fail("a comparison");
+    }
+    condition.compare = it->second;
+    ++_position;
+    const auto &value = peek();
+    if (value.kind != TOKEN_WORD && value.kind != TOKEN_NUMBER &&
+        value.kind != TOKEN_STRING) {
+      return fail("a value");
+    }
+    condition.value = value.text;
+    condition.value_is_property = value.kind == TOKEN_WORD;
+    ++_position;
+    return true;
+  }
+
+  bool parse_arrow(sQueryStep &step) {
+    if (!is_symbol("->") && !is_symbol("<-")) {
+      return fail("'->' or '<-'");
+    }
+    step.upstream = peek().text == "<-";
+    ++_position;
+    if (!is_symbol("{")) {
+      return true;
+    }
+    ++_position;
+    step.min_hops = 1;
+    if (!parse_int(step.max_hops)) {
+      return false;
+    }
+    if (is_symbol(",")) {
+      ++_position;
+      step.min_hops = step.max_hops;
+      if (!parse_int(step.max_hops)) {
+        return false;
+      }
+    }
+    if (step.min_hops < 1 || step.max_hops < step.min_hops) {
+      _error = "hop range must satisfy 1 <= min <= max";
+      return false;
+    }
+    return expect("}");
+  }
+};
+
+bool to_number(const std::string &text, double &value) {
+  if (text.empty()) {
+    return false;
+  }
+  char *end = nullptr;
+  value = std::strtod(text.c_str(), &end);
+  return *end == '\0';
+}
+
+bool node_property(const sModelGraph &graph, int node,
+                   const std::string &name, std::string &value) {
+  const auto &n = graph.nodes[node];
+  auto count = [](const std::vector<int> &tensors) {
+    return std::to_string(
+        std::count_if(tensors.begin(), tensors.end(), [](int t) {
+          return t >= 0;
+        }));
+  };
+  if (name == "name") {
+    value = n.name;
+  } else if (name == "op") {
+    value = n.op_type;
+  } else if (name == "inputs") {
+    value = count(n.input_tensors);
+  } else if (name == "outputs") {
+    value = count(n.output_tensors);
+  } else if (name == "channels") {
+    // dim 1 of the first input, else C / group of a Conv weight times group
+    const int input = n.input_tensors.empty() ? -1 : n.input_tensors[0];
+    const int weight = n.input_tensors.size() > 1 ? n.input_tensors[1] : -1;
+    if (input >= 0 && graph.tensors[input].shape.size() > 1 &&
+        graph.tensors[input].shape[1] >= 0) {
+      value = std::to_string(graph.tensors[input].shape[1]);
+    } else if (n.op_type == "Conv" && weight >= 0 &&
+               graph.tensors[weight].shape.size() > 1 &&
+               graph.tensors[weight].shape[1] >= 0) {
+      value = std::to_string(graph.tensors[weight].shape[1] *
+                             attribute_int(n, "group", 1));
+    } else {
+      return false;
+    }
+  } else {
+    auto it = n.attributes.find(name);
+    if (it == n.attributes.end()) {
+      return false;
+    }
+    value = it->second;
+  }
+  return true;
+}
+
+bool compare_values(const std::string &left, eQueryCompare compare,
+                    const std::string &right) {
+  if (compare == QUERY_CONTAINS) {
+    return left.find(right) != std::string::npos;
+  }
+  double a = 0.0;
+  double b = 0.0;
+  const bool numeric = to_number(left, a) && to_number(right, b);
+  const int order = numeric ? (a < b ? -1 : a > b ? 1 : 0)
+                            : left.compare(right);
+  switch (compare) {
+  case QUERY_NOT_EQUAL:
+    return order != 0;
+  case QUERY_LESS:
+    return order < 0;
+  case QUERY_LESS_EQUAL:
+    return order <= 0;
+  case QUERY_GREATER:
+    return order > 0;
+  case QUERY_GREATER_EQUAL:
+    return order >= 0;
+  case QUERY_EQUAL:
+  default:
+    return order == 0;
+  }
+}
+
+// depth first over the steps, breadth first over the hops of each arrow
+class QuerySearch {
+public:
+  QuerySearch(const GraphIndex &index, const sGraphQuery &query,
+              size_t max_matches, sQueryResult &result)
+      : _index(index), _query(query), _max_matches(max_matches),
+        _result(result), _seen(query.steps.size()),
+        _parent(query.steps.size()), _epoch(query.steps.size(), 0) {
+    const size_t count = index.graph().nodes.size();
+    for (size_t level = 1; level < query.steps.size(); ++level) {
+      _seen[level].assign(count, 0);
+      _parent[level].assign(count, -1);
+    }
+  }
+
+  void run() {
+    const auto &first = _query.steps[0];
+    auto start = [&](int node) {
+      if (!_result.truncated && matches(first, node)) {
+        _anchors.push_back(node);
+        extend(1, node);
+        _anchors.pop_back();
+      }
+    };
+    if (!first.op_type.empty()) {
+      for (int node : _index.nodes_of(first.op_type)) {
+        start(node);
+      }
+      return;
+    }
+    const int count = static_cast<int>(_index.graph().nodes.size());
+    for (int node = 0; node < count; ++node) {
+      start(node);
+    }
+  }
+
+private:
+  const GraphIndex &_index;
+  const sGraphQuery &_query;
+  size_t _max_matches;
+  sQueryResult &_result;
+  // per step: visit stamps and BFS parents, reused across searches
+  std::vector<std::vector<uint32_t>> _seen;
+  std::vector<std::vector<int>> _parent;
+  std::vector<uint32_t> _epoch;
+  std::vector<int> _anchors;
+  std::vector<int> _path;
+
+  bool matches(const sQueryStep &step, int node) const {
+    const auto &graph = _index.graph();
+    if (!step.op_type.empty() && graph.nodes[node].op_type != step.op_type) {
+      return false;
+    }
+    std::string left;
+    std::string right;
+    for (const auto &condition : step.conditions) {
+      if (!node_property(graph, node, condition.property, left)) {
+        return false;
+      }
+      // a bare word the node has no property for is taken literally
+      if (!condition.value_is_property ||
+          !node_property(graph, node, condition.value, right)) {
+        right = condition.value;
+      }
+      if (!compare_values(left, condition.compare, right)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void record() {
+    if (_result.matches.size() >= _max_matches) {
+      _result.truncated = true;
+      return;
+    }
+    sQueryMatch match;
+    match.anchors = _anchors;
+    match.nodes = _anchors;
+    match.nodes.insert(match.nodes.end(), _path.begin(), _path.end());
+    std::sort(match.nodes.begin(), match.nodes.end());
+    match.nodes.erase(std::unique(match.nodes.begin(), match.nodes.end()),
+                      match.nodes.end());
+    _result.matches.push_back(std::move(match));
+  }
+
+  void extend(size_t level, int from) {
+    if (level == _query.steps.size()) {
+      record();
+      return;
+    }
+    const auto &step = _query.steps[level];
+    auto &seen = _seen[level];
+    auto &parent = _parent[level];
+    const uint32_t stamp = ++_epoch[level];
+    seen[from] = stamp;
+    std::vector<int> frontier{from};
+    std::vector<int> next;
+    for (int hop = 1; hop <= step.max_hops && !frontier.empty(); ++hop) {
+      next.clear();
+      for (int node : frontier) {
+        const auto neighbours = step.upstream ? _index.predecessors(node)
+                                              : _index.successors(node);
+        for (int neighbour : neighbours) {
+          if (seen[neighbour] != stamp) {
+            seen[neighbour] = stamp;
+            parent[neighbour] = node;
+            next.push_back(neighbour);
+          }
+        }
+      }
+      if (hop >= step.min_hops) {
+        for (int node : next) {
+          if (_result.truncated) {
+            return;
+          }
+          if (!matches(step, node)) {
+            continue;
+          }
+          const size_t path_size = _path.size();
+          for (int n = parent[node]; n != from; n = parent[n]) {
+            _path.push_back(n);
+          }
+          _anchors.push_back(node);
+          extend(level + 1, node);
+          _anchors.pop_back();
+          _path.resize(path_size);
+        }
+      }
+      frontier.swap(next);
+    }
+  }
+};
+
+} // namespace
+
+bool parse_graph_query(const std::string &text, sGraphQuery &query,
+                       std::string &error) {
+  std::vector<sToken> tokens;
+  if (!tokenize(text, tokens, error)) {
+    return false;
+  }
+  return QueryParser(tokens, error).parse(query);
+}
+
+GraphIndex::GraphIndex(const sModelGraph &graph) : _graph(graph) {
+  const auto producers = tensor_producers(graph);
+  const auto consumers = tensor_consumers(graph);
+  const size_t count = graph.nodes.size();
+  _successor_offsets.reserve(count + 1);
+  _predecessor_offsets.reserve(count + 1);
+  _successor_offsets.push_back(0);
+  _predecessor_offsets.push_back(0);
+  std::vector<int> row;
+  auto append = [&](std::vector<int> &values, std::vector<int> &offsets) {
+    std::sort(row.begin(), row.end());
+    row.erase(std::unique(row.begin(), row.end()), row.end());
+    values.insert(values.end(), row.begin(), row.end());
+    offsets.push_back(static_cast<int>(values.size()));
+    row.clear();
+  };
+  for (size_t n = 0; n < count; ++n) {
+    const auto &node = graph.nodes[n];
+    _by_op[node.op_type].push_back(static_cast<int>(n));
+    for (int t : node.output_tensors) {
+      if (t >= 0) {
+        row.insert(row.end(), consumers[t].begin(), consumers[t].end());
+      }
+    }
+    append(_successors, _successor_offsets);
+    for (int t : node.input_tensors) {
+      if (t >= 0 && producers[t] >= 0) {
+        row.push_back(producers[t]);
+      }
+    }
+    append(_predecessors, _predecessor_offsets);
+  }
+}
+
+const std::vector<int> &GraphIndex::nodes_of(const std::string &op_type) const {
+  static const std::vector<int> kNone;
+  auto it = _by_op.find(op_type);
+  return it == _by_op.end() ? kNone : it->second;
+}
+
+sNodeSpan GraphIndex::successors(int node) const {
+  const int *base = _successors.data();
+  return {base + _successor_offsets[node], base + _successor_offsets[node + 1]};
+}
+
+sNodeSpan GraphIndex::predecessors(int node) const {
+  const int *base = _predecessors.data();
+  return {base + _predecessor_offsets[node],
+          base + _predecessor_offsets[node + 1]};
+}
+
+sQueryResult run_graph_query(const GraphIndex &index, const std::string &text,
+                             size_t max_matches) {
+  const auto started = std::chrono::steady_clock::now();
+  sQueryResult result;
+  sGraphQuery query;
+  if (!parse_graph_query(text, query, result.error)) {
+    return result;
+  }
+  QuerySearch(index, query, max_matches, result).run();
+  result.ok = true;
+  result.query_ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - started)
+                        .count();
+  return result;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+
+// Pattern queries over sModelGraph. A query is a chain of steps joined by
+// arrows, for example
+//
+//   MatMul ->{3} Softmax          a MatMul whose output reaches a Softmax
+//                                 in at most 3 hops
+//   Conv[group == channels]       depthwise convolutions
+//   Conv[group > 1] -> Relu       grouped convolutions followed by Relu
+//   *[name ~ "attn"] <- Gather    nodes named *attn* fed by a Gather
+//
+// A step is an op type or * with optional conditions in brackets joined by
+// "and". A condition compares a property with a number, a quoted string or
+// another property: the node's attributes, or name, op, inputs, outputs
+// and channels (dim 1 of the first input). A bare word the node has no
+// property for is taken literally, as in op == Softmax. Values compare as
+// numbers when both sides are numbers; ~ tests for a substring.
+//
+// "->" follows outputs to their consumers, "<-" inputs to their producers;
+// {n} allows 1 to n hops and {m,n} m to n.
+
+enum eQueryCompare {
+  QUERY_EQUAL = 0,
+  QUERY_NOT_EQUAL,
+  QUERY_LESS,
+  QUERY_LESS_EQUAL,
+  QUERY_GREATER,
+  QUERY_GREATER_EQUAL,
+  QUERY_CONTAINS,
+};
+
+struct sQueryCondition {
+  std::string property;
+  eQueryCompare compare = QUERY_EQUAL;
+  std::string value;
+  // unquoted word, looked up as a property of the same node first
+  bool value_is_property = false;
+};
+
+struct sQueryStep {
+  // empty matches any op
+  std::string op_type;
+  std::vector<sQueryCondition> conditions;
+  // distance from the node of the previous step, unused on the first
+  int min_hops = 1;
+  int max_hops = 1;
+  bool upstream = false;
+};
+
+struct sGraphQuery {
+  std::vector<sQueryStep> steps;
+};
+
+bool parse_graph_query(const std::string &text, sGraphQuery &query,
+                       std::string &error);
+
+// neighbours of a node, a row of a CSR adjacency
+struct sNodeSpan {
+  const int *first = nullptr;
+  const int *last = nullptr;
+
+  const int *begin() const { return first; }
+  const int *end() const { return last; }
+  size_t size() const { return static_cast<size_t>(last - first); }
+};
+
+// op type index and CSR adjacency of a graph, built once and shared by
+// every query. the graph must outlive the index.
+class GraphIndex {
+public:
+  explicit GraphIndex(const sModelGraph &graph);
+
+  const sModelGraph &graph() const { return _graph; }
+  // nodes of an op type in index order
+  const std::vector<int> &nodes_of(const std::string &op_type) const;
+  // distinct consumers of the node's outputs, producers of its inputs
+  sNodeSpan successors(int node) const;
+  sNodeSpan predecessors(int node) const;
+
+private:
+  const sModelGraph &_graph;
+  std::unordered_map<std::string, std::vector<int>> _by_op;
+  // neighbours of node n are _successors[_successor_offsets[n]] up to
+  // _successors[_successor_offsets[n + 1]]
+  std::vector<int> _successor_offsets;
+  std::vector<int> _successors;
+  std::vector<int> _predecessor_offsets;
+  std::vector<int> _predecessors;
+};
+
+struct sQueryMatch {
+  // node matched by each step
+  std::vector<int> anchors;
+  // anchors and the nodes on the paths between them, ascending
+  std::vector<int> nodes;
+};
+
+struct sQueryResult {
+  bool ok = false;
+  std::string error;
+  std::vector<sQueryMatch> matches;
+  // stopped at max_matches
+  bool truncated = false;
+  double query_ms = 0.0;
+};
+
+sQueryResult run_graph_query(const GraphIndex &index, const std::string &text,
+                             size_t max_matches = 10000);
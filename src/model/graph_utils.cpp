@@ -0,0 +1,154 @@
+#include "graph_utils.h"
+
+#include <cstdlib>
+#include <functional>
+#include <queue>
+
+int edge_tensor_index(const sModelGraph &graph, int edge_index) {
+  if (edge_index < 0 || edge_index >= static_cast<int>(graph.edges.size())) {
+    return -1;
+  }
+  const int tensor_index = graph.edges[edge_index].tensor_index;
+  if (tensor_index < 0 ||
+      tensor_index >= static_cast<int>(graph.tensors.size())) {
+    return -1;
+  }
+  return tensor_index;
+}
+
+std::vector<int> topological_order(const sModelGraph &graph) {
+  const int node_count = static_cast<int>(graph.nodes.size());
+  std::vector<int> pending_inputs(node_count, 0);
+  for (const auto &edge : graph.edges) {
+    if (edge.source_node >= 0 && edge.target_node >= 0 &&
+        edge.target_node < node_count) {
+      ++pending_inputs[edge.target_node];
+    }
+  }
+
+  // a min-heap keeps the original node order among ready nodes, which is
+  // the exporter's schedule for already sorted ONNX graphs.
+  std::priority_queue<int, std::vector<int>, std::greater<int>> ready;
+  for (int i = 0; i < node_count; ++i) {
+    if (pending_inputs[i] == 0) {
+      ready.push(i);
+    }
+  }
+
+  std::vector<int> order;
+  std::vector<bool> scheduled(node_count, false);
+  order.reserve(node_count);
+  while (!ready.empty()) {
+    const int current = ready.top();
+    ready.pop();
+    order.push_back(current);
+    scheduled[current] = true;
+    for (int edge_index : graph.nodes[current].output_edges) {
+      if (edge_index < 0 ||
+          edge_index >= static_cast<int>(graph.edges.size())) {
+        continue;
+      }
+      const int target = graph.edges[edge_index].target_node;
+      if (target >= 0 && target < node_count && --pending_inputs[target] == 0) {
+        ready.push(target);
+      }
+    }
+  }
+  for (int i = 0; i < node_count; ++i) {
+    if (!scheduled[i]) {
+      order.push_back(i);
+    }
+  }
+  return order;
+}
+
+std::vector<int> tensor_producers(const sModelGraph &graph) {
+  std::vector<int> producers(graph.tensors.size(), -1);
+  for (int i = 0; i < static_cast<int>(graph.nodes.size()); ++i) {
+    for (int tensor_index : graph.nodes[i].output_tensors) {
+      if (tensor_index >= 0) {
+        producers[tensor_index] = i;
+      }
+    }
+  }
+  return producers;
+}
+
+std::vector<std::vector<int>> tensor_consumers(const sModelGraph &graph) {
+  std::vector<std::vector<int>> consumers(graph.tensors.size());
+  for (int i = 0; i < static_cast<int>(graph.nodes.size()); ++i) {
+    for (int tensor_index : graph.nodes[i].input_tensors) {
+      if (tensor_index < 0) {
+        continue;
+      }
+      auto &list = consumers[tensor_index];
+      // a node reading the same tensor twice is one consumer
+      if (list.empty() || list.back() != i) {
+        list.push_back(i);
+      }
+    }
+  }
+  return consumers;
+}
+
+int64_t attribute_int(const sModelGraphNode &node, const std::string &key,
+                      int64_t fallback) {
+  auto it = node.attributes.find(key);
+  if (it == node.attributes.end() || it->second.empty()) {
+    return fallback;
+  }
+  char *end = nullptr;
+  const long long value = std::strtoll(it->second.c_str(), &end, 10);
+  return end != it->second.c_str() ? value : fallback;
+}
+
+float attribute_float(const sModelGraphNode &node, const std::string &key,
+                      float fallback) {
+  auto it = node.attributes.find(key);
+  if (it == node.attributes.end() || it->second.empty()) {
+    return fallback;
+  }
+  char *end = nullptr;
+  const float value = std::strtof(it->second.c_str(), &end);
+  return end != it->second.c_str() ? value : fallback;
+}
+
+std::vector<int64_t> attribute_ints(const sModelGraphNode &node,
+                                    const std::string &key) {
+  std::vector<int64_t> values;
+  auto it = node.attributes.find(key);
+  if (it == node.attributes.end()) {
+    return values;
+  }
+  const char *cursor = it->second.c_str();
+  while (*cursor != '\0') {
+    char *end = nullptr;
+    const long long value = std::strtoll(cursor, &end, 10);
+    if (end == cursor) {
+      break;
+    }
+    values.push_back(value);
+    cursor = *end == ',' ? end + 1 : end;
+  }
+  return values;
+}
+
+std::string attribute_string(const sModelGraphNode &node,
+                             const std::string &key,
+                             const std::string &fallback) {
+  auto it = node.attributes.find(key);
+  return it != node.attributes.end() ? it->second : fallback;
+}
+
+uint64_t hash_string(const std::string &text) {
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : text) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+uint64_t hash_combine(uint64_t seed, uint64_t value) {
+  return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// tensor index behind an edge, -1 if the edge or tensor is invalid
+int edge_tensor_index(const sModelGraph &graph, int edge_index);
+
+// node indices in an order where every producer precedes its consumers.
+// nodes on cycles (invalid graphs) are appended in index order.
+std::vector<int> topological_order(const sModelGraph &graph);
+
+// producing node of every tensor, -1 for graph inputs and initializers
+std::vector<int> tensor_producers(const sModelGraph &graph);
+
+// consuming nodes of every tensor
+std::vector<std::vector<int>> tensor_consumers(const sModelGraph &graph);
+
+// attribute accessors. attributes are stored serialized, lists comma
+// separated; missing or malformed values yield the fallback.
+int64_t attribute_int(const sModelGraphNode &node, const std::string &key,
+                      int64_t fallback);
+float attribute_float(const sModelGraphNode &node, const std::string &key,
+                      float fallback);
+std::vector<int64_t> attribute_ints(const sModelGraphNode &node,
+                                    const std::string &key);
+std::string attribute_string(const sModelGraphNode &node,
+                             const std::string &key,
+                             const std::string &fallback = {});
+
+// FNV-1a of a string, and a hash folded into a running seed, for structural
+// hashes of nodes and subgraphs
+uint64_t hash_string(const std::string &text);
+uint64_t hash_combine(uint64_t seed, uint64_t value);
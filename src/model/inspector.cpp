@@ -1,5 +1,7 @@
 #include "inspector.h"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -11,43 +13,16 @@
 #include <onnx/onnx_pb.h>
 #include <onnxruntime_cxx_api.h>
 
-namespace {
+#include "shape_inference.h"
+#include "tensor_utils.h"
+#include "weights.h"
 
-eModelTensorDataType onnx_to_model_dtype(int onnx_type) {
-  switch (onnx_type) {
-  case onnx::TensorProto_DataType_UINT8:
-    return MODEL_TENSOR_DATA_TYPE_UINT8;
-  case onnx::TensorProto_DataType_INT8:
-    return MODEL_TENSOR_DATA_TYPE_INT8;
-  case onnx::TensorProto_DataType_UINT16:
-    return MODEL_TENSOR_DATA_TYPE_UINT16;
-  case onnx::TensorProto_DataType_INT16:
-    return MODEL_TENSOR_DATA_TYPE_INT16;
-  case onnx::TensorProto_DataType_UINT32:
-    return MODEL_TENSOR_DATA_TYPE_UINT32;
-  case onnx::TensorProto_DataType_INT32:
-    return MODEL_TENSOR_DATA_TYPE_INT32;
-  case onnx::TensorProto_DataType_UINT64:
-    return MODEL_TENSOR_DATA_TYPE_UINT64;
-  case onnx::TensorProto_DataType_INT64:
-    return MODEL_TENSOR_DATA_TYPE_INT64;
-  case onnx::TensorProto_DataType_FLOAT16:
-    return MODEL_TENSOR_DATA_TYPE_FLOAT16;
-  case onnx::TensorProto_DataType_FLOAT:
-    return MODEL_TENSOR_DATA_TYPE_FLOAT32;
-  case onnx::TensorProto_DataType_DOUBLE:
-    return MODEL_TENSOR_DATA_TYPE_DOUBLE;
-  case onnx::TensorProto_DataType_BFLOAT16:
-    return MODEL_TENSOR_DATA_TYPE_BFLOAT16;
-  case onnx::TensorProto_DataType_BOOL:
-    return MODEL_TENSOR_DATA_TYPE_BOOL;
-  default:
-    return MODEL_TENSOR_DATA_TYPE_UNDEFINED;
-  }
-}
+namespace {
 
+// symbolic dims (dim_param) are interned into graph.dim_symbols
 std::vector<int64_t>
-shape_from_tensor_type(const onnx::TypeProto::Tensor &tensor_type) {
+shape_from_tensor_type(const onnx::TypeProto::Tensor &tensor_type,
+                       sModelGraph &graph) {
   std::vector<int64_t> shape;
   if (!tensor_type.has_shape()) {
     return shape;
@@ -55,6 +30,8 @@ shape_from_tensor_type(const onnx::TypeProto::Tensor &tensor_type) {
   for (const auto &dim : tensor_type.shape().dim()) {
     if (dim.has_dim_value()) {
       shape.push_back(dim.dim_value());
+    } else if (dim.has_dim_param() && !dim.dim_param().empty()) {
+      shape.push_back(intern_dim_symbol(graph, dim.dim_param()));
     } else {
       shape.push_back(-1);
     }
@@ -75,6 +52,43 @@ shape_from_initializer(const onnx::TensorProto &initializer) {
   return {initializer.dims().begin(), initializer.dims().end()};
 }
 
+// contents of small int32/int64 tensors, which are shape operands far more
+// often than weights
+bool int_values_from_tensor(const onnx::TensorProto &tensor,
+                            std::vector<int64_t> &values) {
+  constexpr int64_t kMaxValues = 64;
+  int64_t count = 1;
+  for (int64_t dim : tensor.dims()) {
+    count *= dim;
+  }
+  if (count > kMaxValues ||
+      tensor.data_location() == onnx::TensorProto_DataLocation_EXTERNAL) {
+    return false;
+  }
+  values.clear();
+  if (tensor.data_type() == onnx::TensorProto_DataType_INT64) {
+    if (tensor.has_raw_data()) {
+      const auto &raw = tensor.raw_data();
+      values.resize(raw.size() / sizeof(int64_t));
+      std::memcpy(values.data(), raw.data(), values.size() * sizeof(int64_t));
+    } else {
+      values.assign(tensor.int64_data().begin(), tensor.int64_data().end());
+    }
+  } else if (tensor.data_type() == onnx::TensorProto_DataType_INT32) {
+    if (tensor.has_raw_data()) {
+      const auto &raw = tensor.raw_data();
+      std::vector<int32_t> narrow(raw.size() / sizeof(int32_t));
+      std::memcpy(narrow.data(), raw.data(), narrow.size() * sizeof(int32_t));
+      values.assign(narrow.begin(), narrow.end());
+    } else {
+      values.assign(tensor.int32_data().begin(), tensor.int32_data().end());
+    }
+  } else {
+    return false;
+  }
+  return static_cast<int64_t>(values.size()) == count;
+}
+
 template <typename Field>
 std::string join_repeated_field(const Field &field, char delimiter) {
   std::string serialized;
@@ -100,6 +114,32 @@ join_string_field(const google::protobuf::RepeatedPtrField<std::string> &field,
   return serialized;
 }
 
+void describe_constant(const onnx::NodeProto &node, sModelTensor &tensor) {
+  for (const auto &attribute : node.attribute()) {
+    if (attribute.name() == "value" && attribute.has_t()) {
+      tensor.shape = shape_from_initializer(attribute.t());
+      tensor.tensorDataType = onnx_to_model_dtype(attribute.t().data_type());
+      tensor.has_values = int_values_from_tensor(attribute.t(), tensor.values);
+    } else if (attribute.name() == "value_int") {
+      tensor.shape.clear();
+      tensor.tensorDataType = MODEL_TENSOR_DATA_TYPE_INT64;
+      tensor.values = {attribute.i()};
+      tensor.has_values = true;
+    } else if (attribute.name() == "value_ints") {
+      tensor.shape = {attribute.ints_size()};
+      tensor.tensorDataType = MODEL_TENSOR_DATA_TYPE_INT64;
+      tensor.values.assign(attribute.ints().begin(), attribute.ints().end());
+      tensor.has_values = true;
+    } else if (attribute.name() == "value_float") {
+      tensor.shape.clear();
+      tensor.tensorDataType = MODEL_TENSOR_DATA_TYPE_FLOAT32;
+    } else if (attribute.name() == "value_floats") {
+      tensor.shape = {attribute.floats_size()};
+      tensor.tensorDataType = MODEL_TENSOR_DATA_TYPE_FLOAT32;
+    }
+  }
+}
+
 std::string attribute_to_string(const onnx::AttributeProto &attr) {
   switch (attr.type()) {
   case onnx::AttributeProto_AttributeType_FLOAT:
@@ -149,6 +189,8 @@ bool ModelInspector::load_model(const std::string &model_path) {
 
   const auto &graph_proto = model_proto.graph();
   _graph = sModelGraph{};
+  _declared_graph.reset();
+  _graph.opset = opset_version(model_proto);
 
   std::unordered_map<std::string, int> tensor_index_by_name;
   std::unordered_map<std::string, int> producer_map;
@@ -203,7 +245,8 @@ bool ModelInspector::load_model(const std::string &model_path) {
       return;
     }
     const auto &tensor_type = value_type.tensor_type();
-    ensure_tensor(value_info.name(), shape_from_tensor_type(tensor_type),
+    ensure_tensor(value_info.name(),
+                  shape_from_tensor_type(tensor_type, _graph),
                   dtype_from_tensor_type(tensor_type), false);
   };
 
@@ -211,8 +254,11 @@ bool ModelInspector::load_model(const std::string &model_path) {
     if (initializer.name().empty()) {
       continue;
     }
-    ensure_tensor(initializer.name(), shape_from_initializer(initializer),
-                  onnx_to_model_dtype(initializer.data_type()), true);
+    const int tensor_index =
+        ensure_tensor(initializer.name(), shape_from_initializer(initializer),
+                      onnx_to_model_dtype(initializer.data_type()), true);
+    auto &tensor = _graph.tensors[tensor_index];
+    tensor.has_values = int_values_from_tensor(initializer, tensor.values);
   }
 
   for (const auto &input : graph_proto.input()) {
@@ -221,7 +267,7 @@ bool ModelInspector::load_model(const std::string &model_path) {
     eModelTensorDataType dtype = MODEL_TENSOR_DATA_TYPE_UNDEFINED;
     if (value_type.has_tensor_type()) {
       const auto &tensor_type = value_type.tensor_type();
-      shape = shape_from_tensor_type(tensor_type);
+      shape = shape_from_tensor_type(tensor_type, _graph);
       dtype = dtype_from_tensor_type(tensor_type);
     }
     const int tensor_index =
@@ -264,10 +310,12 @@ bool ModelInspector::load_model(const std::string &model_path) {
     const int node_index = static_cast<int>(_graph.nodes.size()) - 1;
     for (const auto &input_name : node_proto.input()) {
       if (input_name.empty()) {
+        current_node.input_tensors.push_back(-1);
         continue;
       }
       const int tensor_index = ensure_tensor(
           input_name, {}, MODEL_TENSOR_DATA_TYPE_UNDEFINED, false);
+      current_node.input_tensors.push_back(tensor_index);
       if (tensor_index < 0) {
         continue;
       }
@@ -286,11 +334,21 @@ bool ModelInspector::load_model(const std::string &model_path) {
 
     for (const auto &output_name : node_proto.output()) {
       if (output_name.empty()) {
+        current_node.output_tensors.push_back(-1);
         continue;
       }
-      ensure_tensor(output_name, {}, MODEL_TENSOR_DATA_TYPE_UNDEFINED, false);
+      current_node.output_tensors.push_back(ensure_tensor(
+          output_name, {}, MODEL_TENSOR_DATA_TYPE_UNDEFINED, false));
       producer_map[output_name] = node_index;
     }
+
+    // Constant outputs carry their shape, type and small integer contents
+    if (current_node.op_type == "Constant" &&
+        !current_node.output_tensors.empty() &&
+        current_node.output_tensors[0] >= 0) {
+      describe_constant(node_proto,
+                        _graph.tensors[current_node.output_tensors[0]]);
+    }
     ++node_counter;
   }
 
@@ -314,6 +372,25 @@ bool ModelInspector::load_model(const std::string &model_path) {
     }
   }
 
+  _shape_inference = ShapeInference();
+  _shape_inference.run(_graph);
+  ++_revision;
+
   std::cout << "Number of nodes: " << _graph.nodes.size() << std::endl;
   return true;
 }
+
+bool ModelInspector::set_input_shape(int tensor_index,
+                                     const std::vector<int64_t> &shape) {
+  if (std::find(_graph.input_tensors.begin(), _graph.input_tensors.end(),
+                tensor_index) == _graph.input_tensors.end()) {
+    std::cerr << "not a graph input: " << tensor_index << std::endl;
+    return false;
+  }
+  if (!_declared_graph) {
+    _declared_graph = std::make_unique<sModelGraph>(_graph);
+  }
+  _shape_inference.update_input_shape(_graph, tensor_index, shape);
+  ++_revision;
+  return true;
+}
@@ -1,18 +1,44 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "shape_inference.h"
 #include "types.h"
 
 class ModelInspector {
 private:
   std::string _model_path;
   sModelGraph _graph;
+  ShapeInference _shape_inference;
+  // _graph before the first set_input_shape(), null until then
+  std::unique_ptr<sModelGraph> _declared_graph;
+  // bumped whenever _graph changes
+  uint64_t _revision = 0;
 
 public:
   ModelInspector(const std::string &model_path);
   std::string getName();
+  const std::string &model_path() const { return _model_path; }
   bool load_model(const std::string &model_path);
   const sModelGraph &graph() const { return _graph; }
+  // the graph with the shapes the model declares, without the input shapes
+  // set since; what rewrites written back to the model must see
+  const sModelGraph &declared_graph() const {
+    return _declared_graph ? *_declared_graph : _graph;
+  }
   const std::vector<sModelGraphNode> &nodes() const { return _graph.nodes; }
+  uint64_t revision() const { return _revision; }
+
+  // dim value of a named symbolic dim, added to the graph if new
+  int64_t dim_symbol(const std::string &name) {
+    return intern_dim_symbol(_graph, name);
+  }
+  // replaces the shape of a graph input and re-infers the shapes downstream
+  bool set_input_shape(int tensor_index, const std::vector<int64_t> &shape);
+  const sShapeInferenceStats &shape_inference_stats() const {
+    return _shape_inference.stats();
+  }
 };
@@ -0,0 +1,136 @@
+#include "mapped_file.h"
+
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(const std::string &path) {
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return;
+  }
+  _file = file;
+  _size = static_cast<size_t>(size.QuadPart);
+  _ok = true;
+  if (_size == 0) {
+    return;
+  }
+  _mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (_mapping) {
+    _data = static_cast<const uint8_t *>(
+        MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+  }
+  if (!_data) {
+    unmap();
+  }
+}
+
+void MappedFile::unmap() {
+  if (_data) {
+    UnmapViewOfFile(_data);
+  }
+  if (_mapping) {
+    CloseHandle(_mapping);
+  }
+  if (_file) {
+    CloseHandle(_file);
+  }
+  _data = nullptr;
+  _mapping = nullptr;
+  _file = nullptr;
+  _size = 0;
+  _ok = false;
+}
+
+void MappedFile::advise_sequential() const {}
+
+#else
+
+MappedFile::MappedFile(const std::string &path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    return;
+  }
+  _size = static_cast<size_t>(info.st_size);
+  _ok = true;
+  if (_size > 0) {
+    void *data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      _size = 0;
+      _ok = false;
+    } else {
+      _data = static_cast<const uint8_t *>(data);
+    }
+  }
+  // the mapping keeps its own reference to the file
+  close(fd);
+}
+
+void MappedFile::unmap() {
+  if (_data) {
+    munmap(const_cast<uint8_t *>(_data), _size);
+  }
+  _data = nullptr;
+  _size = 0;
+  _ok = false;
+}
+
+void MappedFile::advise_sequential() const {
+  if (_data) {
+    madvise(const_cast<uint8_t *>(_data), _size, MADV_SEQUENTIAL);
+  }
+}
+
+#endif
+
+MappedFile::~MappedFile() { unmap(); }
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : _data(std::exchange(other._data, nullptr)),
+      _size(std::exchange(other._size, 0)),
+      _ok(std::exchange(other._ok, false))
+#if defined(_WIN32)
+      ,
+      _file(std::exchange(other._file, nullptr)),
+      _mapping(std::exchange(other._mapping, nullptr))
+#endif
+{
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    unmap();
+    _data = std::exchange(other._data, nullptr);
+    _size = std::exchange(other._size, 0);
+    _ok = std::exchange(other._ok, false);
+#if defined(_WIN32)
+    _file = std::exchange(other._file, nullptr);
+    _mapping = std::exchange(other._mapping, nullptr);
+#endif
+  }
+  return *this;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file. Pages are read in as they are
+// touched and can be dropped again by the OS, so a pass over multi-GB
+// weights streams through the page cache instead of a heap copy.
+class MappedFile {
+public:
+  MappedFile() = default;
+  explicit MappedFile(const std::string &path);
+  ~MappedFile();
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // false if the file could not be opened or mapped; empty files map to
+  // no data but are ok
+  bool ok() const { return _ok; }
+  const uint8_t *data() const { return _data; }
+  size_t size() const { return _size; }
+  // tells the OS the mapping is read front to back
+  void advise_sequential() const;
+
+private:
+  void unmap();
+
+  const uint8_t *_data = nullptr;
+  size_t _size = 0;
+  bool _ok = false;
+#if defined(_WIN32)
+  void *_file = nullptr;
+  void *_mapping = nullptr;
+#endif
+};
@@ -0,0 +1,202 @@
+#include "memory_planner.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "graph_utils.h"
+#include "tensor_utils.h"
+
+namespace {
+
+int64_t align_up(int64_t size, int64_t alignment) {
+  if (alignment <= 1) {
+    return size;
+  }
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+bool overlaps(const sTensorLifetime &a, const sTensorLifetime &b) {
+  return a.first <= b.last && b.first <= a.last;
+}
+
+sMemoryPlan plan_greedy_by_size(std::vector<sTensorLifetime> tensors) {
+  std::sort(tensors.begin(), tensors.end(),
+            [](const sTensorLifetime &a, const sTensorLifetime &b) {
+              if (a.size != b.size) {
+                return a.size > b.size;
+              }
+              return a.first < b.first;
+            });
+
+  sMemoryPlan plan;
+  plan.strategy = MEMORY_PLAN_GREEDY_BY_SIZE;
+  std::vector<const sTensorLifetime *> neighbours;
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    auto &tensor = tensors[i];
+    neighbours.clear();
+    for (size_t j = 0; j < i; ++j) {
+      if (overlaps(tensors[j], tensor)) {
+        neighbours.push_back(&tensors[j]);
+      }
+    }
+    std::sort(neighbours.begin(), neighbours.end(),
+              [](const sTensorLifetime *a, const sTensorLifetime *b) {
+                return a->offset < b->offset;
+              });
+
+    int64_t best_offset = -1;
+    int64_t best_gap = std::numeric_limits<int64_t>::max();
+    int64_t cursor = 0;
+    for (const auto *neighbour : neighbours) {
+      const int64_t gap = neighbour->offset - cursor;
+      if (gap >= tensor.size && gap < best_gap) {
+        best_gap = gap;
+        best_offset = cursor;
+      }
+      cursor = std::max(cursor, neighbour->offset + neighbour->size);
+    }
+    tensor.offset = best_offset >= 0 ? best_offset : cursor;
+    plan.arena_size = std::max(plan.arena_size, tensor.offset + tensor.size);
+  }
+  plan.assignments = std::move(tensors);
+  return plan;
+}
+
+sMemoryPlan plan_interval_coloring(std::vector<sTensorLifetime> tensors) {
+  std::sort(tensors.begin(), tensors.end(),
+            [](const sTensorLifetime &a, const sTensorLifetime &b) {
+              if (a.first != b.first) {
+                return a.first < b.first;
+              }
+              return a.size > b.size;
+            });
+
+  struct sBuffer {
+    int64_t size = 0;
+    // last step of the current occupant
+    int busy_until = -1;
+  };
+  std::vector<sBuffer> buffers;
+  std::vector<int> buffer_of(tensors.size(), -1);
+
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    const auto &tensor = tensors[i];
+    int best_fit = -1;
+    int largest_free = -1;
+    for (int b = 0; b < static_cast<int>(buffers.size()); ++b) {
+      if (buffers[b].busy_until >= tensor.first) {
+        continue;
+      }
+      if (buffers[b].size >= tensor.size &&
+          (best_fit < 0 || buffers[b].size < buffers[best_fit].size)) {
+        best_fit = b;
+      }
+      if (largest_free < 0 || buffers[b].size > buffers[largest_free].size) {
+        largest_free = b;
+      }
+    }
+    // no free buffer is big enough: grow the largest free one
+    int chosen = best_fit >= 0 ? best_fit : largest_free;
+    if (chosen < 0) {
+      buffers.push_back({});
+      chosen = static_cast<int>(buffers.size()) - 1;
+    }
+    buffers[chosen].size = std::max(buffers[chosen].size, tensor.size);
+    buffers[chosen].busy_until = tensor.last;
+    buffer_of[i] = chosen;
+  }
+
+  sMemoryPlan plan;
+  plan.strategy = MEMORY_PLAN_INTERVAL_COLORING;
+  std::vector<int64_t> buffer_offsets(buffers.size(), 0);
+  for (size_t b = 0; b < buffers.size(); ++b) {
+    buffer_offsets[b] = plan.arena_size;
+    plan.arena_size += buffers[b].size;
+  }
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    tensors[i].offset = buffer_offsets[buffer_of[i]];
+  }
+  plan.assignments = std::move(tensors);
+  return plan;
+}
+
+} // namespace
+
+sLivenessAnalysis analyze_liveness(const sModelGraph &graph,
+                                   int64_t batch_size) {
+  sLivenessAnalysis liveness;
+  liveness.schedule = topological_order(graph);
+  const int steps = static_cast<int>(liveness.schedule.size());
+
+  std::vector<int> step_of(graph.nodes.size(), 0);
+  for (int step = 0; step < steps; ++step) {
+    step_of[liveness.schedule[step]] = step;
+  }
+  std::vector<bool> is_graph_output(graph.tensors.size(), false);
+  for (int tensor_index : graph.output_tensors) {
+    is_graph_output[tensor_index] = true;
+  }
+
+  const auto producers = tensor_producers(graph);
+  const auto consumers = tensor_consumers(graph);
+  for (int t = 0; t < static_cast<int>(graph.tensors.size()); ++t) {
+    const auto &tensor = graph.tensors[t];
+    if (tensor.is_initializer || producers[t] < 0) {
+      continue;
+    }
+    const int64_t size = tensor_byte_size(tensor, batch_size);
+    if (size < 0) {
+      ++liveness.unsized_tensors;
+      continue;
+    }
+    sTensorLifetime lifetime;
+    lifetime.tensor = t;
+    lifetime.size = size;
+    lifetime.first = step_of[producers[t]];
+    lifetime.last = lifetime.first;
+    for (int consumer : consumers[t]) {
+      lifetime.last = std::max(lifetime.last, step_of[consumer]);
+    }
+    if (is_graph_output[t]) {
+      lifetime.last = steps - 1;
+    }
+    liveness.naive_bytes += size;
+    liveness.lifetimes.push_back(lifetime);
+  }
+
+  // difference array over the schedule
+  std::vector<int64_t> delta(steps + 1, 0);
+  for (const auto &lifetime : liveness.lifetimes) {
+    delta[lifetime.first] += lifetime.size;
+    delta[lifetime.last + 1] -= lifetime.size;
+  }
+  liveness.live_bytes.resize(steps);
+  int64_t live = 0;
+  for (int step = 0; step < steps; ++step) {
+    live += delta[step];
+    liveness.live_bytes[step] = live;
+    liveness.peak_bytes = std::max(liveness.peak_bytes, live);
+  }
+  for (int step = 0; step < steps; ++step) {
+    if (liveness.peak_bytes > 0 &&
+        liveness.live_bytes[step] == liveness.peak_bytes) {
+      liveness.peak_steps.push_back(step);
+    }
+  }
+  return liveness;
+}
+
+sMemoryPlan plan_memory(const sLivenessAnalysis &liveness,
+                        eMemoryPlanStrategy strategy, int64_t alignment) {
+  std::vector<sTensorLifetime> tensors = liveness.lifetimes;
+  for (auto &tensor : tensors) {
+    tensor.size = align_up(tensor.size, alignment);
+  }
+  switch (strategy) {
+  case MEMORY_PLAN_INTERVAL_COLORING:
+    return plan_interval_coloring(std::move(tensors));
+  case MEMORY_PLAN_GREEDY_BY_SIZE:
+  default:
+    return plan_greedy_by_size(std::move(tensors));
+  }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "types.h"
+
+// lifetime of one activation over the schedule
+struct sTensorLifetime {
+  int tensor = -1;
+  // schedule steps of the producing node and of the last consumer, inclusive
+  int first = 0;
+  int last = 0;
+  int64_t size = 0;
+  // arena offset, filled in by plan_memory
+  int64_t offset = 0;
+};
+
+struct sLivenessAnalysis {
+  // node indices in execution order
+  std::vector<int> schedule;
+  // activations produced by nodes; initializers and graph inputs are owned
+  // by the caller and not planned
+  std::vector<sTensorLifetime> lifetimes;
+  // bytes alive while each step executes
+  std::vector<int64_t> live_bytes;
+  int64_t peak_bytes = 0;
+  std::vector<int> peak_steps;
+  // every activation in its own buffer
+  int64_t naive_bytes = 0;
+  int unsized_tensors = 0;
+};
+
+enum eMemoryPlanStrategy {
+  // offsets by decreasing size, each placed into the tightest gap among
+  // the time-overlapping tensors already placed
+  MEMORY_PLAN_GREEDY_BY_SIZE = 0,
+  // tensors in order of definition share buffers whose previous occupant is
+  // dead (interval coloring), picking the best fitting free buffer
+  MEMORY_PLAN_INTERVAL_COLORING,
+};
+
+struct sMemoryPlan {
+  eMemoryPlanStrategy strategy = MEMORY_PLAN_GREEDY_BY_SIZE;
+  int64_t arena_size = 0;
+  std::vector<sTensorLifetime> assignments;
+};
+
+// unknown dims are taken as `batch_size`
+sLivenessAnalysis analyze_liveness(const sModelGraph &graph,
+                                   int64_t batch_size = 1);
+
+sMemoryPlan plan_memory(const sLivenessAnalysis &liveness,
+                        eMemoryPlanStrategy strategy, int64_t alignment = 64);
@@ -0,0 +1,597 @@
+#include "mixed_precision.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <onnx/onnx_pb.h>
+
+#include "../engine/thread_pool.h"
+#include "half.h"
+#include "weight_stats.h"
+#include "weights.h"
+
+namespace {
+
+// elements per conversion batch
+constexpr size_t kBatch = 4096;
+
+// ops whose float operands are all of one type T that onnx defines for
+// float16 and bfloat16. Resize and Upsample take float32 scales, Range and
+// ConstantOfShape pick their type from values, Cast from an attribute.
+const std::unordered_set<std::string> &half_ops() {
+  static const std::unordered_set<std::string> ops = {
+      "Abs", "Acos", "Add", "ArgMax", "ArgMin", "Asin", "Atan",
+      "AveragePool", "BatchNormalization", "Ceil", "Celu", "Clip", "Concat",
+      "Constant", "Conv", "ConvTranspose", "Cos", "CumSum", "DepthToSpace",
+      "Div", "Einsum", "Elu", "Equal", "Erf", "Exp", "Expand", "Flatten",
+      "Floor", "Gather", "GatherElements", "GatherND", "Gelu", "Gemm",
+      "GlobalAveragePool", "GlobalMaxPool", "Greater", "GreaterOrEqual",
+      "GroupNormalization", "HardSigmoid", "HardSwish", "Identity",
+      "InstanceNormalization", "LRN", "LayerNormalization", "LeakyRelu",
+      "Less", "LessOrEqual", "Log", "LogSoftmax", "MatMul", "Max", "MaxPool",
+      "Mean", "Min", "Mish", "Mul", "Neg", "PRelu", "Pad", "Pow",
+      "Reciprocal", "ReduceL1", "ReduceL2", "ReduceLogSum",
+      "ReduceLogSumExp", "ReduceMax", "ReduceMean", "ReduceMin",
+      "ReduceProd", "ReduceSum", "ReduceSumSquare", "Relu", "Reshape",
+      "Round", "ScatterElements", "ScatterND", "Selu", "Shape", "Sigmoid",
+      "Sign", "Sin", "Size", "Slice", "Softmax", "Softplus", "Softsign",
+      "SpaceToDepth", "Split", "Sqrt", "Squeeze", "Sub", "Sum", "Tanh",
+      "Tile", "TopK", "Transpose", "Trilu", "Unsqueeze", "Where",
+  };
+  return ops;
+}
+
+// first opset whose schema takes bfloat16 for an op of half_ops(); 13 for
+// the ones not listed. Einsum and Celu have no bfloat16 kernel at all.
+int bfloat16_opset(const std::string &op_type) {
+  static const std::unordered_map<std::string, int> opsets = {
+      {"CumSum", 14}, {"GreaterOrEqual", 16}, {"LeakyRelu", 16},
+      {"LessOrEqual", 16}, {"PRelu", 16}, {"Where", 16},
+      {"LayerNormalization", 17}, {"GroupNormalization", 18},
+      {"Gelu", 20}, {"Acos", 22}, {"Asin", 22}, {"Atan", 22},
+      {"AveragePool", 22}, {"Conv", 22}, {"ConvTranspose", 22},
+      {"Cos", 22}, {"Elu", 22}, {"GlobalAveragePool", 22},
+      {"GlobalMaxPool", 22}, {"HardSigmoid", 22}, {"HardSwish", 22},
+      {"InstanceNormalization", 22}, {"MaxPool", 22}, {"Mish", 22},
+      {"Round", 22}, {"Selu", 22}, {"Sin", 22}, {"Softplus", 22},
+      {"Softsign", 22}, {"TopK", 24}, {"Celu", INT_MAX},
+      {"Einsum", INT_MAX},
+  };
+  auto it = opsets.find(op_type);
+  return it == opsets.end() ? 13 : it->second;
+}
+
+bool other_float_type(eModelTensorDataType dtype) {
+  return dtype == MODEL_TENSOR_DATA_TYPE_FLOAT16 ||
+         dtype == MODEL_TENSOR_DATA_TYPE_BFLOAT16 ||
+         dtype == MODEL_TENSOR_DATA_TYPE_DOUBLE ||
+         dtype == MODEL_TENSOR_DATA_TYPE_UNDEFINED;
+}
+
+bool is_float(const sModelGraph &graph, int tensor) {
+  return tensor >= 0 && graph.tensors[tensor].tensorDataType ==
+                            MODEL_TENSOR_DATA_TYPE_FLOAT32;
+}
+
+int half_type(eHalfFormat format) {
+  return format == HALF_FORMAT_BF16 ? onnx::TensorProto_DataType_BFLOAT16
+                                    : onnx::TensorProto_DataType_FLOAT16;
+}
+
+// float16 rounds a value to zero or infinity unless `clamp`, which keeps
+// finite values finite and nonzero values nonzero
+uint16_t to_half(float value, eHalfFormat format, bool clamp,
+                 int64_t &clamped) {
+  if (format == HALF_FORMAT_BF16) {
+    return float_to_bfloat16(value);
+  }
+  uint16_t half = float_to_half(value);
+  const uint16_t magnitude = half & 0x7fffu;
+  if (clamp && std::isfinite(value) &&
+      (magnitude == 0x7c00u || (magnitude == 0 && value != 0.f))) {
+    half = static_cast<uint16_t>((half & 0x8000u) |
+                                 (magnitude ? 0x7bffu : 0x0001u));
+    ++clamped;
+  }
+  return half;
+}
+
+// float32 tensor to half in place. external data is inlined by
+// load_model_proto.
+bool convert_tensor(onnx::TensorProto &tensor, eHalfFormat format,
+                    bool clamp, int64_t &clamped) {
+  if (tensor.data_type() != onnx::TensorProto_DataType_FLOAT ||
+      tensor.data_location() == onnx::TensorProto_DataLocation_EXTERNAL) {
+    return false;
+  }
+  std::vector<float> values;
+  if (tensor.has_raw_data()) {
+    values.resize(tensor.raw_data().size() / sizeof(float));
+    std::memcpy(values.data(), tensor.raw_data().data(),
+                values.size() * sizeof(float));
+  } else {
+    values.assign(tensor.float_data().begin(), tensor.float_data().end());
+  }
+  std::vector<uint16_t> halves(values.size());
+  for (size_t k = 0; k < values.size(); ++k) {
+    halves[k] = to_half(values[k], format, clamp, clamped);
+  }
+  tensor.clear_float_data();
+  tensor.set_data_type(half_type(format));
+  tensor.set_raw_data(halves.data(), halves.size() * sizeof(uint16_t));
+  return true;
+}
+
+eNodePrecision node_precision(const sModelGraph &graph,
+                              const sModelGraphNode &node,
+                              const sMixedPrecisionConfig &config,
+                              const std::unordered_set<std::string> &listed,
+                              const std::vector<char> &risky) {
+  bool reads_float = false;
+  bool other = false;
+  bool out_of_range = false;
+  auto visit = [&](int t) {
+    if (t < 0) {
+      return;
+    }
+    const auto dtype = graph.tensors[t].tensorDataType;
+    reads_float = reads_float || dtype == MODEL_TENSOR_DATA_TYPE_FLOAT32;
+    other = other || other_float_type(dtype);
+    out_of_range = out_of_range || risky[t];
+  };
+  for (int t : node.input_tensors) {
+    visit(t);
+  }
+  for (int t : node.output_tensors) {
+    visit(t);
+  }
+  if (!reads_float) {
+    return PRECISION_NONE;
+  }
+  // optional statistics outputs of LayerNormalization follow stash_type,
+  // Constant converts only a tensor value and bfloat16 kernels came to most
+  // ops in later opsets than float16 ones
+  const bool supported =
+      half_ops().count(node.op_type) &&
+      !(node.op_type == "LayerNormalization" &&
+        node.output_tensors.size() > 1) &&
+      !(node.op_type == "Constant" && !node.attributes.count("value")) &&
+      !(config.format == HALF_FORMAT_BF16 &&
+        graph.opset < bfloat16_opset(node.op_type));
+  if (!supported || other) {
+    return PRECISION_FLOAT_UNSUPPORTED;
+  }
+  if (listed.count(node.op_type) != (config.mode == OP_LIST_ALLOW)) {
+    return PRECISION_FLOAT_LISTED;
+  }
+  return out_of_range ? PRECISION_FLOAT_RANGE : PRECISION_HALF;
+}
+
+// where a float32 tensor lives in the converted model
+struct sTensorStorage {
+  bool half = false;
+  // half, but a graph output or read by a subgraph: the producer writes a
+  // half name and a Cast restores the float32 one
+  bool keep_name = false;
+  // a Cast to the other precision for consumers of the other kind
+  bool float_copy = false;
+  bool half_copy = false;
+};
+
+std::vector<sTensorStorage>
+assign_storage(const sModelGraph &graph,
+               const std::vector<eNodePrecision> &precisions,
+               const std::vector<int> &implicit_uses) {
+  const size_t tensors = graph.tensors.size();
+  std::vector<int> producer(tensors, -1);
+  std::vector<char> half_reader(tensors, 0);
+  std::vector<char> float_reader(tensors, 0);
+  for (size_t n = 0; n < graph.nodes.size(); ++n) {
+    const auto &node = graph.nodes[n];
+    for (int t : node.output_tensors) {
+      if (t >= 0) {
+        producer[t] = static_cast<int>(n);
+      }
+    }
+    for (int t : node.input_tensors) {
+      if (t >= 0) {
+        (precisions[n] == PRECISION_HALF ? half_reader : float_reader)[t] = 1;
+      }
+    }
+  }
+  std::vector<char> pinned(tensors, 0);
+  std::vector<char> input(tensors, 0);
+  for (int t : graph.output_tensors) {
+    pinned[t] = 1;
+  }
+  for (int t : implicit_uses) {
+    pinned[t] = 1;
+  }
+  for (int t : graph.input_tensors) {
+    input[t] = 1;
+  }
+
+  std::vector<sTensorStorage> storage(tensors);
+  for (size_t t = 0; t < tensors; ++t) {
+    if (!is_float(graph, static_cast<int>(t))) {
+      continue;
+    }
+    auto &s = storage[t];
+    if (producer[t] >= 0 && precisions[producer[t]] == PRECISION_HALF) {
+      s.half = true;
+      s.keep_name = pinned[t];
+      s.float_copy = float_reader[t] && !pinned[t];
+    } else if (producer[t] < 0 && graph.tensors[t].is_initializer &&
+               !input[t] && !pinned[t] && !float_reader[t] &&
+               half_reader[t]) {
+      // initializers only half nodes read are stored in half
+      s.half = true;
+    } else {
+      s.half_copy = half_reader[t];
+    }
+  }
+  return storage;
+}
+
+// Rewrites the node list with Casts between float and half nodes, placed
+// right before the first consumer that needs them so the list stays
+// topologically sorted, and converts the tensors stored in half.
+class HalfWriter {
+public:
+  HalfWriter(onnx::GraphProto &graph, const sModelGraph &model_graph,
+             const std::vector<eNodePrecision> &precisions,
+             const std::vector<sTensorStorage> &storage, eHalfFormat format)
+      : _graph(graph), _model_graph(model_graph), _precisions(precisions),
+        _storage(storage), _format(format),
+        _suffix(std::string("_") + half_format_name(format)),
+        _renamed(model_graph.tensors.size()) {
+    for (size_t t = 0; t < model_graph.tensors.size(); ++t) {
+      _tensor_of.emplace(model_graph.tensors[t].name, static_cast<int>(t));
+      _names.insert(model_graph.tensors[t].name);
+    }
+    for (const auto &node : graph.node()) {
+      _names.insert(node.output().begin(), node.output().end());
+    }
+  }
+
+  int64_t clamped = 0;
+
+  void write() {
+    std::vector<onnx::NodeProto> nodes(_graph.node().begin(),
+                                       _graph.node().end());
+    _graph.clear_node();
+    for (size_t n = 0; n < nodes.size(); ++n) {
+      auto &node = nodes[n];
+      const bool half = _precisions[n] == PRECISION_HALF;
+      for (auto &input : *node.mutable_input()) {
+        const int t = tensor(input);
+        if (is_float(_model_graph, t)) {
+          input = name_for(t, half);
+        }
+      }
+      std::vector<int> restored;
+      for (auto &output : *node.mutable_output()) {
+        const int t = tensor(output);
+        if (half && is_float(_model_graph, t) && _storage[t].keep_name) {
+          _renamed[t] = unique_name(output + _suffix);
+          output = _renamed[t];
+          restored.push_back(t);
+        }
+      }
+      if (half && node.op_type() == "Constant") {
+        for (auto &attribute : *node.mutable_attribute()) {
+          if (attribute.name() == "value" && attribute.has_t()) {
+            convert_tensor(*attribute.mutable_t(), _format, true, clamped);
+          }
+        }
+      }
+      *_graph.add_node() = std::move(node);
+      for (int t : restored) {
+        add_cast(_renamed[t], _model_graph.tensors[t].name,
+                 onnx::TensorProto_DataType_FLOAT);
+      }
+    }
+
+    for (auto &initializer : *_graph.mutable_initializer()) {
+      const int t = tensor(initializer.name());
+      if (t >= 0 && _storage[t].half) {
+        convert_tensor(initializer, _format, false, clamped);
+      }
+    }
+    for (auto &info : *_graph.mutable_value_info()) {
+      const int t = tensor(info.name());
+      auto *type = info.mutable_type();
+      if (t >= 0 && _storage[t].half && !_storage[t].keep_name &&
+          type->has_tensor_type()) {
+        type->mutable_tensor_type()->set_elem_type(half_type(_format));
+      }
+    }
+  }
+
+private:
+  onnx::GraphProto &_graph;
+  const sModelGraph &_model_graph;
+  const std::vector<eNodePrecision> &_precisions;
+  const std::vector<sTensorStorage> &_storage;
+  eHalfFormat _format;
+  std::string _suffix;
+  std::unordered_map<std::string, int> _tensor_of;
+  std::unordered_set<std::string> _names;
+  // half names of kept-name tensors
+  std::vector<std::string> _renamed;
+  // Casts made so far, by tensor
+  std::unordered_map<int, std::string> _copies;
+
+  int tensor(const std::string &name) const {
+    auto it = _tensor_of.find(name);
+    return it == _tensor_of.end() ? -1 : it->second;
+  }
+
+  std::string unique_name(const std::string &base) {
+    std::string name = base;
+    for (int i = 1; !_names.insert(name).second; ++i) {
+      name = base + "_" + std::to_string(i);
+    }
+    return name;
+  }
+
+  void add_cast(const std::string &input, const std::string &output,
+                int to) {
+    auto *node = _graph.add_node();
+    node->set_name(unique_name(output + "_Cast"));
+    node->set_op_type("Cast");
+    node->add_input(input);
+    node->add_output(output);
+    auto *attribute = node->add_attribute();
+    attribute->set_name("to");
+    attribute->set_type(onnx::AttributeProto_AttributeType_INT);
+    attribute->set_i(to);
+  }
+
+  // name of tensor `t` in the precision a consumer needs
+  std::string name_for(int t, bool half) {
+    const auto &s = _storage[t];
+    const auto &name = _model_graph.tensors[t].name;
+    if (s.keep_name) {
+      return half ? _renamed[t] : name;
+    }
+    if (s.half == half) {
+      return name;
+    }
+    auto it = _copies.find(t);
+    if (it != _copies.end()) {
+      return it->second;
+    }
+    const auto copy = unique_name(name + (half ? _suffix : "_fp32"));
+    add_cast(name, copy,
+             half ? half_type(_format) : onnx::TensorProto_DataType_FLOAT);
+    _copies.emplace(t, copy);
+    return copy;
+  }
+};
+
+} // namespace
+
+const char *half_format_name(eHalfFormat format) {
+  switch (format) {
+  case HALF_FORMAT_BF16:
+    return "bf16";
+  case HALF_FORMAT_FP16:
+  default:
+    return "fp16";
+  }
+}
+
+std::vector<std::string> default_float_ops() {
+  return {"Softmax",         "LogSoftmax",      "LayerNormalization",
+          "GroupNormalization", "InstanceNormalization",
+          "ReduceMean",      "ReduceSum",       "ReduceSumSquare",
+          "ReduceL1",        "ReduceL2",        "ReduceLogSum",
+          "ReduceLogSumExp", "ReduceProd",      "CumSum",
+          "Exp",             "Log",             "Pow"};
+}
+
+std::vector<std::string> default_half_ops() {
+  return {"MatMul", "Gemm", "Conv", "ConvTranspose"};
+}
+
+const char *node_precision_name(eNodePrecision precision) {
+  switch (precision) {
+  case PRECISION_HALF:
+    return "half";
+  case PRECISION_FLOAT_LISTED:
+    return "float, op list";
+  case PRECISION_FLOAT_RANGE:
+    return "float, weight range";
+  case PRECISION_FLOAT_UNSUPPORTED:
+    return "float, no half kernel";
+  case PRECISION_NONE:
+  default:
+    return "-";
+  }
+}
+
+bool scan_initializer_ranges(const std::string &model_path,
+                             const sModelGraph &graph,
+                             std::vector<sInitializerRange> &ranges,
+                             std::string &error) {
+  ranges.clear();
+  MappedInitializers initializers(model_path);
+  if (!initializers.ok()) {
+    error = initializers.error();
+    return false;
+  }
+  std::unordered_map<std::string, int> tensor_index;
+  for (size_t t = 0; t < graph.tensors.size(); ++t) {
+    tensor_index.emplace(graph.tensors[t].name, static_cast<int>(t));
+  }
+  std::vector<size_t> scanned;
+  for (size_t i = 0; i < initializers.tensors().size(); ++i) {
+    const auto &tensor = initializers.tensors()[i];
+    auto it = tensor_index.find(tensor.name);
+    if (tensor.data_type != onnx::TensorProto_DataType_FLOAT ||
+        it == tensor_index.end()) {
+      continue;
+    }
+    sInitializerRange range;
+    range.tensor = it->second;
+    range.count = static_cast<int64_t>(tensor.float_count);
+    ranges.push_back(range);
+    scanned.push_back(i);
+  }
+
+  ThreadPool::shared().parallel_for(
+      static_cast<int64_t>(ranges.size()), [&](int64_t r) {
+        auto &range = ranges[r];
+        const size_t index = scanned[r];
+        const size_t count = static_cast<size_t>(range.count);
+        float buffer[kBatch];
+        for (size_t first = 0; first < count; first += kBatch) {
+          const size_t batch = std::min(kBatch, count - first);
+          const float *values =
+              initializers.read(index, first, batch, buffer);
+          for (size_t k = 0; k < batch; ++k) {
+            const float value = values[k];
+            if (value == 0.f || !std::isfinite(value)) {
+              continue;
+            }
+            ++range.nonzero;
+            range.max_abs = std::max(range.max_abs, std::fabs(value));
+            const uint16_t half = float_to_half(value) & 0x7fffu;
+            const uint16_t bf16 = float_to_bfloat16(value) & 0x7fffu;
+            range.overflow[HALF_FORMAT_FP16] += half == 0x7c00u;
+            range.underflow[HALF_FORMAT_FP16] += half == 0;
+            range.overflow[HALF_FORMAT_BF16] += bf16 == 0x7f80u;
+            range.underflow[HALF_FORMAT_BF16] += bf16 == 0;
+          }
+        }
+      });
+  return true;
+}
+
+sPrecisionPlan
+plan_mixed_precision(const sModelGraph &graph,
+                     const sMixedPrecisionConfig &config,
+                     const std::vector<sInitializerRange> &ranges,
+                     const std::vector<int> &implicit_uses) {
+  const auto started = std::chrono::steady_clock::now();
+  sPrecisionPlan plan;
+  const int format = config.format;
+  std::vector<char> risky(graph.tensors.size(), 0);
+  for (size_t r = 0; r < ranges.size(); ++r) {
+    const auto &range = ranges[r];
+    if (range.overflow[format] > 0 ||
+        range.underflow[format] > config.max_underflow * range.nonzero) {
+      risky[range.tensor] = 1;
+      plan.risky.push_back(static_cast<int>(r));
+    }
+  }
+  const std::unordered_set<std::string> listed(config.ops.begin(),
+                                               config.ops.end());
+  plan.precisions.resize(graph.nodes.size());
+  for (size_t n = 0; n < graph.nodes.size(); ++n) {
+    const auto precision =
+        node_precision(graph, graph.nodes[n], config, listed, risky);
+    plan.precisions[n] = precision;
+    plan.half_nodes += precision == PRECISION_HALF;
+    plan.float_nodes +=
+        precision != PRECISION_HALF && precision != PRECISION_NONE;
+  }
+
+  const auto storage = assign_storage(graph, plan.precisions, implicit_uses);
+  for (size_t t = 0; t < storage.size(); ++t) {
+    const auto &s = storage[t];
+    plan.half_tensors += s.half;
+    plan.casts += s.keep_name + s.float_copy + s.half_copy;
+    const auto &tensor = graph.tensors[t];
+    if (!s.half || !tensor.is_initializer) {
+      continue;
+    }
+    int64_t elements = 1;
+    for (int64_t dim : tensor.shape) {
+      elements *= std::max<int64_t>(dim, 0);
+    }
+    plan.float_weight_bytes += elements * 4;
+    plan.half_weight_bytes += elements * 2;
+  }
+  plan.elapsed_ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - started)
+                        .count();
+  return plan;
+}
+
+sHalfConversionResult convert_to_half(const std::string &model_path,
+                                      const sModelGraph &graph,
+                                      const sMixedPrecisionConfig &config,
+                                      const std::string &output_path) {
+  const auto started = std::chrono::steady_clock::now();
+  sHalfConversionResult result;
+  onnx::ModelProto model;
+  if (!load_model_proto(model_path, model, result.error)) {
+    return result;
+  }
+  auto &graph_proto = *model.mutable_graph();
+  // an output missing from the graph would be converted unnoticed
+  if (graph_proto.node_size() != static_cast<int>(graph.nodes.size()) ||
+      graph_proto.output_size() !=
+          static_cast<int>(graph.output_tensors.size())) {
+    result.error = "the graph does not match " + model_path;
+    return result;
+  }
+  const int opset = opset_version(model);
+  if (config.format == HALF_FORMAT_BF16 && opset < 13) {
+    result.error = "bfloat16 needs opset 13, the model has opset " +
+                   std::to_string(opset);
+    return result;
+  }
+
+  std::vector<sInitializerRange> ranges;
+  if (!scan_initializer_ranges(model_path, graph, ranges, result.error)) {
+    return result;
+  }
+  const auto implicit_uses = subgraph_inputs(graph_proto, graph);
+  result.plan = plan_mixed_precision(graph, config, ranges, implicit_uses);
+  if (result.plan.half_nodes == 0) {
+    result.error = std::string("no node runs in ") +
+                   half_format_name(config.format) + " with this op list";
+    return result;
+  }
+
+  const auto storage =
+      assign_storage(graph, result.plan.precisions, implicit_uses);
+  HalfWriter writer(graph_proto, graph, result.plan.precisions, storage,
+                    config.format);
+  writer.write();
+  result.clamped_values = writer.clamped;
+
+  result.output_path = output_path;
+  if (result.output_path.empty()) {
+    result.output_path =
+        std::filesystem::path(model_path)
+            .replace_extension(std::string(".") +
+                               half_format_name(config.format) + ".onnx")
+            .string();
+  }
+  {
+    std::ofstream output(result.output_path,
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!output.is_open() || !model.SerializeToOstream(&output)) {
+      result.error = "unable to write " + result.output_path;
+      return result;
+    }
+  }
+  result.bytes_before = file_size(model_path);
+  result.bytes_after = file_size(result.output_path);
+  result.elapsed_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - started)
+                          .count();
+  result.ok = true;
+  return result;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// Conversion of float32 models to float16 or bfloat16 with numerically
+// sensitive ops kept in float32. Planning reads the graph and a range scan
+// of the initializers; conversion writes the mixed precision model. Its
+// outputs and latency are compared with the float model in
+// runtime/mixed_precision.h.
+
+enum eHalfFormat {
+  HALF_FORMAT_FP16 = 0,
+  HALF_FORMAT_BF16,
+  HALF_FORMAT_COUNT,
+};
+
+const char *half_format_name(eHalfFormat format);
+
+enum eOpListMode {
+  // every op runs in half except the listed ones
+  OP_LIST_DENY = 0,
+  // only the listed ops run in half
+  OP_LIST_ALLOW,
+};
+
+// softmax, normalizations, sum-like reductions, Exp, Log and Pow: ops
+// whose accumulations or intermediate values outgrow half precision
+std::vector<std::string> default_float_ops();
+// MatMul, Gemm and convolutions, where the weight bandwidth goes
+std::vector<std::string> default_half_ops();
+
+struct sMixedPrecisionConfig {
+  eHalfFormat format = HALF_FORMAT_FP16;
+  eOpListMode mode = OP_LIST_DENY;
+  std::vector<std::string> ops = default_float_ops();
+  // share of an initializer's nonzero values that may round to zero before
+  // its consumers stay in float
+  float max_underflow = 0.01f;
+};
+
+enum eNodePrecision {
+  PRECISION_HALF = 0,
+  // kept in float by the op list
+  PRECISION_FLOAT_LISTED,
+  // reads an initializer that overflows or underflows in half
+  PRECISION_FLOAT_RANGE,
+  // no half kernel at the model's opset, or reads tensors of other or
+  // unknown floating types
+  PRECISION_FLOAT_UNSUPPORTED,
+  // reads and writes no float tensor
+  PRECISION_NONE,
+};
+
+const char *node_precision_name(eNodePrecision precision);
+
+// what half would do to the values of one float32 initializer
+struct sInitializerRange {
+  // index into sModelGraph::tensors
+  int tensor = -1;
+  int64_t count = 0;
+  int64_t nonzero = 0;
+  float max_abs = 0.f;
+  // values past the largest finite half, and nonzero values rounding to
+  // zero, per format
+  std::array<int64_t, HALF_FORMAT_COUNT> overflow = {};
+  std::array<int64_t, HALF_FORMAT_COUNT> underflow = {};
+};
+
+// Scans every float32 initializer of the model at `model_path`, whose graph
+// is `graph`, in place from the mapped model on the shared pool.
+bool scan_initializer_ranges(const std::string &model_path,
+                             const sModelGraph &graph,
+                             std::vector<sInitializerRange> &ranges,
+                             std::string &error);
+
+struct sPrecisionPlan {
+  // per node
+  std::vector<eNodePrecision> precisions;
+  int half_nodes = 0;
+  int float_nodes = 0;
+  // initializers whose consumers stay in float, indices into the ranges
+  std::vector<int> risky;
+  // float32 tensors stored in half
+  int half_tensors = 0;
+  // Cast nodes at the boundaries between float and half nodes
+  int casts = 0;
+  // initializers stored in half, at 4 and 2 bytes per value
+  int64_t float_weight_bytes = 0;
+  int64_t half_weight_bytes = 0;
+  double elapsed_ms = 0.0;
+};
+
+// Picks the precision of every node in one pass over the graph. A node runs
+// in half when its op has half kernels for all its float operands at the
+// graph's opset, the op list allows it and none of its initializers is out
+// of range for the format. Graph inputs and outputs stay float32, so the
+// converted model is a drop-in replacement. `implicit_uses` are tensors read
+// by If, Loop and Scan bodies, which stay float32 as well.
+sPrecisionPlan
+plan_mixed_precision(const sModelGraph &graph,
+                     const sMixedPrecisionConfig &config,
+                     const std::vector<sInitializerRange> &ranges,
+                     const std::vector<int> &implicit_uses = {});
+
+struct sHalfConversionResult {
+  bool ok = false;
+  std::string error;
+  std::string output_path;
+  sPrecisionPlan plan;
+  // float16 Constant values out of range, clamped to the largest finite or
+  // smallest subnormal half
+  int64_t clamped_values = 0;
+  // model file sizes
+  int64_t bytes_before = 0;
+  int64_t bytes_after = 0;
+  double elapsed_ms = 0.0;
+};
+
+// Converts the model at `model_path`, whose ModelInspector graph is `graph`,
+// and writes it to `output_path`, empty for <model>.fp16.onnx or
+// <model>.bf16.onnx next to the model. Half tensors that are graph outputs
+// or read by subgraphs get a half name, and a Cast back to float32 takes
+// the original one.
+sHalfConversionResult convert_to_half(const std::string &model_path,
+                                      const sModelGraph &graph,
+                                      const sMixedPrecisionConfig &config,
+                                      const std::string &output_path);
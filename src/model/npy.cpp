@@ -0,0 +1,127 @@
+#include "npy.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "tensor_utils.h"
+
+namespace {
+
+// value of `key` in the header dict, up to the next top level comma
+std::string header_field(const std::string &header, const std::string &key) {
+  const auto at = header.find("'" + key + "'");
+  if (at == std::string::npos) {
+    return {};
+  }
+  auto begin = header.find(':', at);
+  if (begin == std::string::npos) {
+    return {};
+  }
+  ++begin;
+  int depth = 0;
+  auto end = begin;
+  for (; end < header.size(); ++end) {
+    const char c = header[end];
+    if (c == '(') {
+      ++depth;
+    } else if (c == ')') {
+      --depth;
+    } else if ((c == ',' && depth == 0) || c == '}') {
+      break;
+    }
+  }
+  const auto first = header.find_first_not_of(" '", begin);
+  const auto last = header.find_last_not_of(" '", end - 1);
+  if (first == std::string::npos || last < first) {
+    return {};
+  }
+  return header.substr(first, last - first + 1);
+}
+
+eModelTensorDataType npy_dtype(const std::string &descr) {
+  // '|' marks single byte types, '<' little endian ones
+  if (descr.size() < 3 || (descr[0] != '<' && descr[0] != '|')) {
+    return MODEL_TENSOR_DATA_TYPE_UNDEFINED;
+  }
+  const std::string type = descr.substr(1);
+  if (type == "f4") {
+    return MODEL_TENSOR_DATA_TYPE_FLOAT32;
+  } else if (type == "f8") {
+    return MODEL_TENSOR_DATA_TYPE_DOUBLE;
+  } else if (type == "f2") {
+    return MODEL_TENSOR_DATA_TYPE_FLOAT16;
+  } else if (type == "i8") {
+    return MODEL_TENSOR_DATA_TYPE_INT64;
+  } else if (type == "i4") {
+    return MODEL_TENSOR_DATA_TYPE_INT32;
+  } else if (type == "i2") {
+    return MODEL_TENSOR_DATA_TYPE_INT16;
+  } else if (type == "i1") {
+    return MODEL_TENSOR_DATA_TYPE_INT8;
+  } else if (type == "u1") {
+    return MODEL_TENSOR_DATA_TYPE_UINT8;
+  } else if (type == "b1") {
+    return MODEL_TENSOR_DATA_TYPE_BOOL;
+  }
+  return MODEL_TENSOR_DATA_TYPE_UNDEFINED;
+}
+
+} // namespace
+
+bool load_npy(const std::string &path, sNpyArray &array, std::string &error) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    error = "unable to open " + path;
+    return false;
+  }
+  char magic[8] = {};
+  file.read(magic, sizeof(magic));
+  if (!file || std::memcmp(magic, "\x93NUMPY", 6) != 0) {
+    error = "not a .npy file: " + path;
+    return false;
+  }
+  // version 1 has a 2 byte header length, later versions 4 bytes
+  uint8_t length_bytes[4] = {};
+  const int length_size = magic[6] == 1 ? 2 : 4;
+  file.read(reinterpret_cast<char *>(length_bytes), length_size);
+  uint32_t header_size = 0;
+  for (int i = length_size - 1; i >= 0; --i) {
+    header_size = header_size << 8 | length_bytes[i];
+  }
+  std::string header(header_size, '\0');
+  file.read(header.data(), header_size);
+  if (!file) {
+    error = "truncated .npy header: " + path;
+    return false;
+  }
+
+  const std::string descr = header_field(header, "descr");
+  array.dtype = npy_dtype(descr);
+  if (array.dtype == MODEL_TENSOR_DATA_TYPE_UNDEFINED) {
+    error = "unsupported .npy dtype '" + descr + "': " + path;
+    return false;
+  }
+  if (header_field(header, "fortran_order") == "True") {
+    error = "fortran order .npy arrays are not supported: " + path;
+    return false;
+  }
+  array.shape.clear();
+  const std::string shape = header_field(header, "shape");
+  size_t count = 1;
+  for (size_t at = shape.find_first_of("0123456789");
+       at != std::string::npos; at = shape.find_first_of("0123456789", at)) {
+    size_t used = 0;
+    array.shape.push_back(std::stoll(shape.substr(at), &used));
+    count *= static_cast<size_t>(array.shape.back());
+    at += used;
+  }
+
+  array.data.resize(count * model_dtype_size(array.dtype));
+  file.read(reinterpret_cast<char *>(array.data.data()),
+            static_cast<std::streamsize>(array.data.size()));
+  if (!file) {
+    error = "truncated .npy data: " + path;
+    return false;
+  }
+  return true;
+}
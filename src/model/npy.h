@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// A tensor read from a NumPy .npy file, e.g. one calibration sample.
+struct sNpyArray {
+  std::vector<int64_t> shape;
+  eModelTensorDataType dtype = MODEL_TENSOR_DATA_TYPE_UNDEFINED;
+  // little endian elements in C order
+  std::vector<uint8_t> data;
+};
+
+// reads format version 1 to 3 files holding little endian bool, integer,
+// float16, float32 or float64 elements. Fortran order arrays are rejected.
+bool load_npy(const std::string &path, sNpyArray &array, std::string &error);
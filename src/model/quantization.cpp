@@ -0,0 +1,231 @@
+#include "quantization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// magnitude levels of a symmetric 8-bit code
+constexpr int kLevels = 128;
+
+// KL(p || q) of two unnormalized distributions
+double kl_divergence(const std::vector<double> &p,
+                     const std::vector<double> &q) {
+  double p_sum = 0.0;
+  double q_sum = 0.0;
+  for (size_t i = 0; i < p.size(); ++i) {
+    p_sum += p[i];
+    q_sum += q[i];
+  }
+  if (p_sum <= 0.0 || q_sum <= 0.0) {
+    return std::numeric_limits<double>::infinity();
+  }
+  double divergence = 0.0;
+  for (size_t i = 0; i < p.size(); ++i) {
+    if (p[i] <= 0.0) {
+      continue;
+    }
+    if (q[i] <= 0.0) {
+      return std::numeric_limits<double>::infinity();
+    }
+    const double pi = p[i] / p_sum;
+    divergence += pi * std::log(pi / (q[i] / q_sum));
+  }
+  return divergence;
+}
+
+} // namespace
+
+const char *calibration_method_name(eCalibrationMethod method) {
+  switch (method) {
+  case CALIBRATION_PERCENTILE:
+    return "percentile";
+  case CALIBRATION_ENTROPY:
+    return "entropy";
+  case CALIBRATION_MIN_MAX:
+  default:
+    return "min-max";
+  }
+}
+
+void ActivationHistogram::grow(float magnitude) {
+  if (_bins.empty()) {
+    _bins.assign(kBins, 0);
+    _range = magnitude > 0.f ? magnitude * 1.0001f : 1.f;
+    return;
+  }
+  while (magnitude >= _range) {
+    // bin i of [-r, r) lands in bin (i + n / 2) / 2 of [-2r, 2r)
+    std::vector<uint64_t> merged(kBins, 0);
+    for (int i = 0; i < kBins; ++i) {
+      merged[(i + kBins / 2) / 2] += _bins[i];
+    }
+    _bins = std::move(merged);
+    _range *= 2.f;
+  }
+}
+
+void ActivationHistogram::add(const float *values, size_t count) {
+  float low = std::numeric_limits<float>::infinity();
+  float high = -std::numeric_limits<float>::infinity();
+  for (size_t i = 0; i < count; ++i) {
+    if (std::isfinite(values[i])) {
+      low = std::min(low, values[i]);
+      high = std::max(high, values[i]);
+    }
+  }
+  if (low > high) {
+    return;
+  }
+  grow(std::max(std::fabs(low), std::fabs(high)));
+  _min = _count ? std::min(_min, low) : low;
+  _max = _count ? std::max(_max, high) : high;
+
+  const float to_bin = kBins / (2.f * _range);
+  for (size_t i = 0; i < count; ++i) {
+    if (!std::isfinite(values[i])) {
+      continue;
+    }
+    const int bin = static_cast<int>((values[i] + _range) * to_bin);
+    ++_bins[std::clamp(bin, 0, kBins - 1)];
+    ++_count;
+  }
+}
+
+float ActivationHistogram::entropy_threshold() const {
+  // magnitudes: bin i covers [i, i + 1) * width
+  constexpr int kHalf = kBins / 2;
+  std::vector<double> magnitude(kHalf);
+  for (int i = 0; i < kHalf; ++i) {
+    magnitude[i] =
+        static_cast<double>(_bins[kHalf + i] + _bins[kHalf - 1 - i]);
+  }
+  const float width = _range / kHalf;
+
+  int best = kHalf;
+  double best_divergence = std::numeric_limits<double>::infinity();
+  std::vector<double> p;
+  std::vector<double> q;
+  for (int end = kLevels; end <= kHalf; ++end) {
+    // reference: everything past the threshold clipped into the last bin
+    p.assign(magnitude.begin(), magnitude.begin() + end);
+    for (int i = end; i < kHalf; ++i) {
+      p[end - 1] += magnitude[i];
+    }
+    // candidate: the same bins merged into kLevels levels, each level
+    // spread evenly over its non-empty bins
+    q.assign(end, 0.0);
+    for (int level = 0; level < kLevels; ++level) {
+      const int first = level * end / kLevels;
+      const int last = (level + 1) * end / kLevels;
+      double sum = 0.0;
+      int used = 0;
+      for (int i = first; i < last; ++i) {
+        sum += magnitude[i];
+        used += magnitude[i] > 0.0;
+      }
+      for (int i = first; i < last && used > 0; ++i) {
+        q[i] = magnitude[i] > 0.0 ? sum / used : 0.0;
+      }
+    }
+    const double divergence = kl_divergence(p, q);
+    if (divergence < best_divergence) {
+      best_divergence = divergence;
+      best = end;
+    }
+  }
+  return best * width;
+}
+
+void ActivationHistogram::calibrated_range(eCalibrationMethod method,
+                                           float percentile, float &low,
+                                           float &high) const {
+  low = _min;
+  high = _max;
+  if (_count == 0 || method == CALIBRATION_MIN_MAX) {
+    return;
+  }
+  if (method == CALIBRATION_ENTROPY) {
+    const float threshold = entropy_threshold();
+    low = std::max(_min, -threshold);
+    high = std::min(_max, threshold);
+    return;
+  }
+
+  // equal tails on both sides
+  const double tail = (1.0 - std::clamp(percentile, 0.f, 100.f) / 100.0) / 2;
+  const auto low_rank = static_cast<uint64_t>(tail * _count);
+  const auto high_rank = static_cast<uint64_t>((1.0 - tail) * _count);
+  const float width = 2.f * _range / kBins;
+  uint64_t seen = 0;
+  bool low_found = false;
+  for (int i = 0; i < kBins; ++i) {
+    seen += _bins[i];
+    if (!low_found && seen > low_rank) {
+      low = std::max(_min, -_range + i * width);
+      low_found = true;
+    }
+    if (seen >= high_rank) {
+      high = std::min(_max, -_range + (i + 1) * width);
+      break;
+    }
+  }
+}
+
+sQuantParams uint8_params(float low, float high) {
+  low = std::min(low, 0.f);
+  high = std::max(high, 0.f);
+  sQuantParams params;
+  if (high - low <= std::numeric_limits<float>::min()) {
+    return params;
+  }
+  params.scale = (high - low) / 255.f;
+  params.zero_point = static_cast<int32_t>(
+      std::clamp(std::round(-low / params.scale), 0.f, 255.f));
+  return params;
+}
+
+sQuantizedWeight quantize_weight(const std::vector<float> &weight,
+                                 const std::vector<int64_t> &shape,
+                                 int axis) {
+  // slices: outer x channels x inner, channel c at (o, c, i)
+  int64_t outer = 1;
+  int64_t channels = 1;
+  int64_t inner = static_cast<int64_t>(weight.size());
+  if (axis >= 0 && axis < static_cast<int>(shape.size())) {
+    channels = shape[axis];
+    inner = 1;
+    for (size_t d = 0; d < shape.size(); ++d) {
+      if (static_cast<int>(d) < axis) {
+        outer *= shape[d];
+      } else if (static_cast<int>(d) > axis) {
+        inner *= shape[d];
+      }
+    }
+  }
+
+  sQuantizedWeight quantized;
+  quantized.values.resize(weight.size());
+  quantized.scales.assign(static_cast<size_t>(channels), 1.f);
+  auto for_channel = [&](int64_t c, auto &&body) {
+    for (int64_t o = 0; o < outer; ++o) {
+      for (int64_t i = 0; i < inner; ++i) {
+        body(static_cast<size_t>((o * channels + c) * inner + i));
+      }
+    }
+  };
+  for (int64_t c = 0; c < channels; ++c) {
+    float magnitude = 0.f;
+    for_channel(c, [&](size_t k) {
+      magnitude = std::max(magnitude, std::fabs(weight[k]));
+    });
+    const float scale = magnitude > 0.f ? magnitude / 127.f : 1.f;
+    quantized.scales[c] = scale;
+    for_channel(c, [&](size_t k) {
+      quantized.values[k] = static_cast<int8_t>(
+          std::clamp(std::round(weight[k] / scale), -127.f, 127.f));
+    });
+  }
+  return quantized;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Post-training quantization math: activation range calibration and the
+// affine parameters of 8-bit tensors. Reading calibration data and writing
+// the QDQ model is in runtime/quantization.h.
+
+enum eCalibrationMethod {
+  // observed minimum and maximum
+  CALIBRATION_MIN_MAX = 0,
+  // central percentile of the observed values, outliers clipped
+  CALIBRATION_PERCENTILE,
+  // threshold minimizing the KL divergence between the value distribution
+  // and its 8-bit quantization
+  CALIBRATION_ENTROPY,
+};
+
+const char *calibration_method_name(eCalibrationMethod method);
+
+// Value histogram of one tensor over a symmetric range that doubles when a
+// value falls outside it, so calibration takes a single pass over the data.
+class ActivationHistogram {
+private:
+  std::vector<uint64_t> _bins;
+  // bins cover [-_range, _range)
+  float _range = 0.f;
+  float _min = 0.f;
+  float _max = 0.f;
+  uint64_t _count = 0;
+
+  void grow(float magnitude);
+  float entropy_threshold() const;
+
+public:
+  // even halves, so doubling the range merges bins pairwise
+  static constexpr int kBins = 2048;
+
+  // non-finite values are skipped
+  void add(const float *values, size_t count);
+  uint64_t count() const { return _count; }
+  float min() const { return _min; }
+  float max() const { return _max; }
+  float range() const { return _range; }
+  const std::vector<uint64_t> &bins() const { return _bins; }
+
+  // range to quantize to, within [min(), max()]. percentile is in percent
+  // and only used by CALIBRATION_PERCENTILE.
+  void calibrated_range(eCalibrationMethod method, float percentile,
+                        float &low, float &high) const;
+};
+
+// real = scale * (quantized - zero_point)
+struct sQuantParams {
+  float scale = 1.f;
+  int32_t zero_point = 0;
+};
+
+// asymmetric uint8 over [low, high], widened to include zero so padding
+// and Relu outputs stay exact
+sQuantParams uint8_params(float low, float high);
+
+// symmetric int8 weights, one scale per slice along `axis` or a single one
+// for axis < 0. zero points are all 0.
+struct sQuantizedWeight {
+  std::vector<int8_t> values;
+  std::vector<float> scales;
+};
+
+sQuantizedWeight quantize_weight(const std::vector<float> &weight,
+                                 const std::vector<int64_t> &shape, int axis);
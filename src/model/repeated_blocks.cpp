@@ -0,0 +1,272 @@
+#include "repeated_blocks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+#include "graph_utils.h"
+
+namespace {
+
+// anchors tried, most frequent labels first, and occurrences of the anchor
+// per block
+constexpr size_t kMaxAnchors = 12;
+constexpr int kMaxPeriod = 4;
+// a single node repeated is not worth a block
+constexpr int kMinBlockNodes = 2;
+
+uint64_t hash_tensor(const sModelTensor &tensor) {
+  uint64_t hash = hash_combine(tensor.is_initializer, tensor.tensorDataType);
+  for (int64_t dim : tensor.shape) {
+    hash = hash_combine(hash, static_cast<uint64_t>(dim));
+  }
+  return hash_combine(hash, tensor.shape.size());
+}
+
+// op type, attributes and the shapes of every operand: nodes with equal
+// labels cost the same in every analysis
+std::vector<uint64_t> node_labels(const sModelGraph &graph) {
+  std::vector<uint64_t> labels(graph.nodes.size());
+  for (size_t n = 0; n < graph.nodes.size(); ++n) {
+    const auto &node = graph.nodes[n];
+    uint64_t hash = hash_string(node.op_type);
+    for (const auto &[key, value] : node.attributes) {
+      hash = hash_combine(hash_combine(hash, hash_string(key)),
+                          hash_string(value));
+    }
+    for (int t : node.input_tensors) {
+      hash = hash_combine(hash, t < 0 ? 0 : hash_tensor(graph.tensors[t]));
+    }
+    hash = hash_combine(hash, node.input_tensors.size());
+    for (int t : node.output_tensors) {
+      hash = hash_combine(hash, t < 0 ? 0 : hash_tensor(graph.tensors[t]));
+    }
+    labels[n] = hash_combine(hash, node.output_tensors.size());
+  }
+  return labels;
+}
+
+// `count` segments of `length` nodes from position `start` of the
+// topological order
+struct sCandidate {
+  int start = 0;
+  int length = 0;
+  int count = 0;
+  uint64_t hash = 0;
+
+  int covered() const { return length * count; }
+};
+
+class BlockDetector {
+public:
+  BlockDetector(const sModelGraph &graph, int min_repeats)
+      : _graph(graph), _min_repeats(std::max(min_repeats, 2)),
+        _order(topological_order(graph)), _position(graph.nodes.size(), 0),
+        _producers(tensor_producers(graph)), _labels(node_labels(graph)) {
+    for (size_t p = 0; p < _order.size(); ++p) {
+      _position[_order[p]] = static_cast<int>(p);
+    }
+  }
+
+  sBlockPlan run();
+
+private:
+  const sModelGraph &_graph;
+  int _min_repeats;
+  std::vector<int> _order;
+  std::vector<int> _position;
+  std::vector<int> _producers;
+  std::vector<uint64_t> _labels;
+
+  uint64_t segment_hash(int begin, int end) const;
+  void collect(const std::vector<int> &cuts,
+               std::vector<sCandidate> &candidates) const;
+  std::string label(const std::vector<int> &instance) const;
+};
+
+uint64_t BlockDetector::segment_hash(int begin, int end) const {
+  // operands produced inside the segment hash by their producer's offset,
+  // so equal hashes mean equal wiring as well as equal ops
+  constexpr uint64_t kMissing = 1;
+  constexpr uint64_t kGraphInput = 2;
+  constexpr uint64_t kExternal = 3;
+  constexpr uint64_t kInternal = 16;
+  uint64_t hash = hash_combine(0, static_cast<uint64_t>(end - begin));
+  for (int p = begin; p < end; ++p) {
+    const int node = _order[p];
+    hash = hash_combine(hash, _labels[node]);
+    for (int t : _graph.nodes[node].input_tensors) {
+      if (t < 0) {
+        hash = hash_combine(hash, kMissing);
+        continue;
+      }
+      const int producer = _producers[t];
+      if (producer < 0) {
+        hash = hash_combine(hash, kGraphInput);
+        continue;
+      }
+      const int q = _position[producer];
+      hash = hash_combine(hash, q >= begin && q < end ? kInternal + (q - begin)
+                                                 : kExternal);
+    }
+  }
+  return hash;
+}
+
+void BlockDetector::collect(const std::vector<int> &cuts,
+                            std::vector<sCandidate> &candidates) const {
+  // segments run from one cut to the next; the last is taken as long as
+  // the one before it
+  const int total = static_cast<int>(_order.size());
+  std::vector<sCandidate> segments;
+  for (size_t j = 0; j < cuts.size(); ++j) {
+    const int begin = cuts[j];
+    int end = 0;
+    if (j + 1 < cuts.size()) {
+      end = cuts[j + 1];
+    } else if (j > 0) {
+      end = std::min(total, begin + (cuts[j] - cuts[j - 1]));
+    } else {
+      break;
+    }
+    segments.push_back({begin, end - begin, 1, segment_hash(begin, end)});
+  }
+  for (size_t j = 0; j < segments.size();) {
+    size_t k = j + 1;
+    while (k < segments.size() && segments[k].hash == segments[j].hash) {
+      ++k;
+    }
+    const int count = static_cast<int>(k - j);
+    if (count >= _min_repeats && segments[j].length >= kMinBlockNodes) {
+      candidates.push_back(
+          {segments[j].start, segments[j].length, count, segments[j].hash});
+    }
+    j = k;
+  }
+}
+
+std::string BlockDetector::label(const std::vector<int> &instance) const {
+  constexpr size_t kShown = 4;
+  std::string text;
+  for (size_t i = 0; i < instance.size() && i < kShown; ++i) {
+    text += (i > 0 ? "+" : "") + _graph.nodes[instance[i]].op_type;
+  }
+  if (instance.size() > kShown) {
+    text += "+... (" + std::to_string(instance.size()) + " nodes)";
+  }
+  return text;
+}
+
+sBlockPlan BlockDetector::run() {
+  sBlockPlan plan;
+  const int total = static_cast<int>(_order.size());
+  plan.node_block.assign(_graph.nodes.size(), -1);
+  plan.representative.resize(_graph.nodes.size());
+  for (size_t n = 0; n < _graph.nodes.size(); ++n) {
+    plan.representative[n] = static_cast<int>(n);
+  }
+
+  // anchor candidates: the most frequent labels, by position
+  std::unordered_map<uint64_t, std::vector<int>> occurrences;
+  for (int p = 0; p < total; ++p) {
+    occurrences[_labels[_order[p]]].push_back(p);
+  }
+  std::vector<const std::vector<int> *> anchors;
+  for (const auto &[label, positions] : occurrences) {
+    if (static_cast<int>(positions.size()) >= _min_repeats) {
+      anchors.push_back(&positions);
+    }
+  }
+  std::sort(anchors.begin(), anchors.end(), [](const auto *a, const auto *b) {
+    return a->size() != b->size() ? a->size() > b->size()
+                                  : a->front() < b->front();
+  });
+  anchors.resize(std::min(anchors.size(), kMaxAnchors));
+
+  std::vector<sCandidate> candidates;
+  std::vector<int> cuts;
+  for (const auto *positions : anchors) {
+    for (int period = 1; period <= kMaxPeriod; ++period) {
+      for (int phase = 0; phase < period; ++phase) {
+        cuts.clear();
+        for (size_t i = phase; i < positions->size(); i += period) {
+          cuts.push_back((*positions)[i]);
+        }
+        collect(cuts, candidates);
+      }
+    }
+  }
+
+  // largest coverage first, then the finer block
+  std::sort(candidates.begin(), candidates.end(),
+            [](const sCandidate &a, const sCandidate &b) {
+              if (a.covered() != b.covered()) {
+                return a.covered() > b.covered();
+              }
+              if (a.length != b.length) {
+                return a.length < b.length;
+              }
+              return a.start < b.start;
+            });
+  std::vector<bool> taken(total, false);
+  std::vector<sCandidate> accepted;
+  for (const auto &candidate : candidates) {
+    const int end = candidate.start + candidate.covered();
+    if (std::any_of(taken.begin() + candidate.start, taken.begin() + end,
+                    [](bool t) { return t; })) {
+      continue;
+    }
+    std::fill(taken.begin() + candidate.start, taken.begin() + end, true);
+    accepted.push_back(candidate);
+  }
+  std::sort(accepted.begin(), accepted.end(),
+            [](const sCandidate &a, const sCandidate &b) {
+              return a.start < b.start;
+            });
+
+  std::unordered_map<uint64_t, int> unique_of;
+  std::vector<const sRepeatedBlock *> first_of_unique;
+  for (const auto &candidate : accepted) {
+    sRepeatedBlock block;
+    block.hash = candidate.hash;
+    for (int i = 0; i < candidate.count; ++i) {
+      const int begin = candidate.start + i * candidate.length;
+      block.instances.emplace_back(_order.begin() + begin,
+                                   _order.begin() + begin + candidate.length);
+    }
+    block.label = label(block.instances[0]);
+    auto [it, inserted] = unique_of.emplace(block.hash, plan.unique_blocks);
+    if (inserted) {
+      ++plan.unique_blocks;
+    }
+    block.unique = it->second;
+    plan.blocks.push_back(std::move(block));
+    plan.covered_nodes += candidate.covered();
+  }
+  for (size_t b = 0; b < plan.blocks.size(); ++b) {
+    const auto &block = plan.blocks[b];
+    if (block.unique >= static_cast<int>(first_of_unique.size())) {
+      first_of_unique.push_back(&block);
+    }
+    const auto &reference = first_of_unique[block.unique]->instances[0];
+    for (const auto &instance : block.instances) {
+      for (size_t k = 0; k < instance.size(); ++k) {
+        plan.node_block[instance[k]] = static_cast<int>(b);
+        plan.representative[instance[k]] = reference[k];
+      }
+    }
+  }
+  return plan;
+}
+
+} // namespace
+
+sBlockPlan detect_repeated_blocks(const sModelGraph &graph,
+                                  int min_repeats) {
+  const auto started = std::chrono::steady_clock::now();
+  sBlockPlan plan = BlockDetector(graph, min_repeats).run();
+  plan.detect_ms = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - started)
+                       .count();
+  return plan;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// Detection of repeated blocks, the identical layers transformer and ResNet
+// exports are made of. Every node gets a label hashing its op type,
+// attributes and tensor shapes. The topological order is then cut at the
+// occurrences of a frequent label, every k-th one for blocks holding the
+// label k times. A segment hashes its labels and its internal wiring,
+// relative to the start of the segment. Runs of consecutive segments with
+// equal hashes are repetitions of one block. The candidate runs of all cuts
+// are taken largest first, as long as they do not overlap.
+
+struct sRepeatedBlock {
+  // structural hash shared by every instance
+  uint64_t hash = 0;
+  // blocks with equal hashes share an id, numbered from 0
+  int unique = -1;
+  // op types of an instance, abbreviated, e.g. Conv+Relu+Conv+Add+Relu
+  std::string label;
+  // consecutive repetitions, each in topological order; node k of one
+  // instance corresponds to node k of every other
+  std::vector<std::vector<int>> instances;
+
+  int repeats() const { return static_cast<int>(instances.size()); }
+  int nodes_per_instance() const {
+    return instances.empty() ? 0 : static_cast<int>(instances[0].size());
+  }
+};
+
+struct sBlockPlan {
+  std::vector<sRepeatedBlock> blocks;
+  int unique_blocks = 0;
+  // block of every node, -1 outside repetitions
+  std::vector<int> node_block;
+  // the corresponding node in the first instance of the first block with
+  // the same structure, the node itself outside repetitions. analyses run
+  // on representatives only and copy the result to the other nodes.
+  std::vector<int> representative;
+  int covered_nodes = 0;
+  double detect_ms = 0.0;
+};
+
+sBlockPlan detect_repeated_blocks(const sModelGraph &graph,
+                                  int min_repeats = 2);
@@ -0,0 +1,1399 @@
+#include "shape_inference.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <unordered_set>
+
+#include "graph_utils.h"
+#include "tensor_utils.h"
+
+namespace {
+
+constexpr int64_t kUnknownDim = -1;
+
+// propagated values keep literal negatives (Reshape's -1, negative Slice
+// starts) apart from dims read by Shape: an unknown dim becomes
+// kUnknownValue and symbol i becomes kUnknownValue + 1 + i.
+constexpr int64_t kUnknownValue = std::numeric_limits<int64_t>::min();
+constexpr int64_t kMaxSymbols = int64_t(1) << 32;
+
+int64_t value_from_dim(int64_t dim) {
+  if (dim >= 0) {
+    return dim;
+  }
+  return dim == kUnknownDim ? kUnknownValue : kUnknownValue + (-1 - dim);
+}
+
+// an encoded symbol or unknown dim rather than a literal
+bool is_dim_value(int64_t value) {
+  return value <= kUnknownValue + kMaxSymbols;
+}
+
+// literal negatives are not dims and come back unknown
+int64_t dim_from_value(int64_t value) {
+  if (value >= 0) {
+    return value;
+  }
+  if (value != kUnknownValue && is_dim_value(value)) {
+    return -1 - (value - kUnknownValue);
+  }
+  return kUnknownDim;
+}
+
+bool is_static(int64_t dim) { return dim >= 0; }
+
+// numpy broadcasting of one dim. a symbol against a static dim > 1 must
+// equal it at runtime.
+int64_t broadcast_dim(int64_t a, int64_t b) {
+  if (a == b) {
+    return a;
+  }
+  if (a == 1) {
+    return b;
+  }
+  if (b == 1) {
+    return a;
+  }
+  if (is_static(a) && !is_static(b)) {
+    return a;
+  }
+  if (is_static(b) && !is_static(a)) {
+    return b;
+  }
+  return kUnknownDim;
+}
+
+std::vector<int64_t> broadcast_shapes(const std::vector<int64_t> &a,
+                                      const std::vector<int64_t> &b) {
+  const size_t rank = std::max(a.size(), b.size());
+  std::vector<int64_t> shape(rank, 1);
+  for (size_t i = 0; i < rank; ++i) {
+    const int64_t da = i < rank - a.size() ? 1 : a[i - (rank - a.size())];
+    const int64_t db = i < rank - b.size() ? 1 : b[i - (rank - b.size())];
+    shape[i] = broadcast_dim(da, db);
+  }
+  return shape;
+}
+
+// product of dims: static if all are, a lone symbol times ones stays that
+// symbol, anything else is unknown
+int64_t dim_product(const std::vector<int64_t> &shape, size_t begin,
+                    size_t end) {
+  int64_t product = 1;
+  int64_t symbol = 0;
+  for (size_t i = begin; i < end && i < shape.size(); ++i) {
+    if (is_static(shape[i])) {
+      product *= shape[i];
+    } else if (shape[i] != kUnknownDim && symbol == 0) {
+      symbol = shape[i];
+    } else {
+      return kUnknownDim;
+    }
+  }
+  if (symbol != 0) {
+    return product == 1 ? symbol : kUnknownDim;
+  }
+  return product;
+}
+
+// output size of a sliding window along one spatial axis
+int64_t window_output(int64_t input, int64_t kernel, int64_t stride,
+                      int64_t dilation, int64_t pad_begin, int64_t pad_end,
+                      const std::string &auto_pad, bool ceil_mode) {
+  if (!is_static(input)) {
+    // a symbolic dim survives an identity window
+    const bool same = auto_pad == "SAME_UPPER" || auto_pad == "SAME_LOWER";
+    const bool identity = kernel == 1 && stride == 1 &&
+                          ((pad_begin == 0 && pad_end == 0) || same);
+    return identity ? input : kUnknownDim;
+  }
+  if (stride <= 0) {
+    return kUnknownDim;
+  }
+  if (auto_pad == "SAME_UPPER" || auto_pad == "SAME_LOWER") {
+    return (input + stride - 1) / stride;
+  }
+  const int64_t effective_kernel = (kernel - 1) * dilation + 1;
+  int64_t padded = input - effective_kernel;
+  if (auto_pad != "VALID") {
+    padded += pad_begin + pad_end;
+  }
+  if (padded < 0) {
+    return kUnknownDim;
+  }
+  const int64_t steps = ceil_mode ? (padded + stride - 1) / stride
+                                  : padded / stride;
+  return steps + 1;
+}
+
+int64_t slice_length(int64_t dim, int64_t start, int64_t end, int64_t step) {
+  if (step == 0) {
+    return kUnknownDim;
+  }
+  const int64_t kOpenEnd = std::numeric_limits<int32_t>::max();
+  if (!is_static(dim)) {
+    if (step == 1 && start == 0 && end >= kOpenEnd) {
+      return dim;
+    }
+    // a slice off the back, e.g. the last token
+    if (step == 1 && start < 0 && end >= kOpenEnd) {
+      return -start;
+    }
+    return kUnknownDim;
+  }
+  if (start < 0) {
+    start += dim;
+  }
+  if (end < 0) {
+    end += dim;
+  }
+  if (step > 0) {
+    start = std::clamp<int64_t>(start, 0, dim);
+    end = std::clamp<int64_t>(end, 0, dim);
+    return std::max<int64_t>(0, (end - start + step - 1) / step);
+  }
+  start = std::clamp<int64_t>(start, 0, dim - 1);
+  end = std::clamp<int64_t>(end, -1, dim - 1);
+  return std::max<int64_t>(0, (start - end - step - 1) / -step);
+}
+
+// axis normalized into [0, rank), -1 if out of range
+int normalize_axis(int64_t axis, size_t rank) {
+  if (axis < 0) {
+    axis += static_cast<int64_t>(rank);
+  }
+  return axis >= 0 && axis < static_cast<int64_t>(rank)
+             ? static_cast<int>(axis)
+             : -1;
+}
+
+const std::unordered_set<std::string> kSameShapeOps = {
+    "Relu",        "LeakyRelu",
+    "Sigmoid",     "Tanh",
+    "Clip",        "Exp",
+    "Log",         "Sqrt",
+    "Neg",         "Abs",
+    "Reciprocal",  "Floor",
+    "Ceil",        "Round",
+    "Sign",        "Erf",
+    "Sin",         "Cos",
+    "HardSigmoid", "HardSwish",
+    "Elu",         "Selu",
+    "Celu",        "Softplus",
+    "Softsign",    "Mish",
+    "Gelu",        "FastGelu",
+    "QuickGelu",   "ThresholdedRelu",
+    "Shrink",      "Softmax",
+    "LogSoftmax",  "Hardmax",
+    "Identity",    "LRN",
+    "CumSum",      "Trilu",
+    "BatchNormalization",
+    "InstanceNormalization",
+    "GroupNormalization",
+    "LayerNormalization",
+    "SimplifiedLayerNormalization",
+    "SkipLayerNormalization",
+    "SkipSimplifiedLayerNormalization",
+    "LpNormalization",
+    "MeanVarianceNormalization",
+};
+
+const std::unordered_set<std::string> kBroadcastOps = {
+    "Add",  "Sub", "Mul",  "Div",    "Pow",      "Mod",     "Max",
+    "Min",  "Sum", "Mean", "PRelu",  "BitShift", "BiasGelu",
+};
+
+const std::unordered_set<std::string> kComparisonOps = {
+    "Equal", "Less", "Greater", "LessOrEqual", "GreaterOrEqual",
+    "And",   "Or",   "Xor",
+};
+
+const std::unordered_set<std::string> kReduceOps = {
+    "ReduceMean", "ReduceSum",       "ReduceMax",    "ReduceMin",
+    "ReduceProd", "ReduceL1",        "ReduceL2",     "ReduceSumSquare",
+    "ReduceLogSum", "ReduceLogSumExp",
+};
+
+struct sInferredTensor {
+  bool known = false;
+  std::vector<int64_t> shape;
+  eModelTensorDataType dtype = MODEL_TENSOR_DATA_TYPE_UNDEFINED;
+  bool has_values = false;
+  std::vector<int64_t> values;
+};
+
+class NodeShapeInferer {
+private:
+  const sModelGraph &_graph;
+  const sModelGraphNode &_node;
+  const std::vector<bool> &_has_values;
+  const std::vector<std::vector<int64_t>> &_values;
+  std::vector<sInferredTensor> &_outputs;
+
+public:
+  NodeShapeInferer(const sModelGraph &graph, const sModelGraphNode &node,
+                   const std::vector<bool> &has_values,
+                   const std::vector<std::vector<int64_t>> &values,
+                   std::vector<sInferredTensor> &outputs)
+      : _graph(graph), _node(node), _has_values(has_values), _values(values),
+        _outputs(outputs) {
+    _outputs.assign(node.output_tensors.size(), {});
+  }
+
+  // false if the op has no inference rule
+  bool infer() {
+    const auto &op = _node.op_type;
+    if (kSameShapeOps.count(op) || op == "Dropout") {
+      same_as_input(0);
+      if (op == "Dropout" && known(0)) {
+        set_output(1, shape(0), MODEL_TENSOR_DATA_TYPE_BOOL);
+      }
+    } else if (kBroadcastOps.count(op)) {
+      broadcast(input_dtype(0));
+      binary_values();
+    } else if (kComparisonOps.count(op)) {
+      broadcast(MODEL_TENSOR_DATA_TYPE_BOOL);
+    } else if (op == "Not" || op == "IsNaN" || op == "IsInf") {
+      if (known(0)) {
+        set_output(0, shape(0), MODEL_TENSOR_DATA_TYPE_BOOL);
+      }
+    } else if (op == "Where") {
+      where();
+    } else if (op == "Cast") {
+      cast(onnx_to_model_dtype(
+          static_cast<int>(attribute_int(_node, "to", 0))));
+    } else if (op == "CastLike") {
+      cast(input_dtype(1));
+    } else if (op == "Conv" || op == "ConvInteger" || op == "FusedConv") {
+      conv(op == "ConvInteger" ? MODEL_TENSOR_DATA_TYPE_INT32
+                               : input_dtype(0));
+    } else if (op == "ConvTranspose") {
+      conv_transpose();
+    } else if (op == "MaxPool" || op == "AveragePool" || op == "LpPool") {
+      pool();
+    } else if (op == "GlobalAveragePool" || op == "GlobalMaxPool" ||
+               op == "GlobalLpPool") {
+      global_pool();
+    } else if (op == "Gemm" || op == "FusedGemm") {
+      gemm();
+    } else if (op == "MatMul" || op == "MatMulInteger" ||
+               op == "FusedMatMul") {
+      matmul(op == "MatMulInteger" ? MODEL_TENSOR_DATA_TYPE_INT32
+                                   : input_dtype(0));
+    } else if (op == "Flatten") {
+      flatten();
+    } else if (op == "Reshape") {
+      reshape();
+    } else if (op == "Transpose") {
+      transpose();
+    } else if (op == "Concat") {
+      concat();
+    } else if (op == "Split") {
+      split();
+    } else if (op == "Slice") {
+      slice();
+    } else if (op == "Squeeze") {
+      squeeze();
+    } else if (op == "Unsqueeze") {
+      unsqueeze();
+    } else if (op == "Gather") {
+      gather();
+    } else if (op == "GatherElements") {
+      if (known(1)) {
+        set_output(0, shape(1), input_dtype(0));
+      }
+    } else if (op == "ScatterElements" || op == "ScatterND") {
+      same_as_input(0);
+    } else if (op == "Shape") {
+      shape_of();
+    } else if (op == "Size") {
+      set_output(0, {}, MODEL_TENSOR_DATA_TYPE_INT64);
+    } else if (op == "Pad") {
+      pad();
+    } else if (op == "Resize" || op == "Upsample") {
+      resize();
+    } else if (kReduceOps.count(op)) {
+      reduce(input_dtype(0));
+    } else if (op == "ArgMax" || op == "ArgMin") {
+      arg_reduce();
+    } else if (op == "Expand") {
+      expand();
+    } else if (op == "ConstantOfShape") {
+      constant_of_shape();
+    } else if (op == "Tile") {
+      tile();
+    } else if (op == "TopK") {
+      top_k();
+    } else if (op == "Range") {
+      range();
+    } else if (op == "NonZero") {
+      if (known(0)) {
+        set_output(0, {static_cast<int64_t>(shape(0).size()), kUnknownDim},
+                   MODEL_TENSOR_DATA_TYPE_INT64);
+      }
+    } else if (op == "DepthToSpace" || op == "SpaceToDepth") {
+      depth_space(op == "DepthToSpace");
+    } else if (op == "QuantizeLinear") {
+      if (known(0)) {
+        set_output(0, shape(0),
+                   has_input(2) ? input_dtype(2)
+                                : MODEL_TENSOR_DATA_TYPE_UINT8);
+      }
+    } else if (op == "DequantizeLinear") {
+      if (known(0)) {
+        set_output(0, shape(0),
+                   has_input(1) ? input_dtype(1)
+                                : MODEL_TENSOR_DATA_TYPE_FLOAT32);
+      }
+    } else if (op == "Constant") {
+      // described by the loader
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+private:
+  bool has_input(size_t i) const {
+    return i < _node.input_tensors.size() && _node.input_tensors[i] >= 0;
+  }
+  const sModelTensor &input(size_t i) const {
+    return _graph.tensors[_node.input_tensors[i]];
+  }
+  // rank known. scalars of known type have an empty shape.
+  bool known(size_t i) const {
+    return has_input(i) &&
+           (!input(i).shape.empty() ||
+            input(i).tensorDataType != MODEL_TENSOR_DATA_TYPE_UNDEFINED);
+  }
+  const std::vector<int64_t> &shape(size_t i) const { return input(i).shape; }
+  eModelTensorDataType input_dtype(size_t i) const {
+    return has_input(i) ? input(i).tensorDataType
+                        : MODEL_TENSOR_DATA_TYPE_UNDEFINED;
+  }
+  const std::vector<int64_t> *values(size_t i) const {
+    if (!has_input(i) || !_has_values[_node.input_tensors[i]]) {
+      return nullptr;
+    }
+    return &_values[_node.input_tensors[i]];
+  }
+  // integer list from an attribute (older opsets) or an input (newer ones)
+  bool ints_from(const char *attribute, size_t input_index,
+                 std::vector<int64_t> &out) const {
+    if (_node.attributes.count(attribute)) {
+      out = attribute_ints(_node, attribute);
+      return true;
+    }
+    if (const auto *v = values(input_index)) {
+      out = *v;
+      return true;
+    }
+    return false;
+  }
+
+  void set_output(size_t i, std::vector<int64_t> shape,
+                  eModelTensorDataType dtype) {
+    if (i >= _outputs.size()) {
+      return;
+    }
+    _outputs[i].known = true;
+    _outputs[i].shape = std::move(shape);
+    _outputs[i].dtype = dtype;
+  }
+  void set_values(size_t i, std::vector<int64_t> values) {
+    if (i >= _outputs.size()) {
+      return;
+    }
+    _outputs[i].has_values = true;
+    _outputs[i].values = std::move(values);
+  }
+
+  void same_as_input(size_t i) {
+    if (known(i)) {
+      set_output(0, shape(i), input_dtype(i));
+    }
+  }
+
+  void broadcast(eModelTensorDataType dtype) {
+    std::vector<int64_t> result;
+    for (size_t i = 0; i < _node.input_tensors.size(); ++i) {
+      if (!has_input(i)) {
+        continue;
+      }
+      if (!known(i)) {
+        return;
+      }
+      result = broadcast_shapes(result, shape(i));
+    }
+    set_output(0, std::move(result), dtype);
+  }
+
+  // shape arithmetic, e.g. Gather(Shape) * 2 or sequence length - 1
+  void binary_values() {
+    const auto *a = values(0);
+    const auto *b = values(1);
+    if (!a || !b || _node.input_tensors.size() != 2 ||
+        (a->size() != b->size() && a->size() != 1 && b->size() != 1)) {
+      return;
+    }
+    const auto &op = _node.op_type;
+    const size_t count = std::max(a->size(), b->size());
+    std::vector<int64_t> result(count);
+    for (size_t i = 0; i < count; ++i) {
+      const int64_t x = (*a)[a->size() == 1 ? 0 : i];
+      const int64_t y = (*b)[b->size() == 1 ? 0 : i];
+      if (is_dim_value(x) || is_dim_value(y)) {
+        // symbols and unknown dims only survive identities
+        if ((op == "Mul" || op == "Div" || op == "Add" || op == "Sub") &&
+            y == (op == "Mul" || op == "Div" ? 1 : 0)) {
+          result[i] = x;
+        } else if ((op == "Mul" && x == 1) || (op == "Add" && x == 0)) {
+          result[i] = y;
+        } else {
+          result[i] = kUnknownValue;
+        }
+      } else if (op == "Add") {
+        result[i] = x + y;
+      } else if (op == "Sub") {
+        result[i] = x - y;
+      } else if (op == "Mul") {
+        result[i] = x * y;
+      } else if (op == "Div" && y != 0) {
+        result[i] = x / y;
+      } else {
+        return;
+      }
+    }
+    set_values(0, std::move(result));
+  }
+
+  void where() {
+    std::vector<int64_t> result;
+    for (size_t i = 0; i < 3; ++i) {
+      if (!known(i)) {
+        return;
+      }
+      result = broadcast_shapes(result, shape(i));
+    }
+    set_output(0, std::move(result), input_dtype(1));
+  }
+
+  void cast(eModelTensorDataType dtype) {
+    if (!known(0)) {
+      return;
+    }
+    set_output(0, shape(0), dtype);
+    if (const auto *v = values(0)) {
+      set_values(0, *v);
+    }
+  }
+
+  // spatial dims of a windowed op over input 0
+  bool spatial_dims(const std::vector<int64_t> &kernel,
+                    std::vector<int64_t> &dims, bool ceil_mode) {
+    const auto &in = shape(0);
+    const size_t spatial = in.size() - 2;
+    if (kernel.size() != spatial) {
+      return false;
+    }
+    auto strides = attribute_ints(_node, "strides");
+    auto dilations = attribute_ints(_node, "dilations");
+    auto pads = attribute_ints(_node, "pads");
+    strides.resize(spatial, 1);
+    dilations.resize(spatial, 1);
+    pads.resize(2 * spatial, 0);
+    const auto auto_pad = attribute_string(_node, "auto_pad", "NOTSET");
+    for (size_t i = 0; i < spatial; ++i) {
+      dims.push_back(window_output(in[2 + i], kernel[i], strides[i],
+                                   dilations[i], pads[i], pads[spatial + i],
+                                   auto_pad, ceil_mode));
+    }
+    return true;
+  }
+
+  void conv(eModelTensorDataType dtype) {
+    if (!known(0) || shape(0).size() < 3 || !known(1) ||
+        shape(1).size() != shape(0).size()) {
+      return;
+    }
+    auto kernel = attribute_ints(_node, "kernel_shape");
+    if (kernel.empty()) {
+      kernel.assign(shape(1).begin() + 2, shape(1).end());
+    }
+    std::vector<int64_t> out = {shape(0)[0], shape(1)[0]};
+    if (spatial_dims(kernel, out, false)) {
+      set_output(0, std::move(out), dtype);
+    }
+  }
+
+  void conv_transpose() {
+    if (!known(0) || shape(0).size() < 3 || !known(1) ||
+        shape(1).size() != shape(0).size()) {
+      return;
+    }
+    const auto &in = shape(0);
+    const size_t spatial = in.size() - 2;
+    const int64_t group = attribute_int(_node, "group", 1);
+    const int64_t channels =
+        is_static(shape(1)[1]) ? shape(1)[1] * group : kUnknownDim;
+    std::vector<int64_t> out = {in[0], channels};
+
+    auto output_shape = attribute_ints(_node, "output_shape");
+    if (output_shape.size() == spatial) {
+      out.insert(out.end(), output_shape.begin(), output_shape.end());
+      set_output(0, std::move(out), input_dtype(0));
+      return;
+    }
+    auto kernel = attribute_ints(_node, "kernel_shape");
+    if (kernel.empty()) {
+      kernel.assign(shape(1).begin() + 2, shape(1).end());
+    }
+    auto strides = attribute_ints(_node, "strides");
+    auto dilations = attribute_ints(_node, "dilations");
+    auto pads = attribute_ints(_node, "pads");
+    auto output_padding = attribute_ints(_node, "output_padding");
+    strides.resize(spatial, 1);
+    dilations.resize(spatial, 1);
+    pads.resize(2 * spatial, 0);
+    output_padding.resize(spatial, 0);
+    const auto auto_pad = attribute_string(_node, "auto_pad", "NOTSET");
+    for (size_t i = 0; i < spatial && i < kernel.size(); ++i) {
+      const int64_t dim = in[2 + i];
+      if (!is_static(dim)) {
+        out.push_back(kUnknownDim);
+      } else if (auto_pad == "SAME_UPPER" || auto_pad == "SAME_LOWER") {
+        out.push_back(dim * strides[i]);
+      } else {
+        out.push_back(strides[i] * (dim - 1) + output_padding[i] +
+                      (kernel[i] - 1) * dilations[i] + 1 - pads[i] -
+                      pads[spatial + i]);
+      }
+    }
+    if (out.size() == in.size()) {
+      set_output(0, std::move(out), input_dtype(0));
+    }
+  }
+
+  void pool() {
+    if (!known(0) || shape(0).size() < 3) {
+      return;
+    }
+    const auto kernel = attribute_ints(_node, "kernel_shape");
+    std::vector<int64_t> out = {shape(0)[0], shape(0)[1]};
+    if (!spatial_dims(kernel, out,
+                      attribute_int(_node, "ceil_mode", 0) != 0)) {
+      return;
+    }
+    set_output(1, out, MODEL_TENSOR_DATA_TYPE_INT64);
+    set_output(0, std::move(out), input_dtype(0));
+  }
+
+  void global_pool() {
+    if (!known(0) || shape(0).size() < 2) {
+      return;
+    }
+    std::vector<int64_t> out(shape(0).size(), 1);
+    out[0] = shape(0)[0];
+    out[1] = shape(0)[1];
+    set_output(0, std::move(out), input_dtype(0));
+  }
+
+  void gemm() {
+    if (!known(0) || !known(1) || shape(0).size() != 2 ||
+        shape(1).size() != 2) {
+      return;
+    }
+    const bool trans_a = attribute_int(_node, "transA", 0) != 0;
+    const bool trans_b = attribute_int(_node, "transB", 0) != 0;
+    set_output(0, {shape(0)[trans_a ? 1 : 0], shape(1)[trans_b ? 0 : 1]},
+               input_dtype(0));
+  }
+
+  void matmul(eModelTensorDataType dtype) {
+    if (!known(0) || !known(1) || shape(0).empty() || shape(1).empty()) {
+      return;
+    }
+    auto a = shape(0);
+    auto b = shape(1);
+    const bool vector_a = a.size() == 1;
+    const bool vector_b = b.size() == 1;
+    if (vector_a) {
+      a.insert(a.begin(), 1);
+    }
+    if (vector_b) {
+      b.push_back(1);
+    }
+    auto out = broadcast_shapes({a.begin(), a.end() - 2},
+                                {b.begin(), b.end() - 2});
+    if (!vector_a) {
+      out.push_back(a[a.size() - 2]);
+    }
+    if (!vector_b) {
+      out.push_back(b.back());
+    }
+    set_output(0, std::move(out), dtype);
+  }
+
+  void flatten() {
+    if (!known(0)) {
+      return;
+    }
+    const auto &in = shape(0);
+    const int64_t axis = attribute_int(_node, "axis", 1);
+    const int64_t rank = static_cast<int64_t>(in.size());
+    const size_t split = static_cast<size_t>(
+        std::clamp<int64_t>(axis < 0 ? axis + rank : axis, 0, rank));
+    set_output(0,
+               {dim_product(in, 0, split), dim_product(in, split, in.size())},
+               input_dtype(0));
+  }
+
+  void reshape() {
+    const auto *target = values(1);
+    if (!target) {
+      // the rank still follows from the shape operand's length
+      if (known(1) && shape(1).size() == 1 && is_static(shape(1)[0])) {
+        set_output(0, std::vector<int64_t>(shape(1)[0], kUnknownDim),
+                   input_dtype(0));
+      }
+      return;
+    }
+    const bool allow_zero = attribute_int(_node, "allowzero", 0) != 0;
+    const bool input_known = known(0);
+    std::vector<int64_t> out;
+    int infer_axis = -1;
+    for (size_t i = 0; i < target->size(); ++i) {
+      const int64_t value = (*target)[i];
+      if (value == 0 && !allow_zero) {
+        out.push_back(input_known && i < shape(0).size() ? shape(0)[i]
+                                                         : kUnknownDim);
+      } else if (value == -1) {
+        infer_axis = static_cast<int>(i);
+        out.push_back(kUnknownDim);
+      } else {
+        out.push_back(dim_from_value(value));
+      }
+    }
+    if (infer_axis >= 0 && input_known) {
+      out[infer_axis] = inferred_reshape_dim(shape(0), out, infer_axis);
+    }
+    set_output(0, std::move(out), input_dtype(0));
+    if (const auto *v = values(0)) {
+      set_values(0, *v);
+    }
+  }
+
+  // the -1 dim of a reshape: total input size over the other output dims,
+  // cancelling symbols that appear on both sides
+  static int64_t inferred_reshape_dim(const std::vector<int64_t> &in,
+                                      const std::vector<int64_t> &out,
+                                      int infer_axis) {
+    int64_t in_static = 1;
+    int64_t out_static = 1;
+    std::vector<int64_t> symbols;
+    for (int64_t dim : in) {
+      if (dim == kUnknownDim) {
+        return kUnknownDim;
+      }
+      if (is_static(dim)) {
+        in_static *= dim;
+      } else {
+        symbols.push_back(dim);
+      }
+    }
+    for (size_t i = 0; i < out.size(); ++i) {
+      if (static_cast<int>(i) == infer_axis) {
+        continue;
+      }
+      const int64_t dim = out[i];
+      if (dim == kUnknownDim) {
+        return kUnknownDim;
+      }
+      if (is_static(dim)) {
+        out_static *= dim;
+        continue;
+      }
+      auto it = std::find(symbols.begin(), symbols.end(), dim);
+      if (it == symbols.end()) {
+        return kUnknownDim;
+      }
+      symbols.erase(it);
+    }
+    if (out_static == 0) {
+      return kUnknownDim;
+    }
+    if (symbols.empty()) {
+      return in_static % out_static == 0 ? in_static / out_static
+                                         : kUnknownDim;
+    }
+    return symbols.size() == 1 && in_static == out_static ? symbols[0]
+                                                          : kUnknownDim;
+  }
+
+  void transpose() {
+    if (!known(0)) {
+      return;
+    }
+    const auto &in = shape(0);
+    auto perm = attribute_ints(_node, "perm");
+    if (perm.empty()) {
+      for (size_t i = in.size(); i-- > 0;) {
+        perm.push_back(static_cast<int64_t>(i));
+      }
+    }
+    std::vector<int64_t> out;
+    for (int64_t axis : perm) {
+      const int i = normalize_axis(axis, in.size());
+      if (i < 0) {
+        return;
+      }
+      out.push_back(in[i]);
+    }
+    set_output(0, std::move(out), input_dtype(0));
+  }
+
+  void concat() {
+    size_t rank = 0;
+    bool all_values = true;
+    std::vector<int64_t> concatenated;
+    for (size_t i = 0; i < _node.input_tensors.size(); ++i) {
+      if (!known(i)) {
+        return;
+      }
+      rank = shape(i).size();
+      if (const auto *v = values(i)) {
+        concatenated.insert(concatenated.end(), v->begin(), v->end());
+      } else {
+        all_values = false;
+      }
+    }
+    const int axis = normalize_axis(attribute_int(_node, "axis", 0), rank);
+    if (axis < 0) {
+      return;
+    }
+    std::vector<int64_t> out(rank, kUnknownDim);
+    int64_t length = 0;
+    for (size_t i = 0; i < _node.input_tensors.size(); ++i) {
+      const auto &in = shape(i);
+      if (in.size() != rank) {
+        return;
+      }
+      for (size_t d = 0; d < rank; ++d) {
+        if (static_cast<int>(d) == axis) {
+          length = is_static(in[d]) && length >= 0 ? length + in[d]
+                                                   : kUnknownDim;
+        } else if (!is_static(out[d])) {
+          // prefer static dims, then symbols, over unknown ones
+          if (is_static(in[d]) || out[d] == kUnknownDim) {
+            out[d] = in[d];
+          }
+        }
+      }
+    }
+    out[axis] = length;
+    set_output(0, std::move(out), input_dtype(0));
+    if (all_values) {
+      set_values(0, std::move(concatenated));
+    }
+  }
+
+  void split() {
+    if (!known(0)) {
+      return;
+    }
+    const auto &in = shape(0);
+    const int axis =
+        normalize_axis(attribute_int(_node, "axis", 0), in.size());
+    if (axis < 0) {
+      return;
+    }
+    const size_t count = _node.output_tensors.size();
+    const int64_t parts = static_cast<int64_t>(count);
+    std::vector<int64_t> sizes;
+    if (!ints_from("split", 1, sizes) || sizes.size() != count) {
+      sizes.assign(count, kUnknownDim);
+      if (is_static(in[axis]) && count > 0) {
+        // equal parts, the last one smaller if uneven
+        const int64_t part = (in[axis] + parts - 1) / parts;
+        for (int64_t i = 0; i < parts; ++i) {
+          sizes[i] = std::clamp<int64_t>(in[axis] - part * i, 0, part);
+        }
+      }
+    }
+    for (size_t i = 0; i < count; ++i) {
+      auto out = in;
+      out[axis] = sizes[i];
+      set_output(i, std::move(out), input_dtype(0));
+    }
+  }
+
+  void slice() {
+    if (!known(0)) {
+      return;
+    }
+    std::vector<int64_t> starts, ends, axes, steps;
+    if (!ints_from("starts", 1, starts) || !ints_from("ends", 2, ends) ||
+        starts.size() != ends.size()) {
+      // the rank is preserved either way
+      set_output(0, std::vector<int64_t>(shape(0).size(), kUnknownDim),
+                 input_dtype(0));
+      return;
+    }
+    const auto &in = shape(0);
+    if (!ints_from("axes", 3, axes)) {
+      for (size_t i = 0; i < starts.size(); ++i) {
+        axes.push_back(static_cast<int64_t>(i));
+      }
+    }
+    if (!has_input(4) || !ints_from("steps", 4, steps)) {
+      steps.assign(starts.size(), 1);
+    }
+    if (axes.size() != starts.size() || steps.size() != starts.size()) {
+      return;
+    }
+    auto out = in;
+    for (size_t i = 0; i < starts.size(); ++i) {
+      const int axis = normalize_axis(axes[i], in.size());
+      if (axis < 0) {
+        return;
+      }
+      out[axis] = slice_length(in[axis], starts[i], ends[i], steps[i]);
+    }
+    // slices of shape vectors, e.g. Shape(x)[2:]
+    const auto *v = values(0);
+    if (v && in.size() == 1 && is_static(out[0])) {
+      const int64_t length = static_cast<int64_t>(v->size());
+      int64_t start = starts[0] < 0 ? starts[0] + length : starts[0];
+      start = std::clamp<int64_t>(start, 0, length);
+      std::vector<int64_t> sliced;
+      for (int64_t i = 0; i < out[0]; ++i) {
+        const int64_t index = start + i * steps[0];
+        if (index < 0 || index >= length) {
+          sliced.clear();
+          break;
+        }
+        sliced.push_back((*v)[index]);
+      }
+      if (static_cast<int64_t>(sliced.size()) == out[0]) {
+        set_values(0, std::move(sliced));
+      }
+    }
+    set_output(0, std::move(out), input_dtype(0));
+  }
+
+  void squeeze() {
+    if (!known(0)) {
+      return;
+    }
+    const auto &in = shape(0);
+    std::vector<int64_t> axes;
+    std::vector<bool> removed(in.size(), false);
+    if (ints_from("axes", 1, axes)) {
+      for (int64_t axis : axes) {
+        const int i = normalize_axis(axis, in.size());
+        if (i < 0) {
+          return;
+        }
+        removed[i] = true;
+      }
+    } else {
+      for (size_t i = 0; i < in.size(); ++i) {
+        if (!is_static(in[i])) {
+          // could be 1 at runtime
+          return;
+        }
+        removed[i] = in[i] == 1;
+      }
+    }
+    std::vector<int64_t> out;
+    for (size_t i = 0; i < in.size(); ++i) {
+      if (!removed[i]) {
+        out.push_back(in[i]);
+      }
+    }
+    set_output(0, std::move(out), input_dtype(0));
+    if (const auto *v = values(0)) {
+      set_values(0, *v);
+    }
+  }
+
+  void unsqueeze() {
+    if (!known(0)) {
+      return;
+    }
+    std::vector<int64_t> axes;
+    if (!ints_from("axes", 1, axes)) {
+      return;
+    }
+    const auto &in = shape(0);
+    const size_t rank = in.size() + axes.size();
+    std::vector<bool> inserted(rank, false);
+    for (int64_t axis : axes) {
+      const int i = normalize_axis(axis, rank);
+      if (i < 0) {
+        return;
+      }
+      inserted[i] = true;
+    }
+    std::vector<int64_t> out;
+    size_t next = 0;
+    for (size_t i = 0; i < rank; ++i) {
+      if (inserted[i]) {
+        out.push_back(1);
+      } else if (next < in.size()) {
+        out.push_back(in[next++]);
+      }
+    }
+    set_output(0, std::move(out), input_dtype(0));
+    if (const auto *v = values(0)) {
+      set_values(0, *v);
+    }
+  }
+
+  void gather() {
+    if (!known(0) || !known(1)) {
+      return;
+    }
+    const auto &data = shape(0);
+    const auto &indices = shape(1);
+    const int axis =
+        normalize_axis(attribute_int(_node, "axis", 0), data.size());
+    if (axis < 0) {
+      return;
+    }
+    std::vector<int64_t> out(data.begin(), data.begin() + axis);
+    out.insert(out.end(), indices.begin(), indices.end());
+    out.insert(out.end(), data.begin() + axis + 1, data.end());
+    set_output(0, std::move(out), input_dtype(0));
+
+    // picking dims out of a shape vector
+    const auto *v = values(0);
+    const auto *index_values = values(1);
+    if (v && index_values && data.size() == 1) {
+      std::vector<int64_t> picked;
+      const int64_t length = static_cast<int64_t>(v->size());
+      for (int64_t index : *index_values) {
+        if (index < 0) {
+          index += length;
+        }
+        if (index < 0 || index >= length) {
+          return;
+        }
+        picked.push_back((*v)[index]);
+      }
+      set_values(0, std::move(picked));
+    }
+  }
+
+  void shape_of() {
+    if (!known(0)) {
+      return;
+    }
+    const auto &in = shape(0);
+    const int64_t rank = static_cast<int64_t>(in.size());
+    int64_t start = attribute_int(_node, "start", 0);
+    int64_t end = attribute_int(_node, "end", rank);
+    start = std::clamp<int64_t>(start < 0 ? start + rank : start, 0, rank);
+    end = std::clamp<int64_t>(end < 0 ? end + rank : end, 0, rank);
+    std::vector<int64_t> dims;
+    for (int64_t i = start; i < end; ++i) {
+      dims.push_back(value_from_dim(in[i]));
+    }
+    set_output(0, {static_cast<int64_t>(dims.size())},
+               MODEL_TENSOR_DATA_TYPE_INT64);
+    set_values(0, std::move(dims));
+  }
+
+  void pad() {
+    if (!known(0)) {
+      return;
+    }
+    const auto &in = shape(0);
+    std::vector<int64_t> pads;
+    if (!ints_from("pads", 1, pads) || pads.size() != 2 * in.size()) {
+      set_output(0, std::vector<int64_t>(in.size(), kUnknownDim),
+                 input_dtype(0));
+      return;
+    }
+    auto out = in;
+    for (size_t i = 0; i < in.size(); ++i) {
+      const int64_t extra = pads[i] + pads[in.size() + i];
+      if (extra != 0) {
+        out[i] = is_static(in[i]) ? in[i] + extra : kUnknownDim;
+      }
+    }
+    set_output(0, std::move(out), input_dtype(0));
+  }
+
+  // float scales are not captured by the loader, so only explicit sizes
+  // give dims; the rank is known regardless
+  void resize() {
+    if (!known(0)) {
+      return;
+    }
+    const auto &in = shape(0);
+    if (_node.op_type == "Resize") {
+      if (const auto *sizes = values(3); sizes && sizes->size() == in.size()) {
+        std::vector<int64_t> out;
+        for (int64_t value : *sizes) {
+          out.push_back(dim_from_value(value));
+        }
+        set_output(0, std::move(out), input_dtype(0));
+        return;
+      }
+    }
+    std::vector<int64_t> out(in.size(), kUnknownDim);
+    if (in.size() >= 2) {
+      // image resizes keep batch and channels
+      out[0] = in[0];
+      out[1] = in[1];
+    }
+    set_output(0, std::move(out), input_dtype(0));
+  }
+
+  void reduce(eModelTensorDataType dtype) {
+    if (!known(0)) {
+      return;
+    }
+    const auto &in = shape(0);
+    const bool keep_dims = attribute_int(_node, "keepdims", 1) != 0;
+    std::vector<int64_t> axes;
+    if (!ints_from("axes", 1, axes)) {
+      if (has_input(1)) {
+        // axes computed at runtime
+        if (keep_dims) {
+          set_output(0, std::vector<int64_t>(in.size(), kUnknownDim), dtype);
+        }
+        return;
+      }
+      if (attribute_int(_node, "noop_with_empty_axes", 0) != 0) {
+        set_output(0, in, dtype);
+        return;
+      }
+      for (size_t i = 0; i < in.size(); ++i) {
+        axes.push_back(static_cast<int64_t>(i));
+      }
+    }
+    std::vector<bool> reduced(in.size(), false);
+    for (int64_t axis : axes) {
+      const int i = normalize_axis(axis, in.size());
+      if (i < 0) {
+        return;
+      }
+      reduced[i] = true;
+    }
+    std::vector<int64_t> out;
+    for (size_t i = 0; i < in.size(); ++i) {
+      if (!reduced[i]) {
+        out.push_back(in[i]);
+      } else if (keep_dims) {
+        out.push_back(1);
+      }
+    }
+    set_output(0, std::move(out), dtype);
+  }
+
+  void arg_reduce() {
+    if (!known(0)) {
+      return;
+    }
+    const auto &in = shape(0);
+    const int axis =
+        normalize_axis(attribute_int(_node, "axis", 0), in.size());
+    if (axis < 0) {
+      return;
+    }
+    auto out = in;
+    if (attribute_int(_node, "keepdims", 1) != 0) {
+      out[axis] = 1;
+    } else {
+      out.erase(out.begin() + axis);
+    }
+    set_output(0, std::move(out), MODEL_TENSOR_DATA_TYPE_INT64);
+  }
+
+  std::vector<int64_t> dims_from_values(const std::vector<int64_t> &v) const {
+    std::vector<int64_t> dims;
+    for (int64_t value : v) {
+      dims.push_back(dim_from_value(value));
+    }
+    return dims;
+  }
+
+  void expand() {
+    if (!known(0)) {
+      return;
+    }
+    if (const auto *target = values(1)) {
+      set_output(0, broadcast_shapes(shape(0), dims_from_values(*target)),
+                 input_dtype(0));
+    } else if (known(1) && shape(1).size() == 1 && is_static(shape(1)[0])) {
+      const size_t rank = std::max<size_t>(shape(0).size(), shape(1)[0]);
+      set_output(0, std::vector<int64_t>(rank, kUnknownDim), input_dtype(0));
+    }
+  }
+
+  void constant_of_shape() {
+    // the fill value's type is not kept by the loader; float is the default
+    const auto dtype = _node.attributes.count("value")
+                           ? MODEL_TENSOR_DATA_TYPE_UNDEFINED
+                           : MODEL_TENSOR_DATA_TYPE_FLOAT32;
+    if (const auto *target = values(0)) {
+      set_output(0, dims_from_values(*target), dtype);
+    } else if (known(0) && shape(0).size() == 1 && is_static(shape(0)[0])) {
+      set_output(0, std::vector<int64_t>(shape(0)[0], kUnknownDim), dtype);
+    }
+  }
+
+  void tile() {
+    if (!known(0)) {
+      return;
+    }
+    const auto &in = shape(0);
+    const auto *repeats = values(1);
+    auto out = in;
+    for (size_t i = 0; i < in.size(); ++i) {
+      const int64_t repeat =
+          repeats && repeats->size() == in.size() ? (*repeats)[i] : -1;
+      if (repeat != 1) {
+        out[i] = is_static(in[i]) && repeat >= 0 ? in[i] * repeat
+                                                 : kUnknownDim;
+      }
+    }
+    set_output(0, std::move(out), input_dtype(0));
+  }
+
+  void top_k() {
+    if (!known(0)) {
+      return;
+    }
+    auto out = shape(0);
+    const int axis =
+        normalize_axis(attribute_int(_node, "axis", -1), out.size());
+    if (axis < 0) {
+      return;
+    }
+    const auto *k = values(1);
+    out[axis] = k && k->size() == 1 ? dim_from_value((*k)[0]) : kUnknownDim;
+    set_output(1, out, MODEL_TENSOR_DATA_TYPE_INT64);
+    set_output(0, std::move(out), input_dtype(0));
+  }
+
+  void range() {
+    const auto *start = values(0);
+    const auto *limit = values(1);
+    const auto *delta = values(2);
+    int64_t length = kUnknownDim;
+    if (!start || !limit || !delta || start->size() != 1 ||
+        limit->size() != 1 || delta->size() != 1) {
+      // unknown length
+    } else if (!is_dim_value((*start)[0]) && !is_dim_value((*limit)[0]) &&
+               !is_dim_value((*delta)[0]) && (*delta)[0] != 0) {
+      const int64_t d = (*delta)[0];
+      length = std::max<int64_t>(
+          0, ((*limit)[0] - (*start)[0] + d - (d > 0 ? 1 : -1)) / d);
+    } else if ((*start)[0] == 0 && (*delta)[0] == 1) {
+      // arange(seq_len) keeps the symbol
+      length = dim_from_value((*limit)[0]);
+    }
+    set_output(0, {length}, input_dtype(0));
+  }
+
+  void depth_space(bool to_space) {
+    if (!known(0) || shape(0).size() != 4) {
+      return;
+    }
+    const auto &in = shape(0);
+    const int64_t block = attribute_int(_node, "blocksize", 1);
+    const int64_t area = block * block;
+    auto scaled = [](int64_t dim, int64_t factor, bool multiply) {
+      if (!is_static(dim)) {
+        return kUnknownDim;
+      }
+      return multiply ? dim * factor : dim / factor;
+    };
+    set_output(0,
+               {in[0], scaled(in[1], area, !to_space),
+                scaled(in[2], block, to_space),
+                scaled(in[3], block, to_space)},
+               input_dtype(0));
+  }
+};
+
+bool shape_known(const sModelTensor &tensor) {
+  return !tensor.shape.empty() ||
+         tensor.tensorDataType != MODEL_TENSOR_DATA_TYPE_UNDEFINED;
+}
+
+} // namespace
+
+int64_t intern_dim_symbol(sModelGraph &graph, const std::string &name) {
+  auto it = std::find(graph.dim_symbols.begin(), graph.dim_symbols.end(), name);
+  const int64_t index = it - graph.dim_symbols.begin();
+  if (it == graph.dim_symbols.end()) {
+    graph.dim_symbols.push_back(name);
+  }
+  return -2 - index;
+}
+
+std::string dim_to_string(const sModelGraph &graph, int64_t dim) {
+  if (dim >= 0) {
+    return std::to_string(dim);
+  }
+  const int64_t symbol = -2 - dim;
+  if (symbol >= 0 && symbol < static_cast<int64_t>(graph.dim_symbols.size())) {
+    return graph.dim_symbols[symbol];
+  }
+  return "?";
+}
+
+std::string shape_to_string(const sModelGraph &graph,
+                            const sModelTensor &tensor) {
+  if (!shape_known(tensor)) {
+    return "?";
+  }
+  std::string text = "[";
+  for (size_t i = 0; i < tensor.shape.size(); ++i) {
+    if (i > 0) {
+      text += ", ";
+    }
+    text += dim_to_string(graph, tensor.shape[i]);
+  }
+  return text + "]";
+}
+
+const sShapeInferenceStats &ShapeInference::run(sModelGraph &graph) {
+  const size_t tensor_count = graph.tensors.size();
+  _declared_shapes.resize(tensor_count);
+  _declared_types.resize(tensor_count);
+  _has_values.assign(tensor_count, false);
+  _values.assign(tensor_count, {});
+  for (size_t t = 0; t < tensor_count; ++t) {
+    const auto &tensor = graph.tensors[t];
+    _declared_shapes[t] = tensor.shape;
+    _declared_types[t] = tensor.tensorDataType;
+    if (tensor.has_values) {
+      _has_values[t] = true;
+      _values[t] = tensor.values;
+    }
+  }
+  _order = topological_order(graph);
+
+  std::vector<bool> dirty(tensor_count, false);
+  infer(graph, dirty, true);
+  return _stats;
+}
+
+const sShapeInferenceStats &
+ShapeInference::update_input_shape(sModelGraph &graph, int tensor_index,
+                                   const std::vector<int64_t> &shape) {
+  if (_declared_shapes.size() != graph.tensors.size()) {
+    run(graph);
+  }
+  std::vector<bool> dirty(graph.tensors.size(), false);
+  if (tensor_index >= 0 &&
+      tensor_index < static_cast<int>(graph.tensors.size())) {
+    graph.tensors[tensor_index].shape = shape;
+    _declared_shapes[tensor_index] = shape;
+    dirty[tensor_index] = true;
+  }
+  infer(graph, dirty, false);
+  return _stats;
+}
+
+void ShapeInference::infer(sModelGraph &graph, std::vector<bool> &dirty,
+                           bool everything) {
+  const auto started = std::chrono::steady_clock::now();
+  _stats = {};
+  std::vector<sInferredTensor> outputs;
+  for (int node_index : _order) {
+    const auto &node = graph.nodes[node_index];
+    if (!everything &&
+        std::none_of(node.input_tensors.begin(), node.input_tensors.end(),
+                     [&](int t) { return t >= 0 && dirty[t]; })) {
+      continue;
+    }
+    ++_stats.nodes_visited;
+    NodeShapeInferer inferer(graph, node, _has_values, _values, outputs);
+    if (!inferer.infer()) {
+      ++_stats.unsupported_ops[node.op_type];
+    }
+
+    for (size_t i = 0; i < node.output_tensors.size(); ++i) {
+      const int t = node.output_tensors[i];
+      if (t < 0) {
+        continue;
+      }
+      auto &tensor = graph.tensors[t];
+      if (tensor.is_initializer || node.op_type == "Constant") {
+        continue;
+      }
+      const auto &inferred = outputs[i];
+      // start over from the declaration, then let inferred dims win
+      std::vector<int64_t> shape = _declared_shapes[t];
+      auto dtype = _declared_types[t];
+      if (inferred.known) {
+        const auto &declared = _declared_shapes[t];
+        shape = inferred.shape;
+        for (size_t d = 0; d < shape.size(); ++d) {
+          if (shape[d] == kUnknownDim && declared.size() == shape.size()) {
+            shape[d] = declared[d];
+          }
+        }
+        if (inferred.dtype != MODEL_TENSOR_DATA_TYPE_UNDEFINED) {
+          dtype = inferred.dtype;
+        }
+      }
+      const bool values_changed =
+          inferred.has_values != _has_values[t] ||
+          (inferred.has_values && inferred.values != _values[t]);
+      if (shape != tensor.shape || dtype != tensor.tensorDataType ||
+          values_changed) {
+        tensor.shape = std::move(shape);
+        tensor.tensorDataType = dtype;
+        _has_values[t] = inferred.has_values;
+        _values[t] = inferred.values;
+        // the graph gets literal contents only, not dims read by Shape
+        tensor.has_values =
+            inferred.has_values &&
+            std::none_of(inferred.values.begin(), inferred.values.end(),
+                         is_dim_value);
+        tensor.values = tensor.has_values ? inferred.values
+                                          : std::vector<int64_t>{};
+        dirty[t] = true;
+        ++_stats.tensors_updated;
+      }
+    }
+  }
+
+  for (const auto &tensor : graph.tensors) {
+    if (tensor.is_initializer) {
+      continue;
+    }
+    if (!shape_known(tensor)) {
+      ++_stats.unknown_tensors;
+    } else if (std::find(tensor.shape.begin(), tensor.shape.end(),
+                         kUnknownDim) != tensor.shape.end()) {
+      ++_stats.partial_tensors;
+    }
+  }
+  _stats.elapsed_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - started)
+                          .count();
+}
+
+void pin_input_shapes(sModelGraph &graph, int64_t batch_size) {
+  for (int t : graph.input_tensors) {
+    auto &tensor = graph.tensors[t];
+    if (tensor.is_initializer) {
+      continue;
+    }
+    for (size_t d = 0; d < tensor.shape.size(); ++d) {
+      if (tensor.shape[d] < 0) {
+        tensor.shape[d] = d == 0 ? batch_size : 1;
+      }
+    }
+  }
+  ShapeInference().run(graph);
+}
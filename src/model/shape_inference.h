@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// symbolic dims are stored as negative dim values, see
+// sModelGraph::dim_symbols. returns the dim value of `name`, adding it if new.
+int64_t intern_dim_symbol(sModelGraph &graph, const std::string &name);
+
+// "?" for unknown dims, the symbol name for symbolic ones
+std::string dim_to_string(const sModelGraph &graph, int64_t dim);
+// e.g. "[batch, 3, 224, 224]", "?" if the rank is unknown
+std::string shape_to_string(const sModelGraph &graph,
+                            const sModelTensor &tensor);
+
+// fixes the symbolic and unknown dims of the graph inputs (leading dim to
+// `batch_size`, others to 1) and re-infers every shape from there
+void pin_input_shapes(sModelGraph &graph, int64_t batch_size);
+
+struct sShapeInferenceStats {
+  int nodes_visited = 0;
+  // tensors whose shape or type changed
+  int tensors_updated = 0;
+  // non-initializer tensors without a rank, and with some unknown dims
+  int unknown_tensors = 0;
+  int partial_tensors = 0;
+  // op types without an inference rule, with their node counts
+  std::map<std::string, int> unsupported_ops;
+  double elapsed_ms = 0.0;
+};
+
+// Native shape and dtype inference over sModelGraph. Symbolic dims (dynamic
+// batch, sequence length, ..) are propagated through the ops that preserve
+// them, and small integer tensors computed from shapes (Shape -> Gather ->
+// Concat -> Reshape chains) are evaluated so dynamic reshapes resolve.
+// Shapes declared by the model seed the pass and fill dims it cannot infer.
+class ShapeInference {
+private:
+  // shapes and types as declared by the model, before any inference
+  std::vector<std::vector<int64_t>> _declared_shapes;
+  std::vector<eModelTensorDataType> _declared_types;
+  // propagated integer contents, symbolic dims encoded (see .cpp)
+  std::vector<bool> _has_values;
+  std::vector<std::vector<int64_t>> _values;
+  std::vector<int> _order;
+  sShapeInferenceStats _stats;
+
+  void infer(sModelGraph &graph, std::vector<bool> &dirty, bool everything);
+
+public:
+  // infers every node
+  const sShapeInferenceStats &run(sModelGraph &graph);
+  // replaces the shape of `tensor_index` and re-infers the nodes downstream
+  // of it, stopping wherever shapes stop changing. run() must have been
+  // called on this graph before.
+  const sShapeInferenceStats &update_input_shape(
+      sModelGraph &graph, int tensor_index, const std::vector<int64_t> &shape);
+  const sShapeInferenceStats &stats() const { return _stats; }
+};
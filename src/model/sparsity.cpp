@@ -0,0 +1,408 @@
+#include "sparsity.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+#include "../engine/thread_pool.h"
+#include "cost_model.h"
+#include "graph_utils.h"
+#include "weight_stats.h"
+
+namespace {
+
+// time a sparse kernel spends per remaining nonzero, relative to a dense
+// kernel per weight: index loads and scattered reads for unstructured
+// sparsity, the metadata of 2:4, a smaller dense kernel for pruned
+// channels and dense 4x4 micro-kernels for tiles
+constexpr std::array<double, PRUNING_PATTERN_COUNT> kNonzeroCost = {
+    3.0, 1.1, 1.0, 1.3};
+// 2:4 kernels need every group to conform
+constexpr double kMin24Conformance = 0.999;
+constexpr int kTile = 4;
+// magnitude bins: the exponent and 3 mantissa bits of |x|
+constexpr int kMagnitudeShift = 20;
+constexpr int kMagnitudeBins = 1 << (31 - kMagnitudeShift);
+
+double kernel_speedup(ePruningPattern pattern, double density) {
+  return std::max(1.0, 1.0 / (std::max(density, 1e-6) *
+                              kNonzeroCost[pattern]));
+}
+
+// Amdahl's law with FLOPs standing in for time
+double model_speedup(double share, double speedup) {
+  return 1.0 / (1.0 - share + share / speedup);
+}
+
+int magnitude_bin(float x) {
+  uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  return static_cast<int>((bits & 0x7fffffffu) >> kMagnitudeShift);
+}
+
+// squared norm removed by zeroing the `count` smallest of `values`
+double smallest_sum(std::vector<double> &values, size_t count) {
+  count = std::min(count, values.size());
+  std::nth_element(values.begin(), values.begin() + count, values.end());
+  return std::accumulate(values.begin(), values.begin() + count, 0.0);
+}
+
+// one pass over initializer `index` in 4x4 tiles, in storage order, read a
+// stripe of 4 storage lines at a time
+void analyze_weight(const MappedInitializers &initializers, size_t index,
+                    const sSparsityConfig &config, sLayerSparsity &layer) {
+  const auto &m = layer.matrix;
+  const int64_t tile_rows = (m.rows + kTile - 1) / kTile;
+  const int64_t tile_cols = (m.cols + kTile - 1) / kTile;
+  std::vector<double> row_energy(m.rows, 0.0);
+  std::vector<double> tile_energy(tile_rows * tile_cols, 0.0);
+  std::vector<double> bin_count(kMagnitudeBins, 0.0);
+  std::vector<double> bin_energy(kMagnitudeBins, 0.0);
+  size_t zeros = 0;
+  size_t groups = 0;
+  size_t conforming = 0;
+  int64_t zero_tiles = 0;
+  double loss_2_4 = 0.0;
+
+  const int64_t outer = m.rows_contiguous ? tile_rows : tile_cols;
+  const int64_t inner = m.rows_contiguous ? tile_cols : tile_rows;
+  const size_t stripe_size = kTile * (m.rows_contiguous ? m.cols : m.rows);
+  std::vector<float> buffer(stripe_size);
+  for (int64_t a = 0; a < outer; ++a) {
+    const size_t first = a * stripe_size;
+    const float *stripe = initializers.read(
+        index, first, std::min(stripe_size, m.size() - first), buffer.data());
+    for (int64_t b = 0; b < inner; ++b) {
+      const int64_t tr = m.rows_contiguous ? a : b;
+      const int64_t tc = m.rows_contiguous ? b : a;
+      const int64_t r0 = tr * kTile;
+      const int64_t c0 = tc * kTile;
+      const int64_t nr = std::min<int64_t>(kTile, m.rows - r0);
+      const int64_t nc = std::min<int64_t>(kTile, m.cols - c0);
+      double energy = 0.0;
+      for (int64_t i = 0; i < nr; ++i) {
+        double squares[kTile];
+        int group_zeros = 0;
+        for (int64_t j = 0; j < nc; ++j) {
+          const float x = stripe[m.index(r0 + i, c0 + j) - first];
+          const double square = static_cast<double>(x) * x;
+          squares[j] = square;
+          group_zeros += x == 0.f;
+          energy += square;
+          const int bin = magnitude_bin(x);
+          bin_count[bin] += 1.0;
+          bin_energy[bin] += square;
+        }
+        row_energy[r0 + i] += std::accumulate(squares, squares + nc, 0.0);
+        zeros += group_zeros;
+        if (nc == kTile) {
+          ++groups;
+          conforming += group_zeros >= 2;
+          std::sort(squares, squares + kTile);
+          loss_2_4 += squares[0] + squares[1];
+        }
+      }
+      tile_energy[tr * tile_cols + tc] = energy;
+      zero_tiles += energy == 0.0;
+    }
+  }
+
+  const double total = std::accumulate(row_energy.begin(), row_energy.end(),
+                                       0.0);
+  const double count = static_cast<double>(m.size());
+  layer.zeros = zeros / count;
+  layer.groups_2_4 = groups > 0 ? static_cast<double>(conforming) / groups
+                                : 0.0;
+  layer.zero_channels = std::count(row_energy.begin(), row_energy.end(), 0.0);
+  layer.zero_blocks = static_cast<double>(zero_tiles) / tile_energy.size();
+
+  const double density_channels =
+      1.0 - static_cast<double>(layer.zero_channels) / m.rows;
+  layer.current_speedup = std::max(
+      {kernel_speedup(PRUNING_UNSTRUCTURED, 1.0 - layer.zeros),
+       kernel_speedup(PRUNING_CHANNEL, density_channels),
+       kernel_speedup(PRUNING_BLOCK, 1.0 - layer.zero_blocks)});
+  if (groups > 0 && layer.groups_2_4 >= kMin24Conformance) {
+    layer.current_speedup = std::max(layer.current_speedup,
+                                     kernel_speedup(PRUNING_2_4, 0.5));
+  }
+
+  // unstructured: the smallest magnitudes up to the target, the bin the
+  // target falls in taken in proportion
+  const double target = std::clamp(config.target, 0.f, 1.f);
+  double wanted = target * count;
+  double removed = 0.0;
+  for (int bin = 0; bin < kMagnitudeBins && wanted > 0.0; ++bin) {
+    const double taken = std::min(wanted, bin_count[bin]);
+    if (taken > 0.0) {
+      removed += bin_energy[bin] * taken / bin_count[bin];
+    }
+    wanted -= taken;
+  }
+  const auto channels = static_cast<size_t>(target * m.rows);
+  const auto tiles = static_cast<size_t>(target * tile_energy.size());
+  const double energy_loss[PRUNING_PATTERN_COUNT] = {
+      removed, groups > 0 ? loss_2_4 : total,
+      smallest_sum(row_energy, channels), smallest_sum(tile_energy, tiles)};
+  for (int p = 0; p < PRUNING_PATTERN_COUNT; ++p) {
+    layer.energy_loss[p] = total > 0.0 ? energy_loss[p] / total : 0.0;
+  }
+
+  layer.speedup[PRUNING_UNSTRUCTURED] = kernel_speedup(
+      PRUNING_UNSTRUCTURED, 1.0 - std::max(target, layer.zeros));
+  layer.speedup[PRUNING_2_4] =
+      groups > 0 ? kernel_speedup(PRUNING_2_4, 0.5) : 1.0;
+  layer.speedup[PRUNING_CHANNEL] = kernel_speedup(
+      PRUNING_CHANNEL, std::min(1.0 - static_cast<double>(channels) / m.rows,
+                                density_channels));
+  layer.speedup[PRUNING_BLOCK] = kernel_speedup(
+      PRUNING_BLOCK,
+      std::min(1.0 - static_cast<double>(tiles) / tile_energy.size(),
+               1.0 - layer.zero_blocks));
+}
+
+} // namespace
+
+const char *pruning_pattern_name(ePruningPattern pattern) {
+  switch (pattern) {
+  case PRUNING_UNSTRUCTURED:
+    return "unstructured";
+  case PRUNING_2_4:
+    return "2:4";
+  case PRUNING_CHANNEL:
+    return "channel";
+  case PRUNING_BLOCK:
+    return "4x4 block";
+  default:
+    return "none";
+  }
+}
+
+bool weight_matrix(const std::string &op_type, bool trans_b,
+                   const std::vector<int64_t> &dims, sWeightMatrix &matrix) {
+  if (std::any_of(dims.begin(), dims.end(),
+                  [](int64_t dim) { return dim <= 0; })) {
+    return false;
+  }
+  if (op_type == "Conv" && dims.size() >= 3) {
+    matrix.rows = dims[0];
+    matrix.cols = std::accumulate(dims.begin() + 1, dims.end(), int64_t(1),
+                                  std::multiplies<int64_t>());
+    matrix.rows_contiguous = true;
+    return true;
+  }
+  if ((op_type == "Gemm" || op_type == "MatMul") && dims.size() == 2) {
+    matrix.rows_contiguous = op_type == "Gemm" && trans_b;
+    matrix.rows = matrix.rows_contiguous ? dims[0] : dims[1];
+    matrix.cols = matrix.rows_contiguous ? dims[1] : dims[0];
+    return true;
+  }
+  return false;
+}
+
+size_t prune_weight(float *weight, const sWeightMatrix &m,
+                    ePruningPattern pattern, float target) {
+  const size_t size = m.size();
+  const double share = std::clamp(target, 0.f, 1.f);
+  size_t zeroed = 0;
+  auto zero = [&](size_t i) {
+    zeroed += weight[i] != 0.f;
+    weight[i] = 0.f;
+  };
+  switch (pattern) {
+  case PRUNING_UNSTRUCTURED: {
+    const auto count = static_cast<size_t>(share * size);
+    if (count == 0) {
+      break;
+    }
+    std::vector<float> magnitudes(weight, weight + size);
+    for (auto &x : magnitudes) {
+      x = std::abs(x);
+    }
+    std::nth_element(magnitudes.begin(), magnitudes.begin() + count - 1,
+                     magnitudes.end());
+    const float threshold = magnitudes[count - 1];
+    // ties at the threshold are kept once the count is reached
+    size_t left = count;
+    for (size_t i = 0; i < size && left > 0; ++i) {
+      if (std::abs(weight[i]) < threshold) {
+        zero(i);
+        --left;
+      }
+    }
+    for (size_t i = 0; i < size && left > 0; ++i) {
+      if (weight[i] != 0.f && std::abs(weight[i]) == threshold) {
+        zero(i);
+        --left;
+      }
+    }
+    break;
+  }
+  case PRUNING_2_4:
+    for (int64_t r = 0; r < m.rows; ++r) {
+      for (int64_t c = 0; c + kTile <= m.cols; c += kTile) {
+        size_t index[kTile];
+        for (int j = 0; j < kTile; ++j) {
+          index[j] = m.index(r, c + j);
+        }
+        std::sort(index, index + kTile, [&](size_t a, size_t b) {
+          return std::abs(weight[a]) < std::abs(weight[b]);
+        });
+        zero(index[0]);
+        zero(index[1]);
+      }
+    }
+    break;
+  case PRUNING_CHANNEL: {
+    std::vector<std::pair<double, int64_t>> norms(m.rows);
+    for (int64_t r = 0; r < m.rows; ++r) {
+      double energy = 0.0;
+      for (int64_t c = 0; c < m.cols; ++c) {
+        const float x = weight[m.index(r, c)];
+        energy += static_cast<double>(x) * x;
+      }
+      norms[r] = {energy, r};
+    }
+    const auto count = static_cast<size_t>(share * m.rows);
+    std::partial_sort(norms.begin(), norms.begin() + count, norms.end());
+    for (size_t k = 0; k < count; ++k) {
+      for (int64_t c = 0; c < m.cols; ++c) {
+        zero(m.index(norms[k].second, c));
+      }
+    }
+    break;
+  }
+  case PRUNING_BLOCK: {
+    const int64_t tile_rows = (m.rows + kTile - 1) / kTile;
+    const int64_t tile_cols = (m.cols + kTile - 1) / kTile;
+    std::vector<std::pair<double, int64_t>> tiles(tile_rows * tile_cols);
+    for (int64_t r = 0; r < m.rows; ++r) {
+      for (int64_t c = 0; c < m.cols; ++c) {
+        const float x = weight[m.index(r, c)];
+        auto &tile = tiles[(r / kTile) * tile_cols + c / kTile];
+        tile.first += static_cast<double>(x) * x;
+      }
+    }
+    for (size_t t = 0; t < tiles.size(); ++t) {
+      tiles[t].second = static_cast<int64_t>(t);
+    }
+    const auto count = static_cast<size_t>(share * tiles.size());
+    std::partial_sort(tiles.begin(), tiles.begin() + count, tiles.end());
+    for (size_t k = 0; k < count; ++k) {
+      const int64_t r0 = tiles[k].second / tile_cols * kTile;
+      const int64_t c0 = tiles[k].second % tile_cols * kTile;
+      for (int64_t r = r0; r < std::min(r0 + kTile, m.rows); ++r) {
+        for (int64_t c = c0; c < std::min(c0 + kTile, m.cols); ++c) {
+          zero(m.index(r, c));
+        }
+      }
+    }
+    break;
+  }
+  default:
+    break;
+  }
+  return zeroed;
+}
+
+sSparsityReport analyze_sparsity(const std::string &model_path,
+                                 const sModelGraph &graph,
+                                 const sSparsityConfig &config) {
+  const auto started = std::chrono::steady_clock::now();
+  sSparsityReport report;
+  const auto cost = estimate_cost(graph, std::max(config.batch_size, 1));
+  report.total_flops = cost.total.flops;
+
+  std::vector<sLayerSparsity> layers;
+  for (size_t n = 0; n < graph.nodes.size(); ++n) {
+    const auto &node = graph.nodes[n];
+    if (node.input_tensors.size() < 2 || node.input_tensors[1] < 0) {
+      continue;
+    }
+    const auto &tensor = graph.tensors[node.input_tensors[1]];
+    sLayerSparsity layer;
+    if (!tensor.is_initializer ||
+        !weight_matrix(node.op_type, attribute_int(node, "transB", 0) != 0,
+                       tensor.shape, layer.matrix)) {
+      continue;
+    }
+    layer.node = static_cast<int>(n);
+    layer.tensor = node.input_tensors[1];
+    layer.weight = tensor.name;
+    layer.flops = cost.nodes[n].flops;
+    layer.flop_share =
+        report.total_flops > 0.0 ? layer.flops / report.total_flops : 0.0;
+    layers.push_back(std::move(layer));
+  }
+
+  // the model mapped once; layers in parallel, each read in place unless it
+  // needs converting
+  MappedInitializers initializers(model_path);
+  if (!initializers.ok()) {
+    report.error = initializers.error();
+    return report;
+  }
+  std::unordered_map<std::string, size_t> index_of;
+  for (size_t t = 0; t < initializers.tensors().size(); ++t) {
+    index_of.emplace(initializers.tensors()[t].name, t);
+  }
+  std::vector<std::string> errors(layers.size());
+  ThreadPool::shared().parallel_for(
+      static_cast<int64_t>(layers.size()), [&](int64_t i) {
+        auto &layer = layers[i];
+        auto it = index_of.find(layer.weight);
+        if (it == index_of.end()) {
+          errors[i] = "no initializer " + layer.weight;
+          return;
+        }
+        if (initializers.tensors()[it->second].float_count !=
+            layer.matrix.size()) {
+          errors[i] = "shape mismatch";
+          return;
+        }
+        analyze_weight(initializers, it->second, config, layer);
+      });
+
+  std::array<double, PRUNING_PATTERN_COUNT> pruned_time = {};
+  double recommended_time = 0.0;
+  for (size_t i = 0; i < layers.size(); ++i) {
+    if (!errors[i].empty()) {
+      continue;
+    }
+    auto &layer = layers[i];
+    double best = config.min_model_speedup;
+    for (int p = 0; p < PRUNING_PATTERN_COUNT; ++p) {
+      layer.model_speedup[p] =
+          model_speedup(layer.flop_share, layer.speedup[p]);
+      pruned_time[p] += layer.flop_share / layer.speedup[p];
+      if (layer.energy_loss[p] <= config.max_energy_loss &&
+          layer.model_speedup[p] >= best) {
+        best = layer.model_speedup[p];
+        layer.best = static_cast<ePruningPattern>(p);
+      }
+    }
+    report.covered_flops += layer.flop_share;
+    recommended_time += layer.best < PRUNING_PATTERN_COUNT
+                            ? layer.flop_share / layer.speedup[layer.best]
+                            : layer.flop_share;
+    report.layers.push_back(std::move(layer));
+  }
+  for (int p = 0; p < PRUNING_PATTERN_COUNT; ++p) {
+    report.model_speedup[p] =
+        1.0 / (1.0 - report.covered_flops + pruned_time[p]);
+  }
+  report.recommended_speedup =
+      1.0 / (1.0 - report.covered_flops + recommended_time);
+  if (report.layers.empty() && !layers.empty()) {
+    report.error = "unable to read the weights: " + errors.front();
+    return report;
+  }
+  report.ok = true;
+  report.elapsed_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - started)
+                          .count();
+  return report;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// Sparsity patterns of weights, measured as they are and as a target for
+// magnitude pruning. Writing and benchmarking a pruned model is in
+// runtime/pruning.h.
+
+enum ePruningPattern {
+  // any weights, by magnitude
+  PRUNING_UNSTRUCTURED = 0,
+  // 2 of every 4 consecutive weights along the reduction axis, the pattern
+  // sparse tensor cores run at twice the dense rate
+  PRUNING_2_4,
+  // whole output channels, which shrink the layer to a smaller dense one
+  PRUNING_CHANNEL,
+  // 4x4 tiles of output channels by reduction steps
+  PRUNING_BLOCK,
+  PRUNING_PATTERN_COUNT,
+};
+
+const char *pruning_pattern_name(ePruningPattern pattern);
+
+// A Conv, Gemm or MatMul weight as a matrix of output channels by
+// reduction steps. Conv and transposed Gemm weights store each output
+// channel contiguously; MatMul and plain Gemm weights are [K, N] and store
+// each reduction step contiguously.
+struct sWeightMatrix {
+  int64_t rows = 0;
+  int64_t cols = 0;
+  bool rows_contiguous = true;
+
+  size_t index(int64_t row, int64_t col) const {
+    return static_cast<size_t>(rows_contiguous ? row * cols + col
+                                               : col * rows + row);
+  }
+  size_t size() const { return static_cast<size_t>(rows * cols); }
+};
+
+// the matrix view of input 1 of a node, false for other ops, shapes and
+// batched MatMul weights
+bool weight_matrix(const std::string &op_type, bool trans_b,
+                   const std::vector<int64_t> &dims, sWeightMatrix &matrix);
+
+// zeroes the weights `pattern` removes at `target` sparsity, smallest
+// magnitudes first. 2:4 always removes half. returns the zeroed count.
+size_t prune_weight(float *weight, const sWeightMatrix &matrix,
+                    ePruningPattern pattern, float target);
+
+struct sLayerSparsity {
+  int node = -1;
+  // the weight, index into sModelGraph::tensors
+  int tensor = -1;
+  std::string weight;
+  sWeightMatrix matrix;
+  double flops = 0.0;
+  // share of the model's FLOPs, taken as its share of the run time
+  double flop_share = 0.0;
+
+  // the weight as it is: zeros, 4-groups along the reduction axis with at
+  // least 2 zeros, all-zero output channels and all-zero 4x4 tiles
+  double zeros = 0.0;
+  double groups_2_4 = 0.0;
+  int64_t zero_channels = 0;
+  double zero_blocks = 0.0;
+  // layer speedup of the best sparse kernel for the weight as it is
+  double current_speedup = 1.0;
+
+  // pruning to each pattern at the target: the share of the weight's
+  // squared norm removed, a proxy for the accuracy cost, the layer speedup
+  // and the model speedup if only this layer is pruned
+  std::array<double, PRUNING_PATTERN_COUNT> energy_loss = {};
+  std::array<double, PRUNING_PATTERN_COUNT> speedup = {};
+  std::array<double, PRUNING_PATTERN_COUNT> model_speedup = {};
+  // the pattern with the largest model speedup within the loss budget,
+  // PRUNING_PATTERN_COUNT if none is worth it
+  ePruningPattern best = PRUNING_PATTERN_COUNT;
+};
+
+struct sSparsityConfig {
+  // sparsity pruned to by the unstructured, channel and block patterns
+  float target = 0.5f;
+  // largest share of a weight's squared norm a pruning may remove
+  float max_energy_loss = 0.05f;
+  // smallest model speedup that makes a layer worth pruning
+  float min_model_speedup = 1.01f;
+  // unknown dims in the FLOP estimate
+  int batch_size = 1;
+};
+
+struct sSparsityReport {
+  bool ok = false;
+  std::string error;
+  std::vector<sLayerSparsity> layers;
+  double total_flops = 0.0;
+  // share of the model's FLOPs in analyzed layers
+  double covered_flops = 0.0;
+  // the model speedup with every layer pruned to each pattern, and with
+  // the layers worth pruning pruned to their best pattern
+  std::array<double, PRUNING_PATTERN_COUNT> model_speedup = {};
+  double recommended_speedup = 1.0;
+  double elapsed_ms = 0.0;
+};
+
+// Sparsity of the float weights of every Conv, Gemm and MatMul of the
+// model at `model_path`, whose graph is `graph`, and the speedup sparse
+// kernels could get from them. Weights are read in place from the mapped
+// model, layers in parallel on the shared pool. Speedups come from the FLOP
+// model with a per-pattern cost for each nonzero a sparse kernel runs:
+// unstructured kernels lose to index loads and irregular access, tiles
+// and 2:4 much less, and pruned channels none.
+sSparsityReport analyze_sparsity(const std::string &model_path,
+                                 const sModelGraph &graph,
+                                 const sSparsityConfig &config);
@@ -0,0 +1,220 @@
+#include "tensor_stats.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MYNN_STATS_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define MYNN_STATS_NEON 1
+#endif
+
+namespace {
+
+// float lanes are flushed into double accumulators every chunk so sums over
+// very large tensors keep their precision.
+constexpr size_t kChunk = 4096;
+
+using sPartial = sTensorStatsPartial;
+
+inline bool is_finite(float x) { return x - x == 0.f; }
+
+void reduce_scalar(const float *data, size_t n, sPartial &acc) {
+  double sum = 0.0;
+  double sumsq = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    const float x = data[i];
+    if (x != x) {
+      ++acc.nan;
+      continue;
+    }
+    if (!is_finite(x)) {
+      continue;
+    }
+    acc.min = std::min(acc.min, x);
+    acc.max = std::max(acc.max, x);
+    acc.zero += x == 0.f;
+    sum += x;
+    sumsq += static_cast<double>(x) * x;
+    ++acc.finite;
+  }
+  acc.sum += sum;
+  acc.sumsq += sumsq;
+}
+
+#if defined(MYNN_STATS_SSE2)
+
+void reduce_chunk(const float *data, size_t n, sPartial &acc) {
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 lowest = _mm_set1_ps(-FLT_MAX);
+  const __m128 highest = _mm_set1_ps(FLT_MAX);
+  __m128 vmin = highest;
+  __m128 vmax = lowest;
+  __m128 vsum = zero;
+  __m128 vsq = zero;
+  __m128i vfinite = _mm_setzero_si128();
+  __m128i vnan = _mm_setzero_si128();
+  __m128i vzero = _mm_setzero_si128();
+
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m128 x = _mm_loadu_ps(data + i);
+    // x - x is 0 for finite values and NaN for NaN/Inf
+    const __m128 finite = _mm_cmpeq_ps(_mm_sub_ps(x, x), zero);
+    const __m128 xf = _mm_and_ps(finite, x);
+    vsum = _mm_add_ps(vsum, xf);
+    vsq = _mm_add_ps(vsq, _mm_mul_ps(xf, xf));
+    vmin = _mm_min_ps(vmin, _mm_or_ps(xf, _mm_andnot_ps(finite, highest)));
+    vmax = _mm_max_ps(vmax, _mm_or_ps(xf, _mm_andnot_ps(finite, lowest)));
+    // masks are all ones (-1) per true lane
+    vfinite = _mm_sub_epi32(vfinite, _mm_castps_si128(finite));
+    vnan = _mm_sub_epi32(vnan, _mm_castps_si128(_mm_cmpunord_ps(x, x)));
+    vzero = _mm_sub_epi32(vzero, _mm_castps_si128(_mm_cmpeq_ps(x, zero)));
+  }
+
+  alignas(16) float lanes_min[4], lanes_max[4], lanes_sum[4], lanes_sq[4];
+  alignas(16) int32_t lanes_finite[4], lanes_nan[4], lanes_zero[4];
+  _mm_store_ps(lanes_min, vmin);
+  _mm_store_ps(lanes_max, vmax);
+  _mm_store_ps(lanes_sum, vsum);
+  _mm_store_ps(lanes_sq, vsq);
+  _mm_store_si128(reinterpret_cast<__m128i *>(lanes_finite), vfinite);
+  _mm_store_si128(reinterpret_cast<__m128i *>(lanes_nan), vnan);
+  _mm_store_si128(reinterpret_cast<__m128i *>(lanes_zero), vzero);
+  for (int l = 0; l < 4; ++l) {
+    acc.min = std::min(acc.min, lanes_min[l]);
+    acc.max = std::max(acc.max, lanes_max[l]);
+    acc.sum += lanes_sum[l];
+    acc.sumsq += lanes_sq[l];
+    acc.finite += static_cast<size_t>(lanes_finite[l]);
+    acc.nan += static_cast<size_t>(lanes_nan[l]);
+    acc.zero += static_cast<size_t>(lanes_zero[l]);
+  }
+  reduce_scalar(data + i, n - i, acc);
+}
+
+#elif defined(MYNN_STATS_NEON)
+
+void reduce_chunk(const float *data, size_t n, sPartial &acc) {
+  const float32x4_t zero = vdupq_n_f32(0.f);
+  const float32x4_t lowest = vdupq_n_f32(-FLT_MAX);
+  const float32x4_t highest = vdupq_n_f32(FLT_MAX);
+  float32x4_t vmin = highest;
+  float32x4_t vmax = lowest;
+  float32x4_t vsum = zero;
+  float32x4_t vsq = zero;
+  uint32x4_t vfinite = vdupq_n_u32(0);
+  uint32x4_t vnan = vdupq_n_u32(0);
+  uint32x4_t vzero = vdupq_n_u32(0);
+
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const float32x4_t x = vld1q_f32(data + i);
+    const uint32x4_t finite = vceqq_f32(vsubq_f32(x, x), zero);
+    const uint32x4_t nan = vmvnq_u32(vceqq_f32(x, x));
+    const float32x4_t xf = vbslq_f32(finite, x, zero);
+    vsum = vaddq_f32(vsum, xf);
+    vsq = vfmaq_f32(vsq, xf, xf);
+    vmin = vminq_f32(vmin, vbslq_f32(finite, x, highest));
+    vmax = vmaxq_f32(vmax, vbslq_f32(finite, x, lowest));
+    vfinite = vsubq_u32(vfinite, finite);
+    vnan = vsubq_u32(vnan, nan);
+    vzero = vsubq_u32(vzero, vceqq_f32(x, zero));
+  }
+
+  acc.min = std::min(acc.min, vminvq_f32(vmin));
+  acc.max = std::max(acc.max, vmaxvq_f32(vmax));
+  acc.sum += vaddvq_f32(vsum);
+  acc.sumsq += vaddvq_f32(vsq);
+  acc.finite += vaddvq_u32(vfinite);
+  acc.nan += vaddvq_u32(vnan);
+  acc.zero += vaddvq_u32(vzero);
+  reduce_scalar(data + i, n - i, acc);
+}
+
+#else
+
+void reduce_chunk(const float *data, size_t n, sPartial &acc) {
+  reduce_scalar(data, n, acc);
+}
+
+#endif
+
+} // namespace
+
+void sTensorStatsPartial::merge(const sTensorStatsPartial &other) {
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+  sum += other.sum;
+  sumsq += other.sumsq;
+  count += other.count;
+  finite += other.finite;
+  nan += other.nan;
+  zero += other.zero;
+}
+
+void reduce_tensor_stats(const float *data, size_t count,
+                         sTensorStatsPartial &partial) {
+  partial.count += count;
+  for (size_t offset = 0; offset < count; offset += kChunk) {
+    reduce_chunk(data + offset, std::min(kChunk, count - offset), partial);
+  }
+}
+
+sTensorStats finish_tensor_stats(const sTensorStatsPartial &partial) {
+  sTensorStats stats;
+  stats.count = partial.count;
+  stats.finite_count = partial.finite;
+  stats.nan_count = partial.nan;
+  stats.inf_count = partial.count - partial.finite - partial.nan;
+  stats.zero_count = partial.zero;
+  if (partial.finite == 0) {
+    return stats;
+  }
+  const double n = static_cast<double>(partial.finite);
+  stats.min = partial.min;
+  stats.max = partial.max;
+  stats.mean = partial.sum / n;
+  stats.std =
+      std::sqrt(std::max(0.0, partial.sumsq / n - stats.mean * stats.mean));
+  return stats;
+}
+
+void add_to_histogram(const float *data, size_t count, float min, float max,
+                      std::vector<uint32_t> &histogram) {
+  const int bins = static_cast<int>(histogram.size());
+  if (bins == 0) {
+    return;
+  }
+  const float range = max - min;
+  const float scale = range > 0.f ? bins / range : 0.f;
+  for (size_t i = 0; i < count; ++i) {
+    const float x = data[i];
+    if (!is_finite(x)) {
+      continue;
+    }
+    const int bin = std::min(static_cast<int>((x - min) * scale), bins - 1);
+    ++histogram[bin];
+  }
+}
+
+sTensorStats compute_tensor_stats(const float *data, size_t count,
+                                  int histogram_bins) {
+  if (!data || count == 0) {
+    sTensorStats stats;
+    stats.count = count;
+    return stats;
+  }
+  sPartial partial;
+  reduce_tensor_stats(data, count, partial);
+  sTensorStats stats = finish_tensor_stats(partial);
+  if (stats.finite_count == 0 || histogram_bins <= 0) {
+    return stats;
+  }
+  stats.histogram.assign(static_cast<size_t>(histogram_bins), 0);
+  add_to_histogram(data, count, stats.min, stats.max, stats.histogram);
+  return stats;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Summary statistics of a float tensor. NaN and Inf values are counted
+// separately and excluded from min/max/mean/std and the histogram.
+struct sTensorStats {
+  size_t count = 0;
+  size_t finite_count = 0;
+  size_t nan_count = 0;
+  size_t inf_count = 0;
+  // exact zeros, e.g. pruned weights
+  size_t zero_count = 0;
+  float min = 0.f;
+  float max = 0.f;
+  double mean = 0.0;
+  double std = 0.0;
+  // histogram over [min, max] of the finite values
+  std::vector<uint32_t> histogram;
+};
+
+// vectorized reduction (SSE2/AVX or NEON when available) over `count` floats
+sTensorStats compute_tensor_stats(const float *data, size_t count,
+                                  int histogram_bins = 64);
+
+// Running reduction over a tensor read in pieces. Pieces reduced on
+// different threads are merged, finished into sTensorStats, and binned in
+// a second pass once min and max are known.
+struct sTensorStatsPartial {
+  float min = FLT_MAX;
+  float max = -FLT_MAX;
+  double sum = 0.0;
+  double sumsq = 0.0;
+  size_t count = 0;
+  size_t finite = 0;
+  size_t nan = 0;
+  size_t zero = 0;
+
+  void merge(const sTensorStatsPartial &other);
+};
+
+void reduce_tensor_stats(const float *data, size_t count,
+                         sTensorStatsPartial &partial);
+// everything but the histogram
+sTensorStats finish_tensor_stats(const sTensorStatsPartial &partial);
+// bins the finite values into `histogram` over [min, max]
+void add_to_histogram(const float *data, size_t count, float min, float max,
+                      std::vector<uint32_t> &histogram);
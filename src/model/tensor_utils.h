@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "types.h"
+
+// maps onnx TensorProto.DataType values
+inline eModelTensorDataType onnx_to_model_dtype(int onnx_type) {
+  switch (onnx_type) {
+  case 1:
+    return MODEL_TENSOR_DATA_TYPE_FLOAT32;
+  case 2:
+    return MODEL_TENSOR_DATA_TYPE_UINT8;
+  case 3:
+    return MODEL_TENSOR_DATA_TYPE_INT8;
+  case 4:
+    return MODEL_TENSOR_DATA_TYPE_UINT16;
+  case 5:
+    return MODEL_TENSOR_DATA_TYPE_INT16;
+  case 6:
+    return MODEL_TENSOR_DATA_TYPE_INT32;
+  case 7:
+    return MODEL_TENSOR_DATA_TYPE_INT64;
+  case 8:
+    return MODEL_TENSOR_DATA_TYPE_STRING;
+  case 9:
+    return MODEL_TENSOR_DATA_TYPE_BOOL;
+  case 10:
+    return MODEL_TENSOR_DATA_TYPE_FLOAT16;
+  case 11:
+    return MODEL_TENSOR_DATA_TYPE_DOUBLE;
+  case 12:
+    return MODEL_TENSOR_DATA_TYPE_UINT32;
+  case 13:
+    return MODEL_TENSOR_DATA_TYPE_UINT64;
+  case 16:
+    return MODEL_TENSOR_DATA_TYPE_BFLOAT16;
+  default:
+    return MODEL_TENSOR_DATA_TYPE_UNDEFINED;
+  }
+}
+
+// inverse of onnx_to_model_dtype, 0 (UNDEFINED) for unknown types
+inline int model_to_onnx_dtype(eModelTensorDataType dtype) {
+  switch (dtype) {
+  case MODEL_TENSOR_DATA_TYPE_FLOAT32:
+    return 1;
+  case MODEL_TENSOR_DATA_TYPE_UINT8:
+    return 2;
+  case MODEL_TENSOR_DATA_TYPE_INT8:
+    return 3;
+  case MODEL_TENSOR_DATA_TYPE_UINT16:
+    return 4;
+  case MODEL_TENSOR_DATA_TYPE_INT16:
+    return 5;
+  case MODEL_TENSOR_DATA_TYPE_INT32:
+    return 6;
+  case MODEL_TENSOR_DATA_TYPE_INT64:
+    return 7;
+  case MODEL_TENSOR_DATA_TYPE_STRING:
+    return 8;
+  case MODEL_TENSOR_DATA_TYPE_BOOL:
+    return 9;
+  case MODEL_TENSOR_DATA_TYPE_FLOAT16:
+    return 10;
+  case MODEL_TENSOR_DATA_TYPE_DOUBLE:
+    return 11;
+  case MODEL_TENSOR_DATA_TYPE_UINT32:
+    return 12;
+  case MODEL_TENSOR_DATA_TYPE_UINT64:
+    return 13;
+  case MODEL_TENSOR_DATA_TYPE_BFLOAT16:
+    return 16;
+  default:
+    return 0;
+  }
+}
+
+inline const char *model_dtype_name(eModelTensorDataType dtype) {
+  switch (dtype) {
+  case MODEL_TENSOR_DATA_TYPE_UINT8:
+    return "uint8";
+  case MODEL_TENSOR_DATA_TYPE_INT8:
+    return "int8";
+  case MODEL_TENSOR_DATA_TYPE_UINT16:
+    return "uint16";
+  case MODEL_TENSOR_DATA_TYPE_INT16:
+    return "int16";
+  case MODEL_TENSOR_DATA_TYPE_UINT32:
+    return "uint32";
+  case MODEL_TENSOR_DATA_TYPE_INT32:
+    return "int32";
+  case MODEL_TENSOR_DATA_TYPE_UINT64:
+    return "uint64";
+  case MODEL_TENSOR_DATA_TYPE_INT64:
+    return "int64";
+  case MODEL_TENSOR_DATA_TYPE_FLOAT16:
+    return "float16";
+  case MODEL_TENSOR_DATA_TYPE_FLOAT32:
+    return "float32";
+  case MODEL_TENSOR_DATA_TYPE_DOUBLE:
+    return "double";
+  case MODEL_TENSOR_DATA_TYPE_BFLOAT16:
+    return "bfloat16";
+  case MODEL_TENSOR_DATA_TYPE_BOOL:
+    return "bool";
+  case MODEL_TENSOR_DATA_TYPE_STRING:
+    return "string";
+  default:
+    return "?";
+  }
+}
+
+// size in bytes of one element, 0 for strings and undefined types
+inline size_t model_dtype_size(eModelTensorDataType dtype) {
+  switch (dtype) {
+  case MODEL_TENSOR_DATA_TYPE_UINT8:
+  case MODEL_TENSOR_DATA_TYPE_INT8:
+  case MODEL_TENSOR_DATA_TYPE_BOOL:
+    return 1;
+  case MODEL_TENSOR_DATA_TYPE_UINT16:
+  case MODEL_TENSOR_DATA_TYPE_INT16:
+  case MODEL_TENSOR_DATA_TYPE_FLOAT16:
+  case MODEL_TENSOR_DATA_TYPE_BFLOAT16:
+    return 2;
+  case MODEL_TENSOR_DATA_TYPE_UINT32:
+  case MODEL_TENSOR_DATA_TYPE_INT32:
+  case MODEL_TENSOR_DATA_TYPE_FLOAT32:
+    return 4;
+  case MODEL_TENSOR_DATA_TYPE_UINT64:
+  case MODEL_TENSOR_DATA_TYPE_INT64:
+  case MODEL_TENSOR_DATA_TYPE_DOUBLE:
+    return 8;
+  default:
+    return 0;
+  }
+}
+
+// element count of a tensor. unknown (-1) dims count as `unknown_dim`.
+// returns -1 if the shape itself is unknown.
+inline int64_t tensor_element_count(const sModelTensor &tensor,
+                                    int64_t unknown_dim = 1) {
+  if (tensor.shape.empty()) {
+    // scalars of known type have an empty shape too
+    return tensor.tensorDataType == MODEL_TENSOR_DATA_TYPE_UNDEFINED ? -1 : 1;
+  }
+  int64_t count = 1;
+  for (int64_t dim : tensor.shape) {
+    count *= dim < 0 ? unknown_dim : dim;
+  }
+  return count;
+}
+
+// bytes of a tensor, -1 if its shape or type is unknown. float is assumed
+// for tensors of known shape but unknown type.
+inline int64_t tensor_byte_size(const sModelTensor &tensor,
+                                int64_t unknown_dim = 1) {
+  const int64_t count = tensor_element_count(tensor, unknown_dim);
+  if (count < 0) {
+    return -1;
+  }
+  size_t element_size = model_dtype_size(tensor.tensorDataType);
+  if (element_size == 0) {
+    element_size = 4;
+  }
+  return count * static_cast<int64_t>(element_size);
+}
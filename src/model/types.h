@@ -38,6 +38,11 @@ struct sModelTensor {
   enum eModelTensorDataType tensorDataType;
   // this this tensor a constant/initializer/parmeter
   bool is_initializer;
+  // contents of small integer constants (shape operands, axes, pads, ..),
+  // used by shape inference, and of the integer tensors it computes from
+  // them and from static dims
+  bool has_values = false;
+  std::vector<int64_t> values;
 };
 
 struct sModelGraphEdge {
@@ -60,6 +65,10 @@ struct sModelGraphNode {
   std::vector<int> input_edges;
   // node outputs
   std::vector<int> output_edges;
+  // input / output tensor indices in operator argument order. -1 marks an
+  // omitted optional argument.
+  std::vector<int> input_tensors;
+  std::vector<int> output_tensors;
   // node attributes. e.g. kernel_size, stride, ..
   std::map<std::string, std::string> attributes;
 };
@@ -76,4 +85,11 @@ struct sModelGraph {
   // torch inputs
   std::vector<int> input_tensors;
   std::vector<int> output_tensors;
+
+  // names of symbolic dims. a dim of -2 - i in a tensor shape is the symbol
+  // dim_symbols[i]; -1 is an unknown dim.
+  std::vector<std::string> dim_symbols;
+
+  // version of the default onnx domain the model imports, 0 when unknown
+  int opset = 0;
 };
@@ -0,0 +1,502 @@
+#include "weight_dedup.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <onnx/onnx_pb.h>
+
+#include "../engine/thread_pool.h"
+#include "half.h"
+#include "weight_stats.h"
+#include "weights.h"
+
+namespace {
+
+// elements per conversion batch
+constexpr size_t kBatch = 4096;
+// values sampled to pick near-duplicate candidates
+constexpr size_t kSketch = 64;
+// full comparisons of near-duplicate candidates at most
+constexpr size_t kMaxNearPairs = 4096;
+
+// byte histograms of a tensor in one format, one per byte plane
+class BytePlanes {
+public:
+  explicit BytePlanes(size_t planes = 1) : _counts(planes) {}
+
+  void add(const uint8_t *data, size_t bytes) {
+    const size_t planes = _counts.size();
+    for (size_t k = 0; k < bytes; ++k) {
+      ++_counts[k % planes][data[k]];
+    }
+    _bytes += bytes;
+  }
+
+  void add_byte(uint8_t byte) {
+    ++_counts[0][byte];
+    ++_bytes;
+  }
+
+  sCompressionEstimate estimate() const {
+    sCompressionEstimate estimate;
+    estimate.bytes = static_cast<int64_t>(_bytes);
+    std::array<uint64_t, 256> all = {};
+    double shuffled_bits = 0.0;
+    for (const auto &counts : _counts) {
+      uint64_t total = 0;
+      for (int b = 0; b < 256; ++b) {
+        all[b] += counts[b];
+        total += counts[b];
+      }
+      shuffled_bits += entropy_bits(counts, total);
+    }
+    estimate.entropy_bytes =
+        static_cast<int64_t>(std::ceil(entropy_bits(all, _bytes) / 8.0));
+    estimate.shuffled_bytes =
+        static_cast<int64_t>(std::ceil(shuffled_bits / 8.0));
+    return estimate;
+  }
+
+private:
+  // total bits of an order-0 code for the counted bytes
+  static double entropy_bits(const std::array<uint64_t, 256> &counts,
+                             uint64_t total) {
+    double bits = 0.0;
+    for (uint64_t count : counts) {
+      if (count > 0) {
+        bits -= count * std::log2(static_cast<double>(count) / total);
+      }
+    }
+    return bits;
+  }
+
+  std::vector<std::array<uint64_t, 256>> _counts;
+  size_t _bytes = 0;
+};
+
+uint64_t hash_bytes(const uint8_t *data, size_t size, uint64_t hash) {
+  constexpr uint64_t kMultiplier = 0x9e3779b97f4a7c15ull;
+  size_t k = 0;
+  for (; k + 8 <= size; k += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + k, sizeof(word));
+    hash = (hash ^ word) * kMultiplier;
+    hash ^= hash >> 29;
+  }
+  uint64_t tail = 0;
+  std::memcpy(&tail, data + k, size - k);
+  hash = (hash ^ tail ^ size) * kMultiplier;
+  return hash ^ (hash >> 32);
+}
+
+size_t stored_element_size(int data_type) {
+  switch (data_type) {
+  case onnx::TensorProto_DataType_DOUBLE:
+  case onnx::TensorProto_DataType_INT64:
+  case onnx::TensorProto_DataType_UINT64:
+    return 8;
+  case onnx::TensorProto_DataType_FLOAT:
+  case onnx::TensorProto_DataType_INT32:
+  case onnx::TensorProto_DataType_UINT32:
+    return 4;
+  case onnx::TensorProto_DataType_FLOAT16:
+  case onnx::TensorProto_DataType_BFLOAT16:
+  case onnx::TensorProto_DataType_INT16:
+  case onnx::TensorProto_DataType_UINT16:
+    return 2;
+  default:
+    return 1;
+  }
+}
+
+// what one pass over an initializer learns
+struct sTensorScan {
+  // index into sModelGraph::tensors, -1 if the graph lacks it
+  int tensor = -1;
+  uint64_t hash = 0;
+  int64_t bytes = 0;
+  float max_abs = 0.f;
+  std::vector<float> sketch;
+  std::array<sCompressionEstimate, WEIGHT_FORMAT_COUNT> formats = {};
+};
+
+void scan(const MappedInitializers &initializers, size_t index,
+          sTensorScan &out) {
+  const auto &tensor = initializers.tensors()[index];
+  const size_t count = tensor.float_count;
+  float buffer[kBatch];
+
+  BytePlanes stored(tensor.raw ? stored_element_size(tensor.data_type) : 1);
+  if (tensor.data) {
+    out.hash = hash_bytes(tensor.data, tensor.bytes, tensor.data_type);
+    out.bytes = static_cast<int64_t>(tensor.bytes);
+    stored.add(tensor.data, tensor.bytes);
+  } else {
+    // float_data stored unpacked: hash and count the values instead
+    stored = BytePlanes(sizeof(float));
+    out.hash = tensor.data_type;
+    for (size_t first = 0; first < count; first += kBatch) {
+      const size_t n = std::min(kBatch, count - first);
+      const auto *bytes = reinterpret_cast<const uint8_t *>(
+          initializers.read(index, first, n, buffer));
+      out.hash = hash_bytes(bytes, n * sizeof(float), out.hash);
+      stored.add(bytes, n * sizeof(float));
+    }
+    out.bytes = static_cast<int64_t>(count * sizeof(float));
+  }
+  const auto as_stored = stored.estimate();
+  out.formats.fill(as_stored);
+  if (count == 0) {
+    return;
+  }
+
+  BytePlanes fp16(sizeof(uint16_t));
+  BytePlanes bf16(sizeof(uint16_t));
+  uint16_t halves[kBatch];
+  for (size_t first = 0; first < count; first += kBatch) {
+    const size_t n = std::min(kBatch, count - first);
+    const float *values = initializers.read(index, first, n, buffer);
+    for (size_t k = 0; k < n; ++k) {
+      // NaN fails the comparison and is skipped
+      const float magnitude = std::fabs(values[k]);
+      out.max_abs = magnitude > out.max_abs ? magnitude : out.max_abs;
+      halves[k] = float_to_half(values[k]);
+    }
+    fp16.add(reinterpret_cast<const uint8_t *>(halves), n * 2);
+    for (size_t k = 0; k < n; ++k) {
+      halves[k] = float_to_bfloat16(values[k]);
+    }
+    bf16.add(reinterpret_cast<const uint8_t *>(halves), n * 2);
+  }
+  out.formats[WEIGHT_FORMAT_FP16] = fp16.estimate();
+  out.formats[WEIGHT_FORMAT_BF16] = bf16.estimate();
+
+  // int8 codes need the range, so they take a second pass
+  BytePlanes int8;
+  const float scale = out.max_abs > 0.f ? 127.f / out.max_abs : 0.f;
+  for (size_t first = 0; first < count; first += kBatch) {
+    const size_t n = std::min(kBatch, count - first);
+    const float *values = initializers.read(index, first, n, buffer);
+    for (size_t k = 0; k < n; ++k) {
+      const float code =
+          std::clamp(std::nearbyint(values[k] * scale), -127.f, 127.f);
+      int8.add_byte(static_cast<uint8_t>(static_cast<int8_t>(
+          std::isnan(code) ? 0.f : code)));
+    }
+  }
+  out.formats[WEIGHT_FORMAT_INT8] = int8.estimate();
+  // the scale
+  out.formats[WEIGHT_FORMAT_INT8].bytes += sizeof(float);
+  out.formats[WEIGHT_FORMAT_INT8].entropy_bytes += sizeof(float);
+  out.formats[WEIGHT_FORMAT_INT8].shuffled_bytes += sizeof(float);
+
+  const size_t samples = std::min(kSketch, count);
+  out.sketch.resize(samples);
+  for (size_t s = 0; s < samples; ++s) {
+    out.sketch[s] = *initializers.read(index, s * count / samples, 1, buffer);
+  }
+}
+
+bool same_values(const MappedInitializers &initializers, size_t a,
+                 size_t b) {
+  const auto &x = initializers.tensors()[a];
+  const auto &y = initializers.tensors()[b];
+  if (x.data && y.data) {
+    return x.raw == y.raw && x.bytes == y.bytes &&
+           std::memcmp(x.data, y.data, x.bytes) == 0;
+  }
+  if (x.data || y.data || x.float_count != y.float_count) {
+    return false;
+  }
+  float buffer_a[kBatch];
+  float buffer_b[kBatch];
+  for (size_t first = 0; first < x.float_count; first += kBatch) {
+    const size_t n = std::min(kBatch, x.float_count - first);
+    if (std::memcmp(initializers.read(a, first, n, buffer_a),
+                    initializers.read(b, first, n, buffer_b),
+                    n * sizeof(float)) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// largest element difference, relative to the largest magnitude of `a`
+float relative_diff(const MappedInitializers &initializers, size_t a,
+                    size_t b, float max_abs) {
+  const size_t count = initializers.tensors()[a].float_count;
+  float buffer_a[kBatch];
+  float buffer_b[kBatch];
+  float diff = 0.f;
+  for (size_t first = 0; first < count; first += kBatch) {
+    const size_t n = std::min(kBatch, count - first);
+    const float *x = initializers.read(a, first, n, buffer_a);
+    const float *y = initializers.read(b, first, n, buffer_b);
+    for (size_t k = 0; k < n; ++k) {
+      const float d = std::fabs(x[k] - y[k]);
+      // NaN differences never pass
+      diff = d > diff || std::isnan(d) ? d : diff;
+    }
+  }
+  return max_abs > 0.f ? diff / max_abs : (diff == 0.f ? 0.f : INFINITY);
+}
+
+void rename_inputs(onnx::GraphProto &graph,
+                   const std::unordered_map<std::string, std::string> &to) {
+  for (auto &node : *graph.mutable_node()) {
+    for (auto &input : *node.mutable_input()) {
+      if (auto it = to.find(input); it != to.end()) {
+        input = it->second;
+      }
+    }
+    for (auto &attribute : *node.mutable_attribute()) {
+      if (attribute.has_g()) {
+        rename_inputs(*attribute.mutable_g(), to);
+      }
+      for (auto &body : *attribute.mutable_graphs()) {
+        rename_inputs(body, to);
+      }
+    }
+  }
+}
+
+} // namespace
+
+const char *weight_format_name(eWeightFormat format) {
+  switch (format) {
+  case WEIGHT_FORMAT_STORED:
+    return "as stored";
+  case WEIGHT_FORMAT_FP16:
+    return "fp16";
+  case WEIGHT_FORMAT_BF16:
+    return "bf16";
+  case WEIGHT_FORMAT_INT8:
+    return "int8";
+  default:
+    return "?";
+  }
+}
+
+sDedupReport analyze_weight_dedup(const std::string &model_path,
+                                  const sModelGraph &graph,
+                                  const sDedupConfig &config) {
+  const auto started = std::chrono::steady_clock::now();
+  sDedupReport report;
+  MappedInitializers initializers(model_path);
+  if (!initializers.ok()) {
+    report.error = initializers.error();
+    return report;
+  }
+  const auto &tensors = initializers.tensors();
+  report.initializers = static_cast<int>(tensors.size());
+
+  std::unordered_map<std::string, int> tensor_index;
+  for (size_t t = 0; t < graph.tensors.size(); ++t) {
+    tensor_index.emplace(graph.tensors[t].name, static_cast<int>(t));
+  }
+  std::vector<sTensorScan> scans(tensors.size());
+  ThreadPool::shared().parallel_for(
+      static_cast<int64_t>(tensors.size()), [&](int64_t i) {
+        scan(initializers, static_cast<size_t>(i), scans[i]);
+      });
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    auto it = tensor_index.find(tensors[i].name);
+    scans[i].tensor = it == tensor_index.end() ? -1 : it->second;
+    report.total_bytes += scans[i].bytes;
+    for (int f = 0; f < WEIGHT_FORMAT_COUNT; ++f) {
+      report.formats[f].bytes += scans[i].formats[f].bytes;
+      report.formats[f].entropy_bytes += scans[i].formats[f].entropy_bytes;
+      report.formats[f].shuffled_bytes += scans[i].formats[f].shuffled_bytes;
+    }
+  }
+
+  // exact: same hash, type and shape, confirmed byte by byte against the
+  // first tensor of a candidate group
+  std::map<std::tuple<uint64_t, int, std::vector<int64_t>>,
+           std::vector<std::vector<size_t>>>
+      by_hash;
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    if (scans[i].tensor < 0 || scans[i].bytes < config.min_bytes) {
+      continue;
+    }
+    auto &candidates =
+        by_hash[{scans[i].hash, tensors[i].data_type, tensors[i].dims}];
+    auto group = std::find_if(
+        candidates.begin(), candidates.end(),
+        [&](const std::vector<size_t> &members) {
+          return same_values(initializers, members[0], i);
+        });
+    if (group == candidates.end()) {
+      candidates.push_back({i});
+    } else {
+      group->push_back(i);
+    }
+  }
+  // the later copies of exact groups are settled; the first of each group
+  // and single tensors can still be near duplicates
+  std::vector<char> copy(tensors.size(), 0);
+  for (const auto &[key, candidates] : by_hash) {
+    for (const auto &members : candidates) {
+      if (members.size() < 2) {
+        continue;
+      }
+      sDuplicateGroup group;
+      group.bytes = scans[members[0]].bytes;
+      for (size_t m : members) {
+        group.tensors.push_back(scans[m].tensor);
+        copy[m] = m != members[0];
+      }
+      report.exact_reclaimable += group.reclaimable();
+      report.groups.push_back(std::move(group));
+    }
+  }
+
+  // near: same type and shape, sketches within the tolerance
+  const float tolerance = std::max(config.near_tolerance, 0.f);
+  std::map<std::pair<int, std::vector<int64_t>>, std::vector<size_t>>
+      by_shape;
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    if (scans[i].tensor >= 0 && !copy[i] && !scans[i].sketch.empty() &&
+        scans[i].bytes >= config.min_bytes) {
+      by_shape[{tensors[i].data_type, tensors[i].dims}].push_back(i);
+    }
+  }
+  struct sPair {
+    size_t a = 0;
+    size_t b = 0;
+    float diff = INFINITY;
+  };
+  std::vector<sPair> pairs;
+  for (const auto &[key, members] : by_shape) {
+    for (size_t x = 0; x < members.size(); ++x) {
+      const auto &a = scans[members[x]];
+      const float limit = tolerance * a.max_abs;
+      for (size_t y = x + 1; y < members.size(); ++y) {
+        const auto &b = scans[members[y]];
+        bool close = std::fabs(a.max_abs - b.max_abs) <= limit;
+        for (size_t s = 0; close && s < a.sketch.size(); ++s) {
+          close = std::fabs(a.sketch[s] - b.sketch[s]) <= limit;
+        }
+        if (close && pairs.size() < kMaxNearPairs) {
+          pairs.push_back({members[x], members[y]});
+        }
+      }
+    }
+  }
+  ThreadPool::shared().parallel_for(
+      static_cast<int64_t>(pairs.size()), [&](int64_t p) {
+        auto &pair = pairs[p];
+        pair.diff = relative_diff(initializers, pair.a, pair.b,
+                                  scans[pair.a].max_abs);
+      });
+  // each tensor joins the group of the first earlier tensor it is close to
+  std::vector<int> near_group(tensors.size(), -1);
+  std::vector<sDuplicateGroup> near;
+  std::sort(pairs.begin(), pairs.end(), [](const sPair &x, const sPair &y) {
+    return std::tie(x.a, x.b) < std::tie(y.a, y.b);
+  });
+  for (const auto &pair : pairs) {
+    if (!(pair.diff <= tolerance) || near_group[pair.b] >= 0 ||
+        (near_group[pair.a] >= 0 &&
+         scans[pair.a].tensor != near[near_group[pair.a]].tensors[0])) {
+      continue;
+    }
+    if (near_group[pair.a] < 0) {
+      near_group[pair.a] = static_cast<int>(near.size());
+      near.emplace_back();
+      near.back().exact = false;
+      near.back().bytes = scans[pair.a].bytes;
+      near.back().tensors.push_back(scans[pair.a].tensor);
+    }
+    auto &group = near[near_group[pair.a]];
+    group.tensors.push_back(scans[pair.b].tensor);
+    group.max_relative_diff = std::max(group.max_relative_diff, pair.diff);
+    near_group[pair.b] = near_group[pair.a];
+  }
+  for (auto &group : near) {
+    report.near_reclaimable += group.reclaimable();
+    report.groups.push_back(std::move(group));
+  }
+  std::stable_sort(report.groups.begin(), report.groups.end(),
+                   [](const sDuplicateGroup &x, const sDuplicateGroup &y) {
+                     if (x.exact != y.exact) {
+                       return x.exact;
+                     }
+                     return x.reclaimable() > y.reclaimable();
+                   });
+
+  report.ok = true;
+  report.elapsed_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - started)
+                          .count();
+  return report;
+}
+
+sShareResult share_duplicates(const std::string &model_path,
+                              const sModelGraph &graph,
+                              const std::vector<sDuplicateGroup> &groups,
+                              const std::string &output_path) {
+  sShareResult result;
+  onnx::ModelProto model;
+  if (!load_model_proto(model_path, model, result.error)) {
+    return result;
+  }
+  // graph inputs can be overridden and outputs are part of the interface
+  std::unordered_set<int> interface;
+  interface.insert(graph.input_tensors.begin(), graph.input_tensors.end());
+  interface.insert(graph.output_tensors.begin(), graph.output_tensors.end());
+  std::unordered_map<std::string, std::string> shared;
+  for (const auto &group : groups) {
+    if (group.tensors.empty() || interface.count(group.tensors[0])) {
+      continue;
+    }
+    const auto &kept = graph.tensors[group.tensors[0]].name;
+    for (size_t m = 1; m < group.tensors.size(); ++m) {
+      if (!interface.count(group.tensors[m])) {
+        shared[graph.tensors[group.tensors[m]].name] = kept;
+      }
+    }
+  }
+  if (shared.empty()) {
+    result.error = "no duplicate can be shared";
+    return result;
+  }
+
+  auto &graph_proto = *model.mutable_graph();
+  rename_inputs(graph_proto, shared);
+  google::protobuf::RepeatedPtrField<onnx::TensorProto> kept;
+  for (auto &tensor : *graph_proto.mutable_initializer()) {
+    if (shared.count(tensor.name())) {
+      ++result.removed_initializers;
+    } else {
+      kept.Add()->Swap(&tensor);
+    }
+  }
+  graph_proto.mutable_initializer()->Swap(&kept);
+
+  result.output_path = output_path;
+  if (result.output_path.empty()) {
+    result.output_path = std::filesystem::path(model_path)
+                             .replace_extension(".dedup.onnx")
+                             .string();
+  }
+  std::ofstream output(result.output_path,
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!output.is_open() || !model.SerializeToOstream(&output)) {
+    result.error = "unable to write " + result.output_path;
+    return result;
+  }
+  output.close();
+  result.bytes_before = file_size(model_path);
+  result.bytes_after = file_size(result.output_path);
+  result.ok = true;
+  return result;
+}
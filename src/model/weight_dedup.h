@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// Duplicate initializers and what the weights would take on disk in
+// smaller formats and compressed.
+
+// initializers with the same dtype, shape and values, or values within the
+// near-duplicate tolerance of the first
+struct sDuplicateGroup {
+  // indices into sModelGraph::tensors, in model order. the first is kept
+  // when the group is shared.
+  std::vector<int> tensors;
+  // one copy as stored
+  int64_t bytes = 0;
+  bool exact = true;
+  // near groups: largest difference of any copy from the first, relative
+  // to the first's largest magnitude
+  float max_relative_diff = 0.f;
+
+  int64_t reclaimable() const {
+    return bytes * static_cast<int64_t>(tensors.size() - 1);
+  }
+};
+
+enum eWeightFormat {
+  WEIGHT_FORMAT_STORED = 0,
+  WEIGHT_FORMAT_FP16,
+  WEIGHT_FORMAT_BF16,
+  // symmetric per-tensor int8 plus one float scale
+  WEIGHT_FORMAT_INT8,
+  WEIGHT_FORMAT_COUNT,
+};
+
+const char *weight_format_name(eWeightFormat format);
+
+// Size of every initializer in one format: as is, entropy coded byte by
+// byte (what deflate or zstd get on weights, which have little repetition
+// for their match finders), and entropy coded per byte plane after a byte
+// shuffle (blosc, zstd on shuffled data). The coded sizes are order-0
+// entropy bounds; real compressors land a few percent above them.
+// Initializers that are not floating point count as stored in every
+// format.
+struct sCompressionEstimate {
+  int64_t bytes = 0;
+  int64_t entropy_bytes = 0;
+  int64_t shuffled_bytes = 0;
+};
+
+struct sDedupConfig {
+  // largest element difference of a near duplicate, relative to the
+  // largest magnitude of the tensor
+  float near_tolerance = 1e-3f;
+  // tensors smaller than this are not worth sharing
+  int64_t min_bytes = 64;
+};
+
+struct sDedupReport {
+  bool ok = false;
+  std::string error;
+  int initializers = 0;
+  int64_t total_bytes = 0;
+  // exact groups first, largest reclaimable first within each kind
+  std::vector<sDuplicateGroup> groups;
+  int64_t exact_reclaimable = 0;
+  int64_t near_reclaimable = 0;
+  std::array<sCompressionEstimate, WEIGHT_FORMAT_COUNT> formats = {};
+  double elapsed_ms = 0.0;
+};
+
+// Finds duplicate initializers of the model at `model_path`, whose graph is
+// `graph`, from a content hash of each as stored, read in place from the
+// mapped model on the shared pool. Hash matches are confirmed byte by byte.
+// Near duplicates are floating point tensors of the same dtype and shape
+// whose values sampled at fixed positions agree, confirmed by a full
+// comparison. The compression estimates come from byte histograms taken
+// in the same passes.
+sDedupReport analyze_weight_dedup(const std::string &model_path,
+                                  const sModelGraph &graph,
+                                  const sDedupConfig &config);
+
+struct sShareResult {
+  bool ok = false;
+  std::string error;
+  std::string output_path;
+  int removed_initializers = 0;
+  int64_t bytes_before = 0;
+  int64_t bytes_after = 0;
+};
+
+// Writes the model with the consumers of every copy in `groups` reading
+// the group's first tensor instead, and the copies removed. Copies that
+// are graph inputs or outputs stay. `output_path` empty writes
+// <model>.dedup.onnx next to the model.
+sShareResult share_duplicates(const std::string &model_path,
+                              const sModelGraph &graph,
+                              const std::vector<sDuplicateGroup> &groups,
+                              const std::string &output_path);
@@ -0,0 +1,712 @@
+#include "weight_stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "../engine/thread_pool.h"
+#include "graph_utils.h"
+#include "half.h"
+#include "mapped_file.h"
+#include "tensor_utils.h"
+
+namespace {
+
+// elements per parallel piece, and per conversion batch within a piece
+constexpr size_t kPiece = size_t(1) << 18;
+constexpr size_t kBatch = 4096;
+
+// onnx TensorProto.DataType values read here
+constexpr int kFloat = 1;
+constexpr int kFloat16 = 10;
+constexpr int kDouble = 11;
+constexpr int kBfloat16 = 16;
+
+// protobuf wire format: just enough of it to find initializers in a
+// mapped model without copying their data
+class WireReader {
+public:
+  WireReader(const uint8_t *data, size_t size)
+      : _pos(data), _end(data + size) {}
+
+  bool done() const { return _pos >= _end || _failed; }
+  bool failed() const { return _failed; }
+
+  // next field, false at the end of the message
+  bool next(uint32_t &field, uint32_t &wire_type) {
+    if (done()) {
+      return false;
+    }
+    const uint64_t key = varint();
+    field = static_cast<uint32_t>(key >> 3);
+    wire_type = static_cast<uint32_t>(key & 7);
+    return !_failed;
+  }
+
+  uint64_t varint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64 && _pos < _end; shift += 7) {
+      const uint8_t byte = *_pos++;
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        return value;
+      }
+    }
+    _failed = true;
+    return 0;
+  }
+
+  // payload of a length-delimited field
+  bool bytes(const uint8_t *&data, size_t &size) {
+    const uint64_t length = varint();
+    if (_failed || length > static_cast<uint64_t>(_end - _pos)) {
+      _failed = true;
+      return false;
+    }
+    data = _pos;
+    size = static_cast<size_t>(length);
+    _pos += length;
+    return true;
+  }
+
+  std::string string() {
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    return bytes(data, size)
+               ? std::string(reinterpret_cast<const char *>(data), size)
+               : std::string();
+  }
+
+  uint32_t fixed32() {
+    uint32_t value = 0;
+    if (_end - _pos < 4) {
+      _failed = true;
+      return 0;
+    }
+    std::memcpy(&value, _pos, 4);
+    _pos += 4;
+    return value;
+  }
+
+  void skip(uint32_t wire_type) {
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    switch (wire_type) {
+    case 0:
+      varint();
+      break;
+    case 1:
+      _pos = _end - _pos < 8 ? (_failed = true, _end) : _pos + 8;
+      break;
+    case 2:
+      bytes(data, size);
+      break;
+    case 5:
+      fixed32();
+      break;
+    default:
+      _failed = true;
+      break;
+    }
+  }
+
+private:
+  const uint8_t *_pos;
+  const uint8_t *_end;
+  bool _failed = false;
+};
+
+// where the values of one initializer live
+struct sInitializerData {
+  std::string name;
+  int data_type = 0;
+  std::vector<int64_t> dims;
+  // raw little-endian values in the mapping, raw_data or packed typed data
+  const uint8_t *data = nullptr;
+  size_t bytes = 0;
+  // typed fields that are not stored raw (varint halves, unpacked floats)
+  // are decoded up front
+  std::vector<float> decoded;
+  // packed int32_data or int64_data varints, as stored
+  const uint8_t *packed = nullptr;
+  size_t packed_bytes = 0;
+  bool external = false;
+  std::string location;
+  int64_t offset = 0;
+  int64_t length = -1;
+};
+
+void read_tensor(const uint8_t *data, size_t size, sInitializerData &tensor) {
+  WireReader reader(data, size);
+  uint32_t field = 0;
+  uint32_t wire_type = 0;
+  while (reader.next(field, wire_type)) {
+    if (field == 1 && wire_type == 0) {
+      tensor.dims.push_back(static_cast<int64_t>(reader.varint()));
+    } else if (field == 1 && wire_type == 2) {
+      const uint8_t *packed = nullptr;
+      size_t packed_size = 0;
+      if (reader.bytes(packed, packed_size)) {
+        WireReader dims(packed, packed_size);
+        while (!dims.done()) {
+          tensor.dims.push_back(static_cast<int64_t>(dims.varint()));
+        }
+      }
+    } else if (field == 2 && wire_type == 0) {
+      tensor.data_type = static_cast<int>(reader.varint());
+    } else if ((field == 9 || field == 4 || field == 10) && wire_type == 2) {
+      // raw_data, packed float_data, packed double_data
+      reader.bytes(tensor.data, tensor.bytes);
+    } else if (field == 4 && wire_type == 5) {
+      float value;
+      const uint32_t bits = reader.fixed32();
+      std::memcpy(&value, &bits, sizeof(value));
+      tensor.decoded.push_back(value);
+    } else if (field == 5 && wire_type == 2) {
+      // int32_data: halves widened to varints
+      const uint8_t *packed = nullptr;
+      size_t packed_size = 0;
+      if (reader.bytes(packed, packed_size)) {
+        tensor.packed = packed;
+        tensor.packed_bytes = packed_size;
+        WireReader halves(packed, packed_size);
+        while (!halves.done()) {
+          const auto bits = static_cast<uint16_t>(halves.varint());
+          tensor.decoded.push_back(tensor.data_type == kBfloat16
+                                       ? bfloat16_to_float(bits)
+                                       : half_to_float(bits));
+        }
+      }
+    } else if (field == 7 && wire_type == 2) {
+      reader.bytes(tensor.packed, tensor.packed_bytes);
+    } else if (field == 8 && wire_type == 2) {
+      tensor.name = reader.string();
+    } else if (field == 13 && wire_type == 2) {
+      const uint8_t *entry = nullptr;
+      size_t entry_size = 0;
+      if (!reader.bytes(entry, entry_size)) {
+        break;
+      }
+      WireReader pair(entry, entry_size);
+      std::string key;
+      std::string value;
+      uint32_t pair_field = 0;
+      uint32_t pair_wire = 0;
+      while (pair.next(pair_field, pair_wire)) {
+        if (pair_field == 1 && pair_wire == 2) {
+          key = pair.string();
+        } else if (pair_field == 2 && pair_wire == 2) {
+          value = pair.string();
+        } else {
+          pair.skip(pair_wire);
+        }
+      }
+      if (key == "location") {
+        tensor.location = value;
+      } else if (key == "offset") {
+        tensor.offset = std::atoll(value.c_str());
+      } else if (key == "length") {
+        tensor.length = std::atoll(value.c_str());
+      }
+    } else if (field == 14 && wire_type == 0) {
+      tensor.external = reader.varint() == 1;
+    } else {
+      reader.skip(wire_type);
+    }
+  }
+}
+
+// ModelProto.graph (7) -> GraphProto.initializer (5)
+bool find_initializers(const MappedFile &file,
+                       std::vector<sInitializerData> &initializers) {
+  WireReader model(file.data(), file.size());
+  uint32_t field = 0;
+  uint32_t wire_type = 0;
+  while (model.next(field, wire_type)) {
+    if (field != 7 || wire_type != 2) {
+      model.skip(wire_type);
+      continue;
+    }
+    const uint8_t *graph_data = nullptr;
+    size_t graph_size = 0;
+    if (!model.bytes(graph_data, graph_size)) {
+      break;
+    }
+    WireReader graph(graph_data, graph_size);
+    while (graph.next(field, wire_type)) {
+      if (field != 5 || wire_type != 2) {
+        graph.skip(wire_type);
+        continue;
+      }
+      const uint8_t *tensor_data = nullptr;
+      size_t tensor_size = 0;
+      if (!graph.bytes(tensor_data, tensor_size)) {
+        break;
+      }
+      initializers.emplace_back();
+      read_tensor(tensor_data, tensor_size, initializers.back());
+    }
+    if (graph.failed()) {
+      return false;
+    }
+  }
+  return !model.failed();
+}
+
+// values of an external initializer within its mapped data file
+bool external_span(const MappedFile &file, const sInitializerData &tensor,
+                   const uint8_t *&data, size_t &bytes) {
+  const auto offset = static_cast<size_t>(tensor.offset);
+  if (!file.ok() || tensor.offset < 0 || offset > file.size()) {
+    return false;
+  }
+  bytes = tensor.length < 0 ? file.size() - offset
+                            : std::min(file.size() - offset,
+                                       static_cast<size_t>(tensor.length));
+  data = file.data() + offset;
+  return true;
+}
+
+size_t element_size(int data_type) {
+  switch (data_type) {
+  case kFloat:
+    return 4;
+  case kDouble:
+    return 8;
+  case kFloat16:
+  case kBfloat16:
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+// axis the output channels of a weight run along, from its first consumer
+int channel_axis(const sModelGraph &graph,
+                 const std::vector<std::vector<int>> &consumers, int tensor,
+                 size_t rank) {
+  if (rank < 2) {
+    return -1;
+  }
+  for (int n : consumers[tensor]) {
+    const auto &node = graph.nodes[n];
+    if (node.input_tensors.size() < 2 || node.input_tensors[1] != tensor) {
+      continue;
+    }
+    if (node.op_type == "MatMul") {
+      return static_cast<int>(rank) - 1;
+    }
+    if (node.op_type == "Gemm") {
+      return attribute_int(node, "transB", 0) != 0 ? 0 : 1;
+    }
+    if (node.op_type == "ConvTranspose") {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// one weight being reduced: its values and channel layout
+struct sWeightJob {
+  const sInitializerData *source = nullptr;
+  const uint8_t *data = nullptr;
+  size_t count = 0;
+  // elements per channel run, and channels
+  int64_t inner = 1;
+  int64_t channels = 0;
+  size_t first_piece = 0;
+  std::mutex channel_mutex;
+};
+
+// floats [first, first + count) of raw values of `data_type` starting at
+// `data`, converted into `buffer` unless they can be read in place
+const float *values(int data_type, const uint8_t *data, size_t first,
+                    size_t count, float *buffer) {
+  switch (data_type) {
+  case kFloat: {
+    const uint8_t *begin = data + first * sizeof(float);
+    if (reinterpret_cast<uintptr_t>(begin) % alignof(float) == 0) {
+      return reinterpret_cast<const float *>(begin);
+    }
+    std::memcpy(buffer, begin, count * sizeof(float));
+    return buffer;
+  }
+  case kDouble:
+    for (size_t i = 0; i < count; ++i) {
+      double value;
+      std::memcpy(&value, data + (first + i) * sizeof(double),
+                  sizeof(value));
+      buffer[i] = static_cast<float>(value);
+    }
+    return buffer;
+  default:
+    for (size_t i = 0; i < count; ++i) {
+      uint16_t bits;
+      std::memcpy(&bits, data + (first + i) * sizeof(uint16_t),
+                  sizeof(bits));
+      buffer[i] = data_type == kBfloat16 ? bfloat16_to_float(bits)
+                                         : half_to_float(bits);
+    }
+    return buffer;
+  }
+}
+
+const float *values(const sWeightJob &job, size_t first, size_t count,
+                    float *buffer) {
+  const auto &decoded = job.source->decoded;
+  return decoded.empty()
+             ? values(job.source->data_type, job.data, first, count, buffer)
+             : decoded.data() + first;
+}
+
+// min/max of every channel run in [first, first + count), into `ranges`
+// indexed from the channel of `first`
+void reduce_channels(const float *data, size_t count, size_t first,
+                     const sWeightJob &job, size_t &run,
+                     std::vector<sChannelRange> &ranges) {
+  const size_t inner = static_cast<size_t>(job.inner);
+  size_t left = inner - first % inner;
+  for (size_t j = 0; j < count;) {
+    const size_t length = std::min(left, count - j);
+    float lo = ranges[run].min;
+    float hi = ranges[run].max;
+    for (size_t k = j; k < j + length; ++k) {
+      // NaN fails both comparisons and is skipped
+      lo = data[k] < lo ? data[k] : lo;
+      hi = data[k] > hi ? data[k] : hi;
+    }
+    ranges[run] = {lo, hi};
+    j += length;
+    left -= length;
+    if (left == 0) {
+      left = inner;
+      if (++run == ranges.size()) {
+        run = 0;
+      }
+    }
+  }
+}
+
+} // namespace
+
+double sWeightStats::channel_spread() const {
+  float smallest = 0.f;
+  float largest = 0.f;
+  bool any = false;
+  for (const auto &range : channels) {
+    // channels without a finite value keep min > max
+    if (range.min > range.max) {
+      continue;
+    }
+    const float magnitude =
+        std::max(std::fabs(range.min), std::fabs(range.max));
+    smallest = any ? std::min(smallest, magnitude) : magnitude;
+    largest = any ? std::max(largest, magnitude) : magnitude;
+    any = true;
+  }
+  if (!any) {
+    return 0.0;
+  }
+  return smallest > 0.f ? static_cast<double>(largest) / smallest : INFINITY;
+}
+
+sWeightStatsReport compute_weight_stats(const std::string &model_path,
+                                        const sModelGraph &graph,
+                                        int histogram_bins) {
+  const auto started = std::chrono::steady_clock::now();
+  sWeightStatsReport report;
+  MappedFile model(model_path);
+  if (!model.ok()) {
+    report.error = "unable to map model file: " + model_path;
+    return report;
+  }
+  std::vector<sInitializerData> initializers;
+  if (!find_initializers(model, initializers)) {
+    report.error = "malformed model file: " + model_path;
+    return report;
+  }
+
+  std::unordered_map<std::string, int> tensor_index;
+  for (size_t t = 0; t < graph.tensors.size(); ++t) {
+    tensor_index.emplace(graph.tensors[t].name, static_cast<int>(t));
+  }
+  const auto consumers = tensor_consumers(graph);
+  const auto model_dir = std::filesystem::path(model_path).parent_path();
+  std::map<std::string, MappedFile> external_files;
+
+  // one job per floating point initializer, cut into pieces
+  std::vector<std::unique_ptr<sWeightJob>> jobs;
+  size_t pieces = 0;
+  report.of_tensor.assign(graph.tensors.size(), -1);
+  for (const auto &initializer : initializers) {
+    const size_t size = element_size(initializer.data_type);
+    auto it = tensor_index.find(initializer.name);
+    if (size == 0 || it == tensor_index.end()) {
+      ++report.skipped;
+      continue;
+    }
+    auto job = std::make_unique<sWeightJob>();
+    job->source = &initializer;
+    job->data = initializer.data;
+    size_t bytes = initializer.bytes;
+    if (initializer.external) {
+      auto &file = external_files[initializer.location];
+      if (!file.ok()) {
+        file = MappedFile((model_dir / initializer.location).string());
+        file.advise_sequential();
+      }
+      if (!external_span(file, initializer, job->data, bytes)) {
+        report.error = "unable to map external data: " + initializer.location;
+        return report;
+      }
+    }
+    job->count = initializer.decoded.empty() ? bytes / size
+                                             : initializer.decoded.size();
+    if (job->count == 0) {
+      ++report.skipped;
+      continue;
+    }
+
+    sWeightStats weight;
+    weight.tensor = it->second;
+    weight.name = initializer.name;
+    weight.dtype = onnx_to_model_dtype(initializer.data_type);
+    weight.shape = initializer.dims;
+    weight.channel_axis = channel_axis(graph, consumers, it->second,
+                                       initializer.dims.size());
+    int64_t elements = 1;
+    for (int64_t dim : initializer.dims) {
+      elements *= dim;
+    }
+    if (weight.channel_axis >= 0 &&
+        elements == static_cast<int64_t>(job->count) &&
+        initializer.dims[weight.channel_axis] > 0) {
+      job->channels = initializer.dims[weight.channel_axis];
+      for (size_t d = weight.channel_axis + 1; d < initializer.dims.size();
+           ++d) {
+        job->inner *= initializer.dims[d];
+      }
+      weight.channels.assign(job->channels, {FLT_MAX, -FLT_MAX});
+    } else {
+      weight.channel_axis = -1;
+    }
+    report.total_bytes += static_cast<int64_t>(job->count * size);
+    report.of_tensor[it->second] = static_cast<int>(report.weights.size());
+    report.weights.push_back(std::move(weight));
+    job->first_piece = pieces;
+    pieces += (job->count + kPiece - 1) / kPiece;
+    jobs.push_back(std::move(job));
+  }
+
+  // pieces in job order, for both passes
+  std::vector<std::pair<int, size_t>> piece_of(pieces);
+  for (size_t j = 0; j < jobs.size(); ++j) {
+    for (size_t first = 0; first < jobs[j]->count; first += kPiece) {
+      piece_of[jobs[j]->first_piece + first / kPiece] = {static_cast<int>(j),
+                                                         first};
+    }
+  }
+
+  // pass 1: ranges, moments, zeros and channel ranges
+  std::vector<sTensorStatsPartial> partials(pieces);
+  ThreadPool::shared().parallel_for(
+      static_cast<int64_t>(pieces), [&](int64_t p) {
+        auto &job = *jobs[piece_of[p].first];
+        auto &weight = report.weights[piece_of[p].first];
+        const size_t first = piece_of[p].second;
+        const size_t count = std::min(kPiece, job.count - first);
+        std::vector<sChannelRange> ranges;
+        size_t first_channel = 0;
+        size_t run = 0;
+        if (job.channels > 0) {
+          const size_t runs = (first + count - 1) / job.inner -
+                              first / job.inner + 1;
+          first_channel = (first / job.inner) % job.channels;
+          ranges.assign(std::min(runs, static_cast<size_t>(job.channels)),
+                        {FLT_MAX, -FLT_MAX});
+        }
+        float buffer[kBatch];
+        for (size_t offset = 0; offset < count; offset += kBatch) {
+          const size_t n = std::min(kBatch, count - offset);
+          const float *data = values(job, first + offset, n, buffer);
+          reduce_tensor_stats(data, n, partials[p]);
+          if (!ranges.empty()) {
+            reduce_channels(data, n, first + offset, job, run, ranges);
+          }
+        }
+        if (ranges.empty()) {
+          return;
+        }
+        std::lock_guard<std::mutex> lock(job.channel_mutex);
+        for (size_t r = 0; r < ranges.size(); ++r) {
+          auto &range =
+              weight.channels[(first_channel + r) % weight.channels.size()];
+          range.min = std::min(range.min, ranges[r].min);
+          range.max = std::max(range.max, ranges[r].max);
+        }
+      });
+
+  sTensorStatsPartial total;
+  for (size_t j = 0; j < jobs.size(); ++j) {
+    sTensorStatsPartial merged;
+    const size_t last = j + 1 < jobs.size() ? jobs[j + 1]->first_piece
+                                            : pieces;
+    for (size_t p = jobs[j]->first_piece; p < last; ++p) {
+      merged.merge(partials[p]);
+    }
+    total.merge(merged);
+    report.weights[j].stats = finish_tensor_stats(merged);
+  }
+  report.total = finish_tensor_stats(total);
+
+  // pass 2: histograms over each weight's range
+  if (histogram_bins > 0) {
+    std::vector<std::vector<uint32_t>> bins(pieces);
+    ThreadPool::shared().parallel_for(
+        static_cast<int64_t>(pieces), [&](int64_t p) {
+          const auto &job = *jobs[piece_of[p].first];
+          const auto &stats = report.weights[piece_of[p].first].stats;
+          if (stats.finite_count == 0) {
+            return;
+          }
+          const size_t first = piece_of[p].second;
+          const size_t count = std::min(kPiece, job.count - first);
+          bins[p].assign(histogram_bins, 0);
+          float buffer[kBatch];
+          for (size_t offset = 0; offset < count; offset += kBatch) {
+            const size_t n = std::min(kBatch, count - offset);
+            add_to_histogram(values(job, first + offset, n, buffer), n,
+                             stats.min, stats.max, bins[p]);
+          }
+        });
+    for (size_t p = 0; p < pieces; ++p) {
+      auto &histogram = report.weights[piece_of[p].first].stats.histogram;
+      if (bins[p].empty()) {
+        continue;
+      }
+      if (histogram.empty()) {
+        histogram = std::move(bins[p]);
+        continue;
+      }
+      for (int b = 0; b < histogram_bins; ++b) {
+        histogram[b] += bins[p][b];
+      }
+    }
+  }
+
+  report.ok = true;
+  report.elapsed_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - started)
+                          .count();
+  return report;
+}
+
+WeightValues::WeightValues(const std::string &model_path,
+                           const std::string &name)
+    : _model(model_path) {
+  if (!_model.ok()) {
+    _error = "unable to map model file: " + model_path;
+    return;
+  }
+  std::vector<sInitializerData> initializers;
+  if (!find_initializers(_model, initializers)) {
+    _error = "malformed model file: " + model_path;
+    return;
+  }
+  auto it = std::find_if(
+      initializers.begin(), initializers.end(),
+      [&](const sInitializerData &tensor) { return tensor.name == name; });
+  if (it == initializers.end()) {
+    _error = "no initializer named " + name;
+    return;
+  }
+  const size_t size = element_size(it->data_type);
+  if (size == 0) {
+    _error = name + " is not floating point";
+    return;
+  }
+  _data_type = it->data_type;
+  _data = it->data;
+  size_t bytes = it->bytes;
+  if (it->external) {
+    _external = MappedFile(
+        (std::filesystem::path(model_path).parent_path() / it->location)
+            .string());
+    if (!external_span(_external, *it, _data, bytes)) {
+      _error = "unable to map external data: " + it->location;
+      return;
+    }
+  }
+  _decoded = std::move(it->decoded);
+  _count = _decoded.empty() ? bytes / size : _decoded.size();
+}
+
+const float *WeightValues::read(size_t first, size_t count,
+                                float *buffer) const {
+  return _decoded.empty() ? values(_data_type, _data, first, count, buffer)
+                          : _decoded.data() + first;
+}
+
+MappedInitializers::MappedInitializers(const std::string &model_path)
+    : _model(model_path) {
+  if (!_model.ok()) {
+    _error = "unable to map model file: " + model_path;
+    return;
+  }
+  std::vector<sInitializerData> initializers;
+  if (!find_initializers(_model, initializers)) {
+    _error = "malformed model file: " + model_path;
+    return;
+  }
+  const auto model_dir = std::filesystem::path(model_path).parent_path();
+  _tensors.resize(initializers.size());
+  _decoded.resize(initializers.size());
+  for (size_t i = 0; i < initializers.size(); ++i) {
+    auto &source = initializers[i];
+    auto &tensor = _tensors[i];
+    tensor.name = source.name;
+    tensor.data_type = source.data_type;
+    tensor.dims = source.dims;
+    tensor.data = source.data;
+    tensor.bytes = source.bytes;
+    if (source.external) {
+      auto &file = _external[source.location];
+      if (!file.ok()) {
+        file = MappedFile((model_dir / source.location).string());
+      }
+      if (!external_span(file, source, tensor.data, tensor.bytes)) {
+        _error = "unable to map external data: " + source.location;
+        return;
+      }
+    } else if (!tensor.data && source.packed) {
+      tensor.data = source.packed;
+      tensor.bytes = source.packed_bytes;
+      tensor.raw = false;
+    }
+    const size_t size = element_size(source.data_type);
+    if (size == 0) {
+      continue;
+    }
+    if (source.decoded.empty()) {
+      tensor.float_count = tensor.raw ? tensor.bytes / size : 0;
+    } else {
+      _decoded[i] = std::move(source.decoded);
+      tensor.float_count = _decoded[i].size();
+    }
+  }
+}
+
+const float *MappedInitializers::read(size_t index, size_t first,
+                                      size_t count, float *buffer) const {
+  const auto &decoded = _decoded[index];
+  return decoded.empty() ? values(_tensors[index].data_type,
+                                  _tensors[index].data, first, count, buffer)
+                         : decoded.data() + first;
+}
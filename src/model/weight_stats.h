@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "tensor_stats.h"
+#include "types.h"
+
+// range of one output channel of a weight
+struct sChannelRange {
+  float min = 0.f;
+  float max = 0.f;
+};
+
+struct sWeightStats {
+  // index into sModelGraph::tensors
+  int tensor = -1;
+  std::string name;
+  eModelTensorDataType dtype = MODEL_TENSOR_DATA_TYPE_UNDEFINED;
+  std::vector<int64_t> shape;
+  sTensorStats stats;
+  // output channel axis: 0 for Conv and Gemm weights, the last for MatMul,
+  // 1 for ConvTranspose. -1 below rank 2.
+  int channel_axis = -1;
+  std::vector<sChannelRange> channels;
+
+  double sparsity() const {
+    return stats.count > 0
+               ? static_cast<double>(stats.zero_count) / stats.count
+               : 0.0;
+  }
+  // largest over smallest channel magnitude, max(|min|, |max|). channels
+  // far apart lose precision under a per-tensor quantization scale. 0
+  // without channels.
+  double channel_spread() const;
+};
+
+struct sWeightStatsReport {
+  bool ok = false;
+  std::string error;
+  std::vector<sWeightStats> weights;
+  // weights index by graph tensor index, -1 for other tensors
+  std::vector<int> of_tensor;
+  // every weight value together, without a histogram
+  sTensorStats total;
+  int64_t total_bytes = 0;
+  // initializers that are not floating point, e.g. shapes and int8 weights
+  int skipped = 0;
+  double elapsed_ms = 0.0;
+
+  const sWeightStats *find(int tensor) const {
+    return tensor >= 0 && tensor < static_cast<int>(of_tensor.size()) &&
+                   of_tensor[tensor] >= 0
+               ? &weights[of_tensor[tensor]]
+               : nullptr;
+  }
+};
+
+// Statistics of every floating point initializer of the model at
+// `model_path`, whose graph is `graph`. The model and its external data
+// files are memory mapped and the initializers read in place from the
+// protobuf encoding, never parsed into a full copy. Tensors are cut into
+// pieces reduced in parallel on the shared pool with the SIMD reductions
+// of tensor_stats, in two passes: ranges, zeros and channel ranges, then
+// the histograms.
+sWeightStatsReport compute_weight_stats(const std::string &model_path,
+                                        const sModelGraph &graph,
+                                        int histogram_bins = 64);
+
+// One floating point initializer of a model, read in place from the mapped
+// model or its external data file, e.g. to plot it without a copy.
+class WeightValues {
+public:
+  WeightValues(const std::string &model_path, const std::string &name);
+
+  bool ok() const { return _error.empty(); }
+  const std::string &error() const { return _error; }
+  size_t size() const { return _count; }
+  // values [first, first + count), converted into `buffer` unless they can
+  // be read in place. safe to call from several threads.
+  const float *read(size_t first, size_t count, float *buffer) const;
+
+private:
+  MappedFile _model;
+  MappedFile _external;
+  int _data_type = 0;
+  const uint8_t *_data = nullptr;
+  size_t _count = 0;
+  // values not stored raw, decoded up front
+  std::vector<float> _decoded;
+  std::string _error;
+};
+
+// One initializer as stored in a mapped model or its external data file.
+struct sMappedInitializer {
+  std::string name;
+  // onnx TensorProto.DataType
+  int data_type = 0;
+  std::vector<int64_t> dims;
+  // the stored values: raw little-endian, or packed varints of int32_data
+  // and int64_data when `raw` is false. null for tensors without values.
+  const uint8_t *data = nullptr;
+  size_t bytes = 0;
+  bool raw = true;
+  // elements read() can return, 0 unless floating point
+  size_t float_count = 0;
+};
+
+// Every initializer of a model located in place, in the mapped model and
+// its external data files, to scan them all without parsing the model.
+class MappedInitializers {
+public:
+  explicit MappedInitializers(const std::string &model_path);
+
+  bool ok() const { return _error.empty(); }
+  const std::string &error() const { return _error; }
+  const std::vector<sMappedInitializer> &tensors() const { return _tensors; }
+  // values [first, first + count) of floating point tensor `index`, like
+  // WeightValues::read. safe to call from several threads.
+  const float *read(size_t index, size_t first, size_t count,
+                    float *buffer) const;
+
+private:
+  MappedFile _model;
+  std::map<std::string, MappedFile> _external;
+  std::vector<sMappedInitializer> _tensors;
+  // values not stored raw, decoded up front
+  std::vector<std::vector<float>> _decoded;
+  std::string _error;
+};
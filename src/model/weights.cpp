@@ -0,0 +1,265 @@
+#include "weights.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_set>
+
+#include <onnx/onnx_pb.h>
+
+#include "half.h"
+#include "types.h"
+
+namespace {
+
+// bytes of an initializer, from raw_data or its external file
+bool tensor_bytes(const onnx::TensorProto &tensor,
+                  const std::filesystem::path &model_dir, std::string &bytes,
+                  std::string &error) {
+  if (tensor.data_location() != onnx::TensorProto_DataLocation_EXTERNAL) {
+    bytes = tensor.raw_data();
+    return true;
+  }
+  std::string location;
+  int64_t offset = 0;
+  int64_t length = -1;
+  for (const auto &entry : tensor.external_data()) {
+    if (entry.key() == "location") {
+      location = entry.value();
+    } else if (entry.key() == "offset") {
+      offset = std::stoll(entry.value());
+    } else if (entry.key() == "length") {
+      length = std::stoll(entry.value());
+    }
+  }
+  const auto path = model_dir / location;
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    error = "unable to open external data: " + path.string();
+    return false;
+  }
+  if (length < 0) {
+    file.seekg(0, std::ios::end);
+    length = static_cast<int64_t>(file.tellg()) - offset;
+  }
+  bytes.resize(static_cast<size_t>(std::max<int64_t>(length, 0)));
+  file.seekg(offset);
+  file.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  if (!file) {
+    error = "short read of external data: " + path.string();
+    return false;
+  }
+  return true;
+}
+
+template <typename T, typename Convert>
+void convert_raw(const std::string &bytes, std::vector<float> &out,
+                 Convert convert) {
+  out.resize(bytes.size() / sizeof(T));
+  for (size_t i = 0; i < out.size(); ++i) {
+    T value;
+    std::memcpy(&value, bytes.data() + i * sizeof(T), sizeof(T));
+    out[i] = convert(value);
+  }
+}
+
+// false for tensors that are not floating point
+bool tensor_to_float(const onnx::TensorProto &tensor,
+                     const std::filesystem::path &model_dir,
+                     std::vector<float> &out, std::string &error) {
+  const auto type = tensor.data_type();
+  if (type != onnx::TensorProto_DataType_FLOAT &&
+      type != onnx::TensorProto_DataType_DOUBLE &&
+      type != onnx::TensorProto_DataType_FLOAT16 &&
+      type != onnx::TensorProto_DataType_BFLOAT16) {
+    return false;
+  }
+  const bool raw = tensor.has_raw_data() ||
+                   tensor.data_location() ==
+                       onnx::TensorProto_DataLocation_EXTERNAL;
+  if (!raw) {
+    // typed fields; halfs are stored widened in int32_data
+    if (type == onnx::TensorProto_DataType_FLOAT) {
+      out.assign(tensor.float_data().begin(), tensor.float_data().end());
+    } else if (type == onnx::TensorProto_DataType_DOUBLE) {
+      out.assign(tensor.double_data().begin(), tensor.double_data().end());
+    } else {
+      out.clear();
+      for (int32_t bits : tensor.int32_data()) {
+        const auto half = static_cast<uint16_t>(bits);
+        out.push_back(type == onnx::TensorProto_DataType_FLOAT16
+                          ? half_to_float(half)
+                          : bfloat16_to_float(half));
+      }
+    }
+    return true;
+  }
+
+  std::string bytes;
+  if (!tensor_bytes(tensor, model_dir, bytes, error)) {
+    return false;
+  }
+  switch (type) {
+  case onnx::TensorProto_DataType_FLOAT:
+    out.resize(bytes.size() / sizeof(float));
+    std::memcpy(out.data(), bytes.data(), out.size() * sizeof(float));
+    break;
+  case onnx::TensorProto_DataType_DOUBLE:
+    convert_raw<double>(bytes, out,
+                        [](double v) { return static_cast<float>(v); });
+    break;
+  case onnx::TensorProto_DataType_FLOAT16:
+    convert_raw<uint16_t>(bytes, out, half_to_float);
+    break;
+  default:
+    convert_raw<uint16_t>(bytes, out, bfloat16_to_float);
+    break;
+  }
+  return true;
+}
+
+// names read anywhere inside a subgraph, outer scope tensors among them
+void subgraph_reads(const onnx::GraphProto &graph,
+                    std::unordered_set<std::string> &names) {
+  for (const auto &node : graph.node()) {
+    names.insert(node.input().begin(), node.input().end());
+    for (const auto &attribute : node.attribute()) {
+      if (attribute.has_g()) {
+        subgraph_reads(attribute.g(), names);
+      }
+      for (const auto &body : attribute.graphs()) {
+        subgraph_reads(body, names);
+      }
+    }
+  }
+}
+
+} // namespace
+
+bool load_float_weights(
+    const std::string &model_path,
+    std::unordered_map<std::string, std::vector<float>> &weights,
+    std::string &error) {
+  onnx::ModelProto model_proto;
+  {
+    std::fstream input(model_path, std::ios::in | std::ios::binary);
+    if (!input.is_open() || !model_proto.ParseFromIstream(&input)) {
+      error = "unable to read model file: " + model_path;
+      return false;
+    }
+  }
+  const auto model_dir = std::filesystem::path(model_path).parent_path();
+  const auto &graph_proto = model_proto.graph();
+
+  weights.clear();
+  for (const auto &initializer : graph_proto.initializer()) {
+    std::vector<float> values;
+    if (tensor_to_float(initializer, model_dir, values, error)) {
+      weights[initializer.name()] = std::move(values);
+    } else if (!error.empty()) {
+      return false;
+    }
+  }
+  for (const auto &node : graph_proto.node()) {
+    if (node.op_type() != "Constant" || node.output_size() == 0) {
+      continue;
+    }
+    for (const auto &attribute : node.attribute()) {
+      std::vector<float> values;
+      if (attribute.name() == "value" && attribute.has_t()) {
+        if (!tensor_to_float(attribute.t(), model_dir, values, error)) {
+          if (!error.empty()) {
+            return false;
+          }
+          continue;
+        }
+      } else if (attribute.name() == "value_float") {
+        values = {attribute.f()};
+      } else if (attribute.name() == "value_floats") {
+        values.assign(attribute.floats().begin(), attribute.floats().end());
+      } else {
+        continue;
+      }
+      weights[node.output(0)] = std::move(values);
+    }
+  }
+  return true;
+}
+
+bool load_model_proto(const std::string &model_path,
+                      onnx::ModelProto &model_proto, std::string &error) {
+  {
+    std::fstream input(model_path, std::ios::in | std::ios::binary);
+    if (!input.is_open() || !model_proto.ParseFromIstream(&input)) {
+      error = "unable to read model file: " + model_path;
+      return false;
+    }
+  }
+  const auto model_dir = std::filesystem::path(model_path).parent_path();
+  auto *graph_proto = model_proto.mutable_graph();
+  for (auto &initializer : *graph_proto->mutable_initializer()) {
+    if (initializer.data_location() !=
+        onnx::TensorProto_DataLocation_EXTERNAL) {
+      continue;
+    }
+    std::string bytes;
+    if (!tensor_bytes(initializer, model_dir, bytes, error)) {
+      return false;
+    }
+    initializer.clear_external_data();
+    initializer.set_data_location(onnx::TensorProto_DataLocation_DEFAULT);
+    initializer.set_raw_data(std::move(bytes));
+  }
+  return true;
+}
+
+int opset_version(const onnx::ModelProto &model_proto) {
+  for (const auto &opset : model_proto.opset_import()) {
+    if (opset.domain().empty() || opset.domain() == "ai.onnx") {
+      return static_cast<int>(opset.version());
+    }
+  }
+  return 0;
+}
+
+int64_t int_attribute(const onnx::NodeProto &node, const std::string &name,
+                      int64_t fallback) {
+  for (const auto &attribute : node.attribute()) {
+    if (attribute.name() == name) {
+      return attribute.i();
+    }
+  }
+  return fallback;
+}
+
+std::vector<int> subgraph_inputs(const onnx::GraphProto &graph_proto,
+                                 const sModelGraph &graph) {
+  std::unordered_set<std::string> reads;
+  for (const auto &node : graph_proto.node()) {
+    for (const auto &attribute : node.attribute()) {
+      if (attribute.has_g()) {
+        subgraph_reads(attribute.g(), reads);
+      }
+      for (const auto &body : attribute.graphs()) {
+        subgraph_reads(body, reads);
+      }
+    }
+  }
+  std::vector<int> inputs;
+  if (reads.empty()) {
+    return inputs;
+  }
+  for (size_t t = 0; t < graph.tensors.size(); ++t) {
+    if (reads.count(graph.tensors[t].name)) {
+      inputs.push_back(static_cast<int>(t));
+    }
+  }
+  return inputs;
+}
+
+int64_t file_size(const std::string &path) {
+  std::error_code ec;
+  const auto size = std::filesystem::file_size(path, ec);
+  return ec ? 0 : static_cast<int64_t>(size);
+}
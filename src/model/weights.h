@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace onnx {
+class GraphProto;
+class ModelProto;
+class NodeProto;
+}
+
+struct sModelGraph;
+
+// float copies of the floating point initializers and Constant node values
+// of a model, keyed by tensor name. half, bfloat16 and double tensors are
+// converted; external data files are resolved next to the model.
+bool load_float_weights(
+    const std::string &model_path,
+    std::unordered_map<std::string, std::vector<float>> &weights,
+    std::string &error);
+
+// parses the model and moves external initializer data into raw_data, so
+// the proto can be edited and serialized as a single file
+bool load_model_proto(const std::string &model_path,
+                      onnx::ModelProto &model_proto, std::string &error);
+
+// version of the default onnx domain the model imports, 0 when none
+int opset_version(const onnx::ModelProto &model_proto);
+
+// value of an integer attribute of a node, `fallback` when absent
+int64_t int_attribute(const onnx::NodeProto &node, const std::string &name,
+                      int64_t fallback);
+
+// tensors of `graph`, the ModelInspector graph of `graph_proto`, read
+// inside the If, Loop and Scan bodies of its nodes
+std::vector<int> subgraph_inputs(const onnx::GraphProto &graph_proto,
+                                 const sModelGraph &graph);
+
+// size of a file in bytes, 0 when it cannot be read
+int64_t file_size(const std::string &path);
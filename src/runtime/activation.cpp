@@ -0,0 +1,158 @@
+#include "activation.h"
+
+#include <fstream>
+#include <iostream>
+#include <unordered_set>
+
+#include <onnx/onnx_pb.h>
+
+#include "../model/half.h"
+#include "session.h"
+
+namespace {
+
+template <typename T>
+void convert_to_float(const void *raw, size_t count, std::vector<float> &out) {
+  const auto *values = static_cast<const T *>(raw);
+  out.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = static_cast<float>(values[i]);
+  }
+}
+
+bool value_to_float(const Ort::Value &value, std::vector<float> &out) {
+  if (!value.IsTensor()) {
+    return false;
+  }
+  const auto info = value.GetTensorTypeAndShapeInfo();
+  const size_t count = info.GetElementCount();
+  const void *raw = value.GetTensorRawData();
+  switch (info.GetElementType()) {
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT: {
+    const auto *values = static_cast<const float *>(raw);
+    out.assign(values, values + count);
+    return true;
+  }
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE:
+    convert_to_float<double>(raw, count, out);
+    return true;
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64:
+    convert_to_float<int64_t>(raw, count, out);
+    return true;
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
+    convert_to_float<int32_t>(raw, count, out);
+    return true;
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8:
+    convert_to_float<int8_t>(raw, count, out);
+    return true;
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_BOOL:
+    convert_to_float<uint8_t>(raw, count, out);
+    return true;
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16: {
+    const auto *values = static_cast<const uint16_t *>(raw);
+    out.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = half_to_float(values[i]);
+    }
+    return true;
+  }
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_BFLOAT16: {
+    const auto *values = static_cast<const uint16_t *>(raw);
+    out.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = bfloat16_to_float(values[i]);
+    }
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+} // namespace
+
+bool ActivationCapture::capture(const std::string &model_path,
+                                const std::vector<std::string> &tensor_names) {
+  _tensors.clear();
+  _error.clear();
+  if (tensor_names.empty()) {
+    return true;
+  }
+
+  onnx::ModelProto model_proto;
+  {
+    std::fstream input(model_path, std::ios::in | std::ios::binary);
+    if (!input.is_open() || !model_proto.ParseFromIstream(&input)) {
+      _error = "unable to read model file: " + model_path;
+      return false;
+    }
+  }
+
+  auto *graph_proto = model_proto.mutable_graph();
+  std::unordered_set<std::string> existing_outputs;
+  for (const auto &output : graph_proto->output()) {
+    existing_outputs.insert(output.name());
+  }
+  std::unordered_set<std::string> initializers;
+  for (const auto &initializer : graph_proto->initializer()) {
+    initializers.insert(initializer.name());
+  }
+
+  // onnxruntime infers the type of outputs that carry only a name
+  for (const auto &name : tensor_names) {
+    if (initializers.count(name) || !existing_outputs.insert(name).second) {
+      continue;
+    }
+    graph_proto->add_output()->set_name(name);
+  }
+
+  std::string serialized;
+  if (!model_proto.SerializeToString(&serialized)) {
+    _error = "failed to serialize instrumented model";
+    return false;
+  }
+
+  sSessionConfig config;
+  config.optimization_level = ORT_ENABLE_BASIC;
+  InferenceSession session(serialized.data(), serialized.size(), config);
+  if (!session.ok()) {
+    _error = session.error();
+    return false;
+  }
+  std::vector<Ort::Value> outputs;
+  if (!session.run(1, &outputs)) {
+    _error = session.error();
+    return false;
+  }
+
+  const std::unordered_set<std::string> wanted(tensor_names.begin(),
+                                               tensor_names.end());
+  const auto &names = session.output_names();
+  for (size_t i = 0; i < names.size() && i < outputs.size(); ++i) {
+    if (!wanted.count(names[i])) {
+      continue;
+    }
+    sCapturedTensor tensor;
+    tensor.name = names[i];
+    if (!value_to_float(outputs[i], tensor.data)) {
+      std::cerr << "skipping activation with unsupported type: " << names[i]
+                << std::endl;
+      continue;
+    }
+    tensor.shape = outputs[i].GetTensorTypeAndShapeInfo().GetShape();
+    tensor.stats = compute_tensor_stats(tensor.data.data(), tensor.data.size());
+    _tensors.push_back(std::move(tensor));
+  }
+  return true;
+}
+
+const sCapturedTensor *
+ActivationCapture::find(const std::string &name) const {
+  for (const auto &tensor : _tensors) {
+    if (tensor.name == name) {
+      return &tensor;
+    }
+  }
+  return nullptr;
+}
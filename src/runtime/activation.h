@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../model/tensor_stats.h"
+
+struct sCapturedTensor {
+  std::string name;
+  std::vector<int64_t> shape;
+  // values converted to float, row major
+  std::vector<float> data;
+  sTensorStats stats;
+};
+
+// Captures intermediate activations by promoting them to extra graph outputs
+// and running a single forward pass for all requested tensors.
+class ActivationCapture {
+private:
+  std::vector<sCapturedTensor> _tensors;
+  std::string _error;
+
+public:
+  bool capture(const std::string &model_path,
+               const std::vector<std::string> &tensor_names);
+  const std::vector<sCapturedTensor> &tensors() const { return _tensors; }
+  const sCapturedTensor *find(const std::string &name) const;
+  const std::string &error() const { return _error; }
+};
@@ -0,0 +1,157 @@
+#include "engine_compare.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+#include "../engine/simd.h"
+#include "session.h"
+#include "timing.h"
+
+sEngineComparison EngineComparison::run(const std::string &model_path,
+                                        const sModelGraph &graph,
+                                        const sExecutorConfig &config,
+                                        int iterations) {
+  sEngineComparison result;
+  iterations = std::max(iterations, 1);
+
+  Stopwatch watch;
+  Executor executor;
+  sExecutorConfig engine_config = config;
+  engine_config.profile = true;
+  if (!executor.prepare(model_path, graph, engine_config)) {
+    result.error = executor.error();
+    return result;
+  }
+  result.prepare_ms = watch.elapsed_ms();
+  result.simd_isa = simd_isa_name(detected_simd_isa());
+  result.arena_bytes = executor.arena_bytes();
+  result.weight_bytes = executor.weight_bytes();
+  result.packed_bytes = executor.packed_bytes();
+  result.fused_nodes = executor.fusion().fused_nodes;
+  result.fused_groups = static_cast<int>(executor.fusion().groups.size());
+
+  InferenceSession session(model_path, sSessionConfig{});
+  if (!session.ok()) {
+    result.error = session.error();
+    return result;
+  }
+  const auto &inputs = session.synthetic_inputs(config.batch_size);
+  if (inputs.empty()) {
+    result.error = session.error();
+    return result;
+  }
+
+  // feed the engine the values onnxruntime gets
+  const auto &engine_graph = executor.graph();
+  for (int t : executor.inputs()) {
+    const auto &name = engine_graph.tensors[t].name;
+    const auto &names = session.input_names();
+    auto it = std::find(names.begin(), names.end(), name);
+    if (it == names.end()) {
+      result.error = "onnxruntime has no input " + name;
+      return result;
+    }
+    const auto &value = inputs[it - names.begin()];
+    const auto info = value.GetTensorTypeAndShapeInfo();
+    if (info.GetElementType() != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT ||
+        static_cast<int64_t>(info.GetElementCount()) !=
+            executor.element_count(t)) {
+      result.error = "input " + name + " does not match the engine's";
+      return result;
+    }
+    std::memcpy(executor.data(t), value.GetTensorData<float>(),
+                info.GetElementCount() * sizeof(float));
+  }
+
+  std::vector<double> step_totals(executor.steps().size(), 0.0);
+  std::vector<double> engine_ms;
+  std::vector<double> ort_ms;
+  std::vector<Ort::Value> ort_outputs;
+  // one untimed warm-up run each
+  if (!executor.run() || !session.run(config.batch_size, &ort_outputs)) {
+    result.error = executor.ready() ? session.error() : executor.error();
+    return result;
+  }
+  for (int i = 0; i < iterations; ++i) {
+    watch.reset();
+    executor.run();
+    engine_ms.push_back(watch.elapsed_ms());
+    for (size_t s = 0; s < step_totals.size(); ++s) {
+      step_totals[s] += executor.step_ms()[s];
+    }
+    watch.reset();
+    if (!session.run(config.batch_size, &ort_outputs)) {
+      result.error = session.error();
+      return result;
+    }
+    ort_ms.push_back(watch.elapsed_ms());
+  }
+
+  const auto &output_names = session.output_names();
+  for (int t : executor.outputs()) {
+    const auto &name = engine_graph.tensors[t].name;
+    auto it = std::find(output_names.begin(), output_names.end(), name);
+    if (it == output_names.end()) {
+      continue;
+    }
+    const auto &value = ort_outputs[it - output_names.begin()];
+    const auto info = value.GetTensorTypeAndShapeInfo();
+    if (info.GetElementType() != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT ||
+        static_cast<int64_t>(info.GetElementCount()) !=
+            executor.element_count(t)) {
+      result.error = "output " + name + " differs in type or size";
+      return result;
+    }
+    const float *expected = value.GetTensorData<float>();
+    const float *actual = executor.data(t);
+    for (size_t k = 0; k < info.GetElementCount(); ++k) {
+      const float diff = std::fabs(expected[k] - actual[k]);
+      // NaN counts as a mismatch
+      result.max_abs_diff = std::isnan(diff)
+                                ? std::numeric_limits<float>::infinity()
+                                : std::max(result.max_abs_diff, diff);
+    }
+    ++result.compared_outputs;
+  }
+
+  auto mean = [](const std::vector<double> &values) {
+    return std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+  };
+  result.engine_mean_ms = mean(engine_ms);
+  result.ort_mean_ms = mean(ort_ms);
+  result.engine_p50_ms = percentile(engine_ms, 0.5);
+  result.ort_p50_ms = percentile(ort_ms, 0.5);
+
+  result.conv_layout = layout_name(engine_config.reference_kernels
+                                      ? LAYOUT_NCHW
+                                      : engine_config.conv_layout);
+  for (size_t s = 0; s < step_totals.size(); ++s) {
+    const auto &step = executor.steps()[s];
+    const auto &node = engine_graph.nodes[step.node];
+    // fused steps are named after their anchor node
+    const auto &op_type = step.fusion >= 0
+                              ? executor.fusion().groups[step.fusion].label
+                              : node.op_type;
+    std::string kernel;
+    if (step.kind == KERNEL_CONV2D) {
+      kernel = step.layout != LAYOUT_NCHW
+                   ? conv2d_layout_kernel_name(step.layout)
+                   : conv_algorithm_name(step.conv_algorithm);
+    } else if (step.kind == KERNEL_REORDER) {
+      kernel = std::string(layout_name(step.source_layout)) + " -> " +
+               layout_name(step.layout);
+    }
+    const double ms = step_totals[s] / iterations;
+    if (step.kind == KERNEL_REORDER) {
+      ++result.reorders;
+      result.reorder_ms += ms;
+    }
+    result.steps.push_back(
+        {node.name, op_type, kernel, layout_name(step.layout), ms});
+  }
+  result.ok = true;
+  return result;
+}
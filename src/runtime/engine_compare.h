@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../engine/executor.h"
+
+struct sEngineStepTime {
+  std::string node_name;
+  // member ops joined by '+' for fused steps
+  std::string op_type;
+  // convolution algorithm or reorder direction, empty for other ops
+  std::string kernel;
+  std::string layout;
+  // mean over the timed iterations
+  double ms = 0.0;
+};
+
+struct sEngineComparison {
+  bool ok = false;
+  std::string error;
+  // instruction set of the engine's vectorized kernels
+  std::string simd_isa;
+  double prepare_ms = 0.0;
+  double engine_mean_ms = 0.0;
+  double engine_p50_ms = 0.0;
+  double ort_mean_ms = 0.0;
+  double ort_p50_ms = 0.0;
+  // largest elementwise difference over all graph outputs
+  float max_abs_diff = 0.f;
+  int compared_outputs = 0;
+  int64_t arena_bytes = 0;
+  int64_t weight_bytes = 0;
+  int64_t packed_bytes = 0;
+  int fused_groups = 0;
+  int fused_nodes = 0;
+  // layout plan: the convolutions' layout and the reorders it inserted
+  std::string conv_layout;
+  int reorders = 0;
+  double reorder_ms = 0.0;
+  std::vector<sEngineStepTime> steps;
+};
+
+// Runs the native engine and onnxruntime on the same synthetic inputs,
+// checks that their outputs agree and compares their latency.
+class EngineComparison {
+public:
+  static sEngineComparison run(const std::string &model_path,
+                               const sModelGraph &graph,
+                               const sExecutorConfig &config, int iterations);
+};
@@ -0,0 +1,318 @@
+#include "extraction.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <onnx/onnx_pb.h>
+
+#include "../model/shape_inference.h"
+#include "../model/tensor_utils.h"
+#include "../model/weights.h"
+#include "session.h"
+#include "timing.h"
+
+namespace {
+
+int64_t initializer_bytes(const onnx::TensorProto &tensor) {
+  if (tensor.has_raw_data()) {
+    return static_cast<int64_t>(tensor.raw_data().size());
+  }
+  int64_t count = 1;
+  for (int64_t dim : tensor.dims()) {
+    count *= dim;
+  }
+  return count * static_cast<int64_t>(model_dtype_size(
+                     onnx_to_model_dtype(tensor.data_type())));
+}
+
+// type and shape from the graph's tensor. symbolic dims keep their name and
+// unknown dims are left open, so the session binds both at run time.
+void set_value_info(const sModelGraph &graph, const sModelTensor &tensor,
+                    onnx::ValueInfoProto *info) {
+  info->set_name(tensor.name);
+  const int elem_type = model_to_onnx_dtype(tensor.tensorDataType);
+  if (elem_type == 0) {
+    return;
+  }
+  auto *tensor_type = info->mutable_type()->mutable_tensor_type();
+  tensor_type->set_elem_type(elem_type);
+  // an empty shape is also how an unknown rank reads, so it stays open
+  if (tensor.shape.empty()) {
+    return;
+  }
+  auto *shape = tensor_type->mutable_shape();
+  for (int64_t dim : tensor.shape) {
+    auto *dim_proto = shape->add_dim();
+    if (dim >= 0) {
+      dim_proto->set_dim_value(dim);
+    } else if (dim <= -2 &&
+               -2 - dim < static_cast<int64_t>(graph.dim_symbols.size())) {
+      dim_proto->set_dim_param(graph.dim_symbols[-2 - dim]);
+    }
+  }
+}
+
+// integer contents the graph knows (shape operands computed outside the
+// region), as an initializer: synthetic values would break the region
+bool values_initializer(const sModelTensor &tensor,
+                        onnx::TensorProto &initializer) {
+  if (!tensor.has_values ||
+      (tensor.tensorDataType != MODEL_TENSOR_DATA_TYPE_INT64 &&
+       tensor.tensorDataType != MODEL_TENSOR_DATA_TYPE_INT32)) {
+    return false;
+  }
+  int64_t count = 1;
+  for (int64_t dim : tensor.shape) {
+    if (dim < 0) {
+      return false;
+    }
+    count *= dim;
+  }
+  if (count != static_cast<int64_t>(tensor.values.size())) {
+    return false;
+  }
+  initializer.set_name(tensor.name);
+  initializer.set_data_type(model_to_onnx_dtype(tensor.tensorDataType));
+  for (int64_t dim : tensor.shape) {
+    initializer.add_dims(dim);
+  }
+  for (int64_t value : tensor.values) {
+    if (tensor.tensorDataType == MODEL_TENSOR_DATA_TYPE_INT64) {
+      initializer.add_int64_data(value);
+    } else {
+      initializer.add_int32_data(static_cast<int32_t>(value));
+    }
+  }
+  return true;
+}
+
+sBoundaryTensor describe(const sModelGraph &graph, const sModelTensor &tensor) {
+  return {tensor.name, tensor.tensorDataType, shape_to_string(graph, tensor)};
+}
+
+// builds the standalone model in `sub` from the full `model`
+bool extract(const onnx::ModelProto &model, const sModelGraph &graph,
+             const std::vector<int> &nodes, onnx::ModelProto &sub,
+             sExtractionResult &result) {
+  const auto &source = model.graph();
+  if (source.node_size() != static_cast<int>(graph.nodes.size())) {
+    result.error = "the model on disk does not match the loaded graph";
+    return false;
+  }
+  std::vector<bool> selected(graph.nodes.size(), false);
+  for (int n : nodes) {
+    if (n < 0 || n >= static_cast<int>(graph.nodes.size())) {
+      continue;
+    }
+    if (source.node(n).op_type() != graph.nodes[n].op_type) {
+      result.error = "the model on disk does not match the loaded graph";
+      return false;
+    }
+    selected[n] = true;
+  }
+
+  std::unordered_map<std::string, int> tensor_index;
+  for (size_t t = 0; t < graph.tensors.size(); ++t) {
+    tensor_index.emplace(graph.tensors[t].name, static_cast<int>(t));
+  }
+  std::unordered_map<std::string, int> initializer_of;
+  for (int i = 0; i < source.initializer_size(); ++i) {
+    initializer_of.emplace(source.initializer(i).name(), i);
+  }
+  std::unordered_map<std::string, int> producer_of;
+  std::unordered_set<std::string> consumed_outside;
+  for (int n = 0; n < source.node_size(); ++n) {
+    for (const auto &output : source.node(n).output()) {
+      producer_of.emplace(output, n);
+    }
+    if (!selected[n]) {
+      for (const auto &input : source.node(n).input()) {
+        consumed_outside.insert(input);
+      }
+    }
+  }
+  for (const auto &output : source.output()) {
+    consumed_outside.insert(output.name());
+  }
+
+  // tensors produced inside the region, and Constant nodes it reads from
+  // outside, which are cheap to carry along like initializers
+  std::unordered_set<std::string> produced;
+  std::unordered_set<std::string> consumed;
+  std::vector<int> kept;
+  std::vector<bool> carried(graph.nodes.size(), false);
+  for (int n = 0; n < source.node_size(); ++n) {
+    if (!selected[n] || carried[n]) {
+      continue;
+    }
+    for (const auto &input : source.node(n).input()) {
+      auto it = producer_of.find(input);
+      if (it != producer_of.end() && !selected[it->second] &&
+          source.node(it->second).op_type() == "Constant") {
+        selected[it->second] = true;
+        carried[it->second] = true;
+        ++result.constants;
+      }
+    }
+  }
+  for (int n = 0; n < source.node_size(); ++n) {
+    if (!selected[n]) {
+      continue;
+    }
+    kept.push_back(n);
+    for (const auto &output : source.node(n).output()) {
+      produced.insert(output);
+    }
+    for (const auto &input : source.node(n).input()) {
+      consumed.insert(input);
+    }
+  }
+  result.nodes = static_cast<int>(kept.size()) - result.constants;
+  if (result.nodes == 0) {
+    result.error = "no nodes selected";
+    return false;
+  }
+
+  sub.set_ir_version(model.ir_version());
+  *sub.mutable_opset_import() = model.opset_import();
+  *sub.mutable_functions() = model.functions();
+  sub.set_producer_name("mynn");
+  auto *graph_proto = sub.mutable_graph();
+  graph_proto->set_name(source.name() + "_subgraph");
+  for (int n : kept) {
+    *graph_proto->add_node() = source.node(n);
+  }
+
+  std::unordered_set<std::string> declared;
+  for (int n : kept) {
+    for (const auto &input : source.node(n).input()) {
+      if (input.empty() || produced.count(input) ||
+          !declared.insert(input).second) {
+        continue;
+      }
+      if (auto it = initializer_of.find(input); it != initializer_of.end()) {
+        const auto &initializer = source.initializer(it->second);
+        *graph_proto->add_initializer() = initializer;
+        ++result.initializers;
+        result.initializer_bytes += initializer_bytes(initializer);
+        continue;
+      }
+      auto it = tensor_index.find(input);
+      if (it == tensor_index.end() ||
+          graph.tensors[it->second].tensorDataType ==
+              MODEL_TENSOR_DATA_TYPE_UNDEFINED) {
+        result.error = "unknown type of boundary tensor " + input;
+        return false;
+      }
+      const auto &tensor = graph.tensors[it->second];
+      onnx::TensorProto values;
+      if (values_initializer(tensor, values)) {
+        result.initializer_bytes += initializer_bytes(values);
+        *graph_proto->add_initializer() = std::move(values);
+        ++result.initializers;
+        continue;
+      }
+      set_value_info(graph, tensor, graph_proto->add_input());
+      result.inputs.push_back(describe(graph, tensor));
+    }
+  }
+  for (int n : kept) {
+    if (carried[n]) {
+      continue;
+    }
+    for (const auto &output : source.node(n).output()) {
+      if (output.empty() ||
+          (consumed.count(output) && !consumed_outside.count(output))) {
+        continue;
+      }
+      auto it = tensor_index.find(output);
+      if (it == tensor_index.end()) {
+        graph_proto->add_output()->set_name(output);
+        result.outputs.push_back({output, MODEL_TENSOR_DATA_TYPE_UNDEFINED,
+                                  "?"});
+        continue;
+      }
+      const auto &tensor = graph.tensors[it->second];
+      set_value_info(graph, tensor, graph_proto->add_output());
+      result.outputs.push_back(describe(graph, tensor));
+    }
+  }
+
+  // intermediate shapes the model declares help the session's planner
+  for (const auto &info : source.value_info()) {
+    if (produced.count(info.name()) && !consumed_outside.count(info.name())) {
+      *graph_proto->add_value_info() = info;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+sExtractionResult SubgraphExtractor::run(const std::string &model_path,
+                                         const sModelGraph &graph,
+                                         const std::vector<int> &nodes,
+                                         const sExtractionConfig &config) {
+  sExtractionResult result;
+  onnx::ModelProto sub;
+  {
+    onnx::ModelProto model;
+    if (!load_model_proto(model_path, model, result.error) ||
+        !extract(model, graph, nodes, sub, result)) {
+      return result;
+    }
+  }
+  result.output_path = config.output_path;
+  if (result.output_path.empty()) {
+    result.output_path = std::filesystem::path(model_path)
+                             .replace_extension(".subgraph.onnx")
+                             .string();
+  }
+  {
+    std::ofstream output(result.output_path,
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!output.is_open() || !sub.SerializeToOstream(&output)) {
+      result.error = "unable to write " + result.output_path;
+      return result;
+    }
+  }
+  sub.Clear();
+
+  sSessionConfig session_config;
+  session_config.intra_op_threads = config.threads;
+  Stopwatch watch;
+  InferenceSession session(result.output_path, session_config);
+  result.create_ms = watch.elapsed_ms();
+  if (!session.ok()) {
+    result.error = session.error();
+    return result;
+  }
+  const int batch_size = std::max(config.batch_size, 1);
+  std::vector<Ort::Value> outputs;
+  watch.reset();
+  if (!session.run(batch_size, &outputs)) {
+    result.error = session.error();
+    return result;
+  }
+  result.first_run_ms = watch.elapsed_ms();
+
+  std::vector<double> times;
+  for (int i = 0; i < std::max(config.iterations, 1); ++i) {
+    watch.reset();
+    if (!session.run(batch_size, &outputs)) {
+      result.error = session.error();
+      return result;
+    }
+    times.push_back(watch.elapsed_ms());
+  }
+  result.mean_ms =
+      std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+  result.p50_ms = percentile(times, 0.5);
+  result.p90_ms = percentile(times, 0.9);
+  result.ok = true;
+  return result;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../model/types.h"
+
+struct sExtractionConfig {
+  // empty for <model>.subgraph.onnx next to the model
+  std::string output_path;
+  // timed runs after one warm-up run
+  int iterations = 50;
+  // leading symbolic dim of the boundary inputs, others run as 1
+  int batch_size = 1;
+  // onnxruntime intra op threads, 0 lets onnxruntime decide
+  int threads = 0;
+};
+
+// a tensor crossing the boundary of the extracted region
+struct sBoundaryTensor {
+  std::string name;
+  eModelTensorDataType dtype = MODEL_TENSOR_DATA_TYPE_UNDEFINED;
+  // as shape_to_string() prints it
+  std::string shape;
+};
+
+struct sExtractionResult {
+  bool ok = false;
+  std::string error;
+  std::string output_path;
+  // selected nodes, and Constant nodes outside the selection it needs
+  int nodes = 0;
+  int constants = 0;
+  std::vector<sBoundaryTensor> inputs;
+  std::vector<sBoundaryTensor> outputs;
+  int initializers = 0;
+  int64_t initializer_bytes = 0;
+  double create_ms = 0.0;
+  double first_run_ms = 0.0;
+  double mean_ms = 0.0;
+  double p50_ms = 0.0;
+  double p90_ms = 0.0;
+};
+
+// Cuts a set of nodes out of a model as a standalone ONNX model and
+// benchmarks it on synthetic inputs. Tensors entering the region become
+// graph inputs typed and shaped from the graph's sModelTensor (so inferred
+// shapes of intermediate tensors apply); tensors leaving it, or not consumed
+// at all, become graph outputs. The initializers the region reads are
+// copied, and so are integer tensors whose values the graph knows, such as
+// shapes computed outside the region. `graph` must be the ModelInspector
+// graph of `model_path`, whose nodes are in the order of the model's nodes.
+class SubgraphExtractor {
+public:
+  static sExtractionResult run(const std::string &model_path,
+                               const sModelGraph &graph,
+                               const std::vector<int> &nodes,
+                               const sExtractionConfig &config);
+};
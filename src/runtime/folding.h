@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+#include "../model/constant_folding.h"
+#include "startup.h"
+
+struct sFoldingComparison {
+  bool ok = false;
+  std::string error;
+  sFoldingResult folding;
+  // opening each model here: parsing and shape inference
+  double open_ms_before = 0.0;
+  double open_ms_after = 0.0;
+  // onnxruntime startup of each model, cold
+  sStartupProfile startup_before;
+  sStartupProfile startup_after;
+  // float outputs of both models on the same synthetic inputs
+  int outputs_compared = 0;
+  float max_abs_diff = 0.f;
+};
+
+// Folds a model with fold_constants() and compares the folded model with
+// the original: time to open it here and to start an onnxruntime session,
+// and outputs on one synthetic batch, which folding must not change. an
+// output whose element type or shape changed fails the comparison.
+class ConstantFolder {
+public:
+  static sFoldingComparison run(const std::string &model_path,
+                                const sModelGraph &graph,
+                                const std::string &output_path);
+};
@@ -0,0 +1,191 @@
+#include "gemm_bench.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <tuple>
+
+#include <onnx/onnx_pb.h>
+
+#include "../engine/gemm.h"
+#include "../engine/thread_pool.h"
+#include "../model/graph_utils.h"
+#include "../model/shape_inference.h"
+#include "../model/tensor_utils.h"
+#include "session.h"
+#include "timing.h"
+
+namespace {
+
+void add_value_info(onnx::ValueInfoProto *info, const std::string &name,
+                    const std::vector<int64_t> &shape) {
+  info->set_name(name);
+  auto *tensor_type = info->mutable_type()->mutable_tensor_type();
+  tensor_type->set_elem_type(onnx::TensorProto_DataType_FLOAT);
+  for (int64_t dim : shape) {
+    tensor_type->mutable_shape()->add_dim()->set_dim_value(dim);
+  }
+}
+
+// Y = A B with B (k x n) as an initializer
+std::string matmul_model(const sGemmShape &shape,
+                         const std::vector<float> &b) {
+  onnx::ModelProto model;
+  model.set_ir_version(8);
+  model.add_opset_import()->set_version(13);
+  auto *graph = model.mutable_graph();
+  graph->set_name("gemm_bench");
+  auto *node = graph->add_node();
+  node->set_op_type("MatMul");
+  node->add_input("A");
+  node->add_input("B");
+  node->add_output("Y");
+  add_value_info(graph->add_input(), "A", {shape.m, shape.k});
+  add_value_info(graph->add_output(), "Y", {shape.m, shape.n});
+  auto *initializer = graph->add_initializer();
+  initializer->set_name("B");
+  initializer->set_data_type(onnx::TensorProto_DataType_FLOAT);
+  initializer->add_dims(shape.k);
+  initializer->add_dims(shape.n);
+  initializer->set_raw_data(std::string(
+      reinterpret_cast<const char *>(b.data()), b.size() * sizeof(float)));
+  return model.SerializeAsString();
+}
+
+template <typename Body>
+double median_ms(int iterations, Body &&body) {
+  std::vector<double> times;
+  body();
+  for (int i = 0; i < iterations; ++i) {
+    Stopwatch watch;
+    body();
+    times.push_back(watch.elapsed_ms());
+  }
+  return percentile(times, 0.5);
+}
+
+float max_diff(const float *expected, const std::vector<float> &actual) {
+  float diff = 0.f;
+  for (size_t i = 0; i < actual.size(); ++i) {
+    diff = std::max(diff, std::fabs(expected[i] - actual[i]));
+  }
+  return diff;
+}
+
+} // namespace
+
+std::vector<sGemmShape> GemmBenchmark::extract_shapes(const sModelGraph &graph,
+                                                      int batch_size) {
+  sModelGraph pinned = graph;
+  pin_input_shapes(pinned, batch_size);
+
+  std::map<std::tuple<int64_t, int64_t, int64_t>, sGemmShape> shapes;
+  for (const auto &node : pinned.nodes) {
+    if ((node.op_type != "MatMul" && node.op_type != "Gemm") ||
+        node.input_tensors.size() < 2 || node.output_tensors.empty()) {
+      continue;
+    }
+    const auto &a = pinned.tensors[node.input_tensors[0]].shape;
+    const auto &b = pinned.tensors[node.input_tensors[1]].shape;
+    const auto &y = pinned.tensors[node.output_tensors[0]].shape;
+    if (a.size() < 2 || b.size() < 2 || y.size() < 2 ||
+        std::any_of(y.begin(), y.end(), [](int64_t d) { return d < 0; })) {
+      continue;
+    }
+    const bool trans_a = attribute_int(node, "transA", 0) != 0;
+    const int64_t outputs =
+        tensor_element_count(pinned.tensors[node.output_tensors[0]]);
+    sGemmShape shape;
+    shape.n = y.back();
+    shape.k = a[trans_a ? 0 : a.size() - 1];
+    if (shape.n <= 0 || shape.k <= 0) {
+      continue;
+    }
+    // a 2D B folds the leading dims of A into the rows, otherwise every
+    // batch is a product of its own
+    shape.m = b.size() == 2 ? outputs / shape.n : y[y.size() - 2];
+    if (shape.m <= 0) {
+      continue;
+    }
+    const int products = static_cast<int>(outputs / (shape.m * shape.n));
+    auto &entry = shapes[{shape.m, shape.n, shape.k}];
+    if (entry.count == 0) {
+      entry = shape;
+      entry.node_name = node.name;
+    }
+    entry.count += products;
+  }
+
+  std::vector<sGemmShape> result;
+  for (const auto &[key, shape] : shapes) {
+    result.push_back(shape);
+  }
+  // most expensive first
+  std::sort(result.begin(), result.end(),
+            [](const sGemmShape &x, const sGemmShape &y) {
+              return x.m * x.n * x.k * x.count > y.m * y.n * y.k * y.count;
+            });
+  return result;
+}
+
+sGemmBenchResult GemmBenchmark::run(const sGemmShape &shape, int threads,
+                                    int iterations) {
+  sGemmBenchResult result;
+  result.shape = shape;
+  iterations = std::max(iterations, 1);
+
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  std::vector<float> b(static_cast<size_t>(shape.k * shape.n));
+  for (auto &value : b) {
+    value = dist(rng);
+  }
+
+  const std::string model = matmul_model(shape, b);
+  sSessionConfig config;
+  config.intra_op_threads = threads;
+  InferenceSession session(model.data(), model.size(), config);
+  if (!session.ok()) {
+    result.error = session.error();
+    return result;
+  }
+  const auto &inputs = session.synthetic_inputs(1);
+  if (inputs.empty()) {
+    result.error = session.error();
+    return result;
+  }
+  const float *a = inputs[0].GetTensorData<float>();
+
+  std::vector<Ort::Value> outputs;
+  bool ort_ok = true;
+  result.ort_ms = median_ms(iterations, [&] {
+    ort_ok = ort_ok && session.run(1, &outputs);
+  });
+  if (!ort_ok || outputs.empty()) {
+    result.error = session.error();
+    return result;
+  }
+  const float *expected = outputs[0].GetTensorData<float>();
+
+  ThreadPool pool(ThreadPool::shared(), threads);
+  std::vector<float> c(static_cast<size_t>(shape.m * shape.n));
+  sPackedMatrix packed;
+  Stopwatch watch;
+  pack_gemm_b(b.data(), shape.n, false, shape.k, shape.n, GEMM_FP32, packed);
+  result.pack_ms = watch.elapsed_ms();
+  result.packed_fp32_ms = median_ms(iterations, [&] {
+    gemm_packed(shape.m, a, shape.k, false, 1.f, packed, c.data(), shape.n,
+                false, &pool);
+  });
+  result.fp32_max_diff = max_diff(expected, c);
+
+  pack_gemm_b(b.data(), shape.n, false, shape.k, shape.n, GEMM_BF16, packed);
+  result.packed_bf16_ms = median_ms(iterations, [&] {
+    gemm_packed(shape.m, a, shape.k, false, 1.f, packed, c.data(), shape.n,
+                false, &pool);
+  });
+  result.bf16_max_diff = max_diff(expected, c);
+  result.ok = true;
+  return result;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../model/types.h"
+
+// one matrix product shape, C (m x n) = A (m x k) B (k x n)
+struct sGemmShape {
+  int64_t m = 0;
+  int64_t n = 0;
+  int64_t k = 0;
+  // nodes of the model with this shape, and the first of them
+  int count = 0;
+  std::string node_name;
+};
+
+struct sGemmBenchResult {
+  sGemmShape shape;
+  bool ok = false;
+  std::string error;
+  // median over the timed iterations
+  double packed_fp32_ms = 0.0;
+  double packed_bf16_ms = 0.0;
+  double ort_ms = 0.0;
+  // one-time cost of packing B
+  double pack_ms = 0.0;
+  // largest difference of the packed fp32 and bf16 results to onnxruntime
+  float fp32_max_diff = 0.f;
+  float bf16_max_diff = 0.f;
+
+  double gflops(double ms) const {
+    return ms > 0.0 ? 2.0 * shape.m * shape.n * shape.k / (ms * 1e6) : 0.0;
+  }
+};
+
+// Benchmarks the engine's packed GEMM against onnxruntime, whose CPU MatMul
+// runs on MLAS, for the matrix product shapes found in a model. Each shape
+// runs as a single-MatMul model with B as an initializer, so both sides
+// prepack B once and only the product is timed.
+class GemmBenchmark {
+public:
+  // distinct static shapes of the MatMul and Gemm nodes, with symbolic
+  // input dims pinned as in the executor. batched MatMuls count once per
+  // product.
+  static std::vector<sGemmShape> extract_shapes(const sModelGraph &graph,
+                                                int batch_size);
+  static sGemmBenchResult run(const sGemmShape &shape, int threads,
+                              int iterations);
+};
@@ -0,0 +1,228 @@
+#include "memory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#elif defined(__linux__)
+#include <cstdio>
+#include <unistd.h>
+#endif
+
+#include "../model/tensor_utils.h"
+#include "session.h"
+#include "timing.h"
+
+int64_t current_rss_bytes() {
+#if defined(__APPLE__)
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                reinterpret_cast<task_info_t>(&info),
+                &count) != KERN_SUCCESS) {
+    return 0;
+  }
+  return static_cast<int64_t>(info.resident_size);
+#elif defined(__linux__)
+  FILE *statm = std::fopen("/proc/self/statm", "r");
+  if (!statm) {
+    return 0;
+  }
+  long total_pages = 0;
+  long resident_pages = 0;
+  const int read = std::fscanf(statm, "%ld %ld", &total_pages,
+                               &resident_pages);
+  std::fclose(statm);
+  if (read != 2) {
+    return 0;
+  }
+  return static_cast<int64_t>(resident_pages) * sysconf(_SC_PAGESIZE);
+#else
+  return 0;
+#endif
+}
+
+namespace {
+
+// samples the process RSS on a background thread until stopped
+class RssSampler {
+private:
+  std::thread _thread;
+  std::atomic<bool> _stop{false};
+  std::mutex _mutex;
+  Stopwatch _clock;
+  int64_t _peak = 0;
+  std::vector<double> _time_ms;
+  std::vector<double> _rss_mb;
+
+public:
+  RssSampler() {
+    _thread = std::thread([this] {
+      while (!_stop) {
+        sample();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+  }
+  ~RssSampler() { stop(); }
+
+  void sample() {
+    const int64_t rss = current_rss_bytes();
+    std::lock_guard<std::mutex> lock(_mutex);
+    _peak = std::max(_peak, rss);
+    _time_ms.push_back(_clock.elapsed_ms());
+    _rss_mb.push_back(rss / (1024.0 * 1024.0));
+  }
+
+  void stop() {
+    _stop = true;
+    if (_thread.joinable()) {
+      _thread.join();
+    }
+  }
+
+  void collect(sMemoryProfile &profile) {
+    stop();
+    sample();
+    profile.peak_rss = _peak;
+    profile.rss_time_ms = std::move(_time_ms);
+    profile.rss_mb = std::move(_rss_mb);
+  }
+};
+
+int64_t stat_or_zero(const std::map<std::string, int64_t> &stats,
+                     const char *key) {
+  auto it = stats.find(key);
+  return it != stats.end() ? it->second : 0;
+}
+
+const sModelTensor *tensor_for_edge(const sModelGraph &graph, int edge_index) {
+  if (edge_index < 0 || edge_index >= static_cast<int>(graph.edges.size())) {
+    return nullptr;
+  }
+  const int tensor_index = graph.edges[edge_index].tensor_index;
+  if (tensor_index < 0 ||
+      tensor_index >= static_cast<int>(graph.tensors.size())) {
+    return nullptr;
+  }
+  return &graph.tensors[tensor_index];
+}
+
+} // namespace
+
+sMemoryBreakdown MemoryProfiler::estimate(const sModelGraph &graph,
+                                          int batch_size,
+                                          int64_t *largest_activation,
+                                          int *unsized_tensors) {
+  sMemoryBreakdown breakdown;
+  int64_t largest = 0;
+  int unsized = 0;
+  for (const auto &tensor : graph.tensors) {
+    // unknown dims are assumed to be the batch dim
+    const int64_t bytes = tensor_byte_size(tensor, batch_size);
+    if (tensor.is_initializer) {
+      breakdown.weights += std::max<int64_t>(bytes, 0);
+      continue;
+    }
+    if (bytes < 0) {
+      ++unsized;
+      continue;
+    }
+    breakdown.activations += bytes;
+    largest = std::max(largest, bytes);
+  }
+
+  // the largest scratch buffer is the im2col matrix of a spatial Conv:
+  // (C / group) * kh * kw rows by Ho * Wo columns.
+  for (const auto &node : graph.nodes) {
+    if (node.op_type != "Conv" || node.input_edges.size() < 2 ||
+        node.output_edges.empty()) {
+      continue;
+    }
+    const auto *weight = tensor_for_edge(graph, node.input_edges[1]);
+    const auto *output = tensor_for_edge(graph, node.output_edges[0]);
+    if (!weight || !output || weight->shape.size() != 4 ||
+        output->shape.size() != 4) {
+      continue;
+    }
+    const int64_t patch =
+        weight->shape[1] * weight->shape[2] * weight->shape[3];
+    if (weight->shape[2] * weight->shape[3] <= 1) {
+      // 1x1 convolutions run as a plain GEMM
+      continue;
+    }
+    // symbolic spatial dims are negative
+    const int64_t spatial = output->shape[2] > 0 && output->shape[3] > 0
+                                ? output->shape[2] * output->shape[3]
+                                : 0;
+    if (patch > 0 && spatial > 0) {
+      breakdown.workspace =
+          std::max<int64_t>(breakdown.workspace, patch * spatial * 4);
+    }
+  }
+
+  if (largest_activation) {
+    *largest_activation = largest;
+  }
+  if (unsized_tensors) {
+    *unsized_tensors = unsized;
+  }
+  return breakdown;
+}
+
+sMemoryProfile MemoryProfiler::profile(const std::string &model_path,
+                                       const sModelGraph &graph,
+                                       const sMemoryProfileConfig &config) {
+  sMemoryProfile profile;
+  profile.estimated = estimate(graph, config.batch_size,
+                               &profile.largest_activation,
+                               &profile.unsized_tensors);
+
+  sSessionConfig session_config;
+  session_config.cpu_mem_arena = config.cpu_mem_arena;
+  session_config.mem_pattern = config.mem_pattern;
+
+  RssSampler sampler;
+  profile.rss_before = current_rss_bytes();
+  InferenceSession session(model_path, session_config);
+  if (!session.ok()) {
+    profile.error = session.error();
+    return profile;
+  }
+  profile.rss_after_create = current_rss_bytes();
+
+  int64_t allocs = stat_or_zero(session.allocator_stats(), "NumAllocs");
+  for (int i = 0; i < config.iterations; ++i) {
+    if (!session.run(config.batch_size)) {
+      profile.error = session.error();
+      return profile;
+    }
+    profile.arena_stats = session.allocator_stats();
+    const int64_t now = stat_or_zero(profile.arena_stats, "NumAllocs");
+    profile.allocs_per_run.push_back(static_cast<double>(now - allocs));
+    allocs = now;
+  }
+  sampler.collect(profile);
+
+  // RSS growth while creating the session is the weights (plus prepacked
+  // copies); the arena high-water mark is the activations; whatever the runs
+  // touched outside the arena is kernel workspace.
+  profile.measured.weights =
+      std::max<int64_t>(0, profile.rss_after_create - profile.rss_before);
+  const int64_t run_growth =
+      std::max<int64_t>(0, profile.peak_rss - profile.rss_after_create);
+  if (profile.arena_stats.empty()) {
+    profile.measured.activations = run_growth;
+  } else {
+    profile.measured.activations =
+        stat_or_zero(profile.arena_stats, "MaxInUse");
+    const int64_t reserved =
+        stat_or_zero(profile.arena_stats, "TotalAllocated");
+    profile.measured.workspace = std::max<int64_t>(0, run_growth - reserved);
+  }
+  profile.ok = true;
+  return profile;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../model/types.h"
+
+// resident set size of this process in bytes, 0 if unsupported
+int64_t current_rss_bytes();
+
+struct sMemoryBreakdown {
+  int64_t weights = 0;
+  int64_t activations = 0;
+  // scratch buffers of kernels, e.g. im2col, packed GEMM panels
+  int64_t workspace = 0;
+  int64_t total() const { return weights + activations + workspace; }
+};
+
+struct sMemoryProfileConfig {
+  int iterations = 10;
+  int batch_size = 1;
+  bool cpu_mem_arena = true;
+  bool mem_pattern = true;
+};
+
+struct sMemoryProfile {
+  bool ok = false;
+  std::string error;
+  int64_t rss_before = 0;
+  int64_t rss_after_create = 0;
+  int64_t peak_rss = 0;
+  // measured during runs
+  sMemoryBreakdown measured;
+  // derived from the tensor shapes of sModelGraph, without reuse of buffers
+  sMemoryBreakdown estimated;
+  int64_t largest_activation = 0;
+  // non-initializer tensors whose size could not be derived
+  int unsized_tensors = 0;
+  // arena allocator statistics after the last run
+  std::map<std::string, int64_t> arena_stats;
+  // arena allocations made by each run
+  std::vector<double> allocs_per_run;
+  // RSS samples taken while the session was created and run
+  std::vector<double> rss_time_ms;
+  std::vector<double> rss_mb;
+};
+
+// Measures the memory footprint of inference runs and compares it against a
+// static estimate from the graph.
+class MemoryProfiler {
+public:
+  static sMemoryProfile profile(const std::string &model_path,
+                                const sModelGraph &graph,
+                                const sMemoryProfileConfig &config);
+  static sMemoryBreakdown estimate(const sModelGraph &graph, int batch_size,
+                                   int64_t *largest_activation = nullptr,
+                                   int *unsized_tensors = nullptr);
+};
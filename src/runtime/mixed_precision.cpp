@@ -0,0 +1,138 @@
+#include "mixed_precision.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "session.h"
+#include "timing.h"
+
+namespace {
+
+int64_t peak_bytes(InferenceSession &session) {
+  const auto stats = session.allocator_stats();
+  auto it = stats.find("MaxInUse");
+  return it == stats.end() ? 0 : it->second;
+}
+
+sHalfOutputAccuracy compare(const std::string &name, const float *reference,
+                            const float *values, size_t count,
+                            const sHalfCompareConfig &config) {
+  sHalfOutputAccuracy accuracy;
+  accuracy.name = name;
+  accuracy.count = static_cast<int64_t>(count);
+  double abs_sum = 0.0;
+  double dot = 0.0;
+  double reference_norm = 0.0;
+  double norm = 0.0;
+  for (size_t k = 0; k < count; ++k) {
+    const float a = reference[k];
+    const float b = values[k];
+    if (!std::isfinite(a)) {
+      continue;
+    }
+    if (!std::isfinite(b)) {
+      ++accuracy.nonfinite;
+      continue;
+    }
+    const float diff = std::fabs(a - b);
+    accuracy.max_abs_diff = std::max(accuracy.max_abs_diff, diff);
+    if (a != 0.f) {
+      accuracy.max_relative_diff =
+          std::max(accuracy.max_relative_diff, diff / std::fabs(a));
+    }
+    accuracy.mismatched += diff > config.atol + config.rtol * std::fabs(a);
+    abs_sum += diff;
+    dot += static_cast<double>(a) * b;
+    reference_norm += static_cast<double>(a) * a;
+    norm += static_cast<double>(b) * b;
+  }
+  if (count > 0) {
+    accuracy.mean_abs_diff = static_cast<float>(abs_sum / count);
+  }
+  const double norms = std::sqrt(reference_norm * norm);
+  accuracy.cosine = norms > 0.0 ? static_cast<float>(dot / norms) : 1.f;
+  return accuracy;
+}
+
+} // namespace
+
+sHalfComparison
+MixedPrecisionConverter::run(const std::string &model_path,
+                             const sModelGraph &graph,
+                             const sMixedPrecisionConfig &config,
+                             const sHalfCompareConfig &compare_config,
+                             const std::string &output_path) {
+  sHalfComparison result;
+  result.conversion = convert_to_half(model_path, graph, config, output_path);
+  if (!result.conversion.ok) {
+    result.error = result.conversion.error;
+    return result;
+  }
+
+  sSessionConfig session_config;
+  session_config.intra_op_threads = compare_config.threads;
+  InferenceSession reference(model_path, session_config);
+  InferenceSession half(result.conversion.output_path, session_config);
+  if (!reference.ok() || !half.ok()) {
+    result.error = reference.ok() ? half.error() : reference.error();
+    return result;
+  }
+  // graph inputs stay float32, so both models take the same values
+  const int batch = std::max(compare_config.batch_size, 1);
+  const auto &inputs = reference.synthetic_inputs(batch);
+  if (inputs.empty()) {
+    result.error = "unable to build inputs for " + model_path;
+    return result;
+  }
+  try {
+    std::vector<Ort::Value> reference_outputs;
+    std::vector<Ort::Value> half_outputs;
+    if (!reference.run(inputs, &reference_outputs) ||
+        !half.run(inputs, &half_outputs)) {
+      result.error =
+          reference.error().empty() ? half.error() : reference.error();
+      return result;
+    }
+    for (size_t i = 0;
+         i < reference_outputs.size() && i < half_outputs.size(); ++i) {
+      const auto info = reference_outputs[i].GetTensorTypeAndShapeInfo();
+      const size_t count = info.GetElementCount();
+      if (info.GetElementType() != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT ||
+          half_outputs[i].GetTensorTypeAndShapeInfo().GetElementCount() !=
+              count) {
+        continue;
+      }
+      result.outputs.push_back(compare(
+          reference.output_names()[i],
+          reference_outputs[i].GetTensorData<float>(),
+          half_outputs[i].GetTensorData<float>(), count, compare_config));
+    }
+
+    // the runs above warmed both sessions up
+    std::vector<double> reference_ms;
+    std::vector<double> half_ms;
+    for (int i = 0; i < std::max(compare_config.iterations, 1); ++i) {
+      Stopwatch watch;
+      if (!reference.run(inputs, &reference_outputs)) {
+        result.error = reference.error();
+        return result;
+      }
+      reference_ms.push_back(watch.elapsed_ms());
+      watch.reset();
+      if (!half.run(inputs, &half_outputs)) {
+        result.error = half.error();
+        return result;
+      }
+      half_ms.push_back(watch.elapsed_ms());
+    }
+    result.float_p50_ms = percentile(reference_ms, 0.5);
+    result.half_p50_ms = percentile(half_ms, 0.5);
+  } catch (const Ort::Exception &e) {
+    result.error = e.what();
+    return result;
+  }
+  result.float_peak_bytes = peak_bytes(reference);
+  result.half_peak_bytes = peak_bytes(half);
+  result.ok = true;
+  return result;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../model/mixed_precision.h"
+
+struct sHalfCompareConfig {
+  // an element passes when |half - float| <= atol + rtol * |float|
+  float rtol = 1e-2f;
+  float atol = 1e-3f;
+  int batch_size = 1;
+  // timed runs per model for the latency comparison
+  int iterations = 20;
+  // onnxruntime intra op threads, 0 lets onnxruntime decide
+  int threads = 0;
+};
+
+// half outputs against float32 outputs on the same inputs
+struct sHalfOutputAccuracy {
+  std::string name;
+  int64_t count = 0;
+  float max_abs_diff = 0.f;
+  float max_relative_diff = 0.f;
+  float mean_abs_diff = 0.f;
+  float cosine = 1.f;
+  // elements outside the tolerance, and infinities or NaNs where the float
+  // model has finite values
+  int64_t mismatched = 0;
+  int64_t nonfinite = 0;
+
+  bool passed() const { return mismatched == 0 && nonfinite == 0; }
+};
+
+struct sHalfComparison {
+  bool ok = false;
+  std::string error;
+  sHalfConversionResult conversion;
+  std::vector<sHalfOutputAccuracy> outputs;
+  double float_p50_ms = 0.0;
+  double half_p50_ms = 0.0;
+  // peak of the CPU arena over the timed runs
+  int64_t float_peak_bytes = 0;
+  int64_t half_peak_bytes = 0;
+
+  bool passed() const {
+    for (const auto &output : outputs) {
+      if (!output.passed()) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+// Converts a model with convert_to_half() and compares the converted model
+// with the float32 one on one synthetic batch, output by output against the
+// tolerance, then times both on that batch.
+class MixedPrecisionConverter {
+public:
+  static sHalfComparison run(const std::string &model_path,
+                             const sModelGraph &graph,
+                             const sMixedPrecisionConfig &config,
+                             const sHalfCompareConfig &compare,
+                             const std::string &output_path);
+};
@@ -0,0 +1,126 @@
+#include "optimization.h"
+
+#include <filesystem>
+#include <iostream>
+#include <set>
+
+#include "../model/inspector.h"
+#include "timing.h"
+
+namespace {
+
+struct sLevel {
+  GraphOptimizationLevel level;
+  const char *name;
+};
+
+constexpr sLevel kLevels[] = {
+    {ORT_DISABLE_ALL, "disabled"},
+    {ORT_ENABLE_BASIC, "basic"},
+    {ORT_ENABLE_EXTENDED, "extended"},
+    {ORT_ENABLE_ALL, "all"},
+};
+
+std::map<std::string, int> count_ops(const sModelGraph &graph) {
+  std::map<std::string, int> counts;
+  for (const auto &node : graph.nodes) {
+    ++counts[node.op_type];
+  }
+  return counts;
+}
+
+} // namespace
+
+bool OptimizationComparison::run(const std::string &model_path,
+                                 int iterations) {
+  namespace fs = std::filesystem;
+  _results.clear();
+
+  std::error_code ec;
+  const fs::path output_dir =
+      fs::temp_directory_path(ec) / "mynn" / "optimized";
+  fs::create_directories(output_dir, ec);
+  if (ec) {
+    std::cerr << "unable to create " << output_dir << ": " << ec.message()
+              << std::endl;
+    return false;
+  }
+  _output_dir = output_dir.string();
+  const std::string stem = fs::path(model_path).stem().string();
+
+  ModelInspector original(model_path);
+  const auto original_ops = count_ops(original.graph());
+
+  for (const auto &[level, name] : kLevels) {
+    sOptimizationLevelResult result;
+    result.level = level;
+    result.name = name;
+    result.onnx_path = (output_dir / (stem + "." + name + ".onnx")).string();
+    result.ort_path = (output_dir / (stem + "." + name + ".ort")).string();
+
+    sSessionConfig config;
+    config.optimization_level = level;
+    config.optimized_model_path = result.onnx_path;
+
+    Stopwatch watch;
+    InferenceSession session(model_path, config);
+    result.create_ms = watch.elapsed_ms();
+    if (!session.ok()) {
+      result.error = session.error();
+      _results.push_back(std::move(result));
+      continue;
+    }
+
+    watch.reset();
+    if (!session.run(1)) {
+      result.error = session.error();
+      _results.push_back(std::move(result));
+      continue;
+    }
+    result.first_run_ms = watch.elapsed_ms();
+
+    std::vector<double> latencies;
+    latencies.reserve(iterations);
+    for (int i = 0; i < iterations; ++i) {
+      watch.reset();
+      session.run(1);
+      latencies.push_back(watch.elapsed_ms());
+    }
+    for (double latency : latencies) {
+      result.mean_latency_ms += latency;
+    }
+    if (!latencies.empty()) {
+      result.mean_latency_ms /= latencies.size();
+    }
+    result.p50_latency_ms = percentile(latencies, 0.50);
+    result.p90_latency_ms = percentile(latencies, 0.90);
+
+    // the same optimizations saved as ORT format, then loaded as a
+    // pre-optimized model to measure the startup side of the tradeoff.
+    {
+      sSessionConfig ort_config = config;
+      ort_config.optimized_model_path = result.ort_path;
+      ort_config.save_ort_format = true;
+      InferenceSession writer(model_path, ort_config);
+    }
+    if (fs::exists(result.ort_path, ec)) {
+      sSessionConfig reload_config;
+      reload_config.optimization_level = ORT_DISABLE_ALL;
+      watch.reset();
+      InferenceSession reloaded(result.ort_path, reload_config);
+      result.reload_ms = reloaded.ok() ? watch.elapsed_ms() : 0.0;
+    }
+
+    ModelInspector optimized(result.onnx_path);
+    result.node_count = optimized.nodes().size();
+    result.op_counts = count_ops(optimized.graph());
+    for (const auto &[op_type, count] : result.op_counts) {
+      if (!original_ops.count(op_type)) {
+        result.fused_ops.push_back(op_type);
+      }
+    }
+    result.ok = true;
+    _results.push_back(std::move(result));
+  }
+  return true;
+}
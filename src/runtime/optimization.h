@@ -0,0 +1,45 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "session.h"
+
+struct sOptimizationLevelResult {
+  GraphOptimizationLevel level = ORT_DISABLE_ALL;
+  const char *name = "";
+  bool ok = false;
+  std::string error;
+  // optimized graph written by onnxruntime, in ONNX and ORT format
+  std::string onnx_path;
+  std::string ort_path;
+  // session creation including graph optimization
+  double create_ms = 0.0;
+  // session creation from the saved ORT-format model, optimizations off
+  double reload_ms = 0.0;
+  double first_run_ms = 0.0;
+  double mean_latency_ms = 0.0;
+  double p50_latency_ms = 0.0;
+  double p90_latency_ms = 0.0;
+  // graph of the optimized ONNX model, as seen by ModelInspector
+  size_t node_count = 0;
+  std::map<std::string, int> op_counts;
+  // op types that only appear after optimization, e.g. FusedConv
+  std::vector<std::string> fused_ops;
+};
+
+// Runs a model through every onnxruntime graph optimization level, saves each
+// optimized graph and measures its startup and steady-state latency.
+class OptimizationComparison {
+private:
+  std::vector<sOptimizationLevelResult> _results;
+  std::string _output_dir;
+
+public:
+  bool run(const std::string &model_path, int iterations);
+  const std::vector<sOptimizationLevelResult> &results() const {
+    return _results;
+  }
+  const std::string &output_dir() const { return _output_dir; }
+};
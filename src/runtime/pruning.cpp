@@ -0,0 +1,176 @@
+#include "pruning.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <onnx/onnx_pb.h>
+
+#include "../model/weights.h"
+#include "session.h"
+#include "timing.h"
+
+namespace {
+
+// float values of a float initializer stored raw or as float_data
+bool float_values(const onnx::TensorProto &tensor,
+                  std::vector<float> &values) {
+  if (tensor.data_type() != onnx::TensorProto_DataType_FLOAT) {
+    return false;
+  }
+  if (tensor.has_raw_data()) {
+    const auto &raw = tensor.raw_data();
+    values.resize(raw.size() / sizeof(float));
+    std::memcpy(values.data(), raw.data(), values.size() * sizeof(float));
+  } else {
+    values.assign(tensor.float_data().begin(), tensor.float_data().end());
+  }
+  return true;
+}
+
+void compare(const Ort::Value &dense, const Ort::Value &pruned,
+             sPrunedOutput &output) {
+  const auto info = dense.GetTensorTypeAndShapeInfo();
+  const size_t count = info.GetElementCount();
+  if (info.GetElementType() != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT ||
+      pruned.GetTensorTypeAndShapeInfo().GetElementCount() != count) {
+    return;
+  }
+  const float *a = dense.GetTensorData<float>();
+  const float *b = pruned.GetTensorData<float>();
+  double dot = 0.0;
+  double dense_norm = 0.0;
+  double pruned_norm = 0.0;
+  for (size_t k = 0; k < count; ++k) {
+    output.max_abs_diff =
+        std::max(output.max_abs_diff, std::fabs(a[k] - b[k]));
+    dot += static_cast<double>(a[k]) * b[k];
+    dense_norm += static_cast<double>(a[k]) * a[k];
+    pruned_norm += static_cast<double>(b[k]) * b[k];
+  }
+  const double norms = std::sqrt(dense_norm * pruned_norm);
+  output.cosine = norms > 0.0 ? static_cast<float>(dot / norms) : 1.f;
+}
+
+} // namespace
+
+sPruningResult WeightPruner::run(const std::string &model_path,
+                                 const sPruningConfig &config) {
+  sPruningResult result;
+  {
+    onnx::ModelProto model;
+    if (!load_model_proto(model_path, model, result.error)) {
+      return result;
+    }
+    auto &graph = *model.mutable_graph();
+    std::unordered_map<std::string, onnx::TensorProto *> initializers;
+    for (auto &tensor : *graph.mutable_initializer()) {
+      initializers[tensor.name()] = &tensor;
+    }
+    // a weight shared by several nodes is pruned once
+    std::unordered_set<std::string> pruned;
+    std::vector<float> values;
+    for (const auto &node : graph.node()) {
+      if (node.input_size() < 2) {
+        continue;
+      }
+      const auto &name = node.input(1);
+      auto pattern = config.weights.find(name);
+      auto tensor = initializers.find(name);
+      if (pattern == config.weights.end() ||
+          tensor == initializers.end() || pruned.count(name) ||
+          !float_values(*tensor->second, values)) {
+        continue;
+      }
+      const std::vector<int64_t> dims(tensor->second->dims().begin(),
+                                      tensor->second->dims().end());
+      sWeightMatrix matrix;
+      if (!weight_matrix(node.op_type(),
+                         int_attribute(node, "transB", 0) != 0, dims,
+                         matrix) ||
+          matrix.size() != values.size()) {
+        continue;
+      }
+      result.zeroed += static_cast<int64_t>(prune_weight(
+          values.data(), matrix, pattern->second, config.target));
+      result.params += static_cast<int64_t>(values.size());
+      tensor->second->clear_float_data();
+      tensor->second->set_raw_data(values.data(),
+                                   values.size() * sizeof(float));
+      pruned.insert(name);
+    }
+    result.pruned_weights = static_cast<int>(pruned.size());
+    if (pruned.empty()) {
+      result.error = "none of the chosen weights could be pruned";
+      return result;
+    }
+
+    result.output_path = config.output_path;
+    if (result.output_path.empty()) {
+      result.output_path = std::filesystem::path(model_path)
+                               .replace_extension(".pruned.onnx")
+                               .string();
+    }
+    std::ofstream output(result.output_path,
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!output.is_open() || !model.SerializeToOstream(&output)) {
+      result.error = "unable to write " + result.output_path;
+      return result;
+    }
+  }
+
+  sSessionConfig session_config;
+  session_config.intra_op_threads = config.threads;
+  InferenceSession dense(model_path, session_config);
+  InferenceSession sparse(result.output_path, session_config);
+  if (!dense.ok() || !sparse.ok()) {
+    result.error = dense.ok() ? sparse.error() : dense.error();
+    return result;
+  }
+  // synthetic inputs are seeded, so both models see the same values
+  const int batch_size = std::max(config.batch_size, 1);
+  std::vector<Ort::Value> dense_outputs;
+  std::vector<Ort::Value> sparse_outputs;
+  if (!dense.run(batch_size, &dense_outputs) ||
+      !sparse.run(batch_size, &sparse_outputs)) {
+    result.error = dense.error().empty() ? sparse.error() : dense.error();
+    return result;
+  }
+  try {
+    for (size_t i = 0;
+         i < dense_outputs.size() && i < sparse_outputs.size(); ++i) {
+      sPrunedOutput compared;
+      compared.name = dense.output_names()[i];
+      compare(dense_outputs[i], sparse_outputs[i], compared);
+      result.outputs.push_back(compared);
+    }
+  } catch (const Ort::Exception &e) {
+    result.error = e.what();
+    return result;
+  }
+
+  std::vector<double> dense_ms;
+  std::vector<double> sparse_ms;
+  for (int i = 0; i < std::max(config.iterations, 1); ++i) {
+    Stopwatch watch;
+    if (!dense.run(batch_size, &dense_outputs)) {
+      result.error = dense.error();
+      return result;
+    }
+    dense_ms.push_back(watch.elapsed_ms());
+    watch.reset();
+    if (!sparse.run(batch_size, &sparse_outputs)) {
+      result.error = sparse.error();
+      return result;
+    }
+    sparse_ms.push_back(watch.elapsed_ms());
+  }
+  result.dense_p50_ms = percentile(dense_ms, 0.5);
+  result.pruned_p50_ms = percentile(sparse_ms, 0.5);
+  result.ok = true;
+  return result;
+}
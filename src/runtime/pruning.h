@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../model/sparsity.h"
+
+struct sPruningConfig {
+  // weights to prune by name, with their pattern. Conv, Gemm and MatMul
+  // float weights only; others are left alone.
+  std::map<std::string, ePruningPattern> weights;
+  // sparsity of the unstructured, channel and block patterns
+  float target = 0.5f;
+  // empty for <model>.pruned.onnx next to the model
+  std::string output_path;
+  // timed runs per model after one warm-up run
+  int iterations = 20;
+  // leading symbolic dim of the inputs
+  int batch_size = 1;
+  // onnxruntime intra op threads, 0 lets onnxruntime decide
+  int threads = 0;
+};
+
+// pruned outputs against dense outputs on the same synthetic inputs
+struct sPrunedOutput {
+  std::string name;
+  float max_abs_diff = 0.f;
+  float cosine = 1.f;
+};
+
+struct sPruningResult {
+  bool ok = false;
+  std::string error;
+  std::string output_path;
+  int pruned_weights = 0;
+  int64_t zeroed = 0;
+  int64_t params = 0;
+  double dense_p50_ms = 0.0;
+  double pruned_p50_ms = 0.0;
+  std::vector<sPrunedOutput> outputs;
+};
+
+// Magnitude-prunes the chosen weights of a model in place (zeroed, shapes
+// unchanged), writes the pruned model and compares it with the dense one.
+// onnxruntime's CPU kernels are dense, so the latency shows what the model
+// runs at without sparse kernels and the output error what pruning costs
+// before any fine-tuning.
+class WeightPruner {
+public:
+  static sPruningResult run(const std::string &model_path,
+                            const sPruningConfig &config);
+};
@@ -0,0 +1,676 @@
+#include "quantization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <onnx/onnx_pb.h>
+
+#include "../model/npy.h"
+#include "../model/tensor_utils.h"
+#include "../model/weights.h"
+#include "session.h"
+#include "timing.h"
+
+namespace {
+
+using sSample = std::vector<sNpyArray>;
+
+// one sample per .npy file or per subdirectory, in name order
+bool load_samples(const std::string &dir, const InferenceSession &session,
+                  std::vector<sSample> &samples, std::string &error) {
+  namespace fs = std::filesystem;
+  std::error_code ec;
+  std::vector<fs::path> entries;
+  for (const auto &entry : fs::directory_iterator(dir, ec)) {
+    entries.push_back(entry.path());
+  }
+  if (ec) {
+    error = "unable to read calibration directory: " + dir;
+    return false;
+  }
+  std::sort(entries.begin(), entries.end());
+
+  const auto &names = session.input_names();
+  for (const auto &path : entries) {
+    std::vector<fs::path> files;
+    if (fs::is_directory(path)) {
+      for (const auto &name : names) {
+        files.push_back(path / (name + ".npy"));
+      }
+    } else if (path.extension() == ".npy" && names.size() == 1) {
+      files.push_back(path);
+    } else {
+      continue;
+    }
+    sSample sample(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+      if (!load_npy(files[i].string(), sample[i], error)) {
+        return false;
+      }
+      // onnxruntime element types share TensorProto's numbering
+      const auto &shape = session.input_shapes()[i];
+      bool matches = sample[i].dtype ==
+                         onnx_to_model_dtype(session.input_types()[i]) &&
+                     sample[i].shape.size() == shape.size();
+      for (size_t d = 0; matches && d < shape.size(); ++d) {
+        matches = shape[d] <= 0 || shape[d] == sample[i].shape[d];
+      }
+      if (!matches) {
+        error = files[i].string() + " does not match input " + names[i];
+        return false;
+      }
+    }
+    samples.push_back(std::move(sample));
+  }
+  if (samples.empty()) {
+    error = "no calibration samples in " + dir;
+    return false;
+  }
+  return true;
+}
+
+// uniform(-1, 1) floats and zero integers, symbolic dims taken as 1
+void synthetic_samples(const InferenceSession &session, int count,
+                       std::vector<sSample> &samples) {
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  for (int s = 0; s < count; ++s) {
+    std::mt19937 rng(42 + s);
+    sSample sample;
+    for (size_t i = 0; i < session.input_names().size(); ++i) {
+      sNpyArray array;
+      array.dtype = onnx_to_model_dtype(session.input_types()[i]);
+      size_t elements = 1;
+      for (int64_t dim : session.input_shapes()[i]) {
+        array.shape.push_back(std::max<int64_t>(dim, 1));
+        elements *= static_cast<size_t>(array.shape.back());
+      }
+      array.data.assign(elements * model_dtype_size(array.dtype), 0);
+      if (array.dtype == MODEL_TENSOR_DATA_TYPE_FLOAT32) {
+        auto *values = reinterpret_cast<float *>(array.data.data());
+        for (size_t k = 0; k < elements; ++k) {
+          values[k] = dist(rng);
+        }
+      }
+      sample.push_back(std::move(array));
+    }
+    samples.push_back(std::move(sample));
+  }
+}
+
+std::vector<Ort::Value> sample_values(const InferenceSession &session,
+                                      sSample &sample) {
+  auto memory_info =
+      Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+  std::vector<Ort::Value> values;
+  for (size_t i = 0; i < sample.size(); ++i) {
+    values.push_back(Ort::Value::CreateTensor(
+        memory_info, sample[i].data.data(), sample[i].data.size(),
+        sample[i].shape.data(), sample[i].shape.size(),
+        session.input_types()[i]));
+  }
+  return values;
+}
+
+struct sQuantTarget {
+  int node = -1;
+  // axis of the output channels in the weight, -1 for per-tensor scales
+  int weight_axis = -1;
+  // index of a float bias initializer input, -1 if none
+  int bias_input = -1;
+};
+
+class QdqWriter {
+public:
+  QdqWriter(onnx::ModelProto &model,
+            const std::unordered_map<std::string, std::vector<float>> &weights,
+            const std::map<std::string, sQuantParams> &activations)
+      : _graph(*model.mutable_graph()), _weights(weights),
+        _activations(activations) {
+    for (const auto &node : _graph.node()) {
+      _names.insert(node.output().begin(), node.output().end());
+    }
+    for (const auto &value : _graph.input()) {
+      _names.insert(value.name());
+    }
+    for (int i = 0; i < _graph.initializer_size(); ++i) {
+      _names.insert(_graph.initializer(i).name());
+      _initializers[_graph.initializer(i).name()] = i;
+    }
+  }
+
+  int64_t fp32_bytes = 0;
+  int64_t int8_bytes = 0;
+
+  void write(const std::vector<sQuantTarget> &targets) {
+    std::vector<onnx::NodeProto> nodes(_graph.node().begin(),
+                                       _graph.node().end());
+    std::unordered_map<int, const sQuantTarget *> target_of;
+    for (const auto &target : targets) {
+      target_of[target.node] = &target;
+    }
+
+    _graph.clear_node();
+    for (int i = 0; i < static_cast<int>(nodes.size()); ++i) {
+      auto &node = nodes[i];
+      const std::string activation =
+          node.input_size() > 0 ? node.input(0) : std::string();
+      for (auto &input : *node.mutable_input()) {
+        auto it = _activations.find(input);
+        if (it == _activations.end()) {
+          continue;
+        }
+        // Q/DQ pairs go right before the first consumer, which keeps the
+        // node list topologically sorted
+        if (!_dequantized.count(input)) {
+          _dequantized[input] = quantize_activation(input, it->second);
+        }
+        input = _dequantized[input];
+      }
+      auto target = target_of.find(i);
+      if (target != target_of.end()) {
+        quantize_operands(*target->second, activation, node);
+      }
+      *_graph.add_node() = std::move(node);
+    }
+    remove_unused_initializers();
+  }
+
+private:
+  onnx::GraphProto &_graph;
+  const std::unordered_map<std::string, std::vector<float>> &_weights;
+  const std::map<std::string, sQuantParams> &_activations;
+  std::unordered_set<std::string> _names;
+  std::unordered_map<std::string, int> _initializers;
+  // original name to dequantized name
+  std::unordered_map<std::string, std::string> _dequantized;
+  std::unordered_set<std::string> _replaced;
+
+  std::string unique_name(const std::string &base) {
+    std::string name = base;
+    for (int i = 1; !_names.insert(name).second; ++i) {
+      name = base + "_" + std::to_string(i);
+    }
+    return name;
+  }
+
+  std::string add_initializer(const std::string &base, int data_type,
+                              const std::vector<int64_t> &dims,
+                              const void *data, size_t bytes) {
+    auto *tensor = _graph.add_initializer();
+    tensor->set_name(unique_name(base));
+    tensor->set_data_type(data_type);
+    for (int64_t dim : dims) {
+      tensor->add_dims(dim);
+    }
+    tensor->set_raw_data(static_cast<const char *>(data), bytes);
+    return tensor->name();
+  }
+
+  std::string add_dequantize(const std::string &base,
+                             const std::string &quantized,
+                             const std::string &scale,
+                             const std::string &zero_point, int axis) {
+    auto *node = _graph.add_node();
+    node->set_name(unique_name(base + "_DequantizeLinear"));
+    node->set_op_type("DequantizeLinear");
+    node->add_input(quantized);
+    node->add_input(scale);
+    node->add_input(zero_point);
+    node->add_output(unique_name(base + "_dequantized"));
+    if (axis >= 0) {
+      auto *attribute = node->add_attribute();
+      attribute->set_name("axis");
+      attribute->set_type(onnx::AttributeProto_AttributeType_INT);
+      attribute->set_i(axis);
+    }
+    return node->output(0);
+  }
+
+  std::string quantize_activation(const std::string &name,
+                                  const sQuantParams &params) {
+    const auto zero_point = static_cast<uint8_t>(params.zero_point);
+    const auto scale = add_initializer(
+        name + "_scale", onnx::TensorProto_DataType_FLOAT, {}, &params.scale,
+        sizeof(float));
+    const auto zero = add_initializer(name + "_zero_point",
+                                      onnx::TensorProto_DataType_UINT8, {},
+                                      &zero_point, sizeof(zero_point));
+    auto *node = _graph.add_node();
+    node->set_name(unique_name(name + "_QuantizeLinear"));
+    node->set_op_type("QuantizeLinear");
+    node->add_input(name);
+    node->add_input(scale);
+    node->add_input(zero);
+    node->add_output(unique_name(name + "_quantized"));
+    return add_dequantize(name, node->output(0), scale, zero, -1);
+  }
+
+  const onnx::TensorProto &initializer(const std::string &name) const {
+    return _graph.initializer(_initializers.at(name));
+  }
+
+  // `activation` is the original name of the node's first input
+  void quantize_operands(const sQuantTarget &target,
+                         const std::string &activation,
+                         onnx::NodeProto &node) {
+    const std::string weight_name = node.input(1);
+    const auto &weight = initializer(weight_name);
+    const std::vector<int64_t> dims(weight.dims().begin(),
+                                    weight.dims().end());
+    const auto quantized =
+        quantize_weight(_weights.at(weight_name), dims, target.weight_axis);
+    const std::vector<int64_t> scale_dims =
+        target.weight_axis >= 0
+            ? std::vector<int64_t>{dims[target.weight_axis]}
+            : std::vector<int64_t>{};
+
+    if (!_dequantized.count(weight_name)) {
+      const std::vector<int8_t> zeros(quantized.scales.size(), 0);
+      const auto values = add_initializer(
+          weight_name + "_quantized", onnx::TensorProto_DataType_INT8, dims,
+          quantized.values.data(), quantized.values.size());
+      const auto scale = add_initializer(
+          weight_name + "_scale", onnx::TensorProto_DataType_FLOAT,
+          scale_dims, quantized.scales.data(),
+          quantized.scales.size() * sizeof(float));
+      const auto zero = add_initializer(
+          weight_name + "_zero_point", onnx::TensorProto_DataType_INT8,
+          scale_dims, zeros.data(), zeros.size());
+      _dequantized[weight_name] =
+          add_dequantize(weight_name, values, scale, zero, target.weight_axis);
+      _replaced.insert(weight_name);
+      fp32_bytes += static_cast<int64_t>(quantized.values.size()) * 4;
+      int8_bytes += static_cast<int64_t>(quantized.values.size());
+    }
+    node.set_input(1, _dequantized[weight_name]);
+
+    // int32 bias at the scale of the accumulator, input times weight scale
+    auto input = _activations.find(activation);
+    if (target.bias_input < 0 || input == _activations.end()) {
+      return;
+    }
+    const std::string bias_name = node.input(target.bias_input);
+    const auto &bias = _weights.at(bias_name);
+    if (quantized.scales.size() > 1 &&
+        bias.size() != quantized.scales.size()) {
+      return;
+    }
+    std::vector<int32_t> values(bias.size());
+    std::vector<float> scales(quantized.scales.size());
+    for (size_t c = 0; c < scales.size(); ++c) {
+      scales[c] = input->second.scale * quantized.scales[c];
+    }
+    for (size_t c = 0; c < bias.size(); ++c) {
+      const float scale = scales[scales.size() == 1 ? 0 : c];
+      values[c] = static_cast<int32_t>(
+          std::clamp(std::round(bias[c] / scale), -2147483520.f,
+                     2147483520.f));
+    }
+    const std::vector<int32_t> zeros(scales.size(), 0);
+    const auto quantized_bias = add_initializer(
+        bias_name + "_quantized", onnx::TensorProto_DataType_INT32,
+        {static_cast<int64_t>(values.size())}, values.data(),
+        values.size() * sizeof(int32_t));
+    const auto scale = add_initializer(
+        bias_name + "_scale", onnx::TensorProto_DataType_FLOAT, scale_dims,
+        scales.data(), scales.size() * sizeof(float));
+    const auto zero = add_initializer(
+        bias_name + "_zero_point", onnx::TensorProto_DataType_INT32,
+        scale_dims, zeros.data(), zeros.size() * sizeof(int32_t));
+    node.set_input(target.bias_input,
+                   add_dequantize(bias_name, quantized_bias, scale, zero,
+                                  scale_dims.empty() ? -1 : 0));
+    _replaced.insert(bias_name);
+    fp32_bytes += static_cast<int64_t>(bias.size()) * 4;
+    int8_bytes += static_cast<int64_t>(bias.size()) * 4;
+  }
+
+  // replaced float tensors that no node reads anymore
+  void remove_unused_initializers() {
+    std::unordered_set<std::string> used;
+    for (const auto &node : _graph.node()) {
+      used.insert(node.input().begin(), node.input().end());
+    }
+    for (const auto &output : _graph.output()) {
+      used.insert(output.name());
+    }
+    auto unused = [&](const std::string &name) {
+      return _replaced.count(name) && !used.count(name);
+    };
+    auto *initializers = _graph.mutable_initializer();
+    initializers->erase(
+        std::remove_if(initializers->begin(), initializers->end(),
+                       [&](const onnx::TensorProto &tensor) {
+                         return unused(tensor.name());
+                       }),
+        initializers->end());
+    // older models also list initializers as graph inputs
+    auto *inputs = _graph.mutable_input();
+    inputs->erase(std::remove_if(inputs->begin(), inputs->end(),
+                                 [&](const onnx::ValueInfoProto &value) {
+                                   return unused(value.name());
+                                 }),
+                  inputs->end());
+  }
+};
+
+// Conv, MatMul and Gemm nodes with a float initializer as weight
+std::vector<sQuantTarget> quantization_targets(
+    const onnx::GraphProto &graph,
+    const std::unordered_map<std::string, std::vector<float>> &weights,
+    bool per_channel) {
+  std::unordered_map<std::string, const onnx::TensorProto *> initializers;
+  for (const auto &tensor : graph.initializer()) {
+    initializers[tensor.name()] = &tensor;
+  }
+  auto float_initializer = [&](const std::string &name) {
+    auto it = initializers.find(name);
+    return it != initializers.end() &&
+           it->second->data_type() == onnx::TensorProto_DataType_FLOAT &&
+           weights.count(name);
+  };
+
+  std::vector<sQuantTarget> targets;
+  for (int i = 0; i < graph.node_size(); ++i) {
+    const auto &node = graph.node(i);
+    const auto &op = node.op_type();
+    if ((op != "Conv" && op != "MatMul" && op != "Gemm") ||
+        node.input_size() < 2 || node.input(0).empty() ||
+        !float_initializer(node.input(1))) {
+      continue;
+    }
+    const int rank = initializers[node.input(1)]->dims_size();
+    sQuantTarget target;
+    target.node = i;
+    if (op == "Conv") {
+      target.weight_axis = 0;
+    } else if (op == "Gemm") {
+      target.weight_axis = int_attribute(node, "transB", 0) ? 0 : 1;
+    } else {
+      target.weight_axis = rank - 1;
+    }
+    if (!per_channel || rank < 2) {
+      target.weight_axis = -1;
+    }
+    if (op != "MatMul" && node.input_size() > 2 &&
+        float_initializer(node.input(2)) &&
+        initializers[node.input(2)]->dims_size() == 1) {
+      target.bias_input = 2;
+    }
+    targets.push_back(target);
+  }
+  return targets;
+}
+
+struct sAccuracySum {
+  double max_abs = 0.0;
+  double abs_sum = 0.0;
+  double dot = 0.0;
+  double fp32_norm = 0.0;
+  double int8_norm = 0.0;
+  int64_t count = 0;
+  int64_t rows = 0;
+  int64_t top1_matches = 0;
+  bool classifier = true;
+};
+
+void accumulate(const Ort::Value &fp32, const Ort::Value &int8,
+                sAccuracySum &sum) {
+  const auto info = fp32.GetTensorTypeAndShapeInfo();
+  const size_t count = info.GetElementCount();
+  if (info.GetElementType() != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT ||
+      int8.GetTensorTypeAndShapeInfo().GetElementCount() != count) {
+    sum.classifier = false;
+    return;
+  }
+  const float *a = fp32.GetTensorData<float>();
+  const float *b = int8.GetTensorData<float>();
+  for (size_t k = 0; k < count; ++k) {
+    const double diff = std::fabs(static_cast<double>(a[k]) - b[k]);
+    sum.max_abs = std::max(sum.max_abs, diff);
+    sum.abs_sum += diff;
+    sum.dot += static_cast<double>(a[k]) * b[k];
+    sum.fp32_norm += static_cast<double>(a[k]) * a[k];
+    sum.int8_norm += static_cast<double>(b[k]) * b[k];
+  }
+  sum.count += static_cast<int64_t>(count);
+
+  const auto shape = info.GetShape();
+  if (shape.size() != 2 || shape[1] < 2) {
+    sum.classifier = false;
+    return;
+  }
+  for (int64_t row = 0; row < shape[0]; ++row) {
+    const float *x = a + row * shape[1];
+    const float *y = b + row * shape[1];
+    sum.top1_matches += std::max_element(x, x + shape[1]) - x ==
+                        std::max_element(y, y + shape[1]) - y;
+    ++sum.rows;
+  }
+}
+
+} // namespace
+
+sQuantizationResult
+PostTrainingQuantizer::run(const std::string &model_path,
+                           const sQuantizationConfig &config) {
+  sQuantizationResult result;
+  onnx::ModelProto model;
+  std::unordered_map<std::string, std::vector<float>> weights;
+  if (!load_model_proto(model_path, model, result.error) ||
+      !load_float_weights(model_path, weights, result.error)) {
+    return result;
+  }
+  const int opset = opset_version(model);
+  if (opset < 10) {
+    result.error = "QuantizeLinear needs opset 10, the model has opset " +
+                   std::to_string(opset);
+    return result;
+  }
+  const auto targets = quantization_targets(
+      model.graph(), weights, config.per_channel && opset >= 13);
+  if (targets.empty()) {
+    result.error = "no Conv, MatMul or Gemm node with constant weights";
+    return result;
+  }
+
+  sSessionConfig session_config;
+  session_config.intra_op_threads = config.threads;
+  InferenceSession fp32(model_path, session_config);
+  if (!fp32.ok()) {
+    result.error = fp32.error();
+    return result;
+  }
+  std::vector<sSample> samples;
+  if (config.calibration_dir.empty()) {
+    synthetic_samples(fp32, std::max(config.synthetic_samples, 1), samples);
+  } else if (!load_samples(config.calibration_dir, fp32, samples,
+                           result.error)) {
+    return result;
+  }
+  result.samples = static_cast<int>(samples.size());
+
+  // activations around every target, captured as extra graph outputs
+  std::vector<std::string> names;
+  std::unordered_set<std::string> seen;
+  for (const auto &target : targets) {
+    const auto &node = model.graph().node(target.node);
+    for (const auto &name : {node.input(0), node.output(0)}) {
+      if (seen.insert(name).second) {
+        names.push_back(name);
+      }
+    }
+  }
+  onnx::ModelProto augmented = model;
+  std::unordered_set<std::string> outputs;
+  for (const auto &output : augmented.graph().output()) {
+    outputs.insert(output.name());
+  }
+  for (const auto &name : names) {
+    if (outputs.insert(name).second) {
+      augmented.mutable_graph()->add_output()->set_name(name);
+    }
+  }
+  std::string serialized;
+  if (!augmented.SerializeToString(&serialized)) {
+    result.error = "failed to serialize calibration model";
+    return result;
+  }
+  augmented.Clear();
+
+  std::map<std::string, ActivationHistogram> histograms;
+  try {
+    Stopwatch watch;
+    sSessionConfig calibration_config = session_config;
+    calibration_config.optimization_level = ORT_ENABLE_BASIC;
+    InferenceSession calibration(serialized.data(), serialized.size(),
+                                 calibration_config);
+    if (!calibration.ok()) {
+      result.error = calibration.error();
+      return result;
+    }
+    for (auto &sample : samples) {
+      std::vector<Ort::Value> values;
+      if (!calibration.run(sample_values(calibration, sample), &values)) {
+        result.error = calibration.error();
+        return result;
+      }
+      // graph inputs are read from the sample itself
+      for (size_t i = 0; i < sample.size(); ++i) {
+        if (seen.count(calibration.input_names()[i]) &&
+            sample[i].dtype == MODEL_TENSOR_DATA_TYPE_FLOAT32) {
+          histograms[calibration.input_names()[i]].add(
+              reinterpret_cast<const float *>(sample[i].data.data()),
+              sample[i].data.size() / sizeof(float));
+        }
+      }
+      for (size_t i = 0; i < values.size(); ++i) {
+        const auto &name = calibration.output_names()[i];
+        const auto info = values[i].GetTensorTypeAndShapeInfo();
+        if (seen.count(name) &&
+            info.GetElementType() == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT) {
+          histograms[name].add(values[i].GetTensorData<float>(),
+                               info.GetElementCount());
+        }
+      }
+    }
+    result.calibration_ms = watch.elapsed_ms();
+  } catch (const Ort::Exception &e) {
+    result.error = e.what();
+    return result;
+  }
+  serialized.clear();
+
+  std::map<std::string, sQuantParams> activations;
+  for (const auto &name : names) {
+    auto it = histograms.find(name);
+    if (it == histograms.end() || it->second.count() == 0) {
+      continue;
+    }
+    sCalibratedTensor tensor;
+    tensor.name = name;
+    tensor.min = it->second.min();
+    tensor.max = it->second.max();
+    it->second.calibrated_range(config.method, config.percentile, tensor.low,
+                                tensor.high);
+    tensor.params = uint8_params(tensor.low, tensor.high);
+    activations[name] = tensor.params;
+    result.tensors.push_back(tensor);
+  }
+
+  QdqWriter writer(model, weights, activations);
+  writer.write(targets);
+  weights.clear();
+  result.quantized_nodes = static_cast<int>(targets.size());
+  result.fp32_weight_bytes = writer.fp32_bytes;
+  result.int8_weight_bytes = writer.int8_bytes;
+  result.output_path = config.output_path;
+  if (result.output_path.empty()) {
+    result.output_path = std::filesystem::path(model_path)
+                             .replace_extension(".int8.onnx")
+                             .string();
+  }
+  {
+    std::ofstream output(result.output_path,
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!output.is_open() || !model.SerializeToOstream(&output)) {
+      result.error = "unable to write " + result.output_path;
+      return result;
+    }
+  }
+  model.Clear();
+
+  InferenceSession int8(result.output_path, session_config);
+  if (!int8.ok()) {
+    result.error = int8.error();
+    return result;
+  }
+  try {
+    std::vector<sAccuracySum> sums(fp32.output_names().size());
+    std::vector<Ort::Value> fp32_outputs;
+    std::vector<Ort::Value> int8_outputs;
+    for (auto &sample : samples) {
+      if (!fp32.run(sample_values(fp32, sample), &fp32_outputs) ||
+          !int8.run(sample_values(int8, sample), &int8_outputs)) {
+        result.error = fp32.error().empty() ? int8.error() : fp32.error();
+        return result;
+      }
+      for (size_t i = 0; i < sums.size() && i < int8_outputs.size(); ++i) {
+        accumulate(fp32_outputs[i], int8_outputs[i], sums[i]);
+      }
+    }
+    for (size_t i = 0; i < sums.size(); ++i) {
+      const auto &sum = sums[i];
+      if (sum.count == 0) {
+        continue;
+      }
+      sOutputAccuracy accuracy;
+      accuracy.name = fp32.output_names()[i];
+      accuracy.max_abs_diff = static_cast<float>(sum.max_abs);
+      accuracy.mean_abs_diff = static_cast<float>(sum.abs_sum / sum.count);
+      const double norms = std::sqrt(sum.fp32_norm * sum.int8_norm);
+      accuracy.cosine =
+          norms > 0.0 ? static_cast<float>(sum.dot / norms) : 1.f;
+      if (sum.classifier && sum.rows > 0) {
+        accuracy.top1_agreement =
+            static_cast<float>(sum.top1_matches) / sum.rows;
+      }
+      result.outputs.push_back(accuracy);
+    }
+
+    // latency on the first sample, after one warm-up run
+    const auto fp32_inputs = sample_values(fp32, samples.front());
+    const auto int8_inputs = sample_values(int8, samples.front());
+    std::vector<double> fp32_ms;
+    std::vector<double> int8_ms;
+    fp32.run(fp32_inputs, &fp32_outputs);
+    int8.run(int8_inputs, &int8_outputs);
+    for (int i = 0; i < std::max(config.iterations, 1); ++i) {
+      Stopwatch watch;
+      if (!fp32.run(fp32_inputs, &fp32_outputs)) {
+        result.error = fp32.error();
+        return result;
+      }
+      fp32_ms.push_back(watch.elapsed_ms());
+      watch.reset();
+      if (!int8.run(int8_inputs, &int8_outputs)) {
+        result.error = int8.error();
+        return result;
+      }
+      int8_ms.push_back(watch.elapsed_ms());
+    }
+    result.fp32_p50_ms = percentile(fp32_ms, 0.5);
+    result.int8_p50_ms = percentile(int8_ms, 0.5);
+  } catch (const Ort::Exception &e) {
+    result.error = e.what();
+    return result;
+  }
+  result.ok = true;
+  return result;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../model/quantization.h"
+
+struct sQuantizationConfig {
+  // directory of NumPy .npy calibration samples. single input models take
+  // one file per sample, others one subdirectory per sample holding
+  // <input name>.npy. empty for synthetic samples.
+  std::string calibration_dir;
+  int synthetic_samples = 16;
+  eCalibrationMethod method = CALIBRATION_MIN_MAX;
+  float percentile = 99.99f;
+  // per output channel weight scales, needs opset 13
+  bool per_channel = true;
+  // empty for <model>.int8.onnx next to the model
+  std::string output_path;
+  // timed runs per model for the latency comparison
+  int iterations = 20;
+  // onnxruntime intra op threads, 0 lets onnxruntime decide
+  int threads = 0;
+};
+
+struct sCalibratedTensor {
+  std::string name;
+  // observed range, and the range chosen by the calibration method
+  float min = 0.f;
+  float max = 0.f;
+  float low = 0.f;
+  float high = 0.f;
+  sQuantParams params;
+};
+
+// int8 outputs against fp32 outputs over all calibration samples
+struct sOutputAccuracy {
+  std::string name;
+  float max_abs_diff = 0.f;
+  float mean_abs_diff = 0.f;
+  float cosine = 1.f;
+  // share of rows with the same argmax for [N, classes] outputs, -1 for
+  // other shapes
+  float top1_agreement = -1.f;
+};
+
+struct sQuantizationResult {
+  bool ok = false;
+  std::string error;
+  std::string output_path;
+  int samples = 0;
+  std::vector<sCalibratedTensor> tensors;
+  int quantized_nodes = 0;
+  // weights and biases replaced by 8 and 32 bit integers
+  int64_t fp32_weight_bytes = 0;
+  int64_t int8_weight_bytes = 0;
+  double calibration_ms = 0.0;
+  double fp32_p50_ms = 0.0;
+  double int8_p50_ms = 0.0;
+  std::vector<sOutputAccuracy> outputs;
+};
+
+// Static INT8 post-training quantization with onnxruntime. Calibrates the
+// inputs and outputs of Conv, MatMul and Gemm nodes with float initializer
+// weights, writes a QDQ model (uint8 activations, int8 symmetric weights,
+// int32 biases) and compares it with the fp32 model on the calibration
+// samples.
+class PostTrainingQuantizer {
+public:
+  static sQuantizationResult run(const std::string &model_path,
+                                 const sQuantizationConfig &config);
+};
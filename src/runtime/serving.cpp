@@ -0,0 +1,278 @@
+#include "serving.h"
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+
+#include "session.h"
+#include "timing.h"
+
+namespace {
+
+double ms_between(std::chrono::steady_clock::time_point from,
+                  std::chrono::steady_clock::time_point to) {
+  return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+} // namespace
+
+ServingSimulator::~ServingSimulator() { stop(); }
+
+bool ServingSimulator::start(const std::string &model_path,
+                             const sServingConfig &config) {
+  stop();
+  if (config.num_sessions <= 0 || config.qps <= 0.0 ||
+      config.max_batch_size <= 0) {
+    _error = "invalid serving configuration";
+    return false;
+  }
+  _model_path = model_path;
+  _config = config;
+  _error.clear();
+  _stop = false;
+  _generating = true;
+  _ready_sessions = 0;
+  _failed_sessions = 0;
+  {
+    std::lock_guard<std::mutex> lock(_stats_mutex);
+    _samples.clear();
+    _submitted = 0;
+    _rejected = 0;
+    _start_time = Clock::now();
+    _last_done = _start_time;
+  }
+  {
+    std::lock_guard<std::mutex> lock(_queue_mutex);
+    _queue.clear();
+  }
+
+  _active_workers = _config.num_sessions;
+  for (int i = 0; i < _config.num_sessions; ++i) {
+    _workers.emplace_back(&ServingSimulator::worker_loop, this);
+  }
+  _generator = std::thread(&ServingSimulator::generator_loop, this);
+  return true;
+}
+
+void ServingSimulator::stop() {
+  {
+    std::lock_guard<std::mutex> lock(_queue_mutex);
+    _stop = true;
+  }
+  _queue_cv.notify_all();
+  join();
+}
+
+void ServingSimulator::join() {
+  if (_generator.joinable()) {
+    _generator.join();
+  }
+  for (auto &worker : _workers) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+  _workers.clear();
+}
+
+void ServingSimulator::generator_loop() {
+  // sessions are created by the workers; the clock starts once all are up.
+  while (!_stop && _ready_sessions + _failed_sessions < _config.num_sessions) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  if (_failed_sessions > 0) {
+    {
+      std::lock_guard<std::mutex> lock(_queue_mutex);
+      _generating = false;
+      _stop = true;
+    }
+    _queue_cv.notify_all();
+    return;
+  }
+
+  std::mt19937_64 rng(std::random_device{}());
+  std::exponential_distribution<double> inter_arrival(_config.qps);
+  const auto start = Clock::now();
+  {
+    std::lock_guard<std::mutex> lock(_stats_mutex);
+    _start_time = start;
+    _last_done = start;
+  }
+  const auto end = start + std::chrono::duration_cast<Clock::duration>(
+                               std::chrono::duration<double>(
+                                   _config.duration_s));
+
+  auto next = start;
+  while (!_stop && next < end) {
+    std::this_thread::sleep_until(next);
+    bool accepted = false;
+    {
+      std::lock_guard<std::mutex> lock(_queue_mutex);
+      if (static_cast<int>(_queue.size()) < _config.queue_capacity) {
+        // stamp with the scheduled time so generator jitter counts as queueing
+        _queue.push_back({next});
+        accepted = true;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(_stats_mutex);
+      ++_submitted;
+      if (!accepted) {
+        ++_rejected;
+      }
+    }
+    if (accepted) {
+      _queue_cv.notify_one();
+    }
+
+    const double gap_s = _config.arrival == ARRIVAL_PROCESS_POISSON
+                             ? inter_arrival(rng)
+                             : 1.0 / _config.qps;
+    next += std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(gap_s));
+  }
+  {
+    std::lock_guard<std::mutex> lock(_queue_mutex);
+    _generating = false;
+  }
+  _queue_cv.notify_all();
+}
+
+void ServingSimulator::worker_loop() {
+  sSessionConfig session_config;
+  session_config.intra_op_threads = _config.intra_op_threads;
+  session_config.inter_op_threads = 1;
+  InferenceSession session(_model_path, session_config);
+  if (!session.ok()) {
+    {
+      std::lock_guard<std::mutex> lock(_stats_mutex);
+      _error = session.error();
+    }
+    ++_failed_sessions;
+    --_active_workers;
+    return;
+  }
+  const bool batchable = session.dynamic_batch();
+  // warm up outside of the measured window
+  session.run(1);
+  ++_ready_sessions;
+
+  const auto window = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double, std::milli>(_config.batching_window_ms));
+
+  std::vector<sRequest> batch;
+  while (true) {
+    batch.clear();
+    {
+      std::unique_lock<std::mutex> lock(_queue_mutex);
+      _queue_cv.wait(lock,
+                     [&] { return _stop || !_queue.empty() || !_generating; });
+      if (_stop || (_queue.empty() && !_generating)) {
+        break;
+      }
+      // hold the first request for up to the batching window
+      const auto deadline = Clock::now() + window;
+      _queue_cv.wait_until(lock, deadline, [&] {
+        return _stop || !_generating ||
+               static_cast<int>(_queue.size()) >= _config.max_batch_size;
+      });
+      while (!_queue.empty() &&
+             static_cast<int>(batch.size()) < _config.max_batch_size) {
+        batch.push_back(_queue.front());
+        _queue.pop_front();
+      }
+    }
+    if (batch.empty()) {
+      continue;
+    }
+
+    const auto dispatch = Clock::now();
+    bool ok = true;
+    if (batchable) {
+      ok = session.run(static_cast<int>(batch.size()));
+    } else {
+      // fixed batch dim: the window still groups requests, but they run
+      // back to back on this session.
+      for (size_t i = 0; i < batch.size() && ok; ++i) {
+        ok = session.run(1);
+      }
+    }
+    const auto done = Clock::now();
+    const double compute_ms = ms_between(dispatch, done);
+
+    std::lock_guard<std::mutex> lock(_stats_mutex);
+    if (!ok) {
+      _error = session.error();
+      _stop = true;
+      _queue_cv.notify_all();
+      break;
+    }
+    _last_done = done;
+    for (const auto &request : batch) {
+      sServingSample sample;
+      sample.arrival_s =
+          std::chrono::duration<double>(request.arrival - _start_time).count();
+      sample.queue_ms = ms_between(request.arrival, dispatch);
+      sample.compute_ms = compute_ms;
+      sample.batch_size = static_cast<int>(batch.size());
+      _samples.push_back(sample);
+    }
+  }
+  --_active_workers;
+}
+
+sServingStats ServingSimulator::stats() const {
+  sServingStats stats;
+  {
+    std::lock_guard<std::mutex> lock(_queue_mutex);
+    stats.queue_depth = static_cast<int>(_queue.size());
+  }
+
+  std::vector<double> latencies;
+  {
+    std::lock_guard<std::mutex> lock(_stats_mutex);
+    stats.submitted = _submitted;
+    stats.rejected = _rejected;
+    stats.completed = _samples.size();
+    const auto until = running() ? Clock::now() : _last_done;
+    stats.elapsed_s =
+        std::chrono::duration<double>(until - _start_time).count();
+    latencies.reserve(_samples.size());
+    for (const auto &sample : _samples) {
+      stats.mean_queue_ms += sample.queue_ms;
+      stats.mean_compute_ms += sample.compute_ms;
+      stats.mean_batch_size += sample.batch_size;
+      latencies.push_back(sample.queue_ms + sample.compute_ms);
+    }
+  }
+  if (latencies.empty()) {
+    return stats;
+  }
+
+  const double n = static_cast<double>(latencies.size());
+  stats.mean_queue_ms /= n;
+  stats.mean_compute_ms /= n;
+  stats.mean_batch_size /= n;
+  if (stats.elapsed_s > 0.0) {
+    stats.throughput_qps = n / stats.elapsed_s;
+  }
+  stats.p50_ms = percentile(latencies, 0.50);
+  stats.p90_ms = percentile(latencies, 0.90);
+  stats.p99_ms = percentile(latencies, 0.99);
+  stats.max_ms = *std::max_element(latencies.begin(), latencies.end());
+  return stats;
+}
+
+size_t ServingSimulator::samples_since(size_t from,
+                                       std::vector<sServingSample> &out) const {
+  std::lock_guard<std::mutex> lock(_stats_mutex);
+  if (from < _samples.size()) {
+    out.insert(out.end(), _samples.begin() + from, _samples.end());
+  }
+  return _samples.size();
+}
+
+std::string ServingSimulator::error() const {
+  std::lock_guard<std::mutex> lock(_stats_mutex);
+  return _error;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum eArrivalProcess {
+  ARRIVAL_PROCESS_POISSON = 0,
+  ARRIVAL_PROCESS_FIXED,
+};
+
+struct sServingConfig {
+  eArrivalProcess arrival = ARRIVAL_PROCESS_POISSON;
+  // offered load in requests per second
+  double qps = 50.0;
+  // number of independent sessions serving the queue
+  int num_sessions = 2;
+  // intra-op threads per session. 0 lets onnxruntime decide
+  int intra_op_threads = 1;
+  // requests arriving at a full queue are rejected
+  int queue_capacity = 256;
+  // dynamic batching: a worker waits up to the window for a full batch
+  int max_batch_size = 8;
+  double batching_window_ms = 2.0;
+  double duration_s = 10.0;
+};
+
+// one served request
+struct sServingSample {
+  // seconds since the simulation started
+  double arrival_s = 0.0;
+  double queue_ms = 0.0;
+  double compute_ms = 0.0;
+  int batch_size = 1;
+};
+
+struct sServingStats {
+  size_t submitted = 0;
+  size_t completed = 0;
+  size_t rejected = 0;
+  int queue_depth = 0;
+  double elapsed_s = 0.0;
+  double throughput_qps = 0.0;
+  double mean_batch_size = 0.0;
+  double mean_queue_ms = 0.0;
+  double mean_compute_ms = 0.0;
+  // end-to-end latency percentiles (queue + compute)
+  double p50_ms = 0.0;
+  double p90_ms = 0.0;
+  double p99_ms = 0.0;
+  double max_ms = 0.0;
+};
+
+// Open-loop load generator driving N sessions of one model through a bounded
+// request queue with dynamic batching.
+class ServingSimulator {
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct sRequest {
+    Clock::time_point arrival;
+  };
+
+  sServingConfig _config;
+  std::string _model_path;
+  // written by worker threads, guarded by _stats_mutex
+  std::string _error;
+
+  std::thread _generator;
+  std::vector<std::thread> _workers;
+  std::atomic<bool> _stop{false};
+  std::atomic<bool> _generating{false};
+  std::atomic<int> _active_workers{0};
+  std::atomic<int> _ready_sessions{0};
+  std::atomic<int> _failed_sessions{0};
+
+  mutable std::mutex _queue_mutex;
+  std::condition_variable _queue_cv;
+  std::deque<sRequest> _queue;
+
+  mutable std::mutex _stats_mutex;
+  Clock::time_point _start_time;
+  Clock::time_point _last_done;
+  std::vector<sServingSample> _samples;
+  size_t _submitted = 0;
+  size_t _rejected = 0;
+
+  void generator_loop();
+  void worker_loop();
+  void join();
+
+public:
+  ServingSimulator() = default;
+  ~ServingSimulator();
+  ServingSimulator(const ServingSimulator &) = delete;
+  ServingSimulator &operator=(const ServingSimulator &) = delete;
+
+  bool start(const std::string &model_path, const sServingConfig &config);
+  void stop();
+  bool running() const { return _active_workers.load() > 0; }
+  std::string error() const;
+
+  sServingStats stats() const;
+  // appends samples recorded after index `from`, returns the new end index
+  size_t samples_since(size_t from, std::vector<sServingSample> &out) const;
+};
@@ -0,0 +1,268 @@
+#include "session.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+Ort::Env &ort_env() {
+  static Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "mynn");
+  return env;
+}
+
+size_t ort_element_size(ONNXTensorElementDataType type) {
+  switch (type) {
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8:
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_BOOL:
+    return 1;
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT16:
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT16:
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_BFLOAT16:
+    return 2;
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT32:
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+    return 4;
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT64:
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64:
+  case ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE:
+    return 8;
+  default:
+    return 0;
+  }
+}
+
+namespace {
+
+Ort::SessionOptions make_session_options(const sSessionConfig &config) {
+  Ort::SessionOptions options;
+  if (config.intra_op_threads > 0) {
+    options.SetIntraOpNumThreads(config.intra_op_threads);
+  }
+  if (config.inter_op_threads > 0) {
+    options.SetInterOpNumThreads(config.inter_op_threads);
+  }
+  options.SetGraphOptimizationLevel(config.optimization_level);
+  if (!config.cpu_mem_arena) {
+    options.DisableCpuMemArena();
+  }
+  if (!config.mem_pattern) {
+    options.DisableMemPattern();
+  }
+  if (!config.optimized_model_path.empty()) {
+    options.SetOptimizedModelFilePath(config.optimized_model_path.c_str());
+    if (config.save_ort_format) {
+      options.AddConfigEntry("session.save_model_format", "ORT");
+    }
+  }
+  if (!config.profile_prefix.empty()) {
+    options.EnableProfiling(config.profile_prefix.c_str());
+  }
+  for (const auto &[key, value] : config.config_entries) {
+    options.AddConfigEntry(key.c_str(), value.c_str());
+  }
+  return options;
+}
+
+} // namespace
+
+InferenceSession::InferenceSession(const std::string &model_path,
+                                   const sSessionConfig &config) {
+  try {
+    auto options = make_session_options(config);
+    _session =
+        std::make_unique<Ort::Session>(ort_env(), model_path.c_str(), options);
+    read_signature();
+  } catch (const Ort::Exception &e) {
+    _error = e.what();
+    _session.reset();
+    std::cerr << "failed to create session for " << model_path << ": "
+              << _error << std::endl;
+  }
+}
+
+InferenceSession::InferenceSession(const void *model_data, size_t model_size,
+                                   const sSessionConfig &config) {
+  try {
+    auto options = make_session_options(config);
+    _session = std::make_unique<Ort::Session>(ort_env(), model_data,
+                                              model_size, options);
+    read_signature();
+  } catch (const Ort::Exception &e) {
+    _error = e.what();
+    _session.reset();
+    std::cerr << "failed to create session from memory: " << _error
+              << std::endl;
+  }
+}
+
+void InferenceSession::read_signature() {
+  Ort::AllocatorWithDefaultOptions allocator;
+  for (size_t i = 0; i < _session->GetInputCount(); ++i) {
+    _input_names.emplace_back(
+        _session->GetInputNameAllocated(i, allocator).get());
+    auto type_info = _session->GetInputTypeInfo(i);
+    auto tensor_info = type_info.GetTensorTypeAndShapeInfo();
+    _input_shapes.push_back(tensor_info.GetShape());
+    _input_types.push_back(tensor_info.GetElementType());
+  }
+  for (size_t i = 0; i < _session->GetOutputCount(); ++i) {
+    _output_names.emplace_back(
+        _session->GetOutputNameAllocated(i, allocator).get());
+  }
+}
+
+bool InferenceSession::dynamic_batch() const {
+  if (_input_shapes.empty()) {
+    return false;
+  }
+  for (const auto &shape : _input_shapes) {
+    if (shape.empty() || shape[0] > 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::map<std::string, int64_t> InferenceSession::allocator_stats() {
+  std::map<std::string, int64_t> stats;
+  if (!_session) {
+    return stats;
+  }
+  const OrtApi &api = Ort::GetApi();
+  OrtKeyValuePairs *pairs = nullptr;
+  try {
+    auto memory_info =
+        Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    Ort::Allocator allocator(*_session, memory_info);
+    Ort::ThrowOnError(api.AllocatorGetStats(allocator, &pairs));
+  } catch (const Ort::Exception &) {
+    // only arena allocators keep statistics
+    return stats;
+  }
+  const char *const *keys = nullptr;
+  const char *const *values = nullptr;
+  size_t count = 0;
+  api.GetKeyValuePairs(pairs, &keys, &values, &count);
+  for (size_t i = 0; i < count; ++i) {
+    stats[keys[i]] = std::strtoll(values[i], nullptr, 10);
+  }
+  api.ReleaseKeyValuePairs(pairs);
+  return stats;
+}
+
+std::string InferenceSession::end_profiling() {
+  if (!_session) {
+    return {};
+  }
+  try {
+    Ort::AllocatorWithDefaultOptions allocator;
+    return _session->EndProfilingAllocated(allocator).get();
+  } catch (const Ort::Exception &e) {
+    _error = e.what();
+    return {};
+  }
+}
+
+bool InferenceSession::prepare_inputs(int batch_size) {
+  if (_buffer_batch == batch_size && !_input_values.empty()) {
+    return true;
+  }
+  _input_values.clear();
+  _input_buffers.clear();
+  _input_buffers.resize(_input_names.size());
+
+  auto memory_info =
+      Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+
+  for (size_t i = 0; i < _input_names.size(); ++i) {
+    const size_t element_size = ort_element_size(_input_types[i]);
+    if (element_size == 0) {
+      _error = "unsupported input type for " + _input_names[i];
+      return false;
+    }
+    std::vector<int64_t> shape = _input_shapes[i];
+    size_t count = 1;
+    for (size_t d = 0; d < shape.size(); ++d) {
+      // symbolic dims: leading one is the batch, the rest default to 1
+      if (shape[d] <= 0) {
+        shape[d] = d == 0 ? batch_size : 1;
+      }
+      count *= static_cast<size_t>(shape[d]);
+    }
+
+    auto &buffer = _input_buffers[i];
+    buffer.assign(count * element_size, 0);
+    if (_input_types[i] == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT) {
+      auto *values = reinterpret_cast<float *>(buffer.data());
+      for (size_t k = 0; k < count; ++k) {
+        values[k] = dist(rng);
+      }
+    }
+    // integer inputs are usually indices or masks, zeros are always valid.
+
+    _input_values.push_back(Ort::Value::CreateTensor(
+        memory_info, buffer.data(), buffer.size(), shape.data(), shape.size(),
+        _input_types[i]));
+  }
+  _buffer_batch = batch_size;
+  return true;
+}
+
+const std::vector<Ort::Value> &
+InferenceSession::synthetic_inputs(int batch_size) {
+  try {
+    if (!prepare_inputs(batch_size)) {
+      _input_values.clear();
+    }
+  } catch (const Ort::Exception &e) {
+    _error = e.what();
+    _input_values.clear();
+  }
+  return _input_values;
+}
+
+bool InferenceSession::run(int batch_size, std::vector<Ort::Value> *outputs) {
+  if (!_session) {
+    return false;
+  }
+  try {
+    if (!prepare_inputs(batch_size)) {
+      return false;
+    }
+  } catch (const Ort::Exception &e) {
+    _error = e.what();
+    return false;
+  }
+  return run(_input_values, outputs);
+}
+
+bool InferenceSession::run(const std::vector<Ort::Value> &inputs,
+                           std::vector<Ort::Value> *outputs) {
+  if (!_session) {
+    return false;
+  }
+  try {
+    std::vector<const char *> input_names;
+    std::vector<const char *> output_names;
+    for (const auto &name : _input_names) {
+      input_names.push_back(name.c_str());
+    }
+    for (const auto &name : _output_names) {
+      output_names.push_back(name.c_str());
+    }
+    auto values = _session->Run(Ort::RunOptions{nullptr}, input_names.data(),
+                                inputs.data(), inputs.size(),
+                                output_names.data(), output_names.size());
+    if (outputs) {
+      *outputs = std::move(values);
+    }
+  } catch (const Ort::Exception &e) {
+    _error = e.what();
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <onnxruntime_cxx_api.h>
+
+// process wide onnxruntime environment. onnxruntime expects a single env.
+Ort::Env &ort_env();
+
+// size in bytes of one element of an onnxruntime tensor type. 0 if unknown.
+size_t ort_element_size(ONNXTensorElementDataType type);
+
+struct sSessionConfig {
+  // 0 lets onnxruntime decide
+  int intra_op_threads = 0;
+  int inter_op_threads = 0;
+  GraphOptimizationLevel optimization_level = ORT_ENABLE_ALL;
+  // BFC arena for the CPU allocator
+  bool cpu_mem_arena = true;
+  // reuse the allocation plan of previous runs with the same shapes
+  bool mem_pattern = true;
+  // if set, onnxruntime writes the optimized graph to this path
+  std::string optimized_model_path;
+  // write the optimized graph in ORT format instead of ONNX
+  bool save_ort_format = false;
+  // if set, onnxruntime profiling is on and traces go to <prefix>_<time>.json
+  std::string profile_prefix;
+  // extra onnxruntime session config entries, e.g. "session.*" keys
+  std::map<std::string, std::string> config_entries;
+};
+
+// Owns one Ort::Session and a set of synthetic inputs that match the model
+// input signature, so a model can be run without real data.
+class InferenceSession {
+private:
+  std::unique_ptr<Ort::Session> _session;
+  std::string _error;
+
+  std::vector<std::string> _input_names;
+  std::vector<std::string> _output_names;
+  std::vector<std::vector<int64_t>> _input_shapes;
+  std::vector<ONNXTensorElementDataType> _input_types;
+
+  // synthetic inputs, rebuilt when the requested batch size changes
+  int _buffer_batch = 0;
+  std::vector<std::vector<uint8_t>> _input_buffers;
+  std::vector<Ort::Value> _input_values;
+
+  bool prepare_inputs(int batch_size);
+  void read_signature();
+
+public:
+  InferenceSession(const std::string &model_path, const sSessionConfig &config);
+  // creates the session from a serialized model held in memory
+  InferenceSession(const void *model_data, size_t model_size,
+                   const sSessionConfig &config);
+  bool ok() const { return _session != nullptr; }
+  const std::string &error() const { return _error; }
+  // true if the leading dim of every input is symbolic, i.e. batchable
+  bool dynamic_batch() const;
+  const std::vector<std::string> &input_names() const { return _input_names; }
+  const std::vector<std::string> &output_names() const {
+    return _output_names;
+  }
+  // declared input shapes, symbolic dims as -1, and element types
+  const std::vector<std::vector<int64_t>> &input_shapes() const {
+    return _input_shapes;
+  }
+  const std::vector<ONNXTensorElementDataType> &input_types() const {
+    return _input_types;
+  }
+  // the synthetic inputs run() feeds for this batch size, in input_names()
+  // order. empty if they could not be built.
+  const std::vector<Ort::Value> &synthetic_inputs(int batch_size);
+  // statistics of the session's CPU arena allocator, e.g. "InUse",
+  // "MaxInUse", "NumAllocs". empty if the arena is disabled.
+  std::map<std::string, int64_t> allocator_stats();
+  // stops profiling and returns the trace file, empty if profiling was off
+  std::string end_profiling();
+  // runs the model once on synthetic inputs with the given batch size.
+  // outputs, if given, receive the values in output_names() order.
+  bool run(int batch_size = 1, std::vector<Ort::Value> *outputs = nullptr);
+  // runs the model on caller provided inputs in input_names() order
+  bool run(const std::vector<Ort::Value> &inputs,
+           std::vector<Ort::Value> *outputs = nullptr);
+};
@@ -0,0 +1,194 @@
+#include "startup.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <sstream>
+
+#include "session.h"
+#include "timing.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr const char *kCachedModel = "model.onnx";
+constexpr const char *kCachedWeights = "weights.bin";
+
+// onnxruntime profiler event names
+constexpr const char *kModelLoadEvent = "model_loading_uri";
+constexpr const char *kSessionInitEvent = "session_initialization";
+
+// Sums the duration of every event in an onnxruntime trace by name. Events
+// are flat objects like {"cat":"Session",...,"dur":123,...,"name":"x",...}.
+std::map<std::string, double> read_profile_events(const std::string &path) {
+  std::map<std::string, double> durations_ms;
+  std::ifstream input(path);
+  if (!input.is_open()) {
+    return durations_ms;
+  }
+  const std::string trace((std::istreambuf_iterator<char>(input)),
+                          std::istreambuf_iterator<char>());
+
+  size_t pos = 0;
+  while ((pos = trace.find("\"name\"", pos)) != std::string::npos) {
+    const size_t object_start = trace.rfind('{', pos);
+    const size_t value_start = trace.find('"', trace.find(':', pos));
+    const size_t value_end = trace.find('"', value_start + 1);
+    if (object_start == std::string::npos || value_start == std::string::npos ||
+        value_end == std::string::npos) {
+      break;
+    }
+    const std::string name =
+        trace.substr(value_start + 1, value_end - value_start - 1);
+    const size_t dur = trace.find("\"dur\"", object_start);
+    if (dur != std::string::npos && dur < pos) {
+      const size_t colon = trace.find(':', dur);
+      // durations are in microseconds
+      durations_ms[name] += std::strtod(trace.c_str() + colon + 1, nullptr) /
+                            1000.0;
+    }
+    pos = value_end + 1;
+  }
+  return durations_ms;
+}
+
+// creates a profiled session, runs it once and fills the generic phases.
+// session_init_ms receives the whole initialization phase.
+bool profiled_start(const std::string &model_path, sSessionConfig config,
+                    sStartupProfile &profile, double &session_init_ms) {
+  std::error_code ec;
+  const fs::path profile_dir = fs::temp_directory_path(ec) / "mynn" / "profile";
+  fs::create_directories(profile_dir, ec);
+  config.profile_prefix = (profile_dir / "startup").string();
+
+  Stopwatch watch;
+  InferenceSession session(model_path, config);
+  profile.create_ms = watch.elapsed_ms();
+  if (!session.ok()) {
+    profile.error = session.error();
+    return false;
+  }
+  watch.reset();
+  if (!session.run(1)) {
+    profile.error = session.error();
+    return false;
+  }
+  profile.first_run_ms = watch.elapsed_ms();
+
+  const std::string trace = session.end_profiling();
+  const auto events = read_profile_events(trace);
+  fs::remove(trace, ec);
+  if (auto it = events.find(kModelLoadEvent); it != events.end()) {
+    profile.model_load_ms = it->second;
+  }
+  session_init_ms = 0.0;
+  if (auto it = events.find(kSessionInitEvent); it != events.end()) {
+    session_init_ms = it->second;
+  }
+  return true;
+}
+
+} // namespace
+
+std::string StartupProfiler::cache_dir(const std::string &model_path) {
+  std::error_code ec;
+  const fs::path path = fs::absolute(model_path, ec);
+  const auto size = fs::file_size(path, ec);
+  const auto mtime = fs::last_write_time(path, ec).time_since_epoch().count();
+  const size_t key = std::hash<std::string>{}(
+      path.string() + ":" + std::to_string(size) + ":" + std::to_string(mtime));
+
+  std::ostringstream name;
+  name << path.stem().string() << "-" << std::hex << key;
+  return (fs::temp_directory_path(ec) / "mynn" / "cache" / name.str())
+      .string();
+}
+
+bool StartupProfiler::has_cache(const std::string &model_path) {
+  std::error_code ec;
+  return fs::exists(fs::path(cache_dir(model_path)) / kCachedModel, ec);
+}
+
+bool StartupProfiler::build_cache(const std::string &model_path,
+                                  std::string &error) {
+  std::error_code ec;
+  const fs::path dir = cache_dir(model_path);
+  fs::create_directories(dir, ec);
+  if (ec) {
+    error = "unable to create " + dir.string() + ": " + ec.message();
+    return false;
+  }
+
+  // the fully optimized graph, with weights (prepacked into the layout the
+  // CPU kernels want) moved to an external file next to it.
+  sSessionConfig config;
+  config.optimization_level = ORT_ENABLE_ALL;
+  config.optimized_model_path = (dir / kCachedModel).string();
+  config.config_entries = {
+      {"session.optimized_model_external_initializers_file_name",
+       kCachedWeights},
+      {"session.optimized_model_external_initializers_min_size_in_bytes",
+       "1024"},
+      {"session.save_external_prepacked_constant_initializers", "1"},
+  };
+  InferenceSession writer(model_path, config);
+  if (!writer.ok()) {
+    error = writer.error();
+    fs::remove_all(dir, ec);
+    return false;
+  }
+  return has_cache(model_path);
+}
+
+void StartupProfiler::clear_cache(const std::string &model_path) {
+  std::error_code ec;
+  fs::remove_all(cache_dir(model_path), ec);
+}
+
+sStartupProfile StartupProfiler::profile_cold(const std::string &model_path) {
+  sStartupProfile profile;
+  sSessionConfig config;
+  config.optimization_level = ORT_ENABLE_ALL;
+  double init_all_ms = 0.0;
+  if (!profiled_start(model_path, config, profile, init_all_ms)) {
+    return profile;
+  }
+
+  // onnxruntime does not trace the optimizer on its own; initialization
+  // with optimizations disabled isolates the kernel setup part.
+  sStartupProfile baseline;
+  config.optimization_level = ORT_DISABLE_ALL;
+  double init_disabled_ms = 0.0;
+  if (!profiled_start(model_path, config, baseline, init_disabled_ms)) {
+    profile.error = baseline.error;
+    return profile;
+  }
+  profile.graph_optimization_ms = std::max(0.0, init_all_ms - init_disabled_ms);
+  profile.kernel_init_ms = init_all_ms - profile.graph_optimization_ms;
+  profile.ok = true;
+  return profile;
+}
+
+sStartupProfile StartupProfiler::profile_warm(const std::string &model_path) {
+  sStartupProfile profile;
+  if (!has_cache(model_path) && !build_cache(model_path, profile.error)) {
+    return profile;
+  }
+  sSessionConfig config;
+  // already optimized, running the transformers again would only cost time
+  config.optimization_level = ORT_DISABLE_ALL;
+  const std::string cached =
+      (fs::path(cache_dir(model_path)) / kCachedModel).string();
+  double init_ms = 0.0;
+  if (!profiled_start(cached, config, profile, init_ms)) {
+    return profile;
+  }
+  profile.kernel_init_ms = init_ms;
+  profile.ok = true;
+  return profile;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+// Wall clock breakdown of getting a session to its first result.
+struct sStartupProfile {
+  bool ok = false;
+  std::string error;
+  // Ort::Session constructor, end to end
+  double create_ms = 0.0;
+  // reading and parsing the model
+  double model_load_ms = 0.0;
+  // graph transformers; 0 when loading a pre-optimized model
+  double graph_optimization_ms = 0.0;
+  // partitioning, kernel creation, weight prepacking, memory planning
+  double kernel_init_ms = 0.0;
+  double first_run_ms = 0.0;
+};
+
+// Measures session startup phases and maintains an on-disk warm-start cache
+// holding the fully optimized model with prepacked weights.
+class StartupProfiler {
+public:
+  // directory of the warm-start cache for a model, keyed by path, size and
+  // modification time so an edited model never hits a stale entry
+  static std::string cache_dir(const std::string &model_path);
+  static bool has_cache(const std::string &model_path);
+  static bool build_cache(const std::string &model_path, std::string &error);
+  static void clear_cache(const std::string &model_path);
+
+  // startup from the original model with all optimizations
+  static sStartupProfile profile_cold(const std::string &model_path);
+  // startup from the cache, built first if missing
+  static sStartupProfile profile_warm(const std::string &model_path);
+};
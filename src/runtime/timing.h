@@ -0,0 +1,31 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+// wall clock stopwatch, started on construction
+class Stopwatch {
+private:
+  std::chrono::steady_clock::time_point _start;
+
+public:
+  Stopwatch() : _start(std::chrono::steady_clock::now()) {}
+  void reset() { _start = std::chrono::steady_clock::now(); }
+  double elapsed_ms() const {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - _start)
+        .count();
+  }
+};
+
+// q-th quantile (0..1) by nearest rank. reorders `values`.
+inline double percentile(std::vector<double> &values, double q) {
+  if (values.empty()) {
+    return 0.0;
+  }
+  const size_t rank = std::min(
+      values.size() - 1, static_cast<size_t>(q * (values.size() - 1) + 0.5));
+  std::nth_element(values.begin(), values.begin() + rank, values.end());
+  return values[rank];
+}
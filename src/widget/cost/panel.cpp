@@ -0,0 +1,277 @@
+#include "panel.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <imgui.h>
+#include <implot.h>
+
+namespace {
+
+constexpr double kMiB = 1024.0 * 1024.0;
+constexpr double kGiga = 1e9;
+
+void aggregate_row(const sCostAggregate &aggregate) {
+  ImGui::TableNextRow();
+  ImGui::TableNextColumn();
+  ImGui::TextUnformatted(aggregate.name.c_str());
+  ImGui::TableNextColumn();
+  ImGui::Text("%d", aggregate.node_count);
+  ImGui::TableNextColumn();
+  ImGui::Text("%.3f", aggregate.flops / kGiga);
+  ImGui::TableNextColumn();
+  ImGui::Text("%.2f", aggregate.param_bytes / kMiB);
+  ImGui::TableNextColumn();
+  ImGui::Text("%.2f", (aggregate.read_bytes + aggregate.write_bytes) / kMiB);
+  ImGui::TableNextColumn();
+  ImGui::Text("%.2f", aggregate.arithmetic_intensity());
+}
+
+void aggregate_table(const char *id, std::vector<const sCostAggregate *> rows) {
+  std::sort(rows.begin(), rows.end(),
+            [](const sCostAggregate *a, const sCostAggregate *b) {
+              return a->flops > b->flops;
+            });
+  if (!ImGui::BeginTable(id, 6,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                             ImGuiTableFlags_ScrollY |
+                             ImGuiTableFlags_Resizable,
+                         ImVec2(0, 220))) {
+    return;
+  }
+  ImGui::TableSetupScrollFreeze(0, 1);
+  ImGui::TableSetupColumn("Name");
+  ImGui::TableSetupColumn("Nodes");
+  ImGui::TableSetupColumn("GFLOP");
+  ImGui::TableSetupColumn("Params MiB");
+  ImGui::TableSetupColumn("Act. MiB");
+  ImGui::TableSetupColumn("FLOP/B");
+  ImGui::TableHeadersRow();
+  for (const auto *row : rows) {
+    aggregate_row(*row);
+  }
+  ImGui::EndTable();
+}
+
+} // namespace
+
+void CostPanel::draw(ModelViewer &viewer) {
+  const auto *inspector = viewer.inspector();
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  const auto &graph = inspector->graph();
+
+  bool changed = m_model_path != inspector->model_path() ||
+                 m_revision != inspector->revision();
+  changed |= ImGui::SliderInt("Batch size", &m_batch_size, 1, 256);
+  changed |= ImGui::SliderInt("Scope depth", &m_scope_depth, 1, 6);
+  if (changed || !m_analyzed) {
+    m_model_path = inspector->model_path();
+    m_revision = inspector->revision();
+    analyze(graph);
+  }
+  ImGui::InputFloat("Peak GFLOP/s", &m_peak_gflops, 10.f, 100.f, "%.0f");
+  ImGui::InputFloat("Bandwidth GB/s", &m_bandwidth_gbs, 1.f, 10.f, "%.0f");
+  m_peak_gflops = std::max(m_peak_gflops, 1.f);
+  m_bandwidth_gbs = std::max(m_bandwidth_gbs, 1.f);
+
+  draw_totals(graph, viewer);
+  draw_roofline(graph, viewer);
+  draw_tables();
+}
+
+void CostPanel::analyze(const sModelGraph &graph) {
+  // repeated blocks are estimated once and copied to every instance
+  m_blocks = detect_repeated_blocks(graph);
+  m_report = estimate_cost(graph, m_batch_size, m_blocks.representative);
+  m_scopes = aggregate_by_scope(graph, m_report, m_scope_depth);
+  m_block_costs.clear();
+  for (const auto &block : m_blocks.blocks) {
+    std::vector<int> nodes;
+    for (const auto &instance : block.instances) {
+      nodes.insert(nodes.end(), instance.begin(), instance.end());
+    }
+    m_block_costs.push_back(aggregate_nodes(
+        m_report, nodes,
+        block.label + " \xc3\x97" + std::to_string(block.repeats())));
+  }
+  m_analyzed = true;
+}
+
+bool CostPanel::compute_bound(const sNodeCost &cost) const {
+  // right of the ridge point the compute roof is the lower one
+  return cost.arithmetic_intensity() >= m_peak_gflops / m_bandwidth_gbs;
+}
+
+void CostPanel::draw_totals(const sModelGraph &graph, ModelViewer &viewer) {
+  const auto &total = m_report.total;
+  ImGui::Text("%.3f GFLOP (%.3f GMAC), %.2f MiB params, %.2f MiB activations",
+              total.flops / kGiga, total.macs / kGiga,
+              total.param_bytes / kMiB,
+              (total.read_bytes + total.write_bytes) / kMiB);
+  // roofline lower bound on latency: every node at its attainable rate
+  double bound_ms = 0.0;
+  for (const auto &cost : m_report.nodes) {
+    bound_ms += 1e3 * std::max(cost.flops / (m_peak_gflops * kGiga),
+                               cost.total_bytes() / (m_bandwidth_gbs * kGiga));
+  }
+  ImGui::Text("Roofline latency bound: %.3f ms", bound_ms);
+  if (m_report.unsized_nodes > 0) {
+    ImGui::TextDisabled("%d nodes have unknown shapes and are undercounted.",
+                        m_report.unsized_nodes);
+  }
+
+  // aggregate over the nodes selected in the graph viewer
+  std::vector<int> selected;
+  for (const auto *node : viewer.selected_nodes()) {
+    selected.push_back(static_cast<int>(node - graph.nodes.data()));
+  }
+  if (!selected.empty()) {
+    const auto subgraph = aggregate_nodes(m_report, selected, "selection");
+    ImGui::Text("Selection: %d nodes, %.3f GFLOP, %.2f MiB moved, "
+                "%.2f FLOP/B",
+                subgraph.node_count, subgraph.flops / kGiga,
+                subgraph.total_bytes() / kMiB,
+                subgraph.arithmetic_intensity());
+  }
+
+  if (ImGui::Button("Highlight compute-bound")) {
+    std::vector<int> nodes;
+    for (const auto &cost : m_report.nodes) {
+      if (cost.flops > 0.0 && compute_bound(cost)) {
+        nodes.push_back(cost.node);
+      }
+    }
+    viewer.highlight_nodes(nodes);
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Highlight memory-bound")) {
+    std::vector<int> nodes;
+    for (const auto &cost : m_report.nodes) {
+      if (cost.total_bytes() > 0 && !compute_bound(cost)) {
+        nodes.push_back(cost.node);
+      }
+    }
+    viewer.highlight_nodes(nodes);
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Clear highlight")) {
+    viewer.highlight_nodes({});
+  }
+}
+
+void CostPanel::draw_roofline(const sModelGraph &graph, ModelViewer &viewer) {
+  // nodes sit on the roof at their intensity: the best they could attain
+  std::vector<double> memory_xs, memory_ys, compute_xs, compute_ys;
+  std::vector<int> memory_nodes, compute_nodes;
+  for (const auto &cost : m_report.nodes) {
+    if (cost.flops <= 0.0 || cost.total_bytes() <= 0) {
+      continue;
+    }
+    const double intensity = cost.arithmetic_intensity();
+    const double attainable =
+        std::min<double>(m_peak_gflops, intensity * m_bandwidth_gbs);
+    if (compute_bound(cost)) {
+      compute_xs.push_back(intensity);
+      compute_ys.push_back(attainable);
+      compute_nodes.push_back(cost.node);
+    } else {
+      memory_xs.push_back(intensity);
+      memory_ys.push_back(attainable);
+      memory_nodes.push_back(cost.node);
+    }
+  }
+  std::vector<double> scope_xs, scope_ys;
+  for (const auto &scope : m_scopes) {
+    if (scope.flops > 0.0 && scope.total_bytes() > 0) {
+      const double intensity = scope.arithmetic_intensity();
+      scope_xs.push_back(intensity);
+      scope_ys.push_back(
+          std::min<double>(m_peak_gflops, intensity * m_bandwidth_gbs));
+    }
+  }
+
+  const double ridge = m_peak_gflops / m_bandwidth_gbs;
+  const double roof_xs[] = {1e-3, ridge, 1e4};
+  const double roof_ys[] = {1e-3 * m_bandwidth_gbs, m_peak_gflops,
+                            m_peak_gflops};
+
+  if (!ImPlot::BeginPlot("Roofline", ImVec2(-1, 320))) {
+    return;
+  }
+  ImPlot::SetupAxes("FLOP/byte", "GFLOP/s");
+  ImPlot::SetupAxisScale(ImAxis_X1, ImPlotScale_Log10);
+  ImPlot::SetupAxisScale(ImAxis_Y1, ImPlotScale_Log10);
+  ImPlot::SetupAxesLimits(1e-2, 1e3, 1e-1, m_peak_gflops * 2.0);
+  ImPlot::PlotLine("roof", roof_xs, roof_ys, 3);
+  ImPlot::PlotScatter("memory-bound", memory_xs.data(), memory_ys.data(),
+                      static_cast<int>(memory_xs.size()));
+  ImPlot::PlotScatter("compute-bound", compute_xs.data(), compute_ys.data(),
+                      static_cast<int>(compute_xs.size()));
+  ImPlot::SetNextMarkerStyle(ImPlotMarker_Diamond, 6.f);
+  ImPlot::PlotScatter("scopes", scope_xs.data(), scope_ys.data(),
+                      static_cast<int>(scope_xs.size()));
+
+  // tooltip and click-to-highlight for the node closest to the mouse
+  if (ImPlot::IsPlotHovered()) {
+    const ImVec2 mouse = ImGui::GetMousePos();
+    int closest = -1;
+    float closest_distance = 8.f * 8.f;
+    auto search = [&](const std::vector<double> &xs,
+                      const std::vector<double> &ys,
+                      const std::vector<int> &nodes) {
+      for (size_t i = 0; i < xs.size(); ++i) {
+        const ImVec2 point = ImPlot::PlotToPixels(xs[i], ys[i]);
+        const float dx = point.x - mouse.x;
+        const float dy = point.y - mouse.y;
+        if (dx * dx + dy * dy < closest_distance) {
+          closest_distance = dx * dx + dy * dy;
+          closest = nodes[i];
+        }
+      }
+    };
+    search(memory_xs, memory_ys, memory_nodes);
+    search(compute_xs, compute_ys, compute_nodes);
+    if (closest >= 0) {
+      const auto &cost = m_report.nodes[closest];
+      const auto &node = graph.nodes[closest];
+      ImGui::SetTooltip("%s (%s)\n%.4f GFLOP, %.3f MiB, %.2f FLOP/B",
+                        node.name.c_str(), node.op_type.c_str(),
+                        cost.flops / kGiga, cost.total_bytes() / kMiB,
+                        cost.arithmetic_intensity());
+      if (ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
+        viewer.highlight_nodes({closest});
+      }
+    }
+  }
+  ImPlot::EndPlot();
+}
+
+void CostPanel::draw_tables() {
+  if (ImGui::CollapsingHeader("By op type", ImGuiTreeNodeFlags_DefaultOpen)) {
+    std::vector<const sCostAggregate *> rows;
+    for (const auto &[op_type, aggregate] : m_report.by_op_type) {
+      rows.push_back(&aggregate);
+    }
+    aggregate_table("cost_by_op", rows);
+  }
+  if (ImGui::CollapsingHeader("By scope")) {
+    std::vector<const sCostAggregate *> rows;
+    for (const auto &scope : m_scopes) {
+      rows.push_back(&scope);
+    }
+    aggregate_table("cost_by_scope", rows);
+  }
+  if (ImGui::CollapsingHeader("By repeated block")) {
+    ImGui::Text("%zu blocks, %d unique, cover %d of %zu nodes",
+                m_blocks.blocks.size(), m_blocks.unique_blocks,
+                m_blocks.covered_nodes, m_report.nodes.size());
+    std::vector<const sCostAggregate *> rows;
+    for (const auto &block : m_block_costs) {
+      rows.push_back(&block);
+    }
+    aggregate_table("cost_by_block", rows);
+  }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../../model/cost_model.h"
+#include "../../model/repeated_blocks.h"
+#include "../model_viewer/viewer.h"
+
+// Static FLOP and memory traffic estimates with a roofline overlay.
+class CostPanel {
+public:
+  void draw(ModelViewer &viewer);
+
+private:
+  void analyze(const sModelGraph &graph);
+  void draw_totals(const sModelGraph &graph, ModelViewer &viewer);
+  void draw_roofline(const sModelGraph &graph, ModelViewer &viewer);
+  void draw_tables();
+  bool compute_bound(const sNodeCost &cost) const;
+
+  std::string m_model_path;
+  uint64_t m_revision = 0;
+  int m_batch_size = 1;
+  int m_scope_depth = 2;
+  // machine roofs; defaults are a few-core desktop CPU
+  float m_peak_gflops = 200.f;
+  float m_bandwidth_gbs = 40.f;
+  sCostReport m_report;
+  std::vector<sCostAggregate> m_scopes;
+  sBlockPlan m_blocks;
+  // one row per repeated block, all instances summed
+  std::vector<sCostAggregate> m_block_costs;
+  bool m_analyzed = false;
+};
@@ -0,0 +1,214 @@
+#include "panel.h"
+
+#include <chrono>
+#include <vector>
+
+#include <imgui.h>
+
+#include "../../engine/thread_pool.h"
+#include "../../model/graph_utils.h"
+#include "../../model/shape_inference.h"
+
+namespace {
+
+constexpr double kMiB = 1024.0 * 1024.0;
+
+} // namespace
+
+void WeightDedupPanel::draw(ModelViewer &viewer) {
+  const auto *inspector = viewer.inspector();
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  if (m_pending.valid() && m_pending.wait_for(std::chrono::seconds(0)) ==
+                               std::future_status::ready) {
+    m_report = m_pending.get();
+    m_has_report = true;
+    m_selected = -1;
+  }
+  if (m_sharing.valid() && m_sharing.wait_for(std::chrono::seconds(0)) ==
+                               std::future_status::ready) {
+    m_share = m_sharing.get();
+    m_has_share = true;
+  }
+  if (!m_pending.valid() && m_model_path != inspector->model_path()) {
+    m_has_report = false;
+    m_has_share = false;
+    start(*inspector);
+  }
+
+  const bool busy = m_pending.valid();
+  ImGui::BeginDisabled(busy);
+  ImGui::SliderFloat("Near tolerance", &m_near_tolerance, 0.f, 1e-2f, "%.4f",
+                     ImGuiSliderFlags_Logarithmic);
+  ImGui::SameLine();
+  if (ImGui::Button("Analyze")) {
+    start(*inspector);
+  }
+  ImGui::EndDisabled();
+  if (busy) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted("running...");
+    return;
+  }
+  if (!m_has_report) {
+    return;
+  }
+  if (!m_report.ok) {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s",
+                       m_report.error.c_str());
+    return;
+  }
+  draw_summary();
+  if (ImGui::CollapsingHeader("Share duplicates")) {
+    draw_sharing(*inspector);
+  }
+  draw_groups(inspector->graph(), viewer);
+}
+
+void WeightDedupPanel::start(const ModelInspector &inspector) {
+  m_model_path = inspector.model_path();
+  sDedupConfig config;
+  config.near_tolerance = m_near_tolerance;
+  m_pending = ThreadPool::shared().submit(
+      TASK_PRIORITY_BACKGROUND, [path = inspector.model_path(),
+                                 graph = inspector.graph(), config] {
+        return analyze_weight_dedup(path, graph, config);
+      });
+}
+
+void WeightDedupPanel::draw_summary() {
+  const auto &r = m_report;
+  ImGui::Text("%d initializers, %.2f MiB, scanned in %.1f ms",
+              r.initializers, r.total_bytes / kMiB, r.elapsed_ms);
+  ImGui::Text("Reclaimable: %.2f MiB exact, %.2f MiB more near duplicates",
+              r.exact_reclaimable / kMiB, r.near_reclaimable / kMiB);
+  if (!ImGui::BeginTable("dedup_formats", 4,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    return;
+  }
+  ImGui::TableSetupColumn("Weights");
+  ImGui::TableSetupColumn("MiB");
+  ImGui::TableSetupColumn("Compressed");
+  ImGui::TableSetupColumn("Shuffled + compressed");
+  ImGui::TableHeadersRow();
+  for (int f = 0; f < WEIGHT_FORMAT_COUNT; ++f) {
+    const auto &estimate = r.formats[f];
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(weight_format_name(static_cast<eWeightFormat>(f)));
+    ImGui::TableNextColumn();
+    ImGui::Text("%.2f", estimate.bytes / kMiB);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.2f", estimate.entropy_bytes / kMiB);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.2f", estimate.shuffled_bytes / kMiB);
+  }
+  ImGui::EndTable();
+  ImGui::TextDisabled("Compressed sizes are order-0 entropy bounds; "
+                      "duplicates are counted once per copy.");
+}
+
+void WeightDedupPanel::draw_groups(const sModelGraph &graph,
+                                   ModelViewer &viewer) {
+  if (!ImGui::BeginTable("dedup_groups", 5,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                             ImGuiTableFlags_ScrollY |
+                             ImGuiTableFlags_Resizable,
+                         ImVec2(0, -1))) {
+    return;
+  }
+  ImGui::TableSetupScrollFreeze(0, 1);
+  ImGui::TableSetupColumn("Tensor");
+  ImGui::TableSetupColumn("Shape");
+  ImGui::TableSetupColumn("Copies");
+  ImGui::TableSetupColumn("Reclaimable MiB");
+  ImGui::TableSetupColumn("Match");
+  ImGui::TableHeadersRow();
+  ImGuiListClipper clipper;
+  clipper.Begin(static_cast<int>(m_report.groups.size()));
+  while (clipper.Step()) {
+    for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+      const auto &group = m_report.groups[i];
+      const auto &first = graph.tensors[group.tensors[0]];
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::PushID(i);
+      if (ImGui::Selectable(first.name.c_str(), m_selected == i,
+                            ImGuiSelectableFlags_SpanAllColumns)) {
+        m_selected = m_selected == i ? -1 : i;
+        // the nodes reading any tensor of the group
+        std::vector<int> nodes;
+        if (m_selected >= 0) {
+          const auto consumers = tensor_consumers(graph);
+          for (int t : group.tensors) {
+            nodes.insert(nodes.end(), consumers[t].begin(),
+                         consumers[t].end());
+          }
+        }
+        viewer.highlight_nodes(nodes);
+      }
+      if (ImGui::IsItemHovered()) {
+        ImGui::BeginTooltip();
+        for (int t : group.tensors) {
+          ImGui::TextUnformatted(graph.tensors[t].name.c_str());
+        }
+        ImGui::EndTooltip();
+      }
+      ImGui::PopID();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(shape_to_string(graph, first).c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%zu", group.tensors.size());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", group.reclaimable() / kMiB);
+      ImGui::TableNextColumn();
+      if (group.exact) {
+        ImGui::TextUnformatted("exact");
+      } else {
+        ImGui::Text("within %.2g", group.max_relative_diff);
+      }
+    }
+  }
+  ImGui::EndTable();
+}
+
+void WeightDedupPanel::draw_sharing(const ModelInspector &inspector) {
+  const bool busy = m_sharing.valid();
+  ImGui::BeginDisabled(busy);
+  ImGui::Checkbox("Share near duplicates too", &m_share_near);
+  ImGui::InputText("Output", m_output_path, sizeof(m_output_path));
+  if (ImGui::Button("Write shared model")) {
+    std::vector<sDuplicateGroup> groups;
+    for (const auto &group : m_report.groups) {
+      if (group.exact || m_share_near) {
+        groups.push_back(group);
+      }
+    }
+    m_sharing = ThreadPool::shared().submit(
+        TASK_PRIORITY_BACKGROUND,
+        [path = inspector.model_path(), graph = inspector.graph(),
+         groups = std::move(groups), output = std::string(m_output_path)] {
+          return share_duplicates(path, graph, groups, output);
+        });
+  }
+  ImGui::EndDisabled();
+  if (busy) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted("running...");
+    return;
+  }
+  if (!m_has_share) {
+    return;
+  }
+  if (!m_share.ok) {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s",
+                       m_share.error.c_str());
+    return;
+  }
+  ImGui::TextWrapped("Wrote %s", m_share.output_path.c_str());
+  ImGui::Text("%d initializers removed, file %.2f MiB -> %.2f MiB",
+              m_share.removed_initializers, m_share.bytes_before / kMiB,
+              m_share.bytes_after / kMiB);
+}
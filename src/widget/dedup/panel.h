@@ -0,0 +1,33 @@
+#pragma once
+
+#include <future>
+#include <string>
+
+#include "../../model/weight_dedup.h"
+#include "../model_viewer/viewer.h"
+
+// Duplicate and near-duplicate initializers, the weight size under smaller
+// formats and compression, and the model rewritten to share duplicates.
+class WeightDedupPanel {
+public:
+  void draw(ModelViewer &viewer);
+
+private:
+  void start(const ModelInspector &inspector);
+  void draw_summary();
+  void draw_groups(const sModelGraph &graph, ModelViewer &viewer);
+  void draw_sharing(const ModelInspector &inspector);
+
+  std::string m_model_path;
+  float m_near_tolerance = 1e-3f;
+  sDedupReport m_report;
+  bool m_has_report = false;
+  std::future<sDedupReport> m_pending;
+  int m_selected = -1;
+
+  bool m_share_near = false;
+  char m_output_path[512] = {};
+  sShareResult m_share;
+  bool m_has_share = false;
+  std::future<sShareResult> m_sharing;
+};
@@ -0,0 +1,172 @@
+#include "panel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+
+#include <imgui.h>
+#include <implot.h>
+
+#include "../../engine/thread_pool.h"
+
+namespace {
+
+constexpr double kMiB = 1024.0 * 1024.0;
+
+} // namespace
+
+void EnginePanel::draw(const ModelInspector *inspector) {
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  if (m_pending.valid() && m_pending.wait_for(std::chrono::seconds(0)) ==
+                               std::future_status::ready) {
+    m_result = m_pending.get();
+    m_has_result = true;
+  }
+
+  const bool busy = m_pending.valid();
+  ImGui::BeginDisabled(busy);
+  ImGui::SliderInt("Batch size", &m_batch_size, 1, 64);
+  ImGui::SliderInt("Iterations", &m_iterations, 1, 200);
+  const char *strategies[] = {"Greedy by size", "Interval coloring"};
+  ImGui::Combo("Arena plan", &m_strategy, strategies,
+               IM_ARRAYSIZE(strategies));
+  ImGui::SliderInt("Threads", &m_threads, 0, 64, m_threads == 0 ? "all" : "%d");
+  const char *precisions[] = {"fp32", "bf16"};
+  ImGui::Combo("GEMM precision", &m_precision, precisions,
+               IM_ARRAYSIZE(precisions));
+  // auto is the blocked layout of the detected ISA
+  const char *layouts[] = {"auto", "nchw", "nhwc", "nchwc8", "nchwc16"};
+  ImGui::Combo("Conv layout", &m_layout, layouts, IM_ARRAYSIZE(layouts));
+  ImGui::Checkbox("Reference kernels", &m_reference_kernels);
+  ImGui::SameLine();
+  ImGui::Checkbox("Fuse operators", &m_fuse);
+  if (ImGui::Button("Run engine and onnxruntime")) {
+    sExecutorConfig config;
+    config.batch_size = m_batch_size;
+    config.memory_plan = static_cast<eMemoryPlanStrategy>(m_strategy);
+    config.reference_kernels = m_reference_kernels;
+    config.threads = m_threads;
+    config.fuse = m_fuse;
+    config.gemm_precision = static_cast<eGemmPrecision>(m_precision);
+    if (m_layout > 0) {
+      config.conv_layout = static_cast<eTensorLayout>(m_layout - 1);
+    }
+    m_pending = ThreadPool::shared().submit(
+        TASK_PRIORITY_BACKGROUND,
+        [path = inspector->model_path(), graph = inspector->graph(), config,
+         iterations = m_iterations] {
+          return EngineComparison::run(path, graph, config, iterations);
+        });
+  }
+  ImGui::EndDisabled();
+  if (busy) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted("running...");
+  }
+  if (m_has_result) {
+    draw_result();
+  }
+}
+
+void EnginePanel::draw_result() {
+  const auto &r = m_result;
+  if (!r.ok) {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s", r.error.c_str());
+    return;
+  }
+  ImGui::Text("Outputs compared: %d, max |diff| %.3g", r.compared_outputs,
+              r.max_abs_diff);
+  ImGui::Text("Prepare %.1f ms, arena %.2f MiB, weights %.2f MiB "
+              "(+%.2f MiB packed), %s",
+              r.prepare_ms, r.arena_bytes / kMiB, r.weight_bytes / kMiB,
+              r.packed_bytes / kMiB, r.simd_isa.c_str());
+  if (r.fused_groups > 0) {
+    ImGui::Text("%d nodes fused into %d steps", r.fused_nodes,
+                r.fused_groups);
+  }
+  ImGui::Text("Conv layout %s, %d reorders taking %.3f ms (%.1f%%)",
+              r.conv_layout.c_str(), r.reorders, r.reorder_ms,
+              r.engine_mean_ms > 0.0
+                  ? 100.0 * r.reorder_ms / r.engine_mean_ms
+                  : 0.0);
+  if (ImGui::BeginTable("engine_latency", 3,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("");
+    ImGui::TableSetupColumn("Mean ms");
+    ImGui::TableSetupColumn("p50 ms");
+    ImGui::TableHeadersRow();
+    auto row = [](const char *label, double mean, double p50) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(label);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", mean);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", p50);
+    };
+    row("Native engine", r.engine_mean_ms, r.engine_p50_ms);
+    row("onnxruntime", r.ort_mean_ms, r.ort_p50_ms);
+    ImGui::EndTable();
+  }
+
+  // time per op type, most expensive first
+  std::map<std::string, double> by_op;
+  for (const auto &step : r.steps) {
+    by_op[step.op_type] += step.ms;
+  }
+  std::vector<std::pair<std::string, double>> ops(by_op.begin(), by_op.end());
+  std::sort(ops.begin(), ops.end(),
+            [](const auto &a, const auto &b) { return a.second > b.second; });
+  std::vector<const char *> labels;
+  std::vector<double> values;
+  for (const auto &[op_type, ms] : ops) {
+    labels.push_back(op_type.c_str());
+    values.push_back(ms);
+  }
+  if (!ops.empty() && ImPlot::BeginPlot("Time per op type", ImVec2(-1, 220))) {
+    ImPlot::SetupAxes(nullptr, "ms", ImPlotAxisFlags_AutoFit,
+                      ImPlotAxisFlags_AutoFit);
+    ImPlot::SetupAxisTicks(ImAxis_X1, 0, static_cast<double>(ops.size() - 1),
+                           static_cast<int>(ops.size()), labels.data());
+    ImPlot::PlotBars("ms", values.data(), static_cast<int>(values.size()));
+    ImPlot::EndPlot();
+  }
+
+  if (!ImGui::CollapsingHeader("Steps")) {
+    return;
+  }
+  if (ImGui::BeginTable("engine_steps", 5,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_ScrollY,
+                        ImVec2(0, 260))) {
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Node");
+    ImGui::TableSetupColumn("Op");
+    ImGui::TableSetupColumn("Kernel");
+    ImGui::TableSetupColumn("Layout");
+    ImGui::TableSetupColumn("ms");
+    ImGui::TableHeadersRow();
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(r.steps.size()));
+    while (clipper.Step()) {
+      for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+        const auto &step = r.steps[i];
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(step.node_name.c_str());
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(step.op_type.c_str());
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(step.kernel.c_str());
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(step.layout.c_str());
+        ImGui::TableNextColumn();
+        ImGui::Text("%.4f", step.ms);
+      }
+    }
+    ImGui::EndTable();
+  }
+}
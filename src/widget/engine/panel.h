@@ -0,0 +1,29 @@
+#pragma once
+
+#include <future>
+
+#include "../../model/inspector.h"
+#include "../../runtime/engine_compare.h"
+
+// Native engine run against onnxruntime: output agreement and latency.
+class EnginePanel {
+public:
+  void draw(const ModelInspector *inspector);
+
+private:
+  void draw_result();
+
+  int m_batch_size = 1;
+  int m_iterations = 20;
+  int m_strategy = MEMORY_PLAN_GREEDY_BY_SIZE;
+  bool m_reference_kernels = false;
+  bool m_fuse = true;
+  // 0 uses every hardware thread
+  int m_threads = 0;
+  int m_precision = GEMM_FP32;
+  // 0 for the native layout, otherwise eTensorLayout + 1
+  int m_layout = 0;
+  sEngineComparison m_result;
+  bool m_has_result = false;
+  std::future<sEngineComparison> m_pending;
+};
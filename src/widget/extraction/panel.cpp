@@ -0,0 +1,110 @@
+#include "panel.h"
+
+#include <chrono>
+
+#include <imgui.h>
+
+#include "../../engine/thread_pool.h"
+#include "../../model/tensor_utils.h"
+
+namespace {
+
+constexpr double kMiB = 1024.0 * 1024.0;
+
+void boundary_table(const char *id, const char *label,
+                    const std::vector<sBoundaryTensor> &tensors) {
+  if (!ImGui::BeginTable(id, 3,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    return;
+  }
+  ImGui::TableSetupColumn(label);
+  ImGui::TableSetupColumn("Type");
+  ImGui::TableSetupColumn("Shape");
+  ImGui::TableHeadersRow();
+  for (const auto &tensor : tensors) {
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(tensor.name.c_str());
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(model_dtype_name(tensor.dtype));
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(tensor.shape.c_str());
+  }
+  ImGui::EndTable();
+}
+
+} // namespace
+
+void ExtractionPanel::draw(ModelViewer &viewer) {
+  const auto *inspector = viewer.inspector();
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  if (m_pending.valid() && m_pending.wait_for(std::chrono::seconds(0)) ==
+                               std::future_status::ready) {
+    m_result = m_pending.get();
+    m_has_result = true;
+  }
+
+  const auto &graph = inspector->graph();
+  std::vector<int> selected;
+  for (const auto *node : viewer.selected_nodes()) {
+    selected.push_back(static_cast<int>(node - graph.nodes.data()));
+  }
+  ImGui::Text("%zu nodes selected in the viewer", selected.size());
+
+  const bool busy = m_pending.valid();
+  ImGui::BeginDisabled(busy);
+  ImGui::InputText("Output", m_output_path, sizeof(m_output_path));
+  ImGui::SliderInt("Iterations", &m_iterations, 1, 500);
+  ImGui::SliderInt("Batch size", &m_batch_size, 1, 256);
+  ImGui::BeginDisabled(selected.empty());
+  if (ImGui::Button("Extract and benchmark")) {
+    sExtractionConfig config;
+    config.output_path = m_output_path;
+    config.iterations = m_iterations;
+    config.batch_size = m_batch_size;
+    m_nodes = selected;
+    m_pending = ThreadPool::shared().submit(
+        TASK_PRIORITY_BACKGROUND,
+        [path = inspector->model_path(), graph, selected, config] {
+          return SubgraphExtractor::run(path, graph, selected, config);
+        });
+  }
+  ImGui::EndDisabled();
+  ImGui::EndDisabled();
+  if (busy) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted("running...");
+  }
+  if (m_has_result) {
+    draw_result(viewer);
+  }
+}
+
+void ExtractionPanel::draw_result(ModelViewer &viewer) {
+  const auto &r = m_result;
+  if (!r.ok) {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s", r.error.c_str());
+    return;
+  }
+  ImGui::TextWrapped("Wrote %s", r.output_path.c_str());
+  ImGui::Text("%d nodes, %d constants carried over, %d initializers "
+              "(%.2f MiB)",
+              r.nodes, r.constants, r.initializers,
+              r.initializer_bytes / kMiB);
+  ImGui::Text("Session %.1f ms, first run %.3f ms", r.create_ms,
+              r.first_run_ms);
+  ImGui::Text("Latency: mean %.3f ms, p50 %.3f ms, p90 %.3f ms", r.mean_ms,
+              r.p50_ms, r.p90_ms);
+  if (ImGui::Button("Highlight extracted")) {
+    viewer.highlight_nodes(m_nodes);
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Clear highlight")) {
+    viewer.highlight_nodes({});
+  }
+  boundary_table("extraction_inputs", "Input", r.inputs);
+  boundary_table("extraction_outputs", "Output", r.outputs);
+}
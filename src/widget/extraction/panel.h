@@ -0,0 +1,27 @@
+#pragma once
+
+#include <future>
+#include <vector>
+
+#include "../../runtime/extraction.h"
+#include "../model_viewer/viewer.h"
+
+// Extracts the nodes selected in the viewer as a standalone ONNX model and
+// benchmarks it in isolation.
+class ExtractionPanel {
+public:
+  void draw(ModelViewer &viewer);
+
+private:
+  void draw_result(ModelViewer &viewer);
+
+  // empty for <model>.subgraph.onnx
+  char m_output_path[512] = {};
+  int m_iterations = 50;
+  int m_batch_size = 1;
+  // nodes of the last extraction, highlighted on request
+  std::vector<int> m_nodes;
+  sExtractionResult m_result;
+  bool m_has_result = false;
+  std::future<sExtractionResult> m_pending;
+};
@@ -0,0 +1,142 @@
+#include "panel.h"
+
+#include <chrono>
+#include <vector>
+
+#include <imgui.h>
+
+#include "../../engine/thread_pool.h"
+
+namespace {
+
+constexpr double kKiB = 1024.0;
+
+} // namespace
+
+void ConstantFoldingPanel::draw(ModelViewer &viewer) {
+  const auto *inspector = viewer.inspector();
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  if (m_folding.valid() && m_folding.wait_for(std::chrono::seconds(0)) ==
+                               std::future_status::ready) {
+    m_result = m_folding.get();
+    m_has_result = true;
+  }
+  // planning only walks the graph, so it runs on every change
+  if (m_model_path != inspector->model_path() ||
+      m_revision != inspector->revision()) {
+    if (m_model_path != inspector->model_path()) {
+      m_has_result = false;
+    }
+    m_model_path = inspector->model_path();
+    m_revision = inspector->revision();
+    m_plan = plan_constant_folding(inspector->declared_graph());
+  }
+
+  draw_plan(inspector->declared_graph(), viewer);
+
+  const bool busy = m_folding.valid();
+  const bool nothing = m_plan.folded_nodes == 0 && m_plan.dead_nodes == 0 &&
+                       m_plan.unused_initializers.empty();
+  ImGui::BeginDisabled(busy || nothing);
+  ImGui::InputText("Output", m_output_path, sizeof(m_output_path));
+  if (ImGui::Button("Fold and compare")) {
+    m_folding = ThreadPool::shared().submit(
+        TASK_PRIORITY_BACKGROUND,
+        [path = inspector->model_path(),
+         graph = inspector->declared_graph(),
+         output = std::string(m_output_path)] {
+          return ConstantFolder::run(path, graph, output);
+        });
+  }
+  ImGui::EndDisabled();
+  if (busy) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted("running...");
+    return;
+  }
+  if (m_has_result) {
+    draw_result();
+  }
+}
+
+void ConstantFoldingPanel::draw_plan(const sModelGraph &graph,
+                                     ModelViewer &viewer) {
+  const auto &plan = m_plan;
+  ImGui::Text("%zu nodes: %d fold into constants, %d are dead",
+              graph.nodes.size(), plan.folded_nodes, plan.dead_nodes);
+  ImGui::Text("%zu new initializers, %zu unused ones dropped (planned in "
+              "%.2f ms)",
+              plan.materialized.size(), plan.unused_initializers.size(),
+              plan.elapsed_ms);
+  ImGui::TextDisabled("Shape, Size and ops on constants fold; nodes whose "
+                      "constants are float16 stay.");
+  ImGui::TextDisabled("Shapes fold as the model declares them; input shapes "
+                      "set in the Shapes panel are not baked in.");
+  std::vector<int> removed;
+  for (size_t n = 0; n < plan.fates.size(); ++n) {
+    if (plan.fates[n] != NODE_KEPT) {
+      removed.push_back(static_cast<int>(n));
+    }
+  }
+  if (ImGui::Button("Highlight removed")) {
+    viewer.highlight_nodes(removed);
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Clear highlight")) {
+    viewer.highlight_nodes({});
+  }
+}
+
+void ConstantFoldingPanel::draw_result() {
+  const auto &r = m_result;
+  if (!r.ok) {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s", r.error.c_str());
+    return;
+  }
+  const auto &f = r.folding;
+  ImGui::TextWrapped("Wrote %s in %.1f ms", f.output_path.c_str(),
+                     f.elapsed_ms);
+  ImGui::Text("Nodes %d -> %d (%d folded, %d dead)", f.nodes_before,
+              f.nodes_after, f.folded_nodes, f.dead_nodes);
+  ImGui::Text("Initializers +%d -%d, file %.1f KiB -> %.1f KiB",
+              f.initializers_added, f.initializers_removed,
+              f.bytes_before / kKiB, f.bytes_after / kKiB);
+  if (!ImGui::BeginTable("folding_startup", 3,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    return;
+  }
+  ImGui::TableSetupColumn("ms");
+  ImGui::TableSetupColumn("Original");
+  ImGui::TableSetupColumn("Folded");
+  ImGui::TableHeadersRow();
+  const struct {
+    const char *label;
+    double before;
+    double after;
+  } rows[] = {
+      {"Open here", r.open_ms_before, r.open_ms_after},
+      {"Session create", r.startup_before.create_ms,
+       r.startup_after.create_ms},
+      {"Model load", r.startup_before.model_load_ms,
+       r.startup_after.model_load_ms},
+      {"Graph optimization", r.startup_before.graph_optimization_ms,
+       r.startup_after.graph_optimization_ms},
+      {"First run", r.startup_before.first_run_ms,
+       r.startup_after.first_run_ms},
+  };
+  for (const auto &row : rows) {
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(row.label);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.2f", row.before);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.2f", row.after);
+  }
+  ImGui::EndTable();
+  ImGui::Text("%d float outputs compared, max abs diff %.3g",
+              r.outputs_compared, r.max_abs_diff);
+}
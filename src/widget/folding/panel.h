@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <string>
+
+#include "../../model/constant_folding.h"
+#include "../../runtime/folding.h"
+#include "../model_viewer/viewer.h"
+
+// Nodes constant folding and dead node elimination would remove, planned
+// again whenever the model or its shapes change, and the folded model
+// written and compared with the original.
+class ConstantFoldingPanel {
+public:
+  void draw(ModelViewer &viewer);
+
+private:
+  void draw_plan(const sModelGraph &graph, ModelViewer &viewer);
+  void draw_result();
+
+  std::string m_model_path;
+  uint64_t m_revision = 0;
+  sFoldingPlan m_plan;
+
+  char m_output_path[512] = {};
+  sFoldingComparison m_result;
+  bool m_has_result = false;
+  std::future<sFoldingComparison> m_folding;
+};
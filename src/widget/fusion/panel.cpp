@@ -0,0 +1,103 @@
+#include "panel.h"
+
+#include <vector>
+
+#include <imgui.h>
+
+namespace {
+
+constexpr double kKiB = 1024.0;
+constexpr double kMiB = 1024.0 * 1024.0;
+
+} // namespace
+
+void FusionPanel::draw(ModelViewer &viewer) {
+  const auto *inspector = viewer.inspector();
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  const auto &graph = inspector->graph();
+
+  bool changed = m_model_path != inspector->model_path() ||
+                 m_revision != inspector->revision();
+  changed |= ImGui::SliderInt("Batch size", &m_batch_size, 1, 256);
+  if (changed || !m_analyzed) {
+    m_model_path = inspector->model_path();
+    m_revision = inspector->revision();
+    m_plan = plan_fusion(graph, m_batch_size);
+    m_selected = -1;
+    m_analyzed = true;
+  }
+
+  draw_summary();
+  draw_groups(graph, viewer);
+}
+
+void FusionPanel::draw_summary() {
+  int per_kind[3] = {};
+  for (const auto &group : m_plan.groups) {
+    ++per_kind[group.kind];
+  }
+  ImGui::Text("%zu groups, %d nodes fused, %.2f MiB of intermediates "
+              "never materialized",
+              m_plan.groups.size(), m_plan.fused_nodes,
+              m_plan.elided_bytes / kMiB);
+  ImGui::Text("%d conv epilogues, %d gemm epilogues, %d elementwise chains",
+              per_kind[FUSION_CONV_EPILOGUE], per_kind[FUSION_GEMM_EPILOGUE],
+              per_kind[FUSION_ELEMENTWISE_CHAIN]);
+}
+
+void FusionPanel::draw_groups(const sModelGraph &graph, ModelViewer &viewer) {
+  if (ImGui::Button("Highlight all fused nodes")) {
+    std::vector<int> nodes;
+    for (const auto &group : m_plan.groups) {
+      nodes.insert(nodes.end(), group.nodes.begin(), group.nodes.end());
+    }
+    viewer.highlight_nodes(nodes);
+    m_selected = -1;
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Clear highlight")) {
+    viewer.highlight_nodes({});
+    m_selected = -1;
+  }
+
+  if (!ImGui::BeginTable("fusion_groups", 4,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                             ImGuiTableFlags_ScrollY,
+                         ImVec2(0, -1))) {
+    return;
+  }
+  ImGui::TableSetupScrollFreeze(0, 1);
+  ImGui::TableSetupColumn("Kind");
+  ImGui::TableSetupColumn("Ops");
+  ImGui::TableSetupColumn("Nodes");
+  ImGui::TableSetupColumn("Elided KiB");
+  ImGui::TableHeadersRow();
+  for (int i = 0; i < static_cast<int>(m_plan.groups.size()); ++i) {
+    const auto &group = m_plan.groups[i];
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::PushID(i);
+    // selecting a group shows exactly its members in the viewer
+    if (ImGui::Selectable(fusion_kind_name(group.kind), m_selected == i,
+                          ImGuiSelectableFlags_SpanAllColumns)) {
+      m_selected = m_selected == i ? -1 : i;
+      viewer.highlight_nodes(m_selected >= 0 ? group.nodes
+                                             : std::vector<int>{});
+    }
+    ImGui::PopID();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(group.label.c_str());
+    ImGui::TableNextColumn();
+    std::string names;
+    for (int node : group.nodes) {
+      names += (names.empty() ? "" : ", ") + graph.nodes[node].name;
+    }
+    ImGui::TextUnformatted(names.c_str());
+    ImGui::TableNextColumn();
+    ImGui::Text("%.1f", group.elided_bytes / kKiB);
+  }
+  ImGui::EndTable();
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "../../model/fusion.h"
+#include "../model_viewer/viewer.h"
+
+// Operator groups the native engine fuses, highlighted in the viewer.
+class FusionPanel {
+public:
+  void draw(ModelViewer &viewer);
+
+private:
+  void draw_summary();
+  void draw_groups(const sModelGraph &graph, ModelViewer &viewer);
+
+  std::string m_model_path;
+  uint64_t m_revision = 0;
+  int m_batch_size = 1;
+  sFusionPlan m_plan;
+  bool m_analyzed = false;
+  // group shown in the viewer, -1 for none
+  int m_selected = -1;
+};
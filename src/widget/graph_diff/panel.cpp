@@ -0,0 +1,210 @@
+#include "panel.h"
+
+#include <chrono>
+
+#include <imgui.h>
+
+#include "../../engine/thread_pool.h"
+
+namespace {
+
+const ImVec4 kError(1.f, 0.4f, 0.4f, 1.f);
+
+ImU32 status_color(eNodeDiffStatus status) {
+  switch (status) {
+  case NODE_DIFF_ADDED:
+    return IM_COL32(40, 140, 60, 90);
+  case NODE_DIFF_REMOVED:
+    return IM_COL32(170, 50, 50, 90);
+  case NODE_DIFF_MODIFIED:
+    return IM_COL32(190, 140, 30, 90);
+  case NODE_DIFF_UNCHANGED:
+  default:
+    return 0;
+  }
+}
+
+// unnamed nodes show their op type and index
+std::string node_label(const sModelGraph &graph, int node) {
+  if (node < 0) {
+    return "";
+  }
+  const auto &n = graph.nodes[node];
+  if (!n.name.empty()) {
+    return n.name + " (" + n.op_type + ")";
+  }
+  return n.op_type + " #" + std::to_string(node);
+}
+
+std::string change_summary(const sNodeDiff &row) {
+  std::string summary;
+  auto add = [&](const std::string &part) {
+    summary += (summary.empty() ? "" : ", ") + part;
+  };
+  if (row.renamed) {
+    add("renamed");
+  }
+  if (row.rewired) {
+    add("rewired");
+  }
+  if (!row.attributes.empty()) {
+    add(std::to_string(row.attributes.size()) + " attributes");
+  }
+  if (!row.shapes.empty()) {
+    add(std::to_string(row.shapes.size()) + " shapes");
+  }
+  return summary.empty() ? node_diff_status_name(row.status) : summary;
+}
+
+const char *or_absent(const std::string &value) {
+  return value.empty() ? "-" : value.c_str();
+}
+
+} // namespace
+
+void GraphDiffPanel::draw(const ModelInspector *inspector) {
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  if (m_pending.valid() && m_pending.wait_for(std::chrono::seconds(0)) ==
+                               std::future_status::ready) {
+    m_result = m_pending.get();
+    m_has_result = true;
+    m_selected = -1;
+    m_visible.clear();
+  }
+
+  const bool busy = m_pending.valid();
+  ImGui::BeginDisabled(busy);
+  ImGui::InputText("Compare with", m_other_path, sizeof(m_other_path));
+  if (ImGui::Button("Compare") && m_other_path[0] != '\0') {
+    m_pending = ThreadPool::shared().submit(
+        TASK_PRIORITY_BACKGROUND,
+        [graph = inspector->graph(), other = std::string(m_other_path)] {
+          sComparison comparison;
+          comparison.before = graph;
+          comparison.after_path = other;
+          ModelInspector after(other);
+          if (after.graph().nodes.empty()) {
+            comparison.error = "could not load " + other;
+            return comparison;
+          }
+          comparison.after = after.graph();
+          comparison.diff = diff_graphs(comparison.before, comparison.after);
+          return comparison;
+        });
+  }
+  ImGui::EndDisabled();
+  if (busy) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted("running...");
+  }
+  if (m_has_result) {
+    draw_result();
+  }
+}
+
+void GraphDiffPanel::draw_result() {
+  const auto &r = m_result;
+  if (!r.error.empty()) {
+    ImGui::TextColored(kError, "%s", r.error.c_str());
+    return;
+  }
+  const auto &diff = r.diff;
+  ImGui::TextWrapped("Against %s", r.after_path.c_str());
+  ImGui::Text("%d unchanged, %d modified, %d added, %d removed in %.1f ms",
+              diff.unchanged, diff.modified, diff.added, diff.removed,
+              diff.diff_ms);
+  ImGui::Text("Aligned by name %d, structure %d, neighbours %d, position %d",
+              diff.matched_by[NODE_MATCH_NAME],
+              diff.matched_by[NODE_MATCH_STRUCTURE],
+              diff.matched_by[NODE_MATCH_NEIGHBOURS],
+              diff.matched_by[NODE_MATCH_POSITION]);
+  for (const auto &change : diff.io_changes) {
+    ImGui::TextColored(kError, "Graph %s %s: %s -> %s",
+                       change.output ? "output" : "input",
+                       change.tensor.c_str(), or_absent(change.before),
+                       or_absent(change.after));
+  }
+
+  if (ImGui::Checkbox("Show unchanged", &m_show_unchanged)) {
+    m_visible.clear();
+    m_selected = -1;
+  }
+  if (m_visible.empty()) {
+    for (int i = 0; i < static_cast<int>(diff.rows.size()); ++i) {
+      if (m_show_unchanged || diff.rows[i].status != NODE_DIFF_UNCHANGED) {
+        m_visible.push_back(i);
+      }
+    }
+  }
+
+  if (ImGui::BeginTable("graph_diff_rows", 3,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY |
+                            ImGuiTableFlags_Resizable,
+                        ImVec2(0, 320))) {
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Before");
+    ImGui::TableSetupColumn("After");
+    ImGui::TableSetupColumn("Changes");
+    ImGui::TableHeadersRow();
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(m_visible.size()));
+    while (clipper.Step()) {
+      for (int v = clipper.DisplayStart; v < clipper.DisplayEnd; ++v) {
+        const int i = m_visible[v];
+        const auto &row = diff.rows[i];
+        ImGui::TableNextRow();
+        if (const ImU32 color = status_color(row.status)) {
+          ImGui::TableSetBgColor(ImGuiTableBgTarget_RowBg0, color);
+        }
+        ImGui::TableNextColumn();
+        ImGui::PushID(i);
+        const auto before = node_label(r.before, row.before);
+        if (ImGui::Selectable(before.empty() ? "-" : before.c_str(),
+                              m_selected == i,
+                              ImGuiSelectableFlags_SpanAllColumns)) {
+          m_selected = m_selected == i ? -1 : i;
+        }
+        ImGui::PopID();
+        ImGui::TableNextColumn();
+        const auto after = node_label(r.after, row.after);
+        ImGui::TextUnformatted(after.empty() ? "-" : after.c_str());
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(change_summary(row).c_str());
+      }
+    }
+    ImGui::EndTable();
+  }
+  if (m_selected >= 0) {
+    draw_details(diff.rows[m_selected]);
+  }
+}
+
+void GraphDiffPanel::draw_details(const sNodeDiff &row) {
+  ImGui::SeparatorText("Details");
+  ImGui::Text("Status: %s, aligned by %s", node_diff_status_name(row.status),
+              node_match_name(row.match));
+  if (row.before >= 0 && row.after >= 0) {
+    const auto &before = m_result.before.nodes[row.before];
+    const auto &after = m_result.after.nodes[row.after];
+    if (row.renamed) {
+      ImGui::Text("Renamed: %s -> %s", or_absent(before.name),
+                  or_absent(after.name));
+    }
+    if (row.rewired) {
+      ImGui::TextUnformatted("Inputs come from different nodes");
+    }
+  }
+  for (const auto &change : row.attributes) {
+    ImGui::BulletText("%s: %s -> %s", change.key.c_str(),
+                      or_absent(change.before), or_absent(change.after));
+  }
+  for (const auto &change : row.shapes) {
+    ImGui::BulletText("%s %d (%s): %s -> %s",
+                      change.output ? "output" : "input", change.slot,
+                      change.tensor.c_str(), or_absent(change.before),
+                      or_absent(change.after));
+  }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <future>
+#include <string>
+
+#include "../../model/graph_diff.h"
+#include "../../model/inspector.h"
+
+// Side by side structural diff of the loaded model against another version
+// of it.
+class GraphDiffPanel {
+public:
+  void draw(const ModelInspector *inspector);
+
+private:
+  // both graphs are kept so the rows stay valid if the model is reloaded
+  struct sComparison {
+    sModelGraph before;
+    sModelGraph after;
+    std::string after_path;
+    sGraphDiff diff;
+    std::string error;
+  };
+
+  void draw_result();
+  void draw_details(const sNodeDiff &row);
+
+  char m_other_path[512] = {};
+  bool m_show_unchanged = false;
+  // index into m_result.diff.rows, -1 for none
+  int m_selected = -1;
+  // rows passing the filter
+  std::vector<int> m_visible;
+  sComparison m_result;
+  bool m_has_result = false;
+  std::future<sComparison> m_pending;
+};
@@ -0,0 +1,150 @@
+#include "panel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include <imgui.h>
+#include <implot.h>
+
+#include "../../engine/thread_pool.h"
+
+namespace {
+
+constexpr double kMiB = 1024.0 * 1024.0;
+
+double to_mib(int64_t bytes) { return bytes / kMiB; }
+
+} // namespace
+
+void MemoryPanel::draw(const ModelInspector *inspector) {
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  if (m_pending.valid() && m_pending.wait_for(std::chrono::seconds(0)) ==
+                               std::future_status::ready) {
+    m_profile = m_pending.get();
+  }
+
+  const bool busy = m_pending.valid();
+  ImGui::BeginDisabled(busy);
+  ImGui::SliderInt("Iterations", &m_config.iterations, 1, 100);
+  ImGui::SliderInt("Batch size", &m_config.batch_size, 1, 64);
+  ImGui::Checkbox("CPU arena", &m_config.cpu_mem_arena);
+  ImGui::SameLine();
+  ImGui::Checkbox("Memory pattern", &m_config.mem_pattern);
+  if (ImGui::Button("Profile memory")) {
+    m_pending = ThreadPool::shared().submit(
+        TASK_PRIORITY_BACKGROUND,
+        [path = inspector->model_path(), graph = inspector->graph(),
+         config = m_config] {
+          return MemoryProfiler::profile(path, graph, config);
+        });
+  }
+  ImGui::EndDisabled();
+  if (busy) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted("running...");
+  }
+  if (!m_profile.error.empty()) {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s",
+                       m_profile.error.c_str());
+  }
+  if (!m_profile.ok) {
+    return;
+  }
+  ImGui::TextDisabled("RSS is process wide; close other tools for clean "
+                      "numbers.");
+  draw_breakdown();
+  draw_budget();
+  draw_plots();
+}
+
+void MemoryPanel::draw_breakdown() {
+  ImGui::Text("RSS before %.1f MiB, after create %.1f MiB, peak %.1f MiB",
+              to_mib(m_profile.rss_before), to_mib(m_profile.rss_after_create),
+              to_mib(m_profile.peak_rss));
+
+  if (ImGui::BeginTable("memory_breakdown", 3,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("");
+    ImGui::TableSetupColumn("Measured (MiB)");
+    ImGui::TableSetupColumn("Static estimate (MiB)");
+    ImGui::TableHeadersRow();
+    auto row = [](const char *label, int64_t measured, int64_t estimated) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(label);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", to_mib(measured));
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", to_mib(estimated));
+    };
+    const auto &measured = m_profile.measured;
+    const auto &estimated = m_profile.estimated;
+    row("Weights", measured.weights, estimated.weights);
+    row("Activations", measured.activations, estimated.activations);
+    row("Workspace", measured.workspace, estimated.workspace);
+    row("Total", measured.total(), estimated.total());
+    ImGui::EndTable();
+  }
+  ImGui::Text("Largest activation: %.2f MiB",
+              to_mib(m_profile.largest_activation));
+  if (m_profile.unsized_tensors > 0) {
+    ImGui::TextDisabled("%d activations have no static shape and are not "
+                        "in the estimate.",
+                        m_profile.unsized_tensors);
+  }
+
+  if (!m_profile.arena_stats.empty() && ImGui::TreeNode("Arena statistics")) {
+    for (const auto &[key, value] : m_profile.arena_stats) {
+      ImGui::Text("%s: %lld", key.c_str(), static_cast<long long>(value));
+    }
+    ImGui::TreePop();
+  }
+}
+
+void MemoryPanel::draw_budget() {
+  ImGui::SliderFloat("Node memory (GB)", &m_budget_gb, 1.f, 256.f, "%.0f");
+  const double budget = m_budget_gb * 1024.0 * 1024.0 * 1024.0;
+  const auto &measured = m_profile.measured;
+  // weights are per session; sessions in one process do not share them
+  const int64_t per_session =
+      std::max(measured.total(), m_profile.estimated.total());
+  if (per_session <= 0) {
+    return;
+  }
+  const int64_t sessions = static_cast<int64_t>(budget / per_session);
+  ImGui::Text("Per session (worst of measured and estimated): %.1f MiB",
+              to_mib(per_session));
+  if (sessions == 0) {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f),
+                       "Does not fit a %.0f GB node at batch %d.", m_budget_gb,
+                       m_config.batch_size);
+  } else {
+    ImGui::Text("Fits %lld sessions on a %.0f GB node at batch %d.",
+                static_cast<long long>(sessions), m_budget_gb,
+                m_config.batch_size);
+  }
+}
+
+void MemoryPanel::draw_plots() {
+  if (!m_profile.rss_mb.empty() &&
+      ImPlot::BeginPlot("RSS", ImVec2(-1, 200))) {
+    ImPlot::SetupAxes("ms", "MiB", ImPlotAxisFlags_AutoFit,
+                      ImPlotAxisFlags_AutoFit);
+    ImPlot::PlotLine("rss", m_profile.rss_time_ms.data(),
+                     m_profile.rss_mb.data(),
+                     static_cast<int>(m_profile.rss_mb.size()));
+    ImPlot::EndPlot();
+  }
+  if (!m_profile.allocs_per_run.empty() &&
+      ImPlot::BeginPlot("Arena allocations per run", ImVec2(-1, 160))) {
+    ImPlot::SetupAxes("run", "allocations", ImPlotAxisFlags_AutoFit,
+                      ImPlotAxisFlags_AutoFit);
+    ImPlot::PlotBars("allocs", m_profile.allocs_per_run.data(),
+                     static_cast<int>(m_profile.allocs_per_run.size()));
+    ImPlot::EndPlot();
+  }
+}
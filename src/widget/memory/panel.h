@@ -0,0 +1,23 @@
+#pragma once
+
+#include <future>
+
+#include "../../model/inspector.h"
+#include "../../runtime/memory.h"
+
+// Measured versus estimated memory footprint of inference runs.
+class MemoryPanel {
+public:
+  void draw(const ModelInspector *inspector);
+
+private:
+  void draw_breakdown();
+  void draw_budget();
+  void draw_plots();
+
+  sMemoryProfileConfig m_config;
+  // memory of one serving node, sessions are packed against this
+  float m_budget_gb = 16.f;
+  sMemoryProfile m_profile;
+  std::future<sMemoryProfile> m_pending;
+};
@@ -0,0 +1,183 @@
+#include "panel.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include <imgui.h>
+#include <implot.h>
+
+namespace {
+
+constexpr double kMiB = 1024.0 * 1024.0;
+
+constexpr const char *kStrategyNames[] = {"Greedy by size",
+                                          "Interval coloring"};
+
+} // namespace
+
+void MemoryPlanPanel::draw(ModelViewer &viewer) {
+  const auto *inspector = viewer.inspector();
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  const auto &graph = inspector->graph();
+
+  bool changed = m_model_path != inspector->model_path() ||
+                 m_revision != inspector->revision();
+  changed |= ImGui::SliderInt("Batch size", &m_batch_size, 1, 256);
+  changed |= ImGui::SliderInt("Alignment", &m_alignment, 1, 4096);
+  if (changed || !m_analyzed) {
+    m_model_path = inspector->model_path();
+    m_revision = inspector->revision();
+    analyze(graph);
+  }
+
+  draw_summary();
+  draw_live_bytes(graph, viewer);
+  draw_memory_map(graph);
+}
+
+void MemoryPlanPanel::analyze(const sModelGraph &graph) {
+  m_liveness = analyze_liveness(graph, m_batch_size);
+  m_plans[MEMORY_PLAN_GREEDY_BY_SIZE] =
+      plan_memory(m_liveness, MEMORY_PLAN_GREEDY_BY_SIZE, m_alignment);
+  m_plans[MEMORY_PLAN_INTERVAL_COLORING] =
+      plan_memory(m_liveness, MEMORY_PLAN_INTERVAL_COLORING, m_alignment);
+  m_analyzed = true;
+}
+
+void MemoryPlanPanel::draw_summary() {
+  if (!ImGui::BeginTable("memory_plan_summary", 3,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    return;
+  }
+  ImGui::TableSetupColumn("");
+  ImGui::TableSetupColumn("MiB");
+  ImGui::TableSetupColumn("vs naive");
+  ImGui::TableHeadersRow();
+  const double naive = static_cast<double>(m_liveness.naive_bytes);
+  auto row = [naive](const char *label, int64_t bytes) {
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(label);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.2f", bytes / kMiB);
+    ImGui::TableNextColumn();
+    if (naive > 0.0) {
+      ImGui::Text("%.1f%%", 100.0 * bytes / naive);
+    }
+  };
+  row("Naive sum of activations", m_liveness.naive_bytes);
+  row("Peak live (lower bound)", m_liveness.peak_bytes);
+  row("Arena, greedy by size",
+      m_plans[MEMORY_PLAN_GREEDY_BY_SIZE].arena_size);
+  row("Arena, interval coloring",
+      m_plans[MEMORY_PLAN_INTERVAL_COLORING].arena_size);
+  ImGui::EndTable();
+
+  ImGui::Text("%zu activations planned over %zu steps",
+              m_liveness.lifetimes.size(), m_liveness.schedule.size());
+  if (m_liveness.unsized_tensors > 0) {
+    ImGui::TextDisabled("%d activations have no static shape and are not "
+                        "planned.",
+                        m_liveness.unsized_tensors);
+  }
+}
+
+void MemoryPlanPanel::draw_live_bytes(const sModelGraph &graph,
+                                      ModelViewer &viewer) {
+  const int steps = static_cast<int>(m_liveness.live_bytes.size());
+  if (steps == 0) {
+    return;
+  }
+
+  if (ImGui::Button("Highlight peak nodes in viewer")) {
+    std::vector<int> nodes;
+    for (int step : m_liveness.peak_steps) {
+      nodes.push_back(m_liveness.schedule[step]);
+    }
+    viewer.highlight_nodes(nodes);
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Clear highlight")) {
+    viewer.highlight_nodes({});
+  }
+
+  std::vector<double> xs(steps);
+  std::vector<double> ys(steps);
+  for (int i = 0; i < steps; ++i) {
+    xs[i] = i;
+    ys[i] = m_liveness.live_bytes[i] / kMiB;
+  }
+  std::vector<double> peak_xs;
+  std::vector<double> peak_ys;
+  for (int step : m_liveness.peak_steps) {
+    peak_xs.push_back(step);
+    peak_ys.push_back(ys[step]);
+  }
+
+  if (ImPlot::BeginPlot("Live activations", ImVec2(-1, 200))) {
+    ImPlot::SetupAxes("schedule step", "MiB", ImPlotAxisFlags_AutoFit,
+                      ImPlotAxisFlags_AutoFit);
+    ImPlot::PlotStairs("live", xs.data(), ys.data(), steps);
+    ImPlot::PlotScatter("peak", peak_xs.data(), peak_ys.data(),
+                        static_cast<int>(peak_xs.size()));
+    ImPlot::EndPlot();
+  }
+
+  if (ImGui::TreeNode("Peak steps")) {
+    for (int step : m_liveness.peak_steps) {
+      const auto &node = graph.nodes[m_liveness.schedule[step]];
+      ImGui::Text("step %d: %s (%s)", step, node.name.c_str(),
+                  node.op_type.c_str());
+    }
+    ImGui::TreePop();
+  }
+}
+
+void MemoryPlanPanel::draw_memory_map(const sModelGraph &graph) {
+  ImGui::Combo("Plan", &m_strategy, kStrategyNames,
+               static_cast<int>(std::size(kStrategyNames)));
+  const auto &plan = m_plans[m_strategy];
+  if (plan.assignments.empty()) {
+    return;
+  }
+
+  // one rectangle per tensor: lifetime on x, arena offset range on y
+  if (!ImPlot::BeginPlot("Arena layout", ImVec2(-1, -1))) {
+    return;
+  }
+  ImPlot::SetupAxes("schedule step", "offset (MiB)");
+  ImPlot::SetupAxesLimits(0, static_cast<double>(m_liveness.schedule.size()),
+                          0, plan.arena_size / kMiB, ImPlotCond_Always);
+  ImPlot::PushPlotClipRect();
+  auto *draw_list = ImPlot::GetPlotDrawList();
+  const ImVec2 mouse = ImGui::GetMousePos();
+  const sTensorLifetime *hovered = nullptr;
+  for (size_t i = 0; i < plan.assignments.size(); ++i) {
+    const auto &tensor = plan.assignments[i];
+    const ImVec2 min = ImPlot::PlotToPixels(tensor.first, tensor.offset / kMiB);
+    const ImVec2 max = ImPlot::PlotToPixels(
+        tensor.last + 1, (tensor.offset + tensor.size) / kMiB);
+    const ImVec2 top_left(std::min(min.x, max.x), std::min(min.y, max.y));
+    const ImVec2 bottom_right(std::max(min.x, max.x), std::max(min.y, max.y));
+    const ImU32 color = ImGui::GetColorU32(
+        ImPlot::GetColormapColor(static_cast<int>(i)));
+    draw_list->AddRectFilled(top_left, bottom_right, color);
+    draw_list->AddRect(top_left, bottom_right, IM_COL32(0, 0, 0, 128));
+    if (mouse.x >= top_left.x && mouse.x <= bottom_right.x &&
+        mouse.y >= top_left.y && mouse.y <= bottom_right.y) {
+      hovered = &tensor;
+    }
+  }
+  ImPlot::PopPlotClipRect();
+  if (hovered && ImPlot::IsPlotHovered()) {
+    ImGui::SetTooltip("%s\n%.3f MiB at %.3f MiB\nsteps %d..%d",
+                      graph.tensors[hovered->tensor].name.c_str(),
+                      hovered->size / kMiB, hovered->offset / kMiB,
+                      hovered->first, hovered->last);
+  }
+  ImPlot::EndPlot();
+}
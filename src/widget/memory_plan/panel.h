@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "../../model/memory_planner.h"
+#include "../model_viewer/viewer.h"
+
+// Static activation liveness and arena planning, without running the model.
+class MemoryPlanPanel {
+public:
+  void draw(ModelViewer &viewer);
+
+private:
+  void analyze(const sModelGraph &graph);
+  void draw_summary();
+  void draw_live_bytes(const sModelGraph &graph, ModelViewer &viewer);
+  void draw_memory_map(const sModelGraph &graph);
+
+  std::string m_model_path;
+  uint64_t m_revision = 0;
+  int m_batch_size = 1;
+  int m_alignment = 64;
+  int m_strategy = MEMORY_PLAN_GREEDY_BY_SIZE;
+  sLivenessAnalysis m_liveness;
+  sMemoryPlan m_plans[2];
+  bool m_analyzed = false;
+};
@@ -47,12 +47,39 @@ void ShowTopMenu(TopMenuState &state) {
 
   if (ImGui::BeginMenu("Tools")) {
     ImGui::MenuItem("Graph Viewer", nullptr, &state.show_graph_viewer);
+    ImGui::MenuItem("Serving Simulator", nullptr,
+                    &state.show_serving_simulator);
+    ImGui::MenuItem("Tensor Inspector", nullptr,
+                    &state.show_tensor_inspector);
+    ImGui::MenuItem("Optimization Levels", nullptr,
+                    &state.show_optimization_levels);
+    ImGui::MenuItem("Startup Profiler", nullptr,
+                    &state.show_startup_profiler);
+    ImGui::MenuItem("Memory Profiler", nullptr, &state.show_memory_profiler);
+    ImGui::MenuItem("Memory Planner", nullptr, &state.show_memory_planner);
+    ImGui::MenuItem("Cost Model", nullptr, &state.show_cost_model);
+    ImGui::MenuItem("Shapes", nullptr, &state.show_shapes);
+    ImGui::MenuItem("Native Engine", nullptr, &state.show_engine);
+    ImGui::MenuItem("Operator Fusion", nullptr, &state.show_fusion);
+    ImGui::MenuItem("Quantization", nullptr, &state.show_quantization);
+    ImGui::MenuItem("Graph Diff", nullptr, &state.show_graph_diff);
+    ImGui::MenuItem("Graph Query", nullptr, &state.show_query);
+    ImGui::MenuItem("Subgraph Extraction", nullptr, &state.show_extraction);
+    ImGui::MenuItem("Weight Statistics", nullptr, &state.show_weight_stats);
+    ImGui::MenuItem("Sparsity & Pruning", nullptr, &state.show_sparsity);
+    ImGui::MenuItem("Constant Folding", nullptr,
+                    &state.show_constant_folding);
+    ImGui::MenuItem("Weight Deduplication", nullptr,
+                    &state.show_weight_dedup);
+    ImGui::MenuItem("Mixed Precision", nullptr, &state.show_mixed_precision);
     ImGui::EndMenu();
   }
 
   if (ImGui::BeginMenu("View")) {
     ImGui::MenuItem("Helper Window", nullptr, &state.show_helper_window);
     ImGui::MenuItem("Dear ImGui Demo", nullptr, &state.show_demo_window);
+    ImGui::MenuItem("Collapse Repeated Blocks", nullptr,
+                    &state.collapse_repeated_blocks);
     ImGui::EndMenu();
   }
 
@@ -4,6 +4,26 @@ struct TopMenuState {
   bool show_demo_window = true;
   bool show_graph_viewer = false;
   bool show_helper_window = true;
+  bool show_serving_simulator = false;
+  bool show_tensor_inspector = false;
+  bool show_optimization_levels = false;
+  bool show_startup_profiler = false;
+  bool show_memory_profiler = false;
+  bool show_memory_planner = false;
+  bool show_cost_model = false;
+  bool show_shapes = false;
+  bool show_engine = false;
+  bool show_fusion = false;
+  bool show_quantization = false;
+  bool show_graph_diff = false;
+  bool show_query = false;
+  bool show_extraction = false;
+  bool show_weight_stats = false;
+  bool show_sparsity = false;
+  bool show_constant_folding = false;
+  bool show_weight_dedup = false;
+  bool show_mixed_precision = false;
+  bool collapse_repeated_blocks = true;
 };
 
 void ShowTopMenu(TopMenuState &state);
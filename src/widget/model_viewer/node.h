@@ -5,7 +5,9 @@
 #include <string>
 #include <unordered_map>
 
+#include "../../model/repeated_blocks.h"
 #include "../../model/types.h"
+#include "../../model/weight_stats.h"
 
 // Renders a model graph node with its op type, parameters, and tensor pins.
 class ModelGraphNodeView : public ImFlow::BaseNode {
@@ -56,6 +58,7 @@ public:
 
     show_edge_list("Inputs", m_node->input_edges, "In");
     show_edge_list("Outputs", m_node->output_edges, "Out");
+    show_weight_stats();
 
     if (!m_node->attributes.empty()) {
       ImGui::Text("Attributes:");
@@ -69,6 +72,16 @@ public:
     }
   }
 
+  // draws the node in the highlight style, e.g. for analysis results
+  void set_highlight(bool highlight) {
+    setStyle(highlight ? ImFlow::NodeStyle::red() : ImFlow::NodeStyle::cyan());
+  }
+
+  // statistics of the weights read by the node, null for none
+  void set_weight_stats(const sWeightStatsReport *report) {
+    m_weight_stats = report;
+  }
+
   ImFlow::Pin *inputPin(const sModelTensor *tensor) const {
     auto it = m_inputPins.find(tensor);
     return it != m_inputPins.end() ? it->second : nullptr;
@@ -127,8 +140,118 @@ private:
     }
   }
 
+  void show_weight_stats() const {
+    if (!m_graph || !m_weight_stats) {
+      return;
+    }
+    for (int edge_index : m_node->input_edges) {
+      const auto *edge = edge_at(edge_index);
+      const auto *weight =
+          edge ? m_weight_stats->find(edge->tensor_index) : nullptr;
+      if (!weight) {
+        continue;
+      }
+      const auto &stats = weight->stats;
+      ImGui::Text("%s: [%.4g, %.4g] std %.4g, %.1f%% zeros",
+                  weight->name.c_str(), stats.min, stats.max, stats.std,
+                  weight->sparsity() * 100.0);
+      if (!weight->channels.empty()) {
+        ImGui::Text("  %zu channels, spread %.1fx", weight->channels.size(),
+                    weight->channel_spread());
+      }
+    }
+  }
+
   const sModelGraphNode *m_node = nullptr;
   const sModelGraph *m_graph = nullptr;
+  const sWeightStatsReport *m_weight_stats = nullptr;
+  std::unordered_map<const sModelTensor *, ImFlow::Pin *> m_inputPins;
+  std::unordered_map<const sModelTensor *, ImFlow::Pin *> m_outputPins;
+};
+
+// Stands in for a run of repeated blocks when the viewer collapses them. The
+// pins are the tensors entering and leaving the run.
+class RepeatedBlockView : public ImFlow::BaseNode {
+public:
+  RepeatedBlockView(const sRepeatedBlock *block, const sModelGraph *graph,
+                    const std::vector<int> &node_block, int block_index)
+      : m_block(block) {
+    setTitle("Block \xc3\x97" + std::to_string(block->repeats()));
+    setStyle(ImFlow::NodeStyle::green());
+
+    auto inside = [&](int node) {
+      return node >= 0 && node < static_cast<int>(node_block.size()) &&
+             node_block[node] == block_index;
+    };
+    for (const auto &instance : block->instances) {
+      for (int n : instance) {
+        const auto &node = graph->nodes[n];
+        for (int edge_index : node.input_edges) {
+          const auto *tensor = tensor_for_edge(graph, edge_index);
+          if (!tensor || tensor->is_initializer ||
+              inside(graph->edges[edge_index].source_node) ||
+              m_inputPins.count(tensor)) {
+            continue;
+          }
+          auto pin = ImFlow::BaseNode::addIN<float>(
+              tensor->name, 0.f, ImFlow::ConnectionFilter::SameType());
+          m_inputPins[tensor] = pin.get();
+        }
+        for (int edge_index : node.output_edges) {
+          const auto *tensor = tensor_for_edge(graph, edge_index);
+          if (!tensor || inside(graph->edges[edge_index].target_node) ||
+              m_outputPins.count(tensor)) {
+            continue;
+          }
+          auto pin = ImFlow::BaseNode::addOUT<float>(tensor->name);
+          pin->behaviour([this]() { return 0.f; });
+          m_outputPins[tensor] = pin.get();
+        }
+      }
+    }
+  }
+
+  void draw() override {
+    ImGui::TextUnformatted(m_block->label.c_str());
+    if (ImFlow::BaseNode::isSelected()) {
+      ImGui::Text("%d nodes per block, %d blocks",
+                  m_block->nodes_per_instance(), m_block->repeats());
+    }
+  }
+
+  const sRepeatedBlock &block() const { return *m_block; }
+
+  void set_highlight(bool highlight) {
+    setStyle(highlight ? ImFlow::NodeStyle::red()
+                       : ImFlow::NodeStyle::green());
+  }
+
+  ImFlow::Pin *inputPin(const sModelTensor *tensor) const {
+    auto it = m_inputPins.find(tensor);
+    return it != m_inputPins.end() ? it->second : nullptr;
+  }
+
+  ImFlow::Pin *outputPin(const sModelTensor *tensor) const {
+    auto it = m_outputPins.find(tensor);
+    return it != m_outputPins.end() ? it->second : nullptr;
+  }
+
+private:
+  static const sModelTensor *tensor_for_edge(const sModelGraph *graph,
+                                             int edge_index) {
+    if (edge_index < 0 ||
+        edge_index >= static_cast<int>(graph->edges.size())) {
+      return nullptr;
+    }
+    const int tensor_index = graph->edges[edge_index].tensor_index;
+    if (tensor_index < 0 ||
+        tensor_index >= static_cast<int>(graph->tensors.size())) {
+      return nullptr;
+    }
+    return &graph->tensors[tensor_index];
+  }
+
+  const sRepeatedBlock *m_block = nullptr;
   std::unordered_map<const sModelTensor *, ImFlow::Pin *> m_inputPins;
   std::unordered_map<const sModelTensor *, ImFlow::Pin *> m_outputPins;
 };
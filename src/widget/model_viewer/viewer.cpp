@@ -1,106 +1,261 @@
 #include "viewer.h"
 
+#include <chrono>
 #include <limits>
 #include <map>
 #include <queue>
 #include <unordered_map>
 #include <vector>
 
-ModelViewer::ModelViewer()
-    : m_inspector(
-          std::make_unique<ModelInspector>("models/MobileNet-v2.onnx")) {
-  if (m_inspector && !m_inspector->nodes().empty()) {
-    build_graph();
-  }
-  mINF.getGrid().config().scroll_button = ImGuiMouseButton_Right;
-}
-
-void ModelViewer::set_size(ImVec2 d) { mINF.setSize(d); }
-
-void ModelViewer::draw() { mINF.update(); }
+namespace {
 
-void ModelViewer::build_graph() {
-  if (!m_inspector) {
-    return;
-  }
-
-  const auto &graph = m_inspector->graph();
-  const auto &nodes = graph.nodes;
-  if (nodes.empty()) {
-    return;
+// layered layout over units, a node or a collapsed run of blocks each:
+// columns by BFS depth from the units nothing else feeds
+std::vector<ImVec2> layout_units(const sModelGraph &graph,
+                                 const std::vector<int> &unit_of,
+                                 int unit_count) {
+  const int node_count = static_cast<int>(graph.nodes.size());
+  std::vector<std::vector<int>> successors(unit_count);
+  std::vector<bool> is_root(unit_count, true);
+  for (const auto &edge : graph.edges) {
+    if (edge.source_node < 0 || edge.source_node >= node_count ||
+        edge.target_node < 0 || edge.target_node >= node_count) {
+      continue;
+    }
+    const int source = unit_of[edge.source_node];
+    const int target = unit_of[edge.target_node];
+    if (source != target) {
+      successors[source].push_back(target);
+      is_root[target] = false;
+    }
   }
 
-  auto edge_at = [&](int edge_index) -> const sModelGraphEdge * {
-    if (edge_index < 0 || edge_index >= static_cast<int>(graph.edges.size())) {
-      return nullptr;
-    }
-    return &graph.edges[edge_index];
-  };
-  const int node_count = static_cast<int>(nodes.size());
-  std::vector<int> depth(node_count, std::numeric_limits<int>::max());
+  std::vector<int> depth(unit_count, std::numeric_limits<int>::max());
   std::queue<int> bfs_queue;
-
-  for (int i = 0; i < node_count; ++i) {
-    bool is_root = true;
-    for (int edge_index : nodes[i].input_edges) {
-      if (const auto *edge = edge_at(edge_index)) {
-        if (edge->source_node >= 0) {
-          is_root = false;
-          break;
-        }
-      }
-    }
-    if (is_root) {
-      depth[i] = 0;
-      bfs_queue.push(i);
+  for (int u = 0; u < unit_count; ++u) {
+    if (is_root[u]) {
+      depth[u] = 0;
+      bfs_queue.push(u);
     }
   }
-
   while (!bfs_queue.empty()) {
     const int current = bfs_queue.front();
     bfs_queue.pop();
     const int current_depth = depth[current];
-    for (int edge_index : nodes[current].output_edges) {
-      if (const auto *edge = edge_at(edge_index)) {
-        const int target = edge->target_node;
-        if (target < 0 || target >= node_count) {
-          continue;
-        }
-        if (depth[target] > current_depth + 1) {
-          depth[target] = current_depth + 1;
-          bfs_queue.push(target);
-        }
+    for (int target : successors[current]) {
+      if (depth[target] > current_depth + 1) {
+        depth[target] = current_depth + 1;
+        bfs_queue.push(target);
       }
     }
   }
 
-  std::map<int, std::vector<const sModelGraphNode *>> layers;
-  for (int i = 0; i < node_count; ++i) {
-    const auto *node = &nodes[i];
-    const int node_depth =
-        depth[i] == std::numeric_limits<int>::max() ? 0 : depth[i];
-    layers[node_depth].push_back(node);
+  std::map<int, std::vector<int>> layers;
+  for (int u = 0; u < unit_count; ++u) {
+    const int unit_depth =
+        depth[u] == std::numeric_limits<int>::max() ? 0 : depth[u];
+    layers[unit_depth].push_back(u);
   }
 
-  m_node_views.clear();
   constexpr float layer_spacing_x = 260.f;
   constexpr float node_spacing_y = 200.f;
   const float base_x = 80.f;
   const float base_y = 360.f;
 
-  for (const auto &[layer_depth, group_nodes] : layers) {
-    const int per_layer = static_cast<int>(group_nodes.size());
+  std::vector<ImVec2> positions(unit_count);
+  for (const auto &[layer_depth, group_units] : layers) {
+    const int per_layer = static_cast<int>(group_units.size());
     const float column_height =
         per_layer > 1 ? (per_layer - 1) * node_spacing_y : 0.f;
     const float start_y = base_y - column_height * 0.5f;
     const float x = base_x + layer_depth * layer_spacing_x;
 
     for (int idx = 0; idx < per_layer; ++idx) {
-      float y = start_y + idx * node_spacing_y;
-      ImVec2 pos = {x, y};
-      auto view =
-          mINF.addNode<ModelGraphNodeView>(pos, group_nodes[idx], &graph);
-      m_node_views.emplace(group_nodes[idx], view);
+      positions[group_units[idx]] = {x, start_y + idx * node_spacing_y};
+    }
+  }
+  return positions;
+}
+
+} // namespace
+
+ModelViewer::ModelViewer() {
+  mINF.getGrid().config().scroll_button = ImGuiMouseButton_Right;
+  load("models/MobileNet-v2.onnx");
+}
+
+ModelViewer::~ModelViewer() { m_load_token.cancel(); }
+
+void ModelViewer::set_size(ImVec2 d) { mINF.setSize(d); }
+
+void ModelViewer::draw() {
+  if (loading()) {
+    ImGui::TextUnformatted("Loading model...");
+  }
+  mINF.update();
+}
+
+void ModelViewer::load(const std::string &model_path) {
+  // a superseded load is dropped if it has not started yet
+  m_load_token.cancel();
+  m_load_token = CancellationToken();
+  m_pending = ThreadPool::shared().submit(
+      TASK_PRIORITY_INTERACTIVE,
+      [model_path] { return load_model(model_path); }, m_load_token);
+}
+
+void ModelViewer::update() {
+  if (!m_pending.valid() || m_pending.wait_for(std::chrono::seconds(0)) !=
+                                std::future_status::ready) {
+    return;
+  }
+  auto loaded = m_pending.get();
+  if (!loaded.inspector) {
+    return;
+  }
+  clear_graph();
+  m_weight_stats.reset();
+  m_inspector = std::move(loaded.inspector);
+  m_positions = std::move(loaded.positions);
+  m_collapsed_positions = std::move(loaded.collapsed_positions);
+  m_blocks = std::move(loaded.blocks);
+  build_graph();
+}
+
+std::vector<const sModelGraphNode *> ModelViewer::selected_nodes() const {
+  std::vector<const sModelGraphNode *> selected;
+  for (const auto &[node, view] : m_node_views) {
+    if (view->isSelected()) {
+      selected.push_back(node);
+    }
+  }
+  // a selected block stands for every node it hides
+  for (const auto &view : m_block_views) {
+    if (!view->isSelected()) {
+      continue;
+    }
+    for (const auto &instance : view->block().instances) {
+      for (int node : instance) {
+        selected.push_back(&m_inspector->nodes()[node]);
+      }
+    }
+  }
+  return selected;
+}
+
+void ModelViewer::highlight_nodes(const std::vector<int> &node_indices) {
+  if (!m_inspector) {
+    return;
+  }
+  for (auto &[node, view] : m_node_views) {
+    view->set_highlight(false);
+  }
+  for (auto &view : m_block_views) {
+    view->set_highlight(false);
+  }
+  const auto &nodes = m_inspector->nodes();
+  for (int index : node_indices) {
+    if (index < 0 || index >= static_cast<int>(nodes.size())) {
+      continue;
+    }
+    if (collapsed(index)) {
+      m_block_views[m_blocks.node_block[index]]->set_highlight(true);
+      continue;
+    }
+    if (auto it = m_node_views.find(&nodes[index]); it != m_node_views.end()) {
+      it->second->set_highlight(true);
+    }
+  }
+}
+
+void ModelViewer::set_collapse_blocks(bool collapse) {
+  if (collapse == m_collapse_blocks) {
+    return;
+  }
+  m_collapse_blocks = collapse;
+  if (m_inspector) {
+    clear_graph();
+    build_graph();
+  }
+}
+
+void ModelViewer::set_weight_stats(
+    std::shared_ptr<const sWeightStatsReport> report) {
+  m_weight_stats = std::move(report);
+  for (auto &[node, view] : m_node_views) {
+    view->set_weight_stats(m_weight_stats.get());
+  }
+}
+
+ModelViewer::sLoadedModel
+ModelViewer::load_model(const std::string &model_path) {
+  sLoadedModel loaded;
+  loaded.inspector = std::make_unique<ModelInspector>(model_path);
+  const auto &graph = loaded.inspector->graph();
+  const int node_count = static_cast<int>(graph.nodes.size());
+  if (node_count == 0) {
+    return loaded;
+  }
+  std::vector<int> unit_of(node_count);
+  for (int i = 0; i < node_count; ++i) {
+    unit_of[i] = i;
+  }
+  loaded.positions = layout_units(graph, unit_of, node_count);
+
+  // collapsed runs take the unit ids after the nodes
+  loaded.blocks = detect_repeated_blocks(graph);
+  for (int i = 0; i < node_count; ++i) {
+    if (loaded.blocks.node_block[i] >= 0) {
+      unit_of[i] = node_count + loaded.blocks.node_block[i];
+    }
+  }
+  loaded.collapsed_positions = layout_units(
+      graph, unit_of,
+      node_count + static_cast<int>(loaded.blocks.blocks.size()));
+  return loaded;
+}
+
+bool ModelViewer::collapsed(int node) const {
+  return m_collapse_blocks && node >= 0 &&
+         node < static_cast<int>(m_blocks.node_block.size()) &&
+         m_blocks.node_block[node] >= 0;
+}
+
+void ModelViewer::clear_graph() {
+  for (auto &[node, view] : m_node_views) {
+    view->destroy();
+  }
+  m_node_views.clear();
+  for (auto &view : m_block_views) {
+    view->destroy();
+  }
+  m_block_views.clear();
+}
+
+void ModelViewer::build_graph() {
+  const auto &graph = m_inspector->graph();
+  const auto &nodes = graph.nodes;
+  if (nodes.empty() || m_positions.size() != nodes.size() ||
+      m_blocks.node_block.size() != nodes.size()) {
+    return;
+  }
+
+  const bool collapse = m_collapse_blocks && !m_blocks.blocks.empty();
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (collapse && collapsed(static_cast<int>(i))) {
+      continue;
+    }
+    const ImVec2 position = collapse ? m_collapsed_positions[i]
+                                     : m_positions[i];
+    auto view = mINF.addNode<ModelGraphNodeView>(position, &nodes[i], &graph);
+    view->set_weight_stats(m_weight_stats.get());
+    m_node_views.emplace(&nodes[i], view);
+  }
+  if (collapse) {
+    for (size_t b = 0; b < m_blocks.blocks.size(); ++b) {
+      m_block_views.push_back(mINF.addNode<RepeatedBlockView>(
+          m_collapsed_positions[nodes.size() + b], &m_blocks.blocks[b],
+          &graph, m_blocks.node_block, static_cast<int>(b)));
     }
   }
 
@@ -112,6 +267,20 @@ void ModelViewer::build_graph() {
     }
     return &graph.tensors[edge.tensor_index];
   };
+  auto output_pin = [&](int node, const sModelTensor *tensor) -> ImFlow::Pin * {
+    if (collapsed(node)) {
+      return m_block_views[m_blocks.node_block[node]]->outputPin(tensor);
+    }
+    auto it = m_node_views.find(&nodes[node]);
+    return it != m_node_views.end() ? it->second->outputPin(tensor) : nullptr;
+  };
+  auto input_pin = [&](int node, const sModelTensor *tensor) -> ImFlow::Pin * {
+    if (collapsed(node)) {
+      return m_block_views[m_blocks.node_block[node]]->inputPin(tensor);
+    }
+    auto it = m_node_views.find(&nodes[node]);
+    return it != m_node_views.end() ? it->second->inputPin(tensor) : nullptr;
+  };
 
   for (const auto &edge : graph.edges) {
     if (edge.source_node < 0 || edge.target_node < 0) {
@@ -121,16 +290,15 @@ void ModelViewer::build_graph() {
         edge.target_node >= static_cast<int>(nodes.size())) {
       continue;
     }
-    const auto *source = &nodes[edge.source_node];
-    const auto *target = &nodes[edge.target_node];
-    auto src_it = m_node_views.find(source);
-    auto dst_it = m_node_views.find(target);
-    if (src_it == m_node_views.end() || dst_it == m_node_views.end()) {
+    // edges inside a collapsed run are hidden with it
+    if (collapsed(edge.source_node) && collapsed(edge.target_node) &&
+        m_blocks.node_block[edge.source_node] ==
+            m_blocks.node_block[edge.target_node]) {
       continue;
     }
     const auto *tensor = tensor_for_edge(edge);
-    auto *out_pin = src_it->second->outputPin(tensor);
-    auto *in_pin = dst_it->second->inputPin(tensor);
+    auto *out_pin = output_pin(edge.source_node, tensor);
+    auto *in_pin = input_pin(edge.target_node, tensor);
     if (out_pin && in_pin) {
       out_pin->createLink(in_pin);
     }
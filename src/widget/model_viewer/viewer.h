@@ -1,26 +1,71 @@
 #pragma once
 
+#include <future>
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "ImNodeFlow.h"
 #include "imgui.h"
 
+#include "../../engine/thread_pool.h"
 #include "../../model/inspector.h"
+#include "../../model/repeated_blocks.h"
+#include "../../model/weight_stats.h"
 #include "node.h"
 
 class ModelViewer {
 public:
   ModelViewer();
+  ~ModelViewer();
   void set_size(ImVec2 d);
   void draw();
+  // parses and lays out the model on the shared pool. the current model
+  // stays up until update() swaps the new one in.
+  void load(const std::string &model_path);
+  // takes over a finished load, once per frame
+  void update();
+  bool loading() const { return m_pending.valid(); }
+  const ModelInspector *inspector() const { return m_inspector.get(); }
+  ModelInspector *inspector() { return m_inspector.get(); }
+  // nodes currently selected in the node editor
+  std::vector<const sModelGraphNode *> selected_nodes() const;
+  // highlights the given node indices, clearing any previous highlight
+  void highlight_nodes(const std::vector<int> &node_indices);
+  // shows every run of repeated blocks as a single node
+  void set_collapse_blocks(bool collapse);
+  const sBlockPlan &blocks() const { return m_blocks; }
+  // weight statistics shown in the node inspector, for the current model
+  void set_weight_stats(std::shared_ptr<const sWeightStatsReport> report);
 
 private:
+  struct sLoadedModel {
+    std::unique_ptr<ModelInspector> inspector;
+    // editor position of every node, by node index
+    std::vector<ImVec2> positions;
+    sBlockPlan blocks;
+    // with blocks collapsed: nodes outside blocks by node index, then one
+    // position per block
+    std::vector<ImVec2> collapsed_positions;
+  };
+
+  static sLoadedModel load_model(const std::string &model_path);
   void build_graph();
+  void clear_graph();
+  bool collapsed(int node) const;
 
   ImFlow::ImNodeFlow mINF;
   std::unique_ptr<ModelInspector> m_inspector;
+  CancellationToken m_load_token;
+  std::future<sLoadedModel> m_pending;
   std::unordered_map<const sModelGraphNode *,
                      std::shared_ptr<ModelGraphNodeView>>
       m_node_views;
+  std::vector<std::shared_ptr<RepeatedBlockView>> m_block_views;
+  std::vector<ImVec2> m_positions;
+  std::vector<ImVec2> m_collapsed_positions;
+  sBlockPlan m_blocks;
+  bool m_collapse_blocks = true;
+  std::shared_ptr<const sWeightStatsReport> m_weight_stats;
 };
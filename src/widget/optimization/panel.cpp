@@ -0,0 +1,129 @@
+#include "panel.h"
+
+#include <chrono>
+#include <set>
+
+#include <imgui.h>
+
+#include "../../engine/thread_pool.h"
+
+void OptimizationPanel::draw(const ModelInspector *inspector) {
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  if (m_pending.valid() && m_pending.wait_for(std::chrono::seconds(0)) ==
+                               std::future_status::ready) {
+    m_comparison = m_pending.get();
+  }
+
+  const bool busy = m_pending.valid();
+  ImGui::BeginDisabled(busy);
+  ImGui::SliderInt("Iterations", &m_iterations, 1, 500);
+  if (ImGui::Button("Compare optimization levels")) {
+    m_pending = ThreadPool::shared().submit(
+        TASK_PRIORITY_BACKGROUND,
+        [path = inspector->model_path(), iterations = m_iterations] {
+          OptimizationComparison comparison;
+          comparison.run(path, iterations);
+          return comparison;
+        });
+  }
+  ImGui::EndDisabled();
+  if (busy) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted("optimizing and benchmarking...");
+  }
+  draw_results();
+}
+
+void OptimizationPanel::draw_results() {
+  const auto &results = m_comparison.results();
+  if (results.empty()) {
+    return;
+  }
+  ImGui::Text("Optimized models: %s", m_comparison.output_dir().c_str());
+
+  const int columns = static_cast<int>(results.size()) + 1;
+  if (ImGui::BeginTable("optimization_levels", columns,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("");
+    for (const auto &result : results) {
+      ImGui::TableSetupColumn(result.name);
+    }
+    ImGui::TableHeadersRow();
+
+    auto row = [&](const char *label, auto &&cell) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(label);
+      for (const auto &result : results) {
+        ImGui::TableNextColumn();
+        if (!result.ok) {
+          ImGui::TextDisabled("failed");
+          if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("%s", result.error.c_str());
+          }
+          continue;
+        }
+        cell(result);
+      }
+    };
+    row("Nodes", [](const sOptimizationLevelResult &r) {
+      ImGui::Text("%zu", r.node_count);
+    });
+    row("Session create", [](const sOptimizationLevelResult &r) {
+      ImGui::Text("%.1f ms", r.create_ms);
+    });
+    row("ORT-format reload", [](const sOptimizationLevelResult &r) {
+      ImGui::Text("%.1f ms", r.reload_ms);
+    });
+    row("First run", [](const sOptimizationLevelResult &r) {
+      ImGui::Text("%.2f ms", r.first_run_ms);
+    });
+    row("Mean latency", [](const sOptimizationLevelResult &r) {
+      ImGui::Text("%.3f ms", r.mean_latency_ms);
+    });
+    row("p50 / p90", [](const sOptimizationLevelResult &r) {
+      ImGui::Text("%.3f / %.3f ms", r.p50_latency_ms, r.p90_latency_ms);
+    });
+    row("Fused ops", [](const sOptimizationLevelResult &r) {
+      if (r.fused_ops.empty()) {
+        ImGui::TextDisabled("none");
+      }
+      for (const auto &op_type : r.fused_ops) {
+        ImGui::Text("%s x%d", op_type.c_str(), r.op_counts.at(op_type));
+      }
+    });
+    ImGui::EndTable();
+  }
+
+  if (!ImGui::CollapsingHeader("Op counts per level")) {
+    return;
+  }
+  std::set<std::string> op_types;
+  for (const auto &result : results) {
+    for (const auto &[op_type, count] : result.op_counts) {
+      op_types.insert(op_type);
+    }
+  }
+  if (ImGui::BeginTable("optimization_op_counts", columns,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("Op");
+    for (const auto &result : results) {
+      ImGui::TableSetupColumn(result.name);
+    }
+    ImGui::TableHeadersRow();
+    for (const auto &op_type : op_types) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(op_type.c_str());
+      for (const auto &result : results) {
+        ImGui::TableNextColumn();
+        auto it = result.op_counts.find(op_type);
+        ImGui::Text("%d", it != result.op_counts.end() ? it->second : 0);
+      }
+    }
+    ImGui::EndTable();
+  }
+}
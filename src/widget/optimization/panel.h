@@ -0,0 +1,20 @@
+#pragma once
+
+#include <future>
+#include <string>
+
+#include "../../model/inspector.h"
+#include "../../runtime/optimization.h"
+
+// Side by side comparison of the onnxruntime graph optimization levels.
+class OptimizationPanel {
+public:
+  void draw(const ModelInspector *inspector);
+
+private:
+  void draw_results();
+
+  int m_iterations = 50;
+  OptimizationComparison m_comparison;
+  std::future<OptimizationComparison> m_pending;
+};
@@ -0,0 +1,313 @@
+#include "panel.h"
+
+#include <chrono>
+#include <cstdio>
+
+#include <imgui.h>
+
+#include "../../engine/thread_pool.h"
+#include "../../model/graph_utils.h"
+
+namespace {
+
+constexpr double kMiB = 1024.0 * 1024.0;
+
+// op types separated by commas or spaces
+std::vector<std::string> split_ops(const char *text) {
+  std::vector<std::string> ops;
+  std::string op;
+  for (const char *c = text;; ++c) {
+    if (*c == '\0' || *c == ',' || *c == ' ') {
+      if (!op.empty()) {
+        ops.push_back(op);
+        op.clear();
+      }
+      if (*c == '\0') {
+        break;
+      }
+    } else {
+      op += *c;
+    }
+  }
+  return ops;
+}
+
+} // namespace
+
+MixedPrecisionPanel::MixedPrecisionPanel() { reset_ops(); }
+
+void MixedPrecisionPanel::draw(ModelViewer &viewer) {
+  const auto *inspector = viewer.inspector();
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  if (m_scanning.valid() && m_scanning.wait_for(std::chrono::seconds(0)) ==
+                                std::future_status::ready) {
+    m_scan = m_scanning.get();
+    m_has_scan = true;
+    m_dirty = true;
+  }
+  if (m_pending.valid() && m_pending.wait_for(std::chrono::seconds(0)) ==
+                               std::future_status::ready) {
+    m_result = m_pending.get();
+    m_has_result = true;
+  }
+  if (!m_scanning.valid() && m_model_path != inspector->model_path()) {
+    m_has_result = false;
+    start_scan(*inspector);
+  }
+  if (m_scanning.valid() || !m_has_scan) {
+    ImGui::TextUnformatted("scanning weights...");
+    return;
+  }
+  if (!m_scan.ok) {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s",
+                       m_scan.error.c_str());
+    return;
+  }
+
+  if (draw_config()) {
+    m_dirty = true;
+  }
+  // planning only walks the graph, so it runs on every change
+  if (m_dirty || m_revision != inspector->revision()) {
+    m_revision = inspector->revision();
+    m_config.format = static_cast<eHalfFormat>(m_format);
+    m_config.mode = static_cast<eOpListMode>(m_mode);
+    m_config.ops = split_ops(m_ops);
+    m_config.max_underflow = m_max_underflow / 100.f;
+    m_plan = plan_mixed_precision(inspector->graph(), m_config, m_scan.ranges);
+    m_dirty = false;
+  }
+  draw_plan(inspector->graph(), viewer);
+  if (ImGui::CollapsingHeader("Convert and compare",
+                              ImGuiTreeNodeFlags_DefaultOpen)) {
+    draw_compare(*inspector);
+  }
+}
+
+void MixedPrecisionPanel::start_scan(const ModelInspector &inspector) {
+  m_model_path = inspector.model_path();
+  m_scanning = ThreadPool::shared().submit(
+      TASK_PRIORITY_BACKGROUND,
+      [path = inspector.model_path(), graph = inspector.graph()] {
+        sRangeScan scan;
+        scan.ok =
+            scan_initializer_ranges(path, graph, scan.ranges, scan.error);
+        return scan;
+      });
+}
+
+void MixedPrecisionPanel::reset_ops() {
+  const auto ops = m_mode == OP_LIST_ALLOW ? default_half_ops()
+                                           : default_float_ops();
+  std::string joined;
+  for (const auto &op : ops) {
+    joined += joined.empty() ? op : ", " + op;
+  }
+  std::snprintf(m_ops, sizeof(m_ops), "%s", joined.c_str());
+}
+
+bool MixedPrecisionPanel::draw_config() {
+  const bool busy = m_pending.valid();
+  ImGui::BeginDisabled(busy);
+  bool changed = false;
+  const char *formats[] = {"float16", "bfloat16"};
+  changed |= ImGui::Combo("Format", &m_format, formats, IM_ARRAYSIZE(formats));
+  // each mode starts from its own default list
+  bool mode_changed =
+      ImGui::RadioButton("Keep listed ops in float", &m_mode, OP_LIST_DENY);
+  ImGui::SameLine();
+  mode_changed |=
+      ImGui::RadioButton("Convert listed ops only", &m_mode, OP_LIST_ALLOW);
+  if (mode_changed) {
+    reset_ops();
+    changed = true;
+  }
+  changed |= ImGui::InputText("Ops", m_ops, sizeof(m_ops));
+  ImGui::SameLine();
+  if (ImGui::Button("Defaults")) {
+    reset_ops();
+    changed = true;
+  }
+  changed |= ImGui::SliderFloat("Max underflow %", &m_max_underflow, 0.f,
+                                10.f, "%.2f");
+  ImGui::EndDisabled();
+  return changed;
+}
+
+void MixedPrecisionPanel::draw_plan(const sModelGraph &graph,
+                                    ModelViewer &viewer) {
+  const auto &plan = m_plan;
+  int listed = 0;
+  int range = 0;
+  int unsupported = 0;
+  std::vector<int> half_nodes;
+  std::vector<int> float_nodes;
+  for (size_t n = 0; n < plan.precisions.size(); ++n) {
+    const auto precision = plan.precisions[n];
+    listed += precision == PRECISION_FLOAT_LISTED;
+    range += precision == PRECISION_FLOAT_RANGE;
+    unsupported += precision == PRECISION_FLOAT_UNSUPPORTED;
+    if (precision == PRECISION_HALF) {
+      half_nodes.push_back(static_cast<int>(n));
+    } else if (precision != PRECISION_NONE) {
+      float_nodes.push_back(static_cast<int>(n));
+    }
+  }
+  ImGui::Text("%d nodes in %s, %d stay in float (planned in %.2f ms)",
+              plan.half_nodes, half_format_name(m_config.format),
+              plan.float_nodes, plan.elapsed_ms);
+  ImGui::Text("Float: %d by the op list, %d by weight range, %d without "
+              "half kernels at opset %d",
+              listed, range, unsupported, graph.opset);
+  ImGui::Text("%d tensors in half, %d Casts, weights %.2f MiB -> %.2f MiB",
+              plan.half_tensors, plan.casts, plan.float_weight_bytes / kMiB,
+              plan.half_weight_bytes / kMiB);
+  if (ImGui::Button("Highlight half")) {
+    viewer.highlight_nodes(half_nodes);
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Highlight float")) {
+    viewer.highlight_nodes(float_nodes);
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Clear highlight")) {
+    viewer.highlight_nodes({});
+  }
+
+  if (plan.risky.empty()) {
+    return;
+  }
+  ImGui::Text("%zu initializers out of range for %s:", plan.risky.size(),
+              half_format_name(m_config.format));
+  if (!ImGui::BeginTable("precision_risky", 4,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                             ImGuiTableFlags_ScrollY,
+                         ImVec2(0, ImGui::GetTextLineHeightWithSpacing() *
+                                       8))) {
+    return;
+  }
+  ImGui::TableSetupScrollFreeze(0, 1);
+  ImGui::TableSetupColumn("Tensor");
+  ImGui::TableSetupColumn("Max |x|");
+  ImGui::TableSetupColumn("Overflow");
+  ImGui::TableSetupColumn("Underflow %");
+  ImGui::TableHeadersRow();
+  const int format = m_config.format;
+  ImGuiListClipper clipper;
+  clipper.Begin(static_cast<int>(plan.risky.size()));
+  while (clipper.Step()) {
+    for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+      const auto &r = m_scan.ranges[plan.risky[i]];
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::PushID(i);
+      if (ImGui::Selectable(graph.tensors[r.tensor].name.c_str(), false,
+                            ImGuiSelectableFlags_SpanAllColumns)) {
+        viewer.highlight_nodes(tensor_consumers(graph)[r.tensor]);
+      }
+      ImGui::PopID();
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3g", r.max_abs);
+      ImGui::TableNextColumn();
+      ImGui::Text("%lld", static_cast<long long>(r.overflow[format]));
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", r.nonzero ? 100.0 * r.underflow[format] / r.nonzero
+                                    : 0.0);
+    }
+  }
+  ImGui::EndTable();
+}
+
+void MixedPrecisionPanel::draw_compare(const ModelInspector &inspector) {
+  const bool busy = m_pending.valid();
+  ImGui::BeginDisabled(busy || m_plan.half_nodes == 0);
+  ImGui::InputFloat("rtol", &m_rtol, 0.f, 0.f, "%.0e");
+  ImGui::InputFloat("atol", &m_atol, 0.f, 0.f, "%.0e");
+  ImGui::SliderInt("Iterations", &m_iterations, 1, 200);
+  ImGui::InputText("Output", m_output_path, sizeof(m_output_path));
+  if (ImGui::Button("Convert and compare")) {
+    sHalfCompareConfig compare;
+    compare.rtol = m_rtol;
+    compare.atol = m_atol;
+    compare.iterations = m_iterations;
+    m_pending = ThreadPool::shared().submit(
+        TASK_PRIORITY_BACKGROUND,
+        [path = inspector.model_path(), graph = inspector.graph(),
+         config = m_config, compare, output = std::string(m_output_path)] {
+          return MixedPrecisionConverter::run(path, graph, config, compare,
+                                              output);
+        });
+  }
+  ImGui::EndDisabled();
+  if (busy) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted("running...");
+    return;
+  }
+  if (m_has_result) {
+    draw_result();
+  }
+}
+
+void MixedPrecisionPanel::draw_result() {
+  const auto &r = m_result;
+  if (!r.ok) {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s", r.error.c_str());
+    ImGui::TextDisabled("onnxruntime needs half kernels for every converted "
+                        "op; bfloat16 has few on CPU.");
+    return;
+  }
+  const auto &c = r.conversion;
+  ImGui::TextWrapped("Wrote %s in %.1f ms", c.output_path.c_str(),
+                     c.elapsed_ms);
+  ImGui::Text("File %.2f MiB -> %.2f MiB, %lld constants clamped to the "
+              "half range",
+              c.bytes_before / kMiB, c.bytes_after / kMiB,
+              static_cast<long long>(c.clamped_values));
+  ImGui::Text("p50 latency: float %.3f ms, %s %.3f ms (%.2fx)",
+              r.float_p50_ms, half_format_name(m_config.format),
+              r.half_p50_ms,
+              r.half_p50_ms > 0.0 ? r.float_p50_ms / r.half_p50_ms : 0.0);
+  ImGui::Text("Arena peak: float %.2f MiB, half %.2f MiB",
+              r.float_peak_bytes / kMiB, r.half_peak_bytes / kMiB);
+  if (r.passed()) {
+    ImGui::TextColored(ImVec4(0.4f, 1.f, 0.4f, 1.f),
+                       "All outputs within rtol %.0e, atol %.0e", m_rtol,
+                       m_atol);
+  } else {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f),
+                       "Outputs outside rtol %.0e, atol %.0e", m_rtol,
+                       m_atol);
+  }
+  if (!ImGui::BeginTable("precision_outputs", 6,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    return;
+  }
+  ImGui::TableSetupColumn("Output");
+  ImGui::TableSetupColumn("Max abs");
+  ImGui::TableSetupColumn("Max rel");
+  ImGui::TableSetupColumn("Cosine");
+  ImGui::TableSetupColumn("Mismatched");
+  ImGui::TableSetupColumn("Inf/NaN");
+  ImGui::TableHeadersRow();
+  for (const auto &output : r.outputs) {
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(output.name.c_str());
+    ImGui::TableNextColumn();
+    ImGui::Text("%.3g", output.max_abs_diff);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.3g", output.max_relative_diff);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.6f", output.cosine);
+    ImGui::TableNextColumn();
+    ImGui::Text("%lld / %lld", static_cast<long long>(output.mismatched),
+                static_cast<long long>(output.count));
+    ImGui::TableNextColumn();
+    ImGui::Text("%lld", static_cast<long long>(output.nonfinite));
+  }
+  ImGui::EndTable();
+}
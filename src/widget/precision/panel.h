@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "../../model/mixed_precision.h"
+#include "../../runtime/mixed_precision.h"
+#include "../model_viewer/viewer.h"
+
+// Which nodes would run in float16 or bfloat16 and which stay in float32,
+// planned again whenever the op list or the model changes, and the mixed
+// precision model written and checked against the float model.
+class MixedPrecisionPanel {
+public:
+  MixedPrecisionPanel();
+  void draw(ModelViewer &viewer);
+
+private:
+  struct sRangeScan {
+    bool ok = false;
+    std::string error;
+    std::vector<sInitializerRange> ranges;
+  };
+
+  void start_scan(const ModelInspector &inspector);
+  bool draw_config();
+  void draw_plan(const sModelGraph &graph, ModelViewer &viewer);
+  void draw_compare(const ModelInspector &inspector);
+  void draw_result();
+  void reset_ops();
+
+  std::string m_model_path;
+  uint64_t m_revision = 0;
+  sRangeScan m_scan;
+  bool m_has_scan = false;
+  std::future<sRangeScan> m_scanning;
+
+  int m_format = HALF_FORMAT_FP16;
+  int m_mode = OP_LIST_DENY;
+  // comma separated op types
+  char m_ops[1024] = {};
+  // percent
+  float m_max_underflow = 1.f;
+  bool m_dirty = true;
+  sMixedPrecisionConfig m_config;
+  sPrecisionPlan m_plan;
+
+  float m_rtol = 1e-2f;
+  float m_atol = 1e-3f;
+  int m_iterations = 20;
+  char m_output_path[512] = {};
+  sHalfComparison m_result;
+  bool m_has_result = false;
+  std::future<sHalfComparison> m_pending;
+};
@@ -0,0 +1,144 @@
+#include "panel.h"
+
+#include <chrono>
+
+#include <imgui.h>
+
+#include "../../engine/thread_pool.h"
+
+namespace {
+
+constexpr double kMiB = 1024.0 * 1024.0;
+
+} // namespace
+
+void QuantizationPanel::draw(const ModelInspector *inspector) {
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  if (m_pending.valid() && m_pending.wait_for(std::chrono::seconds(0)) ==
+                               std::future_status::ready) {
+    m_result = m_pending.get();
+    m_has_result = true;
+  }
+
+  const bool busy = m_pending.valid();
+  ImGui::BeginDisabled(busy);
+  ImGui::InputText("Calibration dir", m_calibration_dir,
+                   sizeof(m_calibration_dir));
+  if (m_calibration_dir[0] == '\0') {
+    ImGui::SliderInt("Synthetic samples", &m_samples, 1, 256);
+  }
+  const char *methods[] = {"Min-max", "Percentile", "Entropy"};
+  ImGui::Combo("Calibration", &m_method, methods, IM_ARRAYSIZE(methods));
+  if (m_method == CALIBRATION_PERCENTILE) {
+    ImGui::SliderFloat("Percentile", &m_percentile, 99.f, 100.f, "%.3f");
+  }
+  ImGui::Checkbox("Per-channel weights", &m_per_channel);
+  ImGui::InputText("Output", m_output_path, sizeof(m_output_path));
+  ImGui::SliderInt("Iterations", &m_iterations, 1, 200);
+  if (ImGui::Button("Quantize and compare")) {
+    sQuantizationConfig config;
+    config.calibration_dir = m_calibration_dir;
+    config.synthetic_samples = m_samples;
+    config.method = static_cast<eCalibrationMethod>(m_method);
+    config.percentile = m_percentile;
+    config.per_channel = m_per_channel;
+    config.output_path = m_output_path;
+    config.iterations = m_iterations;
+    m_pending = ThreadPool::shared().submit(
+        TASK_PRIORITY_BACKGROUND, [path = inspector->model_path(), config] {
+          return PostTrainingQuantizer::run(path, config);
+        });
+  }
+  ImGui::EndDisabled();
+  if (busy) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted("running...");
+  }
+  if (m_has_result) {
+    draw_result();
+  }
+}
+
+void QuantizationPanel::draw_result() {
+  const auto &r = m_result;
+  if (!r.ok) {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s", r.error.c_str());
+    return;
+  }
+  ImGui::TextWrapped("Wrote %s", r.output_path.c_str());
+  ImGui::Text("%d nodes quantized, %d tensors calibrated on %d samples in "
+              "%.1f ms",
+              r.quantized_nodes, static_cast<int>(r.tensors.size()),
+              r.samples, r.calibration_ms);
+  ImGui::Text("Weights %.2f MiB fp32 -> %.2f MiB int8",
+              r.fp32_weight_bytes / kMiB, r.int8_weight_bytes / kMiB);
+  ImGui::Text("p50 latency: fp32 %.3f ms, int8 %.3f ms (%.2fx)",
+              r.fp32_p50_ms, r.int8_p50_ms,
+              r.int8_p50_ms > 0.0 ? r.fp32_p50_ms / r.int8_p50_ms : 0.0);
+
+  if (ImGui::BeginTable("quantization_accuracy", 5,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("Output");
+    ImGui::TableSetupColumn("Max |diff|");
+    ImGui::TableSetupColumn("Mean |diff|");
+    ImGui::TableSetupColumn("Cosine");
+    ImGui::TableSetupColumn("Top-1 agreement");
+    ImGui::TableHeadersRow();
+    for (const auto &output : r.outputs) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(output.name.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.4g", output.max_abs_diff);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.4g", output.mean_abs_diff);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.6f", output.cosine);
+      ImGui::TableNextColumn();
+      if (output.top1_agreement >= 0.f) {
+        ImGui::Text("%.1f%%", output.top1_agreement * 100.f);
+      } else {
+        ImGui::TextUnformatted("-");
+      }
+    }
+    ImGui::EndTable();
+  }
+
+  if (!ImGui::CollapsingHeader("Calibrated tensors")) {
+    return;
+  }
+  if (ImGui::BeginTable("quantization_tensors", 5,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_ScrollY,
+                        ImVec2(0, 260))) {
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Tensor");
+    ImGui::TableSetupColumn("Observed");
+    ImGui::TableSetupColumn("Calibrated");
+    ImGui::TableSetupColumn("Scale");
+    ImGui::TableSetupColumn("Zero point");
+    ImGui::TableHeadersRow();
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(r.tensors.size()));
+    while (clipper.Step()) {
+      for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+        const auto &tensor = r.tensors[i];
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(tensor.name.c_str());
+        ImGui::TableNextColumn();
+        ImGui::Text("[%.4g, %.4g]", tensor.min, tensor.max);
+        ImGui::TableNextColumn();
+        ImGui::Text("[%.4g, %.4g]", tensor.low, tensor.high);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.4g", tensor.params.scale);
+        ImGui::TableNextColumn();
+        ImGui::Text("%d", tensor.params.zero_point);
+      }
+    }
+    ImGui::EndTable();
+  }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <future>
+
+#include "../../model/inspector.h"
+#include "../../runtime/quantization.h"
+
+// INT8 post-training quantization: calibration, QDQ export and the fp32
+// against int8 comparison.
+class QuantizationPanel {
+public:
+  void draw(const ModelInspector *inspector);
+
+private:
+  void draw_result();
+
+  // empty for synthetic samples
+  char m_calibration_dir[512] = {};
+  // empty for <model>.int8.onnx
+  char m_output_path[512] = {};
+  int m_samples = 16;
+  int m_method = CALIBRATION_MIN_MAX;
+  float m_percentile = 99.99f;
+  bool m_per_channel = true;
+  int m_iterations = 20;
+  sQuantizationResult m_result;
+  bool m_has_result = false;
+  std::future<sQuantizationResult> m_pending;
+};
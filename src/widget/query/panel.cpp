@@ -0,0 +1,134 @@
+#include "panel.h"
+
+#include <cstdio>
+#include <vector>
+
+#include <imgui.h>
+
+namespace {
+
+struct sQueryExample {
+  const char *label;
+  const char *query;
+};
+
+const sQueryExample kExamples[] = {
+    {"Unfused attention", "MatMul ->{4} Softmax ->{2} MatMul"},
+    {"Depthwise convolutions", "Conv[group == channels and group > 1]"},
+    {"Back to back transposes", "Transpose -> Transpose"},
+    {"Reshape chains", "Reshape -> Reshape"},
+};
+
+} // namespace
+
+void QueryPanel::draw(ModelViewer &viewer) {
+  const auto *inspector = viewer.inspector();
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  if (m_inspector != inspector || m_model_path != inspector->model_path() ||
+      m_revision != inspector->revision()) {
+    m_inspector = inspector;
+    m_model_path = inspector->model_path();
+    m_revision = inspector->revision();
+    m_index = std::make_unique<GraphIndex>(inspector->graph());
+    m_has_result = false;
+    m_selected = -1;
+  }
+
+  bool submit = ImGui::InputText("Query", m_query, sizeof(m_query),
+                                 ImGuiInputTextFlags_EnterReturnsTrue);
+  ImGui::SameLine();
+  submit |= ImGui::Button("Run");
+  if (ImGui::BeginCombo("Examples", nullptr, ImGuiComboFlags_NoPreview)) {
+    for (const auto &example : kExamples) {
+      if (ImGui::Selectable(example.label)) {
+        std::snprintf(m_query, sizeof(m_query), "%s", example.query);
+        submit = true;
+      }
+    }
+    ImGui::EndCombo();
+  }
+  if (submit) {
+    run();
+    viewer.highlight_nodes({});
+  }
+  ImGui::TextDisabled("e.g. Conv[group > 1] -> Relu, *[name ~ \"attn\"] "
+                      "<-{2} MatMul");
+
+  if (!m_has_result) {
+    return;
+  }
+  if (!m_result.ok) {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s",
+                       m_result.error.c_str());
+    return;
+  }
+  ImGui::Text("%zu matches%s in %.2f ms", m_result.matches.size(),
+              m_result.truncated ? " (truncated)" : "", m_result.query_ms);
+  draw_matches(inspector->graph(), viewer);
+}
+
+void QueryPanel::run() {
+  m_result = run_graph_query(*m_index, m_query);
+  m_has_result = true;
+  m_selected = -1;
+}
+
+void QueryPanel::draw_matches(const sModelGraph &graph, ModelViewer &viewer) {
+  if (ImGui::Button("Highlight all matches")) {
+    std::vector<int> nodes;
+    for (const auto &match : m_result.matches) {
+      nodes.insert(nodes.end(), match.nodes.begin(), match.nodes.end());
+    }
+    viewer.highlight_nodes(nodes);
+    m_selected = -1;
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Clear highlight")) {
+    viewer.highlight_nodes({});
+    m_selected = -1;
+  }
+
+  if (!ImGui::BeginTable("query_matches", 3,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                             ImGuiTableFlags_ScrollY,
+                         ImVec2(0, -1))) {
+    return;
+  }
+  ImGui::TableSetupScrollFreeze(0, 1);
+  ImGui::TableSetupColumn("#", ImGuiTableColumnFlags_WidthFixed);
+  ImGui::TableSetupColumn("Matched nodes");
+  ImGui::TableSetupColumn("Span", ImGuiTableColumnFlags_WidthFixed);
+  ImGui::TableHeadersRow();
+  ImGuiListClipper clipper;
+  clipper.Begin(static_cast<int>(m_result.matches.size()));
+  while (clipper.Step()) {
+    for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+      const auto &match = m_result.matches[i];
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::PushID(i);
+      // selecting a match shows it and the paths between its steps
+      if (ImGui::Selectable(std::to_string(i + 1).c_str(), m_selected == i,
+                            ImGuiSelectableFlags_SpanAllColumns)) {
+        m_selected = m_selected == i ? -1 : i;
+        viewer.highlight_nodes(m_selected >= 0 ? match.nodes
+                                               : std::vector<int>{});
+      }
+      ImGui::PopID();
+      ImGui::TableNextColumn();
+      std::string names;
+      for (int node : match.anchors) {
+        const auto &n = graph.nodes[node];
+        names += (names.empty() ? "" : " -> ") +
+                 (n.name.empty() ? n.op_type : n.name);
+      }
+      ImGui::TextUnformatted(names.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%zu nodes", match.nodes.size());
+    }
+  }
+  ImGui::EndTable();
+}
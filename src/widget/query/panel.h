@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "../../model/graph_query.h"
+#include "../model_viewer/viewer.h"
+
+// Pattern queries over the loaded model, matches highlighted in the viewer.
+class QueryPanel {
+public:
+  void draw(ModelViewer &viewer);
+
+private:
+  void run();
+  void draw_matches(const sModelGraph &graph, ModelViewer &viewer);
+
+  char m_query[512] = "MatMul ->{4} Softmax ->{2} MatMul";
+  // index of the graph it was built for, rebuilt when the model changes
+  std::unique_ptr<GraphIndex> m_index;
+  const ModelInspector *m_inspector = nullptr;
+  std::string m_model_path;
+  uint64_t m_revision = 0;
+  sQueryResult m_result;
+  bool m_has_result = false;
+  // match shown in the viewer, -1 for none
+  int m_selected = -1;
+};
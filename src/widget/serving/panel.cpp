@@ -0,0 +1,145 @@
+#include "panel.h"
+
+#include <algorithm>
+#include <thread>
+
+#include <imgui.h>
+#include <implot.h>
+
+namespace {
+
+// stats percentiles sort every sample, so they refresh a few times a second
+constexpr double kStatsRefreshInterval = 0.25;
+// newest samples kept in the live charts
+constexpr int kMaxPlotSamples = 20000;
+
+} // namespace
+
+void ServingPanel::draw(const ModelInspector *inspector) {
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  ImGui::Text("Model: %s", inspector->model_path().c_str());
+  ImGui::Text("Hardware threads: %u", std::thread::hardware_concurrency());
+
+  draw_config();
+
+  const bool running = m_simulator.running();
+  if (running) {
+    if (ImGui::Button("Stop")) {
+      m_simulator.stop();
+    }
+  } else if (ImGui::Button("Start")) {
+    m_sample_cursor = 0;
+    m_arrival_s.clear();
+    m_latency_ms.clear();
+    m_queue_ms.clear();
+    m_compute_ms.clear();
+    m_stats = sServingStats{};
+    m_simulator.start(inspector->model_path(), m_config);
+  }
+  const auto error = m_simulator.error();
+  if (!error.empty()) {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s", error.c_str());
+  }
+
+  pull_samples();
+  const double now = ImGui::GetTime();
+  if (now - m_last_refresh > kStatsRefreshInterval) {
+    m_stats = m_simulator.stats();
+    m_last_refresh = now;
+  }
+  draw_stats();
+  draw_plots();
+}
+
+void ServingPanel::draw_config() {
+  ImGui::BeginDisabled(m_simulator.running());
+  int arrival = static_cast<int>(m_config.arrival);
+  if (ImGui::Combo("Arrival", &arrival, "Poisson\0Fixed QPS\0")) {
+    m_config.arrival = static_cast<eArrivalProcess>(arrival);
+  }
+  ImGui::InputDouble("QPS", &m_config.qps, 1.0, 10.0, "%.1f");
+  ImGui::InputDouble("Duration (s)", &m_config.duration_s, 1.0, 10.0, "%.1f");
+  ImGui::SliderInt("Sessions", &m_config.num_sessions, 1, 16);
+  ImGui::SliderInt("Intra-op threads", &m_config.intra_op_threads, 0, 16);
+  ImGui::InputInt("Queue capacity", &m_config.queue_capacity);
+  ImGui::SliderInt("Max batch", &m_config.max_batch_size, 1, 64);
+  ImGui::InputDouble("Batch window (ms)", &m_config.batching_window_ms, 0.5,
+                     5.0, "%.2f");
+  m_config.qps = std::max(m_config.qps, 0.1);
+  m_config.duration_s = std::max(m_config.duration_s, 1.0);
+  m_config.queue_capacity = std::max(m_config.queue_capacity, 1);
+  m_config.batching_window_ms = std::max(m_config.batching_window_ms, 0.0);
+  ImGui::EndDisabled();
+}
+
+void ServingPanel::pull_samples() {
+  std::vector<sServingSample> fresh;
+  m_sample_cursor = m_simulator.samples_since(m_sample_cursor, fresh);
+  for (const auto &sample : fresh) {
+    m_arrival_s.push_back(sample.arrival_s);
+    m_queue_ms.push_back(sample.queue_ms);
+    m_compute_ms.push_back(sample.compute_ms);
+    m_latency_ms.push_back(sample.queue_ms + sample.compute_ms);
+  }
+}
+
+void ServingPanel::draw_stats() {
+  if (!ImGui::BeginTable("serving_stats", 4, ImGuiTableFlags_Borders)) {
+    return;
+  }
+  auto row = [](const char *a, const char *fa, double va, const char *b,
+                const char *fb, double vb) {
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(a);
+    ImGui::TableNextColumn();
+    ImGui::Text(fa, va);
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(b);
+    ImGui::TableNextColumn();
+    ImGui::Text(fb, vb);
+  };
+  row("Submitted", "%.0f", static_cast<double>(m_stats.submitted), "Completed",
+      "%.0f", static_cast<double>(m_stats.completed));
+  row("Rejected", "%.0f", static_cast<double>(m_stats.rejected), "Queue depth",
+      "%.0f", static_cast<double>(m_stats.queue_depth));
+  row("Throughput", "%.1f qps", m_stats.throughput_qps, "Mean batch", "%.2f",
+      m_stats.mean_batch_size);
+  row("Mean queue", "%.2f ms", m_stats.mean_queue_ms, "Mean compute",
+      "%.2f ms", m_stats.mean_compute_ms);
+  row("p50", "%.2f ms", m_stats.p50_ms, "p90", "%.2f ms", m_stats.p90_ms);
+  row("p99", "%.2f ms", m_stats.p99_ms, "max", "%.2f ms", m_stats.max_ms);
+  ImGui::EndTable();
+}
+
+void ServingPanel::draw_plots() {
+  const int total = static_cast<int>(m_arrival_s.size());
+  if (total == 0) {
+    return;
+  }
+  const int count = std::min(total, kMaxPlotSamples);
+  const int offset = total - count;
+
+  if (ImPlot::BeginPlot("Latency over time", ImVec2(-1, 220))) {
+    ImPlot::SetupAxes("arrival (s)", "ms", ImPlotAxisFlags_AutoFit,
+                      ImPlotAxisFlags_AutoFit);
+    ImPlot::PlotScatter("queue", m_arrival_s.data() + offset,
+                        m_queue_ms.data() + offset, count);
+    ImPlot::PlotScatter("compute", m_arrival_s.data() + offset,
+                        m_compute_ms.data() + offset, count);
+    ImPlot::PlotScatter("end-to-end", m_arrival_s.data() + offset,
+                        m_latency_ms.data() + offset, count);
+    ImPlot::EndPlot();
+  }
+
+  if (ImPlot::BeginPlot("Latency distribution", ImVec2(-1, 180))) {
+    ImPlot::SetupAxes("ms", "requests", ImPlotAxisFlags_AutoFit,
+                      ImPlotAxisFlags_AutoFit);
+    ImPlot::PlotHistogram("end-to-end", m_latency_ms.data() + offset, count,
+                          64);
+    ImPlot::EndPlot();
+  }
+}
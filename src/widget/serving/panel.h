@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+
+#include "../../model/inspector.h"
+#include "../../runtime/serving.h"
+
+// Controls and live charts for the multi-session serving simulator.
+class ServingPanel {
+public:
+  void draw(const ModelInspector *inspector);
+
+private:
+  void draw_config();
+  void draw_stats();
+  void draw_plots();
+  void pull_samples();
+
+  sServingConfig m_config;
+  ServingSimulator m_simulator;
+  sServingStats m_stats;
+  double m_last_refresh = 0.0;
+
+  // streamed samples, one entry per completed request
+  size_t m_sample_cursor = 0;
+  std::vector<double> m_arrival_s;
+  std::vector<double> m_latency_ms;
+  std::vector<double> m_queue_ms;
+  std::vector<double> m_compute_ms;
+};
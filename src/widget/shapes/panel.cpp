@@ -0,0 +1,187 @@
+#include "panel.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <imgui.h>
+
+#include "../../model/tensor_utils.h"
+
+namespace {
+
+std::string trim(const std::string &text) {
+  const auto not_space = [](unsigned char c) { return !std::isspace(c); };
+  const auto begin = std::find_if(text.begin(), text.end(), not_space);
+  const auto end = std::find_if(text.rbegin(), text.rend(), not_space).base();
+  return begin < end ? std::string(begin, end) : std::string();
+}
+
+// "batch, 3, 224, 224": integers are static dims, "?" is unknown, anything
+// else names a symbolic dim
+bool parse_shape(ModelInspector &inspector, const char *text,
+                 std::vector<int64_t> &shape, std::string &error) {
+  shape.clear();
+  std::string source = text;
+  if (!source.empty() && source.front() == '[') {
+    source.erase(0, 1);
+  }
+  if (!source.empty() && source.back() == ']') {
+    source.pop_back();
+  }
+  size_t start = 0;
+  while (start <= source.size()) {
+    size_t comma = source.find(',', start);
+    if (comma == std::string::npos) {
+      comma = source.size();
+    }
+    const std::string token = trim(source.substr(start, comma - start));
+    start = comma + 1;
+    if (token.empty()) {
+      if (comma == source.size() && shape.empty()) {
+        // a scalar
+        break;
+      }
+      error = "empty dim in \"" + std::string(text) + "\"";
+      return false;
+    }
+    if (token == "?") {
+      shape.push_back(-1);
+    } else if (std::isdigit(static_cast<unsigned char>(token[0]))) {
+      char *end = nullptr;
+      const long long dim = std::strtoll(token.c_str(), &end, 10);
+      if (*end != '\0') {
+        error = "invalid dim \"" + token + "\"";
+        return false;
+      }
+      shape.push_back(dim);
+    } else {
+      shape.push_back(inspector.dim_symbol(token));
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+void ShapesPanel::draw(ModelViewer &viewer) {
+  auto *inspector = viewer.inspector();
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  if (m_model_path != inspector->model_path() ||
+      m_revision != inspector->revision()) {
+    m_model_path = inspector->model_path();
+    m_revision = inspector->revision();
+    const auto &graph = inspector->graph();
+    m_input_text.assign(graph.input_tensors.size(), {});
+    for (size_t i = 0; i < graph.input_tensors.size(); ++i) {
+      auto text =
+          shape_to_string(graph, graph.tensors[graph.input_tensors[i]]);
+      std::snprintf(m_input_text[i].data(), m_input_text[i].size(), "%s",
+                    text.c_str());
+    }
+  }
+
+  draw_inputs(*inspector);
+  draw_stats(*inspector);
+  draw_tensors(inspector->graph());
+}
+
+void ShapesPanel::draw_inputs(ModelInspector &inspector) {
+  const auto &graph = inspector.graph();
+  for (size_t i = 0; i < graph.input_tensors.size(); ++i) {
+    const int tensor_index = graph.input_tensors[i];
+    const auto &tensor = graph.tensors[tensor_index];
+    if (tensor.is_initializer) {
+      // older exporters list weights as graph inputs too
+      continue;
+    }
+    ImGui::PushID(static_cast<int>(i));
+    ImGui::InputText(tensor.name.c_str(), m_input_text[i].data(),
+                     m_input_text[i].size());
+    ImGui::SameLine();
+    if (ImGui::Button("Apply")) {
+      std::vector<int64_t> shape;
+      m_error.clear();
+      if (parse_shape(inspector, m_input_text[i].data(), shape, m_error)) {
+        inspector.set_input_shape(tensor_index, shape);
+      }
+    }
+    ImGui::PopID();
+  }
+  if (!m_error.empty()) {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s", m_error.c_str());
+  }
+}
+
+void ShapesPanel::draw_stats(const ModelInspector &inspector) {
+  const auto &stats = inspector.shape_inference_stats();
+  ImGui::Text("Last pass: %d nodes in %.3f ms, %d tensors updated",
+              stats.nodes_visited, stats.elapsed_ms, stats.tensors_updated);
+  ImGui::Text("%d tensors without a shape, %d with unknown dims",
+              stats.unknown_tensors, stats.partial_tensors);
+  if (!stats.unsupported_ops.empty() &&
+      ImGui::TreeNode("Ops without an inference rule")) {
+    for (const auto &[op_type, count] : stats.unsupported_ops) {
+      ImGui::BulletText("%s (%d)", op_type.c_str(), count);
+    }
+    ImGui::TreePop();
+  }
+}
+
+void ShapesPanel::draw_tensors(const sModelGraph &graph) {
+  ImGui::InputText("Filter", m_filter, sizeof(m_filter));
+  ImGui::SameLine();
+  ImGui::Checkbox("Unknown only", &m_unknown_only);
+
+  std::vector<int> rows;
+  for (int i = 0; i < static_cast<int>(graph.tensors.size()); ++i) {
+    const auto &tensor = graph.tensors[i];
+    if (m_filter[0] != '\0' &&
+        tensor.name.find(m_filter) == std::string::npos) {
+      continue;
+    }
+    const bool unknown =
+        tensor_element_count(tensor) < 0 ||
+        std::count(tensor.shape.begin(), tensor.shape.end(), -1) > 0;
+    if (m_unknown_only && !unknown) {
+      continue;
+    }
+    rows.push_back(i);
+  }
+
+  if (!ImGui::BeginTable("shapes_tensors", 3,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                             ImGuiTableFlags_ScrollY |
+                             ImGuiTableFlags_Resizable)) {
+    return;
+  }
+  ImGui::TableSetupScrollFreeze(0, 1);
+  ImGui::TableSetupColumn("Tensor");
+  ImGui::TableSetupColumn("Shape");
+  ImGui::TableSetupColumn("Type");
+  ImGui::TableHeadersRow();
+  ImGuiListClipper clipper;
+  clipper.Begin(static_cast<int>(rows.size()));
+  while (clipper.Step()) {
+    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+      const auto &tensor = graph.tensors[rows[row]];
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      if (tensor.is_initializer) {
+        ImGui::TextDisabled("%s", tensor.name.c_str());
+      } else {
+        ImGui::TextUnformatted(tensor.name.c_str());
+      }
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(shape_to_string(graph, tensor).c_str());
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(model_dtype_name(tensor.tensorDataType));
+    }
+  }
+  ImGui::EndTable();
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../model_viewer/viewer.h"
+
+// Inferred tensor shapes and types, with editable graph input shapes.
+class ShapesPanel {
+public:
+  void draw(ModelViewer &viewer);
+
+private:
+  void draw_inputs(ModelInspector &inspector);
+  void draw_stats(const ModelInspector &inspector);
+  void draw_tensors(const sModelGraph &graph);
+
+  std::string m_model_path;
+  uint64_t m_revision = 0;
+  // one editable "batch, 3, 224, 224" line per graph input
+  std::vector<std::array<char, 128>> m_input_text;
+  std::string m_error;
+  char m_filter[128] = {};
+  bool m_unknown_only = false;
+};
@@ -0,0 +1,239 @@
+#include "panel.h"
+
+#include <chrono>
+
+#include <imgui.h>
+
+#include "../../engine/thread_pool.h"
+
+void SparsityPanel::draw(ModelViewer &viewer) {
+  const auto *inspector = viewer.inspector();
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  if (m_pending.valid() && m_pending.wait_for(std::chrono::seconds(0)) ==
+                               std::future_status::ready) {
+    m_report = m_pending.get();
+    m_has_report = true;
+    m_selected = -1;
+  }
+  if (m_pruning.valid() && m_pruning.wait_for(std::chrono::seconds(0)) ==
+                               std::future_status::ready) {
+    m_result = m_pruning.get();
+    m_has_result = true;
+  }
+  if (!m_pending.valid() && m_model_path != inspector->model_path()) {
+    m_has_report = false;
+    m_has_result = false;
+    start_analysis(*inspector);
+  }
+
+  const bool busy = m_pending.valid();
+  ImGui::BeginDisabled(busy);
+  ImGui::SliderFloat("Target sparsity", &m_target, 0.1f, 0.95f, "%.2f");
+  ImGui::SliderFloat("Max norm loss %", &m_max_loss_percent, 0.f, 50.f,
+                     "%.1f");
+  ImGui::SliderInt("Batch size", &m_batch_size, 1, 256);
+  if (ImGui::Button("Analyze")) {
+    start_analysis(*inspector);
+  }
+  ImGui::EndDisabled();
+  if (busy) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted("running...");
+    return;
+  }
+  if (!m_has_report) {
+    return;
+  }
+  if (!m_report.ok) {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s",
+                       m_report.error.c_str());
+    return;
+  }
+  draw_summary(viewer);
+  if (ImGui::CollapsingHeader("Prune and benchmark")) {
+    draw_pruning(*inspector);
+  }
+  draw_layers(inspector->graph(), viewer);
+}
+
+void SparsityPanel::start_analysis(const ModelInspector &inspector) {
+  m_model_path = inspector.model_path();
+  sSparsityConfig config;
+  config.target = m_target;
+  config.max_energy_loss = m_max_loss_percent / 100.f;
+  config.batch_size = m_batch_size;
+  m_pending = ThreadPool::shared().submit(
+      TASK_PRIORITY_BACKGROUND, [path = inspector.model_path(),
+                                 graph = inspector.graph(), config] {
+        return analyze_sparsity(path, graph, config);
+      });
+}
+
+void SparsityPanel::draw_summary(ModelViewer &viewer) {
+  const auto &r = m_report;
+  std::vector<int> worth;
+  for (const auto &layer : r.layers) {
+    if (layer.best < PRUNING_PATTERN_COUNT) {
+      worth.push_back(layer.node);
+    }
+  }
+  ImGui::Text("%zu layers, %.1f%% of %.3f GFLOPs, analyzed in %.1f ms",
+              r.layers.size(), r.covered_flops * 100.0,
+              r.total_flops * 1e-9, r.elapsed_ms);
+  ImGui::Text("Model speedup with every layer pruned:");
+  for (int p = 0; p < PRUNING_PATTERN_COUNT; ++p) {
+    ImGui::SameLine();
+    ImGui::Text("%s %.2fx",
+                pruning_pattern_name(static_cast<ePruningPattern>(p)),
+                r.model_speedup[p]);
+  }
+  ImGui::Text("%zu layers worth pruning within the loss budget: %.2fx",
+              worth.size(), r.recommended_speedup);
+  ImGui::SameLine();
+  if (ImGui::Button("Highlight")) {
+    viewer.highlight_nodes(worth);
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Clear highlight")) {
+    viewer.highlight_nodes({});
+  }
+}
+
+void SparsityPanel::draw_layers(const sModelGraph &graph,
+                                ModelViewer &viewer) {
+  if (!ImGui::BeginTable("sparsity_layers", 10,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                             ImGuiTableFlags_ScrollY |
+                             ImGuiTableFlags_Resizable,
+                         ImVec2(0, -1))) {
+    return;
+  }
+  ImGui::TableSetupScrollFreeze(0, 1);
+  ImGui::TableSetupColumn("Layer");
+  ImGui::TableSetupColumn("Matrix");
+  ImGui::TableSetupColumn("FLOPs");
+  ImGui::TableSetupColumn("Zeros");
+  ImGui::TableSetupColumn("2:4 groups");
+  ImGui::TableSetupColumn("Zero ch");
+  ImGui::TableSetupColumn("Zero tiles");
+  ImGui::TableSetupColumn("Now");
+  ImGui::TableSetupColumn("Best");
+  ImGui::TableSetupColumn("Model gain");
+  ImGui::TableHeadersRow();
+  ImGuiListClipper clipper;
+  clipper.Begin(static_cast<int>(m_report.layers.size()));
+  while (clipper.Step()) {
+    for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+      const auto &layer = m_report.layers[i];
+      const auto &node = graph.nodes[layer.node];
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::PushID(i);
+      if (ImGui::Selectable(node.name.empty() ? node.op_type.c_str()
+                                              : node.name.c_str(),
+                            m_selected == i,
+                            ImGuiSelectableFlags_SpanAllColumns)) {
+        m_selected = m_selected == i ? -1 : i;
+        viewer.highlight_nodes(m_selected >= 0
+                                   ? std::vector<int>{layer.node}
+                                   : std::vector<int>{});
+      }
+      if (ImGui::IsItemHovered()) {
+        // the loss and speedup of every pattern
+        ImGui::BeginTooltip();
+        ImGui::Text("%s, %s", node.op_type.c_str(), layer.weight.c_str());
+        for (int p = 0; p < PRUNING_PATTERN_COUNT; ++p) {
+          ImGui::Text("%-12s norm loss %5.1f%%  layer %.2fx  model %.3fx",
+                      pruning_pattern_name(static_cast<ePruningPattern>(p)),
+                      layer.energy_loss[p] * 100.0, layer.speedup[p],
+                      layer.model_speedup[p]);
+        }
+        ImGui::EndTooltip();
+      }
+      ImGui::PopID();
+      ImGui::TableNextColumn();
+      ImGui::Text("%lld x %lld", static_cast<long long>(layer.matrix.rows),
+                  static_cast<long long>(layer.matrix.cols));
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f%%", layer.flop_share * 100.0);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f%%", layer.zeros * 100.0);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f%%", layer.groups_2_4 * 100.0);
+      ImGui::TableNextColumn();
+      ImGui::Text("%lld", static_cast<long long>(layer.zero_channels));
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f%%", layer.zero_blocks * 100.0);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2fx", layer.current_speedup);
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(pruning_pattern_name(layer.best));
+      ImGui::TableNextColumn();
+      if (layer.best < PRUNING_PATTERN_COUNT) {
+        ImGui::Text("%.3fx", layer.model_speedup[layer.best]);
+      } else {
+        ImGui::TextUnformatted("-");
+      }
+    }
+  }
+  ImGui::EndTable();
+}
+
+void SparsityPanel::draw_pruning(const ModelInspector &inspector) {
+  const bool busy = m_pruning.valid();
+  ImGui::BeginDisabled(busy);
+  const char *choices[] = {"Recommended", "Unstructured, all layers",
+                           "2:4, all layers", "Channel, all layers",
+                           "4x4 block, all layers"};
+  ImGui::Combo("Prune", &m_prune_choice, choices, IM_ARRAYSIZE(choices));
+  ImGui::InputText("Output", m_output_path, sizeof(m_output_path));
+  ImGui::SliderInt("Iterations", &m_iterations, 1, 200);
+  if (ImGui::Button("Prune and benchmark")) {
+    sPruningConfig config;
+    for (const auto &layer : m_report.layers) {
+      if (m_prune_choice > 0) {
+        config.weights[layer.weight] =
+            static_cast<ePruningPattern>(m_prune_choice - 1);
+      } else if (layer.best < PRUNING_PATTERN_COUNT) {
+        config.weights[layer.weight] = layer.best;
+      }
+    }
+    config.target = m_target;
+    config.output_path = m_output_path;
+    config.iterations = m_iterations;
+    config.batch_size = m_batch_size;
+    m_pruning = ThreadPool::shared().submit(
+        TASK_PRIORITY_BACKGROUND, [path = inspector.model_path(), config] {
+          return WeightPruner::run(path, config);
+        });
+  }
+  ImGui::EndDisabled();
+  if (busy) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted("running...");
+  }
+  if (m_has_result) {
+    draw_pruning_result();
+  }
+}
+
+void SparsityPanel::draw_pruning_result() {
+  const auto &r = m_result;
+  if (!r.ok) {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s", r.error.c_str());
+    return;
+  }
+  ImGui::TextWrapped("Wrote %s", r.output_path.c_str());
+  ImGui::Text("%d weights pruned, %lld of %lld parameters zeroed",
+              r.pruned_weights, static_cast<long long>(r.zeroed),
+              static_cast<long long>(r.params));
+  ImGui::Text("Latency p50: dense %.3f ms, pruned %.3f ms (dense kernels)",
+              r.dense_p50_ms, r.pruned_p50_ms);
+  for (const auto &output : r.outputs) {
+    ImGui::Text("%s: max abs diff %.4g, cosine %.5f", output.name.c_str(),
+                output.max_abs_diff, output.cosine);
+  }
+}
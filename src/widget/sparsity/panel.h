@@ -0,0 +1,42 @@
+#pragma once
+
+#include <future>
+#include <string>
+#include <vector>
+
+#include "../../model/sparsity.h"
+#include "../../runtime/pruning.h"
+#include "../model_viewer/viewer.h"
+
+// Weight sparsity patterns per layer, the speedup sparse kernels could get
+// from pruning each one, and a pruned model benchmarked against the dense
+// one.
+class SparsityPanel {
+public:
+  void draw(ModelViewer &viewer);
+
+private:
+  void start_analysis(const ModelInspector &inspector);
+  void draw_summary(ModelViewer &viewer);
+  void draw_layers(const sModelGraph &graph, ModelViewer &viewer);
+  void draw_pruning(const ModelInspector &inspector);
+  void draw_pruning_result();
+
+  std::string m_model_path;
+  float m_target = 0.5f;
+  float m_max_loss_percent = 5.f;
+  int m_batch_size = 1;
+  sSparsityReport m_report;
+  bool m_has_report = false;
+  std::future<sSparsityReport> m_pending;
+  int m_selected = -1;
+
+  // 0 prunes the layers worth it to their best pattern, others one
+  // pattern everywhere
+  int m_prune_choice = 0;
+  char m_output_path[512] = {};
+  int m_iterations = 20;
+  sPruningResult m_result;
+  bool m_has_result = false;
+  std::future<sPruningResult> m_pruning;
+};
@@ -0,0 +1,139 @@
+#include "panel.h"
+
+#include <chrono>
+#include <iterator>
+
+#include <imgui.h>
+#include <implot.h>
+
+#include "../../engine/thread_pool.h"
+
+namespace {
+
+template <typename T> bool ready(std::future<T> &future) {
+  return future.valid() && future.wait_for(std::chrono::seconds(0)) ==
+                               std::future_status::ready;
+}
+
+} // namespace
+
+void StartupPanel::draw(const ModelInspector *inspector) {
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  if (ready(m_pending_cold)) {
+    m_cold = m_pending_cold.get();
+  }
+  if (ready(m_pending_warm)) {
+    m_warm = m_pending_warm.get();
+  }
+
+  const std::string path = inspector->model_path();
+  const bool busy = m_pending_cold.valid() || m_pending_warm.valid();
+  ImGui::BeginDisabled(busy);
+  if (ImGui::Button("Profile cold start")) {
+    m_pending_cold =
+        ThreadPool::shared().submit(TASK_PRIORITY_BACKGROUND, [path] {
+          return StartupProfiler::profile_cold(path);
+        });
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Profile warm start")) {
+    m_pending_warm =
+        ThreadPool::shared().submit(TASK_PRIORITY_BACKGROUND, [path] {
+          return StartupProfiler::profile_warm(path);
+        });
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Clear cache")) {
+    StartupProfiler::clear_cache(path);
+    m_warm = sStartupProfile{};
+  }
+  ImGui::EndDisabled();
+  if (busy) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted("profiling...");
+  }
+
+  ImGui::Text("Warm-start cache: %s",
+              StartupProfiler::has_cache(path) ? "present" : "not built");
+  ImGui::TextDisabled("%s", StartupProfiler::cache_dir(path).c_str());
+  for (const auto *profile : {&m_cold, &m_warm}) {
+    if (!profile->error.empty()) {
+      ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s",
+                         profile->error.c_str());
+    }
+  }
+  draw_comparison();
+}
+
+void StartupPanel::draw_comparison() {
+  if (!m_cold.ok && !m_warm.ok) {
+    return;
+  }
+  struct sPhase {
+    const char *label;
+    double sStartupProfile::*field;
+  };
+  constexpr sPhase phases[] = {
+      {"Model load", &sStartupProfile::model_load_ms},
+      {"Graph optimization", &sStartupProfile::graph_optimization_ms},
+      {"Kernel init", &sStartupProfile::kernel_init_ms},
+      {"First run", &sStartupProfile::first_run_ms},
+  };
+  constexpr int phase_count = static_cast<int>(std::size(phases));
+
+  if (ImGui::BeginTable("startup_phases", 4,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("Phase");
+    ImGui::TableSetupColumn("Cold");
+    ImGui::TableSetupColumn("Warm");
+    ImGui::TableSetupColumn("Speedup");
+    ImGui::TableHeadersRow();
+    auto cell = [](bool ok, double ms) {
+      ImGui::TableNextColumn();
+      if (ok) {
+        ImGui::Text("%.1f ms", ms);
+      } else {
+        ImGui::TextDisabled("-");
+      }
+    };
+    auto row = [&](const char *label, double cold, double warm) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(label);
+      cell(m_cold.ok, cold);
+      cell(m_warm.ok, warm);
+      ImGui::TableNextColumn();
+      if (m_cold.ok && m_warm.ok && warm > 0.0) {
+        ImGui::Text("%.2fx", cold / warm);
+      }
+    };
+    for (const auto &phase : phases) {
+      row(phase.label, m_cold.*phase.field, m_warm.*phase.field);
+    }
+    row("Session create (total)", m_cold.create_ms, m_warm.create_ms);
+    ImGui::EndTable();
+  }
+
+  // stacked bars: one bar per start mode, one segment per phase
+  const char *labels[phase_count];
+  double values[phase_count * 2];
+  for (int i = 0; i < phase_count; ++i) {
+    labels[i] = phases[i].label;
+    values[i * 2] = m_cold.*phases[i].field;
+    values[i * 2 + 1] = m_warm.*phases[i].field;
+  }
+  if (ImPlot::BeginPlot("Startup", ImVec2(-1, 200))) {
+    static const char *modes[] = {"cold", "warm"};
+    static const double positions[] = {0.0, 1.0};
+    ImPlot::SetupAxes("ms", nullptr, ImPlotAxisFlags_AutoFit,
+                      ImPlotAxisFlags_AutoFit);
+    ImPlot::SetupAxisTicks(ImAxis_Y1, positions, 2, modes);
+    ImPlot::PlotBarGroups(labels, values, phase_count, 2, 0.67, 0,
+                          ImPlotBarGroupsFlags_Stacked |
+                              ImPlotBarGroupsFlags_Horizontal);
+    ImPlot::EndPlot();
+  }
+}
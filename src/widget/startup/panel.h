@@ -0,0 +1,21 @@
+#pragma once
+
+#include <future>
+#include <string>
+
+#include "../../model/inspector.h"
+#include "../../runtime/startup.h"
+
+// Cold versus warm-start session startup, phase by phase.
+class StartupPanel {
+public:
+  void draw(const ModelInspector *inspector);
+
+private:
+  void draw_comparison();
+
+  sStartupProfile m_cold;
+  sStartupProfile m_warm;
+  std::future<sStartupProfile> m_pending_cold;
+  std::future<sStartupProfile> m_pending_warm;
+};
@@ -0,0 +1,295 @@
+#include "panel.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <imgui.h>
+#include <implot.h>
+
+#include "../../engine/thread_pool.h"
+
+namespace {
+
+constexpr int kMaxHeatmapDim = 128;
+
+std::string shape_to_string(const std::vector<int64_t> &shape) {
+  std::string text = "[";
+  for (size_t i = 0; i < shape.size(); ++i) {
+    if (i > 0) {
+      text += ", ";
+    }
+    text += shape[i] < 0 ? "?" : std::to_string(shape[i]);
+  }
+  return text + "]";
+}
+
+// splits a tensor into 2D planes over its last two dims
+void plane_layout(const std::vector<int64_t> &shape, int &planes, int &rows,
+                  int &cols) {
+  planes = 1;
+  rows = 1;
+  cols = 1;
+  if (shape.empty()) {
+    return;
+  }
+  cols = static_cast<int>(shape.back());
+  if (shape.size() >= 2) {
+    rows = static_cast<int>(shape[shape.size() - 2]);
+  }
+  for (size_t i = 0; i + 2 < shape.size(); ++i) {
+    planes *= static_cast<int>(shape[i]);
+  }
+}
+
+} // namespace
+
+void TensorInspectorPanel::draw(
+    const ModelInspector *inspector,
+    const std::vector<const sModelGraphNode *> &selected_nodes) {
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  const auto &graph = inspector->graph();
+  if (m_model_path != inspector->model_path() ||
+      m_selected.size() != graph.tensors.size()) {
+    m_model_path = inspector->model_path();
+    m_selected.assign(graph.tensors.size(), false);
+    m_plot.clear();
+    m_plot_tensor = -1;
+    m_capture = ActivationCapture{};
+  }
+  poll_capture();
+
+  if (ImGui::BeginTabBar("tensor_inspector_tabs")) {
+    if (ImGui::BeginTabItem("Select")) {
+      draw_tensor_picker(graph, selected_nodes);
+      ImGui::EndTabItem();
+    }
+    if (ImGui::BeginTabItem("Captured")) {
+      draw_captured();
+      ImGui::EndTabItem();
+    }
+    ImGui::EndTabBar();
+  }
+}
+
+void TensorInspectorPanel::poll_capture() {
+  if (!m_pending.valid()) {
+    return;
+  }
+  if (m_pending.wait_for(std::chrono::seconds(0)) !=
+      std::future_status::ready) {
+    return;
+  }
+  m_plot.clear();
+  m_plot_tensor = -1;
+  m_capture = m_pending.get();
+  m_current = 0;
+  m_plane = 0;
+  m_heatmap_tensor = -1;
+}
+
+void TensorInspectorPanel::draw_tensor_picker(
+    const sModelGraph &graph,
+    const std::vector<const sModelGraphNode *> &nodes) {
+  const bool busy = m_pending.valid();
+  ImGui::BeginDisabled(busy);
+  if (ImGui::Button("Add outputs of selected nodes")) {
+    for (const auto *node : nodes) {
+      for (int edge_index : node->output_edges) {
+        if (edge_index < 0 ||
+            edge_index >= static_cast<int>(graph.edges.size())) {
+          continue;
+        }
+        const int tensor_index = graph.edges[edge_index].tensor_index;
+        if (tensor_index >= 0 &&
+            tensor_index < static_cast<int>(m_selected.size())) {
+          m_selected[tensor_index] = true;
+        }
+      }
+    }
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Clear")) {
+    std::fill(m_selected.begin(), m_selected.end(), false);
+  }
+  ImGui::SameLine();
+  const int selected_count =
+      static_cast<int>(std::count(m_selected.begin(), m_selected.end(), true));
+  if (ImGui::Button("Capture") && selected_count > 0) {
+    std::vector<std::string> names;
+    for (size_t i = 0; i < m_selected.size(); ++i) {
+      if (m_selected[i]) {
+        names.push_back(graph.tensors[i].name);
+      }
+    }
+    m_pending = ThreadPool::shared().submit(
+        TASK_PRIORITY_BACKGROUND,
+        [path = m_model_path, names = std::move(names)] {
+          ActivationCapture capture;
+          capture.capture(path, names);
+          return capture;
+        });
+  }
+  ImGui::EndDisabled();
+  ImGui::SameLine();
+  if (busy) {
+    ImGui::TextUnformatted("capturing...");
+  } else {
+    ImGui::Text("%d selected", selected_count);
+  }
+
+  ImGui::InputText("Filter", m_filter, sizeof(m_filter));
+  if (!ImGui::BeginChild("tensor_list", ImVec2(0, 0),
+                         ImGuiChildFlags_Borders)) {
+    ImGui::EndChild();
+    return;
+  }
+  for (size_t i = 0; i < graph.tensors.size(); ++i) {
+    const auto &tensor = graph.tensors[i];
+    // initializers are weights, not activations
+    if (tensor.is_initializer) {
+      continue;
+    }
+    if (m_filter[0] != '\0' &&
+        tensor.name.find(m_filter) == std::string::npos) {
+      continue;
+    }
+    bool checked = m_selected[i];
+    ImGui::PushID(static_cast<int>(i));
+    if (ImGui::Checkbox(tensor.name.c_str(), &checked)) {
+      m_selected[i] = checked;
+    }
+    ImGui::PopID();
+  }
+  ImGui::EndChild();
+}
+
+void TensorInspectorPanel::draw_captured() {
+  if (!m_capture.error().empty()) {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s",
+                       m_capture.error().c_str());
+  }
+  const auto &tensors = m_capture.tensors();
+  if (tensors.empty()) {
+    ImGui::TextUnformatted("Nothing captured yet.");
+    return;
+  }
+  m_current = std::clamp(m_current, 0, static_cast<int>(tensors.size()) - 1);
+  if (ImGui::BeginCombo("Tensor", tensors[m_current].name.c_str())) {
+    for (int i = 0; i < static_cast<int>(tensors.size()); ++i) {
+      if (ImGui::Selectable(tensors[i].name.c_str(), i == m_current)) {
+        m_current = i;
+        m_plane = 0;
+      }
+    }
+    ImGui::EndCombo();
+  }
+  draw_tensor(tensors[m_current]);
+}
+
+void TensorInspectorPanel::draw_tensor(const sCapturedTensor &tensor) {
+  const auto &stats = tensor.stats;
+  ImGui::Text("Shape: %s", shape_to_string(tensor.shape).c_str());
+  ImGui::Text("min %.5g  max %.5g  mean %.5g  std %.5g", stats.min, stats.max,
+              stats.mean, stats.std);
+  ImGui::Text("elements %zu  NaN %zu  Inf %zu", stats.count, stats.nan_count,
+              stats.inf_count);
+
+  if (!stats.histogram.empty() &&
+      ImPlot::BeginPlot("Histogram", ImVec2(-1, 180))) {
+    const int bins = static_cast<int>(stats.histogram.size());
+    const double width = (stats.max - stats.min) / bins;
+    std::vector<double> xs(bins);
+    std::vector<double> ys(bins);
+    for (int i = 0; i < bins; ++i) {
+      xs[i] = stats.min + (i + 0.5) * width;
+      ys[i] = stats.histogram[i];
+    }
+    ImPlot::SetupAxes("value", "count", ImPlotAxisFlags_AutoFit,
+                      ImPlotAxisFlags_AutoFit);
+    ImPlot::PlotBars("values", xs.data(), ys.data(), bins,
+                     width > 0.0 ? width : 1.0);
+    ImPlot::EndPlot();
+  }
+
+  if (m_plot_tensor != m_current) {
+    m_plot_tensor = m_current;
+    m_plot.set_source(tensor.shape, tensor.data.size(),
+                      [data = tensor.data.data()](size_t first, size_t,
+                                                  float *) {
+                        return data + first;
+                      });
+  }
+  if (ImGui::CollapsingHeader("Values")) {
+    m_plot.draw();
+  }
+
+  int planes = 1;
+  int rows = 1;
+  int cols = 1;
+  plane_layout(tensor.shape, planes, rows, cols);
+  if (planes > 1) {
+    ImGui::SliderInt("Plane", &m_plane, 0, planes - 1);
+  }
+  m_plane = std::clamp(m_plane, 0, planes - 1);
+  update_heatmap(tensor);
+  if (m_heatmap.empty()) {
+    return;
+  }
+  if (ImPlot::BeginPlot("Heatmap", ImVec2(-1, -1),
+                        ImPlotFlags_Equal | ImPlotFlags_NoLegend)) {
+    ImPlot::SetupAxes(nullptr, nullptr, ImPlotAxisFlags_NoDecorations,
+                      ImPlotAxisFlags_NoDecorations);
+    ImPlot::PlotHeatmap("##activation", m_heatmap.data(), m_heatmap_rows,
+                        m_heatmap_cols, stats.min, stats.max, nullptr,
+                        ImPlotPoint(0, 0), ImPlotPoint(cols, rows));
+    ImPlot::EndPlot();
+  }
+}
+
+void TensorInspectorPanel::update_heatmap(const sCapturedTensor &tensor) {
+  if (m_heatmap_tensor == m_current && m_heatmap_plane == m_plane) {
+    return;
+  }
+  m_heatmap_tensor = m_current;
+  m_heatmap_plane = m_plane;
+  m_heatmap.clear();
+
+  int planes = 1;
+  int rows = 1;
+  int cols = 1;
+  plane_layout(tensor.shape, planes, rows, cols);
+  const size_t plane_size = static_cast<size_t>(rows) * cols;
+  if (plane_size == 0 ||
+      (static_cast<size_t>(m_plane) + 1) * plane_size > tensor.data.size()) {
+    return;
+  }
+  const float *plane = tensor.data.data() + m_plane * plane_size;
+
+  // block-average the plane down to the heatmap resolution
+  m_heatmap_rows = std::min(rows, kMaxHeatmapDim);
+  m_heatmap_cols = std::min(cols, kMaxHeatmapDim);
+  m_heatmap.assign(static_cast<size_t>(m_heatmap_rows) * m_heatmap_cols, 0.f);
+  std::vector<int> hits(m_heatmap.size(), 0);
+  for (int r = 0; r < rows; ++r) {
+    const int hr = static_cast<int>(static_cast<int64_t>(r) * m_heatmap_rows /
+                                    rows);
+    for (int c = 0; c < cols; ++c) {
+      const int hc = static_cast<int>(static_cast<int64_t>(c) *
+                                      m_heatmap_cols / cols);
+      const float x = plane[static_cast<size_t>(r) * cols + c];
+      if (x - x != 0.f) {
+        continue;
+      }
+      m_heatmap[hr * m_heatmap_cols + hc] += x;
+      ++hits[hr * m_heatmap_cols + hc];
+    }
+  }
+  for (size_t i = 0; i < m_heatmap.size(); ++i) {
+    if (hits[i] > 0) {
+      m_heatmap[i] /= hits[i];
+    }
+  }
+}
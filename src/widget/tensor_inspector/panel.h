@@ -0,0 +1,45 @@
+#pragma once
+
+#include <future>
+#include <string>
+#include <vector>
+
+#include "../../model/inspector.h"
+#include "../../runtime/activation.h"
+#include "../tensor_plot/plot.h"
+
+// Picks graph tensors, captures them in one forward pass and shows their
+// statistics, histogram, values and a downsampled heatmap.
+class TensorInspectorPanel {
+public:
+  void draw(const ModelInspector *inspector,
+            const std::vector<const sModelGraphNode *> &selected_nodes);
+
+private:
+  void draw_tensor_picker(const sModelGraph &graph,
+                          const std::vector<const sModelGraphNode *> &nodes);
+  void draw_captured();
+  void draw_tensor(const sCapturedTensor &tensor);
+  void poll_capture();
+  void update_heatmap(const sCapturedTensor &tensor);
+
+  std::string m_model_path;
+  std::vector<bool> m_selected;
+  char m_filter[128] = "";
+
+  ActivationCapture m_capture;
+  std::future<ActivationCapture> m_pending;
+  int m_current = 0;
+  int m_plane = 0;
+
+  // heatmap of the current plane, block-averaged to at most kMaxHeatmapDim
+  std::vector<float> m_heatmap;
+  int m_heatmap_rows = 0;
+  int m_heatmap_cols = 0;
+  int m_heatmap_tensor = -1;
+  int m_heatmap_plane = -1;
+
+  // values of the current tensor; reads m_capture, so declared after it
+  TensorPlot m_plot;
+  int m_plot_tensor = -1;
+};
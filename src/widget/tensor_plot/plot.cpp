@@ -0,0 +1,164 @@
+#include "plot.h"
+
+#include <chrono>
+
+#include <imgui.h>
+#include <implot.h>
+#include <implot3d.h>
+
+#include "../../engine/thread_pool.h"
+
+namespace {
+
+constexpr double kMiB = 1024.0 * 1024.0;
+// surface cells per side; more does not read at plot size
+constexpr int kSurfaceDim = 96;
+
+// leading dim against the rest, after dropping leading 1s: output channels
+// of a conv kernel or MatMul weight, channels of an activation
+void surface_layout(const std::vector<int64_t> &shape, size_t count,
+                    size_t &rows, size_t &cols) {
+  rows = 0;
+  cols = 0;
+  size_t first = 0;
+  while (first < shape.size() && shape[first] == 1) {
+    ++first;
+  }
+  if (shape.size() < first + 2 || shape[first] <= 1) {
+    return;
+  }
+  rows = static_cast<size_t>(shape[first]);
+  cols = count / rows;
+}
+
+} // namespace
+
+TensorPlot::~TensorPlot() { clear(); }
+
+void TensorPlot::set_source(const std::vector<int64_t> &shape, size_t count,
+                            ValueReader read) {
+  clear();
+  m_shape = shape;
+  m_count = count;
+  m_read = std::move(read);
+  surface_layout(m_shape, m_count, m_rows, m_cols);
+  m_pending = ThreadPool::shared().submit(
+      TASK_PRIORITY_BACKGROUND,
+      [count, read = m_read] { return build_pyramid(count, read); });
+}
+
+void TensorPlot::clear() {
+  if (m_pending.valid()) {
+    m_pending.wait();
+    m_pending = {};
+  }
+  if (m_grid_pending.valid()) {
+    m_grid_pending.wait();
+    m_grid_pending = {};
+  }
+  m_shape.clear();
+  m_count = 0;
+  m_read = nullptr;
+  m_pyramid = {};
+  m_series = {};
+  m_width = 0;
+  m_fit = true;
+  m_grid_ready = false;
+}
+
+void TensorPlot::draw() {
+  if (empty()) {
+    return;
+  }
+  if (m_pending.valid()) {
+    if (m_pending.wait_for(std::chrono::seconds(0)) !=
+        std::future_status::ready) {
+      ImGui::TextUnformatted("summarizing...");
+      return;
+    }
+    m_pyramid = m_pending.get();
+  }
+  ImGui::Text("%zu values, %zu levels of %zu+ values (%.2f MiB) in %.1f ms",
+              m_pyramid.count, m_pyramid.levels.size(), m_pyramid.base,
+              m_pyramid.bytes() / kMiB, m_pyramid.build_ms);
+  if (m_rows > 0) {
+    ImGui::SameLine();
+    ImGui::Checkbox("3D surface", &m_show_surface);
+  }
+  if (m_show_surface && m_rows > 0) {
+    draw_surface();
+  } else {
+    draw_series();
+  }
+}
+
+void TensorPlot::draw_series() {
+  if (!ImPlot::BeginPlot("##tensor_values", ImVec2(-1, 240))) {
+    return;
+  }
+  ImPlot::SetupAxes("index", "value");
+  if (m_fit && !m_pyramid.levels.empty()) {
+    const auto &all = m_pyramid.levels.back()[0];
+    ImPlot::SetupAxesLimits(0.0, static_cast<double>(m_pyramid.count),
+                            all.empty() ? 0.0 : all.min,
+                            all.empty() ? 1.0 : all.max, ImPlotCond_Always);
+    m_fit = false;
+  }
+  // one point per pixel of the view, redone only when it moves
+  const ImPlotRect limits = ImPlot::GetPlotLimits();
+  const int width = static_cast<int>(ImPlot::GetPlotSize().x);
+  if (limits.X.Min != m_first || limits.X.Max != m_last ||
+      width != m_width) {
+    m_first = limits.X.Min;
+    m_last = limits.X.Max;
+    m_width = width;
+    decimate(m_pyramid, m_read, m_first, m_last, width, m_series);
+  }
+  const int points = static_cast<int>(m_series.x.size());
+  if (m_series.bucket <= 1) {
+    ImPlot::PlotLine("value", m_series.x.data(), m_series.min.data(),
+                     points);
+  } else {
+    ImPlot::PlotShaded("range", m_series.x.data(), m_series.min.data(),
+                       m_series.max.data(), points);
+    ImPlot::PlotLine("min", m_series.x.data(), m_series.min.data(), points);
+    ImPlot::PlotLine("max", m_series.x.data(), m_series.max.data(), points);
+  }
+  ImPlot::EndPlot();
+  if (m_series.bucket > 1) {
+    ImGui::Text("%zu values per point", m_series.bucket);
+  }
+}
+
+void TensorPlot::draw_surface() {
+  if (!m_grid_ready && !m_grid_pending.valid()) {
+    // the pyramid stays put until clear(), which waits for the build
+    m_grid_pending = ThreadPool::shared().submit(
+        TASK_PRIORITY_BACKGROUND,
+        [pyramid = &m_pyramid, read = m_read, rows = m_rows, cols = m_cols] {
+          sDecimatedGrid grid;
+          decimate_grid(*pyramid, read, rows, cols, kSurfaceDim, kSurfaceDim,
+                        grid);
+          return grid;
+        });
+  }
+  if (m_grid_pending.valid()) {
+    if (m_grid_pending.wait_for(std::chrono::seconds(0)) !=
+        std::future_status::ready) {
+      ImGui::TextUnformatted("folding...");
+      return;
+    }
+    m_grid = m_grid_pending.get();
+    m_grid_ready = true;
+  }
+  if (m_grid.rows == 0 || !ImPlot3D::BeginPlot("##tensor_surface",
+                                               ImVec2(-1, 360))) {
+    return;
+  }
+  ImPlot3D::SetupAxes("column", "row", "value");
+  ImPlot3D::PlotSurface("values", m_grid.xs.data(), m_grid.ys.data(),
+                        m_grid.zs.data(), m_grid.cols, m_grid.rows);
+  ImPlot3D::EndPlot();
+  ImGui::Text("%zu x %zu folded to %d x %d cells", m_rows, m_cols,
+              m_grid.rows, m_grid.cols);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <vector>
+
+#include "../../model/decimation.h"
+
+// Plots a tensor of any size from a min/max decimation pyramid: a line
+// view with about one point per pixel at every zoom level, and a 3D
+// surface of its leading dim against the rest. Only the pyramid and the
+// points on screen are held, never a copy of the values.
+class TensorPlot {
+public:
+  TensorPlot() = default;
+  ~TensorPlot();
+  TensorPlot(const TensorPlot &) = delete;
+  TensorPlot &operator=(const TensorPlot &) = delete;
+
+  // plots `count` values of a tensor shaped `shape`. `read` is kept for the
+  // raw values when zoomed in and must stay valid until clear() or the
+  // next set_source(). the pyramid is built in the background.
+  void set_source(const std::vector<int64_t> &shape, size_t count,
+                  ValueReader read);
+  // waits for pending builds, so the reader can be released
+  void clear();
+  bool empty() const { return m_count == 0; }
+
+  void draw();
+
+private:
+  void draw_series();
+  void draw_surface();
+
+  std::vector<int64_t> m_shape;
+  size_t m_count = 0;
+  ValueReader m_read;
+  std::future<sDecimationPyramid> m_pending;
+  sDecimationPyramid m_pyramid;
+
+  // points on screen, redone when the view moves
+  sDecimatedSeries m_series;
+  double m_first = 0.0;
+  double m_last = 0.0;
+  int m_width = 0;
+  bool m_fit = true;
+
+  bool m_show_surface = false;
+  // surface rows and columns, 0 when the tensor has a single row
+  size_t m_rows = 0;
+  size_t m_cols = 0;
+  sDecimatedGrid m_grid;
+  bool m_grid_ready = false;
+  // built in the background from m_pyramid and m_read
+  std::future<sDecimatedGrid> m_grid_pending;
+};
@@ -0,0 +1,268 @@
+#include "panel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <imgui.h>
+#include <implot.h>
+
+#include "../../engine/thread_pool.h"
+#include "../../model/shape_inference.h"
+#include "../../model/tensor_utils.h"
+
+namespace {
+
+constexpr double kMiB = 1024.0 * 1024.0;
+
+const char *kSortNames[] = {"Model order", "Size", "Sparsity",
+                            "Channel spread", "Range"};
+
+double magnitude(const sTensorStats &stats) {
+  return std::max(std::abs(static_cast<double>(stats.min)),
+                  std::abs(static_cast<double>(stats.max)));
+}
+
+} // namespace
+
+void WeightStatsPanel::draw(ModelViewer &viewer) {
+  const auto *inspector = viewer.inspector();
+  if (!inspector) {
+    ImGui::TextUnformatted("No model loaded.");
+    return;
+  }
+  if (m_pending.valid() && m_pending.wait_for(std::chrono::seconds(0)) ==
+                               std::future_status::ready) {
+    m_report = std::make_shared<const sWeightStatsReport>(m_pending.get());
+    select(-1);
+    sort_rows();
+    // a model loaded meanwhile is computed again below
+    if (m_model_path == inspector->model_path()) {
+      viewer.set_weight_stats(m_report);
+    }
+  }
+  // the weights on disk only change with the model
+  if (!m_pending.valid() && m_model_path != inspector->model_path()) {
+    start(*inspector);
+  }
+
+  const bool busy = m_pending.valid();
+  ImGui::BeginDisabled(busy);
+  if (ImGui::Button("Recompute")) {
+    start(*inspector);
+  }
+  ImGui::EndDisabled();
+  if (busy) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted("running...");
+    return;
+  }
+  if (!m_report) {
+    return;
+  }
+  if (!m_report->ok) {
+    ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s",
+                       m_report->error.c_str());
+    return;
+  }
+  draw_totals();
+  if (ImGui::Combo("Sort by", &m_sort, kSortNames,
+                   IM_ARRAYSIZE(kSortNames))) {
+    sort_rows();
+  }
+  draw_selected();
+  draw_table(inspector->graph(), viewer);
+}
+
+void WeightStatsPanel::start(const ModelInspector &inspector) {
+  m_model_path = inspector.model_path();
+  m_pending = ThreadPool::shared().submit(
+      TASK_PRIORITY_BACKGROUND,
+      [path = inspector.model_path(), graph = inspector.graph()] {
+        return compute_weight_stats(path, graph);
+      });
+}
+
+void WeightStatsPanel::select(int weight) {
+  m_selected = weight;
+  m_plot.clear();
+  m_plot_error.clear();
+  if (weight < 0) {
+    return;
+  }
+  const auto &w = m_report->weights[weight];
+  auto values = std::make_shared<WeightValues>(m_model_path, w.name);
+  if (!values->ok()) {
+    m_plot_error = values->error();
+    return;
+  }
+  // the reader owns the mapping, which lives as long as the plot uses it
+  m_plot.set_source(w.shape, values->size(),
+                    [values](size_t first, size_t count, float *buffer) {
+                      return values->read(first, count, buffer);
+                    });
+}
+
+void WeightStatsPanel::sort_rows() {
+  const auto &weights = m_report->weights;
+  m_rows.resize(weights.size());
+  for (size_t i = 0; i < m_rows.size(); ++i) {
+    m_rows[i] = static_cast<int>(i);
+  }
+  auto key = [&](int i) -> double {
+    const auto &w = weights[i];
+    switch (m_sort) {
+    case 1:
+      return static_cast<double>(w.stats.count);
+    case 2:
+      return w.sparsity();
+    case 3:
+      return w.channel_spread();
+    case 4:
+      return magnitude(w.stats);
+    default:
+      return -i;
+    }
+  };
+  std::stable_sort(m_rows.begin(), m_rows.end(),
+                   [&](int a, int b) { return key(a) > key(b); });
+}
+
+void WeightStatsPanel::draw_totals() {
+  const auto &r = *m_report;
+  const auto &total = r.total;
+  const double sparsity =
+      total.count > 0 ? static_cast<double>(total.zero_count) / total.count
+                      : 0.0;
+  ImGui::Text("%zu weights, %zu parameters (%.2f MiB), read in %.1f ms",
+              r.weights.size(), total.count, r.total_bytes / kMiB,
+              r.elapsed_ms);
+  ImGui::Text("min %.5g  max %.5g  mean %.5g  std %.5g", total.min,
+              total.max, total.mean, total.std);
+  ImGui::Text("%.2f%% zeros  NaN %zu  Inf %zu", sparsity * 100.0,
+              total.nan_count, total.inf_count);
+  if (r.skipped > 0) {
+    ImGui::Text("%d non floating point initializers skipped", r.skipped);
+  }
+}
+
+void WeightStatsPanel::draw_selected() {
+  if (m_selected < 0) {
+    return;
+  }
+  const auto &w = m_report->weights[m_selected];
+  const auto &stats = w.stats;
+  ImGui::Text("%s: min %.5g  max %.5g  mean %.5g  std %.5g", w.name.c_str(),
+              stats.min, stats.max, stats.mean, stats.std);
+  if (!stats.histogram.empty() &&
+      ImPlot::BeginPlot("Histogram", ImVec2(-1, 160))) {
+    const int bins = static_cast<int>(stats.histogram.size());
+    const double width = (stats.max - stats.min) / bins;
+    std::vector<double> xs(bins);
+    std::vector<double> ys(bins);
+    for (int i = 0; i < bins; ++i) {
+      xs[i] = stats.min + (i + 0.5) * width;
+      ys[i] = stats.histogram[i];
+    }
+    ImPlot::SetupAxes("value", "count", ImPlotAxisFlags_AutoFit,
+                      ImPlotAxisFlags_AutoFit);
+    ImPlot::PlotBars("values", xs.data(), ys.data(), bins,
+                     width > 0.0 ? width : 1.0);
+    ImPlot::EndPlot();
+  }
+  if (!w.channels.empty() &&
+      ImPlot::BeginPlot("Channel ranges", ImVec2(-1, 160))) {
+    const int count = static_cast<int>(w.channels.size());
+    std::vector<float> xs(count);
+    std::vector<float> lows(count);
+    std::vector<float> highs(count);
+    for (int c = 0; c < count; ++c) {
+      xs[c] = static_cast<float>(c);
+      lows[c] = w.channels[c].min;
+      highs[c] = w.channels[c].max;
+    }
+    ImPlot::SetupAxes("channel", "value", ImPlotAxisFlags_AutoFit,
+                      ImPlotAxisFlags_AutoFit);
+    ImPlot::PlotShaded("range", xs.data(), lows.data(), highs.data(), count);
+    ImPlot::PlotLine("min", xs.data(), lows.data(), count);
+    ImPlot::PlotLine("max", xs.data(), highs.data(), count);
+    ImPlot::EndPlot();
+  }
+  if (ImGui::CollapsingHeader("Values")) {
+    if (!m_plot_error.empty()) {
+      ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s",
+                         m_plot_error.c_str());
+    }
+    m_plot.draw();
+  }
+}
+
+void WeightStatsPanel::draw_table(const sModelGraph &graph,
+                                  ModelViewer &viewer) {
+  if (!ImGui::BeginTable("weights", 8,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                             ImGuiTableFlags_ScrollY |
+                             ImGuiTableFlags_Resizable,
+                         ImVec2(0, -1))) {
+    return;
+  }
+  ImGui::TableSetupScrollFreeze(0, 1);
+  ImGui::TableSetupColumn("Weight");
+  ImGui::TableSetupColumn("Shape");
+  ImGui::TableSetupColumn("Type");
+  ImGui::TableSetupColumn("Min");
+  ImGui::TableSetupColumn("Max");
+  ImGui::TableSetupColumn("Std");
+  ImGui::TableSetupColumn("Zeros");
+  ImGui::TableSetupColumn("Spread");
+  ImGui::TableHeadersRow();
+  const auto &weights = m_report->weights;
+  ImGuiListClipper clipper;
+  clipper.Begin(static_cast<int>(m_rows.size()));
+  while (clipper.Step()) {
+    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+      const int i = m_rows[row];
+      const auto &w = weights[i];
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::PushID(i);
+      // selecting a weight highlights the nodes reading it
+      if (ImGui::Selectable(w.name.c_str(), m_selected == i,
+                            ImGuiSelectableFlags_SpanAllColumns)) {
+        select(m_selected == i ? -1 : i);
+        std::vector<int> consumers;
+        for (size_t n = 0; m_selected >= 0 && n < graph.nodes.size(); ++n) {
+          const auto &inputs = graph.nodes[n].input_tensors;
+          if (std::find(inputs.begin(), inputs.end(), w.tensor) !=
+              inputs.end()) {
+            consumers.push_back(static_cast<int>(n));
+          }
+        }
+        viewer.highlight_nodes(consumers);
+      }
+      ImGui::PopID();
+      ImGui::TableNextColumn();
+      if (w.tensor < static_cast<int>(graph.tensors.size())) {
+        ImGui::TextUnformatted(
+            shape_to_string(graph, graph.tensors[w.tensor]).c_str());
+      }
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(model_dtype_name(w.dtype));
+      ImGui::TableNextColumn();
+      ImGui::Text("%.4g", w.stats.min);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.4g", w.stats.max);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.4g", w.stats.std);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f%%", w.sparsity() * 100.0);
+      ImGui::TableNextColumn();
+      if (w.channels.empty()) {
+        ImGui::TextUnformatted("-");
+      } else {
+        ImGui::Text("%.1fx", w.channel_spread());
+      }
+    }
+  }
+  ImGui::EndTable();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../../model/weight_stats.h"
+#include "../model_viewer/viewer.h"
+#include "../tensor_plot/plot.h"
+
+// Value statistics of the model's weights: model-wide totals, one row per
+// initializer, and the histogram, channel ranges and values of the selected
+// one.
+// The results also show in the viewer's node inspector.
+class WeightStatsPanel {
+public:
+  void draw(ModelViewer &viewer);
+
+private:
+  void start(const ModelInspector &inspector);
+  void draw_totals();
+  void draw_table(const sModelGraph &graph, ModelViewer &viewer);
+  void draw_selected();
+  void select(int weight);
+  void sort_rows();
+
+  std::string m_model_path;
+  int m_sort = 0;
+  int m_selected = -1;
+  std::shared_ptr<const sWeightStatsReport> m_report;
+  // weights indices in table order
+  std::vector<int> m_rows;
+  std::future<sWeightStatsReport> m_pending;
+  // values of the selected weight, read in place from the model
+  TensorPlot m_plot;
+  std::string m_plot_error;
+};